@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "AccessFile.hxx"
+#include "AprMd5.hxx"
+#include "util/CharUtil.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringAPI.hxx"
+#include "util/StringSplit.hxx"
+#include "util/StringStrip.hxx"
+
+#include <algorithm> // for std::transform()
+#include <memory>
+
+#include <crypt.h>
+
+static std::string
+ToLower(std::string_view s) noexcept
+{
+	std::string result{s};
+	std::transform(result.begin(), result.end(), result.begin(),
+		       ToLowerASCII);
+	return result;
+}
+
+AccessFileMap
+ParseAccessFile(std::string_view contents) noexcept
+{
+	AccessFileMap map;
+
+	for (std::string_view line : IterableSplitString(contents, '\n')) {
+		line = Strip(line);
+
+		const auto [user, crypted_password] = Split(line, ':');
+		if (user.empty() || crypted_password.data() == nullptr)
+			continue;
+
+		/* emplace() does not overwrite existing elements,
+		   i.e. the first line wins */
+		map.emplace(ToLower(user), crypted_password);
+	}
+
+	return map;
+}
+
+const std::string *
+FindAccessFileUser(const AccessFileMap &map, std::string_view user) noexcept
+{
+	auto i = map.find(ToLower(user));
+	if (i == map.end())
+		return nullptr;
+
+	return &i->second;
+}
+
+bool
+VerifyPassword(const char *crypted_password,
+	       const char *given_password) noexcept
+{
+	if (IsAprMd5(crypted_password)) {
+		const auto result = AprMd5(given_password, crypted_password);
+		return StringIsEqual(crypted_password, result.c_str());
+	}
+
+	/* crypt() is not thread-safe; use crypt_r() with a private
+	   buffer (which is too large for the stack) */
+	const auto data = std::make_unique<struct crypt_data>();
+
+	const char *p = crypt_r(given_password, crypted_password, data.get());
+	if (p == nullptr)
+		return false;
+
+	return StringIsEqual(p, crypted_password);
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Parser for the ".access" files of the mod_auth_easy emulation.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+/**
+ * The parsed contents of an ".access" file: a map of user names
+ * (converted to lower case) to crypted passwords.
+ */
+using AccessFileMap = std::map<std::string, std::string, std::less<>>;
+
+/**
+ * Parse the contents of an ".access" file.  Each line contains a
+ * user name and a crypted password separated by a colon.  If a user
+ * name appears more than once, the first line wins.
+ */
+AccessFileMap
+ParseAccessFile(std::string_view contents) noexcept;
+
+/**
+ * Look up a user in a parsed ".access" file (case-insensitive).
+ *
+ * @return the crypted password or nullptr if the user is not listed
+ */
+[[gnu::pure]]
+const std::string *
+FindAccessFileUser(const AccessFileMap &map, std::string_view user) noexcept;
+
+/**
+ * Verify a password against a crypted password (either APR's MD5
+ * or anything supported by crypt()).  This function is thread-safe,
+ * but it may be expensive; avoid calling it in the main thread.
+ */
+bool
+VerifyPassword(const char *crypted_password,
+	       const char *given_password) noexcept;
@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "AccessFileCache.hxx"
+#include "thread/WorkerJob.hxx"
+#include "thread/WorkerPool.hxx"
+#include "event/Loop.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "io/Logger.hxx"
+#include "io/linux/ProcPath.hxx"
+#include "util/Cancellable.hxx"
+
+#include <sodium/utils.h>
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+#include <fcntl.h> // for AT_EMPTY_PATH
+#include <sys/inotify.h>
+
+/**
+ * The approximate total memory used by parsed ".access" files.
+ */
+static constexpr std::size_t access_file_cache_size = 4 * 1024 * 1024;
+
+/**
+ * Files larger than this are not cached (and only this many bytes
+ * are parsed).
+ */
+static constexpr std::size_t access_file_size_limit = 256 * 1024;
+
+/**
+ * Parsed files expire after this duration even if inotify did not
+ * report a modification.
+ */
+static constexpr std::chrono::steady_clock::duration access_file_cache_expires =
+	std::chrono::minutes(10);
+
+/**
+ * How long is a successfully verified password remembered?
+ */
+static constexpr std::chrono::steady_clock::duration verified_credential_max_age =
+	std::chrono::minutes(5);
+
+/**
+ * Build the cache key from the identity (device and inode number) of
+ * a file.
+ */
+static std::string
+MakeKey(const struct statx &st) noexcept
+{
+	const struct {
+		uint_least32_t dev_major, dev_minor;
+		uint_least64_t ino;
+	} id{st.stx_dev_major, st.stx_dev_minor, st.stx_ino};
+
+	return std::string{reinterpret_cast<const char *>(&id), sizeof(id)};
+}
+
+[[gnu::pure]]
+static std::size_t
+GetMemorySize(const AccessFileMap &users) noexcept
+{
+	std::size_t size = sizeof(AccessFileCacheItem);
+	for (const auto &[user, crypted_password] : users)
+		size += sizeof(AccessFileMap::value_type) +
+			user.size() + crypted_password.size();
+	return size;
+}
+
+AccessFileCacheItem::AccessFileCacheItem(AccessFileCache &_parent,
+					 std::string &&_key,
+					 AccessFileMap &&_users,
+					 std::chrono::steady_clock::time_point now) noexcept
+	:AccessFileCacheItemKey(std::move(_key)),
+	 CacheItem(StringWithHash{AccessFileCacheItemKey::key},
+		   GetMemorySize(_users), now + access_file_cache_expires),
+	 InotifyWatch(_parent.inotify_manager),
+	 parent(_parent),
+	 users(std::move(_users)) {}
+
+AccessFileCacheItem::~AccessFileCacheItem() noexcept
+{
+	RemoveWatch();
+}
+
+void
+AccessFileCacheItem::OnInotify([[maybe_unused]] unsigned mask,
+			       [[maybe_unused]] const char *name) noexcept
+{
+	assert(!IsWatching()); // it's oneshot
+
+	if (!IsRemoved())
+		/* this may delete this object */
+		parent.cache.Remove(*this);
+}
+
+/**
+ * Parses an ".access" file and/or verifies a password in a worker
+ * thread.
+ */
+class AccessFileCache::Job final : public JobBase, public WorkerJob, public Cancellable {
+	WorkerPool &queue;
+
+	/**
+	 * The handler; nullptr if this job has been canceled while it
+	 * was running (and this object deletes itself in Done()).
+	 */
+	AccessCheckHandler *handler;
+
+	const std::string user;
+	std::string password;
+
+public:
+	/**
+	 * The ".access" file to be parsed; undefined if only
+	 * #crypted_password shall be verified.
+	 */
+	UniqueFileDescriptor fd;
+
+	/**
+	 * The statx() of #fd, obtained before it was read.
+	 */
+	struct statx st;
+
+	/**
+	 * The crypted password to verify #password against; if #fd
+	 * is defined, this is looked up in #users by Run().
+	 */
+	std::string crypted_password;
+
+	/**
+	 * The parsed contents of #fd.
+	 */
+	AccessFileMap users;
+
+	/**
+	 * Was #fd parsed completely, i.e. may #users be added to
+	 * the cache?
+	 */
+	bool complete = false;
+
+	bool granted = false;
+
+	Job(AccessFileCache &_cache, AccessCheckHandler &_handler,
+	    std::string_view _user, std::string_view _password) noexcept
+		:JobBase(_cache), queue(_cache.queue),
+		 handler(&_handler),
+		 user(_user), password(_password) {}
+
+	~Job() noexcept {
+		/* don't leave plain-text passwords in freed memory */
+		sodium_memzero(password.data(), password.size());
+	}
+
+	const std::string &GetUser() const noexcept {
+		return user;
+	}
+
+	const std::string &GetPassword() const noexcept {
+		return password;
+	}
+
+private:
+	void LoadFile() noexcept;
+
+	/* virtual methods from WorkerJob */
+	void Run() noexcept override;
+
+	void Done() noexcept override {
+		if (cache != nullptr)
+			cache->OnJobDone(*this);
+
+		if (handler != nullptr)
+			handler->OnAccessCheck(granted);
+
+		delete this;
+	}
+
+	/* virtual methods from class Cancellable */
+	void Cancel() noexcept override {
+		if (queue.Cancel(*this)) {
+			delete this;
+			return;
+		}
+
+		/* the job is running right now; it will delete
+		   itself in Done() */
+		handler = nullptr;
+	}
+};
+
+inline void
+AccessFileCache::Job::LoadFile() noexcept
+{
+	std::string contents;
+	contents.resize(access_file_size_limit);
+
+	std::size_t fill = 0;
+	while (fill < contents.size()) {
+		ssize_t nbytes = fd.ReadAt(fill, std::as_writable_bytes(std::span{contents}.subspan(fill)));
+		if (nbytes < 0)
+			return;
+
+		if (nbytes == 0) {
+			complete = true;
+			break;
+		}
+
+		fill += nbytes;
+	}
+
+	contents.resize(fill);
+	users = ParseAccessFile(contents);
+}
+
+void
+AccessFileCache::Job::Run() noexcept
+{
+	if (fd.IsDefined()) {
+		LoadFile();
+
+		const auto *p = FindAccessFileUser(users, user);
+		if (p == nullptr)
+			return;
+
+		crypted_password = *p;
+	}
+
+	granted = VerifyPassword(crypted_password.c_str(), password.c_str());
+}
+
+AccessFileCache::AccessFileCache(EventLoop &event_loop,
+				 WorkerPool &_queue) noexcept
+	:inotify_manager(event_loop),
+	 queue(_queue),
+	 cache(event_loop, access_file_cache_size),
+	 verified(verified_credential_max_age)
+{
+}
+
+AccessFileCache::~AccessFileCache() noexcept
+{
+	BeginShutdown();
+}
+
+void
+AccessFileCache::BeginShutdown() noexcept
+{
+	/* pending jobs will still invoke their handlers, but they
+	   will not touch this object anymore */
+	jobs.clear_and_dispose([](JobBase *job){ job->cache = nullptr; });
+
+	inotify_manager.BeginShutdown();
+
+	cache.Flush();
+}
+
+inline void
+AccessFileCache::Submit(Job &job, CancellablePointer &cancel_ptr) noexcept
+{
+	jobs.push_back(job);
+	cancel_ptr = job;
+	queue.Add(job);
+}
+
+AccessCheckResult
+AccessFileCache::CheckFile(UniqueFileDescriptor &&fd,
+			   std::string_view user, std::string_view password,
+			   AccessCheckHandler &handler,
+			   CancellablePointer &cancel_ptr) noexcept
+{
+	struct statx st;
+	if (statx(fd.Get(), "", AT_EMPTY_PATH,
+		  STATX_NLINK|STATX_INO|STATX_MTIME|STATX_SIZE, &st) < 0)
+		return AccessCheckResult::DENIED;
+
+	if (const auto *item = static_cast<const Item *>(cache.Get(StringWithHash{MakeKey(st)}))) {
+		const auto *crypted_password = FindAccessFileUser(item->users, user);
+		if (crypted_password == nullptr)
+			return AccessCheckResult::DENIED;
+
+		return CheckPassword(*crypted_password, user, password,
+				     handler, cancel_ptr);
+	}
+
+	/* cache miss: read and parse the file in a worker thread */
+
+	auto *job = new Job(*this, handler, user, password);
+	job->fd = std::move(fd);
+	job->st = st;
+	Submit(*job, cancel_ptr);
+	return AccessCheckResult::PENDING;
+}
+
+AccessCheckResult
+AccessFileCache::CheckPassword(std::string_view crypted_password,
+			       std::string_view user,
+			       std::string_view password,
+			       AccessCheckHandler &handler,
+			       CancellablePointer &cancel_ptr) noexcept
+{
+	const auto digest = verified.MakeDigest(user, password,
+						crypted_password);
+	if (verified.Contains(digest, cache.SteadyNow()))
+		return AccessCheckResult::GRANTED;
+
+	/* cache miss: crypt() may be expensive, so verify the
+	   password in a worker thread */
+
+	auto *job = new Job(*this, handler, user, password);
+	job->crypted_password = crypted_password;
+	Submit(*job, cancel_ptr);
+	return AccessCheckResult::PENDING;
+}
+
+/**
+ * Check whether the file referred to by the descriptor still matches
+ * the given statx() which was obtained before reading it.
+ */
+static bool
+IsUnmodified(FileDescriptor fd, const struct statx &st) noexcept
+{
+	struct statx now;
+	if (statx(fd.Get(), "", AT_EMPTY_PATH,
+		  STATX_NLINK|STATX_MTIME|STATX_SIZE, &now) < 0)
+		return false;
+
+	return now.stx_nlink > 0 &&
+		now.stx_size == st.stx_size &&
+		now.stx_mtime.tv_sec == st.stx_mtime.tv_sec &&
+		now.stx_mtime.tv_nsec == st.stx_mtime.tv_nsec;
+}
+
+inline void
+AccessFileCache::AddFile(FileDescriptor fd, const struct statx &st,
+			 AccessFileMap &&users) noexcept
+{
+	auto item = std::make_unique<Item>(*this, MakeKey(st),
+					   std::move(users),
+					   cache.SteadyNow());
+
+	/* IN_ATTRIB catches unlink() and rename() over the file
+	   because they modify the link count; IN_MASK_CREATE fails if
+	   this inode is already being watched (i.e. it has been added
+	   to the cache by a concurrent job) */
+	if (!item->TryAddWatch(ProcFdPath(fd),
+			       IN_ONESHOT|IN_MASK_CREATE|
+			       IN_MODIFY|IN_ATTRIB|IN_DELETE_SELF|IN_MOVE_SELF))
+		return;
+
+	/* the file may have been modified after the worker thread
+	   has read it, but before the watch was registered */
+	if (!IsUnmodified(fd, st)) {
+		LogConcat(4, "AccessFileCache", "nocache stale");
+		return;
+	}
+
+	cache.Put(*item.release());
+}
+
+inline void
+AccessFileCache::OnJobDone(Job &job) noexcept
+{
+	if (job.fd.IsDefined() && job.complete)
+		AddFile(job.fd, job.st, std::move(job.users));
+
+	if (job.granted)
+		verified.Add(verified.MakeDigest(job.GetUser(),
+						 job.GetPassword(),
+						 job.crypted_password),
+			     cache.SteadyNow());
+}
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "AccessFile.hxx"
+#include "CredentialCache.hxx"
+#include "cache/Cache.hxx"
+#include "cache/Item.hxx"
+#include "event/InotifyManager.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h> // for struct statx
+
+class FileDescriptor;
+class UniqueFileDescriptor;
+class WorkerPool;
+class CancellablePointer;
+class AccessFileCache;
+
+enum class AccessCheckResult {
+	GRANTED,
+	DENIED,
+
+	/**
+	 * The check will be finished asynchronously;
+	 * AccessCheckHandler::OnAccessCheck() will be called.
+	 */
+	PENDING,
+};
+
+class AccessCheckHandler {
+public:
+	virtual void OnAccessCheck(bool granted) noexcept = 0;
+};
+
+class AccessFileCacheItemKey {
+protected:
+	const std::string key;
+
+public:
+	[[nodiscard]]
+	explicit AccessFileCacheItemKey(std::string &&_key) noexcept
+		:key(std::move(_key)) {}
+};
+
+/**
+ * A parsed ".access" file in the #AccessFileCache.
+ */
+class AccessFileCacheItem final : AccessFileCacheItemKey, public CacheItem, public InotifyWatch {
+	friend class AccessFileCache;
+
+	AccessFileCache &parent;
+
+	const AccessFileMap users;
+
+public:
+	AccessFileCacheItem(AccessFileCache &_parent, std::string &&_key,
+			    AccessFileMap &&_users,
+			    std::chrono::steady_clock::time_point now) noexcept;
+
+	~AccessFileCacheItem() noexcept;
+
+private:
+	/* virtual methods from class CacheItem */
+	bool Validate() const noexcept override {
+		/* the inotify watch is oneshot; if it has fired,
+		   this item is stale */
+		return IsWatching();
+	}
+
+	void Destroy() noexcept override {
+		delete this;
+	}
+
+	/* virtual methods from class InotifyWatch */
+	void OnInotify(unsigned mask, const char *name) noexcept override;
+};
+
+/**
+ * Checks HTTP Basic credentials for the mod_auth_easy emulation
+ * without blocking the main thread.
+ *
+ * Parsed ".access" files are cached by their identity (device and
+ * inode number), and each cached file is watched with inotify so it
+ * gets evicted as soon as it is modified or replaced.  Passwords
+ * which were verified successfully are remembered in a
+ * #VerifiedCredentialCache.
+ *
+ * On a cache miss, reading the file and calling crypt() happen in a
+ * worker thread.
+ */
+class AccessFileCache final {
+	InotifyManager inotify_manager;
+
+	WorkerPool &queue;
+
+	Cache cache;
+
+	VerifiedCredentialCache verified;
+
+	/**
+	 * The part of #Job which is needed to manage the #jobs list.
+	 */
+	struct JobBase : AutoUnlinkIntrusiveListHook {
+		/**
+		 * The owner; nullptr if it has been shut down while
+		 * the job was pending.
+		 */
+		AccessFileCache *cache;
+
+		explicit JobBase(AccessFileCache &_cache) noexcept
+			:cache(&_cache) {}
+	};
+
+	class Job;
+
+	/**
+	 * Jobs which have been submitted to the #WorkerPool.  We
+	 * keep track of them so we can detach them on shutdown.
+	 */
+	IntrusiveList<JobBase> jobs;
+
+	friend class AccessFileCacheItem;
+
+public:
+	using Item = AccessFileCacheItem;
+
+	AccessFileCache(EventLoop &event_loop, WorkerPool &_queue) noexcept;
+	~AccessFileCache() noexcept;
+
+	AccessFileCache(const AccessFileCache &) = delete;
+	AccessFileCache &operator=(const AccessFileCache &) = delete;
+
+	void Flush() noexcept {
+		cache.Flush();
+		verified.Clear();
+	}
+
+	/**
+	 * Initiate shutdown.  This detaches all pending jobs and
+	 * unregisters all #EventLoop events.
+	 */
+	void BeginShutdown() noexcept;
+
+	/**
+	 * Check the credentials against an ".access" file.
+	 *
+	 * @param fd the opened ".access" file
+	 * @param handler on #AccessCheckResult::PENDING, this handler
+	 * will be invoked later
+	 */
+	AccessCheckResult CheckFile(UniqueFileDescriptor &&fd,
+				    std::string_view user,
+				    std::string_view password,
+				    AccessCheckHandler &handler,
+				    CancellablePointer &cancel_ptr) noexcept;
+
+	/**
+	 * Check a password against the given crypted password.
+	 *
+	 * @param handler on #AccessCheckResult::PENDING, this handler
+	 * will be invoked later
+	 */
+	AccessCheckResult CheckPassword(std::string_view crypted_password,
+					std::string_view user,
+					std::string_view password,
+					AccessCheckHandler &handler,
+					CancellablePointer &cancel_ptr) noexcept;
+
+private:
+	void Submit(Job &job, CancellablePointer &cancel_ptr) noexcept;
+	void OnJobDone(Job &job) noexcept;
+	void AddFile(FileDescriptor fd, const struct statx &st,
+		     AccessFileMap &&users) noexcept;
+};
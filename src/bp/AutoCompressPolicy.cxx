@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "AutoCompressPolicy.hxx"
+#include "istream/BrotliEncoderIstream.hxx"
+#include "istream/GzipIstream.hxx"
+#include "thread/WorkerJob.hxx"
+#include "thread/WorkerPool.hxx"
+#include "event/Loop.hxx"
+
+#include <algorithm> // for std::max()
+#include <cassert>
+#include <cstdlib> // for std::strtof()
+#include <span>
+#include <string_view>
+
+using std::string_view_literals::operator""sv;
+
+static constexpr Event::Duration SAMPLE_INTERVAL = std::chrono::seconds{1};
+
+/**
+ * If jobs wait longer than this for a worker thread, the pool is
+ * considered saturated and responses are sent uncompressed.
+ */
+static constexpr std::chrono::steady_clock::duration SATURATED_QUEUE_LATENCY =
+	std::chrono::milliseconds{100};
+
+/**
+ * Above this queue latency, only the fastest compression level is
+ * used.
+ */
+static constexpr std::chrono::steady_clock::duration HIGH_QUEUE_LATENCY =
+	std::chrono::milliseconds{20};
+
+/**
+ * Below this queue latency, the pool is considered idle.
+ */
+static constexpr std::chrono::steady_clock::duration LOW_QUEUE_LATENCY =
+	std::chrono::milliseconds{2};
+
+/**
+ * CPU pressure thresholds ("some avg10" in percent).
+ */
+static constexpr float HIGH_CPU_PRESSURE = 40;
+static constexpr float LOW_CPU_PRESSURE = 10;
+
+/**
+ * Bodies up to this size may be compressed with the best level if
+ * the machine is idle.
+ */
+static constexpr int_least64_t SMALL_BODY = 64 * 1024;
+
+/**
+ * Bodies larger than this (or with unknown length) are compressed
+ * with one level less than usual if there is any load.
+ */
+static constexpr int_least64_t LARGE_BODY = 1024 * 1024;
+
+/**
+ * A no-op job which measures how long it waited in the
+ * #WorkerPool before a worker thread picked it up.
+ */
+struct AutoCompressPolicy::Probe final : WorkerJob {
+	/**
+	 * The owner; nullptr if the owner has been destroyed while
+	 * this job was running (and this object deletes itself in
+	 * Done()).
+	 */
+	AutoCompressPolicy *parent;
+
+	std::chrono::steady_clock::time_point submit_time, run_time;
+
+	explicit Probe(AutoCompressPolicy &_parent) noexcept
+		:parent(&_parent) {}
+
+	void Submit(WorkerPool &queue) noexcept {
+		submit_time = std::chrono::steady_clock::now();
+		queue.Add(*this);
+	}
+
+	[[gnu::pure]]
+	std::chrono::steady_clock::duration GetWaiting() const noexcept {
+		return IsIdle()
+			? std::chrono::steady_clock::duration{}
+			: std::chrono::steady_clock::now() - submit_time;
+	}
+
+	// virtual methods from WorkerJob
+	void Run() noexcept override {
+		run_time = std::chrono::steady_clock::now();
+	}
+
+	void Done() noexcept override {
+		if (parent == nullptr) {
+			delete this;
+			return;
+		}
+
+		parent->OnProbeDone(run_time - submit_time);
+	}
+};
+
+AutoCompressPolicy::AutoCompressPolicy(WorkerPool &_queue) noexcept
+	:queue(_queue),
+	 sample_timer(queue.GetEventLoop(), BIND_THIS_METHOD(OnSampleTimer)),
+	 probe(std::make_unique<Probe>(*this))
+{
+	/* failure is not fatal: without PSI, we rely on the queue
+	   latency alone */
+	(void)cpu_pressure_fd.OpenReadOnly("/proc/pressure/cpu");
+
+	sample_timer.Schedule(SAMPLE_INTERVAL);
+}
+
+AutoCompressPolicy::~AutoCompressPolicy() noexcept
+{
+	if (!probe->IsIdle() && !queue.Cancel(*probe))
+		/* the probe is running right now; it will delete
+		   itself in Done() */
+		probe.release()->parent = nullptr;
+}
+
+inline std::chrono::steady_clock::duration
+AutoCompressPolicy::GetQueueLatency() const noexcept
+{
+	return std::max(stats.queue_latency, probe->GetWaiting());
+}
+
+inline void
+AutoCompressPolicy::ReadCpuPressure() noexcept
+{
+	if (!cpu_pressure_fd.IsDefined())
+		return;
+
+	/* the first line looks like this:
+	   "some avg10=1.23 avg60=0.45 avg300=0.12 total=123456" */
+	char buffer[256];
+	ssize_t nbytes = cpu_pressure_fd.ReadAt(0, std::as_writable_bytes(std::span{buffer, sizeof(buffer) - 1}));
+	if (nbytes <= 0) {
+		cpu_pressure_fd.Close();
+		return;
+	}
+
+	buffer[nbytes] = 0;
+
+	const std::string_view s{buffer, static_cast<std::size_t>(nbytes)};
+	const auto i = s.find("avg10="sv);
+	if (i == s.npos)
+		return;
+
+	stats.cpu_pressure = std::strtof(buffer + i + 6, nullptr);
+}
+
+inline void
+AutoCompressPolicy::OnProbeDone(std::chrono::steady_clock::duration latency) noexcept
+{
+	stats.queue_latency = latency;
+}
+
+void
+AutoCompressPolicy::OnSampleTimer() noexcept
+{
+	ReadCpuPressure();
+
+	/* if the previous probe is still waiting, don't submit
+	   another one; GetQueueLatency() accounts for the time it
+	   has been waiting */
+	if (probe->IsIdle())
+		probe->Submit(queue);
+
+	sample_timer.Schedule(SAMPLE_INTERVAL);
+}
+
+AutoCompressLevel
+AutoCompressPolicy::ChooseLevel(std::chrono::steady_clock::duration latency,
+				float cpu_pressure,
+				int_least64_t length) noexcept
+{
+	if (latency >= SATURATED_QUEUE_LATENCY)
+		return AutoCompressLevel::NONE;
+
+	if (latency >= HIGH_QUEUE_LATENCY ||
+	    cpu_pressure >= HIGH_CPU_PRESSURE)
+		return AutoCompressLevel::FAST;
+
+	if (latency < LOW_QUEUE_LATENCY &&
+	    cpu_pressure < LOW_CPU_PRESSURE)
+		/* idle: small bodies are cheap enough to be
+		   compressed with the best level */
+		return length >= 0 && length <= SMALL_BODY
+			? AutoCompressLevel::BEST
+			: AutoCompressLevel::MEDIUM;
+
+	/* moderate load: large bodies occupy a worker thread for a
+	   long time, so use less effort */
+	return length < 0 || length > LARGE_BODY
+		? AutoCompressLevel::FAST
+		: AutoCompressLevel::MEDIUM;
+}
+
+AutoCompressLevel
+AutoCompressPolicy::Choose(int_least64_t length) noexcept
+{
+	const auto level = ChooseLevel(GetQueueLatency(), stats.cpu_pressure,
+				       length);
+	++stats.n_by_level[static_cast<std::size_t>(level)];
+	return level;
+}
+
+BrotliEncoderParams
+AutoCompressPolicy::ToBrotliParams(AutoCompressLevel level,
+				   bool text_mode) noexcept
+{
+	BrotliEncoderParams params{.text_mode = text_mode};
+
+	switch (level) {
+	case AutoCompressLevel::NONE:
+		assert(false);
+		break;
+
+	case AutoCompressLevel::FAST:
+		params.quality = 1;
+		break;
+
+	case AutoCompressLevel::MEDIUM:
+		break;
+
+	case AutoCompressLevel::BEST:
+		/* not the maximum (11) which is much too slow for
+		   on-the-fly compression */
+		params.quality = 9;
+		break;
+	}
+
+	return params;
+}
+
+GzipParams
+AutoCompressPolicy::ToGzipParams(AutoCompressLevel level) noexcept
+{
+	GzipParams params;
+
+	switch (level) {
+	case AutoCompressLevel::NONE:
+		assert(false);
+		break;
+
+	case AutoCompressLevel::FAST:
+		params.level = 1;
+		break;
+
+	case AutoCompressLevel::MEDIUM:
+		break;
+
+	case AutoCompressLevel::BEST:
+		params.level = 9;
+		break;
+	}
+
+	return params;
+}
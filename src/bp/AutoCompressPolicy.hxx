@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "stats/AutoCompressStats.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+class WorkerPool;
+struct BrotliEncoderParams;
+struct GzipParams;
+
+/**
+ * Chooses the compression level for auto-compressed responses
+ * (TranslateResponse::auto_gzip, auto_brotli) depending on the
+ * current load and on the size of the response body.
+ *
+ * The load is sampled periodically: a tiny probe job is submitted
+ * to the #WorkerPool to measure how long jobs wait for a worker
+ * thread, and the kernel's CPU pressure stall information is read
+ * from /proc/pressure/cpu.  This way, the request path does not
+ * need to do any additional work.
+ */
+class AutoCompressPolicy {
+	WorkerPool &queue;
+
+	/**
+	 * Samples the load periodically.
+	 */
+	CoarseTimerEvent sample_timer;
+
+	/**
+	 * /proc/pressure/cpu; may be undefined if the kernel does not
+	 * support PSI.
+	 */
+	UniqueFileDescriptor cpu_pressure_fd;
+
+	struct Probe;
+	std::unique_ptr<Probe> probe;
+
+	AutoCompressStats stats;
+
+public:
+	explicit AutoCompressPolicy(WorkerPool &_queue) noexcept;
+	~AutoCompressPolicy() noexcept;
+
+	AutoCompressPolicy(const AutoCompressPolicy &) = delete;
+	AutoCompressPolicy &operator=(const AutoCompressPolicy &) = delete;
+
+	const auto &GetStats() const noexcept {
+		return stats;
+	}
+
+	/**
+	 * Choose a compression level for a response body and count
+	 * it in the #AutoCompressStats.
+	 *
+	 * @param length the length of the response body or -1 if
+	 * unknown
+	 */
+	AutoCompressLevel Choose(int_least64_t length) noexcept;
+
+	/**
+	 * The decision made by Choose() for the given load
+	 * figures (without updating the statistics).
+	 *
+	 * @param queue_latency the thread pool queue latency
+	 * @param cpu_pressure the CPU pressure in percent
+	 * @param length the length of the response body or -1 if
+	 * unknown
+	 */
+	[[gnu::const]]
+	static AutoCompressLevel ChooseLevel(std::chrono::steady_clock::duration queue_latency,
+					     float cpu_pressure,
+					     int_least64_t length) noexcept;
+
+	[[gnu::const]]
+	static BrotliEncoderParams ToBrotliParams(AutoCompressLevel level,
+						  bool text_mode) noexcept;
+
+	[[gnu::const]]
+	static GzipParams ToGzipParams(AutoCompressLevel level) noexcept;
+
+private:
+	/**
+	 * Returns the current queue latency; if the probe job has
+	 * been waiting for longer than the last measurement, that
+	 * duration is returned.
+	 */
+	[[gnu::pure]]
+	std::chrono::steady_clock::duration GetQueueLatency() const noexcept;
+
+	void ReadCpuPressure() noexcept;
+	void OnProbeDone(std::chrono::steady_clock::duration latency) noexcept;
+	void OnSampleTimer() noexcept;
+};
@@ -18,6 +18,10 @@
 #include <string.h>
 #include <sysexits.h> // for EX_*
 
+#ifndef NDEBUG
+bool debug_mode = false;
+#endif
+
 static void
 PrintUsage()
 {
@@ -9,6 +9,8 @@
 #include "time/Parser.hxx"
 #include "util/StringCompare.hxx"
 #include "util/StringParser.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringStrip.hxx"
 
 #include <stdexcept>
 
@@ -27,6 +29,17 @@ HandleSetStockOption(StockOptions &options, std::string_view name, const char *v
 		throw std::invalid_argument{"Unknown variable"};
 }
 
+static CacheAdmission
+ParseCacheAdmission(std::string_view s)
+{
+	if (s == "lru"sv)
+		return CacheAdmission::LRU;
+	else if (s == "tinylfu"sv)
+		return CacheAdmission::TINY_LFU;
+	else
+		throw std::invalid_argument{"Invalid cache admission policy"};
+}
+
 void
 BpConfig::HandleSet(std::string_view name, const char *value)
 {
@@ -50,14 +63,53 @@ BpConfig::HandleSet(std::string_view name, const char *value)
 		http_cache_size = ParseSize(value);
 	} else if (name == "http_cache_obey_no_cache"sv) {
 		http_cache_obey_no_cache = ParseBool(value);
+	} else if (name == "http_cache_admission"sv) {
+		http_cache_admission = ParseCacheAdmission(value);
+	} else if (name == "http_cache_key_drop_query_params"sv) {
+		for (std::string_view i : IterableSplitString(value, ',')) {
+			i = Strip(i);
+			if (!i.empty())
+				http_cache_key_rules.drop_query_params.emplace_back(i);
+		}
+	} else if (name == "http_cache_key_sort_query"sv) {
+		http_cache_key_rules.sort_query = ParseBool(value);
+	} else if (name == "http_cache_key_lowercase_host"sv) {
+		http_cache_key_rules.lowercase_host = ParseBool(value);
+	} else if (name == "http_cache_key_normalize_uri"sv) {
+		http_cache_key_rules.normalize_uri = ParseBool(value);
+	} else if (name == "http_cache_disk_path"sv) {
+		if (*value != '/')
+			throw std::runtime_error("Absolute path expected");
+
+		http_cache_disk.path = value;
+	} else if (name == "http_cache_disk_size"sv) {
+		http_cache_disk.max_size = ParseSize(value);
+	} else if (name == "http_cache_disk_max_object_size"sv) {
+		http_cache_disk.max_object_size = ParseSize(value);
+	} else if (name == "http_cache_disk_promote_hits"sv) {
+		http_cache_disk.promote_hits = ParseUnsignedLong(value);
 	} else if (name == "filter_cache_size"sv) {
 		filter_cache_size = ParseSize(value);
+	} else if (name == "filter_cache_admission"sv) {
+		filter_cache_admission = ParseCacheAdmission(value);
 	} else if (name == "encoding_cache_size"sv) {
 		encoding_cache_size = ParseSize(value);
+	} else if (name == "encoding_cache_recompress"sv) {
+		encoding_cache_recompress = ParseBool(value);
+	} else if (name == "static_file_cache_size"sv) {
+		static_file_cache_size = ParseSize(value);
+	} else if (name == "widget_fragment_cache_size"sv) {
+		widget_fragment_cache_size = ParseSize(value);
+	} else if (name == "early_hints_cache_size"sv) {
+		early_hints_cache_size = ParseSize(value);
+	} else if (name == "adaptive_auto_compress"sv) {
+		adaptive_auto_compress = ParseBool(value);
 	} else if (name == "nfs_cache_size"sv) {
 		/* deprecated */
 	} else if (name == "translate_cache_size"sv) {
 		translate_cache_size = ParseUnsignedLong(value);
+	} else if (name == "translate_cache_admission"sv) {
+		translate_cache_admission = ParseCacheAdmission(value);
 	} else if (name == "translate_stock_limit"sv) {
 		translate_stock_limit = ParseUnsignedLong(value);
 	} else if (name == "stopwatch"sv) {
@@ -76,6 +128,13 @@ BpConfig::HandleSet(std::string_view name, const char *value)
 		io_uring_sqpoll = ParseBool(value);
 	} else if (name == "io_uring_sq_thread_cpu"sv) {
 		io_uring_sq_thread_cpu = ParseUnsignedLong(value);
+	} else if (name == "pool_profiler"sv) {
+		if (StringIsEqual(value, "adaptive"))
+			pool_profiler = PoolProfilerMode::ADAPTIVE;
+		else
+			pool_profiler = ParseBool(value)
+				? PoolProfilerMode::PROFILE
+				: PoolProfilerMode::DISABLED;
 	} else if (name == "populate_translate_cache"sv) {
 		populate_translate_cache = ParseBool(value);
 	} else if (name == "populate_http_cache"sv) {
@@ -99,6 +158,21 @@ BpConfig::HandleSet(std::string_view name, const char *value)
 		session_idle_timeout = Pg::ParseIntervalS(value);
 	} else if (name == "session_save_path"sv) {
 		session_save_path = value;
+	} else if (name == "session_store_path"sv) {
+		session_store_path = value;
+	} else if (name == "session_store_size"sv) {
+		session_store_size = ParseSize(value);
+	} else if (name == "trace_path"sv) {
+		if (*value != '/')
+			throw std::runtime_error("Absolute path expected");
+
+		trace_path = value;
+	} else if (name == "trace_sample_rate"sv) {
+		trace_sample_rate = ParseUnsignedLong(value);
+		if (trace_sample_rate == 0)
+			throw std::runtime_error("Must be positive");
+	} else if (name == "trace_traceparent"sv) {
+		trace_traceparent = ParseBool(value);
 	} else
 		throw std::runtime_error("Unknown variable");
 }
@@ -6,12 +6,16 @@
 
 #include "LConfig.hxx"
 #include "access_log/Config.hxx"
+#include "cache/Admission.hxx"
+#include "http/cache/DiskConfig.hxx"
+#include "http/cache/KeyRules.hxx"
 #include "ssl/Config.hxx"
 #include "http/CookieSameSite.hxx"
 #include "net/LocalSocketAddress.hxx"
 #include "net/SocketConfig.hxx"
 #include "spawn/Config.hxx"
 #include "stock/Options.hxx"
+#include "pool/Profiler.hxx"
 #include "config.h"
 
 #include <chrono>
@@ -37,6 +41,32 @@ struct BpConfig {
 
 	std::string session_save_path;
 
+	/**
+	 * The path of the #SharedSessionStore file; empty means
+	 * sessions are not shared with other processes.
+	 */
+	std::string session_store_path;
+
+	std::size_t session_store_size = 64 * 1024 * 1024;
+
+	/**
+	 * Sampled request traces are written to this file or local
+	 * socket (OTLP/JSON, see #TraceExporter); empty means tracing
+	 * is disabled.
+	 */
+	std::string trace_path;
+
+	/**
+	 * Trace one in this many requests.
+	 */
+	unsigned trace_sample_rate = 1000;
+
+	/**
+	 * Always trace requests whose "traceparent" header has the
+	 * "sampled" flag?
+	 */
+	bool trace_traceparent = false;
+
 	struct ControlListener : SocketConfig {
 		ControlListener()
 			:SocketConfig{
@@ -56,6 +86,30 @@ struct BpConfig {
 
 	std::forward_list<ControlListener> control_listen;
 
+	struct RateLimitGossip : SocketConfig {
+		/**
+		 * Unicast addresses of other nodes which receive our
+		 * datagrams (in addition to the #multicast_group).
+		 */
+		std::forward_list<AllocatedSocketAddress> peers;
+
+		/**
+		 * A secret shared by all nodes which is used to
+		 * authenticate datagrams.
+		 */
+		std::string secret;
+
+		bool IsEnabled() const noexcept {
+			return !bind_address.IsNull();
+		}
+	};
+
+	/**
+	 * Exchange per-site rate limiter consumption with other
+	 * nodes (see #BpPerSiteGossip)?
+	 */
+	RateLimitGossip rate_limit_gossip;
+
 	std::forward_list<LocalSocketAddress> translation_sockets;
 
 	/** maximum number of simultaneous connections */
@@ -65,8 +119,39 @@ struct BpConfig {
 
 	size_t filter_cache_size = 128 * 1024 * 1024;
 
+	CacheAdmission http_cache_admission = CacheAdmission::LRU;
+
+	HttpCacheKeyRules http_cache_key_rules;
+
+	HttpCacheDiskConfig http_cache_disk;
+
+	CacheAdmission filter_cache_admission = CacheAdmission::LRU;
+	CacheAdmission translate_cache_admission = CacheAdmission::LRU;
+
 	std::size_t encoding_cache_size = 0;
 
+	/**
+	 * Recompress frequently hit #EncodingCache items with the
+	 * maximum quality in the background?
+	 */
+	bool encoding_cache_recompress = false;
+
+	/**
+	 * The size of the #StaticFileCache; 0 disables it.
+	 */
+	std::size_t static_file_cache_size = 0;
+
+	/**
+	 * The size of the #WidgetFragmentCache; 0 disables it.
+	 */
+	std::size_t widget_fragment_cache_size = 0;
+
+	/**
+	 * The size of the #EarlyHintsCache; 0 disables "103 Early
+	 * Hints".
+	 */
+	std::size_t early_hints_cache_size = 0;
+
 	unsigned translate_cache_size = 131072;
 	unsigned translate_stock_limit = 32;
 
@@ -123,6 +208,18 @@ struct BpConfig {
 
 	bool io_uring_sqpoll = false;
 
+	/**
+	 * Choose the auto-compression level depending on the
+	 * current load (see #AutoCompressPolicy)?
+	 */
+	bool adaptive_auto_compress = false;
+
+	/**
+	 * Collect per-name statistics about memory pools, and
+	 * optionally use them to choose initial pool area sizes.
+	 */
+	PoolProfilerMode pool_profiler = PoolProfilerMode::DISABLED;
+
 	bool populate_translate_cache = false;
 	bool populate_http_cache = false, populate_filter_cache = false, populate_encoding_cache = false;
 
@@ -3,6 +3,7 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "Config.hxx"
+#include "GossipProtocol.hxx"
 #include "access_log/ConfigParser.hxx"
 #include "spawn/ConfigParser.hxx"
 #include "io/config/FileLineParser.hxx"
@@ -48,6 +49,20 @@ class BpConfigParser final : public NestedConfigParser {
 		void Finish() override;
 	};
 
+	class RateLimitGossip final : public ConfigParser {
+		BpConfigParser &parent;
+		BpConfig::RateLimitGossip config;
+
+	public:
+		explicit RateLimitGossip(BpConfigParser &_parent)
+			:parent(_parent) {}
+
+	protected:
+		/* virtual methods from class ConfigParser */
+		void ParseLine(FileLineParser &line) override;
+		void Finish() override;
+	};
+
 public:
 	explicit BpConfigParser(BpConfig &_config)
 		:config(_config) {}
@@ -60,6 +75,7 @@ protected:
 private:
 	void CreateListener(FileLineParser &line);
 	void CreateControl(FileLineParser &line);
+	void CreateRateLimitGossip(FileLineParser &line);
 };
 
 class SslClientConfigParser : public ConfigParser {
@@ -288,6 +304,57 @@ BpConfigParser::CreateControl(FileLineParser &line)
 	SetChild(std::make_unique<Control>(*this));
 }
 
+void
+BpConfigParser::RateLimitGossip::ParseLine(FileLineParser &line)
+{
+	const char *word = line.ExpectWord();
+
+	if (StringIsEqual(word, "bind")) {
+		config.bind_address = ParseSocketAddress(line.ExpectValueAndEnd(),
+							 BP_GOSSIP_DEFAULT_PORT, true);
+	} else if (StringIsEqual(word, "multicast_group")) {
+		config.multicast_group = ParseSocketAddress(line.ExpectValueAndEnd(),
+							    0, false);
+	} else if (StringIsEqual(word, "peer")) {
+		config.peers.emplace_front(ParseSocketAddress(line.ExpectValueAndEnd(),
+							      BP_GOSSIP_DEFAULT_PORT,
+							      false));
+	} else if (StringIsEqual(word, "interface")) {
+		config.interface = line.ExpectValueAndEnd();
+	} else if (StringIsEqual(word, "secret")) {
+		config.secret = line.ExpectValueAndEnd();
+		if (config.secret.empty())
+			throw LineParser::Error("Empty secret");
+	} else
+		throw LineParser::Error("Unknown option");
+}
+
+void
+BpConfigParser::RateLimitGossip::Finish()
+{
+	if (config.bind_address.IsNull())
+		throw LineParser::Error("Bind address is missing");
+
+	if (config.secret.empty())
+		throw LineParser::Error("Secret is missing");
+
+	if (config.multicast_group.IsNull() && config.peers.empty())
+		throw LineParser::Error("Neither multicast_group nor peer specified");
+
+	config.Fixup();
+
+	parent.config.rate_limit_gossip = std::move(config);
+
+	ConfigParser::Finish();
+}
+
+inline void
+BpConfigParser::CreateRateLimitGossip(FileLineParser &line)
+{
+	line.ExpectSymbolAndEol('{');
+	SetChild(std::make_unique<RateLimitGossip>(*this));
+}
+
 void
 BpConfigParser::ParseLine2(FileLineParser &line)
 {
@@ -297,6 +364,8 @@ BpConfigParser::ParseLine2(FileLineParser &line)
 		CreateListener(line);
 	else if (StringIsEqual(word, "control"))
 		CreateControl(line);
+	else if (StringIsEqual(word, "rate_limit_gossip"))
+		CreateRateLimitGossip(line);
 	else if (StringIsEqual(word, "access_logger")) {
 		if (line.SkipSymbol('{')) {
 			line.ExpectEnd();
@@ -15,6 +15,7 @@
 #include "was/Stock.hxx"
 #include "was/MStock.hxx"
 #include "widget/View.hxx"
+#include "widget/FragmentCache.hxx"
 #include "event/net/control/Server.hxx"
 #include "translation/Builder.hxx"
 #include "translation/Protocol.hxx"
@@ -23,6 +24,7 @@
 #include "translation/Transformation.hxx"
 #include "pool/tpool.hxx"
 #include "pool/pool.hxx"
+#include "pool/Profiler.hxx"
 #include "net/SocketAddress.hxx"
 #include "io/Logger.hxx"
 #include "util/djb_hash.hxx"
@@ -290,6 +292,9 @@ BpInstance::OnControlPacket(BengControl::Command command,
 		break;
 
 	case Command::DUMP_POOLS:
+		pool_profiler_dump();
+		break;
+
 	case Command::NODE_STATUS:
 	case Command::FLUSH_NFS_CACHE:
 	case Command::STATS:
@@ -306,6 +311,14 @@ BpInstance::OnControlPacket(BengControl::Command command,
 								   payload.size()));
 		}
 
+		/* widget fragments are processed filter output, too */
+		if (widget_fragment_cache) {
+			if (payload.empty())
+				widget_fragment_cache->Flush();
+			else
+				widget_fragment_cache->FlushTag(ToStringView(payload));
+		}
+
 		break;
 
 	case Command::STOPWATCH_PIPE:
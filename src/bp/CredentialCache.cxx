@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "CredentialCache.hxx"
+
+#include <sodium/crypto_generichash.h>
+#include <sodium/randombytes.h>
+#include <sodium/utils.h>
+
+#include <cstdint>
+#include <cstring>
+
+static_assert(sizeof(VerifiedCredentialCache::Digest) >= crypto_generichash_BYTES_MIN);
+
+VerifiedCredentialCache::VerifiedCredentialCache(std::chrono::steady_clock::duration _max_age) noexcept
+	:max_age(_max_age)
+{
+	static_assert(std::tuple_size_v<decltype(key)> >= crypto_generichash_KEYBYTES_MIN);
+	static_assert(std::tuple_size_v<decltype(key)> <= crypto_generichash_KEYBYTES_MAX);
+
+	randombytes_buf(key.data(), key.size());
+}
+
+/**
+ * Feed a string into the hash, prefixed with its length, so the
+ * boundaries between the fields are unambiguous.
+ */
+static void
+UpdateField(crypto_generichash_state &state, std::string_view s) noexcept
+{
+	const uint32_t length = s.size();
+	crypto_generichash_update(&state,
+				  reinterpret_cast<const unsigned char *>(&length),
+				  sizeof(length));
+	crypto_generichash_update(&state,
+				  reinterpret_cast<const unsigned char *>(s.data()),
+				  s.size());
+}
+
+VerifiedCredentialCache::Digest
+VerifiedCredentialCache::MakeDigest(std::string_view user,
+				    std::string_view password,
+				    std::string_view crypted_password) const noexcept
+{
+	crypto_generichash_state state;
+	crypto_generichash_init(&state,
+				reinterpret_cast<const unsigned char *>(key.data()),
+				key.size(), sizeof(Digest));
+	UpdateField(state, user);
+	UpdateField(state, password);
+	UpdateField(state, crypted_password);
+
+	Digest digest;
+	crypto_generichash_final(&state,
+				 reinterpret_cast<unsigned char *>(digest.data()),
+				 digest.size());
+	sodium_memzero(&state, sizeof(state));
+	return digest;
+}
+
+inline std::size_t
+VerifiedCredentialCache::GetIndex(const Digest &digest) noexcept
+{
+	std::size_t i;
+	std::memcpy(&i, digest.data(), sizeof(i));
+	return i % N_ENTRIES;
+}
+
+bool
+VerifiedCredentialCache::Contains(const Digest &digest,
+				  std::chrono::steady_clock::time_point now) const noexcept
+{
+	const auto &entry = entries[GetIndex(digest)];
+	return entry.expires > now &&
+		sodium_memcmp(entry.digest.data(), digest.data(),
+			      digest.size()) == 0;
+}
+
+void
+VerifiedCredentialCache::Add(const Digest &digest,
+			     std::chrono::steady_clock::time_point now) noexcept
+{
+	auto &entry = entries[GetIndex(digest)];
+	entry.digest = digest;
+	entry.expires = now + max_age;
+}
+
+void
+VerifiedCredentialCache::Clear() noexcept
+{
+	entries = {};
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+
+/**
+ * A small cache for passwords which have been verified successfully
+ * against a crypted password, to avoid calling crypt() again for
+ * each request.
+ *
+ * Neither the plain-text password nor the crypted password is stored
+ * here; each entry contains only a keyed hash (BLAKE2b with a random
+ * per-process key) of the user name, the password and the crypted
+ * password.  Since the crypted password is part of the hash, an entry
+ * becomes useless as soon as the user's line in the password file
+ * changes.
+ *
+ * This is a direct-mapped table of fixed size; a collision evicts the
+ * previous entry.
+ */
+class VerifiedCredentialCache {
+	static constexpr std::size_t N_ENTRIES = 1024;
+
+public:
+	using Digest = std::array<std::byte, 16>;
+
+private:
+	struct Entry {
+		Digest digest;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+	const std::chrono::steady_clock::duration max_age;
+
+	std::array<std::byte, 32> key;
+
+	std::array<Entry, N_ENTRIES> entries{};
+
+public:
+	explicit VerifiedCredentialCache(std::chrono::steady_clock::duration _max_age) noexcept;
+
+	VerifiedCredentialCache(const VerifiedCredentialCache &) = delete;
+	VerifiedCredentialCache &operator=(const VerifiedCredentialCache &) = delete;
+
+	/**
+	 * Calculate the keyed hash which is passed to Contains() and
+	 * Add().  This method is thread-safe.
+	 */
+	[[gnu::pure]]
+	Digest MakeDigest(std::string_view user, std::string_view password,
+			  std::string_view crypted_password) const noexcept;
+
+	[[gnu::pure]]
+	bool Contains(const Digest &digest,
+		      std::chrono::steady_clock::time_point now) const noexcept;
+
+	/**
+	 * Remember that the password has been verified successfully.
+	 */
+	void Add(const Digest &digest,
+		 std::chrono::steady_clock::time_point now) noexcept;
+
+	void Clear() noexcept;
+
+private:
+	[[gnu::pure]]
+	static std::size_t GetIndex(const Digest &digest) noexcept;
+};
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "EarlyHintsCache.hxx"
+#include "cache/Item.hxx"
+#include "http/CommonHeaders.hxx"
+#include "http/LinkHeader.hxx"
+#include "strmap.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringStrip.hxx"
+
+#include <string>
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * Learned links expire after this duration, so the hints do not
+ * lag behind changes of the site forever.
+ */
+static constexpr std::chrono::steady_clock::duration early_hints_expires =
+	std::chrono::minutes(10);
+
+/**
+ * Larger values are not stored; there is no point in sending huge
+ * "103 Early Hints" responses.
+ */
+static constexpr std::size_t early_hints_max_link_size = 4096;
+
+/**
+ * Is the response private or must it not be stored?
+ */
+[[gnu::pure]]
+static bool
+IsPrivate(const char *cache_control) noexcept
+{
+	for (std::string_view s : IterableSplitString(cache_control, ',')) {
+		s = Strip(s);
+
+		if (s.starts_with("private"sv) ||
+		    s == "no-cache"sv || s == "no-store"sv)
+			return true;
+	}
+
+	return false;
+}
+
+bool
+IsEarlyHintsSharable(const StringMap &headers) noexcept
+{
+	if (headers.Contains(set_cookie_header) ||
+	    headers.Contains(set_cookie2_header))
+		return false;
+
+	const auto cache_control = headers.EqualRange(cache_control_header);
+	for (auto i = cache_control.first; i != cache_control.second; ++i)
+		if (IsPrivate(i->value))
+			return false;
+
+	return true;
+}
+
+class EarlyHintsCacheItemKey {
+protected:
+	const std::string key;
+
+public:
+	[[nodiscard]]
+	explicit EarlyHintsCacheItemKey(std::string_view _key) noexcept
+		:key(_key) {}
+};
+
+class EarlyHintsCache::Item final : EarlyHintsCacheItemKey, public CacheItem {
+	const std::string link;
+
+public:
+	Item(std::string_view _key, std::string &&_link,
+	     std::chrono::steady_clock::time_point now) noexcept
+		:EarlyHintsCacheItemKey(_key),
+		 CacheItem(StringWithHash{EarlyHintsCacheItemKey::key},
+			   sizeof(*this) + key.size() + _link.size(),
+			   now + early_hints_expires),
+		 link(std::move(_link)) {}
+
+	std::string_view GetLink() const noexcept {
+		return link;
+	}
+
+	/* virtual methods from class CacheItem */
+	void Destroy() noexcept override {
+		delete this;
+	}
+};
+
+EarlyHintsCache::EarlyHintsCache(EventLoop &event_loop,
+				 std::size_t max_size) noexcept
+	:cache(event_loop, max_size) {}
+
+EarlyHintsCache::~EarlyHintsCache() noexcept = default;
+
+std::string_view
+EarlyHintsCache::Get(std::string_view key) noexcept
+{
+	if (const auto *item = static_cast<const Item *>(cache.Get(StringWithHash{key})))
+		return item->GetLink();
+
+	return {};
+}
+
+void
+EarlyHintsCache::Put(std::string_view key, std::string_view link) noexcept
+{
+	auto early_link = ExtractEarlyHintLinks(link);
+	if (early_link.empty() || early_link.size() > early_hints_max_link_size) {
+		cache.Remove(StringWithHash{key});
+		return;
+	}
+
+	const auto now = cache.SteadyNow();
+
+	if (auto *item = static_cast<Item *>(cache.Get(StringWithHash{key}));
+	    item != nullptr && item->GetLink() == early_link) {
+		/* unchanged: just postpone the expiry */
+		cache.SetExpires(*item, now + early_hints_expires);
+		return;
+	}
+
+	cache.Put(*new Item(key, std::move(early_link), now));
+}
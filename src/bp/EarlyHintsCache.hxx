@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "cache/Cache.hxx"
+
+#include <string_view>
+
+class EventLoop;
+class StringMap;
+
+/**
+ * May the links of a response with these headers be learned by the
+ * #EarlyHintsCache, i.e. be sent to other clients?  This refuses
+ * responses which are private, must not be stored or set cookies,
+ * because their links may depend on the user.
+ */
+[[gnu::pure]]
+bool
+IsEarlyHintsSharable(const StringMap &response_headers) noexcept;
+
+/**
+ * Remembers the "preload" and "preconnect" links which were last
+ * seen in a response for a certain request, so they can be sent in a
+ * "103 Early Hints" response (RFC 8297) the next time this resource
+ * is requested, before the backend has responded.
+ */
+class EarlyHintsCache final {
+	class Item;
+
+	Cache cache;
+
+public:
+	EarlyHintsCache(EventLoop &event_loop, std::size_t max_size) noexcept;
+	~EarlyHintsCache() noexcept;
+
+	EarlyHintsCache(const EarlyHintsCache &) = delete;
+	EarlyHintsCache &operator=(const EarlyHintsCache &) = delete;
+
+	void Flush() noexcept {
+		cache.Flush();
+	}
+
+	/**
+	 * Look up the "Link" header value to be sent for the given
+	 * request.
+	 *
+	 * @return the "Link" header value or an empty string if
+	 * nothing is known
+	 */
+	[[gnu::pure]]
+	std::string_view Get(std::string_view key) noexcept;
+
+	/**
+	 * Remember the "Link" header of a response (or forget it if
+	 * it does not contain any links which are useful for "103
+	 * Early Hints").
+	 */
+	void Put(std::string_view key, std::string_view link) noexcept;
+};
@@ -3,8 +3,9 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "Request.hxx"
+#include "ModAuthEasy.hxx"
 #include "Instance.hxx"
-#include "AprMd5.hxx"
+#include "AccessFileCache.hxx"
 #include "FileHeaders.hxx"
 #include "file/Address.hxx"
 #include "lib/sodium/Base64.hxx"
@@ -14,20 +15,16 @@
 #include "translation/Vary.hxx"
 #include "istream/FileIstream.hxx"
 #include "io/FileAt.hxx"
-#include "io/FileDescriptor.hxx"
-#include "util/StringAPI.hxx"
+#include "io/UniqueFileDescriptor.hxx"
 #include "util/StringCompare.hxx"
 #include "util/StringSplit.hxx"
 #include "util/StringStrip.hxx"
 #include "util/CharUtil.hxx"
-#include "util/ScopeExit.hxx"
 
 #include <sodium.h>
 
 #include <assert.h>
 #include <fcntl.h>
-#include <stdlib.h>
-#include <stdio.h>
 #include <sys/stat.h>
 
 static void
@@ -125,23 +122,7 @@ ReadFirstLine(FileDescriptor fd, char *buffer, size_t size) noexcept
 	return buffer;
 }
 
-static bool
-VerifyPassword(const char *crypted_password,
-	       const char *given_password) noexcept
-{
-	if (IsAprMd5(crypted_password)) {
-		const auto result = AprMd5(given_password, crypted_password);
-		return StringIsEqual(crypted_password, result.c_str());
-	}
-
-	char *p = crypt(given_password, crypted_password);
-	if (p == nullptr)
-		return false;
-
-	return StringIsEqual(p, crypted_password);
-}
-
-static FILE *
+static UniqueFileDescriptor
 OpenSiblingFile(FileDescriptor directory, std::string_view base_relative,
 		const char *path,
 		const char *sibling_name)
@@ -156,7 +137,7 @@ OpenSiblingFile(FileDescriptor directory, std::string_view base_relative,
 		const std::string_view sibling_name_v{sibling_name};
 
 		if (base_relative.size() + parent.size() + sibling_name_v.size() >= sizeof(buffer))
-			return nullptr;
+			return {};
 
 		char *i = buffer;
 		if (*path != '/')
@@ -168,44 +149,11 @@ OpenSiblingFile(FileDescriptor directory, std::string_view base_relative,
 		sibling_name = buffer;
 	}
 
-	FileDescriptor fd;
+	UniqueFileDescriptor fd;
 	if (!fd.Open({directory, sibling_name}, O_RDONLY|O_NOFOLLOW))
-		return nullptr;
-
-	return fdopen(fd.Get(), "r");
-}
-
-static bool
-CheckAccessFileFor(FileDescriptor directory, std::string_view base_relative,
-		   const StringMap &request_headers, const char *html_path)
-{
-	FILE *file = OpenSiblingFile(directory, base_relative,
-				     html_path, ".access");
-	if (file == nullptr)
-		return true;
-
-	AtScopeExit(file) { fclose(file); };
-
-	const char *authorization = request_headers.Get(authorization_header);
-	if (authorization == nullptr)
-		return false;
-
-	const auto basic_auth = ParseBasicAuth(authorization);
-	if (basic_auth.first.empty())
-		return false;
-
-	const std::string_view username = basic_auth.first;
-	const auto given_password = basic_auth.second.c_str();
-
-	char buffer[4096];
-	while (fgets(buffer, sizeof(buffer), file) != nullptr) {
-		char *line = Strip(buffer);
-		const char *crypted_password = CheckUsername(line, username);
-		if (crypted_password != nullptr)
-			return VerifyPassword(crypted_password, given_password);
-	}
+		return {};
 
-	return false;
+	return fd;
 }
 
 bool
@@ -214,13 +162,51 @@ Request::EmulateModAuthEasy(const FileAddress &address,
 			    const struct statx &st,
 			    SharedLease &lease) noexcept
 {
-	if (!CheckAccessFileFor(handler.file.base, handler.file.base_relative,
-				request.headers,
-				address.path)) {
-		DispatchUnauthorized(*this);
-		return true;
+	auto access_fd = OpenSiblingFile(handler.file.base,
+					 handler.file.base_relative,
+					 address.path, ".access");
+	if (access_fd.IsDefined()) {
+		const char *authorization = request.headers.Get(authorization_header);
+		if (authorization == nullptr) {
+			DispatchUnauthorized(*this);
+			return true;
+		}
+
+		const auto basic_auth = ParseBasicAuth(authorization);
+		if (basic_auth.first.empty()) {
+			DispatchUnauthorized(*this);
+			return true;
+		}
+
+		handler.file.mod_auth_easy = UniquePoolPtr<Handler::File::ModAuthEasy>::Make(pool, *this, fd, st, false);
+
+		switch (instance.access_file_cache->CheckFile(std::move(access_fd),
+							      basic_auth.first,
+							      basic_auth.second,
+							      *handler.file.mod_auth_easy,
+							      cancel_ptr)) {
+		case AccessCheckResult::GRANTED:
+			break;
+
+		case AccessCheckResult::DENIED:
+			DispatchUnauthorized(*this);
+			return true;
+
+		case AccessCheckResult::PENDING:
+			handler.file.mod_auth_easy->lease = std::move(lease);
+			return true;
+		}
 	}
 
+	return CheckModAuthEasyHtml(address, fd, st, lease);
+}
+
+bool
+Request::CheckModAuthEasyHtml(const FileAddress &address,
+			      FileDescriptor fd,
+			      const struct statx &st,
+			      SharedLease &lease) noexcept
+{
 	if (!StringEndsWith(address.path, ".html"))
 		return false;
 
@@ -256,12 +242,40 @@ Request::EmulateModAuthEasy(const FileAddress &address,
 
 	const char *password =
 		FindUserPassword(s, basic_auth.first.c_str());
-	if (password == nullptr ||
-	    !VerifyPassword(password, basic_auth.second.c_str())) {
+	if (password == nullptr) {
 		DispatchUnauthorized(*this);
 		return true;
 	}
 
+	handler.file.mod_auth_easy = UniquePoolPtr<Handler::File::ModAuthEasy>::Make(pool, *this, fd, st, true);
+
+	switch (instance.access_file_cache->CheckPassword(password,
+							  basic_auth.first,
+							  basic_auth.second,
+							  *handler.file.mod_auth_easy,
+							  cancel_ptr)) {
+	case AccessCheckResult::GRANTED:
+		break;
+
+	case AccessCheckResult::DENIED:
+		DispatchUnauthorized(*this);
+		return true;
+
+	case AccessCheckResult::PENDING:
+		handler.file.mod_auth_easy->lease = std::move(lease);
+		return true;
+	}
+
+	DispatchModAuthEasyHtml(address, fd, st, std::move(lease));
+	return true;
+}
+
+void
+Request::DispatchModAuthEasyHtml(const FileAddress &address,
+				 FileDescriptor fd,
+				 const struct statx &st,
+				 SharedLease &&lease) noexcept
+{
 	const TranslateResponse &tr = *translate.response;
 
 	HttpHeaders headers;
@@ -281,6 +295,33 @@ Request::EmulateModAuthEasy(const FileAddress &address,
 					     address.path,
 					     fd, std::move(lease),
 					     0, st.stx_size));
+}
 
-	return true;
+void
+Request::OnModAuthEasyCheck(bool granted) noexcept
+{
+	auto &m = *handler.file.mod_auth_easy;
+
+	/* copy everything we need, because the following calls may
+	   replace #mod_auth_easy */
+	const auto &address = *handler.file.address;
+	const FileDescriptor fd = m.fd;
+	const struct statx st = m.st;
+	const bool html = m.html;
+	SharedLease lease = std::move(m.lease);
+
+	if (!granted) {
+		DispatchUnauthorized(*this);
+		return;
+	}
+
+	if (html) {
+		DispatchModAuthEasyHtml(address, fd, st, std::move(lease));
+		return;
+	}
+
+	/* the ".access" file has granted access; now check the HTML
+	   header (if any) */
+	if (!CheckModAuthEasyHtml(address, fd, st, lease))
+		HandleFileAddressAfterAuth(address, fd, st, std::move(lease));
 }
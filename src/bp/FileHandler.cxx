@@ -4,6 +4,7 @@
 
 #include "Precompressed.hxx"
 #include "FileHeaders.hxx"
+#include "StaticFileCache.hxx"
 #include "ClassifyMimeType.hxx"
 #include "file/Address.hxx"
 #include "Request.hxx"
@@ -15,6 +16,7 @@
 #include "http/Method.hxx"
 #include "http/IncomingRequest.hxx"
 #include "istream/FileIstream.hxx"
+#include "istream/UnusedPtr.hxx"
 #include "pool/pool.hxx"
 #include "translation/Vary.hxx"
 #include "lib/fmt/SystemError.hxx"
@@ -131,6 +133,52 @@ Request::GetFileContentType(const FileAddress &address) const noexcept
 	return "application/octet-stream";
 }
 
+/**
+ * Generate the "Accept-Ranges" and "Content-Range" response headers
+ * and apply the requested range to the status and the offsets.
+ *
+ * @return false if the range is not satisfiable and the response
+ * shall be sent without a body
+ */
+static bool
+ApplyFileRange(HttpHeaders &headers, HttpStatus &status,
+	       const HttpRangeRequest &range, uint_least64_t size,
+	       off_t &start_offset, off_t &end_offset) noexcept
+{
+	GrowingBuffer &headers2 = headers.GetBuffer();
+
+	header_write(headers2, "accept-ranges", "bytes");
+
+	switch (range.type) {
+	case HttpRangeRequest::Type::NONE:
+		break;
+
+	case HttpRangeRequest::Type::VALID:
+		start_offset = range.skip;
+		end_offset = range.size;
+
+		status = HttpStatus::PARTIAL_CONTENT;
+
+		headers.contains_content_range = true;
+		header_write_begin(headers2, "content-range"sv);
+		headers2.Fmt("bytes {}-{}/{}",
+			     range.skip, range.size - 1, size);
+		header_write_finish(headers2);
+		break;
+
+	case HttpRangeRequest::Type::INVALID:
+		status = HttpStatus::REQUESTED_RANGE_NOT_SATISFIABLE;
+
+		headers.contains_content_range = true;
+		header_write_begin(headers2, "content-range"sv);
+		headers2.Fmt("bytes */{}", size);
+		header_write_finish(headers2);
+		return false;
+	}
+
+	return true;
+}
+
 void
 Request::DispatchFile(const char *path, FileDescriptor fd,
 		      const struct statx &st, SharedLease &&lease,
@@ -155,64 +203,113 @@ Request::DispatchFile(const char *path, FileDescriptor fd,
 
 	/* generate the Content-Range header */
 
-	header_write(headers2, "accept-ranges", "bytes");
-
 	off_t start_offset = 0, end_offset = st.stx_size;
 
-	switch (file_request.range.type) {
-	case HttpRangeRequest::Type::NONE:
-		break;
+	if (!ApplyFileRange(headers, status, file_request.range, st.stx_size,
+			    start_offset, end_offset)) {
+		DispatchResponse(status, std::move(headers), nullptr);
+		return;
+	}
 
-	case HttpRangeRequest::Type::VALID:
-		start_offset = file_request.range.skip;
-		end_offset = file_request.range.size;
+	/* finished, dispatch this response */
 
-		status = HttpStatus::PARTIAL_CONTENT;
+	UnusedIstreamPtr body =
+#ifdef HAVE_URING
+		instance.uring
+		? (IsDirect(end_offset - start_offset, content_type)
+		   /* if this response is going to be transmitted
+		      directly, use splice() with io_uring instead of
+		      sendfile() to avoid getting blocked by slow disk
+		      (or network filesystem) I/O */
+		   ? NewUringSpliceIstream(instance.event_loop, *instance.uring, instance.pipe_stock,
+					   pool, path,
+					   fd, std::move(lease),
+					   start_offset, end_offset)
+		   : NewUringIstream(*instance.uring, pool, path,
+				     fd, std::move(lease),
+				     start_offset, end_offset))
+		:
+#endif
+		istream_file_fd_new(instance.event_loop, pool, path,
+				    fd, std::move(lease),
+				    start_offset, end_offset);
+
+	if (handler.file.static_file_cache_path.data() != nullptr &&
+	    file_request.range.type == HttpRangeRequest::Type::NONE &&
+	    request.method == HttpMethod::GET)
+		/* copy the file contents into the cache while sending
+		   them; the next request will be served from
+		   there */
+		body = instance.static_file_cache->Put(pool,
+						       handler.file.static_file_cache_path,
+						       handler.file.static_file_cache_beneath,
+						       content_type, fd, st,
+						       std::move(body));
+
+	DispatchResponse(status, std::move(headers), std::move(body));
+}
 
-		headers.contains_content_range = true;
-		header_write_begin(headers2, "content-range"sv);
-		headers2.Fmt("bytes {}-{}/{}",
-			     file_request.range.skip,
-			     file_request.range.size - 1,
-			     st.stx_size);
-		header_write_finish(headers2);
-		break;
+bool
+Request::IsStaticFileCacheable(const FileAddress &address) const noexcept
+{
+	if (!instance.static_file_cache)
+		return false;
 
-	case HttpRangeRequest::Type::INVALID:
-		status = HttpStatus::REQUESTED_RANGE_NOT_SATISFIABLE;
+	if (request.method != HttpMethod::HEAD &&
+	    request.method != HttpMethod::GET)
+		return false;
 
-		headers.contains_content_range = true;
-		header_write_begin(headers2, "content-range"sv);
-		headers2.Fmt("bytes */{}", st.stx_size);
-		header_write_finish(headers2);
+	/* the cached headers are not suitable for the processor,
+	   and transformations don't see the file anyway */
+	if (IsTransformationEnabled())
+		return false;
+
+	/* precompressed files are probed after opening the file;
+	   don't bother caching those */
+	if (address.auto_gzipped || address.auto_brotli_path ||
+	    address.gzipped != nullptr || translate.auto_gzipped)
+		return false;
+
+#ifdef HAVE_BROTLI
+	if (translate.auto_brotli_path)
+		return false;
+#endif
 
+	return !NeedsModAuthEasy(address);
+}
+
+void
+Request::DispatchCachedFile(StaticFileCacheItem &item) noexcept
+{
+	const TranslateResponse &tr = *translate.response;
+	const auto &st = item.GetStatx();
+
+	struct file_request file_request(st.stx_size);
+	if (!EvaluateFileRequest(st, file_request))
+		return;
+
+	HttpHeaders headers;
+	GrowingBuffer &headers2 = headers.GetBuffer();
+	headers2.Write(item.GetHeaders());
+	file_expires_header(headers2,
+			    instance.event_loop.GetSystemClockCache(),
+			    tr.GetExpiresRelative(HasQueryString()));
+	write_translation_vary_header(headers2, tr);
+
+	auto status = tr.status == HttpStatus{} ? HttpStatus::OK : tr.status;
+
+	off_t start_offset = 0, end_offset = st.stx_size;
+
+	if (!ApplyFileRange(headers, status, file_request.range, st.stx_size,
+			    start_offset, end_offset)) {
 		DispatchResponse(status, std::move(headers), nullptr);
 		return;
 	}
 
-	/* finished, dispatch this response */
-
 	DispatchResponse(status, std::move(headers),
-#ifdef HAVE_URING
-			 instance.uring
-			 ? (IsDirect(end_offset - start_offset, content_type)
-			    /* if this response is going to be
-			       transmitted directly, use splice() with
-			       io_uring instead of sendfile() to avoid
-			       getting blocked by slow disk (or
-			       network filesystem) I/O */
-			    ? NewUringSpliceIstream(instance.event_loop, *instance.uring, instance.pipe_stock,
-						    pool, path,
-						    fd, std::move(lease),
-						    start_offset, end_offset)
-			    : NewUringIstream(*instance.uring, pool, path,
-					      fd, std::move(lease),
-					      start_offset, end_offset))
-			 :
-#endif
-			 istream_file_fd_new(instance.event_loop, pool, path,
-					     fd, std::move(lease),
-					     start_offset, end_offset));
+			 instance.static_file_cache->NewIstream(pool, item,
+								start_offset,
+								end_offset));
 }
 
 inline bool
@@ -389,14 +486,9 @@ Request::ProbePrecompressed(FileDescriptor fd, const struct statx &st,
 	ProbeNextPrecompressed();
 }
 
-inline bool
-Request::MaybeEmulateModAuthEasy(const FileAddress &address,
-				 FileDescriptor fd,
-				 const struct statx &st,
-				 SharedLease &lease) noexcept
+bool
+Request::NeedsModAuthEasy(const FileAddress &address) const noexcept
 {
-	assert(S_ISREG(st.stx_mode));
-
 	if (!instance.config.emulate_mod_auth_easy)
 		return false;
 
@@ -410,7 +502,18 @@ Request::MaybeEmulateModAuthEasy(const FileAddress &address,
 	if (!StringStartsWith(base, "/var/www/vol"))
 		return false;
 
-	if (strstr(base, "/pr_0001/public_html") == nullptr)
+	return strstr(base, "/pr_0001/public_html") != nullptr;
+}
+
+inline bool
+Request::MaybeEmulateModAuthEasy(const FileAddress &address,
+				 FileDescriptor fd,
+				 const struct statx &st,
+				 SharedLease &lease) noexcept
+{
+	assert(S_ISREG(st.stx_mode));
+
+	if (!NeedsModAuthEasy(address))
 		return false;
 
 	return EmulateModAuthEasy(address, fd, st, lease);
@@ -435,6 +538,7 @@ Request::HandleFileAddress(const FileAddress &address) noexcept
 		return;
 
 	handler.file.address = &address;
+	handler.file.static_file_cache_path = {};
 
 	assert(address.path != nullptr);
 
@@ -460,6 +564,21 @@ Request::HandleFileAddressAfterBase(FileDescriptor base, std::string_view strip_
 	if (address.base != nullptr)
 		path = AllocatorPtr{pool}.ConcatView(address.base, path);
 
+	if (IsStaticFileCacheable(address)) {
+		const bool beneath = base.IsDefined();
+
+		if (auto *item = instance.static_file_cache->Get(path, beneath,
+								 GetFileContentType(address))) {
+			DispatchCachedFile(*item);
+			return;
+		}
+
+		/* cache miss: add the file to the cache after it has
+		   been opened */
+		handler.file.static_file_cache_path = path;
+		handler.file.static_file_cache_beneath = beneath;
+	}
+
 	static constexpr struct open_how open_read_only{
 		.flags = O_RDONLY|O_NOCTTY|O_CLOEXEC|O_NONBLOCK,
 		.resolve = RESOLVE_NO_MAGICLINKS,
@@ -504,6 +623,15 @@ Request::HandleFileAddress(const FileAddress &address,
 		return;
 	}
 
+	HandleFileAddressAfterAuth(address, fd, st, std::move(lease));
+}
+
+void
+Request::HandleFileAddressAfterAuth(const FileAddress &address,
+				    FileDescriptor fd,
+				    const struct statx &st,
+				    SharedLease &&lease) noexcept
+{
 	struct file_request file_request(st.stx_size);
 
 	/* request options */
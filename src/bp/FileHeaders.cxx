@@ -203,3 +203,12 @@ file_response_headers(GrowingBuffer &headers,
 
 	header_write(headers, "content-type", content_type);
 }
+
+void
+file_expires_header(GrowingBuffer &headers,
+		    const ClockCache<std::chrono::system_clock> &system_clock,
+		    std::chrono::seconds expires_relative) noexcept
+{
+	if (expires_relative > std::chrono::seconds::zero())
+		generate_expires(headers, system_clock.now(), expires_relative);
+}
@@ -32,3 +32,13 @@ file_response_headers(GrowingBuffer &headers,
 		      const struct statx &st,
 		      std::chrono::seconds expires_relative,
 		      bool processor_first) noexcept;
+
+/**
+ * Generate the "Expires" response header (if #expires_relative is
+ * positive).  This complements file_static_response_headers() (see
+ * file/Headers.hxx).
+ */
+void
+file_expires_header(GrowingBuffer &headers,
+		    const ClockCache<std::chrono::system_clock> &system_clock,
+		    std::chrono::seconds expires_relative) noexcept;
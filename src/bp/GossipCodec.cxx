@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "GossipCodec.hxx"
+
+#include <sodium/crypto_auth.h>
+#include <sodium/crypto_generichash.h>
+
+#include <algorithm> // for std::copy()
+#include <cassert>
+
+static_assert(BP_GOSSIP_KEY_SIZE == crypto_auth_KEYBYTES);
+static_assert(BP_GOSSIP_MAC_SIZE == crypto_auth_BYTES);
+static_assert(BP_GOSSIP_KEY_SIZE >= crypto_generichash_BYTES_MIN);
+static_assert(BP_GOSSIP_KEY_SIZE <= crypto_generichash_BYTES_MAX);
+
+BpGossipKey
+MakeBpGossipKey(std::string_view secret) noexcept
+{
+	BpGossipKey key;
+	crypto_generichash(reinterpret_cast<unsigned char *>(key.data()), key.size(),
+			   reinterpret_cast<const unsigned char *>(secret.data()),
+			   secret.size(),
+			   nullptr, 0);
+	return key;
+}
+
+BpGossipWriter::BpGossipWriter(const BpGossipKey &_key,
+			       uint_least64_t node_id) noexcept
+	:key(_key), fill(sizeof(BpGossipHeader))
+{
+	auto &header = *reinterpret_cast<BpGossipHeader *>(buffer.data());
+	header.magic = BP_GOSSIP_MAGIC;
+	header.node_id = node_id;
+}
+
+bool
+BpGossipWriter::Append(std::string_view site,
+		       uint_least32_t requests, uint_least64_t traffic) noexcept
+{
+	assert(!site.empty());
+
+	/* leave room for the HMAC */
+	const std::size_t size = sizeof(BpGossipSiteHeader) + site.size();
+	if (fill + size + BP_GOSSIP_MAC_SIZE > buffer.size())
+		return false;
+
+	auto &header = *reinterpret_cast<BpGossipSiteHeader *>(buffer.data() + fill);
+	header.site_length = static_cast<uint16_t>(site.size());
+	header.requests = requests;
+	header.traffic = traffic;
+
+	std::copy(site.begin(), site.end(),
+		  reinterpret_cast<char *>(buffer.data() + fill + sizeof(header)));
+
+	fill += size;
+	return true;
+}
+
+std::span<const std::byte>
+BpGossipWriter::Finish(uint_least64_t timestamp) noexcept
+{
+	assert(fill + BP_GOSSIP_MAC_SIZE <= buffer.size());
+
+	auto &header = *reinterpret_cast<BpGossipHeader *>(buffer.data());
+	header.timestamp = timestamp;
+
+	crypto_auth(reinterpret_cast<unsigned char *>(buffer.data() + fill),
+		    reinterpret_cast<const unsigned char *>(buffer.data()), fill,
+		    reinterpret_cast<const unsigned char *>(key.data()));
+
+	return std::span{buffer}.first(fill + BP_GOSSIP_MAC_SIZE);
+}
+
+bool
+BpGossipReplayFilter::Check(uint_least64_t node_id, uint_least64_t timestamp,
+			    uint_least64_t now) noexcept
+{
+	if (timestamp + BP_GOSSIP_MAX_AGE < now ||
+	    timestamp > now + BP_GOSSIP_MAX_AGE)
+		/* too old (or too far in the future): if we have
+		   forgotten this node already, this may be a replay */
+		return false;
+
+	auto [i, inserted] = nodes.try_emplace(node_id, timestamp);
+	if (!inserted) {
+		if (timestamp <= i->second)
+			/* duplicate or out of order */
+			return false;
+
+		i->second = timestamp;
+	}
+
+	return true;
+}
+
+void
+BpGossipReplayFilter::Expire(uint_least64_t now) noexcept
+{
+	std::erase_if(nodes, [now](const auto &i){
+		return i.second + BP_GOSSIP_MAX_AGE < now;
+	});
+}
+
+/**
+ * Parse the record at the beginning of the buffer.
+ *
+ * @return the size of the record or 0 if it is malformed
+ */
+static std::size_t
+SplitRecord(std::span<const std::byte> src,
+	    const BpGossipSiteHeader *&site_header,
+	    std::string_view &site) noexcept
+{
+	if (src.size() < sizeof(BpGossipSiteHeader))
+		return 0;
+
+	site_header = reinterpret_cast<const BpGossipSiteHeader *>(src.data());
+	src = src.subspan(sizeof(*site_header));
+
+	const std::size_t site_length = site_header->site_length;
+	if (site_length == 0 || src.size() < site_length)
+		return 0;
+
+	site = {reinterpret_cast<const char *>(src.data()), site_length};
+	return sizeof(*site_header) + site_length;
+}
+
+bool
+ParseBpGossip(std::span<const std::byte> src, const BpGossipKey &key,
+	      BpGossipReplayFilter &replay_filter, uint_least64_t now,
+	      uint_least64_t &node_id,
+	      const BpGossipRecordCallback &callback)
+{
+	if (src.size() < sizeof(BpGossipHeader) + BP_GOSSIP_MAC_SIZE)
+		return false;
+
+	const auto mac = src.last(BP_GOSSIP_MAC_SIZE);
+	src = src.first(src.size() - BP_GOSSIP_MAC_SIZE);
+
+	if (crypto_auth_verify(reinterpret_cast<const unsigned char *>(mac.data()),
+			       reinterpret_cast<const unsigned char *>(src.data()),
+			       src.size(),
+			       reinterpret_cast<const unsigned char *>(key.data())) != 0)
+		return false;
+
+	const auto &header = *reinterpret_cast<const BpGossipHeader *>(src.data());
+	if (header.magic != BP_GOSSIP_MAGIC)
+		return false;
+
+	node_id = header.node_id;
+	src = src.subspan(sizeof(header));
+
+	const BpGossipSiteHeader *site_header;
+	std::string_view site;
+
+	/* validate all records before applying any of them */
+	for (auto i = src; !i.empty();) {
+		const std::size_t size = SplitRecord(i, site_header, site);
+		if (size == 0)
+			return false;
+
+		i = i.subspan(size);
+	}
+
+	if (!replay_filter.Check(node_id, header.timestamp, now))
+		return false;
+
+	while (!src.empty()) {
+		const std::size_t size = SplitRecord(src, site_header, site);
+		src = src.subspan(size);
+
+		callback(site, site_header->requests, site_header->traffic);
+	}
+
+	return true;
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "GossipProtocol.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+using BpGossipKey = std::array<std::byte, BP_GOSSIP_KEY_SIZE>;
+
+/**
+ * Derive the datagram authentication key from the configured
+ * secret.
+ */
+[[gnu::pure]]
+BpGossipKey
+MakeBpGossipKey(std::string_view secret) noexcept;
+
+/**
+ * Builds one #BpPerSiteGossip datagram.
+ */
+class BpGossipWriter {
+	const BpGossipKey &key;
+
+	std::array<std::byte, BP_GOSSIP_MAX_DATAGRAM> buffer;
+
+	std::size_t fill;
+
+public:
+	/**
+	 * @param _key the authentication key; the reference must
+	 * remain valid as long as this object
+	 */
+	BpGossipWriter(const BpGossipKey &_key, uint_least64_t node_id) noexcept;
+
+	bool IsEmpty() const noexcept {
+		return fill == sizeof(BpGossipHeader);
+	}
+
+	/**
+	 * Remove all records (but keep the header).
+	 */
+	void Clear() noexcept {
+		fill = sizeof(BpGossipHeader);
+	}
+
+	/**
+	 * Append one record.
+	 *
+	 * @return false if the datagram is full (or if the site name
+	 * is too long to fit into any datagram)
+	 */
+	bool Append(std::string_view site,
+		    uint_least32_t requests, uint_least64_t traffic) noexcept;
+
+	/**
+	 * Append the HMAC and return the complete datagram.  The
+	 * returned span is valid until the next Clear() or
+	 * Append() call.
+	 *
+	 * @param timestamp see BpGossipHeader::timestamp; must be
+	 * larger than the one of the previous datagram
+	 */
+	std::span<const std::byte> Finish(uint_least64_t timestamp) noexcept;
+};
+
+/**
+ * Remembers the newest timestamp of each node to reject replayed
+ * datagrams.
+ */
+class BpGossipReplayFilter {
+	/**
+	 * Maps the node id to the newest timestamp accepted from
+	 * it.
+	 */
+	std::unordered_map<uint_least64_t, uint_least64_t> nodes;
+
+public:
+	/**
+	 * Check whether a datagram is fresh, and if yes, remember
+	 * its timestamp.
+	 *
+	 * @param now the receiver's clock (same unit as
+	 * BpGossipHeader::timestamp)
+	 */
+	bool Check(uint_least64_t node_id, uint_least64_t timestamp,
+		   uint_least64_t now) noexcept;
+
+	/**
+	 * Forget nodes whose newest timestamp has become too old;
+	 * replays of their datagrams are rejected by the age check.
+	 */
+	void Expire(uint_least64_t now) noexcept;
+};
+
+using BpGossipRecordCallback =
+	std::function<void(std::string_view site,
+			   uint_least32_t requests,
+			   uint_least64_t traffic)>;
+
+/**
+ * Parse a datagram received from another node.  The whole datagram
+ * (including its HMAC) is validated before the callback is invoked
+ * for the first time, so a malformed datagram is never applied
+ * partially.
+ *
+ * @param now the receiver's clock in microseconds since the epoch
+ * @param node_id receives the sender's node id
+ * @param callback invoked for each record
+ * @return false if the datagram is malformed, not authentic or
+ * replayed (in which case the callback has not been invoked)
+ */
+bool
+ParseBpGossip(std::span<const std::byte> src, const BpGossipKey &key,
+	      BpGossipReplayFilter &replay_filter, uint_least64_t now,
+	      uint_least64_t &node_id,
+	      const BpGossipRecordCallback &callback);
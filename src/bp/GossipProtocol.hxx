@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * The UDP protocol used by #BpPerSiteGossip to exchange per-site
+ * rate limiter consumption between beng-proxy nodes.
+ *
+ * Each datagram begins with a #BpGossipHeader, followed by any
+ * number of records, each consisting of a #BpGossipSiteHeader and
+ * the site name (without padding), and ends with a HMAC
+ * (libsodium's crypto_auth()) of everything before it, keyed with a
+ * secret shared by all nodes.  All numbers are big-endian.
+ * The counters are deltas since the previous datagram of the same
+ * node, so a lost datagram only means that the receivers
+ * underestimate the consumption for a moment.
+ *
+ * The authenticated header carries a timestamp which is strictly
+ * increasing per node; receivers reject datagrams which are not
+ * newer than the last one of the same node, or whose timestamp is
+ * too far from their own clock (#BP_GOSSIP_MAX_AGE).  This prevents
+ * replaying captured datagrams.
+ */
+
+#pragma once
+
+#include "util/PackedBigEndian.hxx"
+
+#include <cstddef>
+#include <cstdint>
+
+static constexpr uint32_t BP_GOSSIP_MAGIC = 0x62704733; // "bpG3"
+
+static constexpr unsigned BP_GOSSIP_DEFAULT_PORT = 5482;
+
+/**
+ * The maximum size of a datagram.  This is small enough to avoid IP
+ * fragmentation on Ethernet.
+ */
+static constexpr std::size_t BP_GOSSIP_MAX_DATAGRAM = 1400;
+
+/**
+ * Datagrams whose timestamp differs from the receiver's clock by
+ * more than this (in microseconds) are rejected.  This requires the
+ * clocks of all nodes to be synchronized.
+ */
+static constexpr uint_least64_t BP_GOSSIP_MAX_AGE = 10'000'000;
+
+/**
+ * The size of the key and of the HMAC at the end of each datagram
+ * (crypto_auth_KEYBYTES and crypto_auth_BYTES).
+ */
+static constexpr std::size_t BP_GOSSIP_KEY_SIZE = 32;
+static constexpr std::size_t BP_GOSSIP_MAC_SIZE = 32;
+
+struct BpGossipHeader {
+	PackedBE32 magic;
+
+	/**
+	 * A random number identifying the sender; used to ignore
+	 * our own datagrams (e.g. multicast loopback).
+	 */
+	PackedBE64 node_id;
+
+	/**
+	 * The sender's wall clock time in microseconds since the
+	 * epoch; strictly increasing for each #node_id.
+	 */
+	PackedBE64 timestamp;
+};
+
+static_assert(sizeof(BpGossipHeader) == 20);
+static_assert(alignof(BpGossipHeader) == 1);
+
+struct BpGossipSiteHeader {
+	PackedBE16 site_length;
+
+	/**
+	 * The number of requests accepted since the last datagram.
+	 */
+	PackedBE32 requests;
+
+	/**
+	 * The number of bytes transferred since the last datagram.
+	 */
+	PackedBE64 traffic;
+
+	/*
+	  char site[site_length];
+	*/
+};
+
+static_assert(sizeof(BpGossipSiteHeader) == 14);
+static_assert(alignof(BpGossipSiteHeader) == 1);
@@ -143,7 +143,7 @@ Request::HandleTranslatedRequest2(const TranslateResponse &response) noexcept
 
 	if (response.stats_tag != nullptr) {
 		auto &rl = *(BpRequestLogger *)request.logger;
-		rl.stats_tag = response.stats_tag;
+		rl.stats_tag = instance.stats_tags.Intern(response.stats_tag);
 	}
 
 	if (response.rate_limit_site_requests.IsDefined() ||
@@ -446,6 +446,7 @@ Request::HandleTranslatedRequest(UniquePoolPtr<TranslateResponse> _response) noe
 	if (response.generator != nullptr) {
 		auto &rl = *(BpRequestLogger *)request.logger;
 		rl.generator = p_strdup(request.pool, response.generator);
+		rl.generator_id = instance.stats_generators.Intern(response.generator);
 	}
 
 	ApplyFileEnotdir();
@@ -7,7 +7,17 @@
 #include "LStats.hxx"
 #include "Connection.hxx"
 #include "PerSite.hxx"
+#include "PerSiteGossip.hxx"
 #include "LSSHandler.hxx"
+#include "Control.hxx"
+#include "AutoCompressPolicy.hxx"
+#include "trace/Exporter.hxx"
+#include "trace/Tracer.hxx"
+#include "StaticFileCache.hxx"
+#include "EarlyHintsCache.hxx"
+#include "AccessFileCache.hxx"
+#include "widget/FragmentCache.hxx"
+#include "pool/pool.hxx"
 #include "memory/fb_pool.hxx"
 #include "event/net/control/Server.hxx"
 #include "cluster/TcpBalancer.hxx"
@@ -42,8 +52,11 @@
 #include "spawn/CgroupPidsThrottle.hxx"
 #include "spawn/Client.hxx"
 #include "spawn/Launch.hxx"
+#include "net/InterfaceNameCache.hxx"
 #include "net/ListenStreamStock.hxx"
 #include "access_log/Glue.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "io/Logger.hxx"
 #include "time/Cast.hxx" // for ToFloatSeconds()
 #include "util/PrintException.hxx"
 
@@ -55,6 +68,7 @@
 #include <fmt/core.h>
 
 #include <sys/signal.h>
+#include <unistd.h> // for getpid()
 
 static constexpr auto COMPRESS_INTERVAL = std::chrono::minutes(10);
 
@@ -128,6 +142,186 @@ BpInstance::~BpInstance() noexcept
 	FreeStocksAndCaches();
 }
 
+void
+BpInstance::CreateStocksAndCaches(Net::Log::Sink *child_log_sink,
+				  const ChildErrorLogOptions &child_log_options) noexcept
+{
+	tcp_stock = new TcpStock(event_loop,
+				 config.tcp_stock_limit,
+				 config.tcp_stock_max_idle);
+	tcp_balancer = new TcpBalancer(*tcp_stock, failure_manager);
+
+	fs_stock = new FilteredSocketStock(event_loop,
+					   config.tcp_stock_limit,
+					   config.tcp_stock_max_idle);
+	fs_balancer = new FilteredSocketBalancer(*fs_stock, failure_manager);
+
+#ifdef HAVE_NGHTTP2
+	nghttp2_stock = new NgHttp2::Stock();
+#endif
+
+	/* the WidgetRegistry class has its own cache and doesn't need
+	   the TranslationCache */
+	if (uncached_translation_service)
+		widget_registry = new WidgetRegistry(root_pool,
+						     *uncached_translation_service);
+
+	if (translation_service != nullptr) {
+		spawn_listen_stream_stock_handler =
+			std::make_unique<BpListenStreamStockHandler>(*this,
+								     child_log_sink,
+								     child_log_options);
+		listen_stream_stock = std::make_unique<ListenStreamStock>(event_loop,
+									  *spawn_listen_stream_stock_handler);
+	}
+
+	lhttp_stock = std::make_unique<LhttpStock>(event_loop,
+						   *spawn_service,
+#ifdef HAVE_LIBSYSTEMD
+						   cgroup_multi_watch.get(),
+#endif
+						   listen_stream_stock.get(),
+						   config.lhttp_stock_options,
+						   child_log_sink,
+						   child_log_options);
+
+	fcgi_stock = std::make_unique<FcgiStock>(event_loop,
+						 *spawn_service,
+#ifdef HAVE_LIBSYSTEMD
+						 cgroup_multi_watch.get(),
+#endif
+						 listen_stream_stock.get(),
+						 config.fcgi_stock_options,
+						 child_log_sink, child_log_options);
+
+#ifdef HAVE_LIBWAS
+	was_stock = new WasStock(event_loop,
+				 *spawn_service,
+				 listen_stream_stock.get(),
+				 child_log_sink, child_log_options,
+				 config.was_stock_options);
+	multi_was_stock = new MultiWasStock(event_loop,
+					    *spawn_service,
+#ifdef HAVE_LIBSYSTEMD
+					    cgroup_multi_watch.get(),
+#endif
+					    config.multi_was_stock_options,
+					    child_log_sink,
+					    child_log_options);
+	remote_was_stock = new RemoteWasStock(event_loop,
+					      config.remote_was_stock_options);
+
+#ifdef HAVE_URING
+	if (uring) {
+		fd_cache.EnableUring(*uring);
+
+		if (config.was_io_uring) {
+			was_stock->EnableUring(*uring);
+			multi_was_stock->EnableUring(*uring);
+			remote_was_stock->EnableUring(*uring);
+		}
+	}
+#endif // HAVE_URING
+#endif // HAVE_LIBWAS
+
+	direct_resource_loader =
+		new DirectResourceLoader(event_loop,
+#ifdef HAVE_URING
+					 uring.get(),
+#endif
+					 tcp_balancer,
+					 *fs_balancer,
+#ifdef HAVE_NGHTTP2
+					 *nghttp2_stock,
+#endif
+					 *spawn_service,
+					 lhttp_stock.get(),
+					 fcgi_stock.get(),
+#ifdef HAVE_LIBWAS
+					 was_stock,
+					 multi_was_stock,
+					 remote_was_stock,
+					 this,
+#endif
+					 ssl_client_factory.get(),
+
+					 /* TODO how to support
+					    per-listener XFF
+					    setting? */
+					 config.access_log.main.xff);
+
+	if (config.http_cache_size > 0) {
+		http_cache = http_cache_new(root_pool,
+					    config.http_cache_size,
+					    config.http_cache_admission,
+					    config.http_cache_obey_no_cache,
+					    config.http_cache_key_rules,
+					    config.http_cache_disk,
+					    event_loop,
+#ifdef HAVE_URING
+					    uring.get(),
+#endif
+					    *direct_resource_loader);
+
+		cached_resource_loader = new CachedResourceLoader(*http_cache);
+	} else
+		cached_resource_loader = direct_resource_loader;
+
+	pipe_stock = new PipeStock(event_loop);
+
+#ifdef HAVE_URING
+	if (uring)
+		pipe_stock->EnableUring(*uring);
+#endif // HAVE_URING
+
+	if (config.filter_cache_size > 0) {
+		filter_cache = filter_cache_new(root_pool,
+						config.filter_cache_size,
+						config.filter_cache_admission,
+						event_loop,
+						*direct_resource_loader);
+		filter_resource_loader = new FilterResourceLoader(*filter_cache);
+	} else
+		filter_resource_loader = direct_resource_loader;
+
+	if (config.encoding_cache_size > 0) {
+		encoding_cache = std::make_unique<EncodingCache>(event_loop,
+								 config.encoding_cache_size);
+
+		if (config.encoding_cache_recompress)
+			encoding_cache->EnableRecompress(worker_pool_get(event_loop));
+	}
+
+	if (config.static_file_cache_size > 0)
+		static_file_cache =
+			std::make_unique<StaticFileCache>(event_loop,
+							  config.static_file_cache_size);
+
+	if (config.widget_fragment_cache_size > 0)
+		widget_fragment_cache =
+			std::make_unique<WidgetFragmentCache>(event_loop,
+							      config.widget_fragment_cache_size);
+
+	if (config.early_hints_cache_size > 0)
+		early_hints_cache =
+			std::make_unique<EarlyHintsCache>(event_loop,
+							  config.early_hints_cache_size);
+
+	if (config.emulate_mod_auth_easy)
+		access_file_cache =
+			std::make_unique<AccessFileCache>(event_loop,
+							  worker_pool_get(event_loop));
+
+	if (config.adaptive_auto_compress)
+		auto_compress_policy =
+			std::make_unique<AutoCompressPolicy>(worker_pool_get(event_loop));
+
+	buffered_filter_resource_loader =
+		new BufferedResourceLoader(event_loop,
+					   *filter_resource_loader,
+					   pipe_stock);
+}
+
 void
 BpInstance::FreeStocksAndCaches() noexcept
 {
@@ -152,6 +346,10 @@ BpInstance::FreeStocksAndCaches() noexcept
 	}
 
 	encoding_cache.reset();
+	static_file_cache.reset();
+	widget_fragment_cache.reset();
+	early_hints_cache.reset();
+	access_file_cache.reset();
 
 	lhttp_stock.reset();
 	fcgi_stock.reset();
@@ -180,6 +378,233 @@ BpInstance::FreeStocksAndCaches() noexcept
 	delete std::exchange(pipe_stock, nullptr);
 }
 
+inline TranslationServiceBuilder &
+BpInstance::GetTranslationServiceBuilder() const noexcept
+{
+	return translation_caches
+		? (TranslationServiceBuilder &)*translation_caches
+		: *translation_clients;
+}
+
+#ifdef HAVE_AVAHI
+
+inline Avahi::Client &
+BpInstance::GetAvahiClient()
+{
+	if (!avahi_client) {
+		Avahi::ErrorHandler &error_handler = *this;
+		avahi_client = std::make_unique<Avahi::Client>(event_loop,
+							       error_handler);
+	}
+
+	return *avahi_client;
+}
+
+Avahi::Publisher &
+BpInstance::GetAvahiPublisher()
+{
+	if (!avahi_publisher) {
+		Avahi::ErrorHandler &error_handler = *this;
+		avahi_publisher = std::make_unique<Avahi::Publisher>(GetAvahiClient(),
+								     "beng-proxy",
+								     error_handler);
+	}
+
+	return *avahi_publisher;
+}
+
+#endif
+
+void
+BpInstance::ShutdownCallback() noexcept
+{
+	event_loop.SetVolatile();
+	fd_cache.BeginShutdown();
+	file_cache.BeginShutdown();
+
+	if (static_file_cache)
+		static_file_cache->BeginShutdown();
+
+	if (widget_fragment_cache)
+		widget_fragment_cache->BeginShutdown();
+
+	if (access_file_cache)
+		access_file_cache->BeginShutdown();
+
+#ifdef HAVE_LIBSYSTEMD
+	systemd_watchdog.Disable();
+#endif
+
+	DisableSignals();
+	auto_compress_policy.reset();
+
+	trace_set_sample_rate(0);
+	trace_exporter.reset();
+	per_site_gossip.reset();
+	worker_pool_stop();
+
+	if (spawn)
+		spawn->Shutdown();
+
+#ifdef HAVE_LIBSYSTEMD
+	if (cgroup_multi_watch)
+		cgroup_multi_watch->BeginShutdown();
+
+	cgroup_pids_throttle.reset();
+	cgroup_memory_throttle.reset();
+#endif
+
+	listeners.clear();
+
+	pool_commit();
+
+#ifdef HAVE_AVAHI
+	avahi_publisher.reset();
+	avahi_client.reset();
+#endif
+
+#ifdef HAVE_URING
+	enable_uring_timer.Cancel();
+#endif
+
+	compress_timer.Cancel();
+
+	zombie_reaper.Disable();
+
+	worker_pool_join();
+
+	background_manager.AbortAll();
+
+	session_save_timer.Cancel();
+	session_save_deinit(*session_manager);
+
+	session_manager.reset();
+
+	FreeStocksAndCaches();
+
+	global_control_handler_deinit(this);
+
+	pool_commit();
+}
+
+void
+BpInstance::ReloadEventCallback(int) noexcept
+{
+	LogConcat(3, "main", "caught SIGHUP, flushing all caches (pid=",
+		  (int)getpid(), ")");
+
+	FlushInterfaceNameCache();
+
+	FadeChildren();
+
+	FlushTranslationCaches();
+
+	if (http_cache != nullptr)
+		http_cache_flush(*http_cache);
+
+	if (filter_cache != nullptr)
+		filter_cache_flush(*filter_cache);
+
+	if (encoding_cache)
+		encoding_cache->Flush();
+
+	if (static_file_cache)
+		static_file_cache->Flush();
+
+	if (widget_fragment_cache)
+		widget_fragment_cache->Flush();
+
+	if (early_hints_cache)
+		early_hints_cache->Flush();
+
+	if (access_file_cache)
+		access_file_cache->Flush();
+
+#ifdef HAVE_NGHTTP2
+	if (nghttp2_stock != nullptr)
+		nghttp2_stock->FadeAll();
+#endif
+
+#ifdef HAVE_LIBWAS
+	if (remote_was_stock != nullptr)
+		remote_was_stock->FadeAll();
+#endif
+
+	if (listen_stream_stock)
+		listen_stream_stock->FadeAll();
+
+	fd_cache.Flush();
+	file_cache.Flush();
+
+	Compress();
+
+	ReloadState();
+}
+
+void
+BpInstance::EnableSignals() noexcept
+{
+	shutdown_listener.Enable();
+	sighup_event.Enable();
+}
+
+void
+BpInstance::DisableSignals() noexcept
+{
+	shutdown_listener.Disable();
+	sighup_event.Disable();
+}
+
+static std::shared_ptr<TranslationService>
+MakeTranslationService(EventLoop &event_loop, Pcre::Cache &pcre_cache,
+		       TranslationServiceBuilder &b,
+		       const std::forward_list<LocalSocketAddress> &l)
+{
+	auto multi = std::make_shared<MultiTranslationService>();
+	for (const SocketAddress a : l)
+		multi->Add(b.Get(a, event_loop, pcre_cache));
+
+	return multi;
+}
+
+inline Net::Log::Sink *
+BpInstance::GetChildLogSink(const UidGid *logger_user)
+{
+	if (config.child_error_log.type != AccessLogConfig::Type::INTERNAL) {
+		if (!child_error_log)
+			child_error_log.reset(AccessLogGlue::Create(event_loop,
+								    config.child_error_log,
+								    logger_user));
+
+		if (child_error_log)
+			return child_error_log->GetChildSink();
+	}
+
+	if (auto *access_logger = access_log.Make(event_loop, config.access_log, logger_user, {}))
+		return access_logger->GetChildSink();
+
+	return nullptr;
+}
+
+void
+BpInstance::AddListener(const BpListenerConfig &c, const UidGid *logger_user)
+{
+	auto ts = c.translation_sockets.empty()
+		? translation_service
+		: MakeTranslationService(event_loop, pcre_cache,
+					 GetTranslationServiceBuilder(),
+					 c.translation_sockets);
+
+	listeners.emplace_front(*this,
+				listener_stats[c.tag],
+				config.access_log.FindXForwardedForConfig(c.access_logger_name),
+				access_log.Make(event_loop,
+						config.access_log, logger_user,
+						c.access_logger_name),
+				std::move(ts),
+				c, c.Create(SOCK_STREAM));
+}
+
 void
 BpInstance::ForkCow(bool inherit) noexcept
 {
@@ -196,6 +621,12 @@ BpInstance::ForkCow(bool inherit) noexcept
 
 	if (encoding_cache)
 		encoding_cache->ForkCow(inherit);
+
+	if (static_file_cache)
+		static_file_cache->ForkCow(inherit);
+
+	if (widget_fragment_cache)
+		widget_fragment_cache->ForkCow(inherit);
 }
 
 void
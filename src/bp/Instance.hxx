@@ -10,7 +10,8 @@
 #include "UringGlue.hxx"
 #include "Config.hxx"
 #include "access_log/Multi.hxx"
-#include "stats/HttpStats.hxx"
+#include "stats/ShardedHttpStats.hxx"
+#include "stats/TagRegistry.hxx"
 #include "lib/avahi/ErrorHandler.hxx"
 #ifdef HAVE_LIBWAS
 #include "was/MetricsHandler.hxx"
@@ -81,15 +82,23 @@ class FcgiStock;
 class HttpCache;
 class FilterCache;
 class EncodingCache;
+class StaticFileCache;
+class WidgetFragmentCache;
+class EarlyHintsCache;
+class AccessFileCache;
+class AutoCompressPolicy;
+class TraceExporter;
 class SessionManager;
 class BpListener;
 class BpPerSite;
 class BpPerSiteMap;
+class BpPerSiteGossip;
 struct BpListenerStats;
 namespace NgHttp2 { class Stock; }
 namespace Avahi { class Client; class Publisher; }
 namespace Prometheus { struct Stats; }
 namespace Net::Log { class Sink; }
+struct ChildErrorLogOptions;
 
 struct TranslateResponse;
 struct ResourceAddress;
@@ -104,7 +113,21 @@ struct BpInstance final : PInstance, BengControl::Handler,
 			  Avahi::ErrorHandler {
 	const BpConfig config;
 
-	HttpStats http_stats;
+	ShardedHttpStats http_stats;
+
+	/**
+	 * Interned #TranslationCommand::STATS_TAG values for
+	 * #BpListenerStats.
+	 */
+	StatsTagRegistry stats_tags{"stats_tags"};
+
+	/**
+	 * Interned GENERATOR values for #BpListenerStats.  These may
+	 * come from the "X-CM4all-Generator" response header, i.e.
+	 * from an untrusted backend, therefore the number of distinct
+	 * values is limited more strictly.
+	 */
+	StatsTagRegistry stats_generators{"stats_generators", 4096};
 
 #ifdef HAVE_LIBSYSTEMD
 	Systemd::Watchdog systemd_watchdog{event_loop};
@@ -131,6 +154,31 @@ struct BpInstance final : PInstance, BengControl::Handler,
 	 */
 	FileCache file_cache{event_loop};
 
+	/**
+	 * Cache for the contents of small static files.  Only set if
+	 * BpConfig::static_file_cache_size is non-zero.
+	 */
+	std::unique_ptr<StaticFileCache> static_file_cache;
+
+	/**
+	 * Cache for the processed output of session-independent
+	 * widgets.  Only set if BpConfig::widget_fragment_cache_size
+	 * is non-zero.
+	 */
+	std::unique_ptr<WidgetFragmentCache> widget_fragment_cache;
+
+	/**
+	 * Remembers preload links for "103 Early Hints".  Only set if
+	 * BpConfig::early_hints_cache_size is non-zero.
+	 */
+	std::unique_ptr<EarlyHintsCache> early_hints_cache;
+
+	/**
+	 * Cache for the credentials of the mod_auth_easy emulation.
+	 * Only set if BpConfig::emulate_mod_auth_easy is enabled.
+	 */
+	std::unique_ptr<AccessFileCache> access_file_cache;
+
 	/**
 	 * An allocator for per-request memory.
 	 */
@@ -215,6 +263,19 @@ struct BpInstance final : PInstance, BengControl::Handler,
 
 	std::unique_ptr<EncodingCache> encoding_cache;
 
+	/**
+	 * Chooses the compression level for auto-compressed responses
+	 * depending on the load.  Only set if
+	 * BpConfig::adaptive_auto_compress is enabled.
+	 */
+	std::unique_ptr<AutoCompressPolicy> auto_compress_policy;
+
+	/**
+	 * Writes sampled request traces.  Only set if
+	 * BpConfig::trace_path is set.
+	 */
+	std::unique_ptr<TraceExporter> trace_exporter;
+
 	std::unique_ptr<BpListenStreamStockHandler> spawn_listen_stream_stock_handler;
 	std::unique_ptr<ListenStreamStock> listen_stream_stock;
 
@@ -241,6 +302,8 @@ struct BpInstance final : PInstance, BengControl::Handler,
 
 	std::unique_ptr<BpPerSiteMap> per_site;
 
+	std::unique_ptr<BpPerSiteGossip> per_site_gossip;
+
 	BpInstance(BpConfig &&_config,
 		   LaunchSpawnServerResult &&spawner) noexcept;
 	~BpInstance() noexcept;
@@ -250,6 +313,14 @@ struct BpInstance final : PInstance, BengControl::Handler,
 
 	Net::Log::Sink *GetChildLogSink(const UidGid *logger_user);
 
+	/**
+	 * Create all stocks, caches and #ResourceLoader instances
+	 * according to #config.  The translation services must have
+	 * been set up already.
+	 */
+	void CreateStocksAndCaches(Net::Log::Sink *child_log_sink,
+				   const ChildErrorLogOptions &child_log_options) noexcept;
+
 	void EnableSignals() noexcept;
 	void DisableSignals() noexcept;
 
@@ -4,19 +4,19 @@
 
 #pragma once
 
-#include "stats/TaggedHttpStats.hxx"
-#include "stats/PerGeneratorStats.hxx"
+#include "stats/ShardedHttpStats.hxx"
 
 /**
- * Per-listener statistics.
+ * Per-listener statistics.  The counters are per-thread; use
+ * Merge*() to obtain a snapshot.
  */
 struct BpListenerStats {
-	TaggedHttpStats tagged;
+	ShardedTaggedHttpStats tagged;
 
-	PerGeneratorStatsMap per_generator;
+	ShardedPerGeneratorStats per_generator;
 
-	void AddRequest(std::string_view tag,
-			std::string_view generator,
+	void AddRequest(StatsTagId tag,
+			StatsTagId generator,
 			HttpStatus status,
 			uint64_t bytes_received,
 			uint64_t bytes_sent,
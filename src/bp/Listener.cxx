@@ -119,22 +119,34 @@ BpListener::SetZeroconfVisible(bool _visible) noexcept
 
 #endif
 
+UniqueSocketDescriptor
+BpListener::OnFilteredSocketAccept(UniqueSocketDescriptor s,
+				   SocketAddress)
+{
+	/* check the limit before the listener allocates a pool and
+	   TLS state for this connection; during a connection storm,
+	   this avoids wasting TLS handshakes on connections which
+	   would be dropped afterwards anyway.  Connections which are
+	   still in the TLS handshake count, too, or else a storm of
+	   handshakes would bypass the limit. */
+	const std::size_t n = GetConnectionCount() + listener.GetPendingCount();
+	if (n >= instance.config.max_connections) {
+		/* drop only the new connection; this peer has not
+		   even completed a handshake yet, and must not be
+		   able to evict established clients */
+		LogFmt(1, "connection", "too many connections ({}), dropping", n);
+		s.Close();
+	}
+
+	return s;
+}
+
 void
 BpListener::OnFilteredSocketConnect(PoolPtr pool,
 				    UniquePoolPtr<FilteredSocket> socket,
 				    SocketAddress address,
 				    const SslFilter *ssl_filter) noexcept
 {
-	if (GetConnectionCount() >= instance.config.max_connections) {
-		unsigned num_dropped = DropSomeConnections();
-
-		if (num_dropped == 0) {
-			LogFmt(1, "connection", "too many connections ({}), dropping",
-			       GetConnectionCount());
-			return;
-		}
-	}
-
 	auto *connection = new_connection(std::move(pool), instance, *this,
 					  prometheus_exporter.get(),
 					  std::move(socket), ssl_filter,
@@ -119,6 +119,15 @@ public:
 		return connections.size();
 	}
 
+	/**
+	 * Add a socket which is already connected.  This is used by
+	 * the benchmark to inject one side of a socketpair().
+	 */
+	void AddConnection(UniqueSocketDescriptor s,
+			   SocketAddress address) noexcept {
+		listener.AddConnection(std::move(s), address);
+	}
+
 	void CloseConnection(BpConnection &connection) noexcept;
 
 	/**
@@ -135,6 +144,8 @@ private:
 	std::unique_ptr<Avahi::Service> MakeAvahiService(const BpListenerConfig &config) const noexcept;
 
 	/* virtual methods from class FilteredSocketListenerHandler */
+	UniqueSocketDescriptor OnFilteredSocketAccept(UniqueSocketDescriptor s,
+						      SocketAddress address) override;
 	void OnFilteredSocketConnect(PoolPtr pool,
 				     UniquePoolPtr<FilteredSocket> socket,
 				     SocketAddress address,
@@ -5,53 +5,29 @@
 #include "CommandLine.hxx"
 #include "Instance.hxx"
 #include "Listener.hxx"
-#include "LStats.hxx"
-#include "Connection.hxx"
-#include "LSSHandler.hxx"
+#include "PerSite.hxx"
+#include "PerSiteGossip.hxx"
 #include "pool/pool.hxx"
+#include "pool/Profiler.hxx"
 #include "memory/fb_pool.hxx"
 #include "session/Manager.hxx"
 #include "session/Save.hxx"
-#include "tcp_stock.hxx"
+#include "trace/Exporter.hxx"
+#include "trace/Tracer.hxx"
 #include "translation/Stock.hxx"
 #include "translation/Cache.hxx"
 #include "translation/Multi.hxx"
 #include "translation/Builder.hxx"
-#include "cluster/TcpBalancer.hxx"
-#include "fs/Stock.hxx"
-#include "fs/Balancer.hxx"
-#include "nghttp2/Stock.hxx"
-#include "http/cache/EncodingCache.hxx"
-#include "http/cache/FilterCache.hxx"
-#include "http/cache/Public.hxx"
-#include "http/local/Stock.hxx"
-#include "http/rl/DirectResourceLoader.hxx"
-#include "http/rl/CachedResourceLoader.hxx"
-#include "http/rl/FilterResourceLoader.hxx"
-#include "http/rl/BufferedResourceLoader.hxx"
-#include "fcgi/Stock.hxx"
-#include "was/Stock.hxx"
-#include "was/MStock.hxx"
-#include "was/RStock.hxx"
-#include "thread/Pool.hxx"
-#include "pipe/Stock.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "bp/Control.hxx"
-#include "widget/Registry.hxx"
 #include "access_log/Glue.hxx"
 #include "ssl/Init.hxx"
 #include "ssl/Client.hxx"
 #include "system/KernelVersion.hxx"
 #include "system/SetupProcess.hxx"
 #include "system/ProcessName.hxx"
-#include "spawn/CgroupMemoryThrottle.hxx"
-#include "spawn/CgroupMultiWatch.hxx"
-#include "spawn/CgroupPidsThrottle.hxx"
 #include "spawn/Launch.hxx"
 #include "spawn/Client.hxx"
-#include "net/InterfaceNameCache.hxx"
-#include "net/ListenStreamStock.hxx"
-#include "net/SocketAddress.hxx"
-#include "net/StaticSocketAddress.hxx"
 #include "io/Logger.hxx"
 #include "io/SpliceSupport.hxx"
 #include "util/StringCompare.hxx"
@@ -74,222 +50,11 @@
 #include <systemd/sd-daemon.h>
 #endif
 
-#ifdef HAVE_AVAHI
-#include "lib/avahi/Client.hxx"
-#include "lib/avahi/Publisher.hxx"
-#include "lib/avahi/Service.hxx"
-#endif
-
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <sysexits.h> // for EX_*
 
-#ifndef NDEBUG
-bool debug_mode = false;
-#endif
-
-inline TranslationServiceBuilder &
-BpInstance::GetTranslationServiceBuilder() const noexcept
-{
-	return translation_caches
-		? (TranslationServiceBuilder &)*translation_caches
-		: *translation_clients;
-}
-
-#ifdef HAVE_AVAHI
-
-inline Avahi::Client &
-BpInstance::GetAvahiClient()
-{
-	if (!avahi_client) {
-		Avahi::ErrorHandler &error_handler = *this;
-		avahi_client = std::make_unique<Avahi::Client>(event_loop,
-							       error_handler);
-	}
-
-	return *avahi_client;
-}
-
-Avahi::Publisher &
-BpInstance::GetAvahiPublisher()
-{
-	if (!avahi_publisher) {
-		Avahi::ErrorHandler &error_handler = *this;
-		avahi_publisher = std::make_unique<Avahi::Publisher>(GetAvahiClient(),
-								     "beng-proxy",
-								     error_handler);
-	}
-
-	return *avahi_publisher;
-}
-
-#endif
-
-void
-BpInstance::ShutdownCallback() noexcept
-{
-	event_loop.SetVolatile();
-	fd_cache.BeginShutdown();
-	file_cache.BeginShutdown();
-
-#ifdef HAVE_LIBSYSTEMD
-	systemd_watchdog.Disable();
-#endif
-
-	DisableSignals();
-	thread_pool_stop();
-
-	if (spawn)
-		spawn->Shutdown();
-
-#ifdef HAVE_LIBSYSTEMD
-	if (cgroup_multi_watch)
-		cgroup_multi_watch->BeginShutdown();
-
-	cgroup_pids_throttle.reset();
-	cgroup_memory_throttle.reset();
-#endif
-
-	listeners.clear();
-
-	pool_commit();
-
-#ifdef HAVE_AVAHI
-	avahi_publisher.reset();
-	avahi_client.reset();
-#endif
-
-#ifdef HAVE_URING
-	enable_uring_timer.Cancel();
-#endif
-
-	compress_timer.Cancel();
-
-	zombie_reaper.Disable();
-
-	thread_pool_join();
-
-	background_manager.AbortAll();
-
-	session_save_timer.Cancel();
-	session_save_deinit(*session_manager);
-
-	session_manager.reset();
-
-	FreeStocksAndCaches();
-
-	global_control_handler_deinit(this);
-
-	pool_commit();
-}
-
-void
-BpInstance::ReloadEventCallback(int) noexcept
-{
-	LogConcat(3, "main", "caught SIGHUP, flushing all caches (pid=",
-		  (int)getpid(), ")");
-
-	FlushInterfaceNameCache();
-
-	FadeChildren();
-
-	FlushTranslationCaches();
-
-	if (http_cache != nullptr)
-		http_cache_flush(*http_cache);
-
-	if (filter_cache != nullptr)
-		filter_cache_flush(*filter_cache);
-
-	if (encoding_cache)
-		encoding_cache->Flush();
-
-#ifdef HAVE_NGHTTP2
-	if (nghttp2_stock != nullptr)
-		nghttp2_stock->FadeAll();
-#endif
-
-#ifdef HAVE_LIBWAS
-	if (remote_was_stock != nullptr)
-		remote_was_stock->FadeAll();
-#endif
-
-	if (listen_stream_stock)
-		listen_stream_stock->FadeAll();
-
-	fd_cache.Flush();
-	file_cache.Flush();
-
-	Compress();
-
-	ReloadState();
-}
-
-void
-BpInstance::EnableSignals() noexcept
-{
-	shutdown_listener.Enable();
-	sighup_event.Enable();
-}
-
-void
-BpInstance::DisableSignals() noexcept
-{
-	shutdown_listener.Disable();
-	sighup_event.Disable();
-}
-
-static std::shared_ptr<TranslationService>
-MakeTranslationService(EventLoop &event_loop, Pcre::Cache &pcre_cache,
-		       TranslationServiceBuilder &b,
-		       const std::forward_list<LocalSocketAddress> &l)
-{
-	auto multi = std::make_shared<MultiTranslationService>();
-	for (const SocketAddress a : l)
-		multi->Add(b.Get(a, event_loop, pcre_cache));
-
-	return multi;
-}
-
-inline Net::Log::Sink *
-BpInstance::GetChildLogSink(const UidGid *logger_user)
-{
-	if (config.child_error_log.type != AccessLogConfig::Type::INTERNAL) {
-		if (!child_error_log)
-			child_error_log.reset(AccessLogGlue::Create(event_loop,
-								    config.child_error_log,
-								    logger_user));
-
-		if (child_error_log)
-			return child_error_log->GetChildSink();
-	}
-
-	if (auto *access_logger = access_log.Make(event_loop, config.access_log, logger_user, {}))
-		return access_logger->GetChildSink();
-
-	return nullptr;
-}
-
-void
-BpInstance::AddListener(const BpListenerConfig &c, const UidGid *logger_user)
-{
-	auto ts = c.translation_sockets.empty()
-		? translation_service
-		: MakeTranslationService(event_loop, pcre_cache,
-					 GetTranslationServiceBuilder(),
-					 c.translation_sockets);
-
-	listeners.emplace_front(*this,
-				listener_stats[c.tag],
-				config.access_log.FindXForwardedForConfig(c.access_logger_name),
-				access_log.Make(event_loop,
-						config.access_log, logger_user,
-						c.access_logger_name),
-				std::move(ts),
-				c, c.Create(SOCK_STREAM));
-}
-
 [[gnu::const]]
 static unsigned
 GetDefaultPort() noexcept
@@ -368,6 +133,8 @@ try {
 	capabilities_init();
 #endif // HAVE_LIBCAP
 
+	pool_profiler_set_mode(instance.config.pool_profiler);
+
 	const ScopeSslGlobalInit ssl_init;
 	instance.ssl_client_factory =
 		std::make_unique<SslClientFactory>(instance.config.ssl_client);
@@ -386,6 +153,29 @@ try {
 						 instance.config.cluster_size,
 						 instance.config.cluster_node);
 
+	if (!instance.config.session_store_path.empty())
+		instance.session_manager->OpenSharedStore(instance.config.session_store_path.c_str(),
+							  instance.config.session_store_size);
+
+	if (!instance.config.trace_path.empty()) {
+		instance.trace_exporter =
+			std::make_unique<TraceExporter>(instance.event_loop,
+							instance.config.trace_path.c_str(),
+							"beng-proxy");
+		trace_set_sample_rate(instance.config.trace_sample_rate);
+		trace_set_honor_traceparent(instance.config.trace_traceparent);
+	}
+
+	if (instance.config.rate_limit_gossip.IsEnabled()) {
+		if (!instance.per_site)
+			instance.per_site = std::make_unique<BpPerSiteMap>();
+
+		instance.per_site_gossip =
+			std::make_unique<BpPerSiteGossip>(instance.event_loop,
+							  *instance.per_site,
+							  instance.config.rate_limit_gossip);
+	}
+
 	if (!instance.config.session_save_path.empty()) {
 		session_save_init(*instance.session_manager,
 				  instance.config.session_save_path.c_str());
@@ -402,22 +192,6 @@ try {
 
 	/* initialize ResourceLoader and all its dependencies */
 
-	instance.tcp_stock = new TcpStock(instance.event_loop,
-					  instance.config.tcp_stock_limit,
-					  instance.config.tcp_stock_max_idle);
-	instance.tcp_balancer = new TcpBalancer(*instance.tcp_stock,
-						instance.failure_manager);
-
-	instance.fs_stock = new FilteredSocketStock(instance.event_loop,
-						    instance.config.tcp_stock_limit,
-						    instance.config.tcp_stock_max_idle);
-	instance.fs_balancer = new FilteredSocketBalancer(*instance.fs_stock,
-							  instance.failure_manager);
-
-#ifdef HAVE_NGHTTP2
-	instance.nghttp2_stock = new NgHttp2::Stock();
-#endif
-
 	assert(!instance.config.translation_sockets.empty());
 
 	instance.translation_clients =
@@ -429,7 +203,8 @@ try {
 		instance.translation_caches =
 			std::make_unique<TranslationCacheBuilder>(*instance.translation_clients,
 								  instance.root_pool,
-								  instance.config.translate_cache_size);
+								  instance.config.translate_cache_size,
+								  instance.config.translate_cache_admission);
 		instance.cached_translation_service =
 			std::make_unique<MultiTranslationService>();
 	}
@@ -451,137 +226,7 @@ try {
 		? instance.cached_translation_service
 		: instance.uncached_translation_service;
 
-
-	/* the WidgetRegistry class has its own cache and doesn't need
-	   the TranslationCache */
-	instance.widget_registry =
-		new WidgetRegistry(instance.root_pool,
-				   *instance.uncached_translation_service);
-
-	if (instance.translation_service != nullptr) {
-		instance.spawn_listen_stream_stock_handler =
-			std::make_unique<BpListenStreamStockHandler>(instance,
-								     child_log_sink,
-								     child_log_options);
-		instance.listen_stream_stock = std::make_unique<ListenStreamStock>(instance.event_loop,
-										   *instance.spawn_listen_stream_stock_handler);
-	}
-
-
-	instance.lhttp_stock = std::make_unique<LhttpStock>(instance.event_loop,
-							    *instance.spawn_service,
-#ifdef HAVE_LIBSYSTEMD
-							    instance.cgroup_multi_watch.get(),
-#endif
-							    instance.listen_stream_stock.get(),
-							    instance.config.lhttp_stock_options,
-							    child_log_sink,
-							    child_log_options);
-
-	instance.fcgi_stock = std::make_unique<FcgiStock>(instance.event_loop,
-							  *instance.spawn_service,
-#ifdef HAVE_LIBSYSTEMD
-							  instance.cgroup_multi_watch.get(),
-#endif
-							  instance.listen_stream_stock.get(),
-							  instance.config.fcgi_stock_options,
-							  child_log_sink, child_log_options);
-
-#ifdef HAVE_LIBWAS
-	instance.was_stock = new WasStock(instance.event_loop,
-					  *instance.spawn_service,
-					  instance.listen_stream_stock.get(),
-					  child_log_sink, child_log_options,
-					  instance.config.was_stock_options);
-	instance.multi_was_stock =
-		new MultiWasStock(instance.event_loop,
-				  *instance.spawn_service,
-#ifdef HAVE_LIBSYSTEMD
-				  instance.cgroup_multi_watch.get(),
-#endif
-				  instance.config.multi_was_stock_options,
-				  child_log_sink,
-				  child_log_options);
-	instance.remote_was_stock =
-		new RemoteWasStock(instance.event_loop,
-				   instance.config.remote_was_stock_options);
-
-#ifdef HAVE_URING
-	if (instance.uring) {
-		instance.fd_cache.EnableUring(*instance.uring);
-
-		if (instance.config.was_io_uring) {
-			instance.was_stock->EnableUring(*instance.uring);
-			instance.multi_was_stock->EnableUring(*instance.uring);
-			instance.remote_was_stock->EnableUring(*instance.uring);
-		}
-	}
-#endif // HAVE_URING
-#endif // HAVE_LIBWAS
-
-	instance.direct_resource_loader =
-		new DirectResourceLoader(instance.event_loop,
-#ifdef HAVE_URING
-					 instance.uring.get(),
-#endif
-					 instance.tcp_balancer,
-					 *instance.fs_balancer,
-#ifdef HAVE_NGHTTP2
-					 *instance.nghttp2_stock,
-#endif
-					 *instance.spawn_service,
-					 instance.lhttp_stock.get(),
-					 instance.fcgi_stock.get(),
-#ifdef HAVE_LIBWAS
-					 instance.was_stock,
-					 instance.multi_was_stock,
-					 instance.remote_was_stock,
-					 &instance,
-#endif
-					 instance.ssl_client_factory.get(),
-
-					 /* TODO how to support
-					    per-listener XFF
-					    setting? */
-					 instance.config.access_log.main.xff);
-
-	if (instance.config.http_cache_size > 0) {
-		instance.http_cache = http_cache_new(instance.root_pool,
-						     instance.config.http_cache_size,
-						     instance.config.http_cache_obey_no_cache,
-						     instance.event_loop,
-						     *instance.direct_resource_loader);
-
-		instance.cached_resource_loader =
-			new CachedResourceLoader(*instance.http_cache);
-	} else
-		instance.cached_resource_loader = instance.direct_resource_loader;
-
-	instance.pipe_stock = new PipeStock(instance.event_loop);
-
-#ifdef HAVE_URING
-	if (instance.uring)
-		instance.pipe_stock->EnableUring(*instance.uring);
-#endif // HAVE_URING
-
-	if (instance.config.filter_cache_size > 0) {
-		instance.filter_cache = filter_cache_new(instance.root_pool,
-							 instance.config.filter_cache_size,
-							 instance.event_loop,
-							 *instance.direct_resource_loader);
-		instance.filter_resource_loader =
-			new FilterResourceLoader(*instance.filter_cache);
-	} else
-		instance.filter_resource_loader = instance.direct_resource_loader;
-
-	if (instance.config.encoding_cache_size > 0)
-		instance.encoding_cache = std::make_unique<EncodingCache>(instance.event_loop,
-									  instance.config.encoding_cache_size);
-
-	instance.buffered_filter_resource_loader =
-		new BufferedResourceLoader(instance.event_loop,
-					   *instance.filter_resource_loader,
-					   instance.pipe_stock);
+	instance.CreateStocksAndCaches(child_log_sink, child_log_options);
 
 	instance.ForkCow(false);
 	instance.ApplyPopulate();
@@ -631,7 +276,7 @@ try {
 
 	/* cleanup */
 
-	thread_pool_deinit();
+	worker_pool_deinit();
 } catch (...) {
 	PrintException(std::current_exception());
 	return EXIT_FAILURE;
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Request.hxx"
+#include "AccessFileCache.hxx"
+#include "util/SharedLease.hxx"
+
+#include <sys/stat.h>
+
+struct Request::Handler::File::ModAuthEasy final : AccessCheckHandler {
+	Request &request;
+
+	/**
+	 * The lease on #fd; it is moved here only while a check is
+	 * pending.
+	 */
+	SharedLease lease;
+
+	const struct statx st;
+
+	const FileDescriptor fd;
+
+	/**
+	 * Is the "~#" header of the HTML file being checked (and not
+	 * the ".access" file)?
+	 */
+	const bool html;
+
+	ModAuthEasy(Request &_request, FileDescriptor _fd,
+		    const struct statx &_st, bool _html) noexcept
+		:request(_request), st(_st), fd(_fd), html(_html) {}
+
+	/* virtual methods from class AccessCheckHandler */
+	void OnAccessCheck(bool granted) noexcept override {
+		request.OnModAuthEasyCheck(granted);
+	}
+};
@@ -10,8 +10,12 @@
 #include "util/StringWithHash.hxx"
 #include "util/TokenBucket.hxx"
 
+#include <algorithm> // for std::min()
 #include <cassert>
+#include <concepts>
+#include <cstdint>
 #include <string>
+#include <utility> // for std::exchange()
 
 class BpPerSite final
 	: public IntrusiveHashSetHook<>,
@@ -27,6 +31,21 @@ class BpPerSite final
 	TokenBucket request_count_throttle;
 	TokenBucket request_traffic_throttle;
 
+	/**
+	 * The most recent configurations passed to
+	 * CheckRequestCount() and UpdateRequestTraffic(); needed to
+	 * apply consumption reported by other nodes.
+	 */
+	TokenBucketConfig request_count_config{};
+	TokenBucketConfig request_traffic_config{};
+
+	/**
+	 * Local consumption which was not yet reported to other
+	 * nodes (see #BpPerSiteGossip).
+	 */
+	uint_least32_t gossip_requests = 0;
+	uint_least64_t gossip_traffic = 0;
+
 	double expires = 0;
 
 public:
@@ -45,7 +64,11 @@ public:
 	};
 
 	bool CheckRequestCount(TokenBucketConfig config, double now) noexcept {
+		request_count_config = config;
+
 		bool result = request_count_throttle.Check(config, now, 1);
+		if (result)
+			++gossip_requests;
 
 		if (double full_time = request_count_throttle.GetFullTime(config);
 		    full_time > expires)
@@ -59,6 +82,9 @@ public:
 	}
 
 	void UpdateRequestTraffic(TokenBucketConfig config, double now, double size) noexcept {
+		request_traffic_config = config;
+		gossip_traffic += static_cast<uint_least64_t>(size);
+
 		request_traffic_throttle.Update(config, now, size);
 
 		if (double full_time = request_traffic_throttle.GetFullTime(config);
@@ -66,6 +92,59 @@ public:
 			expires = full_time;
 	}
 
+	/**
+	 * Return the local consumption since the last call and reset
+	 * the counters.
+	 */
+	std::pair<uint_least32_t, uint_least64_t> TakeGossipDelta() noexcept {
+		return {
+			std::exchange(gossip_requests, 0),
+			std::exchange(gossip_traffic, 0),
+		};
+	}
+
+	/**
+	 * Account consumption reported by another node, as if it
+	 * had happened here.  This makes all nodes share one budget.
+	 * Nothing is done until this node has seen a request for
+	 * this site, because only then the limits are known.
+	 *
+	 * Each delta is clamped to what one node can consume within
+	 * the given interval (the burst plus the refill), so a single
+	 * (bogus) datagram cannot block the site for longer than
+	 * that.
+	 *
+	 * @param interval the (maximum) time span covered by one
+	 * delta in seconds
+	 */
+	void ApplyRemoteConsumption(double now, double interval,
+				    uint_least32_t requests,
+				    uint_least64_t traffic) noexcept {
+		if (requests > 0 && request_count_config.rate > 0) {
+			request_count_throttle.Update(request_count_config, now,
+						      std::min<double>(requests,
+								       GetMaxDelta(request_count_config, interval)));
+
+			if (double full_time = request_count_throttle.GetFullTime(request_count_config);
+			    full_time > expires)
+				expires = full_time;
+		}
+
+		if (traffic > 0 && request_traffic_config.rate > 0) {
+			request_traffic_throttle.Update(request_traffic_config, now,
+							std::min<double>(traffic,
+									 GetMaxDelta(request_traffic_config, interval)));
+
+			if (double full_time = request_traffic_throttle.GetFullTime(request_traffic_config);
+			    full_time > expires)
+				expires = full_time;
+		}
+	}
+
+	const std::string &GetName() const noexcept {
+		return site;
+	}
+
 	bool IsExpired(double now) const noexcept {
 		return now >= expires;
 	}
@@ -75,6 +154,18 @@ public:
 		request_traffic_throttle.Reset();
 	}
 
+private:
+	/**
+	 * The maximum consumption a node can report for one
+	 * interval: an empty bucket is refilled with
+	 * rate*interval, plus the burst it may have had at the
+	 * beginning.
+	 */
+	static constexpr double GetMaxDelta(TokenBucketConfig config,
+					    double interval) noexcept {
+		return config.burst + config.rate * interval;
+	}
+
 protected:
 	// virtual methods from SharedAnchor
 	void OnAbandoned() noexcept override;
@@ -111,4 +202,9 @@ public:
 	 */
 	[[gnu::pure]]
 	SharedLeasePtr<BpPerSite> Make(StringWithHash site) noexcept;
+
+	void ForEach(std::invocable<BpPerSite &> auto f) {
+		for (auto &i : lru)
+			f(i);
+	}
 };
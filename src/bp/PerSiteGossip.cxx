@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PerSiteGossip.hxx"
+#include "PerSite.hxx"
+#include "GossipCodec.hxx"
+#include "event/Loop.hxx"
+#include "net/StaticSocketAddress.hxx"
+#include "time/Cast.hxx" // for ToFloatSeconds()
+#include "util/StringWithHash.hxx"
+
+#include <algorithm> // for std::any_of(), std::max(), std::ranges::equal()
+#include <random>
+
+#include <sys/socket.h>
+
+static constexpr Event::Duration SEND_INTERVAL = std::chrono::seconds{1};
+
+/**
+ * Receive at most this many datagrams per #SocketEvent callback to
+ * avoid starving other events.
+ */
+static constexpr unsigned MAX_RECEIVE_BATCH = 64;
+
+static uint_least64_t
+GenerateNodeId() noexcept
+{
+	std::random_device rd;
+	return (uint_least64_t{rd()} << 32) | rd();
+}
+
+BpPerSiteGossip::BpPerSiteGossip(EventLoop &event_loop, BpPerSiteMap &_map,
+				 const BpConfig::RateLimitGossip &config)
+	:map(_map),
+	 event(event_loop, BIND_THIS_METHOD(EventCallback)),
+	 send_timer(event_loop, BIND_THIS_METHOD(OnSendTimer)),
+	 node_id(GenerateNodeId()),
+	 key(MakeBpGossipKey(config.secret))
+{
+	for (const auto &i : config.peers)
+		destinations.emplace_front(i);
+
+	if (!config.multicast_group.IsNull()) {
+		auto &group = destinations.emplace_front(config.multicast_group);
+		if (group.GetPort() == 0)
+			group.SetPort(config.bind_address.GetPort());
+	} else
+		allowed_sources = config.peers;
+
+	event.Open(config.Create(SOCK_DGRAM).Release());
+	event.ScheduleRead();
+
+	send_timer.Schedule(SEND_INTERVAL);
+}
+
+BpPerSiteGossip::~BpPerSiteGossip() noexcept
+{
+	event.Close();
+}
+
+inline uint_least64_t
+BpPerSiteGossip::GetTimestamp() const noexcept
+{
+	const auto now = event.GetEventLoop().SystemNow().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+void
+BpPerSiteGossip::Send(std::span<const std::byte> datagram) noexcept
+{
+	const int fd = event.GetSocket().Get();
+
+	for (const auto &i : destinations)
+		/* errors are ignored; the next datagram will carry
+		   fresh deltas anyway */
+		::sendto(fd, datagram.data(), datagram.size(),
+			 MSG_DONTWAIT|MSG_NOSIGNAL,
+			 i.GetAddress(), i.GetSize());
+}
+
+void
+BpPerSiteGossip::Flush(BpGossipWriter &writer) noexcept
+{
+	if (writer.IsEmpty())
+		return;
+
+	/* several datagrams may be sent in one event loop
+	   iteration, but each needs a new timestamp */
+	last_timestamp = std::max(GetTimestamp(), last_timestamp + 1);
+
+	Send(writer.Finish(last_timestamp));
+	writer.Clear();
+}
+
+void
+BpPerSiteGossip::OnSendTimer() noexcept
+{
+	BpGossipWriter writer{key, node_id};
+
+	map.ForEach([this, &writer](BpPerSite &per_site){
+		const auto [requests, traffic] = per_site.TakeGossipDelta();
+		if (requests == 0 && traffic == 0)
+			return;
+
+		const std::string_view site = per_site.GetName();
+		if (writer.Append(site, requests, traffic))
+			return;
+
+		Flush(writer);
+
+		/* if this fails again, the site name is too long;
+		   ignore it */
+		writer.Append(site, requests, traffic);
+	});
+
+	Flush(writer);
+
+	replay_filter.Expire(GetTimestamp());
+
+	send_timer.Schedule(SEND_INTERVAL);
+}
+
+inline bool
+BpPerSiteGossip::IsAllowedSource(SocketAddress address) const noexcept
+{
+	if (allowed_sources.empty())
+		/* multicast: any member of the group */
+		return true;
+
+	const auto steady = address.GetSteadyPart();
+	return std::any_of(allowed_sources.begin(), allowed_sources.end(),
+			   [steady](SocketAddress i){
+				   return std::ranges::equal(i.GetSteadyPart(), steady);
+			   });
+}
+
+inline void
+BpPerSiteGossip::ReceiveDatagram(std::span<const std::byte> datagram) noexcept
+{
+	const double now = ToFloatSeconds(event.GetEventLoop().SteadyNow().time_since_epoch());
+
+	uint_least64_t sender;
+	ParseBpGossip(datagram, key, replay_filter, GetTimestamp(),
+		      sender, [this, now, &sender](std::string_view site,
+						   uint_least32_t requests,
+						   uint_least64_t traffic){
+		if (sender == node_id)
+			/* our own multicast datagram */
+			return;
+
+		/* sites which are not known locally are ignored
+		   because we don't know their limits */
+		if (auto *per_site = map.Get(StringWithHash{site}))
+			per_site->ApplyRemoteConsumption(now, ToFloatSeconds(SEND_INTERVAL),
+							 requests, traffic);
+	});
+}
+
+void
+BpPerSiteGossip::EventCallback(unsigned) noexcept
+{
+	std::byte buffer[BP_GOSSIP_MAX_DATAGRAM];
+	const int fd = event.GetSocket().Get();
+
+	for (unsigned i = 0; i < MAX_RECEIVE_BATCH; ++i) {
+		StaticSocketAddress address;
+		socklen_t address_size = address.GetCapacity();
+		const auto nbytes = ::recvfrom(fd, buffer, sizeof(buffer),
+					       MSG_DONTWAIT,
+					       address, &address_size);
+		if (nbytes < 0)
+			/* EAGAIN or error; errors are ignored, there
+			   is nothing we could do */
+			break;
+
+		address.SetSize(address_size);
+		if (!IsAllowedSource(address))
+			continue;
+
+		ReceiveDatagram(std::span{buffer}.first(nbytes));
+	}
+}
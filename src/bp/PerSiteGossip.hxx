@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Config.hxx"
+#include "GossipCodec.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "event/SocketEvent.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+
+#include <cstdint>
+#include <forward_list>
+#include <span>
+
+class BpPerSiteMap;
+class SocketAddress;
+
+/**
+ * Shares the consumption of the per-site rate limiters
+ * (#BpPerSite) with other nodes of the cluster.
+ *
+ * Once per second, each node sends the number of requests and bytes
+ * it has accounted since the last datagram to all other nodes (via
+ * multicast and/or a list of unicast peers).  Receivers apply these
+ * deltas to their own token buckets, so the configured rate becomes
+ * a cluster-wide budget.
+ *
+ * This is best-effort: a lost datagram just means the cluster
+ * briefly allows a little more than the limit, and nodes may join
+ * and leave at any time.  The request path only increments two
+ * counters.
+ *
+ * Datagrams are authenticated with a HMAC, and replays are rejected
+ * by #BpGossipReplayFilter; without a multicast group, only
+ * datagrams from the configured peers are accepted.
+ */
+class BpPerSiteGossip final {
+	BpPerSiteMap &map;
+
+	SocketEvent event;
+
+	CoarseTimerEvent send_timer;
+
+	/**
+	 * A random number identifying this process; used to ignore
+	 * our own multicast datagrams.
+	 */
+	const uint_least64_t node_id;
+
+	const BpGossipKey key;
+
+	/**
+	 * The timestamp of the last datagram sent by this node; see
+	 * BpGossipHeader::timestamp.
+	 */
+	uint_least64_t last_timestamp = 0;
+
+	BpGossipReplayFilter replay_filter;
+
+	std::forward_list<AllocatedSocketAddress> destinations;
+
+	/**
+	 * Datagrams are accepted only from these addresses (the
+	 * port is ignored).  Empty if a multicast group is
+	 * configured, because its members are not known; in that
+	 * case, the "interface" setting can be used to restrict the
+	 * source.
+	 */
+	std::forward_list<AllocatedSocketAddress> allowed_sources;
+
+public:
+	BpPerSiteGossip(EventLoop &event_loop, BpPerSiteMap &_map,
+			const BpConfig::RateLimitGossip &config);
+	~BpPerSiteGossip() noexcept;
+
+	BpPerSiteGossip(const BpPerSiteGossip &) = delete;
+	BpPerSiteGossip &operator=(const BpPerSiteGossip &) = delete;
+
+private:
+	/**
+	 * Returns the current wall clock time in microseconds since
+	 * the epoch.
+	 */
+	[[gnu::pure]]
+	uint_least64_t GetTimestamp() const noexcept;
+
+	void Send(std::span<const std::byte> datagram) noexcept;
+	void Flush(BpGossipWriter &writer) noexcept;
+
+	[[gnu::pure]]
+	bool IsAllowedSource(SocketAddress address) const noexcept;
+
+	void ReceiveDatagram(std::span<const std::byte> datagram) noexcept;
+
+	void OnSendTimer() noexcept;
+	void EventCallback(unsigned events) noexcept;
+};
@@ -4,11 +4,20 @@
 
 #include "PrometheusExporter.hxx"
 #include "Instance.hxx"
+#include "AutoCompressPolicy.hxx"
 #include "LStats.hxx"
 #include "prometheus/Stats.hxx"
 #include "prometheus/HttpStats.hxx"
 #include "prometheus/SpawnStats.hxx"
 #include "prometheus/StockStats.hxx"
+#include "prometheus/AutoCompressStats.hxx"
+#include "prometheus/ThreadSocketFilterStats.hxx"
+#include "prometheus/WorkerPoolStats.hxx"
+#include "prometheus/PoolProfilerStats.hxx"
+#include "pool/Profiler.hxx"
+#include "stats/WorkerPoolStats.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "thread/WorkerPool.hxx"
 #include "http/Headers.hxx"
 #include "http/IncomingRequest.hxx"
 #include "http/ResponseHandler.hxx"
@@ -23,6 +32,7 @@
 #include "stock/Stats.hxx"
 #include "memory/istream_gb.hxx"
 #include "memory/GrowingBuffer.hxx"
+#include "fs/ThreadSocketFilter.hxx"
 #include "event/PrometheusStats.hxx"
 #include "tcp_stock.hxx"
 
@@ -38,10 +48,13 @@ namespace Prometheus {
 static void
 Write(GrowingBuffer &buffer, std::string_view process,
       std::string_view listener,
-      const BpListenerStats &stats) noexcept
+      const BpListenerStats &stats,
+      const StatsTagRegistry &tags,
+      const StatsTagRegistry &generators) noexcept
 {
-	Prometheus::Write(buffer, process, listener, stats.tagged);
-	Prometheus::Write(buffer, process, listener, stats.per_generator);
+	Prometheus::Write(buffer, process, listener, stats.tagged.Merge(tags));
+	Prometheus::Write(buffer, process, listener,
+			  stats.per_generator.Merge(generators));
 }
 
 } // namespace Prometheus
@@ -56,6 +69,13 @@ BpPrometheusExporter::HandleHttpRequest(IncomingHttpRequest &request,
 	constexpr auto process = "bp"sv;
 	buffer.Write(ToPrometheusString(instance.event_loop.GetStats(), process));
 	Prometheus::Write(buffer, process, instance.GetStats());
+	Prometheus::Write(buffer, process, GetThreadSocketFilterStats());
+
+	if (const auto *worker_pool = worker_pool_get_existing()) {
+		WorkerPoolStats stats;
+		worker_pool->GetStats(stats);
+		Prometheus::Write(buffer, process, stats);
+	}
 
 	if (instance.spawn) {
 		Prometheus::Write(buffer, process, instance.spawn->GetTerminatorStats());
@@ -63,7 +83,15 @@ BpPrometheusExporter::HandleHttpRequest(IncomingHttpRequest &request,
 	}
 
 	for (const auto &[name, stats] : instance.listener_stats)
-		Prometheus::Write(buffer, process, name, stats);
+		Prometheus::Write(buffer, process, name, stats,
+				  instance.stats_tags,
+				  instance.stats_generators);
+
+	if (instance.auto_compress_policy)
+		Prometheus::Write(buffer, process, instance.auto_compress_policy->GetStats());
+
+	if (instance.config.pool_profiler != PoolProfilerMode::DISABLED)
+		Prometheus::Write(buffer, process, pool_profiler_get_stats());
 
 	if (instance.tcp_stock != nullptr || instance.fs_stock) {
 		StockStats stats{};
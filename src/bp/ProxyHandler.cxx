@@ -78,6 +78,10 @@ Request::HandleProxyAddress() noexcept
 
 	collect_cookies = tr.response_header_forward.IsCookieMangle();
 
+	/* let the client fetch subresources while we wait for the
+	   backend */
+	MaybeSendEarlyHints();
+
 	auto &rl = tr.uncached
 		? *instance.direct_resource_loader
 		: *instance.cached_resource_loader;
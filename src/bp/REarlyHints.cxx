@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Request.hxx"
+#include "Instance.hxx"
+#include "EarlyHintsCache.hxx"
+#include "http/CommonHeaders.hxx"
+#include "http/IncomingRequest.hxx"
+#include "http/Method.hxx"
+#include "http/Status.hxx"
+#include "strmap.hxx"
+#include "AllocatorPtr.hxx"
+
+using std::string_view_literals::operator""sv;
+
+std::string_view
+Request::GetEarlyHintsKey() const noexcept
+{
+	const AllocatorPtr alloc{pool};
+	return alloc.Concat(GetExternalUriHost(*translate.response),
+			    request.uri);
+}
+
+void
+Request::MaybeSendEarlyHints() noexcept
+{
+	auto *cache = instance.early_hints_cache.get();
+	if (cache == nullptr || request.method != HttpMethod::GET)
+		return;
+
+	if (const auto link = cache->Get(GetEarlyHintsKey()); !link.empty())
+		request.SendEarlyHints(link);
+}
+
+inline bool
+Request::HasUserState() const noexcept
+{
+	return session_id.IsDefined() || user != nullptr ||
+		request.headers.Contains(authorization_header) ||
+		request.headers.Contains(cookie_header);
+}
+
+void
+Request::LearnEarlyHints(HttpStatus status,
+			 const StringMap &response_headers) noexcept
+{
+	auto *cache = instance.early_hints_cache.get();
+	if (cache == nullptr || request.method != HttpMethod::GET ||
+	    status != HttpStatus::OK)
+		return;
+
+	/* the learned links are sent to all clients; don't learn
+	   from responses which may be specific to this user */
+	if (HasUserState() || !IsEarlyHintsSharable(response_headers))
+		return;
+
+	const char *link = response_headers.Get(link_header);
+	cache->Put(GetEarlyHintsKey(), link != nullptr ? link : ""sv);
+}
@@ -54,7 +54,7 @@ BpRequestLogger::LogHttpRequest(IncomingHttpRequest &request,
 				       duration);
 
 	http_stats.AddRequest(stats_tag,
-			      generator != nullptr ? std::string_view{generator} : std::string_view{},
+			      generator_id,
 			      status,
 			      bytes_received, bytes_sent,
 			      duration);
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "http/Logger.hxx"
+#include "stats/TagRegistry.hxx"
 #include "time/RequestClock.hxx"
 #include "util/SharedLease.hxx"
 #include "util/TokenBucket.hxx"
@@ -54,9 +55,15 @@ struct BpRequestLogger final : IncomingHttpRequestLogger {
 	const char *generator = nullptr;
 
 	/**
-	 * From TranslationCommand::STATS_TAG
+	 * The #generator, interned in BpInstance::stats_generators.
 	 */
-	std::string_view stats_tag{};
+	StatsTagId generator_id = 0;
+
+	/**
+	 * From TranslationCommand::STATS_TAG, interned in
+	 * BpInstance::stats_tags.
+	 */
+	StatsTagId stats_tag = 0;
 
 	const bool send_backend_errors;
 
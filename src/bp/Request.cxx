@@ -4,6 +4,7 @@
 
 #include "Request.hxx"
 #include "Precompressed.hxx"
+#include "ModAuthEasy.hxx"
 #include "Connection.hxx"
 #include "Config.hxx"
 #include "Listener.hxx"
@@ -49,6 +49,7 @@ class Widget;
 class SessionLease;
 class RealmSessionLease;
 class UringGlue;
+class StaticFileCacheItem;
 namespace Co { template<typename T> class Task; }
 
 /*
@@ -317,6 +318,27 @@ private:
 			struct Precompressed;
 			UniquePoolPtr<Precompressed> precompressed;
 
+			/**
+			 * State of an asynchronous credential check
+			 * of the mod_auth_easy emulation.
+			 */
+			struct ModAuthEasy;
+			UniquePoolPtr<ModAuthEasy> mod_auth_easy;
+
+			/**
+			 * If not nullptr, then the file may be added
+			 * to the #StaticFileCache under this
+			 * (absolute) path after it has been opened.
+			 */
+			std::string_view static_file_cache_path;
+
+			/**
+			 * Was the file opened with RESOLVE_BENEATH?
+			 * Only valid if #static_file_cache_path is
+			 * set.
+			 */
+			bool static_file_cache_beneath;
+
 			using OpenBaseCallback = void (Request:: *)(FileDescriptor fd, std::string_view strip_base) noexcept;
 			OpenBaseCallback open_base_callback;
 
@@ -624,6 +646,15 @@ private:
 			  const struct statx &st, SharedLease &&lease,
 			  const struct file_request &file_request) noexcept;
 
+	/**
+	 * May the response for this file be served from (and stored
+	 * in) the #StaticFileCache?
+	 */
+	[[gnu::pure]]
+	bool IsStaticFileCacheable(const FileAddress &address) const noexcept;
+
+	void DispatchCachedFile(StaticFileCacheItem &item) noexcept;
+
 	bool DispatchCompressedFile(const char *path,
 				    const struct statx &st,
 				    std::string_view encoding,
@@ -635,11 +666,39 @@ private:
 	bool CheckAutoCompressedFile(const char *path, std::string_view encoding,
 				     std::string_view suffix) noexcept;
 
+	/**
+	 * @return true if the request has been handled (or if
+	 * handling continues asynchronously)
+	 */
 	bool EmulateModAuthEasy(const FileAddress &address,
 				FileDescriptor fd,
 				const struct statx &st,
 				SharedLease &lease) noexcept;
 
+	/**
+	 * Check the "~#" header in the first line of a HTML file.
+	 *
+	 * @return true if the request has been handled (or if
+	 * handling continues asynchronously)
+	 */
+	bool CheckModAuthEasyHtml(const FileAddress &address,
+				  FileDescriptor fd,
+				  const struct statx &st,
+				  SharedLease &lease) noexcept;
+
+	void DispatchModAuthEasyHtml(const FileAddress &address,
+				     FileDescriptor fd,
+				     const struct statx &st,
+				     SharedLease &&lease) noexcept;
+
+public:
+	void OnModAuthEasyCheck(bool granted) noexcept;
+
+private:
+
+	[[gnu::pure]]
+	bool NeedsModAuthEasy(const FileAddress &address) const noexcept;
+
 	bool MaybeEmulateModAuthEasy(const FileAddress &address,
 				     FileDescriptor fd,
 				     const struct statx &st,
@@ -651,6 +710,10 @@ private:
 			       FileDescriptor fd,
 			       const struct statx &st,
 			       SharedLease &&lease) noexcept;
+	void HandleFileAddressAfterAuth(const FileAddress &address,
+					FileDescriptor fd,
+					const struct statx &st,
+					SharedLease &&lease) noexcept;
 
 	void OnStatOpenStatSuccess(FileDescriptor fd, const struct statx &st, SharedLease &&lease) noexcept;
 	void OnStatOpenStatError(int error) noexcept;
@@ -677,6 +740,38 @@ private:
 	 */
 	void HandleProxyAddress() noexcept;
 
+	/**
+	 * Build the #EarlyHintsCache key for this request.
+	 */
+	[[gnu::pure]]
+	std::string_view GetEarlyHintsKey() const noexcept;
+
+	/**
+	 * Send a "103 Early Hints" response with the preload links
+	 * which were learned from an earlier response to this
+	 * resource (if the #EarlyHintsCache is enabled).
+	 */
+	void MaybeSendEarlyHints() noexcept;
+
+	/**
+	 * Does this request carry session or authentication state,
+	 * i.e. may the response depend on the user?
+	 */
+	[[gnu::pure]]
+	bool HasUserState() const noexcept;
+
+	/**
+	 * Remember the preload links of this response for
+	 * MaybeSendEarlyHints().  Responses which may depend on the
+	 * user are ignored.
+	 *
+	 * @param response_headers the response headers as received
+	 * from the backend (before Set-Cookie may have been consumed
+	 * by the session)
+	 */
+	void LearnEarlyHints(HttpStatus status,
+			     const StringMap &response_headers) noexcept;
+
 	/**
 	 * Handle the request by forwarding it to the given address.
 	 */
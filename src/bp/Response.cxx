@@ -11,6 +11,7 @@
 #include "Connection.hxx"
 #include "PendingResponse.hxx"
 #include "Instance.hxx"
+#include "AutoCompressPolicy.hxx"
 #include "ClassifyMimeType.hxx"
 #include "http/CommonHeaders.hxx"
 #include "http/IncomingRequest.hxx"
@@ -43,7 +44,7 @@
 #include "translation/Transformation.hxx"
 #include "translation/Service.hxx"
 #include "http/Address.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "co/Task.hxx"
 #include "uri/Relocate.hxx"
 #include "uri/Verify.hxx"
@@ -135,29 +136,6 @@ GetEncodingCacheKey(AllocatorPtr alloc,
 	return StringWithHash{nullptr};
 }
 
-static void
-MaybeCacheEncoded(EncodingCache *cache, AllocatorPtr alloc,
-		  StringWithHash resource_tag,
-		  std::string_view encoding,
-		  const HttpHeaders &response_headers,
-		  UnusedIstreamPtr &response_body) noexcept
-{
-	if (cache == nullptr)
-		return;
-
-	const auto key = GetEncodingCacheKey(alloc, resource_tag, encoding,
-					     response_headers);
-	if (key.IsNull())
-		return;
-
-	if (auto encoded = cache->Get(alloc.GetPool(), key)) {
-		response_body = std::move(encoded);
-		return;
-	}
-
-	response_body = cache->Put(alloc.GetPool(), key, std::move(response_body));
-}
-
 [[gnu::pure]]
 static bool
 IsTextMimeType(const HttpHeaders &response_headers) noexcept
@@ -173,8 +151,27 @@ IsShorterThan(const UnusedIstreamPtr &i, uint_least64_t length) noexcept
 	return il.exhaustive && il.length < length;
 }
 
+[[gnu::pure]]
+static int_least64_t
+GetKnownLength(const UnusedIstreamPtr &i) noexcept
+{
+	const auto il = i.GetLength();
+	return il.exhaustive ? static_cast<int_least64_t>(il.length) : -1;
+}
+
+/**
+ * Compress the response body with the given encoding if the client
+ * accepts it.  The #EncodingCache is consulted first; only if a new
+ * encoder needs to be created, the #AutoCompressPolicy is asked for
+ * a level.
+ *
+ * @return true if no other encoding shall be tried (because the
+ * body was compressed or because the policy decided to send it
+ * uncompressed)
+ */
 static bool
 MaybeAutoCompress(EncodingCache *cache, AllocatorPtr alloc,
+		  AutoCompressPolicy *policy,
 		  const StringMap &request_headers,
 		  StringWithHash resource_tag,
 		  HttpHeaders &response_headers,
@@ -187,12 +184,42 @@ MaybeAutoCompress(EncodingCache *cache, AllocatorPtr alloc,
 	if (!http_client_accepts_encoding(request_headers, encoding))
 		return false;
 
+	const auto key = cache != nullptr
+		? GetEncodingCacheKey(alloc, resource_tag, encoding,
+				      response_headers)
+		: StringWithHash{nullptr};
+
+	UnusedIstreamPtr encoded;
+	if (!key.IsNull())
+		encoded = cache->Get(alloc.GetPool(), key);
+
+	auto level = AutoCompressLevel::MEDIUM;
+	if (!encoded && policy != nullptr) {
+		level = policy->Choose(GetKnownLength(response_body));
+		if (level == AutoCompressLevel::NONE)
+			/* the worker threads are saturated; sending the
+			   response uncompressed is cheaper than letting
+			   it wait in the queue */
+			return true;
+	}
+
 	response_headers.contains_content_encoding = true;
 	response_headers.Write("content-encoding", encoding);
-	response_body = factory(std::move(response_body));
 
-	MaybeCacheEncoded(cache, alloc, resource_tag, encoding,
-			  response_headers, response_body);
+	if (encoded) {
+		response_body = std::move(encoded);
+		return true;
+	}
+
+	response_body = factory(level, std::move(response_body));
+
+	/* output of a reduced level is not stored, or it would
+	   still be served long after the load spike is over */
+	if (!key.IsNull() && level >= AutoCompressLevel::MEDIUM)
+		response_body = cache->Put(alloc.GetPool(), key, encoding,
+					   IsTextMimeType(response_headers),
+					   std::move(response_body));
+
 	return true;
 }
 
@@ -200,31 +227,35 @@ inline void
 Request::ApplyAutoCompress(HttpHeaders &response_headers,
 			   UnusedIstreamPtr &response_body) noexcept
 {
+	auto *const policy = instance.auto_compress_policy.get();
+
 #ifdef HAVE_BROTLI
 	if ((translate.response->auto_brotli ||
 	     translate.auto_brotli) &&
-	    MaybeAutoCompress(instance.encoding_cache.get(), pool,
+	    MaybeAutoCompress(instance.encoding_cache.get(), pool, policy,
 			      request.headers,
 			      resource_tag,
 			      response_headers, response_body, "br"sv,
-			      [this, &response_headers](auto &&i){
+			      [this, &response_headers](AutoCompressLevel level, auto &&i){
 				      return NewBrotliEncoderIstream(pool,
-								     thread_pool_get_queue(instance.event_loop),
+								     worker_pool_get(instance.event_loop),
 								     std::move(i),
-								     {.text_mode = IsTextMimeType(response_headers)});
+								     AutoCompressPolicy::ToBrotliParams(level,
+													IsTextMimeType(response_headers)));
 			      }))
 		return;
 #endif
 
 	if (translate.response->auto_gzip)
-		MaybeAutoCompress(instance.encoding_cache.get(), pool,
+		MaybeAutoCompress(instance.encoding_cache.get(), pool, policy,
 				  request.headers,
 				  resource_tag,
 				  response_headers, response_body, "gzip"sv,
-				  [this](auto &&i){
+				  [this](AutoCompressLevel level, auto &&i){
 					  return NewGzipIstream(pool,
-								thread_pool_get_queue(instance.event_loop),
-								std::move(i));
+								worker_pool_get(instance.event_loop),
+								std::move(i),
+								AutoCompressPolicy::ToGzipParams(level));
 				  });
 }
 
@@ -290,6 +321,7 @@ Request::NewWidgetContext() const noexcept
 	ctx->peer_subject = connection.peer_subject;
 	ctx->peer_issuer_subject = connection.peer_issuer_subject;
 	ctx->user = user;
+	ctx->fragment_cache = instance.widget_fragment_cache.get();
 
 	return ctx;
 }
@@ -1058,13 +1090,17 @@ Request::OnHttpResponse(HttpStatus status, StringMap &&_headers,
 	if (generator == nullptr)
 		/* if there is a GENERATOR header, include it in the
 		   access log */
-		if (const auto *generator_header = headers.Get(x_cm4all_generator_header))
+		if (const auto *generator_header = headers.Get(x_cm4all_generator_header)) {
 			rl.generator = generator_header;
+			rl.generator_id = instance.stats_generators.Intern(generator_header);
+		}
 
 	auto new_headers = ForwardResponseHeaders(status, headers,
 						  RelocateCallback, this,
 						  translate.response->response_header_forward);
 
+	LearnEarlyHints(status, headers);
+
 	if (generator != nullptr &&
 	    identity_forward == BengProxy::HeaderForwardMode::MANGLE)
 		/* the GENERATOR value from the translation server
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "StaticFileCache.hxx"
+#include "file/Headers.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "istream/SharedLeaseIstream.hxx"
+#include "istream/TeeIstream.hxx"
+#include "memory/istream_rubber.hxx"
+#include "memory/sink_rubber.hxx"
+#include "pool/pool.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "event/Loop.hxx"
+#include "io/FileDescriptor.hxx"
+#include "io/Logger.hxx"
+#include "io/linux/ProcPath.hxx"
+#include "util/Cancellable.hxx"
+#include "util/LeakDetector.hxx"
+
+#include <cassert>
+#include <memory>
+#include <utility> // for std::cmp_greater()
+
+#include <fcntl.h> // for AT_EMPTY_PATH
+#include <sys/inotify.h>
+
+/**
+ * Files larger than this are not cached.
+ */
+static constexpr std::size_t cacheable_size_limit = 256 * 1024;
+
+/**
+ * Items expire after this duration even if inotify did not report a
+ * modification, because renaming a parent directory cannot be
+ * detected with the inotify watch on the file.
+ */
+static constexpr std::chrono::steady_clock::duration static_file_cache_expires =
+	std::chrono::minutes(1);
+
+StaticFileCacheItem::StaticFileCacheItem(StaticFileCache &_parent,
+					 StringWithHash key,
+					 bool _beneath, const char *_content_type,
+					 const struct statx &_st,
+					 std::chrono::steady_clock::time_point now) noexcept
+	:StaticFileCacheItemKey(key.value),
+	 CacheItem(StringWithHash{StaticFileCacheItemKey::path, key.hash},
+		   _st.stx_size, now + static_file_cache_expires),
+	 InotifyWatch(_parent.inotify_manager),
+	 parent(_parent),
+	 content_type(_content_type),
+	 headers(file_static_response_headers(_content_type, _st)),
+	 st(_st),
+	 beneath(_beneath) {}
+
+StaticFileCacheItem::~StaticFileCacheItem() noexcept
+{
+	RemoveWatch();
+}
+
+void
+StaticFileCacheItem::OnInotify([[maybe_unused]] unsigned mask,
+			       [[maybe_unused]] const char *name) noexcept
+{
+	assert(!IsWatching()); // it's oneshot
+
+	LogConcat(5, "StaticFileCache", "modified ", path);
+
+	if (!IsRemoved())
+		/* this may delete this object */
+		parent.cache.Remove(*this);
+
+	/* if this item is still being loaded, Store::RubberDone()
+	   will discard it */
+}
+
+/**
+ * Copies the file contents from a #TeeIstream into the #Rubber heap.
+ * Until this finishes, the #Item is owned by this object and is not
+ * yet in the #Cache.
+ */
+class StaticFileCache::Store final
+	: public AutoUnlinkIntrusiveListHook, RubberSinkHandler, LeakDetector
+{
+	static constexpr Event::Duration timeout = std::chrono::minutes(1);
+
+	StaticFileCache &cache;
+
+	std::unique_ptr<Item> item;
+
+	/**
+	 * This event limits the duration for receiving the file
+	 * contents.
+	 */
+	CoarseTimerEvent timeout_event;
+
+	/**
+	 * To cancel the RubberSink.
+	 */
+	CancellablePointer rubber_cancel_ptr;
+
+public:
+	Store(StaticFileCache &_cache, std::unique_ptr<Item> &&_item) noexcept
+		:cache(_cache), item(std::move(_item)),
+		 timeout_event(cache.GetEventLoop(), BIND_THIS_METHOD(OnTimeout)) {}
+
+	/**
+	 * Release resources held by this request.
+	 */
+	void Destroy() noexcept {
+		assert(!rubber_cancel_ptr);
+
+		this->~Store();
+	}
+
+	void Start(struct pool &pool, UnusedIstreamPtr &&src) noexcept {
+		timeout_event.Schedule(timeout);
+
+		sink_rubber_new(pool, std::move(src),
+				cache.rubber, cacheable_size_limit,
+				*this,
+				rubber_cancel_ptr);
+	}
+
+	/**
+	 * Cancel storing the file contents.
+	 */
+	void CancelStore() noexcept {
+		assert(rubber_cancel_ptr);
+
+		rubber_cancel_ptr.Cancel();
+		Destroy();
+	}
+
+private:
+	void Skip(const char *reason) noexcept {
+		LogConcat(4, "StaticFileCache", "nocache ", reason, " ",
+			  item->GetKey().value);
+		++cache.stats.skips;
+		Destroy();
+	}
+
+	void OnTimeout() noexcept {
+		/* reading the file has taken too long already; don't
+		   store it */
+		rubber_cancel_ptr.Cancel();
+		Skip("timeout");
+	}
+
+	/* virtual methods from class RubberSinkHandler */
+	void RubberDone(RubberAllocation &&a, std::size_t size) noexcept override {
+		rubber_cancel_ptr = nullptr;
+
+		if (!item->IsWatching()) {
+			/* the file was modified while we were
+			   reading it */
+			Skip("modified");
+			return;
+		}
+
+		if (size != item->GetSize()) {
+			Skip("size mismatch");
+			return;
+		}
+
+		cache.Add(*item.release(), std::move(a));
+		Destroy();
+	}
+
+	void RubberOutOfMemory() noexcept override {
+		rubber_cancel_ptr = nullptr;
+		Skip("oom");
+	}
+
+	void RubberTooLarge() noexcept override {
+		rubber_cancel_ptr = nullptr;
+		Skip("too large");
+	}
+
+	void RubberError(std::exception_ptr ep) noexcept override {
+		rubber_cancel_ptr = nullptr;
+
+		LogConcat(4, "StaticFileCache", "body_error ",
+			  item->GetKey().value, ": ", ep);
+		++cache.stats.skips;
+		Destroy();
+	}
+};
+
+StaticFileCache::StaticFileCache(EventLoop &event_loop, std::size_t max_size)
+	:inotify_manager(event_loop),
+	 rubber(max_size, "static_file_cache"),
+	 /* leave 12.5% of the rubber allocator empty, to increase the
+	    chances that a hole can be found for a new allocation, to
+	    reduce the pressure that rubber_compress() creates */
+	 cache(event_loop, max_size * 7 / 8),
+	 compress_timer(event_loop, BIND_THIS_METHOD(OnCompressTimer))
+{
+	compress_timer.Schedule(compress_interval);
+}
+
+StaticFileCache::~StaticFileCache() noexcept
+{
+	stores.clear_and_dispose([](auto *r){ r->CancelStore(); });
+}
+
+void
+StaticFileCache::BeginShutdown() noexcept
+{
+	stores.clear_and_dispose([](auto *r){ r->CancelStore(); });
+
+	compress_timer.Cancel();
+	inotify_manager.BeginShutdown();
+
+	cache.Flush();
+}
+
+StaticFileCacheItem *
+StaticFileCache::Get(std::string_view path, bool beneath,
+		     const char *content_type) noexcept
+{
+	auto *item = static_cast<Item *>(cache.Get(StringWithHash{path}));
+	if (item == nullptr || !item->Match(beneath, content_type)) {
+		++stats.misses;
+		return nullptr;
+	}
+
+	++stats.hits;
+	return item;
+}
+
+UnusedIstreamPtr
+StaticFileCache::NewIstream(struct pool &pool, Item &item,
+			    std::size_t start, std::size_t end) noexcept
+{
+	assert(start <= end);
+	assert(end <= item.GetSize());
+
+	return NewSharedLeaseIstream(pool,
+				     istream_rubber_new(pool, rubber, item.allocation.GetId(),
+							start, end, false),
+				     item);
+}
+
+/**
+ * Check whether the file referred to by the descriptor still matches
+ * the given statx() (which may have been cached for a while by
+ * #FdCache) and has not been deleted.
+ */
+static bool
+IsUnmodified(FileDescriptor fd, const struct statx &st) noexcept
+{
+	struct statx now;
+	if (statx(fd.Get(), "", AT_EMPTY_PATH,
+		  STATX_NLINK|STATX_INO|STATX_MTIME|STATX_SIZE, &now) < 0)
+		return false;
+
+	return now.stx_nlink > 0 &&
+		now.stx_ino == st.stx_ino &&
+		now.stx_size == st.stx_size &&
+		now.stx_mtime.tv_sec == st.stx_mtime.tv_sec &&
+		now.stx_mtime.tv_nsec == st.stx_mtime.tv_nsec;
+}
+
+UnusedIstreamPtr
+StaticFileCache::Put(struct pool &pool,
+		     std::string_view path, bool beneath,
+		     const char *content_type,
+		     FileDescriptor fd, const struct statx &st,
+		     UnusedIstreamPtr src) noexcept
+{
+	assert(content_type != nullptr);
+
+	if (st.stx_size == 0 ||
+	    std::cmp_greater(st.stx_size, cacheable_size_limit)) {
+		++stats.skips;
+		return src;
+	}
+
+	auto item = std::make_unique<Item>(*this, StringWithHash{path},
+					   beneath, content_type, st,
+					   cache.SteadyNow());
+
+	/* watch the inode which is actually being read (and not
+	   whatever the path refers to now); IN_ATTRIB catches
+	   unlink() and rename() over the file because they modify the
+	   link count; IN_MASK_CREATE fails if this inode is already
+	   being watched (e.g. by a concurrent store) */
+	if (!item->TryAddWatch(ProcFdPath(fd),
+			       IN_ONESHOT|IN_MASK_CREATE|
+			       IN_MODIFY|IN_ATTRIB|IN_DELETE_SELF|IN_MOVE_SELF)) {
+		++stats.skips;
+		return src;
+	}
+
+	/* the given statx may be stale; now that the watch is
+	   registered, verify that nothing has happened to the file
+	   before */
+	if (!IsUnmodified(fd, st)) {
+		LogConcat(4, "StaticFileCache", "nocache stale ", path);
+		++stats.skips;
+		return src;
+	}
+
+	LogConcat(4, "StaticFileCache", "put ", path);
+
+	/* tee the file contents: one goes to our client, and one goes
+	   into the cache */
+	src = NewTeeIstream(pool, std::move(src),
+			    GetEventLoop(),
+			    false, false);
+
+	auto store = NewFromPool<Store>(pool, *this, std::move(item));
+	stores.push_back(*store);
+
+	store->Start(pool, AddTeeIstream(src, true));
+
+	return src;
+}
+
+void
+StaticFileCache::Add(Item &item, RubberAllocation &&a) noexcept
+{
+	LogConcat(4, "StaticFileCache", "add ", item.GetKey().value);
+	++stats.stores;
+
+	item.allocation = std::move(a);
+
+	cache.Put(item);
+}
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "cache/Cache.hxx"
+#include "cache/Item.hxx"
+#include "stats/CacheStats.hxx"
+#include "memory/Rubber.hxx"
+#include "event/FarTimerEvent.hxx"
+#include "event/InotifyManager.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h> // for struct statx
+
+struct pool;
+class UnusedIstreamPtr;
+class FileDescriptor;
+class StaticFileCache;
+
+class StaticFileCacheItemKey {
+protected:
+	const std::string path;
+
+public:
+	[[nodiscard]]
+	explicit StaticFileCacheItemKey(std::string_view _path) noexcept
+		:path(_path) {}
+};
+
+/**
+ * An item in the #StaticFileCache.
+ */
+class StaticFileCacheItem final : StaticFileCacheItemKey, public CacheItem, public InotifyWatch {
+	friend class StaticFileCache;
+
+	StaticFileCache &parent;
+
+	const std::string content_type;
+
+	/**
+	 * The precomputed response headers.
+	 */
+	const std::string headers;
+
+	struct statx st;
+
+	RubberAllocation allocation;
+
+	/**
+	 * Was the file opened with RESOLVE_BENEATH?  An item loaded
+	 * without it must not be used for a request which requires
+	 * it.
+	 */
+	const bool beneath;
+
+public:
+	StaticFileCacheItem(StaticFileCache &_parent, StringWithHash key,
+			    bool _beneath, const char *_content_type,
+			    const struct statx &_st,
+			    std::chrono::steady_clock::time_point now) noexcept;
+
+	~StaticFileCacheItem() noexcept;
+
+	const struct statx &GetStatx() const noexcept {
+		return st;
+	}
+
+	std::string_view GetHeaders() const noexcept {
+		return headers;
+	}
+
+private:
+	[[gnu::pure]]
+	bool Match(bool _beneath,
+		   std::string_view _content_type) const noexcept {
+		return beneath == _beneath &&
+			content_type == _content_type;
+	}
+
+	/* virtual methods from class CacheItem */
+	bool Validate() const noexcept override {
+		/* the inotify watch is oneshot; if it has fired,
+		   this item is stale */
+		return IsWatching();
+	}
+
+	void Destroy() noexcept override {
+		delete this;
+	}
+
+	/* virtual methods from class InotifyWatch */
+	void OnInotify(unsigned mask, const char *name) noexcept override;
+};
+
+/**
+ * A cache for the contents of small static files which are requested
+ * frequently.  It allows serving them from memory without consulting
+ * #FdCache and without reading from the file again.
+ *
+ * Items are stored in a #Rubber heap and are evicted in LRU order.
+ * Each item watches the inode it was read from with inotify and is
+ * removed as soon as the file gets modified, deleted, renamed or
+ * replaced.  Additionally, items expire after a while because
+ * renaming a parent directory cannot be detected.
+ *
+ * The response headers which depend only on the file
+ * ("Last-Modified", "ETag", "Content-Type") are generated only once
+ * per item.
+ */
+class StaticFileCache final {
+	static constexpr Event::Duration compress_interval = std::chrono::minutes(10);
+
+	InotifyManager inotify_manager;
+
+	Rubber rubber;
+	Cache cache;
+
+	FarTimerEvent compress_timer;
+
+	class Store;
+
+	IntrusiveList<Store> stores;
+
+	mutable CacheStats stats{};
+
+	friend class StaticFileCacheItem;
+
+public:
+	using Item = StaticFileCacheItem;
+
+	StaticFileCache(EventLoop &event_loop, std::size_t max_size);
+	~StaticFileCache() noexcept;
+
+	auto &GetEventLoop() const noexcept {
+		return inotify_manager.GetEventLoop();
+	}
+
+	void ForkCow(bool inherit) noexcept {
+		rubber.ForkCow(inherit);
+	}
+
+	CacheStats GetStats() const noexcept {
+		stats.allocator = rubber.GetStats();
+		cache.FillStats(stats);
+		return stats;
+	}
+
+	void Flush() noexcept {
+		cache.Flush();
+		Compress();
+	}
+
+	/**
+	 * Initiate shutdown.  This cancels all pending stores,
+	 * unregisters all #EventLoop events and prevents new ones
+	 * from getting registered.
+	 */
+	void BeginShutdown() noexcept;
+
+	/**
+	 * Look up a file.  The returned pointer is only valid until
+	 * the caller returns to the #EventLoop; pass it to
+	 * NewIstream() to keep using it.
+	 *
+	 * @param path the absolute path of the file
+	 * @param beneath was the file opened with RESOLVE_BENEATH?
+	 * @param content_type the "Content-Type" response header
+	 * @return the item or nullptr on cache miss
+	 */
+	Item *Get(std::string_view path, bool beneath,
+		  const char *content_type) noexcept;
+
+	/**
+	 * Create an #Istream which reads a portion of the item's
+	 * contents.  The item is kept alive until the #Istream is
+	 * closed.
+	 */
+	UnusedIstreamPtr NewIstream(struct pool &pool, Item &item,
+				    std::size_t start,
+				    std::size_t end) noexcept;
+
+	/**
+	 * Copy the contents of an opened file into the cache while it
+	 * is being sent to the client.
+	 *
+	 * @param fd the file descriptor which #src reads from; it is
+	 * used to register the inotify watch on the very same inode
+	 * @param st the statx() of #fd; it must contain at least
+	 * STATX_INO, STATX_MTIME and STATX_SIZE
+	 * @param src an #Istream which reads the whole file
+	 * @return the #Istream to be sent to the client
+	 */
+	UnusedIstreamPtr Put(struct pool &pool,
+			     std::string_view path, bool beneath,
+			     const char *content_type,
+			     FileDescriptor fd, const struct statx &st,
+			     UnusedIstreamPtr src) noexcept;
+
+private:
+	void Add(Item &item, RubberAllocation &&a) noexcept;
+
+	void Compress() noexcept {
+		rubber.Compress();
+	}
+
+	void OnCompressTimer() noexcept {
+		Compress();
+		compress_timer.Schedule(compress_interval);
+	}
+};
@@ -4,6 +4,8 @@
 
 #include "Instance.hxx"
 #include "Listener.hxx"
+#include "StaticFileCache.hxx"
+#include "widget/FragmentCache.hxx"
 #include "prometheus/Stats.hxx"
 #include "fs/Stock.hxx"
 #include "stock/Stats.hxx"
@@ -34,21 +36,33 @@ BpInstance::GetStats() const noexcept
 
 	stats.outgoing_connections = tcp_stock_stats.busy + tcp_stock_stats.idle;
 	stats.sessions = session_manager->Count();
-	stats.http_requests = http_stats.n_requests;
-	stats.http_traffic_received = http_stats.traffic_received;
-	stats.http_traffic_sent = http_stats.traffic_sent;
+
+	const auto merged_http_stats = http_stats.Merge();
+	stats.http_requests = merged_http_stats.n_requests;
+	stats.http_traffic_received = merged_http_stats.traffic_received;
+	stats.http_traffic_sent = merged_http_stats.traffic_sent;
 
 	if (translation_caches)
 		stats.translation_cache = translation_caches->GetStats();
 
-	if (http_cache != nullptr)
+	if (http_cache != nullptr) {
 		stats.http_cache = http_cache_get_stats(*http_cache);
+		stats.http_cache_key = http_cache_get_key_stats(*http_cache);
+	}
 
 	if (filter_cache != nullptr)
 		stats.filter_cache = filter_cache_get_stats(*filter_cache);
 
-	if (encoding_cache)
+	if (encoding_cache) {
 		stats.encoding_cache = encoding_cache->GetStats();
+		stats.encoding_cache_recompressed = encoding_cache->GetRecompressCount();
+	}
+
+	if (static_file_cache)
+		stats.static_file_cache = static_file_cache->GetStats();
+
+	if (widget_fragment_cache)
+		stats.widget_fragment_cache = widget_fragment_cache->GetStats();
 
 	stats.io_buffers = fb_pool_get().GetStats();
 
@@ -4,17 +4,66 @@
 
 #include "Manager.hxx"
 #include "Lease.hxx"
+#include "SharedStore.hxx"
+#include "Read.hxx"
+#include "Write.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "io/BufferedReader.hxx"
 #include "io/Logger.hxx"
+#include "io/OutputStream.hxx"
+#include "io/Reader.hxx"
 #include "system/Seed.hxx"
 #include "util/DeleteDisposer.hxx"
 #include "util/SpanCast.hxx"
 #include "util/StaticVector.hxx"
 #include "util/PrintException.hxx"
 
+#include <algorithm> // for std::copy_n()
 #include <cassert>
+#include <cstring> // for std::memcpy()
+#include <vector>
 
 static constexpr unsigned MAX_SESSIONS = 65536;
 
+namespace {
+
+/**
+ * Serializes into a std::vector for the #SharedSessionStore.
+ */
+class VectorOutputStream final : public OutputStream {
+	std::vector<std::byte> &dest;
+
+public:
+	explicit VectorOutputStream(std::vector<std::byte> &_dest) noexcept
+		:dest(_dest) {}
+
+	/* virtual methods from class OutputStream */
+	void Write(std::span<const std::byte> src) override {
+		dest.insert(dest.end(), src.begin(), src.end());
+	}
+};
+
+/**
+ * Deserializes a record from the #SharedSessionStore.
+ */
+class SpanReader final : public Reader {
+	std::span<const std::byte> src;
+
+public:
+	explicit SpanReader(std::span<const std::byte> _src) noexcept
+		:src(_src) {}
+
+	/* virtual methods from class Reader */
+	std::size_t Read(std::span<std::byte> dest) override {
+		const std::size_t n = std::min(src.size(), dest.size());
+		std::copy_n(src.begin(), n, dest.begin());
+		src = src.subspan(n);
+		return n;
+	}
+};
+
+} // anonymous namespace
+
 inline const SessionId &
 SessionManager::SessionGetId::operator()(const Session &session) const noexcept
 {
@@ -76,6 +125,12 @@ SessionManager::SessionManager(EventLoop &event_loop,
 {
 }
 
+void
+SessionManager::OpenSharedStore(const char *path, std::size_t size)
+{
+	shared_store = std::make_unique<SharedSessionStore>(path, size);
+}
+
 void
 SessionManager::SeedPrng()
 {
@@ -168,7 +223,118 @@ SessionManager::CreateSession() noexcept
 
 	Session *session = new Session(GenerateSessionId(), csrf_salt);
 	Insert(*session);
-	return {*this, session};
+	return MakeLease(*session);
+}
+
+inline SessionLease
+SessionManager::MakeLease(Session &session) noexcept
+{
+	++session.n_leases;
+	return {*this, &session};
+}
+
+Session *
+SessionManager::LoadShared(SessionId id, Session *local) noexcept
+{
+	assert(shared_store);
+
+	const auto now = std::chrono::steady_clock::now();
+
+	if (local != nullptr) {
+		if (local->n_leases > 0)
+			/* somebody in this process is using the
+			   session right now; it must not be replaced,
+			   and the local copy is the most recent one
+			   anyway */
+			return local;
+
+		const auto hash = shared_store->GetHash(id, now);
+		if (hash == 0 || hash == local->shared_hash)
+			/* the local copy is up to date (or the
+			   shared record is gone) */
+			return local;
+	}
+
+	std::vector<std::byte> record;
+	const auto hash = shared_store->Get(id, now, record);
+	if (hash == 0 || record.size() < sizeof(SessionId))
+		return local;
+
+	/* the CSRF salt is appended to the session_write() record */
+	SessionId csrf_salt;
+	std::memcpy(&csrf_salt, record.data() + record.size() - sizeof(csrf_salt),
+		    sizeof(csrf_salt));
+
+	std::unique_ptr<Session> session;
+
+	try {
+		SpanReader r{std::span{record}.first(record.size() - sizeof(csrf_salt))};
+		BufferedReader br{r};
+		session = session_read(br, csrf_salt);
+	} catch (...) {
+		LogConcat(2, "SessionManager", "Failed to load shared session: ",
+			  std::current_exception());
+		return local;
+	}
+
+	if (session->id != id)
+		return local;
+
+	if (local != nullptr) {
+		local->Replace(std::move(*session));
+		local->shared_hash = hash;
+		return local;
+	}
+
+	if (Count() >= MAX_SESSIONS)
+		Purge();
+
+	session->shared_hash = hash;
+	Session *result = session.release();
+	Insert(*result);
+	return result;
+}
+
+void
+SessionManager::StoreShared(Session &session) noexcept
+{
+	assert(shared_store);
+
+	std::vector<std::byte> record;
+
+	try {
+		VectorOutputStream vos{record};
+		WithBufferedOutputStream(vos, [&session](BufferedOutputStream &bos){
+			session_write(bos, &session);
+			bos.WriteT(session.csrf_salt);
+		});
+	} catch (...) {
+		LogConcat(2, "SessionManager", "Failed to serialize session: ",
+			  std::current_exception());
+		return;
+	}
+
+	/* the id, the expiry and the counter change on every access;
+	   they are excluded from the hash so unmodified sessions
+	   only refresh the expiry of the existing record */
+	const auto hash = SharedSessionStore::CalcHash(record,
+						       session_write_volatile_size());
+
+	if (shared_store->Put(session.id, record, hash,
+			      std::chrono::steady_clock::now() + idle_timeout))
+		session.shared_hash = hash;
+}
+
+inline Session *
+SessionManager::FindLocal(SessionId id) noexcept
+{
+	auto i = sessions.find(id);
+	Session *session = i != sessions.end() ? &*i : nullptr;
+
+	if (shared_store)
+		session = LoadShared(id, session);
+
+	return session;
 }
 
 SessionLease
@@ -177,15 +343,13 @@ SessionManager::Find(SessionId id) noexcept
 	if (!id.IsDefined())
 		return nullptr;
 
-	auto i = sessions.find(id);
-	if (i == sessions.end())
+	Session *session = FindLocal(id);
+	if (session == nullptr)
 		return nullptr;
 
-	Session &session = *i;
-
-	session.expires.Touch(idle_timeout);
-	++session.counter;
-	return {*this, &session};
+	session->expires.Touch(idle_timeout);
+	++session->counter;
+	return MakeLease(*session);
 }
 
 RealmSessionLease
@@ -236,22 +400,30 @@ SessionManager::Attach(RealmSessionLease lease, std::string_view realm,
 			   existing session */
 			existing.Attach(std::move(src));
 
+			if (shared_store)
+				shared_store->Remove(src.id);
 			EraseAndDispose(src);
 		}
 
-		return {SessionLease{*this, &existing}, realm};
+		return {MakeLease(existing), realm};
 	}
 }
 
 void
 SessionManager::Put(Session &session) noexcept
 {
-	(void)session;
+	assert(session.n_leases > 0);
+
+	if (--session.n_leases == 0 && shared_store)
+		StoreShared(session);
 }
 
 void
 SessionManager::EraseAndDispose(SessionId id) noexcept
 {
+	if (shared_store)
+		shared_store->Remove(id);
+
 	auto i = sessions.find(id);
 	if (i != sessions.end())
 		EraseAndDispose(*i);
@@ -260,15 +432,19 @@ SessionManager::EraseAndDispose(SessionId id) noexcept
 void
 SessionManager::DiscardRealmSession(SessionId id, std::string_view realm_name) noexcept
 {
-	auto i = sessions.find(id);
-	if (i == sessions.end())
+	Session *session = FindLocal(id);
+	if (session == nullptr)
 		return;
 
-	if (!i->DiscardRealm(realm_name))
+	if (!session->DiscardRealm(realm_name))
 		return;
 
-	if (i->realms.empty())
-		EraseAndDispose(*i);
+	if (session->realms.empty()) {
+		if (shared_store)
+			shared_store->Remove(id);
+		EraseAndDispose(*session);
+	} else if (shared_store && session->n_leases == 0)
+		StoreShared(*session);
 }
 
 void
@@ -287,6 +463,10 @@ void
 SessionManager::DiscardAttachSession(std::span<const std::byte> attach) noexcept
 {
 	auto i = sessions_by_attach.find(attach);
-	if (i != sessions_by_attach.end())
-		EraseAndDispose(*i);
+	if (i == sessions_by_attach.end())
+		return;
+
+	if (shared_store)
+		shared_store->Remove(i->id);
+	EraseAndDispose(*i);
 }
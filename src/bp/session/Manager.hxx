@@ -11,9 +11,11 @@
 #include "util/TransparentHash.hxx"
 
 #include <chrono>
+#include <memory>
 #include <random>
 
 class SessionId;
+class SharedSessionStore;
 class SessionLease;
 class RealmSessionLease;
 class BufferedReader;
@@ -81,12 +83,25 @@ class SessionManager {
 
 	unsigned reseed_counter = 0;
 
+	/**
+	 * If set, then sessions are shared with other processes
+	 * through this store: modified sessions are written to it
+	 * when their lease is released, and Find() loads sessions
+	 * which are missing or outdated in this process.
+	 */
+	std::unique_ptr<SharedSessionStore> shared_store;
+
 public:
 	SessionManager(EventLoop &event_loop, std::chrono::seconds idle_timeout,
 		       unsigned _cluster_size, unsigned _cluster_node) noexcept;
 
 	~SessionManager() noexcept;
 
+	/**
+	 * Open a #SharedSessionStore.  Throws on error.
+	 */
+	void OpenSharedStore(const char *path, std::size_t size);
+
 	/**
 	 * Re-add all libevent events after DisableEvents().
 	 */
@@ -119,7 +134,6 @@ public:
 	void Visit(void (*callback)(const Session *session,
 				    void *ctx), void *ctx);
 
-	[[gnu::pure]]
 	SessionLease Find(SessionId id) noexcept;
 
 	/**
@@ -169,4 +183,27 @@ private:
 
 	SessionId GenerateSessionId() noexcept;
 	void EraseAndDispose(Session &session);
+
+	SessionLease MakeLease(Session &session) noexcept;
+
+	/**
+	 * Look up a session without touching it.  If there is a
+	 * #SharedSessionStore, a newer copy is loaded from it.
+	 */
+	Session *FindLocal(SessionId id) noexcept;
+
+	/**
+	 * Load the given session from the #SharedSessionStore if it
+	 * is newer than the local copy.
+	 *
+	 * @param local the local copy (or nullptr if there is none)
+	 * @return the up-to-date local session or nullptr if there is
+	 * none
+	 */
+	Session *LoadShared(SessionId id, Session *local) noexcept;
+
+	/**
+	 * Write the given session to the #SharedSessionStore.
+	 */
+	void StoreShared(Session &session) noexcept;
 };
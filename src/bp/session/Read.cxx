@@ -222,16 +222,22 @@ DoReadSession(FileReader &file, Session &session)
 }
 
 std::unique_ptr<Session>
-session_read(BufferedReader &r, SessionPrng &prng)
+session_read(BufferedReader &r, const SessionId &csrf_salt)
 {
 	FileReader file(r);
 	const auto id = file.ReadT<SessionId>();
 
+	auto session = std::make_unique<Session>(id, csrf_salt);
+	DoReadSession(file, *session);
+	return session;
+}
+
+std::unique_ptr<Session>
+session_read(BufferedReader &r, SessionPrng &prng)
+{
 	// TODO read salt from session file
 	SessionId csrf_salt;
 	csrf_salt.Generate(prng);
 
-	auto session = std::make_unique<Session>(id, csrf_salt);
-	DoReadSession(file, *session);
-	return session;
+	return session_read(r, csrf_salt);
 }
@@ -15,6 +15,7 @@
 #include <stdint.h>
 
 struct Session;
+class SessionId;
 class BufferedReader;
 
 class SessionDeserializerError {};
@@ -36,3 +37,12 @@ session_read_file_header(BufferedReader &r);
  */
 std::unique_ptr<Session>
 session_read(BufferedReader &r, SessionPrng &prng);
+
+/**
+ * Like session_read(), but use the given CSRF salt instead of
+ * generating a new one.
+ *
+ * Throws on error.
+ */
+std::unique_ptr<Session>
+session_read(BufferedReader &r, const SessionId &csrf_salt);
@@ -135,6 +135,33 @@ Session::Attach(Session &&other) noexcept
 	}
 }
 
+void
+Session::Replace(Session &&other) noexcept
+{
+	assert(other.id == id);
+
+	expires = other.expires;
+	counter = other.counter;
+	cookie_received = other.cookie_received;
+	translate = std::move(other.translate);
+	language = std::move(other.language);
+
+	realms.clear();
+
+	for (auto &[name, src] : other.realms) {
+		/* construct a new RealmSession with the correct
+		   "parent" reference */
+		auto &dest = realms.try_emplace(name, *this).first->second;
+		dest.site = std::move(src.site);
+		dest.translate = std::move(src.translate);
+		dest.user = std::move(src.user);
+		dest.user_expires = src.user_expires;
+		dest.widgets = std::move(src.widgets);
+		dest.cookies.MoveFrom(std::move(src.cookies));
+		dest.session_cookie_same_site = src.session_cookie_same_site;
+	}
+}
+
 void
 Session::SetTranslate(std::span<const std::byte> _translate) noexcept
 {
@@ -18,6 +18,7 @@
 #include "util/IntrusiveHashSet.hxx"
 
 #include <chrono>
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -194,6 +195,19 @@ struct Session {
 
 	RealmSessionSet realms;
 
+	/**
+	 * The number of #SessionLease instances referring to this
+	 * session.  While this is non-zero, the session must not be
+	 * replaced by a newer copy from the #SharedSessionStore.
+	 */
+	unsigned n_leases = 0;
+
+	/**
+	 * The #SharedSessionStore hash of the record this session was
+	 * most recently loaded from or stored to; 0 if none.
+	 */
+	uint_least64_t shared_hash = 0;
+
 	Session(SessionId _id, SessionId _csrf_salt) noexcept;
 	~Session() noexcept;
 
@@ -229,6 +243,14 @@ struct Session {
 
 	void Attach(Session &&other) noexcept;
 
+	/**
+	 * Replace the serializable state of this session with the one
+	 * of another copy of the same session (which was loaded from
+	 * the #SharedSessionStore).  The "attach" value and the
+	 * external session manager are kept.
+	 */
+	void Replace(Session &&other) noexcept;
+
 	void SetLanguage(const char *_language) noexcept {
 		language = _language;
 	}
@@ -0,0 +1,550 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "SharedStore.hxx"
+#include "Id.hxx"
+#include "system/Error.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <array>
+#include <atomic>
+#include <bit> // for std::bit_cast(), std::bit_floor()
+#include <cassert>
+#include <cstring> // for std::memcpy()
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h> // for flock()
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h> // for ftruncate()
+
+static constexpr uint32_t MAGIC = 0x62707373; // "bpss"
+static constexpr uint32_t VERSION = 1;
+
+/**
+ * How often shall a reader retry if a writer is busy?  After that,
+ * the slot is treated as a miss.
+ */
+static constexpr unsigned MAX_RETRY = 64;
+
+/**
+ * One slot per this number of arena bytes.
+ */
+static constexpr std::size_t ARENA_BYTES_PER_SLOT = 1024;
+
+using SessionKey = std::array<uint64_t, 2>;
+
+static_assert(sizeof(SessionId) == sizeof(SessionKey));
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+[[gnu::const]]
+static SessionKey
+ToKey(const SessionId &id) noexcept
+{
+	return std::bit_cast<SessionKey>(id);
+}
+
+[[gnu::const]]
+static constexpr std::size_t
+AlignRecord(std::size_t size) noexcept
+{
+	return (size + 7) & ~std::size_t{7};
+}
+
+[[gnu::const]]
+static int_least64_t
+ToRep(std::chrono::steady_clock::time_point t) noexcept
+{
+	return t.time_since_epoch().count();
+}
+
+struct SharedSessionStore::Header {
+	/**
+	 * Written last during initialization.
+	 */
+	std::atomic<uint32_t> magic;
+
+	uint32_t version;
+
+	uint64_t n_slots, arena_size;
+
+	/**
+	 * The absolute position where the next record will be
+	 * written.  The offset in the arena is this value modulo
+	 * #arena_size.
+	 */
+	alignas(64) std::atomic<uint64_t> arena_head;
+};
+
+/**
+ * All fields are atomic because readers access them without a lock
+ * (they are validated with the #sequence).
+ */
+struct SharedSessionStore::Slot {
+	/**
+	 * The sequence lock.  Odd while a writer modifies this slot.
+	 */
+	std::atomic<uint32_t> sequence;
+
+	/**
+	 * The size of the record (excluding the #RecordHeader); 0 if
+	 * this slot is empty.
+	 */
+	std::atomic<uint32_t> size;
+
+	std::array<std::atomic<uint64_t>, 2> key;
+
+	/**
+	 * The absolute arena position of the record.
+	 */
+	std::atomic<uint64_t> position;
+
+	std::atomic<uint64_t> hash;
+
+	/**
+	 * A std::chrono::steady_clock time point which is valid
+	 * across processes (CLOCK_MONOTONIC).
+	 */
+	std::atomic<int64_t> expires;
+
+	[[gnu::pure]]
+	bool HasKey(const SessionKey &k) const noexcept {
+		return key[0].load(std::memory_order_relaxed) == k[0] &&
+			key[1].load(std::memory_order_relaxed) == k[1];
+	}
+
+	[[gnu::pure]]
+	bool IsUsed(int_least64_t now) const noexcept {
+		return size.load(std::memory_order_relaxed) > 0 &&
+			expires.load(std::memory_order_relaxed) > now;
+	}
+
+	/**
+	 * Try to lock this slot for writing.
+	 */
+	bool TryLock() noexcept {
+		for (unsigned i = 0; i < MAX_RETRY; ++i) {
+			uint32_t s = sequence.load(std::memory_order_relaxed);
+			if ((s & 1) == 0 &&
+			    sequence.compare_exchange_weak(s, s + 1,
+							   std::memory_order_acquire)) {
+				std::atomic_thread_fence(std::memory_order_release);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void Unlock() noexcept {
+		assert(sequence.load(std::memory_order_relaxed) & 1);
+
+		sequence.fetch_add(1, std::memory_order_release);
+	}
+
+	void Clear() noexcept {
+		size.store(0, std::memory_order_relaxed);
+		key[0].store(0, std::memory_order_relaxed);
+		key[1].store(0, std::memory_order_relaxed);
+	}
+};
+
+/**
+ * Precedes each record in the arena; used to verify that the record
+ * has not been overwritten.
+ */
+struct RecordHeader {
+	SessionKey key;
+	uint64_t position;
+	uint32_t size, reserved;
+};
+
+/**
+ * Is a record (including its #RecordHeader) too large for the
+ * arena?
+ */
+[[gnu::const]]
+static constexpr bool
+IsTooLarge(std::size_t total, std::size_t arena_size) noexcept
+{
+	return total > arena_size / 4;
+}
+
+SharedSessionStore::SharedSessionStore(const char *path, std::size_t size)
+{
+	const std::size_t header_size = AlignRecord(sizeof(Header));
+
+	if (size < 1024 * 1024)
+		throw std::invalid_argument("Session store is too small");
+
+	UniqueFileDescriptor fd;
+	if (!fd.Open(path, O_RDWR|O_CREAT|O_NOCTTY, 0600))
+		throw MakeErrno("Failed to open session store");
+
+	/* exclude concurrent initialization by other processes */
+	if (flock(fd.Get(), LOCK_EX) < 0)
+		throw MakeErrno("Failed to lock session store");
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) < 0)
+		throw MakeErrno("Failed to stat session store");
+
+	/* only a new (empty) file may be initialized; an existing
+	   one may be mapped by other processes which would crash
+	   (SIGBUS) if it were truncated, or lose all sessions if it
+	   were cleared */
+	const bool fresh = st.st_size == 0;
+	if (fresh) {
+		if (ftruncate(fd.Get(), size) < 0)
+			throw MakeErrno("Failed to resize session store");
+	} else if (static_cast<std::size_t>(st.st_size) != size)
+		throw std::runtime_error("Session store has a different size");
+
+	void *p = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED,
+		       fd.Get(), 0);
+	if (p == MAP_FAILED)
+		throw MakeErrno("Failed to map session store");
+
+	mapping = static_cast<std::byte *>(p);
+	mapping_size = size;
+
+	const std::size_t n_slots =
+		std::bit_floor((size - header_size) /
+			       (sizeof(Slot) + ARENA_BYTES_PER_SLOT));
+	const std::size_t slots_size = n_slots * sizeof(Slot);
+
+	header = reinterpret_cast<Header *>(mapping);
+	slots = {reinterpret_cast<Slot *>(mapping + header_size), n_slots};
+	arena = {mapping + header_size + slots_size,
+		 size - header_size - slots_size};
+
+	if (fresh || header->magic.load(std::memory_order_acquire) != MAGIC) {
+		/* a process which has created the file may have
+		   been killed before initializing it; nobody can be
+		   using it without the magic */
+		Initialize(n_slots);
+	} else if (header->version != VERSION ||
+		   header->n_slots != slots.size() ||
+		   header->arena_size != arena.size()) {
+		munmap(mapping, mapping_size);
+		throw std::runtime_error("Session store has an incompatible layout");
+	}
+
+	/* the mapping holds a reference on the file, therefore the
+	   lock would not be released by closing the descriptor */
+	flock(fd.Get(), LOCK_UN);
+}
+
+SharedSessionStore::~SharedSessionStore() noexcept
+{
+	munmap(mapping, mapping_size);
+}
+
+void
+SharedSessionStore::Initialize(std::size_t n_slots) noexcept
+{
+	std::memset(mapping, 0, mapping_size);
+
+	header->version = VERSION;
+	header->n_slots = n_slots;
+	header->arena_size = arena.size();
+	header->arena_head.store(0, std::memory_order_relaxed);
+	header->magic.store(MAGIC, std::memory_order_release);
+}
+
+uint_least64_t
+SharedSessionStore::CalcHash(std::span<const std::byte> record,
+			     std::size_t skip) noexcept
+{
+	/* FNV-1a */
+	uint_least64_t hash = 0xcbf29ce484222325ULL;
+
+	for (const std::byte b : record.subspan(std::min(skip, record.size()))) {
+		hash ^= static_cast<uint_least64_t>(b);
+		hash *= 0x100000001b3ULL;
+	}
+
+	/* zero means "no record" */
+	return hash != 0 ? hash : 1;
+}
+
+inline bool
+SharedSessionStore::IsRecordValid(uint_least64_t position,
+				  std::size_t size) const noexcept
+{
+	const uint_least64_t head =
+		header->arena_head.load(std::memory_order_acquire);
+
+	/* the record is overwritten as soon as somebody reserves
+	   space beyond its position plus the arena size */
+	return position + AlignRecord(sizeof(RecordHeader) + size) <= head &&
+		head <= position + arena.size();
+}
+
+uint_least64_t
+SharedSessionStore::GetHash(const SessionId &id,
+			    std::chrono::steady_clock::time_point _now) const noexcept
+{
+	const auto key = ToKey(id);
+	const auto now = ToRep(_now);
+	const std::size_t mask = slots.size() - 1;
+
+	for (std::size_t i = 0; i < MAX_PROBE; ++i) {
+		const Slot &slot = slots[(key[0] + i) & mask];
+
+		for (unsigned retry = 0; retry < MAX_RETRY; ++retry) {
+			const uint32_t seq =
+				slot.sequence.load(std::memory_order_acquire);
+			if (seq & 1)
+				/* a writer is busy */
+				continue;
+
+			if (!slot.HasKey(key) || !slot.IsUsed(now))
+				break;
+
+			const uint_least64_t position =
+				slot.position.load(std::memory_order_relaxed);
+			const std::size_t size =
+				slot.size.load(std::memory_order_relaxed);
+			const uint_least64_t hash =
+				slot.hash.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != seq)
+				continue;
+
+			return IsRecordValid(position, size) ? hash : 0;
+		}
+	}
+
+	return 0;
+}
+
+uint_least64_t
+SharedSessionStore::Get(const SessionId &id,
+			std::chrono::steady_clock::time_point _now,
+			std::vector<std::byte> &dest) const noexcept
+{
+	const auto key = ToKey(id);
+	const auto now = ToRep(_now);
+	const std::size_t mask = slots.size() - 1;
+
+	for (std::size_t i = 0; i < MAX_PROBE; ++i) {
+		const Slot &slot = slots[(key[0] + i) & mask];
+
+		for (unsigned retry = 0; retry < MAX_RETRY; ++retry) {
+			const uint32_t seq =
+				slot.sequence.load(std::memory_order_acquire);
+			if (seq & 1)
+				/* a writer is busy */
+				continue;
+
+			if (!slot.HasKey(key) || !slot.IsUsed(now))
+				break;
+
+			const uint_least64_t position =
+				slot.position.load(std::memory_order_relaxed);
+			const std::size_t size =
+				slot.size.load(std::memory_order_relaxed);
+			const uint_least64_t hash =
+				slot.hash.load(std::memory_order_relaxed);
+
+			if (!IsRecordValid(position, size))
+				return 0;
+
+			/* the values may be torn by a concurrent
+			   writer; make sure the copy does not run
+			   past the end of the arena */
+			const std::size_t offset = position % arena.size();
+			if (IsTooLarge(AlignRecord(sizeof(RecordHeader) + size),
+				       arena.size()) ||
+			    offset + sizeof(RecordHeader) + size > arena.size())
+				continue;
+
+			/* copy the record; a concurrent writer
+			   may overwrite it meanwhile, which is
+			   detected below */
+			const std::byte *src = &arena[offset];
+			RecordHeader rh;
+			std::memcpy(&rh, src, sizeof(rh));
+			dest.resize(size);
+			std::memcpy(dest.data(), src + sizeof(rh), size);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != seq)
+				continue;
+
+			if (!IsRecordValid(position, size) ||
+			    rh.key != key || rh.position != position ||
+			    rh.size != size)
+				return 0;
+
+			return hash;
+		}
+	}
+
+	return 0;
+}
+
+uint_least64_t
+SharedSessionStore::Allocate(std::size_t size) noexcept
+{
+	assert(size <= arena.size());
+
+	uint_least64_t head = header->arena_head.load(std::memory_order_relaxed);
+
+	while (true) {
+		uint_least64_t position = head;
+
+		/* records must not wrap around; skip the tail of the
+		   arena if there is not enough room */
+		const std::size_t offset = position % arena.size();
+		if (offset + size > arena.size())
+			position += arena.size() - offset;
+
+		if (header->arena_head.compare_exchange_weak(head, position + size,
+							     std::memory_order_acq_rel))
+			return position;
+	}
+}
+
+/**
+ * Returns the expiry which decides which slot gets replaced by a new
+ * session: unused slots first, then the one which expires first.
+ */
+[[gnu::pure]]
+static int_least64_t
+GetVictimExpires(const auto &slot, int_least64_t now) noexcept
+{
+	return slot.IsUsed(now)
+		? slot.expires.load(std::memory_order_relaxed)
+		: std::numeric_limits<int_least64_t>::min();
+}
+
+SharedSessionStore::Slot *
+SharedSessionStore::LockSlot(const SessionId &id,
+			     std::chrono::steady_clock::time_point _now) noexcept
+{
+	const auto key = ToKey(id);
+	const auto now = ToRep(_now);
+	const std::size_t mask = slots.size() - 1;
+
+	for (unsigned retry = 0; retry < MAX_RETRY; ++retry) {
+		Slot *match = nullptr, *victim = nullptr;
+		SessionKey victim_key{};
+		int_least64_t victim_expires = std::numeric_limits<int_least64_t>::max();
+
+		/* this search runs without a lock; its result is
+		   verified after the slot has been locked */
+		for (std::size_t i = 0; i < MAX_PROBE; ++i) {
+			Slot &slot = slots[(key[0] + i) & mask];
+
+			if (slot.HasKey(key)) {
+				match = &slot;
+				break;
+			}
+
+			const int_least64_t expires = GetVictimExpires(slot, now);
+			if (expires < victim_expires) {
+				victim = &slot;
+				victim_key = {
+					slot.key[0].load(std::memory_order_relaxed),
+					slot.key[1].load(std::memory_order_relaxed),
+				};
+				victim_expires = expires;
+			}
+		}
+
+		Slot *slot = match != nullptr ? match : victim;
+		assert(slot != nullptr);
+
+		if (!slot->TryLock())
+			return nullptr;
+
+		/* another writer may have replaced the slot after we
+		   have chosen it */
+		if (match != nullptr
+		    ? slot->HasKey(key)
+		    : (slot->HasKey(victim_key) &&
+		       GetVictimExpires(*slot, now) == victim_expires))
+			return slot;
+
+		slot->Unlock();
+	}
+
+	return nullptr;
+}
+
+bool
+SharedSessionStore::Put(const SessionId &id, std::span<const std::byte> record,
+			uint_least64_t hash,
+			std::chrono::steady_clock::time_point expires) noexcept
+{
+	assert(!record.empty());
+	assert(hash != 0);
+
+	const std::size_t total = AlignRecord(sizeof(RecordHeader) + record.size());
+	if (IsTooLarge(total, arena.size()) ||
+	    record.size() > std::numeric_limits<uint32_t>::max())
+		return false;
+
+	const auto key = ToKey(id);
+
+	Slot *slot = LockSlot(id, std::chrono::steady_clock::now());
+	if (slot == nullptr)
+		return false;
+
+	if (slot->HasKey(key) &&
+	    slot->size.load(std::memory_order_relaxed) == record.size() &&
+	    slot->hash.load(std::memory_order_relaxed) == hash &&
+	    IsRecordValid(slot->position.load(std::memory_order_relaxed),
+			  record.size())) {
+		/* unmodified: refresh the expiry only and don't waste
+		   arena space */
+		slot->expires.store(ToRep(expires), std::memory_order_relaxed);
+		slot->Unlock();
+		return true;
+	}
+
+	const uint_least64_t position = Allocate(total);
+
+	const RecordHeader rh{
+		.key = key,
+		.position = position,
+		.size = static_cast<uint32_t>(record.size()),
+		.reserved = 0,
+	};
+
+	std::byte *dest = &arena[position % arena.size()];
+	std::memcpy(dest, &rh, sizeof(rh));
+	std::memcpy(dest + sizeof(rh), record.data(), record.size());
+
+	slot->key[0].store(key[0], std::memory_order_relaxed);
+	slot->key[1].store(key[1], std::memory_order_relaxed);
+	slot->position.store(position, std::memory_order_relaxed);
+	slot->size.store(record.size(), std::memory_order_relaxed);
+	slot->hash.store(hash, std::memory_order_relaxed);
+	slot->expires.store(ToRep(expires), std::memory_order_relaxed);
+	slot->Unlock();
+	return true;
+}
+
+void
+SharedSessionStore::Remove(const SessionId &id) noexcept
+{
+	const auto key = ToKey(id);
+	const std::size_t mask = slots.size() - 1;
+
+	for (std::size_t i = 0; i < MAX_PROBE; ++i) {
+		Slot &slot = slots[(key[0] + i) & mask];
+
+		if (slot.HasKey(key) && slot.TryLock()) {
+			if (slot.HasKey(key))
+				slot.Clear();
+			slot.Unlock();
+		}
+	}
+}
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class SessionId;
+
+/**
+ * A session store in a shared memory segment (a file on a tmpfs such
+ * as /dev/shm) which can be used by several processes on this host
+ * at the same time.  Since it is backed by a file, its contents
+ * survive a process restart.
+ *
+ * The segment has a fixed layout: a header, an open-addressed hash
+ * table of fixed-size slots and an arena which contains the
+ * serialized sessions.  The arena is a ring buffer: new records are
+ * always appended, and the oldest records are overwritten when it
+ * wraps around.  A slot refers to a record by its absolute position;
+ * if the ring has wrapped past that position, the record is gone.
+ *
+ * Each slot is protected by a sequence lock: writers increment the
+ * sequence number to an odd value (with compare-and-swap, which
+ * excludes concurrent writers), modify the slot and increment it to
+ * an even value again.  Readers never lock; they copy the record and
+ * retry if the sequence number has changed meanwhile.
+ *
+ * This class stores opaque byte records; serializing sessions is up
+ * to the caller.
+ */
+class SharedSessionStore {
+	struct Header;
+	struct Slot;
+
+	/**
+	 * How many slots are probed for a given session id?
+	 */
+	static constexpr std::size_t MAX_PROBE = 16;
+
+	std::byte *mapping;
+	std::size_t mapping_size;
+
+	Header *header;
+	std::span<Slot> slots;
+	std::span<std::byte> arena;
+
+public:
+	/**
+	 * Open (or create) the store.  Only a new (empty) file is
+	 * initialized; if the file exists already but has a
+	 * different size or layout, this constructor throws.
+	 *
+	 * Throws on error.
+	 *
+	 * @param path the path of the file backing the shared memory
+	 * segment; it should be on a tmpfs
+	 * @param size the total size of the segment
+	 */
+	SharedSessionStore(const char *path, std::size_t size);
+
+	~SharedSessionStore() noexcept;
+
+	SharedSessionStore(const SharedSessionStore &) = delete;
+	SharedSessionStore &operator=(const SharedSessionStore &) = delete;
+
+	/**
+	 * Calculate the hash of a record which is passed to Put().
+	 * This hash is never zero.
+	 *
+	 * @param skip the number of bytes at the beginning of the
+	 * record which are volatile and shall not be hashed
+	 */
+	[[gnu::pure]]
+	static uint_least64_t CalcHash(std::span<const std::byte> record,
+				       std::size_t skip=0) noexcept;
+
+	/**
+	 * Look up the hash of the record for the given session
+	 * without copying it.  This can be used to check whether a
+	 * local copy is still up to date.
+	 *
+	 * @return the hash or 0 if there is no (valid) record
+	 */
+	[[gnu::pure]]
+	uint_least64_t GetHash(const SessionId &id,
+			       std::chrono::steady_clock::time_point now) const noexcept;
+
+	/**
+	 * Copy the record of the given session.
+	 *
+	 * @return the hash of the record or 0 if there is no (valid)
+	 * record
+	 */
+	uint_least64_t Get(const SessionId &id,
+			   std::chrono::steady_clock::time_point now,
+			   std::vector<std::byte> &dest) const noexcept;
+
+	/**
+	 * Store a record (or refresh the expiry of an existing
+	 * record with the same hash).
+	 *
+	 * @return false if the record could not be stored (too large
+	 * or the slot is contended)
+	 */
+	bool Put(const SessionId &id, std::span<const std::byte> record,
+		 uint_least64_t hash,
+		 std::chrono::steady_clock::time_point expires) noexcept;
+
+	void Remove(const SessionId &id) noexcept;
+
+private:
+	void Initialize(std::size_t n_slots) noexcept;
+
+	/**
+	 * Is the record at the given absolute arena position still
+	 * intact?
+	 */
+	[[gnu::pure]]
+	bool IsRecordValid(uint_least64_t position,
+			   std::size_t size) const noexcept;
+
+	/**
+	 * Reserve space for a record in the arena.
+	 *
+	 * @return the absolute position of the record
+	 */
+	uint_least64_t Allocate(std::size_t size) noexcept;
+
+	/**
+	 * Find the slot which contains the given session or a slot
+	 * which can be used to store it and lock it for writing.
+	 *
+	 * @return the locked slot or nullptr if no slot could be
+	 * locked
+	 */
+	Slot *LockSlot(const SessionId &id,
+		       std::chrono::steady_clock::time_point now) noexcept;
+};
@@ -189,3 +189,9 @@ session_write(BufferedOutputStream &os, const Session *session)
 	file.Write32(MAGIC_END_OF_LIST);
 	file.Write32(MAGIC_END_OF_RECORD);
 }
+
+std::size_t
+session_write_volatile_size() noexcept
+{
+	return sizeof(SessionId) + sizeof(Expiry) + sizeof(unsigned);
+}
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 #include <stdint.h>
 
 struct Session;
@@ -36,3 +38,13 @@ session_write_file_tail(BufferedOutputStream &os);
  */
 void
 session_write(BufferedOutputStream &os, const Session *session);
+
+/**
+ * Returns the number of bytes at the beginning of a record written
+ * by session_write() which change on every access (the session id,
+ * the expiry and the counter).  They can be skipped when checking
+ * whether a session has been modified.
+ */
+[[gnu::const]]
+std::size_t
+session_write_volatile_size() noexcept;
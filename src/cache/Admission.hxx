@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * How does a #Cache decide whether a new item may displace existing
+ * ones?
+ */
+enum class CacheAdmission : uint_least8_t {
+	/**
+	 * Admit every new item and evict the least recently used
+	 * items to make room for it.
+	 */
+	LRU,
+
+	/**
+	 * W-TinyLFU: new items enter a small LRU "admission window";
+	 * items falling out of the window displace the least
+	 * recently used item of the main area only if they are
+	 * estimated (by a #FrequencySketch) to be more popular.  This
+	 * protects the working set from one-hit wonders, e.g. a
+	 * crawler walking many unique URLs.
+	 */
+	TINY_LFU,
+};
@@ -6,16 +6,32 @@
 #include "Handler.hxx"
 #include "Item.hxx"
 #include "event/Loop.hxx"
+#include "stats/CacheStats.hxx"
 
 #include <cassert>
 
 Cache::Cache(EventLoop &event_loop,
 	     size_t _max_size,
-	     CacheHandler *_handler) noexcept
+	     CacheHandler *_handler,
+	     CacheAdmission _admission) noexcept
 	:max_size(_max_size),
-	 handler(_handler),
-	 cleanup_timer(event_loop, std::chrono::minutes(1),
-		       BIND_THIS_METHOD(ExpireCallback)) {}
+	 /* like in the W-TinyLFU paper, the admission window gets
+	    1% of the cache */
+	 window_max_size(_admission == CacheAdmission::TINY_LFU
+			 ? _max_size / 100
+			 : 0),
+	 handler(_handler), admission(_admission),
+	 /* the expiry index makes each run cheap, so it can run
+	    more often than the LRU walk it replaced, which spreads
+	    the work of removing expired items over time */
+	 cleanup_timer(event_loop, std::chrono::seconds(10),
+		       BIND_THIS_METHOD(ExpireCallback))
+{
+	if (admission == CacheAdmission::TINY_LFU)
+		/* allocate a small table right away; ItemAdded() will
+		   grow it */
+		sketch.EnsureCapacity(1);
+}
 
 Cache::~Cache() noexcept
 {
@@ -24,8 +40,10 @@ Cache::~Cache() noexcept
 		assert(size >= item->size);
 		size -= item->size;
 
+		expiry.Remove(*item);
+
 #ifndef NDEBUG
-		sorted_items.erase(sorted_items.iterator_to(*item));
+		UnlinkSorted(*item);
 #endif
 
 		item->Destroy();
@@ -33,6 +51,15 @@ Cache::~Cache() noexcept
 
 	assert(size == 0);
 	assert(sorted_items.empty());
+	assert(window_items.empty());
+	assert(expiry.empty());
+}
+
+void
+Cache::FillStats(CacheStats &stats) const noexcept
+{
+	stats.evictions = n_evictions;
+	stats.rejections = n_rejections;
 }
 
 std::chrono::steady_clock::time_point
@@ -54,6 +81,13 @@ Cache::ItemAdded(CacheItem &item) noexcept
 	assert(!item.IsRemoved());
 
 	size += item.size;
+	++n_items;
+
+	if (admission == CacheAdmission::TINY_LFU &&
+	    n_items > sketch.GetCapacity())
+		sketch.EnsureCapacity(n_items);
+
+	expiry.Insert(item, SteadyNow());
 
 	if (handler != nullptr)
 		handler->OnCacheItemAdded(item);
@@ -71,6 +105,11 @@ Cache::ItemRemoved(CacheItem *item) noexcept
 
 	size -= item->size;
 
+	assert(n_items > 0);
+	--n_items;
+
+	expiry.Remove(*item);
+
 	if (handler != nullptr)
 		handler->OnCacheItemRemoved(*item);
 
@@ -86,12 +125,37 @@ Cache::Flush() noexcept
 	items.clear_and_dispose(Cache::ItemRemover(*this));
 }
 
+inline void
+Cache::LinkSorted(CacheItem &item) noexcept
+{
+	if (admission == CacheAdmission::TINY_LFU) {
+		item.in_window = true;
+		window_size += item.size;
+		window_items.push_back(item);
+	} else
+		sorted_items.push_back(item);
+}
+
+void
+Cache::UnlinkSorted(CacheItem &item) noexcept
+{
+	if (item.in_window) {
+		assert(window_size >= item.size);
+		window_size -= item.size;
+		item.in_window = false;
+		window_items.erase(window_items.iterator_to(item));
+	} else
+		sorted_items.erase(sorted_items.iterator_to(item));
+}
+
 void
 Cache::RefreshItem(CacheItem &item) noexcept
 {
+	auto &list = item.in_window ? window_items : sorted_items;
+
 	/* move to the back of the linked list */
-	sorted_items.erase(sorted_items.iterator_to(item));
-	sorted_items.push_back(item);
+	list.erase(list.iterator_to(item));
+	list.push_back(item);
 }
 
 auto
@@ -106,6 +170,8 @@ Cache::RemoveItem(CacheItem &item) noexcept
 CacheItem *
 Cache::Get(StringWithHash key) noexcept
 {
+	RecordAccess(key);
+
 	auto i = items.find(key);
 	if (i == items.end())
 		return nullptr;
@@ -126,6 +192,8 @@ Cache::Get(StringWithHash key) noexcept
 CacheItem *
 Cache::GetMatch(StringWithHash key, MatchFunction match) noexcept
 {
+	RecordAccess(key);
+
 	const auto now = SteadyNow();
 
 	auto i = items.expire_find_if(key, [now](const auto &item){
@@ -147,17 +215,82 @@ Cache::DestroyOldestItem() noexcept
 		return;
 
 	CacheItem &item = sorted_items.front();
+	++n_evictions;
 	RemoveItem(item);
 }
 
 bool
-Cache::NeedRoom(size_t _size) noexcept
+Cache::AdmitToMain(const CacheItem &item, size_t main_max_size) noexcept
+{
+	if (item.size > main_max_size)
+		return false;
+
+	const unsigned frequency = sketch.Estimate(item.GetKey().hash);
+
+	/* the size of the main area after admitting the item; items
+	   in the window do not count */
+	while (size - window_size + item.size > main_max_size) {
+		assert(!sorted_items.empty());
+
+		CacheItem &victim = sorted_items.front();
+		if (frequency <= sketch.Estimate(victim.GetKey().hash))
+			return false;
+
+		++n_evictions;
+		RemoveItem(victim);
+	}
+
+	return true;
+}
+
+bool
+Cache::NeedRoomTinyLfu(const CacheItem &item) noexcept
+{
+	const size_t main_max_size = max_size - window_max_size;
+
+	/* make room in the admission window: its oldest items move
+	   to the main area if they are more popular than the main
+	   area's victims, or else they get evicted */
+	while (!window_items.empty() &&
+	       window_size + item.size > window_max_size) {
+		CacheItem &candidate = window_items.front();
+
+		if (AdmitToMain(candidate, main_max_size)) {
+			UnlinkSorted(candidate);
+			sorted_items.push_back(candidate);
+		} else {
+			++n_rejections;
+			RemoveItem(candidate);
+		}
+	}
+
+	if (window_size + item.size <= window_max_size)
+		return true;
+
+	/* the new item is larger than the whole (now empty) window:
+	   it has to compete with the main area's victims right
+	   away */
+	assert(window_items.empty());
+
+	if (!AdmitToMain(item, max_size)) {
+		++n_rejections;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+Cache::NeedRoom(const CacheItem &item) noexcept
 {
-	if (_size > max_size)
+	if (item.size > max_size)
 		return false;
 
+	if (admission == CacheAdmission::TINY_LFU)
+		return NeedRoomTinyLfu(item);
+
 	while (true) {
-		if (size + _size <= max_size)
+		if (size + item.size <= max_size)
 			return true;
 
 		DestroyOldestItem();
@@ -168,13 +301,15 @@ bool
 Cache::Add(CacheItem &item) noexcept
 {
 	/* XXX size constraints */
-	if (!NeedRoom(item.size)) {
+	RecordAccess(item.GetKey());
+
+	if (!NeedRoom(item)) {
 		item.Destroy();
 		return false;
 	}
 
 	items.insert(item);
-	sorted_items.push_back(item);
+	LinkSorted(item);
 
 	ItemAdded(item);
 	return true;
@@ -188,7 +323,9 @@ Cache::Put(CacheItem &item) noexcept
 	assert(item.size > 0);
 	assert(item.IsAbandoned());
 
-	if (!NeedRoom(item.size)) {
+	RecordAccess(item.GetKey());
+
+	if (!NeedRoom(item)) {
 		item.Destroy();
 		return false;
 	}
@@ -198,7 +335,7 @@ Cache::Put(CacheItem &item) noexcept
 		it = RemoveItem(*it);
 
 	items.insert_commit(it, item);
-	sorted_items.push_back(item);
+	LinkSorted(item);
 
 	ItemAdded(item);
 	return true;
@@ -212,7 +349,9 @@ Cache::PutMatch(CacheItem &item, MatchFunction match) noexcept
 	assert(item.size > 0);
 	assert(item.IsAbandoned());
 
-	if (!NeedRoom(item.size)) {
+	RecordAccess(item.GetKey());
+
+	if (!NeedRoom(item)) {
 		item.Destroy();
 		return false;
 	}
@@ -222,7 +361,7 @@ Cache::PutMatch(CacheItem &item, MatchFunction match) noexcept
 		it = RemoveItem(*it);
 
 	items.insert_commit(it, item);
-	sorted_items.push_back(item);
+	LinkSorted(item);
 
 	ItemAdded(item);
 	return true;
@@ -246,32 +385,50 @@ Cache::Remove(CacheItem &item) noexcept
 	RemoveItem(item);
 }
 
+void
+Cache::SetExpires(CacheItem &item,
+		  std::chrono::steady_clock::time_point expires) noexcept
+{
+	item.SetExpires(expires);
+
+	if (!item.IsRemoved())
+		expiry.Update(item, SteadyNow());
+}
+
 std::size_t
 Cache::RemoveAllMatch(MatchFunction match) noexcept
 {
-	return sorted_items.remove_and_dispose_if([match](const CacheItem &item){
+	const auto pred = [match](const CacheItem &item){
 		return match(item);
-	}, [this](CacheItem *item){
+	};
+
+	std::size_t n = sorted_items.remove_and_dispose_if(pred, [this](CacheItem *item){
 		items.erase(items.iterator_to(*item));
 		ItemRemoved(item);
 	});
+
+	n += window_items.remove_and_dispose_if(pred, [this](CacheItem *item){
+		assert(window_size >= item->size);
+		window_size -= item->size;
+		item->in_window = false;
+
+		items.erase(items.iterator_to(*item));
+		ItemRemoved(item);
+	});
+
+	return n;
+}
+
+inline void
+Cache::ExpireItem(CacheItem &item) noexcept
+{
+	RemoveItem(item);
 }
 
-/** clean up expired cache items every 60 seconds */
 bool
 Cache::ExpireCallback() noexcept
 {
-	const auto now = SteadyNow();
-
-	for (auto i = sorted_items.begin(), end = sorted_items.end(); i != end;) {
-		CacheItem &item = *i++;
-
-		if (item.expires > now)
-			/* not yet expired */
-			continue;
-
-		RemoveItem(item);
-	}
+	expiry.Advance(SteadyNow(), BIND_THIS_METHOD(ExpireItem));
 
 	return size > 0;
 }
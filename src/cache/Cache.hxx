@@ -5,6 +5,9 @@
 #pragma once
 
 #include "Item.hxx"
+#include "Admission.hxx"
+#include "ExpiryWheel.hxx"
+#include "FrequencySketch.hxx"
 #include "event/CleanupTimer.hxx"
 #include "util/BindMethod.hxx"
 #include "util/IntrusiveHashSet.hxx"
@@ -13,19 +16,51 @@
 
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include <stddef.h>
 
 class CacheItem;
 class CacheHandler;
+struct CacheStats;
 
 class Cache {
 	const size_t max_size;
 	size_t size = 0;
 
+	/**
+	 * The maximum total size of all items in #window_items.
+	 */
+	const size_t window_max_size;
+
+	/**
+	 * The total size of all items in #window_items.
+	 */
+	size_t window_size = 0;
+
+	/**
+	 * The number of items in this cache.
+	 */
+	std::size_t n_items = 0;
+
+	/**
+	 * The number of items which were removed to make room for
+	 * new items.
+	 */
+	uint_least64_t n_evictions = 0;
+
+	/**
+	 * The number of new items which were not admitted (or which
+	 * fell out of the admission window) because they were less
+	 * popular than the items they would have displaced.
+	 */
+	uint_least64_t n_rejections = 0;
+
 	CacheHandler *const handler;
 
+	const CacheAdmission admission;
+
 	using ItemSet = IntrusiveHashSet<CacheItem, 65536,
 					 IntrusiveHashSetOperators<CacheItem,
 								   CacheItem::GetKeyFunction,
@@ -42,11 +77,33 @@ class Cache {
 	IntrusiveList<CacheItem,
 		      IntrusiveListMemberHookTraits<&CacheItem::sorted_siblings>> sorted_items;
 
+	/**
+	 * The admission window (only used with
+	 * CacheAdmission::TINY_LFU): new items are added here; they
+	 * move to #sorted_items (the main area) when they fall out of
+	 * the window, but only if they win against the main area's
+	 * eviction victim.  Sorted by last access, oldest first.
+	 */
+	IntrusiveList<CacheItem,
+		      IntrusiveListMemberHookTraits<&CacheItem::sorted_siblings>> window_items;
+
+	/**
+	 * Estimates the popularity of keys (only used with
+	 * CacheAdmission::TINY_LFU).
+	 */
+	FrequencySketch sketch;
+
+	/**
+	 * All cache items, indexed by their expiry time.
+	 */
+	CacheExpiryWheel expiry;
+
 	CleanupTimer cleanup_timer;
 
 public:
 	Cache(EventLoop &event_loop, size_t _max_size,
-	      CacheHandler *_handler=nullptr) noexcept;
+	      CacheHandler *_handler=nullptr,
+	      CacheAdmission _admission=CacheAdmission::LRU) noexcept;
 
 	~Cache() noexcept;
 
@@ -60,6 +117,11 @@ public:
 	[[gnu::pure]]
 	std::chrono::system_clock::time_point SystemNow() const noexcept;
 
+	/**
+	 * Copy the eviction counters to the given #CacheStats.
+	 */
+	void FillStats(CacheStats &stats) const noexcept;
+
 	[[gnu::pure]]
 	CacheItem *Get(StringWithHash key) noexcept;
 
@@ -115,6 +177,15 @@ public:
 	 */
 	void Remove(CacheItem &item) noexcept;
 
+	/**
+	 * Change the expiry time of an item which is in this cache.
+	 * Unlike CacheItem::SetExpires(), this moves the item in the
+	 * expiry index, which is necessary to remove it in time if
+	 * the new expiry time is earlier.
+	 */
+	void SetExpires(CacheItem &item,
+			std::chrono::steady_clock::time_point expires) noexcept;
+
 	/**
 	 * Removes all matching cache items.
 	 *
@@ -128,9 +199,11 @@ public:
 	void Flush() noexcept;
 
 private:
-	/** clean up expired cache items every 60 seconds */
+	/** clean up expired cache items periodically */
 	bool ExpireCallback() noexcept;
 
+	void ExpireItem(CacheItem &item) noexcept;
+
 	/**
 	 * Update internal book-keeping after #item has been added
 	 * to the data structures of this #Cache.
@@ -157,19 +230,38 @@ private:
 			:cache(_cache) {}
 
 		void operator()(CacheItem *item) noexcept {
-			cache.sorted_items.erase(cache.sorted_items.iterator_to(*item));
+			cache.UnlinkSorted(*item);
 			cache.ItemRemoved(item);
 		}
 	};
 
+	/**
+	 * Remove the #item from #sorted_items or #window_items.
+	 */
+	void UnlinkSorted(CacheItem &item) noexcept;
+
+	/**
+	 * Add a new #item to #sorted_items (or to #window_items).
+	 */
+	void LinkSorted(CacheItem &item) noexcept;
+
+	/**
+	 * Record an access to the given key in the #sketch.
+	 */
+	void RecordAccess(StringWithHash key) noexcept {
+		if (admission == CacheAdmission::TINY_LFU)
+			sketch.Increment(key.hash);
+	}
+
 	/**
 	 * Remove an item from this cache and dispose of it.
 	 */
 	auto RemoveItem(CacheItem &item) noexcept;
 
 	/**
-	 * Move the #item to the back of the #sorted_items list.  Call
-	 * this when it has just been used.
+	 * Move the #item to the back of the #sorted_items list (or
+	 * the #window_items list).  Call this when it has just been
+	 * used.
 	 */
 	void RefreshItem(CacheItem &item) noexcept;
 
@@ -184,5 +276,19 @@ private:
 	 * @return true on success, false if there is not enough room
 	 * in the cache
 	 */
-	bool NeedRoom(size_t _size) noexcept;
+	bool NeedRoom(const CacheItem &item) noexcept;
+
+	/**
+	 * The CacheAdmission::TINY_LFU implementation of NeedRoom().
+	 */
+	bool NeedRoomTinyLfu(const CacheItem &item) noexcept;
+
+	/**
+	 * Make room for an item in the main area (#sorted_items) by
+	 * evicting its least recently used items, but only if they
+	 * are less popular than the given item.
+	 *
+	 * @return true on success, false if the item was rejected
+	 */
+	bool AdmitToMain(const CacheItem &item, size_t main_max_size) noexcept;
 };
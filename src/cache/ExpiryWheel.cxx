@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ExpiryWheel.hxx"
+
+#include <algorithm> // for std::max()
+#include <cassert>
+
+inline uint_least64_t
+CacheExpiryWheel::FloorTick(Clock::time_point t) noexcept
+{
+	const auto n = std::chrono::floor<Tick>(t.time_since_epoch()).count();
+	return n > 0 ? static_cast<uint_least64_t>(n) : 0;
+}
+
+inline uint_least64_t
+CacheExpiryWheel::CeilTick(Clock::time_point t) noexcept
+{
+	if (t == Clock::time_point::max())
+		return UINT_LEAST64_MAX;
+
+	const auto n = std::chrono::ceil<Tick>(t.time_since_epoch()).count();
+	return n > 0 ? static_cast<uint_least64_t>(n) : 0;
+}
+
+void
+CacheExpiryWheel::Insert(CacheItem &item) noexcept
+{
+	assert(!item.expiry_siblings.is_linked());
+
+	/* items which have already expired are processed by the
+	   next Advance() call */
+	uint_least64_t tick = std::max(CeilTick(item.expires),
+				       current_tick + 1);
+
+	for (unsigned level = 0;; ++level) {
+		assert(level < N_LEVELS);
+
+		const unsigned shift = level * LEVEL_BITS;
+		const uint_least64_t current_unit = current_tick >> shift;
+
+		if (level == N_LEVELS - 1) {
+			/* the last level: clamp; Advance() will
+			   insert this item again when this slot is
+			   reached */
+			const uint_least64_t max_tick =
+				(current_unit + N_SLOTS - 1) << shift;
+			tick = std::min(tick, max_tick);
+		}
+
+		/* round up, so the item never expires early */
+		const uint_least64_t mask = (uint_least64_t{1} << shift) - 1;
+		const uint_least64_t unit = (tick >> shift) + ((tick & mask) != 0);
+
+		if (unit - current_unit < N_SLOTS) {
+			levels[level][unit & (N_SLOTS - 1)].push_back(item);
+			++n_items;
+			return;
+		}
+	}
+}
+
+void
+CacheExpiryWheel::Insert(CacheItem &item, Clock::time_point now) noexcept
+{
+	if (n_items == 0)
+		/* the wheel is empty: skip the ticks which have
+		   elapsed while it was idle */
+		current_tick = std::max(current_tick, FloorTick(now));
+
+	Insert(item);
+}
+
+void
+CacheExpiryWheel::Remove(CacheItem &item) noexcept
+{
+	if (!item.expiry_siblings.is_linked())
+		return;
+
+	assert(n_items > 0);
+
+	item.expiry_siblings.unlink();
+	--n_items;
+}
+
+inline void
+CacheExpiryWheel::ProcessSlot(Slot &slot, Clock::time_point now,
+			      ExpireFunction expire) noexcept
+{
+	while (!slot.empty()) {
+		CacheItem &item = slot.front();
+		slot.pop_front();
+		--n_items;
+
+		if (item.expires > now)
+			/* the item's expiry was extended (or it was
+			   clamped to the last level) */
+			Insert(item);
+		else
+			expire(item);
+	}
+}
+
+void
+CacheExpiryWheel::Advance(Clock::time_point now, ExpireFunction expire) noexcept
+{
+	const uint_least64_t now_tick = FloorTick(now);
+
+	while (current_tick < now_tick) {
+		if (n_items == 0) {
+			current_tick = now_tick;
+			break;
+		}
+
+		++current_tick;
+
+		for (unsigned level = 0; level < N_LEVELS; ++level) {
+			const unsigned shift = level * LEVEL_BITS;
+			if (current_tick & ((uint_least64_t{1} << shift) - 1))
+				/* not at a boundary of this level's
+				   granularity (and thus not of the
+				   higher levels) */
+				break;
+
+			const uint_least64_t unit = current_tick >> shift;
+			ProcessSlot(levels[level][unit & (N_SLOTS - 1)],
+				    now, expire);
+		}
+	}
+}
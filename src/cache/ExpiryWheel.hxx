@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Item.hxx"
+#include "util/BindMethod.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * An index of #CacheItem instances sorted by their expiry time.  It
+ * is a hierarchical timer wheel (without cascading): each level has
+ * #N_SLOTS slots, and the granularity of each level is #LEVEL_FACTOR
+ * times the granularity of the previous one.  An item is inserted
+ * into the lowest level whose range covers its expiry time, rounded
+ * up to the granularity of that level.  Therefore, items expire a bit
+ * late (up to 1/8 of their remaining lifetime), but never early.
+ *
+ * Inserting and removing an item is O(1), and Advance() costs only
+ * O(elapsed ticks + expired items), unlike a walk over all items.
+ *
+ * If an item's expiry time gets extended (CacheItem::SetExpires())
+ * while it is in the wheel, Advance() notices that and inserts it
+ * again.
+ */
+class CacheExpiryWheel {
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * The granularity of level 0.
+	 */
+	using Tick = std::chrono::seconds;
+
+	static constexpr unsigned SLOT_BITS = 6;
+	static constexpr std::size_t N_SLOTS = std::size_t{1} << SLOT_BITS;
+
+	static constexpr unsigned LEVEL_BITS = 3;
+	static constexpr unsigned LEVEL_FACTOR = 1U << LEVEL_BITS;
+
+	/**
+	 * With 1 second granularity at level 0, the highest level
+	 * covers more than 24 days; items which expire even later
+	 * are reinserted when their slot is reached.
+	 */
+	static constexpr unsigned N_LEVELS = 6;
+
+	using Slot = IntrusiveList<CacheItem,
+				   IntrusiveListMemberHookTraits<&CacheItem::expiry_siblings>>;
+
+	std::array<std::array<Slot, N_SLOTS>, N_LEVELS> levels;
+
+	/**
+	 * All items which expire at or before this tick have been
+	 * processed by Advance().
+	 */
+	uint_least64_t current_tick = 0;
+
+	/**
+	 * The number of items in this wheel.
+	 */
+	std::size_t n_items = 0;
+
+public:
+	using ExpireFunction = BoundMethod<void(CacheItem &item) noexcept>;
+
+	CacheExpiryWheel() noexcept = default;
+
+	CacheExpiryWheel(const CacheExpiryWheel &) = delete;
+	CacheExpiryWheel &operator=(const CacheExpiryWheel &) = delete;
+
+	bool empty() const noexcept {
+		return n_items == 0;
+	}
+
+	std::size_t size() const noexcept {
+		return n_items;
+	}
+
+	/**
+	 * Add an item which is not yet in the wheel.
+	 *
+	 * @param now the current time; it is only used to
+	 * initialize the wheel if it is empty
+	 */
+	void Insert(CacheItem &item, Clock::time_point now) noexcept;
+
+	/**
+	 * Remove the item from the wheel (if it is in the wheel).
+	 */
+	void Remove(CacheItem &item) noexcept;
+
+	/**
+	 * Re-insert the item after its expiry time has been
+	 * changed.  This is only necessary if the expiry time was
+	 * moved to an earlier time.
+	 */
+	void Update(CacheItem &item, Clock::time_point now) noexcept {
+		Remove(item);
+		Insert(item, now);
+	}
+
+	/**
+	 * Collect all items which have expired.  The #expire
+	 * function gets called for each of them; it must not modify
+	 * the wheel except for removing the given item.
+	 */
+	void Advance(Clock::time_point now, ExpireFunction expire) noexcept;
+
+private:
+	[[gnu::const]]
+	static uint_least64_t FloorTick(Clock::time_point t) noexcept;
+
+	[[gnu::const]]
+	static uint_least64_t CeilTick(Clock::time_point t) noexcept;
+
+	void Insert(CacheItem &item) noexcept;
+
+	void ProcessSlot(Slot &slot, Clock::time_point now,
+			 ExpireFunction expire) noexcept;
+};
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "FrequencySketch.hxx"
+
+#include <algorithm> // for std::min(), std::fill_n()
+#include <bit> // for std::bit_ceil()
+
+/**
+ * Limit the table to 16 MB.
+ */
+static constexpr std::size_t MAX_TABLE_SIZE = std::size_t{1} << 21;
+
+static constexpr uint_least64_t ROW_SEEDS[] = {
+	0xc3a5c85c97cb3127, 0xb492b66fbe98f273,
+	0x9ae16a3b2f90404f, 0xcbf29ce484222325,
+};
+
+/**
+ * The "splitmix64" finalizer; it spreads the bits of the (possibly
+ * weak) key hash over the whole word.
+ */
+static constexpr uint_least64_t
+Mix(uint_least64_t x) noexcept
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111eb;
+	x ^= x >> 31;
+	return x;
+}
+
+struct CounterPosition {
+	std::size_t word;
+	unsigned shift;
+};
+
+static constexpr CounterPosition
+GetCounterPosition(std::size_t hash, unsigned row,
+		   std::size_t table_mask) noexcept
+{
+	const uint_least64_t h = Mix(hash + ROW_SEEDS[row]);
+
+	/* each row owns four of the 16 counters in a word; the
+	   topmost two bits of the hash select one of them */
+	const unsigned counter = row * 4 + static_cast<unsigned>(h >> 62);
+
+	return {
+		static_cast<std::size_t>(h) & table_mask,
+		counter * 4,
+	};
+}
+
+void
+FrequencySketch::EnsureCapacity(std::size_t capacity) noexcept
+{
+	const std::size_t n = std::clamp(std::bit_ceil(capacity),
+					 std::size_t{64}, MAX_TABLE_SIZE);
+	if (n <= GetCapacity())
+		return;
+
+	auto new_table = std::make_unique<uint_least64_t[]>(n);
+
+	/* the new table index of a key is its old index plus some
+	   more bits, so copying the old table into each "slice" of
+	   the new one preserves all counters */
+	for (std::size_t i = 0, old_n = GetCapacity(); i < old_n; ++i)
+		for (std::size_t j = i; j < n; j += old_n)
+			new_table[j] = table[i];
+
+	table = std::move(new_table);
+	table_mask = n - 1;
+	sample_size = n * 10;
+}
+
+void
+FrequencySketch::Increment(std::size_t hash) noexcept
+{
+	if (!table)
+		return;
+
+	bool incremented = false;
+
+	for (unsigned row = 0; row < 4; ++row) {
+		const auto p = GetCounterPosition(hash, row, table_mask);
+		uint_least64_t &word = table[p.word];
+
+		if (((word >> p.shift) & 0xf) < MAX_FREQUENCY) {
+			word += uint_least64_t{1} << p.shift;
+			incremented = true;
+		}
+	}
+
+	if (incremented && ++n_samples >= sample_size)
+		Age();
+}
+
+unsigned
+FrequencySketch::Estimate(std::size_t hash) const noexcept
+{
+	if (!table)
+		return 0;
+
+	unsigned result = MAX_FREQUENCY;
+
+	for (unsigned row = 0; row < 4; ++row) {
+		const auto p = GetCounterPosition(hash, row, table_mask);
+		const unsigned value = (table[p.word] >> p.shift) & 0xf;
+		result = std::min(result, value);
+	}
+
+	return result;
+}
+
+void
+FrequencySketch::Clear() noexcept
+{
+	if (table)
+		std::fill_n(table.get(), GetCapacity(), uint_least64_t{});
+
+	n_samples = 0;
+}
+
+void
+FrequencySketch::Age() noexcept
+{
+	for (std::size_t i = 0, n = GetCapacity(); i < n; ++i)
+		/* shift each 4-bit counter right by one, discarding the
+		   bit which moved in from the neighbouring counter */
+		table[i] = (table[i] >> 1) & 0x7777777777777777;
+
+	n_samples /= 2;
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * A count-min sketch which estimates how often a key (identified
+ * only by its hash) was accessed recently.  Each key maps to one
+ * 4-bit counter in each of four rows; the estimate is the minimum
+ * of these counters, which may be too high (due to collisions), but
+ * never too low.
+ *
+ * To let old popularity fade away, all counters are halved after a
+ * certain number of increments ("aging").
+ *
+ * This is the frequency estimator of the TinyLFU admission policy.
+ */
+class FrequencySketch {
+	/**
+	 * Each word contains 16 counters; each of the four rows uses
+	 * a different quarter of the word.
+	 */
+	std::unique_ptr<uint_least64_t[]> table;
+
+	/**
+	 * The number of words in #table minus one (the number of
+	 * words is a power of two).
+	 */
+	std::size_t table_mask = 0;
+
+	/**
+	 * After this many increments, all counters are halved.
+	 */
+	std::size_t sample_size = 0;
+
+	/**
+	 * The number of increments since the last aging.
+	 */
+	std::size_t n_samples = 0;
+
+public:
+	static constexpr unsigned MAX_FREQUENCY = 15;
+
+	FrequencySketch() noexcept = default;
+
+	FrequencySketch(const FrequencySketch &) = delete;
+	FrequencySketch &operator=(const FrequencySketch &) = delete;
+
+	/**
+	 * The number of distinct keys this sketch can track with
+	 * good accuracy.
+	 */
+	std::size_t GetCapacity() const noexcept {
+		return table ? table_mask + 1 : 0;
+	}
+
+	/**
+	 * Resize the table so it can track at least the given
+	 * number of keys.  Existing counters are preserved.
+	 */
+	void EnsureCapacity(std::size_t capacity) noexcept;
+
+	/**
+	 * Record one access to the given key.
+	 */
+	void Increment(std::size_t hash) noexcept;
+
+	/**
+	 * Estimate the number of recent accesses to the given key
+	 * (at most #MAX_FREQUENCY).
+	 */
+	[[gnu::pure]]
+	unsigned Estimate(std::size_t hash) const noexcept;
+
+	/**
+	 * Reset all counters to zero.
+	 */
+	void Clear() noexcept;
+
+private:
+	/**
+	 * Halve all counters.
+	 */
+	void Age() noexcept;
+};
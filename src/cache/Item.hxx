@@ -18,12 +18,20 @@
  */
 class CacheItem : public SharedAnchor {
 	friend class Cache;
+	friend class CacheExpiryWheel;
 
 	/**
-	 * This item's siblings, sorted by last access.
+	 * This item's siblings, sorted by last access.  Depending on
+	 * #in_window, this is either the main LRU list or the
+	 * admission window.
 	 */
 	IntrusiveListHook<IntrusiveHookMode::TRACK> sorted_siblings;
 
+	/**
+	 * This item's siblings in a #CacheExpiryWheel slot.
+	 */
+	IntrusiveListHook<IntrusiveHookMode::AUTO_UNLINK> expiry_siblings;
+
 	IntrusiveHashSetHook<IntrusiveHookMode::NORMAL> set_hook;
 
 	/**
@@ -35,6 +43,12 @@ class CacheItem : public SharedAnchor {
 
 	const size_t size;
 
+	/**
+	 * Is this item in the admission window of a #Cache with
+	 * CacheAdmission::TINY_LFU?
+	 */
+	bool in_window = false;
+
 public:
 	CacheItem(StringWithHash _key, std::size_t _size,
 		  std::chrono::steady_clock::time_point _expires) noexcept
@@ -68,6 +82,12 @@ public:
 		return key;
 	}
 
+	/**
+	 * Change the expiry time.  If the item is in a #Cache and the
+	 * new time is earlier, the item may stay there until the old
+	 * expiry time (but Validate() fails); use
+	 * Cache::SetExpires() to avoid that.
+	 */
 	void SetExpires(std::chrono::steady_clock::time_point _expires) noexcept {
 		expires = _expires;
 	}
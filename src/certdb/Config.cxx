@@ -62,6 +62,16 @@ CertDatabaseConfig::ParseLine(const char *word, LineParser &line)
 	} else if (StringIsEqual(word, "ca_cert")) {
 		ca_certs.emplace_front(line.ExpectValueAndEnd());
 		return true;
+	} else if (StringIsEqual(word, "ocsp_staple_dir")) {
+		ocsp_staple_directory = line.ExpectValueAndEnd();
+		return true;
+	} else if (StringIsEqual(word, "prewarm_file")) {
+		prewarm_file = line.ExpectValueAndEnd();
+		return true;
+	} else if (StringIsEqual(word, "prewarm_count")) {
+		prewarm_count = line.NextPositiveInteger();
+		line.ExpectEnd();
+		return true;
 	} else
 		return false;
 }
@@ -7,6 +7,7 @@
 #include "pg/Config.hxx"
 #include "WrapKey.hxx"
 
+#include <cstddef>
 #include <forward_list>
 #include <map>
 #include <string>
@@ -24,6 +25,26 @@ struct CertDatabaseConfig : Pg::Config {
 	 */
 	std::forward_list<std::string> ca_certs;
 
+	/**
+	 * A directory containing DER-encoded OCSP responses to be
+	 * stapled to TLS handshakes, one file per certificate named
+	 * after its lower-case hexadecimal serial number with the
+	 * suffix ".der".  Empty disables OCSP stapling.
+	 */
+	std::string ocsp_staple_directory;
+
+	/**
+	 * If not empty, then the names of the most recently used
+	 * certificates are saved to this file periodically, and
+	 * they are loaded into the cache after a restart.
+	 */
+	std::string prewarm_file;
+
+	/**
+	 * The maximum number of names in #prewarm_file.
+	 */
+	std::size_t prewarm_count = 1000;
+
 	/**
 	 * Throws on error.
 	 *
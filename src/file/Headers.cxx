@@ -15,6 +15,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+using std::string_view_literals::operator""sv;
+
 static constexpr void
 static_etag(char *p, const struct statx &st) noexcept
 {
@@ -70,3 +72,21 @@ static_response_headers(struct pool &pool,
 
 	return headers;
 }
+
+std::string
+file_static_response_headers(const char *content_type,
+			     const struct statx &st) noexcept
+{
+	char date[32];
+	const char *date_end =
+		http_date_format_r(date, std::chrono::system_clock::from_time_t(st.stx_mtime.tv_sec));
+
+	char etag[512];
+	GetAnyETag(etag, st);
+
+	std::string headers;
+	headers.append("last-modified: "sv).append(date, date_end).append("\r\n"sv);
+	headers.append("etag: "sv).append(etag).append("\r\n"sv);
+	headers.append("content-type: "sv).append(content_type).append("\r\n"sv);
+	return headers;
+}
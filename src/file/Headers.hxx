@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <string>
+
 struct pool;
 class StringMap;
 struct statx;
@@ -19,3 +21,14 @@ StringMap
 static_response_headers(struct pool &pool,
 			const struct statx &st,
 			const char *content_type) noexcept;
+
+/**
+ * Generate the response headers which depend only on the file and
+ * not on the current time ("Last-Modified", "ETag" and
+ * "Content-Type").  This is used by #StaticFileCache to generate them
+ * only once per item.
+ */
+[[gnu::nonnull]]
+std::string
+file_static_response_headers(const char *content_type,
+			     const struct statx &st) noexcept;
@@ -215,6 +215,22 @@ FilteredSocket::AfterConsumed() noexcept
 		base.AfterConsumed();
 }
 
+void
+FilteredSocket::FreeInputBufferIfEmpty() noexcept
+{
+	if (filter != nullptr)
+		/* the filter manages (and frees) the raw input buffer
+		   on its own */
+		return;
+
+	if (base.HasUring())
+		/* there may be a pending io_uring receive into this
+		   buffer */
+		return;
+
+	base.GetInputBuffer().FreeIfEmpty();
+}
+
 BufferedReadResult
 FilteredSocket::Read() noexcept
 {
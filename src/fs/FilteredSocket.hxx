@@ -264,6 +264,14 @@ public:
 
 	void AfterConsumed() noexcept;
 
+	/**
+	 * Give the input buffer back to fb_pool if it is empty.  Call
+	 * this when the connection is about to become idle (e.g. HTTP
+	 * keep-alive), so idle connections do not hold a buffer; the
+	 * next read allocates a new one.
+	 */
+	void FreeInputBufferIfEmpty() noexcept;
+
 	bool GetDirect() const noexcept {
 		return base.GetDirect();
 	}
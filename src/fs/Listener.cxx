@@ -12,9 +12,10 @@
 #include "pool/PSocketAddress.hxx"
 #include "ssl/Factory.hxx"
 #include "ssl/Filter.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "net/IPv4Address.hxx"
 #include "net/SocketAddress.hxx"
+#include "net/StaticSocketAddress.hxx"
 #include "io/FdType.hxx"
 
 UniqueSocketDescriptor
@@ -29,6 +30,8 @@ class FilteredSocketListener::Pending final
 	  public AutoUnlinkIntrusiveListHook,
 	  BufferedSocketHandler
 {
+	FilteredSocketListener &listener;
+
 	UniquePoolPtr<FilteredSocket> socket;
 
 	const SocketAddress address;
@@ -38,17 +41,24 @@ class FilteredSocketListener::Pending final
 	FilteredSocketListenerHandler &handler;
 
 public:
-	Pending(PoolPtr &&_pool,
+	Pending(FilteredSocketListener &_listener,
+		PoolPtr &&_pool,
 		UniquePoolPtr<FilteredSocket> &&_socket,
 		SocketAddress _address,
 		const SslFilter *_ssl_filter,
 		FilteredSocketListenerHandler &_handler) noexcept
 		:PoolHolder(std::move(_pool)),
+		 listener(_listener),
 		 socket(std::move(_socket)),
 		 address(DupAddress((AllocatorPtr)pool, _address)),
 		 ssl_filter(_ssl_filter), handler(_handler)
 	{
 		socket->Reinit(Event::Duration(-1), *this);
+		++listener.n_pending;
+	}
+
+	~Pending() noexcept {
+		--listener.n_pending;
 	}
 
 	void Destroy() noexcept {
@@ -117,8 +127,8 @@ FilteredSocketListener::~FilteredSocketListener() noexcept
 }
 
 void
-FilteredSocketListener::OnAccept(UniqueSocketDescriptor s,
-				 SocketAddress address) noexcept
+FilteredSocketListener::AcceptConnection(UniqueSocketDescriptor s,
+					 SocketAddress address) noexcept
 try {
 	IPv4Address ipv4_buffer;
 	if (address.IsDefined() && address.IsV4Mapped())
@@ -157,7 +167,7 @@ try {
 	auto f = ssl_filter_new(ssl_factory->Make());
 	auto &ssl_filter = ssl_filter_cast_from(*f);
 
-	SocketFilterPtr filter(new ThreadSocketFilter(thread_pool_get_queue(event_loop),
+	SocketFilterPtr filter(new ThreadSocketFilter(worker_pool_get(event_loop),
 						      std::move(f)));
 
 	auto socket = UniquePoolPtr<FilteredSocket>::Make(connection_pool,
@@ -169,7 +179,7 @@ try {
 		socket->EnableUring(*uring_queue);
 #endif
 
-	auto *p = NewFromPool<Pending>(std::move(connection_pool),
+	auto *p = NewFromPool<Pending>(*this, std::move(connection_pool),
 				       std::move(socket),
 				       address, &ssl_filter, handler);
 	pending.push_front(*p);
@@ -180,6 +190,33 @@ try {
 	handler.OnFilteredSocketError(std::current_exception());
 }
 
+inline void
+FilteredSocketListener::AcceptBatch() noexcept
+{
+	const auto listen_socket = GetSocket();
+
+	for (unsigned i = 1; i < MAX_ACCEPT_BATCH; ++i) {
+		StaticSocketAddress address;
+		auto s = listen_socket.AcceptNonBlock(address);
+		if (!s.IsDefined())
+			/* the listen queue is empty (EAGAIN) or there
+			   was an error; either way, leave it to
+			   ServerSocket, which will report errors on
+			   the next readiness event */
+			break;
+
+		AcceptConnection(std::move(s), address);
+	}
+}
+
+void
+FilteredSocketListener::OnAccept(UniqueSocketDescriptor s,
+				 SocketAddress address) noexcept
+{
+	AcceptConnection(std::move(s), address);
+	AcceptBatch();
+}
+
 void
 FilteredSocketListener::OnAcceptError(std::exception_ptr e) noexcept
 {
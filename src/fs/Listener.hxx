@@ -8,6 +8,7 @@
 #include "io/uring/config.h" // for HAVE_URING
 #include "util/IntrusiveList.hxx"
 
+#include <cstddef>
 #include <memory>
 
 class PoolPtr;
@@ -46,6 +47,15 @@ public:
  * Listener on a TCP port which gives a #FilteredSocket to its handler.
  */
 class FilteredSocketListener final : public ServerSocket {
+	/**
+	 * The maximum number of connections accepted in one
+	 * readiness event.  Draining the listen queue in batches
+	 * reduces the number of epoll_wait() round trips during
+	 * connection storms; the limit keeps one busy listener from
+	 * starving the rest of the event loop.
+	 */
+	static constexpr unsigned MAX_ACCEPT_BATCH = 32;
+
 	struct pool &parent_pool;
 
 	std::unique_ptr<SslFactory> ssl_factory;
@@ -59,6 +69,12 @@ class FilteredSocketListener final : public ServerSocket {
 	class Pending;
 	IntrusiveList<Pending> pending;
 
+	/**
+	 * The number of items in #pending.  The list uses auto-unlink
+	 * hooks, so it cannot count them in constant time.
+	 */
+	std::size_t n_pending = 0;
+
 public:
 	FilteredSocketListener(struct pool &_pool, EventLoop &event_loop,
 			       std::unique_ptr<SslFactory> _ssl_factory,
@@ -69,6 +85,36 @@ public:
 			       UniqueSocketDescriptor _socket) noexcept;
 	~FilteredSocketListener() noexcept;
 
+	/**
+	 * Add a socket which is already connected (e.g. one side of
+	 * a socketpair()), as if it had been accepted on the
+	 * listener socket.
+	 */
+	void AddConnection(UniqueSocketDescriptor s,
+			   SocketAddress address) noexcept {
+		AcceptConnection(std::move(s), address);
+	}
+
+	/**
+	 * Returns the number of connections which have been accepted
+	 * but have not yet completed the TLS handshake (i.e. which
+	 * have not yet been passed to
+	 * FilteredSocketListenerHandler::OnFilteredSocketConnect()).
+	 */
+	std::size_t GetPendingCount() const noexcept {
+		return n_pending;
+	}
+
+private:
+	void AcceptConnection(UniqueSocketDescriptor s,
+			      SocketAddress address) noexcept;
+
+	/**
+	 * Accept more connections which are already waiting in the
+	 * listen queue, up to #MAX_ACCEPT_BATCH.
+	 */
+	void AcceptBatch() noexcept;
+
 protected:
 	void OnAccept(UniqueSocketDescriptor s,
 		      SocketAddress address) noexcept override;
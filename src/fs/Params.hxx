@@ -34,6 +34,8 @@
 
 #include "Ptr.hxx"
 
+class SocketAddress;
+
 /**
  * Contains pool-allocated parameters to create a
  * #SocketFilterFactory.
@@ -50,6 +52,10 @@ public:
 	/**
 	 * Create a #SocketFilterFactory with these parameters,
 	 * copying parameters from the pool to the standard C++ heap.
+	 *
+	 * @param peer the address of the peer the filter will be
+	 * used with; it may be used to look up cached state (e.g. TLS
+	 * sessions)
 	 */
-	virtual SocketFilterFactoryPtr CreateFactory() const noexcept = 0;
+	virtual SocketFilterFactoryPtr CreateFactory(SocketAddress peer) const noexcept = 0;
 };
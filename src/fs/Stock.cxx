@@ -124,7 +124,7 @@ public:
 				      request.bind_address,
 				      request.address,
 				      request.timeout,
-				      request.filter_params ? request.filter_params->CreateFactory() : nullptr,
+				      request.filter_params ? request.filter_params->CreateFactory(request.address) : nullptr,
 				      *this, cancel_ptr);
 	}
 
@@ -4,19 +4,29 @@
 
 #include "ThreadSocketFilter.hxx"
 #include "FilteredSocket.hxx"
+#include "stats/ThreadSocketFilterStats.hxx"
 #include "memory/fb_pool.hxx"
-#include "thread/Queue.hxx"
+#include "thread/WorkerPool.hxx"
 #include "system/Error.hxx"
 #include "net/SocketProtocolError.hxx"
 
 #include <algorithm>
 #include <utility> // for std::unreachable()
 
-ThreadSocketFilter::ThreadSocketFilter(ThreadQueue &_queue,
+static ThreadSocketFilterStats thread_socket_filter_stats;
+
+const ThreadSocketFilterStats &
+GetThreadSocketFilterStats() noexcept
+{
+	return thread_socket_filter_stats;
+}
+
+ThreadSocketFilter::ThreadSocketFilter(WorkerPool &_queue,
 				       std::unique_ptr<ThreadSocketFilterHandler> _handler) noexcept
 	:queue(_queue),
 	 handler(std::move(_handler)),
 	 defer_event(queue.GetEventLoop(), BIND_THIS_METHOD(OnDeferred)),
+	 inline_done_event(queue.GetEventLoop(), BIND_THIS_METHOD(OnInlineDone)),
 	 handshake_timeout_event(queue.GetEventLoop(),
 				 BIND_THIS_METHOD(HandshakeTimeoutCallback))
 {
@@ -40,8 +50,30 @@ ThreadSocketFilter::Schedule() noexcept
 {
 	assert(!postponed_destroy);
 
+	if (inline_done_event.IsPending()) {
+		/* the Done() call for the previous inline Run() is
+		   still pending, i.e. this job is still busy; let
+		   Done() schedule it again, or else a worker thread
+		   could run it concurrently with Done() */
+		const std::scoped_lock lock{mutex};
+		again = true;
+		return;
+	}
+
 	PreRun();
 
+	if (IsIdle() && handler->WantInlineRun(*this)) {
+		/* cheap enough to be done right here (no worker
+		   thread can access this object now); the Done() call
+		   is deferred because the caller (e.g. Write()) does
+		   not expect to be called back */
+		++thread_socket_filter_stats.n_inline_runs;
+		Run();
+		inline_done_event.Schedule();
+		return;
+	}
+
+	++thread_socket_filter_stats.n_offloaded_runs;
 	queue.Add(*this);
 }
 
@@ -246,6 +278,9 @@ ThreadSocketFilter::Run() noexcept
 void
 ThreadSocketFilter::Done() noexcept
 try {
+	/* this Done() call covers an inline Run() as well */
+	inline_done_event.Cancel();
+
 	if (postponed_destroy) {
 		/* the object has been closed, and now that the thread has
 		   finished, we can finally destroy it */
@@ -5,7 +5,7 @@
 #pragma once
 
 #include "SocketFilter.hxx"
-#include "thread/Job.hxx"
+#include "thread/WorkerJob.hxx"
 #include "event/DeferEvent.hxx"
 #include "event/CoarseTimerEvent.hxx"
 #include "memory/SliceFifoBuffer.hxx"
@@ -17,7 +17,8 @@
 
 class FilteredSocket;
 struct ThreadSocketFilterInternal;
-class ThreadQueue;
+struct ThreadSocketFilterStats;
+class WorkerPool;
 
 class ThreadSocketFilterHandler {
 	using ScheduleRunFunction = BoundMethod<void() noexcept>;
@@ -46,6 +47,19 @@ public:
 	 */
 	virtual void PreRun(ThreadSocketFilterInternal &) noexcept {}
 
+	/**
+	 * Is the pending work so cheap that Run() shall be called
+	 * synchronously in the main thread?  For small amounts of
+	 * data, the two thread switches cost more than the work
+	 * itself.
+	 *
+	 * This is called in the main thread after PreRun(), and only
+	 * while no Run() call is queued or running.
+	 */
+	virtual bool WantInlineRun(const ThreadSocketFilterInternal &) const noexcept {
+		return false;
+	}
+
 	/**
 	 * Do the work.  This is run in an unspecified worker thread.  The
 	 * given #ThreadSocketFilter's mutex may be used for protection.
@@ -73,7 +87,7 @@ public:
 	virtual void CancelRun(ThreadSocketFilterInternal &) noexcept {}
 };
 
-struct ThreadSocketFilterInternal : ThreadJob {
+struct ThreadSocketFilterInternal : WorkerJob {
 	/**
 	 * True when #ThreadSocketFilterHandler's internal output buffers
 	 * are empty.  Set by #ThreadSocketFilterHandler::Run() before
@@ -152,10 +166,10 @@ struct ThreadSocketFilterInternal : ThreadJob {
 
 /**
  * A module for #FilteredSocket that moves the filter to a thread
- * pool (see #ThreadJob).
+ * pool (see #WorkerJob).
  */
 class ThreadSocketFilter final : public SocketFilter, ThreadSocketFilterInternal {
-	ThreadQueue &queue;
+	WorkerPool &queue;
 
 	FilteredSocket *socket;
 
@@ -174,6 +188,13 @@ class ThreadSocketFilter final : public SocketFilter, ThreadSocketFilterInternal
 	 */
 	DeferEvent defer_event;
 
+	/**
+	 * After Run() has been called synchronously in the main
+	 * thread, this event calls Done() (outside of the caller's
+	 * stack frame).
+	 */
+	DeferEvent inline_done_event;
+
 	/**
 	 *
 	 */
@@ -197,7 +218,7 @@ class ThreadSocketFilter final : public SocketFilter, ThreadSocketFilterInternal
 
 	/**
 	 * Set to true when the thread queue hasn't yet released the
-	 * #ThreadJob.  The object will be destroyed in the "done"
+	 * #WorkerJob.  The object will be destroyed in the "done"
 	 * callback.
 	 */
 	bool postponed_destroy = false;
@@ -231,7 +252,7 @@ class ThreadSocketFilter final : public SocketFilter, ThreadSocketFilterInternal
 	std::exception_ptr error;
 
 public:
-	ThreadSocketFilter(ThreadQueue &queue,
+	ThreadSocketFilter(WorkerPool &queue,
 			   std::unique_ptr<ThreadSocketFilterHandler> _handler) noexcept;
 
 	ThreadSocketFilter(const ThreadSocketFilter &) = delete;
@@ -244,7 +265,9 @@ public:
 
 private:
 	/**
-	 * Schedule a Run() call in a worker thread.
+	 * Schedule a Run() call in a worker thread (or call it right
+	 * away if ThreadSocketFilterHandler::WantInlineRun() says
+	 * so).
 	 */
 	void Schedule() noexcept;
 
@@ -296,7 +319,11 @@ private:
 	 */
 	void OnDeferred() noexcept;
 
-	/* virtual methods from class ThreadJob */
+	void OnInlineDone() noexcept {
+		Done();
+	}
+
+	/* virtual methods from class WorkerJob */
 	void Run() noexcept final;
 	void Done() noexcept final;
 
@@ -327,3 +354,11 @@ public:
 	void OnEnd() override;
 	void Close() noexcept override;
 };
+
+/**
+ * Return the counters of all #ThreadSocketFilter instances of this
+ * process.
+ */
+[[gnu::const]]
+const ThreadSocketFilterStats &
+GetThreadSocketFilterStats() noexcept;
@@ -34,6 +34,7 @@ constexpr StringMapKey if_none_match_header{"if-none-match"};
 constexpr StringMapKey if_unmodified_since_header{"if-unmodified-since"};
 constexpr StringMapKey host_header{"host"};
 constexpr StringMapKey last_modified_header{"last-modified"};
+constexpr StringMapKey link_header{"link"};
 constexpr StringMapKey location_header{"location"};
 constexpr StringMapKey pragma_header{"pragma"};
 constexpr StringMapKey proxy_authenticate_header{"proxy-authenticate"};
@@ -43,6 +44,7 @@ constexpr StringMapKey server_header{"server"};
 constexpr StringMapKey set_cookie_header{"set-cookie"};
 constexpr StringMapKey set_cookie2_header{"set-cookie2"};
 constexpr StringMapKey status_header{"status"}; // for CGI
+constexpr StringMapKey traceparent_header{"traceparent"};
 constexpr StringMapKey transfer_encoding_header{"transfer-encoding"};
 constexpr StringMapKey upgrade_header{"upgrade"};
 constexpr StringMapKey user_agent_header{"user-agent"};
@@ -80,6 +80,14 @@ public:
 				  HttpHeaders &&response_headers,
 				  UnusedIstreamPtr response_body) noexcept = 0;
 
+	/**
+	 * Send a "103 Early Hints" informational response (RFC 8297)
+	 * with the given "Link" header value.  This may only be
+	 * called before SendResponse().  Implementations which
+	 * cannot send informational responses ignore this call.
+	 */
+	virtual void SendEarlyHints([[maybe_unused]] std::string_view link) noexcept {}
+
 	/**
 	 * Generate a "simple" response with an optional plain-text body and
 	 * an optional "Location" redirect header.
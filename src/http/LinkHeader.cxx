@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "LinkHeader.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringCompare.hxx"
+#include "util/StringStrip.hxx"
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * Find the end of one "link-value", i.e. the next comma which is
+ * not inside the URI reference or a quoted string.
+ */
+[[gnu::pure]]
+static std::size_t
+FindLinkValueEnd(std::string_view s) noexcept
+{
+	bool in_uri = false, in_quotes = false;
+
+	for (std::size_t i = 0; i < s.size(); ++i) {
+		const char ch = s[i];
+
+		if (in_quotes) {
+			if (ch == '\\')
+				++i;
+			else if (ch == '"')
+				in_quotes = false;
+		} else if (in_uri) {
+			if (ch == '>')
+				in_uri = false;
+		} else if (ch == '<')
+			in_uri = true;
+		else if (ch == '"')
+			in_quotes = true;
+		else if (ch == ',')
+			return i;
+	}
+
+	return s.size();
+}
+
+[[gnu::pure]]
+static bool
+IsEarlyHintRelation(std::string_view rel) noexcept
+{
+	if (rel.size() >= 2 && rel.front() == '"' && rel.back() == '"')
+		rel = rel.substr(1, rel.size() - 2);
+
+	/* "rel" may contain a space-separated list of relation
+	   types (RFC 8288 3.3) */
+	for (const std::string_view type : IterableSplitString(rel, ' '))
+		if (StringIsEqualIgnoreCase(type, "preload"sv) ||
+		    StringIsEqualIgnoreCase(type, "preconnect"sv))
+			return true;
+
+	return false;
+}
+
+/**
+ * Does this "link-value" have a relation type which is useful in
+ * "103 Early Hints"?
+ */
+[[gnu::pure]]
+static bool
+IsEarlyHintLink(std::string_view link) noexcept
+{
+	if (!link.starts_with('<'))
+		return false;
+
+	const auto gt = link.find('>');
+	if (gt == link.npos)
+		return false;
+
+	/* a quoted parameter value containing a semicolon is not
+	   split correctly here, but that is only possible with
+	   parameters other than "rel" */
+	for (std::string_view param : IterableSplitString(link.substr(gt + 1), ';')) {
+		param = Strip(param);
+
+		const auto eq = param.find('=');
+		if (eq == param.npos)
+			continue;
+
+		if (StringIsEqualIgnoreCase(StripRight(param.substr(0, eq)), "rel"sv))
+			return IsEarlyHintRelation(StripLeft(param.substr(eq + 1)));
+	}
+
+	return false;
+}
+
+std::string
+ExtractEarlyHintLinks(std::string_view value) noexcept
+{
+	std::string result;
+
+	while (!value.empty()) {
+		const auto end = FindLinkValueEnd(value);
+		const auto link = Strip(value.substr(0, end));
+		value = end < value.size() ? value.substr(end + 1) : std::string_view{};
+
+		if (!IsEarlyHintLink(link))
+			continue;
+
+		if (!result.empty())
+			result.append(", "sv);
+		result.append(link);
+	}
+
+	return result;
+}
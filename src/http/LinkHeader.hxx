@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/**
+ * Extract those links from a "Link" response header (RFC 8288)
+ * which are useful in a "103 Early Hints" response (RFC 8297),
+ * i.e. the ones with "rel=preload" or "rel=preconnect".
+ *
+ * @return a comma-separated list of links (to be used as "Link"
+ * header value) or an empty string if there are none
+ */
+std::string
+ExtractEarlyHintLinks(std::string_view value) noexcept;
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Disk.hxx"
+#include "DiskConfig.hxx"
+#include "Item.hxx"
+#include "memory/AllocatorStats.hxx"
+#include "istream/FailIstream.hxx"
+#include "istream/FileIstream.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "pool/pool.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "lib/fmt/ToBuffer.hxx"
+#include "io/Open.hxx"
+#include "io/SharedFd.hxx"
+#include "AllocatorPtr.hxx"
+#include "util/CharUtil.hxx"
+
+#ifdef HAVE_URING
+#include "istream/UringIstream.hxx"
+#endif
+
+#include <algorithm> // for std::all_of()
+#include <string_view>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static auto
+FormatName(uint_least64_t id) noexcept
+{
+	return FmtBuffer<24>("{:016x}", id);
+}
+
+/**
+ * Does this file name look like it was generated by FormatName()?
+ */
+[[gnu::pure]]
+static bool
+IsCacheFileName(std::string_view name) noexcept
+{
+	return name.size() == 16 &&
+		std::all_of(name.begin(), name.end(), [](char ch){
+			return IsDigitASCII(ch) || (ch >= 'a' && ch <= 'f');
+		});
+}
+
+HttpCacheDisk::HttpCacheDisk(struct pool &_pool, EventLoop &event_loop,
+#ifdef HAVE_URING
+			     Uring::Queue *_uring,
+#endif
+			     const HttpCacheDiskConfig &config,
+			     CacheAdmission admission)
+	:pool(_pool),
+	 directory(OpenDirectory(config.path.c_str())),
+#ifdef HAVE_URING
+	 uring(_uring),
+#endif
+	 slice_pool(1024, 65536, "http_cache_disk_meta"),
+	 cache(event_loop, config.max_size, nullptr, admission),
+	 max_object_size(config.max_object_size)
+{
+	Wipe();
+}
+
+HttpCacheDisk::~HttpCacheDisk() noexcept = default;
+
+void
+HttpCacheDisk::Wipe() noexcept
+{
+	/* fdopendir() takes ownership of the file descriptor, so
+	   pass a duplicate */
+	const int fd = fcntl(directory.Get(), F_DUPFD_CLOEXEC, 0);
+	if (fd < 0)
+		return;
+
+	DIR *dir = fdopendir(fd);
+	if (dir == nullptr) {
+		close(fd);
+		return;
+	}
+
+	while (const auto *e = readdir(dir))
+		/* delete only our own files, just in case the
+		   directory was misconfigured and contains other
+		   data */
+		if ((e->d_type == DT_REG || e->d_type == DT_UNKNOWN) &&
+		    IsCacheFileName(e->d_name))
+			/* errors (e.g. EISDIR) are ignored */
+			unlinkat(directory.Get(), e->d_name, 0);
+
+	closedir(dir);
+}
+
+AllocatorStats
+HttpCacheDisk::GetStats() const noexcept
+{
+	return slice_pool.GetStats();
+}
+
+std::pair<uint_least64_t, UniqueFileDescriptor>
+HttpCacheDisk::CreateFile()
+{
+	const uint_least64_t id = next_id++;
+	const auto name = FormatName(id);
+
+	UniqueFileDescriptor fd;
+	if (!fd.Open({directory, name.c_str()},
+		     O_CREAT|O_EXCL|O_WRONLY|O_NOFOLLOW, 0600))
+		throw FmtErrno("Failed to create disk cache file {}", name.c_str());
+
+	return {id, std::move(fd)};
+}
+
+void
+HttpCacheDisk::Unlink(uint_least64_t id) noexcept
+{
+	unlinkat(directory.Get(), FormatName(id).c_str(), 0);
+}
+
+UnusedIstreamPtr
+HttpCacheDisk::OpenFile(struct pool &_pool, uint_least64_t id,
+			off_t start, off_t end) noexcept
+{
+	const auto name = FormatName(id);
+
+	UniqueFileDescriptor fd;
+	if (!fd.Open({directory, name.c_str()}, O_RDONLY|O_NOFOLLOW))
+		return istream_fail_new(_pool,
+					std::make_exception_ptr(FmtErrno("Failed to open disk cache file {}",
+									 name.c_str())));
+
+	/* the path is only used for error messages */
+	const char *path = p_strdup(_pool, name.c_str());
+
+	auto *shared_fd = new SharedFd(std::move(fd));
+
+#ifdef HAVE_URING
+	if (uring != nullptr) {
+		shared_fd->EnableUring(*uring);
+		return NewUringIstream(*uring, _pool, path,
+				       shared_fd->Get(), *shared_fd,
+				       start, end);
+	}
+#endif
+
+	return istream_file_fd_new(cache.GetEventLoop(), _pool, path,
+				   shared_fd->Get(), *shared_fd,
+				   start, end);
+}
+
+HttpCacheDocument *
+HttpCacheDisk::Get(StringWithHash key, StringMap &request_headers) noexcept
+{
+	return (HttpCacheItem *)cache.GetMatch(key,
+					       {&request_headers, HttpCacheItem::MatchVary});
+}
+
+void
+HttpCacheDisk::Put(StringWithHash key, const char *tag,
+		   const HttpCacheResponseInfo &info,
+		   const StringMap &request_headers,
+		   HttpStatus status,
+		   const StringMap &response_headers,
+		   uint_least64_t id, size_t size) noexcept
+{
+	auto new_pool = pool_new_slice(pool, "http_cache_disk_item", slice_pool);
+	const AllocatorPtr alloc{new_pool};
+	key = alloc.Dup(key);
+
+	auto item = NewFromPool<HttpCacheItem>(std::move(new_pool), key,
+					       cache.SteadyNow(),
+					       cache.SystemNow(),
+					       tag,
+					       info, request_headers,
+					       status, response_headers,
+					       size,
+					       *this, id);
+
+	if (tag != nullptr)
+		per_tag.insert(*item);
+
+	cache.PutMatch(*item,
+		       {const_cast<void *>((const void *)&request_headers), HttpCacheItem::MatchVary});
+}
+
+void
+HttpCacheDisk::Remove(StringWithHash key, const StringMap &headers) noexcept
+{
+	cache.RemoveKeyIf(key, [&headers](const CacheItem &_item){
+		const auto &item = static_cast<const HttpCacheItem &>(_item);
+		return item.VaryFits(headers);
+	});
+}
+
+void
+HttpCacheDisk::Flush() noexcept
+{
+	cache.Flush();
+	slice_pool.Compress();
+}
+
+void
+HttpCacheDisk::FlushTag(std::string_view tag) noexcept
+{
+	per_tag.remove_and_dispose_key(tag, [this](auto *item){
+		cache.Remove(*item);
+	});
+}
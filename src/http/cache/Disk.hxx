@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Item.hxx"
+#include "cache/Cache.hxx"
+#include "memory/SlicePool.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "io/uring/config.h" // for HAVE_URING
+#include "util/IntrusiveHashSet.hxx"
+#include "util/TransparentHash.hxx"
+
+#include <cstdint>
+#include <utility>
+
+#include <sys/types.h>
+
+enum class HttpStatus : uint_least16_t;
+struct pool;
+class UnusedIstreamPtr;
+class EventLoop;
+class StringMap;
+struct AllocatorStats;
+struct HttpCacheResponseInfo;
+struct HttpCacheDocument;
+struct HttpCacheDiskConfig;
+namespace Uring { class Queue; }
+
+/**
+ * The on-disk tier of the HTTP cache.  Each response body is stored
+ * in a file (named after a serial number) in one directory; the
+ * metadata is kept in memory, just like in #HttpCacheHeap.  Since
+ * the metadata does not survive a restart, the directory is wiped
+ * by the constructor.
+ */
+class HttpCacheDisk {
+	struct pool &pool;
+
+	/**
+	 * The directory containing all files.  This must be declared
+	 * before #cache, because destroying items deletes their
+	 * files.
+	 */
+	const UniqueFileDescriptor directory;
+
+#ifdef HAVE_URING
+	Uring::Queue *const uring;
+#endif
+
+	SlicePool slice_pool;
+
+	Cache cache;
+
+	/**
+	 * Lookup table to speed up FlushTag().
+	 */
+	IntrusiveHashSet<HttpCacheItem, 65536,
+			 IntrusiveHashSetOperators<HttpCacheItem,
+						   HttpCacheItem::GetTagFunction,
+						   TransparentHash,
+						   std::equal_to<std::string_view>>,
+			 IntrusiveHashSetMemberHookTraits<&HttpCacheItem::per_tag_hook>> per_tag;
+
+	const off_t max_object_size;
+
+	/**
+	 * The serial number of the next file.
+	 */
+	uint_least64_t next_id = 0;
+
+public:
+	/**
+	 * Throws if the directory cannot be opened.
+	 */
+	HttpCacheDisk(struct pool &pool, EventLoop &event_loop,
+#ifdef HAVE_URING
+		      Uring::Queue *uring,
+#endif
+		      const HttpCacheDiskConfig &config,
+		      CacheAdmission admission);
+	~HttpCacheDisk() noexcept;
+
+	HttpCacheDisk(const HttpCacheDisk &) = delete;
+	HttpCacheDisk &operator=(const HttpCacheDisk &) = delete;
+
+#ifdef HAVE_URING
+	Uring::Queue *GetUring() const noexcept {
+		return uring;
+	}
+#endif
+
+	off_t GetMaxObjectSize() const noexcept {
+		return max_object_size;
+	}
+
+	[[gnu::pure]]
+	AllocatorStats GetStats() const noexcept;
+
+	void FillStats(CacheStats &stats) const noexcept {
+		cache.FillStats(stats);
+	}
+
+	/**
+	 * Create a new (empty) file.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the file's serial number and a file descriptor
+	 * opened for writing
+	 */
+	std::pair<uint_least64_t, UniqueFileDescriptor> CreateFile();
+
+	/**
+	 * Delete a file which was created with CreateFile().
+	 */
+	void Unlink(uint_least64_t id) noexcept;
+
+	/**
+	 * Open a portion of a file for reading (with io_uring if
+	 * available).  On error, the returned stream fails.
+	 *
+	 * @param end the end offset (exclusive)
+	 */
+	UnusedIstreamPtr OpenFile(struct pool &_pool, uint_least64_t id,
+				  off_t start, off_t end) noexcept;
+
+	HttpCacheDocument *Get(StringWithHash key,
+			       StringMap &request_headers) noexcept;
+
+	/**
+	 * Add a file which was created with CreateFile() to the
+	 * cache.  It will be deleted when the item gets removed.
+	 */
+	void Put(StringWithHash key, const char *tag,
+		 const HttpCacheResponseInfo &info,
+		 const StringMap &request_headers,
+		 HttpStatus status,
+		 const StringMap &response_headers,
+		 uint_least64_t id, size_t size) noexcept;
+
+	void Remove(HttpCacheItem &item) noexcept {
+		cache.Remove(item);
+	}
+
+	void Remove(StringWithHash key, const StringMap &headers) noexcept;
+
+	void Flush() noexcept;
+	void FlushTag(std::string_view tag) noexcept;
+
+private:
+	/**
+	 * Delete all regular files from the directory.
+	 */
+	void Wipe() noexcept;
+};
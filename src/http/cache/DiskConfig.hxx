@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Configuration of the optional on-disk tier of the HTTP cache,
+ * which stores response bodies that are too large for the rubber
+ * heap.
+ */
+struct HttpCacheDiskConfig {
+	/**
+	 * The directory where response bodies are stored.  All
+	 * regular files in it are deleted on startup.  An empty
+	 * string disables the disk tier.
+	 */
+	std::string path;
+
+	/**
+	 * The maximum total size of all items on disk.
+	 */
+	std::size_t max_size = 0;
+
+	/**
+	 * Responses larger than this are not cached at all.
+	 */
+	std::size_t max_object_size = 64 * 1024 * 1024;
+
+	/**
+	 * Promote a small item (one that was demoted from the rubber
+	 * heap) back to memory after this number of hits on disk.  0
+	 * disables promotion.
+	 */
+	unsigned promote_hits = 4;
+
+	bool IsEnabled() const noexcept {
+		return !path.empty() && max_size > 0;
+	}
+};
@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "DiskSink.hxx"
+#include "Disk.hxx"
+#include "istream/Sink.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "pool/pool.hxx"
+#include "pool/LeakDetector.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/Cancellable.hxx"
+
+#ifdef HAVE_URING
+#include "io/uring/Operation.hxx"
+#include "io/uring/Queue.hxx"
+#include "memory/fb_pool.hxx"
+#include "memory/SliceFifoBuffer.hxx"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <utility> // for std::cmp_greater()
+
+#include <fcntl.h> // for fallocate()
+#include <unistd.h> // for pwrite()
+
+class HttpCacheDiskSink final : IstreamSink, Cancellable, PoolLeakDetector {
+#ifdef HAVE_URING
+	/**
+	 * Writes data from the #buffer to the file.  This is a
+	 * separate allocation because the kernel may still read from
+	 * the buffer after the #HttpCacheDiskSink has been destroyed.
+	 */
+	struct WriteOperation final : Uring::Operation {
+		HttpCacheDiskSink &parent;
+		Uring::Queue &queue;
+
+		const UniqueFileDescriptor fd;
+
+		SliceFifoBuffer buffer;
+
+		/**
+		 * The file offset of the next write operation.
+		 */
+		off_t offset = 0;
+
+		bool released = false;
+
+		WriteOperation(HttpCacheDiskSink &_parent, Uring::Queue &_queue,
+			       UniqueFileDescriptor &&_fd) noexcept
+			:parent(_parent), queue(_queue), fd(std::move(_fd)) {}
+
+		void Release() noexcept;
+
+		/**
+		 * Submit a write for all data in the #buffer.
+		 *
+		 * Throws on error.
+		 */
+		void Start();
+
+		/* virtual methods from class Uring::Operation */
+		void OnUringCompletion(int res) noexcept override;
+	};
+
+	/**
+	 * If this is set, then data is written with io_uring; else
+	 * with pwrite() to #fd.
+	 */
+	WriteOperation *write_operation = nullptr;
+#endif
+
+	HttpCacheDisk &disk;
+
+	const uint_least64_t id;
+
+	UniqueFileDescriptor fd;
+
+	const off_t max_size;
+
+	/**
+	 * The number of bytes received from the input.
+	 */
+	off_t position = 0;
+
+	HttpCacheDiskSinkHandler &handler;
+
+	/**
+	 * Has the file been handed over to the handler?  If not, the
+	 * destructor deletes it.
+	 */
+	bool committed = false;
+
+public:
+	HttpCacheDiskSink(struct pool &_pool, UnusedIstreamPtr &&_input,
+			  HttpCacheDisk &_disk,
+			  uint_least64_t _id, UniqueFileDescriptor &&_fd,
+			  off_t _max_size,
+			  HttpCacheDiskSinkHandler &_handler,
+			  CancellablePointer &cancel_ptr) noexcept
+		:IstreamSink(std::move(_input)),
+		 PoolLeakDetector(_pool),
+		 disk(_disk), id(_id), fd(std::move(_fd)),
+		 max_size(_max_size),
+		 handler(_handler)
+	{
+#ifdef HAVE_URING
+		if (auto *uring = disk.GetUring())
+			write_operation = new WriteOperation(*this, *uring,
+							     std::move(fd));
+#endif
+
+		cancel_ptr = *this;
+	}
+
+	~HttpCacheDiskSink() noexcept {
+#ifdef HAVE_URING
+		if (write_operation != nullptr)
+			write_operation->Release();
+#endif
+
+		if (!committed)
+			disk.Unlink(id);
+	}
+
+	void Read() noexcept {
+		input.Read();
+	}
+
+private:
+	void Destroy() noexcept {
+		this->~HttpCacheDiskSink();
+	}
+
+	void DestroyDone() noexcept;
+	void DestroyTooLarge() noexcept;
+	void DestroyError(std::exception_ptr &&ep) noexcept;
+
+#ifdef HAVE_URING
+	bool IsWritePending() const noexcept {
+		return write_operation != nullptr &&
+			write_operation->IsUringPending();
+	}
+
+	void OnWriteComplete() noexcept;
+	void OnWriteError(int error) noexcept;
+#endif
+
+	/* virtual methods from class Cancellable */
+	void Cancel() noexcept override;
+
+	/* virtual methods from class IstreamHandler */
+	std::size_t OnData(std::span<const std::byte> src) noexcept override;
+	void OnEof() noexcept override;
+	void OnError(std::exception_ptr &&ep) noexcept override;
+};
+
+void
+HttpCacheDiskSink::DestroyDone() noexcept
+{
+	committed = true;
+
+	auto &_handler = handler;
+	const std::size_t size = position;
+	Destroy();
+	_handler.OnDiskSinkDone(size);
+}
+
+void
+HttpCacheDiskSink::DestroyTooLarge() noexcept
+{
+	auto &_handler = handler;
+	Destroy();
+	_handler.OnDiskSinkTooLarge();
+}
+
+void
+HttpCacheDiskSink::DestroyError(std::exception_ptr &&ep) noexcept
+{
+	auto &_handler = handler;
+	Destroy();
+	_handler.OnDiskSinkError(std::move(ep));
+}
+
+#ifdef HAVE_URING
+
+inline void
+HttpCacheDiskSink::WriteOperation::Release() noexcept
+{
+	assert(!released);
+
+	if (IsUringPending()) {
+		/* the kernel may still be reading from the buffer;
+		   OnUringCompletion() will free it */
+
+		if (auto *s = queue.GetSubmitEntry()) {
+			io_uring_prep_cancel(s, GetUringData(), 0);
+			io_uring_sqe_set_data(s, nullptr);
+			io_uring_sqe_set_flags(s, IOSQE_CQE_SKIP_SUCCESS);
+			queue.Submit();
+		}
+
+		released = true;
+	} else
+		delete this;
+}
+
+inline void
+HttpCacheDiskSink::WriteOperation::Start()
+{
+	assert(!IsUringPending());
+
+	const auto r = buffer.Read();
+	assert(!r.empty());
+
+	auto &s = queue.RequireSubmitEntry();
+	io_uring_prep_write(&s, fd.Get(), r.data(), r.size(), offset);
+	queue.Push(s, *this);
+}
+
+void
+HttpCacheDiskSink::WriteOperation::OnUringCompletion(int res) noexcept
+{
+	if (released) {
+		delete this;
+		return;
+	}
+
+	if (res < 0) {
+		parent.OnWriteError(-res);
+		return;
+	}
+
+	buffer.Consume(res);
+	offset += res;
+
+	if (!buffer.empty()) {
+		/* short write: submit the rest */
+		try {
+			Start();
+		} catch (...) {
+			parent.DestroyError(std::current_exception());
+		}
+
+		return;
+	}
+
+	parent.OnWriteComplete();
+}
+
+inline void
+HttpCacheDiskSink::OnWriteComplete() noexcept
+{
+	if (!HasInput()) {
+		/* the input has already ended while this write was
+		   pending */
+		DestroyDone();
+		return;
+	}
+
+	input.Read();
+}
+
+inline void
+HttpCacheDiskSink::OnWriteError(int error) noexcept
+{
+	DestroyError(std::make_exception_ptr(FmtErrno(error,
+						      "Failed to write to disk cache file {:016x}",
+						      id)));
+}
+
+#endif // HAVE_URING
+
+/*
+ * istream handler
+ *
+ */
+
+std::size_t
+HttpCacheDiskSink::OnData(std::span<const std::byte> src) noexcept
+{
+	assert(position <= max_size);
+
+	if (position + static_cast<off_t>(src.size()) > max_size) {
+		DestroyTooLarge();
+		return 0;
+	}
+
+#ifdef HAVE_URING
+	if (write_operation != nullptr) {
+		if (write_operation->IsUringPending())
+			/* wait for the pending write to complete;
+			   OnWriteComplete() resumes reading */
+			return 0;
+
+		auto &buffer = write_operation->buffer;
+		if (buffer.IsNull())
+			buffer.Allocate(fb_pool_get());
+
+		const auto w = buffer.Write();
+		const std::size_t nbytes = std::min(w.size(), src.size());
+		std::copy_n(src.begin(), nbytes, w.begin());
+		buffer.Append(nbytes);
+		position += nbytes;
+
+		try {
+			write_operation->Start();
+		} catch (...) {
+			DestroyError(std::current_exception());
+			return 0;
+		}
+
+		return nbytes;
+	}
+#endif
+
+	const ssize_t nbytes = pwrite(fd.Get(), src.data(), src.size(), position);
+	if (nbytes < 0) {
+		DestroyError(std::make_exception_ptr(FmtErrno("Failed to write to disk cache file {:016x}",
+							      id)));
+		return 0;
+	}
+
+	position += nbytes;
+	return nbytes;
+}
+
+void
+HttpCacheDiskSink::OnEof() noexcept
+{
+	assert(HasInput());
+	ClearInput();
+
+#ifdef HAVE_URING
+	if (IsWritePending())
+		/* finish after the pending write has completed */
+		return;
+#endif
+
+	DestroyDone();
+}
+
+void
+HttpCacheDiskSink::OnError(std::exception_ptr &&ep) noexcept
+{
+	assert(HasInput());
+	ClearInput();
+
+	DestroyError(std::move(ep));
+}
+
+/*
+ * async operation
+ *
+ */
+
+void
+HttpCacheDiskSink::Cancel() noexcept
+{
+	Destroy();
+}
+
+/*
+ * constructor
+ *
+ */
+
+HttpCacheDiskSink *
+NewHttpCacheDiskSink(struct pool &pool, UnusedIstreamPtr input,
+		     HttpCacheDisk &disk,
+		     uint_least64_t id, UniqueFileDescriptor &&fd,
+		     off_t max_size,
+		     HttpCacheDiskSinkHandler &handler,
+		     CancellablePointer &cancel_ptr) noexcept
+{
+	const auto length = input.GetLength();
+	if (std::cmp_greater(length.length, max_size)) {
+		input.Clear();
+		disk.Unlink(id);
+		handler.OnDiskSinkTooLarge();
+		return nullptr;
+	}
+
+	if (length.exhaustive && length.length > 0)
+		/* reserve the disk space in one step to reduce
+		   fragmentation; this is only an optimization, so
+		   errors are ignored */
+		(void)fallocate(fd.Get(), 0, 0, length.length);
+
+	return NewFromPool<HttpCacheDiskSink>(pool, pool, std::move(input),
+					      disk, id, std::move(fd),
+					      max_size,
+					      handler, cancel_ptr);
+}
+
+void
+ReadHttpCacheDiskSink(HttpCacheDiskSink &sink) noexcept
+{
+	sink.Read();
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+#include <sys/types.h>
+
+struct pool;
+class UnusedIstreamPtr;
+class UniqueFileDescriptor;
+class HttpCacheDisk;
+class HttpCacheDiskSink;
+class CancellablePointer;
+
+class HttpCacheDiskSinkHandler {
+public:
+	/**
+	 * The whole stream has been written to the file.  The
+	 * ownership of the file is passed to the handler.
+	 */
+	virtual void OnDiskSinkDone(std::size_t size) noexcept = 0;
+
+	virtual void OnDiskSinkTooLarge() noexcept = 0;
+	virtual void OnDiskSinkError(std::exception_ptr ep) noexcept = 0;
+};
+
+/**
+ * An istream sink that writes data into a file of the
+ * #HttpCacheDisk (using io_uring if available).  Unless
+ * HttpCacheDiskSinkHandler::OnDiskSinkDone() is invoked, the file
+ * gets deleted.
+ *
+ * @param id the file which was created with
+ * HttpCacheDisk::CreateFile()
+ */
+HttpCacheDiskSink *
+NewHttpCacheDiskSink(struct pool &pool, UnusedIstreamPtr input,
+		     HttpCacheDisk &disk,
+		     uint_least64_t id, UniqueFileDescriptor &&fd,
+		     off_t max_size,
+		     HttpCacheDiskSinkHandler &handler,
+		     CancellablePointer &cancel_ptr) noexcept;
+
+void
+ReadHttpCacheDiskSink(HttpCacheDiskSink &sink) noexcept;
@@ -3,6 +3,7 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "EncodingCache.hxx"
+#include "Recompress.hxx"
 #include "istream/Length.hxx"
 #include "istream/UnusedPtr.hxx"
 #include "istream/SharedLeaseIstream.hxx"
@@ -13,14 +14,29 @@
 #include "pool/pool.hxx"
 #include "event/CoarseTimerEvent.hxx"
 #include "event/Loop.hxx"
+#include "thread/WorkerJob.hxx"
+#include "thread/WorkerPool.hxx"
 #include "io/Logger.hxx"
 #include "util/Cancellable.hxx"
 #include "util/LeakDetector.hxx"
 
+#include <algorithm> // for std::copy()
 #include <string>
 
 static constexpr off_t cacheable_size_limit = 512 * 1024;
 
+/**
+ * After this number of hits, an item is considered "hot" and will be
+ * recompressed with the maximum quality.
+ */
+static constexpr unsigned recompress_hits = 16;
+
+/**
+ * Refuse to recompress items which decompress to more than this
+ * number of bytes.
+ */
+static constexpr std::size_t recompress_max_uncompressed_size = 16 * 1024 * 1024;
+
 /**
  * The default "expires" duration [s] if no expiration was given for
  * the input.
@@ -37,21 +53,51 @@ public:
 		:key(_key) {}
 };
 
-struct EncodingCache::Item final : EncodingCacheItemKey, CacheItem, LeakDetector {
+/**
+ * The #AutoUnlinkIntrusiveListHook is used for
+ * EncodingCache::recompress_candidates.
+ */
+struct EncodingCache::Item final : EncodingCacheItemKey, CacheItem, AutoUnlinkIntrusiveListHook, LeakDetector {
 	const std::string key;
 
 
 	const RubberAllocation allocation;
 
-	Item(StringWithHash _key,
+	/**
+	 * The "Content-Encoding" of the data.
+	 */
+	const std::string encoding;
+
+	/**
+	 * Is this text?  This is a hint for the Brotli encoder.
+	 */
+	const bool text_mode;
+
+	/**
+	 * The number of cache hits; used to find candidates for
+	 * recompression.
+	 */
+	unsigned hits = 0;
+
+	/**
+	 * Has this item already been recompressed with the maximum
+	 * quality (or has an attempt been made)?  This is also set if
+	 * this build does not support recompressing the encoding.
+	 */
+	bool recompressed;
+
+	Item(StringWithHash _key, std::string_view _encoding, bool _text_mode,
 	     std::chrono::steady_clock::time_point now,
 	     std::chrono::system_clock::time_point system_now,
-	     std::size_t _size, RubberAllocation &&_allocation) noexcept
+	     std::size_t _size, RubberAllocation &&_allocation,
+	     bool _recompressed) noexcept
 		:EncodingCacheItemKey(_key.value),
 		 CacheItem(StringWithHash{EncodingCacheItemKey::key, _key.hash},
 			   _size, now, system_now,
 			   system_now + encoding_cache_default_expires),
-		 allocation(std::move(_allocation)) {}
+		 allocation(std::move(_allocation)),
+		 encoding(_encoding), text_mode(_text_mode),
+		 recompressed(_recompressed || !CanRecompress(encoding)) {}
 
 	/* virtual methods from class CacheItem */
 	void Destroy() noexcept override {
@@ -60,6 +106,74 @@ struct EncodingCache::Item final : EncodingCacheItemKey, CacheItem, LeakDetector
 
 };
 
+/**
+ * Decompresses an item and compresses it again with the maximum
+ * quality in a worker thread.  The data is copied from the #Rubber
+ * allocation because the #Rubber may be compressed (moving
+ * allocations around) in the main thread at any time.
+ */
+class EncodingCache::RecompressJob final : public WorkerJob {
+	/**
+	 * The owner; nullptr if it has been destroyed while this job
+	 * was running (and this object deletes itself in Done()).
+	 */
+	EncodingCache *cache;
+
+	Item &item;
+
+	/**
+	 * Keeps #item alive even if it gets removed from the cache
+	 * while this job runs.
+	 */
+	SharedLease lease;
+
+	const std::string encoding;
+
+	const bool text_mode;
+
+	const std::vector<std::byte> input;
+
+	std::vector<std::byte> output;
+
+	std::exception_ptr error;
+
+public:
+	RecompressJob(EncodingCache &_cache, Item &_item) noexcept
+		:cache(&_cache), item(_item), lease(item),
+		 encoding(item.encoding), text_mode(item.text_mode),
+		 input(static_cast<const std::byte *>(item.allocation.Read()),
+		       static_cast<const std::byte *>(item.allocation.Read()) + item.GetSize()) {}
+
+	/**
+	 * The #EncodingCache is being destroyed, but this job could
+	 * not be canceled because it is running right now.
+	 */
+	void Orphan() noexcept {
+		cache = nullptr;
+		lease = {};
+	}
+
+	// virtual methods from WorkerJob
+	void Run() noexcept override {
+		try {
+			output = RecompressBest(encoding, input, text_mode,
+						recompress_max_uncompressed_size);
+		} catch (...) {
+			error = std::current_exception();
+		}
+	}
+
+	void Done() noexcept override {
+		if (cache == nullptr) {
+			delete this;
+			return;
+		}
+
+		/* this call destroys this object */
+		cache->OnRecompressDone(item, std::move(error), std::move(output));
+	}
+};
+
 class EncodingCache::Store final
 	: public AutoUnlinkIntrusiveListHook, RubberSinkHandler, LeakDetector
 {
@@ -69,6 +183,10 @@ class EncodingCache::Store final
 
 	const StringWithHash key;
 
+	const std::string_view encoding;
+
+	const bool text_mode;
+
 	/**
 	 * This event is initialized by the response callback, and limits
 	 * the duration for receiving the response body.
@@ -81,8 +199,10 @@ class EncodingCache::Store final
 	CancellablePointer rubber_cancel_ptr;
 
 public:
-	Store(EncodingCache &_cache, StringWithHash _key) noexcept
-		:cache(_cache), key(_key),
+	Store(EncodingCache &_cache, StringWithHash _key,
+	      std::string_view _encoding, bool _text_mode) noexcept
+		:cache(_cache), key(_key), encoding(_encoding),
+		 text_mode(_text_mode),
 		 timeout_event(cache.GetEventLoop(), BIND_THIS_METHOD(OnTimeout)) {}
 
 	/**
@@ -133,7 +253,7 @@ EncodingCache::Store::RubberDone(RubberAllocation &&a, std::size_t size) noexcep
 {
 	rubber_cancel_ptr = nullptr;
 
-	cache.Add(key, std::move(a), size);
+	cache.Add(key, encoding, text_mode, std::move(a), size);
 
 	Destroy();
 }
@@ -181,6 +301,8 @@ EncodingCache::Get(struct pool &pool, StringWithHash key) noexcept
 	LogConcat(5, "EncodingCache", "hit ", key.value);
 	++stats.hits;
 
+	MaybeRecompress(*item);
+
 	return NewSharedLeaseIstream(pool,
 				     istream_rubber_new(pool, rubber, item->allocation.GetId(),
 							0, item->GetSize(), false),
@@ -190,6 +312,7 @@ EncodingCache::Get(struct pool &pool, StringWithHash key) noexcept
 UnusedIstreamPtr
 EncodingCache::Put(struct pool &pool,
 		   StringWithHash key,
+		   std::string_view encoding, bool text_mode,
 		   UnusedIstreamPtr src) noexcept
 {
 	if (!src)
@@ -210,7 +333,8 @@ EncodingCache::Put(struct pool &pool,
 			    GetEventLoop(),
 			    false, false);
 
-	auto store = NewFromPool<Store>(pool, *this, key);
+	auto store = NewFromPool<Store>(pool, *this, key, encoding,
+					text_mode);
 	stores.push_back(*store);
 
 	store->Start(pool, AddTeeIstream(src, true));
@@ -219,33 +343,115 @@ EncodingCache::Put(struct pool &pool,
 }
 
 void
-EncodingCache::Add(StringWithHash key,
-		   RubberAllocation &&a, std::size_t size) noexcept
+EncodingCache::Add(StringWithHash key, std::string_view encoding,
+		   bool text_mode, RubberAllocation &&a, std::size_t size,
+		   bool recompressed) noexcept
 {
 	LogConcat(4, "EncodingCache", "add ", key.value);
 	++stats.stores;
 
-	auto item = new Item(key,
+	auto item = new Item(key, encoding, text_mode,
 			     cache.SteadyNow(),
 			     cache.SystemNow(),
 			     size,
-			     std::move(a));
+			     std::move(a),
+			     recompressed);
 
 	cache.Put(*item);
 }
 
+inline void
+EncodingCache::MaybeRecompress(Item &item) noexcept
+{
+	if (recompress_queue == nullptr || item.recompressed ||
+	    ++item.hits != recompress_hits || !item.allocation)
+		return;
+
+	recompress_candidates.push_back(item);
+
+	if (!recompress_job && !recompress_timer.IsPending())
+		recompress_timer.Schedule(recompress_interval);
+}
+
+void
+EncodingCache::OnRecompressTimer() noexcept
+{
+	assert(recompress_queue != nullptr);
+	assert(!recompress_job);
+
+	while (!recompress_candidates.empty()) {
+		auto &item = recompress_candidates.front();
+		item.unlink();
+
+		if (item.IsRemoved())
+			/* this item has been removed from the cache
+			   meanwhile, but is still being read */
+			continue;
+
+		LogConcat(5, "EncodingCache", "recompress ", item.GetKey().value);
+
+		recompress_job = std::make_unique<RecompressJob>(*this, item);
+		recompress_queue->Add(*recompress_job);
+		return;
+	}
+}
+
+void
+EncodingCache::OnRecompressDone(Item &item, std::exception_ptr error,
+				std::vector<std::byte> &&output) noexcept
+{
+	assert(recompress_job);
+
+	item.recompressed = true;
+
+	if (error) {
+		LogConcat(3, "EncodingCache", "recompress failed ",
+			  item.GetKey().value, ": ", error);
+	} else if (!item.IsRemoved() && !output.empty() &&
+		   output.size() < item.GetSize()) {
+		if (unsigned id = rubber.Add(output.size()); id != 0) {
+			RubberAllocation a{rubber, id};
+			std::copy(output.begin(), output.end(),
+				  static_cast<std::byte *>(a.Write()));
+
+			/* this replaces the old item; clients which
+			   are currently reading it hold a lease, and
+			   the old allocation will be freed when the
+			   last of them is finished */
+			Add(item.GetKey(), item.encoding, item.text_mode,
+			    std::move(a), output.size(), true);
+			++n_recompressed;
+		}
+	}
+
+	/* this releases the lease on the item; it must not be used
+	   after this point */
+	recompress_job.reset();
+
+	if (!recompress_candidates.empty())
+		recompress_timer.Schedule(recompress_interval);
+}
+
 EncodingCache::EncodingCache(EventLoop &_event_loop, size_t max_size)
 	:rubber(max_size, "encoding_cache"),
 	 /* leave 12.5% of the rubber allocator empty, to increase the
 	    chances that a hole can be found for a new allocation, to
 	    reduce the pressure that rubber_compress() creates */
 	 cache(_event_loop, max_size * 7 / 8),
-	 compress_timer(_event_loop, BIND_THIS_METHOD(OnCompressTimer))
+	 compress_timer(_event_loop, BIND_THIS_METHOD(OnCompressTimer)),
+	 recompress_timer(_event_loop, BIND_THIS_METHOD(OnRecompressTimer))
 {
 	compress_timer.Schedule(compress_interval);
 }
 
 EncodingCache::~EncodingCache() noexcept
 {
+	if (recompress_job && !recompress_queue->Cancel(*recompress_job))
+		/* the job is running right now; it will delete itself
+		   in Done() */
+		recompress_job.release()->Orphan();
+
+	recompress_candidates.clear();
+
 	stores.clear_and_dispose([](auto *r){ r->CancelStore(); });
 }
@@ -7,14 +7,28 @@
 #include "cache/Cache.hxx"
 #include "stats/CacheStats.hxx"
 #include "memory/Rubber.hxx"
+#include "event/CoarseTimerEvent.hxx"
 #include "event/FarTimerEvent.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <exception>
+#include <memory>
+#include <string_view>
+#include <vector>
+
 class UnusedIstreamPtr;
+class WorkerPool;
 
 class EncodingCache final {
 	static constexpr Event::Duration compress_interval = std::chrono::minutes(10);
 
+	/**
+	 * The delay between two background recompression jobs.  This
+	 * keeps recompression from competing with the request path
+	 * for worker threads.
+	 */
+	static constexpr Event::Duration recompress_interval = std::chrono::seconds(1);
+
 	Rubber rubber;
 	Cache cache;
 
@@ -26,8 +40,35 @@ class EncodingCache final {
 
 	IntrusiveList<Store> stores;
 
+	/**
+	 * If set, then frequently hit items are recompressed with
+	 * the maximum quality in this queue's worker threads.
+	 */
+	WorkerPool *recompress_queue = nullptr;
+
+	class RecompressJob;
+
+	/**
+	 * The currently running recompression job (at most one at a
+	 * time).
+	 */
+	std::unique_ptr<RecompressJob> recompress_job;
+
+	/**
+	 * Hot items waiting to be recompressed.
+	 */
+	IntrusiveList<Item> recompress_candidates;
+
+	CoarseTimerEvent recompress_timer;
+
 	mutable CacheStats stats{};
 
+	/**
+	 * Number of items that were replaced with a better-compressed
+	 * version.
+	 */
+	uint_least64_t n_recompressed = 0;
+
 public:
 	EncodingCache(EventLoop &_event_loop, std::size_t max_size);
 
@@ -45,8 +86,21 @@ public:
 		rubber.Populate();
 	}
 
+	/**
+	 * Enable background recompression of frequently hit items
+	 * with the maximum quality.
+	 */
+	void EnableRecompress(WorkerPool &queue) noexcept {
+		recompress_queue = &queue;
+	}
+
+	uint_least64_t GetRecompressCount() const noexcept {
+		return n_recompressed;
+	}
+
 	CacheStats GetStats() const noexcept {
 		stats.allocator = rubber.GetStats();
+		cache.FillStats(stats);
 		return stats;
 	}
 
@@ -57,12 +111,25 @@ public:
 
 	UnusedIstreamPtr Get(struct pool &pool, StringWithHash key) noexcept;
 
+	/**
+	 * @param encoding the "Content-Encoding" of the data (e.g.
+	 * "gzip" or "br"); it is used by background recompression
+	 * @param text_mode is the data text?  This is passed to the
+	 * Brotli encoder by background recompression
+	 */
 	UnusedIstreamPtr Put(struct pool &pool, StringWithHash key,
+			     std::string_view encoding, bool text_mode,
 			     UnusedIstreamPtr src) noexcept;
 
 private:
-	void Add(StringWithHash key,
-		 RubberAllocation &&a, std::size_t size) noexcept;
+	void Add(StringWithHash key, std::string_view encoding,
+		 bool text_mode, RubberAllocation &&a, std::size_t size,
+		 bool recompressed=false) noexcept;
+
+	void MaybeRecompress(Item &item) noexcept;
+	void OnRecompressTimer() noexcept;
+	void OnRecompressDone(Item &item, std::exception_ptr error,
+			      std::vector<std::byte> &&output) noexcept;
 
 	void Compress() noexcept {
 		rubber.Compress();
@@ -251,6 +251,7 @@ class FilterCache final : LeakDetector {
 
 public:
 	FilterCache(struct pool &_pool, size_t max_size,
+		    CacheAdmission admission,
 		    EventLoop &_event_loop, ResourceLoader &_resource_loader);
 
 	~FilterCache() noexcept;
@@ -271,6 +272,7 @@ public:
 
 	CacheStats GetStats() const noexcept {
 		stats.allocator = slice_pool.GetStats() + rubber.GetStats();
+		cache.FillStats(stats);
 		return stats;
 	}
 
@@ -652,6 +654,7 @@ FilterCacheRequest::OnHttpError(std::exception_ptr ep) noexcept
  */
 
 FilterCache::FilterCache(struct pool &_pool, size_t max_size,
+			 CacheAdmission admission,
 			 EventLoop &_event_loop,
 			 ResourceLoader &_resource_loader)
 	:pool(pool_new_dummy(&_pool, "filter_cache")),
@@ -660,7 +663,7 @@ FilterCache::FilterCache(struct pool &_pool, size_t max_size,
 	 /* leave 12.5% of the rubber allocator empty, to increase the
 	    chances that a hole can be found for a new allocation, to
 	    reduce the pressure that rubber_compress() creates */
-	 cache(_event_loop, max_size * 7 / 8),
+	 cache(_event_loop, max_size * 7 / 8, nullptr, admission),
 	 compress_timer(_event_loop, BIND_THIS_METHOD(OnCompressTimer)),
 	 resource_loader(_resource_loader) {
 	compress_timer.Schedule(fcache_compress_interval);
@@ -668,12 +671,13 @@ FilterCache::FilterCache(struct pool &_pool, size_t max_size,
 
 FilterCache *
 filter_cache_new(struct pool *pool, size_t max_size,
+		 CacheAdmission admission,
 		 EventLoop &event_loop,
 		 ResourceLoader &resource_loader)
 {
 	assert(max_size > 0);
 
-	return new FilterCache(*pool, max_size,
+	return new FilterCache(*pool, max_size, admission,
 			       event_loop, resource_loader);
 }
 
@@ -8,6 +8,7 @@
 #include <string_view>
 
 enum class HttpStatus : uint_least16_t;
+enum class CacheAdmission : uint_least8_t;
 struct pool;
 class StopwatchPtr;
 class UnusedIstreamPtr;
@@ -26,6 +27,7 @@ struct StringWithHash;
  */
 FilterCache *
 filter_cache_new(struct pool *pool, size_t max_size,
+		 CacheAdmission admission,
 		 EventLoop &event_loop,
 		 ResourceLoader &resource_loader);
 
@@ -4,26 +4,30 @@
 
 #include "Heap.hxx"
 #include "Item.hxx"
+#include "Disk.hxx"
+#include "DiskConfig.hxx"
+#include "Internal.hxx"
+#include "stats/CacheStats.hxx"
 #include "memory/AllocatorStats.hxx"
 #include "istream/UnusedPtr.hxx"
 #include "istream/SharedLeaseIstream.hxx"
 #include "pool/pool.hxx"
 #include "AllocatorPtr.hxx"
 
-static bool
-http_cache_item_match(void *ctx, const CacheItem &_item) noexcept
-{
-	const auto &item = static_cast<const HttpCacheItem &>(_item);
-	const auto &headers = *(const StringMap *)ctx;
-
-	return item.VaryFits(headers);
-}
+#include <cassert>
+#include <utility> // for std::cmp_less_equal()
 
 HttpCacheDocument *
 HttpCacheHeap::Get(StringWithHash key, StringMap &request_headers) noexcept
 {
-	return (HttpCacheItem *)cache.GetMatch(key,
-					       {&request_headers, http_cache_item_match});
+	if (auto *item = cache.GetMatch(key,
+					{&request_headers, HttpCacheItem::MatchVary}))
+		return (HttpCacheItem *)item;
+
+	if (disk)
+		return disk->Get(key, request_headers);
+
+	return nullptr;
 }
 
 void
@@ -34,6 +38,10 @@ HttpCacheHeap::Put(StringWithHash key, const char *tag,
 		   const StringMap &response_headers,
 		   RubberAllocation &&a, size_t size) noexcept
 {
+	/* older copies of this document (in both tiers) are
+	   obsolete */
+	Remove(key, request_headers);
+
 	auto new_pool = pool_new_slice(pool, "http_cache_item", slice_pool);
 	const AllocatorPtr alloc{new_pool};
 	key = alloc.Dup(key);
@@ -51,7 +59,46 @@ HttpCacheHeap::Put(StringWithHash key, const char *tag,
 		per_tag.insert(*item);
 
 	cache.PutMatch(*item,
-		       {const_cast<void *>((const void *)&request_headers), http_cache_item_match});
+		       {const_cast<void *>((const void *)&request_headers), HttpCacheItem::MatchVary});
+}
+
+void
+HttpCacheHeap::PutDisk(StringWithHash key, const char *tag,
+		       const HttpCacheResponseInfo &info,
+		       const StringMap &request_headers,
+		       HttpStatus status,
+		       const StringMap &response_headers,
+		       uint_least64_t disk_id, size_t size) noexcept
+{
+	assert(disk);
+
+	Remove(key, request_headers);
+
+	disk->Put(key, tag, info, request_headers,
+		  status, response_headers,
+		  disk_id, size);
+}
+
+void
+HttpCacheHeap::PutDemoted(const HttpCacheItem &item,
+			  uint_least64_t disk_id, size_t size) noexcept
+{
+	/* the "vary" map contains all request headers which are
+	   relevant for the new item */
+	PutDisk(item.GetKey(), item.GetTag(), item.info, item.vary,
+		item.status, item.response_headers,
+		disk_id, size);
+}
+
+void
+HttpCacheHeap::PutPromoted(const HttpCacheItem &item,
+			   RubberAllocation &&a, size_t size) noexcept
+{
+	/* this removes the (locked) source item from the disk
+	   tier */
+	Put(item.GetKey(), item.GetTag(), item.info, item.vary,
+	    item.status, item.response_headers,
+	    std::move(a), size);
 }
 
 void
@@ -59,16 +106,80 @@ HttpCacheHeap::Remove(HttpCacheDocument &document) noexcept
 {
 	auto &item = (HttpCacheItem &)document;
 
+	CancelMigrations(item.GetKey());
+
+	if (item.IsOnDisk()) {
+		item.GetDisk()->Remove(item);
+		return;
+	}
+
+	demote = false;
 	cache.Remove(item);
+	demote = true;
 }
 
 void
 HttpCacheHeap::Remove(StringWithHash key, const StringMap &headers) noexcept
 {
+	CancelMigrations(key);
+
+	demote = false;
 	cache.RemoveKeyIf(key, [&headers](const CacheItem &_item){
 		const auto &item = static_cast<const HttpCacheItem &>(_item);
 		return item.VaryFits(headers);
 	});
+	demote = true;
+
+	if (disk)
+		disk->Remove(key, headers);
+}
+
+inline void
+HttpCacheHeap::StartMigration(HttpCacheItem &item) noexcept
+{
+	auto *migration =
+		NewFromPool<HttpCacheMigration>(pool_new_linear(&pool, "HttpCacheMigration", 1024),
+						cache.GetEventLoop(),
+						*this, item);
+	migrations.push_back(*migration);
+	migration->Start();
+}
+
+void
+HttpCacheHeap::CancelMigrations(StringWithHash key) noexcept
+{
+	migrations.remove_and_dispose_if([key](const auto &migration){
+		return migration.GetItem().GetKey() == key;
+	}, [](auto *migration){
+		migration->Cancel();
+	});
+}
+
+void
+HttpCacheHeap::OnMigrationFinished(HttpCacheMigration &migration) noexcept
+{
+	migrations.erase(migrations.iterator_to(migration));
+}
+
+void
+HttpCacheHeap::OnCacheItemAdded(const CacheItem &) noexcept
+{
+}
+
+void
+HttpCacheHeap::OnCacheItemRemoved(const CacheItem &_item) noexcept
+{
+	auto &item = const_cast<HttpCacheItem &>(static_cast<const HttpCacheItem &>(_item));
+
+	if (!demote || !item.HasBody() ||
+	    migrations.size() >= MAX_MIGRATIONS ||
+	    /* expired items are not worth keeping */
+	    !item.Validate(cache.SteadyNow()))
+		return;
+
+	/* this item was evicted to make room for another one: copy
+	   it to the disk tier */
+	StartMigration(item);
 }
 
 void
@@ -95,7 +206,17 @@ HttpCacheHeap::Compress() noexcept
 void
 HttpCacheHeap::Flush() noexcept
 {
+	migrations.clear_and_dispose([](auto *migration){
+		migration->Cancel();
+	});
+
+	demote = false;
 	cache.Flush();
+	demote = true;
+
+	if (disk)
+		disk->Flush();
+
 	slice_pool.Compress();
 	rubber.Compress();
 }
@@ -103,9 +224,21 @@ HttpCacheHeap::Flush() noexcept
 void
 HttpCacheHeap::FlushTag(std::string_view tag) noexcept
 {
+	migrations.remove_and_dispose_if([tag](const auto &migration){
+		const char *item_tag = migration.GetItem().GetTag();
+		return item_tag != nullptr && tag == item_tag;
+	}, [](auto *migration){
+		migration->Cancel();
+	});
+
+	demote = false;
 	per_tag.remove_and_dispose_key(tag, [this](auto *item){
 		cache.Remove(*item);
 	});
+	demote = true;
+
+	if (disk)
+		disk->FlushTag(tag);
 }
 
 SharedLease
@@ -115,9 +248,24 @@ HttpCacheHeap::Lock(HttpCacheDocument &document) noexcept
 	return item;
 }
 
+size_t
+HttpCacheHeap::GetBodySize(const HttpCacheDocument &document) noexcept
+{
+	const auto &item = (const HttpCacheItem &)document;
+	return item.HasBody() ? item.GetBodySize() : 0;
+}
+
 UnusedIstreamPtr
 HttpCacheHeap::OpenStream(struct pool &_pool,
 			  HttpCacheDocument &document) noexcept
+{
+	return OpenStream(_pool, document, 0, GetBodySize(document));
+}
+
+UnusedIstreamPtr
+HttpCacheHeap::OpenStream(struct pool &_pool,
+			  HttpCacheDocument &document,
+			  size_t start, size_t end) noexcept
 {
 	auto &item = (HttpCacheItem &)document;
 
@@ -125,7 +273,18 @@ HttpCacheHeap::OpenStream(struct pool &_pool,
 		/* don't lock the item */
 		return {};
 
-	return NewSharedLeaseIstream(_pool, item.OpenStream(_pool), item);
+	if (item.IsOnDisk() && promote_hits > 0 &&
+	    ++item.disk_hits >= promote_hits &&
+	    std::cmp_less_equal(item.GetBodySize(), cacheable_size_limit) &&
+	    migrations.size() < MAX_MIGRATIONS) {
+		/* this small item is hit often: copy it back to
+		   the rubber heap */
+		item.disk_hits = 0;
+		StartMigration(item);
+	}
+
+	return NewSharedLeaseIstream(_pool, item.OpenStream(_pool, start, end),
+				     item);
 }
 
 /*
@@ -134,21 +293,61 @@ HttpCacheHeap::OpenStream(struct pool &_pool,
  */
 
 HttpCacheHeap::HttpCacheHeap(struct pool &_pool, EventLoop &event_loop,
-			     size_t max_size) noexcept
+#ifdef HAVE_URING
+			     Uring::Queue *uring,
+#endif
+			     size_t max_size,
+			     CacheAdmission admission,
+			     const HttpCacheDiskConfig &disk_config)
 	:pool(_pool),
 	 slice_pool(1024, 65536, "http_cache_meta"),
 	 rubber(max_size, "http_cache_data"),
+	 disk(disk_config.IsEnabled()
+	      ? std::make_unique<HttpCacheDisk>(pool, event_loop,
+#ifdef HAVE_URING
+						uring,
+#endif
+						disk_config, admission)
+	      : nullptr),
 	 /* leave 12.5% of the rubber allocator empty, to increase the
 	    chances that a hole can be found for a new allocation, to
 	    reduce the pressure that rubber_compress() creates */
-	 cache(event_loop, max_size * 7 / 8)
+	 cache(event_loop, max_size * 7 / 8,
+	       /* evicted items are demoted to the disk tier */
+	       disk ? this : nullptr,
+	       admission),
+	 promote_hits(disk_config.promote_hits)
 {
 }
 
-HttpCacheHeap::~HttpCacheHeap() noexcept = default;
+HttpCacheHeap::~HttpCacheHeap() noexcept
+{
+	migrations.clear_and_dispose([](auto *migration){
+		migration->Cancel();
+	});
+
+	/* don't demote while the cache is being destroyed */
+	demote = false;
+}
 
 AllocatorStats
 HttpCacheHeap::GetStats() const noexcept
 {
-	return slice_pool.GetStats() + rubber.GetStats();
+	auto stats = slice_pool.GetStats() + rubber.GetStats();
+	if (disk)
+		stats += disk->GetStats();
+	return stats;
+}
+
+void
+HttpCacheHeap::FillStats(CacheStats &stats) const noexcept
+{
+	cache.FillStats(stats);
+
+	if (disk) {
+		CacheStats disk_stats{};
+		disk->FillStats(disk_stats);
+		stats.evictions += disk_stats.evictions;
+		stats.rejections += disk_stats.rejections;
+	}
 }
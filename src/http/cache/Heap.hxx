@@ -5,12 +5,18 @@
 #pragma once
 
 #include "Item.hxx"
+#include "Migration.hxx"
 #include "cache/Cache.hxx"
+#include "cache/Handler.hxx"
 #include "memory/SlicePool.hxx"
 #include "memory/Rubber.hxx"
+#include "io/uring/config.h" // for HAVE_URING
 #include "util/IntrusiveHashSet.hxx"
+#include "util/IntrusiveList.hxx"
 #include "util/TransparentHash.hxx"
 
+#include <cstdint>
+#include <memory>
 #include <string>
 
 #include <stddef.h>
@@ -23,17 +29,34 @@ class StringMap;
 struct AllocatorStats;
 struct HttpCacheResponseInfo;
 struct HttpCacheDocument;
+struct HttpCacheDiskConfig;
+class HttpCacheDisk;
+namespace Uring { class Queue; }
 
 /**
- * Caching HTTP responses in heap memory.
+ * Caching HTTP responses in heap memory, optionally backed by a disk
+ * tier (#HttpCacheDisk) for large responses and for items evicted
+ * from memory.
  */
-class HttpCacheHeap {
+class HttpCacheHeap final : CacheHandler {
+	/**
+	 * The maximum number of concurrent #HttpCacheMigration
+	 * instances; additional evicted items are not demoted.
+	 */
+	static constexpr std::size_t MAX_MIGRATIONS = 16;
+
 	struct pool &pool;
 
 	SlicePool slice_pool;
 
 	Rubber rubber;
 
+	/**
+	 * The optional disk tier.  It is declared before #cache
+	 * because destroying #cache demotes items.
+	 */
+	std::unique_ptr<HttpCacheDisk> disk;
+
 	Cache cache;
 
 	/**
@@ -46,21 +69,54 @@ class HttpCacheHeap {
 						   std::equal_to<std::string_view>>,
 			 IntrusiveHashSetMemberHookTraits<&HttpCacheItem::per_tag_hook>> per_tag;
 
+	/**
+	 * Items which are currently being copied between #rubber
+	 * and #disk.
+	 */
+	IntrusiveList<HttpCacheMigration,
+		      IntrusiveListMemberHookTraits<&HttpCacheMigration::siblings>,
+		      IntrusiveListOptions{.constant_time_size = true}> migrations;
+
+	/**
+	 * See HttpCacheDiskConfig::promote_hits.
+	 */
+	const unsigned promote_hits;
+
+	/**
+	 * Demote items which get removed from #cache?  This is
+	 * cleared temporarily while items are removed on purpose
+	 * (e.g. because they were flushed or replaced).
+	 */
+	bool demote = true;
+
 public:
+	/**
+	 * Throws if the disk tier cannot be initialized.
+	 */
 	HttpCacheHeap(struct pool &pool, EventLoop &event_loop,
-		      size_t max_size) noexcept;
+#ifdef HAVE_URING
+		      Uring::Queue *uring,
+#endif
+		      size_t max_size, CacheAdmission admission,
+		      const HttpCacheDiskConfig &disk_config);
 	~HttpCacheHeap() noexcept;
 
 	Rubber &GetRubber() noexcept {
 		return rubber;
 	}
 
+	HttpCacheDisk *GetDisk() noexcept {
+		return disk.get();
+	}
+
 	void ForkCow(bool inherit) noexcept;
 	void Populate() noexcept;
 
 	[[gnu::pure]]
 	AllocatorStats GetStats() const noexcept;
 
+	void FillStats(CacheStats &stats) const noexcept;
+
 	HttpCacheDocument *Get(StringWithHash key,
 			       StringMap &request_headers) noexcept;
 
@@ -71,6 +127,37 @@ public:
 		 const StringMap &response_headers,
 		 RubberAllocation &&a, size_t size) noexcept;
 
+	/**
+	 * Add a file which was created with
+	 * HttpCacheDisk::CreateFile() to the disk tier.
+	 */
+	void PutDisk(StringWithHash key, const char *tag,
+		     const HttpCacheResponseInfo &info,
+		     const StringMap &request_headers,
+		     HttpStatus status,
+		     const StringMap &response_headers,
+		     uint_least64_t disk_id, size_t size) noexcept;
+
+	/**
+	 * Called by #HttpCacheMigration after an item has been
+	 * copied to the disk tier.
+	 */
+	void PutDemoted(const HttpCacheItem &item,
+			uint_least64_t disk_id, size_t size) noexcept;
+
+	/**
+	 * Called by #HttpCacheMigration after an item has been
+	 * copied from the disk tier to the rubber heap.
+	 */
+	void PutPromoted(const HttpCacheItem &item,
+			 RubberAllocation &&a, size_t size) noexcept;
+
+	/**
+	 * Called by #HttpCacheMigration when it is about to be
+	 * destroyed.
+	 */
+	void OnMigrationFinished(HttpCacheMigration &migration) noexcept;
+
 	void Remove(HttpCacheDocument &document) noexcept;
 	void Remove(StringWithHash key, const StringMap &headers) noexcept;
 
@@ -81,6 +168,28 @@ public:
 	[[nodiscard]]
 	static SharedLease Lock(HttpCacheDocument &document) noexcept;
 
+	[[gnu::pure]]
+	static size_t GetBodySize(const HttpCacheDocument &document) noexcept;
+
 	UnusedIstreamPtr OpenStream(struct pool &_pool,
 				    HttpCacheDocument &document) noexcept;
+
+	/**
+	 * Open a stream for a portion of the document's body.  Each
+	 * call counts as one hit for the promotion from the disk
+	 * tier.
+	 *
+	 * @param end the end offset (exclusive)
+	 */
+	UnusedIstreamPtr OpenStream(struct pool &_pool,
+				    HttpCacheDocument &document,
+				    size_t start, size_t end) noexcept;
+
+private:
+	void StartMigration(HttpCacheItem &item) noexcept;
+	void CancelMigrations(StringWithHash key) noexcept;
+
+	/* virtual methods from class CacheHandler */
+	void OnCacheItemAdded(const CacheItem &item) noexcept override;
+	void OnCacheItemRemoved(const CacheItem &item) noexcept override;
 };
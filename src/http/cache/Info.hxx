@@ -12,6 +12,20 @@ struct HttpCacheRequestInfo {
 	const char *if_match, *if_none_match;
 	const char *if_modified_since, *if_unmodified_since;
 
+	/**
+	 * The "Range" and "If-Range" request headers (or nullptr).
+	 * Range requests are served from a cached full response, but
+	 * partial responses are never stored.
+	 */
+	const char *range, *if_range;
+
+	/**
+	 * Is this a "HEAD" request?  It is served from a cached "GET"
+	 * response, but the response to a "HEAD" request is never
+	 * stored.
+	 */
+	bool head;
+
 	/**
 	 * Is the request served by a remote server?  If yes, then we
 	 * require the "Date" header to be present.
@@ -37,6 +51,14 @@ struct HttpCacheRequestInfo {
 	/** does the request URI have a query string?  This information is
 	    important for RFC 2616 13.9 */
 	bool has_query_string;
+
+	/**
+	 * Can the response to this request be stored in the cache?
+	 * If not, it can only be served from the cache.
+	 */
+	bool IsStorable() const noexcept {
+		return !head && range == nullptr;
+	}
 };
 
 struct HttpCacheResponseInfo {
@@ -4,10 +4,13 @@
 
 #include "Item.hxx"
 #include "Age.hxx"
+#include "Disk.hxx"
 #include "memory/istream_rubber.hxx"
 #include "istream/UnusedPtr.hxx"
 #include "pool/pool.hxx"
 
+#include <cassert>
+
 HttpCacheItem::HttpCacheItem(PoolPtr &&_pool,
 			     StringWithHash _key,
 			     std::chrono::steady_clock::time_point now,
@@ -30,6 +33,37 @@ HttpCacheItem::HttpCacheItem(PoolPtr &&_pool,
 {
 }
 
+HttpCacheItem::HttpCacheItem(PoolPtr &&_pool,
+			     StringWithHash _key,
+			     std::chrono::steady_clock::time_point now,
+			     std::chrono::system_clock::time_point system_now,
+			     const char *_tag,
+			     const HttpCacheResponseInfo &_info,
+			     const StringMap &_request_headers,
+			     HttpStatus _status,
+			     const StringMap &_response_headers,
+			     size_t _size,
+			     HttpCacheDisk &_disk, uint_least64_t _disk_id) noexcept
+	:PoolHolder(std::move(_pool)),
+	 HttpCacheDocument(pool, _info, _request_headers,
+			   _status, _response_headers),
+	 CacheItem(_key, pool_netto_size(pool) + _size,
+		   http_cache_calc_expires(now, system_now, _info.expires, vary)),
+	 tag(_tag != nullptr ? p_strdup(GetPool(), _tag) : nullptr),
+	 size(_size),
+	 disk(&_disk), disk_id(_disk_id)
+{
+}
+
+bool
+HttpCacheItem::MatchVary(void *ctx, const CacheItem &_item) noexcept
+{
+	const auto &item = static_cast<const HttpCacheItem &>(_item);
+	const auto &headers = *(const StringMap *)ctx;
+
+	return item.VaryFits(headers);
+}
+
 void
 HttpCacheItem::SetExpires(std::chrono::steady_clock::time_point steady_now,
 			  std::chrono::system_clock::time_point system_now,
@@ -43,13 +77,29 @@ HttpCacheItem::SetExpires(std::chrono::steady_clock::time_point steady_now,
 UnusedIstreamPtr
 HttpCacheItem::OpenStream(struct pool &_pool) noexcept
 {
+	return OpenStream(_pool, 0, size);
+}
+
+UnusedIstreamPtr
+HttpCacheItem::OpenStream(struct pool &_pool,
+			  std::size_t start, std::size_t end) noexcept
+{
+	assert(start <= end);
+	assert(end <= size);
+
+	if (disk != nullptr)
+		return disk->OpenFile(_pool, disk_id, start, end);
+
 	return istream_rubber_new(_pool, body.GetRubber(), body.GetId(),
-				  0, size, false);
+				  start, end, false);
 }
 
 void
 HttpCacheItem::Destroy() noexcept
 {
+	if (disk != nullptr)
+		disk->Unlink(disk_id);
+
 	pool_trash(pool);
 	this->~HttpCacheItem();
 }
@@ -10,7 +10,10 @@
 #include "memory/Rubber.hxx"
 #include "util/IntrusiveHashSet.hxx"
 
+#include <cstdint>
+
 class UnusedIstreamPtr;
+class HttpCacheDisk;
 
 class HttpCacheItem final : PoolHolder, public HttpCacheDocument, public CacheItem {
 	const char *const tag;
@@ -19,7 +22,25 @@ class HttpCacheItem final : PoolHolder, public HttpCacheDocument, public CacheIt
 
 	const RubberAllocation body;
 
+	/**
+	 * If this is set, then the body is stored in a file of this
+	 * disk tier instead of #body.
+	 */
+	HttpCacheDisk *const disk = nullptr;
+
+	/**
+	 * The file of the body in the #disk tier.
+	 */
+	const uint_least64_t disk_id = 0;
+
 public:
+	/**
+	 * The number of hits since this item was stored in the disk
+	 * tier; used to decide whether to promote it back to the
+	 * rubber heap.
+	 */
+	unsigned disk_hits = 0;
+
 	/**
 	 * For #HttpCacheHeap::per_tag.
 	 */
@@ -44,6 +65,23 @@ public:
 		      size_t _size,
 		      RubberAllocation &&_body) noexcept;
 
+	/**
+	 * Construct an item whose body is stored in a file of the
+	 * #HttpCacheDisk.  The file gets deleted when this item is
+	 * destroyed.
+	 */
+	HttpCacheItem(PoolPtr &&_pool,
+		      StringWithHash _key,
+		      std::chrono::steady_clock::time_point now,
+		      std::chrono::system_clock::time_point system_now,
+		      const char *_tag,
+		      const HttpCacheResponseInfo &_info,
+		      const StringMap &_request_headers,
+		      HttpStatus _status,
+		      const StringMap &_response_headers,
+		      size_t _size,
+		      HttpCacheDisk &_disk, uint_least64_t _disk_id) noexcept;
+
 	HttpCacheItem(const HttpCacheItem &) = delete;
 	HttpCacheItem &operator=(const HttpCacheItem &) = delete;
 
@@ -58,11 +96,41 @@ public:
 			std::chrono::system_clock::time_point _expires) noexcept;
 
 	bool HasBody() const noexcept {
-		return body;
+		return body || disk != nullptr;
+	}
+
+	bool IsOnDisk() const noexcept {
+		return disk != nullptr;
+	}
+
+	HttpCacheDisk *GetDisk() const noexcept {
+		return disk;
+	}
+
+	/**
+	 * @return the size of the response body
+	 */
+	size_t GetBodySize() const noexcept {
+		return size;
 	}
 
+	/**
+	 * A #Cache::MatchFunction implementation which checks
+	 * whether the item's "Vary" headers fit the #StringMap
+	 * passed as context pointer.
+	 */
+	static bool MatchVary(void *ctx, const CacheItem &item) noexcept;
+
 	UnusedIstreamPtr OpenStream(struct pool &_pool) noexcept;
 
+	/**
+	 * Open a stream for a portion of the body.
+	 *
+	 * @param end the end offset (exclusive)
+	 */
+	UnusedIstreamPtr OpenStream(struct pool &_pool,
+				    std::size_t start, std::size_t end) noexcept;
+
 	/* virtual methods from class CacheItem */
 	void Destroy() noexcept override;
 };
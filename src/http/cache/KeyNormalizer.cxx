@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "KeyNormalizer.hxx"
+#include "KeyRules.hxx"
+#include "stats/HttpCacheKeyStats.hxx"
+#include "ResourceAddress.hxx"
+#include "http/Address.hxx"
+#include "http/local/Address.hxx"
+#include "cgi/Address.hxx"
+#include "uri/PNormalize.hxx"
+#include "AllocatorPtr.hxx"
+#include "util/CharUtil.hxx"
+
+#include <algorithm> // for std::none_of()
+
+using std::string_view_literals::operator""sv;
+
+static constexpr unsigned
+RuleBit(HttpCacheKeyRule rule) noexcept
+{
+	return 1U << static_cast<unsigned>(rule);
+}
+
+static constexpr bool
+IsSame(std::string_view a, std::string_view b) noexcept
+{
+	return a.data() == b.data() && a.size() == b.size();
+}
+
+static std::string_view
+NormalizeQuery(AllocatorPtr alloc, std::string_view query,
+	       const HttpCacheKeyRules &rules, unsigned &applied) noexcept
+{
+	if (rules.normalize_uri) {
+		const auto result = NormalizeUriEscapes(alloc, query);
+		if (!IsSame(result, query)) {
+			query = result;
+			applied |= RuleBit(HttpCacheKeyRule::NORMALIZE_URI);
+		}
+	}
+
+	if (!rules.drop_query_params.empty()) {
+		const auto result = RemoveQueryParameters(alloc, query,
+							  rules.drop_query_params);
+		if (!IsSame(result, query)) {
+			query = result;
+			applied |= RuleBit(HttpCacheKeyRule::DROP_QUERY_PARAMS);
+		}
+	}
+
+	if (rules.sort_query) {
+		const auto result = SortQueryString(alloc, query);
+		if (!IsSame(result, query)) {
+			query = result;
+			applied |= RuleBit(HttpCacheKeyRule::SORT_QUERY);
+		}
+	}
+
+	return query;
+}
+
+/**
+ * Normalize a query string field (without the question mark).
+ */
+static const char *
+NormalizeQueryString(AllocatorPtr alloc, const char *query_string,
+		     const HttpCacheKeyRules &rules, unsigned &applied) noexcept
+{
+	if (query_string == nullptr)
+		return nullptr;
+
+	const std::string_view src{query_string};
+	const auto result = NormalizeQuery(alloc, src, rules, applied);
+	return IsSame(result, src)
+		? query_string
+		: alloc.DupZ(result);
+}
+
+/**
+ * Normalize an URI consisting of a path and an optional query
+ * string.
+ */
+static const char *
+NormalizeUri(AllocatorPtr alloc, const char *uri,
+	     const HttpCacheKeyRules &rules, unsigned &applied) noexcept
+{
+	if (uri == nullptr)
+		return nullptr;
+
+	const std::string_view src{uri};
+	const auto q = src.find('?');
+	const auto path = src.substr(0, q);
+	const auto query = q == src.npos
+		? std::string_view{}
+		: src.substr(q + 1);
+
+	std::string_view new_path = path;
+	if (rules.normalize_uri) {
+		new_path = NormalizeUriEscapes(alloc, new_path);
+
+		if (new_path.find("//"sv) != new_path.npos ||
+		    new_path.find("/./"sv) != new_path.npos ||
+		    new_path.ends_with("/."sv)) {
+			const char *p = NormalizeUriPath(alloc, alloc.DupZ(new_path));
+			new_path = p;
+		}
+
+		if (!IsSame(new_path, path))
+			applied |= RuleBit(HttpCacheKeyRule::NORMALIZE_URI);
+	}
+
+	const auto new_query = NormalizeQuery(alloc, query, rules, applied);
+
+	if (IsSame(new_path, path) && IsSame(new_query, query))
+		return uri;
+
+	return alloc.Concat(new_path,
+			    new_query.empty() ? ""sv : "?"sv,
+			    new_query);
+}
+
+static const char *
+NormalizeHost(AllocatorPtr alloc, const char *host,
+	      const HttpCacheKeyRules &rules, unsigned &applied) noexcept
+{
+	if (host == nullptr || !rules.lowercase_host)
+		return host;
+
+	const std::string_view src{host};
+	if (std::none_of(src.begin(), src.end(),
+			 [](char ch){ return IsUpperAlphaASCII(ch); }))
+		return host;
+
+	applied |= RuleBit(HttpCacheKeyRule::LOWERCASE_HOST);
+	return alloc.DupToLower(src);
+}
+
+ResourceAddress
+NormalizeCacheKeyAddress(AllocatorPtr alloc, const ResourceAddress &address,
+			 const HttpCacheKeyRules &rules,
+			 unsigned &applied) noexcept
+{
+	applied = 0;
+
+	switch (address.type) {
+	case ResourceAddress::Type::NONE:
+	case ResourceAddress::Type::LOCAL:
+	case ResourceAddress::Type::PIPE:
+		/* not cacheable */
+		break;
+
+	case ResourceAddress::Type::HTTP:
+		{
+			const auto &src = address.GetHttp();
+			const char *host_and_port =
+				NormalizeHost(alloc, src.host_and_port, rules, applied);
+			const char *path = NormalizeUri(alloc, src.path, rules, applied);
+			if (applied == 0)
+				break;
+
+			auto *http = alloc.New<HttpAddress>(ShallowCopy(), src);
+			http->host_and_port = host_and_port;
+			http->path = path;
+			return *http;
+		}
+
+	case ResourceAddress::Type::LHTTP:
+		{
+			const auto &src = address.GetLhttp();
+			const char *host_and_port =
+				NormalizeHost(alloc, src.host_and_port, rules, applied);
+			const char *uri = NormalizeUri(alloc, src.uri, rules, applied);
+			if (applied == 0)
+				break;
+
+			auto *lhttp = alloc.New<LhttpAddress>(ShallowCopy(), src);
+			lhttp->host_and_port = host_and_port;
+			lhttp->uri = uri;
+			return *lhttp;
+		}
+
+	case ResourceAddress::Type::CGI:
+	case ResourceAddress::Type::FASTCGI:
+	case ResourceAddress::Type::WAS:
+		{
+			const auto &src = address.GetCgi();
+			const char *uri = NormalizeUri(alloc, src.uri, rules, applied);
+			const char *query_string =
+				NormalizeQueryString(alloc, src.query_string,
+						     rules, applied);
+			if (applied == 0)
+				break;
+
+			auto *cgi = alloc.New<CgiAddress>(ShallowCopy(), src);
+			cgi->uri = uri;
+			cgi->query_string = query_string;
+			return {address.type, *cgi};
+		}
+	}
+
+	return {ShallowCopy(), address};
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+class AllocatorPtr;
+struct ResourceAddress;
+struct HttpCacheKeyRules;
+
+/**
+ * Construct a copy of the given #ResourceAddress with all
+ * #HttpCacheKeyRules applied; it is only used to calculate the cache
+ * key.
+ *
+ * This is a shallow copy: only modified strings are allocated.
+ *
+ * @param applied a bit mask of #HttpCacheKeyRule values which have
+ * modified the address (zero means the original address was
+ * returned)
+ */
+ResourceAddress
+NormalizeCacheKeyAddress(AllocatorPtr alloc, const ResourceAddress &address,
+			 const HttpCacheKeyRules &rules,
+			 unsigned &applied) noexcept;
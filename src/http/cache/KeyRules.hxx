@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Rules for normalizing the HTTP cache key, so URI variants which
+ * refer to the same resource share one cache item.  The request
+ * sent to the server is not modified.
+ */
+struct HttpCacheKeyRules {
+	/**
+	 * Query parameters to be removed from the key (e.g. tracking
+	 * parameters like "utm_source").  A name ending with an
+	 * asterisk matches all parameters beginning with it.
+	 */
+	std::vector<std::string> drop_query_params;
+
+	/**
+	 * Sort the query parameters?
+	 */
+	bool sort_query = false;
+
+	/**
+	 * Convert the host name to lower case?
+	 */
+	bool lowercase_host = false;
+
+	/**
+	 * Normalize percent-encoding and collapse "//" and "/./" in
+	 * the URI path?
+	 */
+	bool normalize_uri = false;
+
+	bool IsEnabled() const noexcept {
+		return !drop_query_params.empty() || sort_query ||
+			lowercase_host || normalize_uri;
+	}
+};
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Migration.hxx"
+#include "Heap.hxx"
+#include "Disk.hxx"
+#include "Internal.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "io/Logger.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "memory/Rubber.hxx"
+
+#include <tuple> // for std::tie()
+
+HttpCacheMigration::HttpCacheMigration(PoolPtr &&_pool, EventLoop &event_loop,
+				       HttpCacheHeap &_heap,
+				       HttpCacheItem &_item) noexcept
+	:PoolHolder(std::move(_pool)),
+	 heap(_heap), item(_item), lease(item),
+	 defer_start(event_loop, BIND_THIS_METHOD(OnDeferredStart))
+{
+}
+
+void
+HttpCacheMigration::Cancel() noexcept
+{
+	if (cancel_ptr)
+		cancel_ptr.Cancel();
+
+	Destroy();
+}
+
+inline void
+HttpCacheMigration::Finish() noexcept
+{
+	cancel_ptr = nullptr;
+	heap.OnMigrationFinished(*this);
+}
+
+inline void
+HttpCacheMigration::StartDemote() noexcept
+{
+	auto &disk = *heap.GetDisk();
+
+	UniqueFileDescriptor fd;
+
+	try {
+		std::tie(disk_id, fd) = disk.CreateFile();
+	} catch (...) {
+		LogConcat(2, "HttpCache", "demote failed: ", std::current_exception());
+		Finish();
+		Destroy();
+		return;
+	}
+
+	auto *sink = NewHttpCacheDiskSink(pool, item.OpenStream(pool),
+					  disk, disk_id, std::move(fd),
+					  disk.GetMaxObjectSize(),
+					  *this, cancel_ptr);
+	if (sink != nullptr)
+		ReadHttpCacheDiskSink(*sink);
+}
+
+inline void
+HttpCacheMigration::StartPromote() noexcept
+{
+	auto *sink = sink_rubber_new(pool, item.OpenStream(pool),
+				     heap.GetRubber(), cacheable_size_limit,
+				     *this, cancel_ptr);
+	if (sink != nullptr)
+		sink_rubber_read(*sink);
+}
+
+void
+HttpCacheMigration::OnDeferredStart() noexcept
+{
+	if (item.IsOnDisk())
+		StartPromote();
+	else
+		StartDemote();
+}
+
+/*
+ * RubberSinkHandler
+ *
+ */
+
+void
+HttpCacheMigration::RubberDone(RubberAllocation &&a, size_t size) noexcept
+{
+	Finish();
+	heap.PutPromoted(item, std::move(a), size);
+	Destroy();
+}
+
+void
+HttpCacheMigration::RubberOutOfMemory() noexcept
+{
+	Finish();
+	Destroy();
+}
+
+void
+HttpCacheMigration::RubberTooLarge() noexcept
+{
+	Finish();
+	Destroy();
+}
+
+void
+HttpCacheMigration::RubberError(std::exception_ptr ep) noexcept
+{
+	LogConcat(2, "HttpCache", "promote failed: ", ep);
+
+	Finish();
+	Destroy();
+}
+
+/*
+ * HttpCacheDiskSinkHandler
+ *
+ */
+
+void
+HttpCacheMigration::OnDiskSinkDone(std::size_t size) noexcept
+{
+	Finish();
+	heap.PutDemoted(item, disk_id, size);
+	Destroy();
+}
+
+void
+HttpCacheMigration::OnDiskSinkTooLarge() noexcept
+{
+	Finish();
+	Destroy();
+}
+
+void
+HttpCacheMigration::OnDiskSinkError(std::exception_ptr ep) noexcept
+{
+	LogConcat(2, "HttpCache", "demote failed: ", ep);
+
+	Finish();
+	Destroy();
+}
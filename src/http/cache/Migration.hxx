@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "DiskSink.hxx"
+#include "memory/sink_rubber.hxx"
+#include "event/DeferEvent.hxx"
+#include "pool/Holder.hxx"
+#include "util/Cancellable.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/SharedLease.hxx"
+
+#include <cstdint>
+
+class HttpCacheHeap;
+class HttpCacheItem;
+
+/**
+ * Copies the body of a #HttpCacheItem from one tier of the HTTP
+ * cache to the other: an item which was evicted from the rubber heap
+ * is demoted to the disk tier, and a small item which is hit often
+ * on disk is promoted back to the rubber heap.  The source item is
+ * locked until the copy is complete.
+ */
+class HttpCacheMigration final
+	: PoolHolder, RubberSinkHandler, HttpCacheDiskSinkHandler
+{
+	HttpCacheHeap &heap;
+
+	HttpCacheItem &item;
+
+	const SharedLease lease;
+
+	/**
+	 * Starts copying outside of the #Cache method which has
+	 * triggered this migration.
+	 */
+	DeferEvent defer_start;
+
+	CancellablePointer cancel_ptr;
+
+	/**
+	 * The destination file (only used for demotion).
+	 */
+	uint_least64_t disk_id;
+
+public:
+	IntrusiveListHook<IntrusiveHookMode::NORMAL> siblings;
+
+	HttpCacheMigration(PoolPtr &&_pool, EventLoop &event_loop,
+			   HttpCacheHeap &_heap, HttpCacheItem &_item) noexcept;
+
+	HttpCacheMigration(const HttpCacheMigration &) = delete;
+	HttpCacheMigration &operator=(const HttpCacheMigration &) = delete;
+
+	const HttpCacheItem &GetItem() const noexcept {
+		return item;
+	}
+
+	void Start() noexcept {
+		defer_start.Schedule();
+	}
+
+	/**
+	 * Abort the migration and destroy this object.  The caller
+	 * is responsible for removing it from the list.
+	 */
+	void Cancel() noexcept;
+
+private:
+	void Destroy() noexcept {
+		this->~HttpCacheMigration();
+	}
+
+	void Finish() noexcept;
+
+	void OnDeferredStart() noexcept;
+	void StartDemote() noexcept;
+	void StartPromote() noexcept;
+
+	/* virtual methods from class RubberSinkHandler */
+	void RubberDone(RubberAllocation &&a, size_t size) noexcept override;
+	void RubberOutOfMemory() noexcept override;
+	void RubberTooLarge() noexcept override;
+	void RubberError(std::exception_ptr ep) noexcept override;
+
+	/* virtual methods from class HttpCacheDiskSinkHandler */
+	void OnDiskSinkDone(std::size_t size) noexcept override;
+	void OnDiskSinkTooLarge() noexcept override;
+	void OnDiskSinkError(std::exception_ptr ep) noexcept override;
+};
@@ -7,27 +7,38 @@
 #include "Item.hxx"
 #include "RFC.hxx"
 #include "Heap.hxx"
+#include "Disk.hxx"
+#include "DiskSink.hxx"
+#include "KeyNormalizer.hxx"
+#include "KeyRules.hxx"
+#include "Range.hxx"
 #include "strmap.hxx"
 #include "http/ResponseHandler.hxx"
 #include "http/rl/ResourceLoader.hxx"
 #include "ResourceAddress.hxx"
 #include "memory/sink_rubber.hxx"
 #include "stats/CacheStats.hxx"
+#include "stats/HttpCacheKeyStats.hxx"
 #include "http/CommonHeaders.hxx"
 #include "http/Date.hxx"
 #include "http/List.hxx"
 #include "http/Method.hxx"
 #include "http/PDigestHeader.hxx"
+#include "http/Status.hxx"
+#include "istream/ConcatIstream.hxx"
 #include "istream/Length.hxx"
 #include "istream/UnusedPtr.hxx"
+#include "istream/istream_string.hxx"
 #include "istream/TeeIstream.hxx"
 #include "istream/RefIstream.hxx"
 #include "pool/Holder.hxx"
 #include "AllocatorPtr.hxx"
 #include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/ToBuffer.hxx"
 #include "event/FarTimerEvent.hxx"
 #include "event/Loop.hxx"
 #include "io/Logger.hxx"
+#include "io/UniqueFileDescriptor.hxx"
 #include "util/Base32.hxx"
 #include "util/Cancellable.hxx"
 #include "util/djb_hash.hxx"
@@ -35,7 +46,10 @@
 #include "util/IntrusiveList.hxx"
 #include "util/StringAPI.hxx"
 
+#include <algorithm> // for std::max()
+#include <array>
 #include <functional>
+#include <tuple> // for std::tie()
 
 #include <string.h>
 #include <stdio.h>
@@ -53,6 +67,7 @@ IsModifyingMethod(HttpMethod method) noexcept
 class HttpCacheRequest final : PoolHolder,
 			       HttpResponseHandler,
 			       RubberSinkHandler,
+			       HttpCacheDiskSinkHandler,
 			       Cancellable {
 public:
 	IntrusiveListHook<IntrusiveHookMode::NORMAL> siblings;
@@ -107,6 +122,14 @@ private:
 
 	CancellablePointer cancel_ptr;
 
+	/**
+	 * The file in the disk tier which receives the response
+	 * body; only used if the body is too large for the rubber
+	 * allocator.
+	 */
+	uint_least64_t disk_id;
+	UniqueFileDescriptor disk_fd;
+
 	const bool eager_cache;
 
 public:
@@ -153,13 +176,14 @@ public:
 	void Put(RubberAllocation &&a, size_t size) noexcept;
 
 	/**
-	 * Storing the response body in the rubber allocator has finished
-	 * (but may have failed).
+	 * Storing the response body in the rubber allocator (or in
+	 * the disk tier) has finished (but may have failed).
 	 */
 	void RubberStoreFinished() noexcept;
 
 	/**
-	 * Abort storing the response body in the rubber allocator.
+	 * Abort storing the response body in the rubber allocator (or
+	 * in the disk tier).
 	 *
 	 * This will not remove the request from the HttpCache, because
 	 * this method is supposed to be used as a "disposer".
@@ -171,6 +195,14 @@ private:
 		this->~HttpCacheRequest();
 	}
 
+	/**
+	 * Create a file in the disk tier for the response body
+	 * (#disk_id, #disk_fd).
+	 *
+	 * @return false on error (the response shall not be cached)
+	 */
+	bool CreateDiskFile() noexcept;
+
 	/* virtual methods from class Cancellable */
 	void Cancel() noexcept override;
 
@@ -184,6 +216,11 @@ private:
 	void RubberOutOfMemory() noexcept override;
 	void RubberTooLarge() noexcept override;
 	void RubberError(std::exception_ptr ep) noexcept override;
+
+	/* virtual methods from class HttpCacheDiskSinkHandler */
+	void OnDiskSinkDone(std::size_t size) noexcept override;
+	void OnDiskSinkTooLarge() noexcept override;
+	void OnDiskSinkError(std::exception_ptr ep) noexcept override;
 };
 
 /**
@@ -252,6 +289,144 @@ private:
 	}
 };
 
+/**
+ * Wrapper for a "Range" request which could not be served from the
+ * cache.  The request is forwarded as-is, and if the partial response
+ * reveals that the whole resource is cacheable, it gets fetched in
+ * the background (see HttpCache::StartFill()).
+ */
+class RangeMissHttpCacheRequest final
+	: public HttpResponseHandler, Cancellable
+{
+	struct pool &caller_pool;
+
+	/**
+	 * The cache object which got this request.
+	 */
+	HttpCache &cache;
+
+	const StringWithHash key;
+
+	const ResourceRequestParams params;
+
+	const ResourceAddress &address;
+
+	/**
+	 * A copy of the original request headers; they are needed
+	 * to start the fill request.
+	 */
+	const StringMap request_headers;
+
+	const HttpCacheRequestInfo info;
+
+	HttpResponseHandler &handler;
+
+	CancellablePointer cancel_ptr;
+
+public:
+	RangeMissHttpCacheRequest(struct pool &_caller_pool,
+				  HttpCache &_cache,
+				  StringWithHash _key,
+				  const ResourceRequestParams &_params,
+				  const ResourceAddress &_address,
+				  const StringMap &_headers,
+				  const HttpCacheRequestInfo &_info,
+				  HttpResponseHandler &_handler) noexcept
+		:caller_pool(_caller_pool),
+		 cache(_cache),
+		 key(_key), params(_params), address(_address),
+		 request_headers(ShallowCopy{}, caller_pool, _headers),
+		 info(_info),
+		 handler(_handler) {}
+
+	RangeMissHttpCacheRequest(const RangeMissHttpCacheRequest &) = delete;
+	RangeMissHttpCacheRequest &operator=(const RangeMissHttpCacheRequest &) = delete;
+
+	void Start(ResourceLoader &next,
+		   const StopwatchPtr &parent_stopwatch,
+		   HttpMethod method,
+		   StringMap &&_headers,
+		   CancellablePointer &_cancel_ptr) noexcept {
+		_cancel_ptr = *this;
+
+		next.SendRequest(caller_pool, parent_stopwatch,
+				 params,
+				 method, address,
+				 std::move(_headers), nullptr,
+				 *this, cancel_ptr);
+	}
+
+private:
+	void Destroy() noexcept {
+		this->~RangeMissHttpCacheRequest();
+	}
+
+	/* virtual methods from class Cancellable */
+	void Cancel() noexcept override {
+		cancel_ptr.Cancel();
+		Destroy();
+	}
+
+	/* virtual methods from class HttpResponseHandler */
+	void OnHttpResponse(HttpStatus status, StringMap &&headers,
+			    UnusedIstreamPtr body) noexcept override;
+
+	void OnHttpError(std::exception_ptr e) noexcept override {
+		auto &_handler = handler;
+		Destroy();
+		_handler.InvokeError(std::move(e));
+	}
+};
+
+/**
+ * Fetches a whole resource in the background after a "Range" request
+ * has missed the cache, so the following "Range" requests can be
+ * served from the cache.  The #HttpCacheRequest stores the response;
+ * this class only discards the body.
+ */
+class HttpCacheFill final : PoolHolder, public HttpResponseHandler {
+	HttpCache &cache;
+
+	const StringWithHash key;
+
+public:
+	IntrusiveListHook<IntrusiveHookMode::NORMAL> siblings;
+
+	CancellablePointer cancel_ptr;
+
+	HttpCacheFill(PoolPtr &&_pool, HttpCache &_cache,
+		      StringWithHash _key) noexcept
+		:PoolHolder(std::move(_pool)),
+		 cache(_cache),
+		 key(AllocatorPtr{pool}.Dup(_key)) {}
+
+	HttpCacheFill(const HttpCacheFill &) = delete;
+	HttpCacheFill &operator=(const HttpCacheFill &) = delete;
+
+	StringWithHash GetKey() const noexcept {
+		return key;
+	}
+
+	/**
+	 * Abort the request and destroy this object.  The caller is
+	 * responsible for removing it from the list.
+	 */
+	void Cancel() noexcept {
+		cancel_ptr.Cancel();
+		Destroy();
+	}
+
+private:
+	void Destroy() noexcept {
+		this->~HttpCacheFill();
+	}
+
+	/* virtual methods from class HttpResponseHandler */
+	void OnHttpResponse(HttpStatus status, StringMap &&headers,
+			    UnusedIstreamPtr body) noexcept override;
+	void OnHttpError(std::exception_ptr ep) noexcept override;
+};
+
 class HttpCache {
 	const PoolPtr pool;
 
@@ -270,14 +445,43 @@ class HttpCache {
 	IntrusiveList<HttpCacheRequest,
 		      IntrusiveListMemberHookTraits<&HttpCacheRequest::siblings>> requests;
 
+	/**
+	 * The maximum number of concurrent background fills.
+	 */
+	static constexpr std::size_t MAX_FILLS = 16;
+
+	/**
+	 * Background fills started by "Range" requests which have
+	 * missed the cache and which are still waiting for the
+	 * response.
+	 */
+	IntrusiveList<HttpCacheFill,
+		      IntrusiveListMemberHookTraits<&HttpCacheFill::siblings>,
+		      IntrusiveListOptions{.constant_time_size = true}> fills;
+
 	mutable CacheStats stats{};
 
+	const HttpCacheKeyRules key_rules;
+
+	HttpCacheKeyStats key_stats;
+
+	/**
+	 * Makes "multipart/byteranges" boundaries unique.
+	 */
+	uint_least64_t next_boundary = 0;
+
 	const bool obey_no_cache;
 
 public:
 	HttpCache(struct pool &_pool, size_t max_size,
+		  CacheAdmission admission,
 		  bool obey_no_cache,
+		  const HttpCacheKeyRules &_key_rules,
+		  const HttpCacheDiskConfig &disk_config,
 		  EventLoop &event_loop,
+#ifdef HAVE_URING
+		  Uring::Queue *uring,
+#endif
 		  ResourceLoader &_resource_loader);
 
 	HttpCache(const HttpCache &) = delete;
@@ -293,6 +497,22 @@ public:
 		return heap.GetRubber();
 	}
 
+	HttpCacheDisk *GetDisk() noexcept {
+		return heap.GetDisk();
+	}
+
+	/**
+	 * Responses larger than this are not cacheable.  Responses
+	 * which are too large for the rubber allocator may be stored
+	 * in the disk tier.
+	 */
+	off_t GetSizeLimit() noexcept {
+		const auto *disk = heap.GetDisk();
+		return disk != nullptr
+			? std::max(disk->GetMaxObjectSize(), cacheable_size_limit)
+			: cacheable_size_limit;
+	}
+
 	void ForkCow(bool inherit) noexcept {
 		heap.ForkCow(inherit);
 	}
@@ -303,9 +523,14 @@ public:
 
 	CacheStats GetStats() const noexcept {
 		stats.allocator = heap.GetStats();
+		heap.FillStats(stats);
 		return stats;
 	}
 
+	const HttpCacheKeyStats &GetKeyStats() const noexcept {
+		return key_stats;
+	}
+
 	void Flush() noexcept {
 		heap.Flush();
 	}
@@ -322,6 +547,26 @@ public:
 		requests.erase(requests.iterator_to(r));
 	}
 
+	void RemoveFill(HttpCacheFill &fill) noexcept {
+		fills.erase(fills.iterator_to(fill));
+	}
+
+	/**
+	 * A "Range" request has missed the cache and the server has
+	 * sent a partial response.  If the whole resource is
+	 * cacheable, fetch it in the background.
+	 *
+	 * @param request_headers the original request headers
+	 * @param response_headers the headers of the partial response
+	 */
+	void StartFill(struct pool &caller_pool,
+		       StringWithHash key,
+		       const ResourceRequestParams &params,
+		       const ResourceAddress &address,
+		       const StringMap &request_headers,
+		       const HttpCacheRequestInfo &info,
+		       const StringMap &response_headers) noexcept;
+
 	void Start(struct pool &caller_pool,
 		   const StopwatchPtr &parent_stopwatch,
 		   const ResourceRequestParams &params,
@@ -345,6 +590,20 @@ public:
 			 std::move(a), size);
 	}
 
+	void PutDisk(StringWithHash key, const char *tag,
+		     const HttpCacheResponseInfo &info,
+		     const StringMap &request_headers,
+		     HttpStatus status,
+		     const StringMap &response_headers,
+		     uint_least64_t disk_id, size_t size) noexcept {
+		LogConcat(4, "HttpCache", "put_disk ", key.value);
+		++stats.stores;
+
+		heap.PutDisk(key, tag, info, request_headers,
+			     status, response_headers,
+			     disk_id, size);
+	}
+
 	void Remove(HttpCacheDocument *document) noexcept {
 		heap.Remove(*document);
 	}
@@ -363,10 +622,13 @@ public:
 	 *
 	 * Caller pool is referenced synchronously and freed
 	 * asynchronously (as needed).
+	 *
+	 * @param key_rules_applied a bit mask of #HttpCacheKeyRule
+	 * values which have modified the key
 	 */
 	void Use(struct pool &caller_pool,
 		 const StopwatchPtr &parent_stopwatch,
-		 StringWithHash key,
+		 StringWithHash key, unsigned key_rules_applied,
 		 const ResourceRequestParams &params,
 		 HttpMethod method,
 		 const ResourceAddress &address,
@@ -376,16 +638,49 @@ public:
 		 CancellablePointer &cancel_ptr) noexcept;
 
 	/**
-	 * Send the cached document to the caller.
+	 * Send the cached document to the caller.  "HEAD" and
+	 * "Range" requests get only the requested portion of the
+	 * body.
 	 *
 	 * Caller pool is left unchanged.
 	 */
 	void Serve(struct pool &caller_pool,
 		   HttpCacheDocument &document,
 		   StringWithHash key,
+		   const HttpCacheRequestInfo &info,
 		   HttpResponseHandler &handler) noexcept;
 
 private:
+	[[gnu::pure]]
+	bool IsFilling(StringWithHash key) const noexcept;
+
+	/**
+	 * Send a "206 Partial Content" (or "416 Range Not
+	 * Satisfiable") response.
+	 */
+	void ServeRanges(struct pool &caller_pool,
+			 HttpCacheDocument &document,
+			 StringWithHash key,
+			 const HttpCacheRanges &ranges,
+			 HttpResponseHandler &handler) noexcept;
+
+	/**
+	 * Forward a "HEAD" or "Range" request which cannot be served
+	 * from the cache.  The response is not stored (because it is
+	 * not complete), but a "Range" request may start a
+	 * background fill.
+	 */
+	void ForwardPartial(struct pool &caller_pool,
+			    const StopwatchPtr &parent_stopwatch,
+			    StringWithHash key,
+			    const ResourceRequestParams &params,
+			    const HttpCacheRequestInfo &info,
+			    HttpMethod method,
+			    const ResourceAddress &address,
+			    StringMap &&headers,
+			    HttpResponseHandler &handler,
+			    CancellablePointer &cancel_ptr) noexcept;
+
 	/**
 	 * A resource was not found in the cache.
 	 *
@@ -558,6 +853,56 @@ HttpCacheRequest::RubberError(std::exception_ptr ep) noexcept
 	Destroy();
 }
 
+/*
+ * disk sink handler
+ *
+ */
+
+void
+HttpCacheRequest::OnDiskSinkDone(std::size_t size) noexcept
+{
+	RubberStoreFinished();
+
+	cache.PutDisk(key, cache_tag, info, request_headers,
+		      response.status, *response.headers,
+		      disk_id, size);
+	Destroy();
+}
+
+void
+HttpCacheRequest::OnDiskSinkTooLarge() noexcept
+{
+	LogConcat(4, "HttpCache", "nocache too large ", key.value);
+
+	RubberStoreFinished();
+	Destroy();
+}
+
+void
+HttpCacheRequest::OnDiskSinkError(std::exception_ptr ep) noexcept
+{
+	LogConcat(4, "HttpCache", "body_abort ", key.value, ": ", ep);
+
+	RubberStoreFinished();
+	Destroy();
+}
+
+inline bool
+HttpCacheRequest::CreateDiskFile() noexcept
+{
+	auto *disk = cache.GetDisk();
+	assert(disk != nullptr);
+
+	try {
+		std::tie(disk_id, disk_fd) = disk->CreateFile();
+		return true;
+	} catch (...) {
+		LogConcat(2, "HttpCache", "nocache ", key.value, ": ",
+			  std::current_exception());
+		return false;
+	}
+}
+
 /*
  * http response handler
  *
@@ -579,6 +924,42 @@ AutoFlushHttpCacheRequest::OnHttpResponse(HttpStatus status,
 	_handler.InvokeResponse(status, std::move(_headers), std::move(body));
 }
 
+void
+RangeMissHttpCacheRequest::OnHttpResponse(HttpStatus status,
+					  StringMap &&_headers,
+					  UnusedIstreamPtr body) noexcept
+{
+	if (status == HttpStatus::PARTIAL_CONTENT)
+		cache.StartFill(caller_pool, key, params, address,
+				request_headers, info, _headers);
+
+	auto &_handler = handler;
+	Destroy();
+
+	_handler.InvokeResponse(status, std::move(_headers), std::move(body));
+}
+
+void
+HttpCacheFill::OnHttpResponse(HttpStatus, StringMap &&,
+			      UnusedIstreamPtr body) noexcept
+{
+	/* the HttpCacheRequest keeps reading the body into the
+	   cache */
+	body.Clear();
+
+	cache.RemoveFill(*this);
+	Destroy();
+}
+
+void
+HttpCacheFill::OnHttpError(std::exception_ptr ep) noexcept
+{
+	LogConcat(4, "HttpCache", "fill_abort ", key.value, ": ", ep);
+
+	cache.RemoveFill(*this);
+	Destroy();
+}
+
 void
 HttpCacheRequest::OnHttpResponse(HttpStatus status, StringMap &&_headers,
 				 UnusedIstreamPtr body) noexcept
@@ -592,7 +973,8 @@ HttpCacheRequest::OnHttpResponse(HttpStatus status, StringMap &&_headers,
 							      alloc,
 							      eager_cache,
 							      HttpStatus::OK,
-							      _headers, 0);
+							      _headers, 0,
+							      cacheable_size_limit);
 		    _info && _info->expires >= GetEventLoop().SystemNow()) {
 			/* copy the new "Expires" (or "max-age") value from the
 			   "304 Not Modified" response */
@@ -634,11 +1016,19 @@ HttpCacheRequest::OnHttpResponse(HttpStatus status, StringMap &&_headers,
 		? body.GetLength().length
 		: 0;
 
-	if (auto _info = http_cache_response_evaluate(request_info, alloc,
-						      eager_cache,
-						      status, _headers,
-						      body_length);
-	    _info) {
+	/* responses which are too large for the rubber allocator
+	   may be stored in the disk tier */
+	const off_t size_limit = cache.GetSizeLimit();
+
+	auto _info = http_cache_response_evaluate(request_info, alloc,
+						  eager_cache,
+						  status, _headers,
+						  body_length, size_limit);
+	if (_info && body_length > cacheable_size_limit &&
+	    !CreateDiskFile())
+		_info.reset();
+
+	if (_info) {
 		info = std::move(*_info);
 	} else {
 		/* don't cache response */
@@ -708,10 +1098,18 @@ HttpCacheRequest::OnHttpResponse(HttpStatus status, StringMap &&_headers,
 
 		cache.AddRequest(*this);
 
-		sink_rubber_new(pool, AddTeeIstream(tee, false),
-				cache.GetRubber(), cacheable_size_limit,
-				*this,
-				cancel_ptr);
+		if (disk_fd.IsDefined())
+			NewHttpCacheDiskSink(pool, AddTeeIstream(tee, false),
+					     *cache.GetDisk(),
+					     disk_id, std::move(disk_fd),
+					     size_limit,
+					     *this,
+					     cancel_ptr);
+		else
+			sink_rubber_new(pool, AddTeeIstream(tee, false),
+					cache.GetRubber(), cacheable_size_limit,
+					*this,
+					cancel_ptr);
 
 		body = std::move(tee);
 	}
@@ -776,14 +1174,25 @@ HttpCacheRequest::HttpCacheRequest(PoolPtr &&_pool,
 
 inline
 HttpCache::HttpCache(struct pool &_pool, size_t max_size,
+		     CacheAdmission admission,
 		     bool _obey_no_cache,
+		     const HttpCacheKeyRules &_key_rules,
+		     const HttpCacheDiskConfig &disk_config,
 		     EventLoop &_event_loop,
+#ifdef HAVE_URING
+		     Uring::Queue *uring,
+#endif
 		     ResourceLoader &_resource_loader)
 	:pool(pool_new_dummy(&_pool, "http_cache")),
 	 event_loop(_event_loop),
 	 compress_timer(event_loop, BIND_THIS_METHOD(OnCompressTimer)),
-	 heap(pool, event_loop, max_size),
+	 heap(pool, event_loop,
+#ifdef HAVE_URING
+	      uring,
+#endif
+	      max_size, admission, disk_config),
 	 resource_loader(_resource_loader),
+	 key_rules(_key_rules),
 	 obey_no_cache(_obey_no_cache)
 {
 	assert(max_size > 0);
@@ -793,14 +1202,25 @@ HttpCache::HttpCache(struct pool &_pool, size_t max_size,
 
 HttpCache *
 http_cache_new(struct pool &pool, size_t max_size,
+	       CacheAdmission admission,
 	       bool obey_no_cache,
+	       const HttpCacheKeyRules &key_rules,
+	       const HttpCacheDiskConfig &disk_config,
 	       EventLoop &event_loop,
+#ifdef HAVE_URING
+	       Uring::Queue *uring,
+#endif
 	       ResourceLoader &resource_loader)
 {
 	assert(max_size > 0);
 
-	return new HttpCache(pool, max_size, obey_no_cache,
-			     event_loop, resource_loader);
+	return new HttpCache(pool, max_size, admission, obey_no_cache,
+			     key_rules, disk_config,
+			     event_loop,
+#ifdef HAVE_URING
+			     uring,
+#endif
+			     resource_loader);
 }
 
 void
@@ -822,6 +1242,7 @@ HttpCacheRequest::AbortRubberStore() noexcept
 inline
 HttpCache::~HttpCache() noexcept
 {
+	fills.clear_and_dispose(std::mem_fn(&HttpCacheFill::Cancel));
 	requests.clear_and_dispose(std::mem_fn(&HttpCacheRequest::AbortRubberStore));
 }
 
@@ -849,6 +1270,12 @@ http_cache_get_stats(const HttpCache &cache) noexcept
 	return cache.GetStats();
 }
 
+HttpCacheKeyStats
+http_cache_get_key_stats(const HttpCache &cache) noexcept
+{
+	return cache.GetKeyStats();
+}
+
 void
 http_cache_flush(HttpCache &cache) noexcept
 {
@@ -882,6 +1309,14 @@ HttpCache::Miss(struct pool &caller_pool,
 		return;
 	}
 
+	if (!info.IsStorable()) {
+		ForwardPartial(caller_pool, parent_stopwatch,
+			       key, params, info,
+			       method, address, std::move(headers),
+			       handler, cancel_ptr);
+		return;
+	}
+
 	/* the cache request may live longer than the caller pool, so
 	   allocate a new pool for it from cache.pool */
 	auto request_pool = pool_new_linear(pool, "HttpCacheRequest", 8192);
@@ -905,6 +1340,121 @@ HttpCache::Miss(struct pool &caller_pool,
 		       cancel_ptr);
 }
 
+bool
+HttpCache::IsFilling(StringWithHash key) const noexcept
+{
+	return std::any_of(fills.begin(), fills.end(), [key](const auto &fill){
+		return fill.GetKey() == key;
+	});
+}
+
+inline void
+HttpCache::ForwardPartial(struct pool &caller_pool,
+			  const StopwatchPtr &parent_stopwatch,
+			  StringWithHash key,
+			  const ResourceRequestParams &params,
+			  const HttpCacheRequestInfo &info,
+			  HttpMethod method,
+			  const ResourceAddress &address,
+			  StringMap &&headers,
+			  HttpResponseHandler &handler,
+			  CancellablePointer &cancel_ptr) noexcept
+{
+	LogConcat(4, "HttpCache", "forward ", key.value);
+
+	if (info.range == nullptr || fills.size() >= MAX_FILLS ||
+	    IsFilling(key)) {
+		/* no background fill */
+		resource_loader.SendRequest(caller_pool, parent_stopwatch,
+					    params,
+					    method, address,
+					    std::move(headers), nullptr,
+					    handler, cancel_ptr);
+		return;
+	}
+
+	auto request =
+		NewFromPool<RangeMissHttpCacheRequest>(caller_pool, caller_pool,
+						       *this, key, params,
+						       address, headers,
+						       info, handler);
+	request->Start(resource_loader, parent_stopwatch,
+		       method, std::move(headers),
+		       cancel_ptr);
+}
+
+void
+HttpCache::StartFill(struct pool &caller_pool,
+		     StringWithHash key,
+		     const ResourceRequestParams &params,
+		     const ResourceAddress &address,
+		     const StringMap &request_headers,
+		     const HttpCacheRequestInfo &info,
+		     const StringMap &response_headers) noexcept
+{
+	/* check again; another fill may have been started while this
+	   request was pending */
+	if (fills.size() >= MAX_FILLS || IsFilling(key))
+		return;
+
+	const char *content_range = response_headers.Get(content_range_header);
+	if (content_range == nullptr)
+		return;
+
+	const auto size = ParseHttpCacheContentRangeSize(content_range);
+	if (!size)
+		return;
+
+	/* the fill request is a plain unconditional GET */
+	HttpCacheRequestInfo fill_info = info;
+	fill_info.if_match = fill_info.if_none_match = nullptr;
+	fill_info.if_modified_since = fill_info.if_unmodified_since = nullptr;
+	fill_info.range = fill_info.if_range = nullptr;
+
+	/* evaluate the partial response as if it were the whole
+	   resource to avoid fetching resources which are too large
+	   or which are not cacheable at all */
+	if (!http_cache_response_evaluate(fill_info, caller_pool,
+					  params.eager_cache,
+					  HttpStatus::OK, response_headers,
+					  *size, GetSizeLimit()))
+		return;
+
+	StringMap fill_headers{ShallowCopy{}, caller_pool, request_headers};
+	fill_headers.RemoveAll(range_header);
+	fill_headers.RemoveAll(if_range_header);
+	fill_headers.RemoveAll(if_match_header);
+	fill_headers.RemoveAll(if_none_match_header);
+	fill_headers.RemoveAll(if_modified_since_header);
+	fill_headers.RemoveAll(if_unmodified_since_header);
+
+	auto *fill = NewFromPool<HttpCacheFill>(pool_new_linear(pool, "HttpCacheFill", 256),
+						*this, key);
+	fills.push_back(*fill);
+
+	/* the cache request may live longer than the caller pool, so
+	   allocate a new pool for it from cache.pool */
+	auto request_pool = pool_new_linear(pool, "HttpCacheRequest", 8192);
+
+	auto request =
+		NewFromPool<HttpCacheRequest>(std::move(request_pool), caller_pool,
+					      params.eager_cache,
+					      params.cache_tag,
+					      *this,
+					      key,
+					      fill_headers,
+					      *fill,
+					      fill_info, nullptr, SharedLease{});
+
+	LogConcat(4, "HttpCache", "fill ", key.value);
+
+	request->Start(resource_loader, nullptr,
+		       params,
+		       HttpMethod::GET, address,
+		       std::move(fill_headers),
+		       fill->cancel_ptr);
+}
+
 [[gnu::pure]]
 static bool
 CheckETagList(const char *list, const StringMap &response_headers) noexcept
@@ -994,12 +1544,171 @@ CheckCacheRequest(struct pool &pool, const HttpCacheRequestInfo &info,
 	return true;
 }
 
+/**
+ * Check the "If-Range" request header (RFC 9110 13.1.5).
+ *
+ * @return true if the "Range" request header shall be applied
+ */
+[[gnu::pure]]
+static bool
+CheckIfRange(const char *if_range, const HttpCacheDocument &document) noexcept
+{
+	if (if_range == nullptr)
+		return true;
+
+	if (*if_range == '"') {
+		/* an entity tag; weak entity tags never match
+		   because their "W/" prefix does not */
+		const char *etag = document.response_headers.Get(etag_header);
+		return etag != nullptr && StringIsEqual(if_range, etag);
+	}
+
+	/* an HTTP-date which must be an exact match */
+	const char *last_modified = document.response_headers.Get(last_modified_header);
+	return last_modified != nullptr &&
+		StringIsEqual(if_range, last_modified);
+}
+
+static const char *
+FormatContentRange(AllocatorPtr alloc, const HttpCacheByteRange &range,
+		   uint_least64_t size) noexcept
+{
+	return alloc.Dup(FmtBuffer<80>("bytes {}-{}/{}",
+				       range.start, range.end - 1,
+				       size).c_str());
+}
+
+inline void
+HttpCache::ServeRanges(struct pool &caller_pool,
+		       HttpCacheDocument &document,
+		       const StringWithHash key,
+		       const HttpCacheRanges &ranges,
+		       HttpResponseHandler &handler) noexcept
+{
+	const AllocatorPtr alloc{caller_pool};
+	const uint_least64_t size = HttpCacheHeap::GetBodySize(document);
+
+	if (ranges.type == HttpCacheRanges::Type::UNSATISFIABLE) {
+		LogConcat(4, "HttpCache", "serve_unsatisfiable ", key.value);
+
+		StringMap headers;
+		headers.Add(alloc, content_range_header,
+			    alloc.Dup(FmtBuffer<40>("bytes */{}", size).c_str()));
+		headers.Add(alloc, x_cache_header, "HIT");
+
+		handler.InvokeResponse(HttpStatus::REQUESTED_RANGE_NOT_SATISFIABLE,
+				       std::move(headers), UnusedIstreamPtr());
+		return;
+	}
+
+	assert(ranges.type == HttpCacheRanges::Type::VALID);
+	assert(ranges.n > 0);
+
+	LogConcat(4, "HttpCache", "serve_range ", key.value);
+
+	/* the body holds a lease on the document, which keeps the
+	   header strings valid */
+	StringMap headers{ShallowCopy{}, caller_pool, document.response_headers};
+	headers.Add(alloc, x_cache_header, "HIT");
+
+	if (ranges.n == 1) {
+		const auto &range = ranges.ranges.front();
+
+		headers.Add(alloc, content_range_header,
+			    FormatContentRange(alloc, range, size));
+
+		handler.InvokeResponse(HttpStatus::PARTIAL_CONTENT,
+				       std::move(headers),
+				       heap.OpenStream(caller_pool, document,
+						       range.start, range.end));
+		return;
+	}
+
+	/* multiple ranges: generate a "multipart/byteranges" body
+	   (RFC 9110 14.6) */
+
+	const char *content_type = document.response_headers.Get(content_type_header);
+	const std::string_view part_content_type = content_type != nullptr
+		? alloc.Concat("content-type: "sv, std::string_view{content_type}, "\r\n"sv)
+		: std::string_view{};
+
+	const auto boundary = FmtBuffer<40>("{:x}{:016x}",
+					    key.hash, next_boundary++);
+
+	std::array<UnusedIstreamPtr, 2 * HttpCacheRanges::MAX + 1> inputs;
+	std::size_t n_inputs = 0;
+
+	for (const auto &range : ranges.GetRanges()) {
+		const bool first = n_inputs == 0;
+		inputs[n_inputs++] =
+			istream_string_new(caller_pool,
+					   alloc.Concat(first ? "--"sv : "\r\n--"sv,
+							std::string_view{boundary.c_str()},
+							"\r\n"sv,
+							part_content_type,
+							"content-range: "sv,
+							FormatContentRange(alloc, range, size),
+							"\r\n\r\n"sv));
+		inputs[n_inputs++] = heap.OpenStream(caller_pool, document,
+						     range.start, range.end);
+	}
+
+	inputs[n_inputs++] =
+		istream_string_new(caller_pool,
+				   alloc.Concat("\r\n--"sv,
+						std::string_view{boundary.c_str()},
+						"--\r\n"sv));
+
+	headers.SecureSet(alloc, content_type_header,
+			  alloc.Concat("multipart/byteranges; boundary="sv,
+				       std::string_view{boundary.c_str()}));
+
+	handler.InvokeResponse(HttpStatus::PARTIAL_CONTENT,
+			       std::move(headers),
+			       _NewConcatIstream(caller_pool,
+						 std::span{inputs.data(), n_inputs}));
+}
+
 inline void
 HttpCache::Serve(struct pool &caller_pool,
 		 HttpCacheDocument &document,
 		 const StringWithHash key,
+		 const HttpCacheRequestInfo &info,
 		 HttpResponseHandler &handler) noexcept
 {
+	if (info.range != nullptr && document.status == HttpStatus::OK &&
+	    HttpCacheHeap::GetBodySize(document) > 0 &&
+	    CheckIfRange(info.if_range, document)) {
+		const auto ranges = ParseHttpCacheRanges(info.range,
+							 HttpCacheHeap::GetBodySize(document));
+		if (ranges.type != HttpCacheRanges::Type::NONE) {
+			ServeRanges(caller_pool, document, key, ranges, handler);
+			return;
+		}
+	}
+
+	if (info.head) {
+		LogConcat(4, "HttpCache", "serve_head ", key.value);
+
+		/* no response body: copy all headers into the
+		   caller's pool (see below) */
+		StringMap headers{caller_pool, document.response_headers};
+		const AllocatorPtr alloc{caller_pool};
+
+		if (!http_status_is_empty(document.status))
+			/* pass Content-Length, even though there is
+			   no response body (RFC 9110 9.3.2) */
+			headers.SecureSet(alloc, content_length_header,
+					  alloc.Dup(FmtBuffer<24>("{}", HttpCacheHeap::GetBodySize(document)).c_str()));
+
+		headers.Add(alloc, x_cache_header, "HIT");
+
+		handler.InvokeResponse(document.status,
+				       std::move(headers),
+				       UnusedIstreamPtr());
+		return;
+	}
+
 	LogConcat(4, "HttpCache", "serve ", key.value);
 
 	auto body = heap.OpenStream(caller_pool, document);
@@ -1031,7 +1740,7 @@ HttpCacheRequest::Serve() noexcept
 	if (!CheckCacheRequest(pool, request_info, *document, handler))
 		return;
 
-	cache.Serve(caller_pool, *document, key, handler);
+	cache.Serve(caller_pool, *document, key, request_info, handler);
 }
 
 inline void
@@ -1106,8 +1815,16 @@ HttpCache::Found(const HttpCacheRequestInfo &info,
 		return;
 
 	if (http_cache_may_serve(GetEventLoop(), info, document))
-		Serve(caller_pool, document, key,
+		Serve(caller_pool, document, key, info,
 		      handler);
+	else if (!info.IsStorable())
+		/* a "HEAD" or "Range" request cannot revalidate the
+		   document, because a new response could not be
+		   stored */
+		ForwardPartial(caller_pool, parent_stopwatch,
+			       key, params, info,
+			       method, address, std::move(headers),
+			       handler, cancel_ptr);
 	else
 		Revalidate(caller_pool, parent_stopwatch,
 			   key, params,
@@ -1119,7 +1836,7 @@ HttpCache::Found(const HttpCacheRequestInfo &info,
 inline void
 HttpCache::Use(struct pool &caller_pool,
 	       const StopwatchPtr &parent_stopwatch,
-	       const StringWithHash key,
+	       const StringWithHash key, unsigned key_rules_applied,
 	       const ResourceRequestParams &params,
 	       HttpMethod method,
 	       const ResourceAddress &address,
@@ -1130,16 +1847,26 @@ HttpCache::Use(struct pool &caller_pool,
 {
 	auto *document = heap.Get(key, headers);
 
-	if (document == nullptr)
+	for (std::size_t i = 0; i < N_HTTP_CACHE_KEY_RULES; ++i) {
+		if (key_rules_applied & (1U << i)) {
+			++key_stats.rules[i].normalized;
+			if (document != nullptr)
+				++key_stats.rules[i].hits;
+		}
+	}
+
+	if (document == nullptr) {
 		Miss(caller_pool, parent_stopwatch,
 		     key, params, info,
 		     method, address, std::move(headers),
 		     handler, cancel_ptr);
-	else
-		Found(info, *document, key, caller_pool, parent_stopwatch,
-		      params,
-		      method, address, std::move(headers),
-		      handler, cancel_ptr);
+		return;
+	}
+
+	Found(info, *document, key, caller_pool, parent_stopwatch,
+	      params,
+	      method, address, std::move(headers),
+	      handler, cancel_ptr);
 }
 
 [[gnu::pure]]
@@ -1160,7 +1887,23 @@ HttpCache::Start(struct pool &caller_pool,
 		 HttpResponseHandler &handler,
 		 CancellablePointer &cancel_ptr) noexcept
 {
-	auto key = http_cache_key(caller_pool, address, params.address_id);
+	unsigned key_rules_applied = 0;
+	StringWithHash key{nullptr};
+
+	if (key_rules.IsEnabled()) {
+		/* calculate the key from a normalized copy of the
+		   address; the precalculated address_id can only be
+		   used if no rule has modified it */
+		const auto key_address =
+			NormalizeCacheKeyAddress(caller_pool, address, key_rules,
+						 key_rules_applied);
+		key = http_cache_key(caller_pool, key_address,
+				     key_rules_applied == 0
+				     ? params.address_id
+				     : StringWithHash{nullptr});
+	} else
+		key = http_cache_key(caller_pool, address, params.address_id);
+
 	if (/* this address type cannot be cached; skip the rest of this
 	       library */
 	    key.IsNull() ||
@@ -1211,7 +1954,7 @@ HttpCache::Start(struct pool &caller_pool,
 						    body)) {
 		assert(!body);
 
-		Use(caller_pool, parent_stopwatch, key, params,
+		Use(caller_pool, parent_stopwatch, key, key_rules_applied, params,
 		    method, address, std::move(headers), *info,
 		    handler, cancel_ptr);
 	} else if (params.auto_flush_cache && IsModifyingMethod(method)) {
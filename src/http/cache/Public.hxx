@@ -4,11 +4,14 @@
 
 #pragma once
 
+#include "io/uring/config.h" // for HAVE_URING
+
 #include <cstdint>
 #include <cstddef>
 #include <string_view>
 
 enum class HttpMethod : uint_least8_t;
+enum class CacheAdmission : uint_least8_t;
 struct pool;
 class StopwatchPtr;
 struct ResourceRequestParams;
@@ -19,16 +22,28 @@ struct ResourceAddress;
 class StringMap;
 class HttpResponseHandler;
 struct CacheStats;
+struct HttpCacheKeyRules;
+struct HttpCacheDiskConfig;
+struct HttpCacheKeyStats;
 class HttpCache;
 class CancellablePointer;
+namespace Uring { class Queue; }
 
 /**
  * Caching HTTP responses.
+ *
+ * Throws if the disk tier cannot be initialized.
  */
 HttpCache *
 http_cache_new(struct pool &pool, size_t max_size,
+	       CacheAdmission admission,
 	       bool obey_no_cache,
+	       const HttpCacheKeyRules &key_rules,
+	       const HttpCacheDiskConfig &disk_config,
 	       EventLoop &event_loop,
+#ifdef HAVE_URING
+	       Uring::Queue *uring,
+#endif
 	       ResourceLoader &resource_loader);
 
 void
@@ -44,6 +59,10 @@ http_cache_populate(HttpCache &cache) noexcept;
 CacheStats
 http_cache_get_stats(const HttpCache &cache) noexcept;
 
+[[gnu::pure]]
+HttpCacheKeyStats
+http_cache_get_key_stats(const HttpCache &cache) noexcept;
+
 void
 http_cache_flush(HttpCache &cache) noexcept;
 
@@ -32,13 +32,11 @@ http_cache_request_evaluate(HttpMethod method,
 			    bool obey_no_cache,
 			    bool has_request_body) noexcept
 {
-	if (method != HttpMethod::GET || has_request_body)
+	if ((method != HttpMethod::GET && method != HttpMethod::HEAD) ||
+	    has_request_body)
 		/* RFC 2616 13.11 "Write-Through Mandatory" */
 		return std::nullopt;
 
-	if (headers.Contains(range_header))
-		return std::nullopt;
-
 	/* RFC 2616 14.8: "When a shared cache receives a request
 	   containing an Authorization field, it MUST NOT return the
 	   corresponding response as a reply to any other request
@@ -78,6 +76,14 @@ http_cache_request_evaluate(HttpMethod method,
 	info.if_modified_since = headers.Get(if_modified_since_header);
 	info.if_unmodified_since = headers.Get(if_unmodified_since_header);
 
+	/* HEAD and Range requests can be served from a cached GET
+	   response (RFC 9111 4.3.5 and RFC 9110 14.2) */
+	info.head = method == HttpMethod::HEAD;
+	info.range = info.head ? nullptr : headers.Get(range_header);
+	info.if_range = info.range != nullptr
+		? headers.Get(if_range_header)
+		: nullptr;
+
 	return info;
 }
 
@@ -170,12 +176,12 @@ http_cache_response_evaluate(const HttpCacheRequestInfo &request_info,
 			     AllocatorPtr alloc,
 			     bool eager_cache,
 			     HttpStatus status, const StringMap &headers,
-			     off_t body_available) noexcept
+			     off_t body_available, off_t size_limit) noexcept
 {
 	if (!http_status_cacheable(status))
 		return std::nullopt;
 
-	if (body_available > cacheable_size_limit)
+	if (body_available > size_limit)
 		/* too large for the cache */
 		return std::nullopt;
 
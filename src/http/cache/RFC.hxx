@@ -52,6 +52,8 @@ http_cache_request_invalidate(HttpMethod method) noexcept;
 
 /**
  * Check whether the HTTP response should be put into the cache.
+ *
+ * @param size_limit responses larger than this are not cacheable
  */
 [[nodiscard]] [[gnu::pure]]
 std::optional<HttpCacheResponseInfo>
@@ -59,7 +61,7 @@ http_cache_response_evaluate(const HttpCacheRequestInfo &request_info,
 			     AllocatorPtr alloc,
 			     bool eager_cache,
 			     HttpStatus status, const StringMap &headers,
-			     off_t body_available) noexcept;
+			     off_t body_available, off_t size_limit) noexcept;
 
 /**
  * Copy all request headers mentioned in the Vary response header to a
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Range.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/NumberParser.hxx"
+#include "util/StringCompare.hxx"
+#include "util/StringStrip.hxx"
+
+#include <algorithm> // for std::sort()
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * Skip the given range unit prefix, which is compared
+ * case-insensitively (RFC 9110 14.1).
+ */
+static bool
+SkipRangeUnit(std::string_view &s, std::string_view prefix) noexcept
+{
+	if (s.size() < prefix.size() ||
+	    !StringIsEqualIgnoreCase(s.substr(0, prefix.size()), prefix))
+		return false;
+
+	s.remove_prefix(prefix.size());
+	return true;
+}
+
+/**
+ * Parse one "int-range" or "suffix-range".
+ *
+ * @return false on syntax error
+ */
+static bool
+ParseRangeSpec(std::string_view spec, uint_least64_t size,
+	       HttpCacheByteRange &range, bool &satisfiable) noexcept
+{
+	const auto dash = spec.find('-');
+	if (dash == spec.npos)
+		return false;
+
+	const auto first = spec.substr(0, dash);
+	const auto last = spec.substr(dash + 1);
+
+	if (first.empty()) {
+		/* suffix-range: the last N bytes */
+		const auto length = ParseInteger<uint_least64_t>(last);
+		if (!length)
+			return false;
+
+		satisfiable = *length > 0 && size > 0;
+		range.start = size > *length ? size - *length : 0;
+		range.end = size;
+		return true;
+	}
+
+	const auto start = ParseInteger<uint_least64_t>(first);
+	if (!start)
+		return false;
+
+	uint_least64_t end = size;
+	if (!last.empty()) {
+		const auto l = ParseInteger<uint_least64_t>(last);
+		if (!l || *l < *start)
+			return false;
+
+		/* clamp before adding one, because "*l + 1"
+		   overflows if the client sends the maximum
+		   value */
+		end = *l >= size ? size : *l + 1;
+	}
+
+	satisfiable = *start < size;
+	range.start = *start;
+	range.end = end;
+	return true;
+}
+
+HttpCacheRanges
+ParseHttpCacheRanges(std::string_view header, uint_least64_t size) noexcept
+{
+	HttpCacheRanges result;
+
+	if (!SkipRangeUnit(header, "bytes="sv))
+		/* unsupported range unit */
+		return result;
+
+	bool any = false;
+
+	for (std::string_view spec : IterableSplitString(header, ',')) {
+		spec = Strip(spec);
+		if (spec.empty())
+			/* empty list elements are allowed (RFC 9110 5.6.1) */
+			continue;
+
+		HttpCacheByteRange range;
+		bool satisfiable;
+		if (!ParseRangeSpec(spec, size, range, satisfiable))
+			return {};
+
+		any = true;
+
+		if (!satisfiable)
+			continue;
+
+		if (result.n >= result.ranges.size())
+			return {};
+
+		result.ranges[result.n++] = range;
+	}
+
+	if (!any)
+		return {};
+
+	if (result.n == 0) {
+		result.type = HttpCacheRanges::Type::UNSATISFIABLE;
+		return result;
+	}
+
+	/* sort and coalesce overlapping or adjacent ranges (RFC 9110
+	   14.2) */
+	const auto begin = result.ranges.begin(), end = begin + result.n;
+	std::sort(begin, end, [](const auto &a, const auto &b){
+		return a.start < b.start;
+	});
+
+	std::size_t n = 0;
+	for (auto i = begin; i != end; ++i) {
+		if (n > 0 && i->start <= result.ranges[n - 1].end)
+			result.ranges[n - 1].end = std::max(result.ranges[n - 1].end,
+							    i->end);
+		else
+			result.ranges[n++] = *i;
+	}
+
+	result.n = n;
+	result.type = HttpCacheRanges::Type::VALID;
+	return result;
+}
+
+std::optional<uint_least64_t>
+ParseHttpCacheContentRangeSize(std::string_view header) noexcept
+{
+	if (!SkipRangeUnit(header, "bytes "sv))
+		return std::nullopt;
+
+	const auto slash = header.rfind('/');
+	if (slash == header.npos)
+		return std::nullopt;
+
+	/* this returns std::nullopt for "*" (unknown length) */
+	return ParseInteger<uint_least64_t>(Strip(header.substr(slash + 1)));
+}
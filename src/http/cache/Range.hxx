@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+/**
+ * One satisfiable range of a "Range" request header.
+ */
+struct HttpCacheByteRange {
+	uint_least64_t start;
+
+	/**
+	 * The end offset (exclusive).
+	 */
+	uint_least64_t end;
+};
+
+/**
+ * A "Range" request header (RFC 9110 14.2) resolved against the size
+ * of a cached response body.  Overlapping and adjacent ranges are
+ * merged, and the result is sorted.
+ */
+struct HttpCacheRanges {
+	/**
+	 * Requests with more ranges than this are answered with
+	 * the whole body (which RFC 9110 14.2 permits).
+	 */
+	static constexpr std::size_t MAX = 16;
+
+	enum class Type : uint_least8_t {
+		/**
+		 * No usable "Range" header (unsupported unit, bad
+		 * syntax, too many ranges): send the whole body.
+		 */
+		NONE,
+
+		/**
+		 * At least one range is satisfiable.
+		 */
+		VALID,
+
+		/**
+		 * None of the ranges is satisfiable; send "416 Range
+		 * Not Satisfiable".
+		 */
+		UNSATISFIABLE,
+	};
+
+	Type type = Type::NONE;
+
+	std::size_t n = 0;
+
+	std::array<HttpCacheByteRange, MAX> ranges;
+
+	std::span<const HttpCacheByteRange> GetRanges() const noexcept {
+		return {ranges.data(), n};
+	}
+};
+
+/**
+ * Parse a "Range" request header.
+ *
+ * @param size the size of the response body
+ */
+[[gnu::pure]]
+HttpCacheRanges
+ParseHttpCacheRanges(std::string_view header, uint_least64_t size) noexcept;
+
+/**
+ * Extract the complete length from a "Content-Range" response header
+ * (RFC 9110 14.4).
+ *
+ * @return the complete length or std::nullopt if it is unknown or
+ * if the header is malformed
+ */
+[[gnu::pure]]
+std::optional<uint_least64_t>
+ParseHttpCacheContentRangeSize(std::string_view header) noexcept;
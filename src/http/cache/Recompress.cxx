@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Recompress.hxx"
+#include "lib/zlib/Error.hxx"
+
+#include <zlib.h>
+
+#ifdef HAVE_BROTLIDEC
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+
+#include <algorithm> // for std::clamp()
+#include <cstdint>
+#include <new> // for std::bad_alloc
+#include <stdexcept>
+
+using std::string_view_literals::operator""sv;
+
+static constexpr int GZIP_WINDOW_BITS = MAX_WBITS + 16;
+
+/**
+ * Estimate the initial size of the decompression buffer; it will be
+ * grown as needed.
+ */
+static constexpr std::size_t
+GetInitialSize(std::size_t compressed_size, std::size_t max_size) noexcept
+{
+	return std::clamp<std::size_t>(compressed_size * 4, 4096, max_size);
+}
+
+static std::vector<std::byte>
+GunzipAll(std::span<const std::byte> src, std::size_t max_size)
+{
+	z_stream z{};
+	if (int err = inflateInit2(&z, GZIP_WINDOW_BITS); err != Z_OK)
+		throw MakeZlibError(err, "inflateInit2() failed");
+
+	std::vector<std::byte> dest(GetInitialSize(src.size(), max_size));
+
+	z.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(src.data()));
+	z.avail_in = static_cast<uInt>(src.size());
+
+	while (true) {
+		if (z.total_out == dest.size()) {
+			if (dest.size() >= max_size) {
+				inflateEnd(&z);
+				throw std::runtime_error{"Uncompressed data is too large"};
+			}
+
+			dest.resize(std::min(dest.size() * 2, max_size));
+		}
+
+		z.next_out = reinterpret_cast<Bytef *>(dest.data() + z.total_out);
+		z.avail_out = static_cast<uInt>(dest.size() - z.total_out);
+
+		int err = inflate(&z, Z_NO_FLUSH);
+		if (err == Z_STREAM_END)
+			break;
+
+		if (err != Z_OK && err != Z_BUF_ERROR) {
+			inflateEnd(&z);
+			throw MakeZlibError(err, "inflate() failed");
+		}
+
+		if (z.avail_in == 0 && z.avail_out > 0) {
+			inflateEnd(&z);
+			throw std::runtime_error{"Truncated gzip data"};
+		}
+	}
+
+	dest.resize(z.total_out);
+	inflateEnd(&z);
+	return dest;
+}
+
+static std::vector<std::byte>
+GzipBest(std::span<const std::byte> src)
+{
+	z_stream z{};
+	if (int err = deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED,
+				   GZIP_WINDOW_BITS, 9, Z_DEFAULT_STRATEGY);
+	    err != Z_OK)
+		throw MakeZlibError(err, "deflateInit2() failed");
+
+	std::vector<std::byte> dest(deflateBound(&z, src.size()));
+
+	z.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(src.data()));
+	z.avail_in = static_cast<uInt>(src.size());
+	z.next_out = reinterpret_cast<Bytef *>(dest.data());
+	z.avail_out = static_cast<uInt>(dest.size());
+
+	/* deflateBound() guarantees that a single Z_FINISH call
+	   suffices */
+	int err = deflate(&z, Z_FINISH);
+	deflateEnd(&z);
+	if (err != Z_STREAM_END)
+		throw MakeZlibError(err, "deflate() failed");
+
+	dest.resize(z.total_out);
+	return dest;
+}
+
+#ifdef HAVE_BROTLIDEC
+
+static std::vector<std::byte>
+BrotliDecodeAll(std::span<const std::byte> src, std::size_t max_size)
+{
+	BrotliDecoderState *state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+	if (state == nullptr)
+		throw std::bad_alloc{};
+
+	std::vector<std::byte> dest(GetInitialSize(src.size(), max_size));
+
+	std::size_t available_in = src.size();
+	const uint8_t *next_in = reinterpret_cast<const uint8_t *>(src.data());
+	std::size_t total_out = 0;
+
+	while (true) {
+		if (total_out == dest.size()) {
+			if (dest.size() >= max_size) {
+				BrotliDecoderDestroyInstance(state);
+				throw std::runtime_error{"Uncompressed data is too large"};
+			}
+
+			dest.resize(std::min(dest.size() * 2, max_size));
+		}
+
+		std::size_t available_out = dest.size() - total_out;
+		uint8_t *next_out = reinterpret_cast<uint8_t *>(dest.data() + total_out);
+
+		const auto result = BrotliDecoderDecompressStream(state,
+								  &available_in, &next_in,
+								  &available_out, &next_out,
+								  &total_out);
+		if (result == BROTLI_DECODER_RESULT_SUCCESS)
+			break;
+
+		if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT)
+			continue;
+
+		BrotliDecoderDestroyInstance(state);
+		throw std::runtime_error{result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT
+			? "Truncated Brotli data"
+			: "Brotli decoder error"};
+	}
+
+	BrotliDecoderDestroyInstance(state);
+	dest.resize(total_out);
+	return dest;
+}
+
+static std::vector<std::byte>
+BrotliBest(std::span<const std::byte> src, bool text_mode)
+{
+	std::vector<std::byte> dest(BrotliEncoderMaxCompressedSize(src.size()));
+	std::size_t encoded_size = dest.size();
+
+	if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW,
+				   text_mode ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC,
+				   src.size(),
+				   reinterpret_cast<const uint8_t *>(src.data()),
+				   &encoded_size,
+				   reinterpret_cast<uint8_t *>(dest.data())))
+		throw std::runtime_error{"Brotli error"};
+
+	dest.resize(encoded_size);
+	return dest;
+}
+
+#endif // HAVE_BROTLIDEC
+
+std::vector<std::byte>
+RecompressBest(std::string_view encoding, std::span<const std::byte> src,
+	       [[maybe_unused]] bool text_mode,
+	       std::size_t max_uncompressed_size)
+{
+	if (encoding == "gzip"sv)
+		return GzipBest(GunzipAll(src, max_uncompressed_size));
+
+#ifdef HAVE_BROTLIDEC
+	if (encoding == "br"sv)
+		return BrotliBest(BrotliDecodeAll(src, max_uncompressed_size),
+				  text_mode);
+#endif
+
+	throw std::invalid_argument{"Unsupported encoding"};
+}
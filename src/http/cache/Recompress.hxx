@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * Is RecompressBest() able to handle the given "Content-Encoding"?
+ * This depends on the libraries this program was built with.
+ */
+constexpr bool
+CanRecompress(std::string_view encoding) noexcept
+{
+	using std::string_view_literals::operator""sv;
+
+	if (encoding == "gzip"sv)
+		return true;
+
+#ifdef HAVE_BROTLIDEC
+	if (encoding == "br"sv)
+		return true;
+#endif
+
+	return false;
+}
+
+/**
+ * Decompress the given data (with the given "Content-Encoding") and
+ * compress it again with the maximum quality.  This is expensive and
+ * blocking; it is supposed to be run in a worker thread.
+ *
+ * Throws on error (e.g. if the encoding is not supported or if the
+ * input is malformed).
+ *
+ * @param encoding the content encoding, e.g. "gzip" or "br"
+ * @param text_mode a hint that the data is text (used by the
+ * Brotli encoder, ignored by gzip)
+ * @param max_uncompressed_size refuse to decompress more than this
+ */
+std::vector<std::byte>
+RecompressBest(std::string_view encoding, std::span<const std::byte> src,
+	       bool text_mode, std::size_t max_uncompressed_size);
@@ -175,6 +175,14 @@ struct HttpServerConnection final
 
 		uint64_t bytes_received = 0;
 
+		/**
+		 * A "103 Early Hints" response (or the part of it
+		 * which could not be written yet) which shall be sent
+		 * before anything else.  Allocated from the request
+		 * pool.
+		 */
+		std::string_view early_hints;
+
 		/**
 		 * If this is set, the this library rejects the
 		 * request with this HTTP status instead of letting
@@ -243,6 +251,13 @@ struct HttpServerConnection final
 		 */
 		bool upgrade;
 
+		/**
+		 * Is this a HTTP/1.0 request?  Those clients must not
+		 * receive informational (1xx) responses (RFC 9110
+		 * 15.2).
+		 */
+		bool http_1_0;
+
 		/** did the client send an "Expect: 100-continue" header? */
 		bool expect_100_continue;
 
@@ -269,6 +284,7 @@ struct HttpServerConnection final
 #endif
 			ignore_headers = false;
 			bytes_received = 0;
+			early_hints = {};
 		}
 
 		constexpr void SetError(HttpStatus _status, const char *_msg) noexcept {
@@ -469,6 +485,15 @@ struct HttpServerConnection final
 
 	void CancelSend100Continue() noexcept;
 
+	void SendEarlyHints(std::string_view link) noexcept;
+
+	/**
+	 * Write (the rest of) the pending "103 Early Hints" response.
+	 *
+	 * @return false if the connection has been closed
+	 */
+	bool WriteEarlyHints() noexcept;
+
 	void SetResponseIstream(UnusedIstreamPtr r) noexcept;
 
 	/**
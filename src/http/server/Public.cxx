@@ -293,6 +293,26 @@ HttpServerConnection::OnBufferedWrite()
 
 	response.want_write = false;
 
+	if (!request.early_hints.empty()) [[unlikely]] {
+		if (!WriteEarlyHints())
+			return false;
+
+		if (!request.early_hints.empty()) {
+			/* the socket is full; nothing else may be
+			   sent before the rest of it */
+			ScheduleWrite();
+			return true;
+		}
+
+		if (!HasInput() && !request.send_100_continue) {
+			/* there is no response yet, and this write
+			   event has been scheduled only for the "103
+			   Early Hints" intermediate response */
+			socket->UnscheduleWrite();
+			return true;
+		}
+	}
+
 	if (request.send_100_continue) [[unlikely]] {
 		if (!socket->IsEmpty())
 			/* meanwhile, request body data has been
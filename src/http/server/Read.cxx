@@ -13,6 +13,8 @@
 #include "strmap.hxx"
 #include "http/HeaderParser.hxx"
 #include "istream/istream_null.hxx"
+#include "trace/Context.hxx"
+#include "trace/Tracer.hxx"
 #include "http/List.hxx"
 #include "util/SpanCast.hxx"
 #include "util/StringCompare.hxx"
@@ -166,6 +168,8 @@ HttpServerConnection::ParseRequestLine(std::string_view line) noexcept
 
 	auto uri = line.substr(0, space);
 
+	request.http_1_0 = line.substr(space + 6).starts_with("1.0"sv);
+
 	if (uri.size() >= 8192) {
 		request.SetError(HttpStatus::REQUEST_URI_TOO_LONG,
 				 "Request URI is too long\n");
@@ -190,6 +194,19 @@ HttpServerConnection::HeadersFinished(bool has_more) noexcept
 	read_timer.Cancel();
 
 	auto &r = *request.request;
+
+#ifndef ENABLE_STOPWATCH
+	if (!r.stopwatch && trace_honor_traceparent()) {
+		/* the peer may have decided to sample this request */
+		if (const char *traceparent = r.headers.Get(traceparent_header);
+		    traceparent != nullptr) {
+			if (const auto ctx = ParseTraceParent(traceparent);
+			    ctx && ctx->sampled)
+				r.stopwatch = RootStopwatchPtr(*ctx, r.uri);
+		}
+	}
+#endif
+
 	r.stopwatch.RecordEvent("request_headers");
 
 	wait_tracker.Reset();
@@ -27,4 +27,5 @@ struct HttpServerRequest final : public IncomingHttpRequest {
 	void SendResponse(HttpStatus status,
 			  HttpHeaders &&response_headers,
 			  UnusedIstreamPtr response_body) noexcept override;
+	void SendEarlyHints(std::string_view link) noexcept override;
 };
@@ -239,6 +239,10 @@ HttpServerConnection::ResponseIstreamFinished() noexcept
 
 		idle_timer.Schedule(idle_timeout);
 
+		/* a connection waiting for the next request does not
+		   need a receive buffer */
+		socket->FreeInputBufferIfEmpty();
+
 		return true;
 	} else {
 		/* keepalive disabled and response is finished: we must close
@@ -18,6 +18,7 @@
 #include "event/Loop.hxx"
 #include "net/log/ContentType.hxx"
 #include "util/SpanCast.hxx"
+#include "AllocatorPtr.hxx"
 #include "product.h"
 
 #include <fmt/format.h> // for fmt::format_int
@@ -98,6 +99,45 @@ HttpServerConnection::CancelSend100Continue() noexcept
 	}
 }
 
+void
+HttpServerConnection::SendEarlyHints(std::string_view link) noexcept
+{
+	assert(IsValid());
+	assert(request.request != nullptr);
+
+	if (request.http_1_0 || HasInput())
+		/* too old for 1xx responses or too late */
+		return;
+
+	const AllocatorPtr alloc{request.request->pool};
+	request.early_hints = alloc.Concat(request.early_hints,
+					   "HTTP/1.1 103 Early Hints\r\n"
+					   "link: "sv, link, "\r\n\r\n"sv);
+	DeferWrite();
+}
+
+bool
+HttpServerConnection::WriteEarlyHints() noexcept
+{
+	assert(IsValid());
+	assert(!request.early_hints.empty());
+
+	ssize_t nbytes = socket->Write(AsBytes(request.early_hints));
+	if (nbytes >= 0) [[likely]] {
+		request.early_hints.remove_prefix(nbytes);
+		return true;
+	}
+
+	if (nbytes == WRITE_BLOCKING)
+		return true;
+
+	if (nbytes == WRITE_ERRNO)
+		SocketErrorErrno("write error");
+	else if (nbytes != WRITE_DESTROYED)
+		SocketError("write error");
+	return false;
+}
+
 static void
 PrependStatusLine(GrowingBuffer &buffer, HttpStatus status) noexcept
 {
@@ -215,6 +255,23 @@ HttpServerConnection::SubmitResponse(HttpStatus status,
 	if (auto *uring_queue = socket->GetUringQueue()) {
 		assert(uring_send == nullptr);
 
+		if (!request.early_hints.empty()) {
+			/* the io_uring send bypasses
+			   OnBufferedWrite(), so the pending "103 Early
+			   Hints" must go in front of the headers */
+			const auto early_hints = request.early_hints;
+			request.early_hints = {};
+			std::copy(early_hints.begin(), early_hints.end(),
+				  (char *)headers3.Prepend(early_hints.size()));
+
+			if (!request.send_100_continue) {
+				/* the write event was scheduled only
+				   for the "103 Early Hints" response */
+				response.want_write = false;
+				socket->UnscheduleWrite();
+			}
+		}
+
 		if (body) {
 			response.length = 0;
 			SetResponseIstream(std::move(body));
@@ -242,6 +299,14 @@ HttpServerConnection::SubmitResponse(HttpStatus status,
 	DeferWrite();
 }
 
+void
+HttpServerRequest::SendEarlyHints(std::string_view link) noexcept
+{
+	assert(connection.request.request == this);
+
+	connection.SendEarlyHints(link);
+}
+
 void
 HttpServerRequest::SendResponse(HttpStatus status,
 				HttpHeaders &&response_headers,
@@ -9,6 +9,7 @@
 
 #include <brotli/encode.h>
 
+#include <algorithm> // for std::min()
 #include <cassert>
 #include <exception> // for std::terminate()
 #include <stdexcept>
@@ -18,11 +19,14 @@ class BrotliEncoderFilter final : public SimpleThreadIstreamFilter {
 
 	const BrotliEncoderMode mode;
 
+	const unsigned quality;
+
 	BrotliEncoderOperation operation = BROTLI_OPERATION_PROCESS;
 
 public:
 	explicit BrotliEncoderFilter(BrotliEncoderParams params) noexcept
-		:mode(params.text_mode ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC)
+		:mode(params.text_mode ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC),
+		 quality(std::min<unsigned>(params.quality, BROTLI_MAX_QUALITY))
 	{
 	}
 
@@ -50,10 +54,7 @@ BrotliEncoderFilter::CreateEncoder() noexcept
 		   hopeless anyway */
 		std::terminate();
 
-	/* use medium quality; doesn't use too much CPU, but
-	   compresses reasonably well */
-	BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY,
-				  (BROTLI_MIN_QUALITY + BROTLI_MAX_QUALITY) / 2);
+	BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, quality);
 
 	BrotliEncoderSetParameter(state, BROTLI_PARAM_MODE, mode);
 }
@@ -92,7 +93,7 @@ BrotliEncoderFilter::SimpleRun(SliceFifoBuffer &input, SliceFifoBuffer &output,
 }
 
 UnusedIstreamPtr
-NewBrotliEncoderIstream(struct pool &pool, ThreadQueue &queue,
+NewBrotliEncoderIstream(struct pool &pool, WorkerPool &queue,
 			UnusedIstreamPtr input,
 			BrotliEncoderParams params) noexcept
 {
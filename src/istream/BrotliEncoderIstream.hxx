@@ -6,19 +6,26 @@
 
 struct pool;
 class UnusedIstreamPtr;
-class ThreadQueue;
+class WorkerPool;
 
 struct BrotliEncoderParams {
 	/**
 	 * Set BROTLI_MODE_TEXT.
 	 */
 	bool text_mode = false;
+
+	/**
+	 * The value for BROTLI_PARAM_QUALITY (0..11).  The default is
+	 * medium quality; doesn't use too much CPU, but compresses
+	 * reasonably well.
+	 */
+	unsigned quality = 5;
 };
 
 /**
  * An #Istream filter which compresses data on-the-fly with Brotli.
  */
 UnusedIstreamPtr
-NewBrotliEncoderIstream(struct pool &pool, ThreadQueue &queue,
+NewBrotliEncoderIstream(struct pool &pool, WorkerPool &queue,
 			UnusedIstreamPtr input,
 			BrotliEncoderParams params={}) noexcept;
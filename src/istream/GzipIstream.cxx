@@ -17,11 +17,16 @@
 #include <cassert>
 
 class GzipFilter final : public SimpleThreadIstreamFilter {
-	z_stream z;
+	z_stream z{};
+
+	const int level;
 
 	bool z_initialized = false, z_stream_end = false;
 
 public:
+	explicit GzipFilter(GzipParams params) noexcept
+		:level(params.level) {}
+
 	~GzipFilter() noexcept override {
 		if (z_initialized)
 			deflateEnd(&z);
@@ -46,7 +51,7 @@ GzipFilter::InitZlib()
 	if (z_initialized)
 		return;
 
-	int err = deflateInit2(&z, Z_DEFAULT_COMPRESSION,
+	int err = deflateInit2(&z, level,
 			       Z_DEFLATED, GetWindowBits(), 8,
 			       Z_DEFAULT_STRATEGY);
 	if (err != Z_OK)
@@ -86,10 +91,11 @@ GzipFilter::SimpleRun(SliceFifoBuffer &input, SliceFifoBuffer &output,
 }
 
 UnusedIstreamPtr
-NewGzipIstream(struct pool &pool, ThreadQueue &queue,
-	       UnusedIstreamPtr input) noexcept
+NewGzipIstream(struct pool &pool, WorkerPool &queue,
+	       UnusedIstreamPtr input,
+	       GzipParams params) noexcept
 {
 	return NewThreadIstream(pool, queue, std::move(input),
-				std::make_unique<GzipFilter>());
+				std::make_unique<GzipFilter>(params));
 
 }
@@ -6,8 +6,17 @@
 
 struct pool;
 class UnusedIstreamPtr;
-class ThreadQueue;
+class WorkerPool;
+
+struct GzipParams {
+	/**
+	 * The zlib compression level (1..9); -1 means
+	 * Z_DEFAULT_COMPRESSION.
+	 */
+	int level = -1;
+};
 
 UnusedIstreamPtr
-NewGzipIstream(struct pool &pool, ThreadQueue &queue,
-	       UnusedIstreamPtr input) noexcept;
+NewGzipIstream(struct pool &pool, WorkerPool &queue,
+	       UnusedIstreamPtr input,
+	       GzipParams params={}) noexcept;
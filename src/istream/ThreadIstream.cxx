@@ -7,8 +7,8 @@
 #include "Bucket.hxx"
 #include "New.hxx"
 #include "UnusedPtr.hxx"
-#include "thread/Job.hxx"
-#include "thread/Queue.hxx"
+#include "thread/WorkerJob.hxx"
+#include "thread/WorkerPool.hxx"
 #include "event/DeferEvent.hxx"
 #include "memory/fb_pool.hxx"
 #include "util/LeakDetector.hxx"
@@ -23,7 +23,7 @@ ThreadIstreamInternal::~ThreadIstreamInternal() noexcept
 }
 
 class ThreadIstream final : public FacadeIstream {
-	ThreadQueue &queue;
+	WorkerPool &queue;
 
 	SliceFifoBuffer unprotected_output;
 
@@ -34,7 +34,7 @@ class ThreadIstream final : public FacadeIstream {
 	 */
 	DeferEvent defer_ready;
 
-	struct Internal final : ThreadIstreamInternal, ThreadJob, ::LeakDetector {
+	struct Internal final : ThreadIstreamInternal, WorkerJob, ::LeakDetector {
 		ThreadIstream &istream;
 
 		std::unique_ptr<ThreadIstreamFilter> filter;
@@ -122,7 +122,7 @@ class ThreadIstream final : public FacadeIstream {
 			filter->CancelRun(*this);
 		}
 
-		// virtual methods from ThreadJob
+		// virtual methods from WorkerJob
 		void Run() noexcept override;
 		void Done() noexcept override;
 	};
@@ -130,7 +130,7 @@ class ThreadIstream final : public FacadeIstream {
 	std::unique_ptr<Internal> internal;
 
 public:
-	ThreadIstream(struct pool &_pool, ThreadQueue &_queue,
+	ThreadIstream(struct pool &_pool, WorkerPool &_queue,
 		      UnusedIstreamPtr &&_input,
 		      std::unique_ptr<ThreadIstreamFilter> &&_filter) noexcept
 		:FacadeIstream(_pool, std::move(_input)),
@@ -221,7 +221,7 @@ ThreadIstream::Internal::Done() noexcept
 		input_empty = input.empty();
 		input_full = input.IsDefinedAndFull();
 		input.FreeIfEmpty();
-		_again = ThreadIstreamInternal::again || ThreadJob::again;
+		_again = ThreadIstreamInternal::again;
 		ThreadIstreamInternal::again = false;
 
 		if (_again && !output_full) {
@@ -549,7 +549,7 @@ ThreadIstream::OnError(std::exception_ptr &&error) noexcept
 }
 
 UnusedIstreamPtr
-NewThreadIstream(struct pool &pool, ThreadQueue &queue,
+NewThreadIstream(struct pool &pool, WorkerPool &queue,
 		 UnusedIstreamPtr input,
 		 std::unique_ptr<ThreadIstreamFilter> filter) noexcept
 {
@@ -11,7 +11,7 @@
 
 struct pool;
 class UnusedIstreamPtr;
-class ThreadQueue;
+class WorkerPool;
 
 /**
  * Gives #ThreadIstreamFilter access to some of the internals of
@@ -121,6 +121,6 @@ public:
  * to a worker thread.
  */
 UnusedIstreamPtr
-NewThreadIstream(struct pool &pool, ThreadQueue &queue,
+NewThreadIstream(struct pool &pool, WorkerPool &queue,
 		 UnusedIstreamPtr input,
 		 std::unique_ptr<ThreadIstreamFilter> filter) noexcept;
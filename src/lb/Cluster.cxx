@@ -5,12 +5,15 @@
 #include "Cluster.hxx"
 #include "ClusterConfig.hxx"
 #include "Context.hxx"
+#include "Hedge.hxx"
+#include "Warmer.hxx"
 #include "MonitorStock.hxx"
 #include "MonitorRef.hxx"
 #include "fs/Stock.hxx"
 #include "fs/Balancer.hxx"
 #include "fs/Handler.hxx"
 #include "ssl/SslSocketFilterFactory.hxx"
+#include "cluster/AddressList.hxx"
 #include "cluster/ConnectBalancer.hxx"
 #include "cluster/RoundRobinBalancer.cxx"
 #include "stock/GetHandler.hxx"
@@ -35,6 +38,8 @@
 #include "lib/avahi/Explorer.hxx"
 #endif
 
+#include <algorithm> // for std::copy_if()
+
 using std::string_view_literals::operator""sv;
 
 [[gnu::pure]]
@@ -132,6 +137,9 @@ LbCluster::LbCluster(const LbClusterConfig &_config,
 			 config.http_host.empty() ? nullptr : config.http_host.c_str(),
 			 nullptr);
 
+	if (config.IsHedgingEnabled())
+		hedge = std::make_unique<LbHedge>(config);
+
 #ifdef HAVE_AVAHI
 	if (config.HasZeroConf())
 		explorer = config.zeroconf.Create(context.GetAvahiClient(),
@@ -153,6 +161,18 @@ LbCluster::LbCluster(const LbClusterConfig &_config,
 		static_members.emplace_back(std::move(address), failure);
 	}
 
+	if (config.min_idle > 0) {
+		std::vector<SocketAddress> addresses;
+		addresses.reserve(static_members.size());
+		for (const auto &member : static_members)
+			addresses.emplace_back(member.address);
+
+		warmer = std::make_unique<LbClusterWarmer>(fs_stock,
+							   socket_filter_params.get(),
+							   std::move(addresses),
+							   config.min_idle);
+	}
+
 	if (monitors != nullptr)
 		/* create monitors for "static" members */
 		for (const auto &member : config.members)
@@ -171,6 +191,7 @@ LbCluster::ConnectHttp(AllocatorPtr alloc,
 		       std::span<const std::byte> sticky_source,
 		       sticky_hash_t sticky_hash,
 		       Event::Duration timeout,
+		       const FailureInfo *exclude,
 		       FilteredSocketBalancerHandler &handler,
 		       CancellablePointer &cancel_ptr) noexcept
 {
@@ -180,7 +201,7 @@ LbCluster::ConnectHttp(AllocatorPtr alloc,
 				    fairness_hash,
 				    bind_address, arch,
 				    sticky_source,
-				    timeout,
+				    timeout, exclude,
 				    handler, cancel_ptr);
 		return;
 	}
@@ -192,7 +213,7 @@ LbCluster::ConnectHttp(AllocatorPtr alloc,
 	ConnectStaticHttp(alloc, parent_stopwatch,
 			  fairness_hash,
 			  bind_address, sticky_hash,
-			  timeout,
+			  timeout, exclude,
 			  handler, cancel_ptr);
 }
 
@@ -226,17 +247,36 @@ LbCluster::ConnectStaticHttp(AllocatorPtr alloc,
 			     SocketAddress bind_address,
 			     sticky_hash_t sticky_hash,
 			     Event::Duration timeout,
+			     const FailureInfo *exclude,
 			     FilteredSocketBalancerHandler &handler,
 			     CancellablePointer &cancel_ptr) noexcept
 {
 	assert(config.protocol == LbProtocol::HTTP);
 
+	const AddressList *address_list = &config.address_list;
+
+	if (exclude != nullptr && address_list->size() > 1) {
+		/* copy the list without the excluded member */
+		const SocketAddress excluded = FailureManager::GetAddress(*exclude);
+		auto *const addresses = alloc.NewArray<SocketAddress>(address_list->size());
+		const auto end = std::copy_if(address_list->begin(),
+					      address_list->end(),
+					      addresses,
+					      [excluded](SocketAddress i){
+						      return i != excluded;
+					      });
+
+		address_list = alloc.New<AddressList>(ShallowCopy{},
+						      address_list->sticky_mode,
+						      std::span{addresses, end});
+	}
+
 	fs_balancer.Get(alloc, parent_stopwatch,
 			fairness_hash,
 			config.transparent_source,
 			bind_address,
 			sticky_hash,
-			config.address_list,
+			*address_list,
 			timeout,
 			socket_filter_params.get(),
 			handler, cancel_ptr);
@@ -337,7 +377,8 @@ LbCluster::PickZeroconfRendezvous(Expiry now, const Arch arch,
 
 LbCluster::ZeroconfMemberMap::const_pointer
 LbCluster::PickZeroconf(const Expiry now, Arch arch,
-			std::span<const std::byte> sticky_source) noexcept
+			std::span<const std::byte> sticky_source,
+			const FailureInfo *exclude) noexcept
 {
 	if (dirty) {
 		dirty = false;
@@ -351,7 +392,14 @@ LbCluster::PickZeroconf(const Expiry now, Arch arch,
 		return &PickZeroconfRendezvous(now, arch, sticky_source);
 	}
 
-	return &PickNextGoodZeroconf(now);
+	const auto *member = &PickNextGoodZeroconf(now);
+	if (&member->second.GetFailureInfo() == exclude &&
+	    active_zeroconf_members.size() > 1)
+		/* the round-robin balancer has advanced; the next
+		   pick is a different member */
+		member = &PickNextGoodZeroconf(now);
+
+	return member;
 }
 
 void
@@ -378,6 +426,12 @@ class LbCluster::ZeroconfHttpConnect final : StockGetHandler, Lease, Cancellable
 	const Event::Duration timeout;
 	const SocketFilterParams *const filter_params;
 
+	/**
+	 * Avoid the member with this #FailureInfo; see
+	 * LbCluster::ConnectHttp().
+	 */
+	const FailureInfo *const exclude;
+
 	FilteredSocketBalancerHandler &handler;
 
 	FailurePtr failure;
@@ -402,6 +456,7 @@ public:
 			    std::span<const std::byte> _sticky_source,
 			    Event::Duration _timeout,
 			    const SocketFilterParams *_filter_params,
+			    const FailureInfo *_exclude,
 			    FilteredSocketBalancerHandler &_handler,
 			    CancellablePointer &caller_cancel_ptr) noexcept
 		:cluster(_cluster), alloc(_alloc),
@@ -410,6 +465,7 @@ public:
 		 sticky_source(_sticky_source),
 		 timeout(_timeout),
 		 filter_params(_filter_params),
+		 exclude(_exclude),
 		 handler(_handler),
 		 retries(CalculateRetries(cluster.GetZeroconfCount())),
 		 arch(_arch)
@@ -459,7 +515,8 @@ LbCluster::ZeroconfHttpConnect::Start() noexcept
 {
 	auto *member = cluster.PickZeroconf(GetEventLoop().SteadyNow(),
 					    arch,
-					    sticky_source);
+					    sticky_source,
+					    exclude);
 	if (member == nullptr) {
 		auto &_handler = handler;
 		Destroy();
@@ -527,6 +584,7 @@ LbCluster::ConnectZeroconfHttp(AllocatorPtr alloc,
 			       Arch arch,
 			       std::span<const std::byte> sticky_source,
 			       Event::Duration timeout,
+			       const FailureInfo *exclude,
 			       FilteredSocketBalancerHandler &handler,
 			       CancellablePointer &cancel_ptr) noexcept
 {
@@ -539,6 +597,7 @@ LbCluster::ConnectZeroconfHttp(AllocatorPtr alloc,
 						 sticky_source,
 						 timeout,
 						 socket_filter_params.get(),
+						 exclude,
 						 handler, cancel_ptr);
 	c->Start();
 }
@@ -28,7 +28,10 @@ struct LbClusterConfig;
 struct LbContext;
 class LbMonitorStock;
 class LbMonitorRef;
+class LbHedge;
+class LbClusterWarmer;
 class FailureManager;
+class FailureInfo;
 class BalancerMap;
 class FilteredSocketStock;
 class FilteredSocketBalancer;
@@ -56,6 +59,12 @@ class LbCluster final
 
 	std::unique_ptr<SslSocketFilterParams> socket_filter_params;
 
+	/**
+	 * Request hedging state; only allocated if hedging is
+	 * enabled for this cluster.
+	 */
+	std::unique_ptr<LbHedge> hedge;
+
 	struct StaticMember {
 		AllocatedSocketAddress address;
 
@@ -69,6 +78,12 @@ class LbCluster final
 
 	std::vector<StaticMember> static_members;
 
+	/**
+	 * Keeps idle connections to #static_members; only allocated
+	 * if "min_idle" is configured.
+	 */
+	std::unique_ptr<LbClusterWarmer> warmer;
+
 #ifdef HAVE_AVAHI
 	/**
 	 * This #AvahiServiceExplorer locates Zeroconf nodes.
@@ -124,8 +139,24 @@ public:
 		return config;
 	}
 
+	/**
+	 * @return the request hedging state or nullptr if hedging
+	 * is disabled
+	 */
+	LbHedge *GetHedge() noexcept {
+		return hedge.get();
+	}
+
+	const LbHedge *GetHedge() const noexcept {
+		return hedge.get();
+	}
+
 	/**
 	 * Obtain a HTTP connection to a member (Zeroconf or static).
+	 *
+	 * @param exclude if not nullptr, then the member with this
+	 * #FailureInfo is avoided (unless it is the only one); this
+	 * is used to send a hedged request to a different member
 	 */
 	void ConnectHttp(AllocatorPtr alloc,
 			 const StopwatchPtr &parent_stopwatch,
@@ -135,6 +166,7 @@ public:
 			 std::span<const std::byte> sticky_source,
 			 sticky_hash_t sticky_hash,
 			 Event::Duration timeout,
+			 const FailureInfo *exclude,
 			 FilteredSocketBalancerHandler &handler,
 			 CancellablePointer &cancel_ptr) noexcept;
 
@@ -160,6 +192,7 @@ private:
 			       SocketAddress bind_address,
 			       sticky_hash_t sticky_hash,
 			       Event::Duration timeout,
+			       const FailureInfo *exclude,
 			       FilteredSocketBalancerHandler &handler,
 			       CancellablePointer &cancel_ptr) noexcept;
 
@@ -191,7 +224,8 @@ private:
 	 * Zeroconf only.
 	 */
 	ZeroconfMemberMap::const_pointer PickZeroconf(Expiry now, Arch arch,
-						      std::span<const std::byte> sticky_source) noexcept;
+						      std::span<const std::byte> sticky_source,
+						      const FailureInfo *exclude=nullptr) noexcept;
 
 	/**
 	 * Like PickZeroconf(), but pick using Rendezvous Hashing.
@@ -212,6 +246,7 @@ private:
 				 Arch arch,
 				 std::span<const std::byte> sticky_source,
 				 Event::Duration timeout,
+				 const FailureInfo *exclude,
 				 FilteredSocketBalancerHandler &handler,
 				 CancellablePointer &cancel_ptr) noexcept;
 
@@ -8,6 +8,7 @@
 #include "SimpleHttpResponse.hxx"
 #include "cluster/AddressList.hxx"
 #include "cluster/StickyMode.hxx"
+#include "event/Chrono.hxx"
 #include "net/AllocatedSocketAddress.hxx"
 #include "config.h"
 
@@ -97,6 +98,32 @@ struct LbClusterConfig {
 
 	bool mangle_via = false;
 
+	/**
+	 * Send a duplicate of an idempotent request to another member
+	 * if no response headers have arrived after this duration?
+	 * Zero means use the observed 95th percentile (only if
+	 * #hedge_auto is set).
+	 */
+	Event::Duration hedge_delay{};
+
+	/**
+	 * Use the observed 95th percentile of the response header
+	 * latency as hedge delay.
+	 */
+	bool hedge_auto = false;
+
+	/**
+	 * The maximum number of hedged requests in percent of all
+	 * requests.
+	 */
+	unsigned hedge_budget = 5;
+
+	/**
+	 * Keep at least this number of idle connections to each
+	 * static member.
+	 */
+	unsigned min_idle = 0;
+
 	LbSimpleHttpResponse fallback;
 
 	StickyMode sticky_mode = StickyMode::NONE;
@@ -166,6 +193,10 @@ struct LbClusterConfig {
 		return 0;
 	}
 
+	bool IsHedgingEnabled() const noexcept {
+		return hedge_auto || hedge_delay > Event::Duration{};
+	}
+
 	bool HasZeroConf() const noexcept {
 #ifdef HAVE_AVAHI
 		return zeroconf.IsEnabled();
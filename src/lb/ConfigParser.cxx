@@ -677,6 +677,32 @@ LbConfigParser::Cluster::ParseLine(FileLineParser &line)
 		config.mangle_via = line.NextBool();
 
 		line.ExpectEnd();
+	} else if (StringIsEqual(word, "hedge_delay")) {
+		const char *value = line.ExpectValueAndEnd();
+		if (StringIsEqual(value, "auto")) {
+			config.hedge_auto = true;
+			config.hedge_delay = {};
+		} else {
+			char *endptr;
+			const unsigned long ms = strtoul(value, &endptr, 10);
+			if (endptr == value || *endptr != 0 || ms == 0)
+				throw LineParser::Error("Positive number of milliseconds or \"auto\" expected");
+
+			config.hedge_auto = false;
+			config.hedge_delay = std::chrono::milliseconds(ms);
+		}
+	} else if (StringIsEqual(word, "hedge_budget")) {
+		config.hedge_budget = line.NextPositiveInteger();
+		line.ExpectEnd();
+
+		if (config.hedge_budget > 100)
+			throw LineParser::Error("Hedge budget must not exceed 100 percent");
+	} else if (StringIsEqual(word, "min_idle")) {
+		config.min_idle = line.NextPositiveInteger();
+		line.ExpectEnd();
+
+		if (config.min_idle > 64)
+			throw LineParser::Error("min_idle is too large");
 	} else if (StringIsEqual(word, "fallback")) {
 		if (config.fallback.IsDefined())
 			throw LineParser::Error("Duplicate fallback");
@@ -749,6 +775,26 @@ LbConfigParser::Cluster::Finish()
 		   sense */
 		config.sticky_mode = StickyMode::NONE;
 
+	if (config.IsHedgingEnabled()) {
+		if (config.protocol != LbProtocol::HTTP)
+			throw LineParser::Error{"Hedging is only available with HTTP"};
+
+		if (config.sticky_mode != StickyMode::NONE ||
+		    !config.sticky_hex_uuid_uri_prefix.empty())
+			throw LineParser::Error{"Hedging is not compatible with sticky"};
+	}
+
+	if (config.min_idle > 0) {
+		if (config.protocol != LbProtocol::HTTP)
+			throw LineParser::Error{"min_idle is only available with HTTP"};
+
+		if (config.HasZeroConf())
+			throw LineParser::Error{"min_idle is not available with Zeroconf"};
+
+		if (config.transparent_source)
+			throw LineParser::Error{"min_idle is not compatible with transparent source"};
+	}
+
 	auto i = parent.config.clusters.emplace(std::string(config.name),
 						std::move(config));
 	if (!i.second)
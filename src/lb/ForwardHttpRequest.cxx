@@ -12,6 +12,7 @@
 #include "Cookie.hxx"
 #include "JvmRoute.hxx"
 #include "Headers.hxx"
+#include "Hedge.hxx"
 #include "cluster/AddressSticky.hxx"
 #include "http/IncomingRequest.hxx"
 #include "http/Client.hxx"
@@ -22,6 +23,7 @@
 #include "http/Method.hxx"
 #include "strmap.hxx"
 #include "pool/pool.hxx"
+#include "event/FineTimerEvent.hxx"
 #include "net/IPv4Address.hxx"
 #include "net/IPv6Address.hxx"
 #include "net/SocketAddress.hxx"
@@ -37,6 +39,7 @@
 #include "util/StringVerify.hxx"
 #include "util/UuidString.hxx"
 #include "AllocatorPtr.hxx"
+#include "lease.hxx"
 #include "stopwatch.hxx"
 
 #include <algorithm> // for std::copy_n()
@@ -45,7 +48,7 @@ static constexpr Event::Duration LB_HTTP_CONNECT_TIMEOUT =
 	std::chrono::seconds{10};
 
 class LbRequest final
-	: LeakDetector, Cancellable, FilteredSocketBalancerHandler, HttpResponseHandler {
+	: LeakDetector, Cancellable {
 
 	struct pool &pool;
 
@@ -60,12 +63,81 @@ class LbRequest final
 	 */
 	UnusedHoldIstreamPtr body;
 
-	CancellablePointer cancel_ptr;
+	/**
+	 * One connection attempt to a cluster member.  There is
+	 * always the #primary attempt; the #hedge attempt is a
+	 * duplicate of an idempotent request which is sent if the
+	 * primary one does not respond in time.
+	 */
+	class Attempt final : public FilteredSocketBalancerHandler, public HttpResponseHandler {
+		LbRequest &parent;
+
+	public:
+		CancellablePointer cancel_ptr;
+
+		FailurePtr failure;
+
+		/**
+		 * Is this attempt still waiting for the connection or
+		 * for response headers?
+		 */
+		bool pending = false;
+
+		explicit Attempt(LbRequest &_parent) noexcept
+			:parent(_parent) {}
+
+	private:
+		/* virtual methods from class FilteredSocketBalancerHandler */
+		void OnFilteredSocketReady(Lease &lease,
+					   FilteredSocket &socket,
+					   SocketAddress address, const char *name,
+					   ReferencedFailureInfo &_failure) noexcept override {
+			parent.OnAttemptReady(*this, lease, socket, address, name, _failure);
+		}
 
-	FailurePtr failure;
+		void OnFilteredSocketError(std::exception_ptr ep) noexcept override {
+			parent.OnAttemptConnectError(*this, std::move(ep));
+		}
+
+		/* virtual methods from class HttpResponseHandler */
+		void OnHttpResponse(HttpStatus status, StringMap &&headers,
+				    UnusedIstreamPtr body) noexcept override {
+			parent.OnAttemptResponse(*this, status, std::move(headers),
+						 std::move(body));
+		}
+
+		void OnHttpError(std::exception_ptr ep) noexcept override {
+			parent.OnAttemptError(*this, std::move(ep));
+		}
+	};
+
+	Attempt primary{*this}, hedge{*this};
+
+	/**
+	 * Fires when it is time to send the #hedge attempt.
+	 */
+	FineTimerEvent hedge_timer;
+
+	/**
+	 * When was the #primary attempt started?  This is used to
+	 * measure the response latency for LbHedge.
+	 */
+	Event::TimePoint start_time;
 
 	unsigned new_cookie = 0;
 
+	/**
+	 * Have lb_forward_request_headers() been applied already?
+	 */
+	bool headers_forwarded = false;
+
+	/**
+	 * Has the #hedge_timer fired while the #primary attempt was
+	 * still connecting?  The #hedge attempt is then sent as soon
+	 * as the primary's member is known.
+	 */
+	bool hedge_due = false;
+
 public:
 	LbRequest(LbHttpConnection &_connection, LbCluster &_cluster,
 		  IncomingHttpRequest &_request,
@@ -73,7 +145,8 @@ public:
 		:pool(_request.pool), connection(_connection), cluster(_cluster),
 		 cluster_config(cluster.GetConfig()),
 		 request(_request),
-		 body(pool, std::move(request.body)) {
+		 body(pool, std::move(request.body)),
+		 hedge_timer(GetEventLoop(), BIND_THIS_METHOD(OnHedgeTimer)) {
 		_cancel_ptr = *this;
 	}
 
@@ -92,11 +165,15 @@ private:
 		DeleteFromPool(pool, this);
 	}
 
-	void SetForwardedTo() noexcept {
-		assert(failure);
+	Attempt &GetOther(const Attempt &attempt) noexcept {
+		return &attempt == &primary ? hedge : primary;
+	}
+
+	void SetForwardedTo(const Attempt &attempt) noexcept {
+		assert(attempt.failure);
 
 		auto &rl = *(LbRequestLogger *)request.logger;
-		rl.forwarded_to = GetFailureManager().GetAddressString(*failure);
+		rl.forwarded_to = GetFailureManager().GetAddressString(*attempt.failure);
 	}
 
 	const char *GetCanonicalHost() const noexcept {
@@ -121,24 +198,51 @@ private:
 
 	SocketAddress MakeBindAddress() const noexcept;
 
+	/**
+	 * May a duplicate of this request be sent to another member?
+	 * Only idempotent requests without a body qualify.
+	 */
+	[[gnu::pure]]
+	bool IsHedgeable() const noexcept;
+
+	/**
+	 * @param exclude avoid the member with this #FailureInfo
+	 */
+	void StartAttempt(Attempt &attempt,
+			  const FailureInfo *exclude=nullptr) noexcept;
+
+	void ForwardRequestHeaders() noexcept;
+
+	/**
+	 * An attempt has failed.  If the other one is still pending,
+	 * wait for it; else send an error response.
+	 */
+	void AttemptFailed(Attempt &attempt, std::exception_ptr ep) noexcept;
+
+	void OnHedgeTimer() noexcept;
+
+	void OnAttemptReady(Attempt &attempt, Lease &lease,
+			    FilteredSocket &socket,
+			    SocketAddress address, const char *name,
+			    ReferencedFailureInfo &failure) noexcept;
+	void OnAttemptConnectError(Attempt &attempt,
+				   std::exception_ptr ep) noexcept;
+	void OnAttemptResponse(Attempt &attempt,
+			       HttpStatus status, StringMap &&headers,
+			       UnusedIstreamPtr body) noexcept;
+	void OnAttemptError(Attempt &attempt, std::exception_ptr ep) noexcept;
+
 	/* virtual methods from class Cancellable */
 	void Cancel() noexcept override {
 		connection.RecordAbuse();
-		cancel_ptr.Cancel();
+
+		if (primary.pending)
+			primary.cancel_ptr.Cancel();
+		if (hedge.pending)
+			hedge.cancel_ptr.Cancel();
+
 		Destroy();
 	}
-
-	/* virtual methods from class FilteredSocketBalancerHandler */
-	void OnFilteredSocketReady(Lease &lease,
-				   FilteredSocket &socket,
-				   SocketAddress address, const char *name,
-				   ReferencedFailureInfo &failure) noexcept override;
-	void OnFilteredSocketError(std::exception_ptr ep) noexcept override;
-
-	/* virtual methods from class HttpResponseHandler */
-	void OnHttpResponse(HttpStatus status, StringMap &&headers,
-			    UnusedIstreamPtr body) noexcept override;
-	void OnHttpError(std::exception_ptr ep) noexcept override;
 };
 
 static bool
@@ -329,10 +433,33 @@ LbRequest::GetStickySource() const noexcept
  */
 
 void
-LbRequest::OnHttpResponse(HttpStatus status, StringMap &&_headers,
-			  UnusedIstreamPtr response_body) noexcept
+LbRequest::OnAttemptResponse(Attempt &attempt,
+			     HttpStatus status, StringMap &&_headers,
+			     UnusedIstreamPtr response_body) noexcept
 {
-	failure->UnsetProtocol();
+	attempt.pending = false;
+	attempt.failure->UnsetProtocol();
+
+	/* the first response wins; cancel the other attempt */
+	hedge_timer.Cancel();
+	if (auto &other = GetOther(attempt); other.pending) {
+		other.pending = false;
+		other.cancel_ptr.Cancel();
+
+		if (&other == &hedge && !hedge.failure)
+			/* the hedge was still connecting and was never
+			   sent */
+			cluster.GetHedge()->Refund();
+	}
+
+	if (auto *h = cluster.GetHedge()) {
+		h->RecordLatency(GetEventLoop().SteadyNow() - start_time);
+
+		if (&attempt == &hedge) {
+			++h->stats.won;
+			SetForwardedTo(attempt);
+		}
+	}
 
 	if (auto &rl = *(LbRequestLogger *)request.logger; rl.generator != nullptr)
 		/* if there is a GENERATOR header, include it in the
@@ -369,13 +496,16 @@ LbRequest::OnHttpResponse(HttpStatus status, StringMap &&_headers,
 }
 
 void
-LbRequest::OnHttpError(std::exception_ptr ep) noexcept
+LbRequest::AttemptFailed(Attempt &attempt, std::exception_ptr ep) noexcept
 {
-	if (IsHttpClientServerFailure(ep))
-		failure->SetProtocol(GetEventLoop().SteadyNow(),
-				     std::chrono::seconds(20));
+	attempt.pending = false;
 
-	connection.logger(2, ep);
+	if (GetOther(attempt).pending)
+		/* the other attempt may still succeed */
+		return;
+
+	hedge_timer.Cancel();
+	body.Clear();
 
 	auto &_connection = connection;
 	auto &_request = request;
@@ -388,14 +518,24 @@ LbRequest::OnHttpError(std::exception_ptr ep) noexcept
 }
 
 void
-LbRequest::OnFilteredSocketReady(Lease &lease,
-				 FilteredSocket &socket,
-				 SocketAddress, const char *name,
-				 ReferencedFailureInfo &_failure) noexcept
+LbRequest::OnAttemptError(Attempt &attempt, std::exception_ptr ep) noexcept
 {
-	failure = _failure;
+	if (IsHttpClientServerFailure(ep))
+		attempt.failure->SetProtocol(GetEventLoop().SteadyNow(),
+					     std::chrono::seconds(20));
 
-	SetForwardedTo();
+	connection.logger(2, ep);
+
+	AttemptFailed(attempt, std::move(ep));
+}
+
+inline void
+LbRequest::ForwardRequestHeaders() noexcept
+{
+	if (headers_forwarded)
+		return;
+
+	headers_forwarded = true;
 
 	auto &headers = request.headers;
 	lb_forward_request_headers(pool, headers,
@@ -409,30 +549,58 @@ LbRequest::OnFilteredSocketReady(Lease &lease,
 	if (!cluster_config.http_host.empty())
 		headers.SecureSet(pool, host_header,
 				  cluster_config.http_host.c_str());
+}
+
+void
+LbRequest::OnAttemptReady(Attempt &attempt, Lease &lease,
+			  FilteredSocket &socket,
+			  SocketAddress, const char *name,
+			  ReferencedFailureInfo &_failure) noexcept
+{
+	if (&attempt == &hedge && primary.pending && primary.failure &&
+	    &*primary.failure == &_failure) {
+		/* the balancer has picked the same member again
+		   (because it is the only one left); a duplicate
+		   request would not help */
+		hedge.pending = false;
+		cluster.GetHedge()->Refund();
+		lease.ReleaseLease(PutAction::REUSE);
+		return;
+	}
+
+	attempt.failure = _failure;
+
+	if (&attempt == &primary) {
+		SetForwardedTo(attempt);
+
+		if (hedge_due)
+			/* the hedge delay has already elapsed; now that
+			   the primary's member is known, send the hedge
+			   to a different one */
+			hedge_timer.Schedule(Event::Duration{});
+	} else
+		++cluster.GetHedge()->stats.sent;
+
+	ForwardRequestHeaders();
 
 	http_client_request(pool, nullptr,
 			    socket, lease, name,
 			    request.method, request.uri,
-			    headers, {},
-			    std::move(body), true,
-			    *this, cancel_ptr);
+			    request.headers, {},
+			    /* only the primary attempt may have a
+			       request body */
+			    &attempt == &primary ? UnusedIstreamPtr{std::move(body)} : UnusedIstreamPtr{},
+			    true,
+			    attempt, attempt.cancel_ptr);
 }
 
 void
-LbRequest::OnFilteredSocketError(std::exception_ptr ep) noexcept
+LbRequest::OnAttemptConnectError(Attempt &attempt,
+				 std::exception_ptr ep) noexcept
 {
 	connection.logger(2, "Connect error: ", ep);
 
-	body.Clear();
-
-	auto &_connection = connection;
-	auto &_request = request;
-	const auto &fallback = cluster_config.fallback;
-
-	Destroy();
-
-	if (!send_fallback(_request, fallback))
-		_connection.SendError(_request, ep);
+	AttemptFailed(attempt, std::move(ep));
 }
 
 /*
@@ -477,11 +645,21 @@ LbRequest::MakeBindAddress() const noexcept
 		return SocketAddress::Null();
 }
 
-inline void
-LbRequest::Start() noexcept
+inline bool
+LbRequest::IsHedgeable() const noexcept
+{
+	return IsSafeMethod(request.method) && !body &&
+		GetStickySource().data() == nullptr;
+}
+
+void
+LbRequest::StartAttempt(Attempt &attempt,
+			const FailureInfo *exclude) noexcept
 {
 	const auto &rl = *(const LbRequestLogger *)request.logger;
 
+	attempt.pending = true;
+
 	cluster.ConnectHttp(pool, nullptr,
 			    MakeFairnessHash(),
 			    MakeBindAddress(),
@@ -489,7 +667,47 @@ LbRequest::Start() noexcept
 			    GetStickySource(),
 			    GetStickyHash(),
 			    LB_HTTP_CONNECT_TIMEOUT,
-			    *this, cancel_ptr);
+			    exclude,
+			    attempt, attempt.cancel_ptr);
+}
+
+void
+LbRequest::OnHedgeTimer() noexcept
+{
+	assert(primary.pending);
+	assert(!hedge.pending);
+
+	if (!primary.failure) {
+		/* the primary attempt is still connecting (which is
+		   limited by LB_HTTP_CONNECT_TIMEOUT); wait until we
+		   know which member it uses */
+		hedge_due = true;
+		return;
+	}
+
+	hedge_due = false;
+
+	if (!cluster.GetHedge()->Acquire())
+		/* hedge budget exhausted */
+		return;
+
+	StartAttempt(hedge, &*primary.failure);
+}
+
+inline void
+LbRequest::Start() noexcept
+{
+	if (auto *h = cluster.GetHedge()) {
+		h->OnRequest();
+
+		if (IsHedgeable())
+			if (const auto delay = h->GetDelay();
+			    delay > Event::Duration{})
+				hedge_timer.Schedule(delay);
+	}
+
+	start_time = GetEventLoop().SteadyNow();
+	StartAttempt(primary);
 }
 
 void
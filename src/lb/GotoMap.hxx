@@ -81,6 +81,14 @@ public:
 
 	LbCluster &GetInstance(const LbClusterConfig &config);
 
+	/**
+	 * Invoke the given function for each #LbCluster instance.
+	 */
+	void ForEachCluster(auto &&f) const {
+		for (const auto &[config, cluster] : clusters)
+			f(cluster);
+	}
+
 	void SetInstance(LbInstance &instance) noexcept;
 
 private:
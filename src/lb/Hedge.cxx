@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Hedge.hxx"
+#include "ClusterConfig.hxx"
+
+#include <algorithm> // for std::nth_element()
+
+LbHedge::LbHedge(const LbClusterConfig &config) noexcept
+	:fixed_delay(config.hedge_delay),
+	 budget(config.hedge_budget),
+	 /* allow a few hedges right from the start */
+	 credit(COST)
+{
+}
+
+Event::Duration
+LbHedge::GetDelay() const noexcept
+{
+	if (credit < COST)
+		/* budget exhausted; don't bother arming a timer */
+		return {};
+
+	if (fixed_delay > Event::Duration{})
+		return fixed_delay;
+
+	if (n_samples < MIN_SAMPLES)
+		return {};
+
+	return p95;
+}
+
+void
+LbHedge::RecordLatency(Event::Duration latency) noexcept
+{
+	if (fixed_delay > Event::Duration{})
+		/* the percentile is not used */
+		return;
+
+	samples[next_sample] = latency;
+	next_sample = (next_sample + 1) % samples.size();
+	if (n_samples < samples.size())
+		++n_samples;
+
+	if (n_samples >= MIN_SAMPLES && next_sample % UPDATE_INTERVAL == 0)
+		UpdatePercentile();
+}
+
+void
+LbHedge::UpdatePercentile() noexcept
+{
+	std::array<Event::Duration, std::tuple_size_v<decltype(samples)>> copy;
+	const auto end = std::copy_n(samples.begin(), n_samples, copy.begin());
+	const auto nth = copy.begin() + n_samples * 95 / 100;
+	std::nth_element(copy.begin(), nth, end);
+	p95 = *nth;
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "event/Chrono.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct LbClusterConfig;
+
+/**
+ * Per-cluster state for request hedging: decides when a duplicate
+ * request shall be sent to another member, enforces the hedge
+ * budget and counts hedges.
+ */
+class LbHedge final {
+	/**
+	 * The fixed delay; zero means use the observed 95th
+	 * percentile.
+	 */
+	const Event::Duration fixed_delay;
+
+	/**
+	 * The hedge budget (in percent of all requests).
+	 */
+	const unsigned budget;
+
+	/**
+	 * Each request earns #budget credits, and each hedge costs
+	 * #COST credits.
+	 */
+	unsigned credit = 0;
+
+	static constexpr unsigned COST = 100;
+	static constexpr unsigned MAX_CREDIT = 10 * COST;
+
+	/**
+	 * A ring buffer of recent response header latencies.
+	 */
+	std::array<Event::Duration, 256> samples;
+	std::size_t n_samples = 0, next_sample = 0;
+
+	/**
+	 * The 95th percentile of #samples, recalculated every
+	 * #UPDATE_INTERVAL samples.
+	 */
+	Event::Duration p95{};
+
+	/**
+	 * Don't hedge in "auto" mode until this many samples have
+	 * been collected.
+	 */
+	static constexpr std::size_t MIN_SAMPLES = 64;
+
+	static constexpr std::size_t UPDATE_INTERVAL = 32;
+
+public:
+	struct Stats {
+		/**
+		 * The number of duplicate requests sent.
+		 */
+		uint_least64_t sent = 0;
+
+		/**
+		 * The number of duplicate requests which responded
+		 * before the original one.
+		 */
+		uint_least64_t won = 0;
+	} stats;
+
+	explicit LbHedge(const LbClusterConfig &config) noexcept;
+
+	/**
+	 * Account for a new request; this earns hedge budget.
+	 */
+	void OnRequest() noexcept {
+		credit += budget;
+		if (credit > MAX_CREDIT)
+			credit = MAX_CREDIT;
+	}
+
+	/**
+	 * How long shall we wait for response headers before sending
+	 * a duplicate request?
+	 *
+	 * @return the delay or zero if hedging is not possible right
+	 * now
+	 */
+	[[gnu::pure]]
+	Event::Duration GetDelay() const noexcept;
+
+	/**
+	 * Attempt to spend hedge budget on one duplicate request.
+	 *
+	 * @return true if the duplicate request may be sent
+	 */
+	bool Acquire() noexcept {
+		if (credit < COST)
+			return false;
+
+		credit -= COST;
+		return true;
+	}
+
+	/**
+	 * Give back the budget spent by Acquire() because the
+	 * duplicate request was not sent after all.
+	 */
+	void Refund() noexcept {
+		credit += COST;
+		if (credit > MAX_CREDIT)
+			credit = MAX_CREDIT;
+	}
+
+	/**
+	 * Record the time it took to receive response headers,
+	 * measured from the start of the request (not from the start
+	 * of the attempt which won).
+	 */
+	void RecordLatency(Event::Duration latency) noexcept;
+
+private:
+	void UpdatePercentile() noexcept;
+};
@@ -62,6 +62,10 @@ struct LbInstance final : PInstance, Avahi::ErrorHandler {
 
 	const StateDirectories state_directories;
 
+	/**
+	 * Unlike bp, lb handles all HTTP requests in the main
+	 * thread, therefore plain (unsharded) counters suffice.
+	 */
 	HttpStats http_stats;
 
 	std::forward_list<LbControl> controls;
@@ -28,6 +28,9 @@ class LbListener final : FilteredSocketListenerHandler {
 
 	const LbListenerConfig &config;
 
+	/**
+	 * Plain counters, see LbInstance::http_stats.
+	 */
 	HttpStats http_stats;
 
 	AccessLogGlue *const access_logger;
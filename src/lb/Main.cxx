@@ -14,7 +14,7 @@
 #include "access_log/Glue.hxx"
 #include "ssl/Init.hxx"
 #include "pool/pool.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "memory/fb_pool.hxx"
 #include "net/InterfaceNameCache.hxx"
 #include "system/Isolate.hxx"
@@ -67,7 +67,7 @@ LbInstance::ShutdownCallback() noexcept
 #endif
 
 	deinit_signals(this);
-	thread_pool_stop();
+	worker_pool_stop();
 
 	compress_event.Cancel();
 
@@ -93,7 +93,7 @@ LbInstance::ShutdownCallback() noexcept
 	avahi_client.reset();
 #endif
 
-	thread_pool_join();
+	worker_pool_join();
 
 	monitors.clear();
 
@@ -244,7 +244,7 @@ try {
 	instance.DeinitAllListeners();
 	instance.DeinitAllControls();
 
-	thread_pool_deinit();
+	worker_pool_deinit();
 } catch (...) {
 	PrintException(std::current_exception());
 	return EXIT_FAILURE;
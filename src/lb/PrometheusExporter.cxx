@@ -6,11 +6,19 @@
 #include "PrometheusExporterConfig.hxx"
 #include "Instance.hxx"
 #include "Listener.hxx"
+#include "Cluster.hxx"
+#include "ClusterConfig.hxx"
+#include "Hedge.hxx"
 #include "Config.hxx"
 #include "prometheus/Stats.hxx"
 #include "prometheus/HttpStats.hxx"
+#include "prometheus/ThreadSocketFilterStats.hxx"
+#include "prometheus/WorkerPoolStats.hxx"
+#include "stats/WorkerPoolStats.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "thread/WorkerPool.hxx"
+#include "fs/ThreadSocketFilter.hxx"
 #include "pool/LeakDetector.hxx"
-#include "thread/Pool.hxx"
 #include "net/control/Protocol.hxx"
 #include "http/Address.hxx"
 #include "http/Headers.hxx"
@@ -33,6 +41,12 @@
 #include "event/PrometheusStats.hxx"
 #include "stopwatch.hxx"
 
+#ifdef ENABLE_CERTDB
+#include "prometheus/OcspStapleStats.hxx"
+#include "ssl/Cache.hxx"
+#include "stats/OcspStapleStats.hxx"
+#endif
+
 using std::string_view_literals::operator""sv;
 
 class LbPrometheusExporter::AppendRequest final
@@ -148,6 +162,22 @@ WriteStats(GrowingBuffer &buffer, const LbInstance &instance) noexcept
 
 	buffer.Write(ToPrometheusString(instance.event_loop.GetStats(), process));
 	Prometheus::Write(buffer, process, instance.GetStats());
+	Prometheus::Write(buffer, process, GetThreadSocketFilterStats());
+
+	if (const auto *worker_pool = worker_pool_get_existing()) {
+		WorkerPoolStats stats;
+		worker_pool->GetStats(stats);
+		Prometheus::Write(buffer, process, stats);
+	}
+
+#ifdef ENABLE_CERTDB
+	if (!instance.cert_dbs.empty()) {
+		OcspStapleStats stats;
+		for (const auto &[config, cache] : instance.cert_dbs)
+			cache.AddOcspStapleStats(stats);
+		Prometheus::Write(buffer, process, stats);
+	}
+#endif
 
 	buffer.Write(R"(
 # HELP beng_proxy_tarpit_connections Number of connections currently in TARPIT
@@ -165,6 +195,26 @@ beng_proxy_tarpit_connections{{process={:?},listener={:?}}} {}
 					  listener.GetConfig().name,
 					  *stats);
 	}
+
+	buffer.Write(R"(
+# HELP beng_proxy_lb_hedged_requests Number of duplicate requests sent to another cluster member
+# TYPE beng_proxy_lb_hedged_requests counter
+# HELP beng_proxy_lb_hedged_requests_won Number of duplicate requests which responded first
+# TYPE beng_proxy_lb_hedged_requests_won counter
+)");
+
+	instance.goto_map.ForEachCluster([&buffer, process](const LbCluster &cluster){
+		const auto *hedge = cluster.GetHedge();
+		if (hedge == nullptr)
+			return;
+
+		buffer.Fmt(R"(
+beng_proxy_lb_hedged_requests{{process={:?},cluster={:?}}} {}
+beng_proxy_lb_hedged_requests_won{{process={:?},cluster={:?}}} {}
+)",
+			   process, cluster.GetConfig().name, hedge->stats.sent,
+			   process, cluster.GetConfig().name, hedge->stats.won);
+	});
 }
 
 void
@@ -202,7 +252,7 @@ LbPrometheusExporter::HandleHttpRequest(IncomingHttpRequest &request,
 	if (instance != nullptr && http_client_accepts_encoding(request.headers, "gzip")) {
 		headers.Write("content-encoding", "gzip");
 		body = NewGzipIstream(pool,
-				      thread_pool_get_queue(instance->event_loop),
+				      worker_pool_get(instance->event_loop),
 				      std::move(body));
 	}
 
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Warmer.hxx"
+#include "fs/Stock.hxx"
+#include "stock/GetHandler.hxx"
+#include "stock/Item.hxx"
+#include "pool/pool.hxx"
+#include "pool/Holder.hxx"
+#include "util/Cancellable.hxx"
+#include "AllocatorPtr.hxx"
+#include "lease.hxx"
+#include "stopwatch.hxx"
+
+#include <cassert>
+#include <span>
+
+/**
+ * Must be shorter than the idle timeout of #FilteredSocketStock
+ * connections, so the connections get refreshed before they expire.
+ */
+static constexpr Event::Duration WARM_INTERVAL = std::chrono::seconds{30};
+
+static constexpr Event::Duration WARM_CONNECT_TIMEOUT = std::chrono::seconds{10};
+
+class LbClusterWarmer::Round final : PoolHolder {
+	LbClusterWarmer &warmer;
+
+	struct Slot final : StockGetHandler {
+		Round &round;
+
+		CancellablePointer cancel_ptr;
+
+		StockItem *item = nullptr;
+
+		explicit Slot(Round &_round) noexcept
+			:round(_round) {}
+
+		/* virtual methods from class StockGetHandler */
+		void OnStockItemReady(StockItem &_item) noexcept override {
+			cancel_ptr = nullptr;
+			item = &_item;
+			round.OnSlotDone();
+		}
+
+		void OnStockItemError(std::exception_ptr) noexcept override {
+			/* errors are handled by the next real request
+			   to this member; just skip it */
+			cancel_ptr = nullptr;
+			round.OnSlotDone();
+		}
+	};
+
+	std::span<Slot> slots;
+
+	/**
+	 * The number of slots which are still waiting for the stock.
+	 */
+	std::size_t n_pending;
+
+public:
+	Round(PoolPtr &&_pool, LbClusterWarmer &_warmer) noexcept
+		:PoolHolder(std::move(_pool)), warmer(_warmer) {}
+
+	void Start() noexcept;
+
+	/**
+	 * Abort this round and destroy this object.
+	 */
+	void Cancel() noexcept {
+		for (auto &i : slots)
+			if (i.cancel_ptr)
+				i.cancel_ptr.Cancel();
+
+		Finish();
+	}
+
+private:
+	void Destroy() noexcept {
+		this->~Round();
+	}
+
+	/**
+	 * Return all borrowed connections to the stock and destroy
+	 * this object.
+	 */
+	void Finish() noexcept {
+		for (auto &i : slots) {
+			if (i.item != nullptr)
+				i.item->Put(PutAction::REUSE);
+			i.~Slot();
+		}
+
+		warmer.OnRoundFinished();
+		Destroy();
+	}
+
+	void OnSlotDone() noexcept {
+		assert(n_pending > 0);
+
+		if (--n_pending == 0)
+			Finish();
+	}
+};
+
+void
+LbClusterWarmer::Round::Start() noexcept
+{
+	const std::size_t n = warmer.addresses.size() * warmer.min_idle;
+	Slot *p = PoolAlloc<Slot>(GetPool(), n);
+	for (std::size_t i = 0; i < n; ++i)
+		new(p + i) Slot(*this);
+	slots = {p, n};
+
+	/* the extra "pending" reference prevents Finish() from being
+	   called while we're still looping */
+	n_pending = n + 1;
+
+	auto slot = slots.begin();
+	for (const SocketAddress address : warmer.addresses) {
+		for (unsigned i = 0; i < warmer.min_idle; ++i, ++slot) {
+			/* all connections are borrowed at the same
+			   time, therefore the stock has to hand out
+			   distinct ones, creating new connections if
+			   there are not enough idle ones */
+			warmer.stock.Get(GetPool(), nullptr,
+					 {}, 0,
+					 false, SocketAddress::Null(),
+					 address,
+					 WARM_CONNECT_TIMEOUT,
+					 warmer.filter_params,
+					 *slot, slot->cancel_ptr);
+		}
+	}
+
+	OnSlotDone();
+}
+
+LbClusterWarmer::LbClusterWarmer(FilteredSocketStock &_stock,
+				 const SocketFilterParams *_filter_params,
+				 std::vector<SocketAddress> &&_addresses,
+				 unsigned _min_idle) noexcept
+	:stock(_stock), filter_params(_filter_params),
+	 addresses(std::move(_addresses)),
+	 min_idle(_min_idle),
+	 timer(stock.GetEventLoop(), BIND_THIS_METHOD(OnTimer))
+{
+	/* don't warm up during startup; wait until the event loop
+	   runs */
+	timer.Schedule(std::chrono::seconds{1});
+}
+
+LbClusterWarmer::~LbClusterWarmer() noexcept
+{
+	if (round != nullptr)
+		round->Cancel();
+}
+
+void
+LbClusterWarmer::OnTimer() noexcept
+{
+	timer.Schedule(WARM_INTERVAL);
+
+	if (round != nullptr || addresses.empty())
+		/* the previous round is still running */
+		return;
+
+	round = NewFromPool<Round>(pool_new_libc(nullptr, "LbClusterWarmer"),
+				   *this);
+	round->Start();
+}
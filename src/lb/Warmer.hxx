@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "event/CoarseTimerEvent.hxx"
+#include "net/SocketAddress.hxx"
+
+#include <vector>
+
+class FilteredSocketStock;
+class SocketFilterParams;
+
+/**
+ * Keeps a minimum number of idle (and, for TLS, pre-handshaked)
+ * connections to each static cluster member in the
+ * #FilteredSocketStock, so a burst of requests after an idle period
+ * does not have to wait for new connections.
+ *
+ * Every few seconds, it borrows the configured number of
+ * connections to each member at the same time (the stock creates
+ * the missing ones) and returns them all to the stock as soon as
+ * they are ready.
+ */
+class LbClusterWarmer final {
+	FilteredSocketStock &stock;
+
+	const SocketFilterParams *const filter_params;
+
+	const std::vector<SocketAddress> addresses;
+
+	const unsigned min_idle;
+
+	CoarseTimerEvent timer;
+
+	class Round;
+
+	/**
+	 * The round which is currently running (or nullptr).
+	 */
+	Round *round = nullptr;
+
+public:
+	/**
+	 * @param _addresses the member addresses; the caller must
+	 * keep the memory they point to alive
+	 */
+	LbClusterWarmer(FilteredSocketStock &_stock,
+			const SocketFilterParams *_filter_params,
+			std::vector<SocketAddress> &&_addresses,
+			unsigned _min_idle) noexcept;
+
+	~LbClusterWarmer() noexcept;
+
+	LbClusterWarmer(const LbClusterWarmer &) = delete;
+	LbClusterWarmer &operator=(const LbClusterWarmer &) = delete;
+
+private:
+	void OnTimer() noexcept;
+
+	void OnRoundFinished() noexcept {
+		round = nullptr;
+	}
+};
@@ -37,6 +37,8 @@
 
 #include <nghttp2/nghttp2.h>
 
+#include <array>
+
 #include <fmt/format.h>
 
 #include <assert.h>
@@ -277,6 +279,7 @@ private:
 	void SendResponse(HttpStatus status,
 			  HttpHeaders &&response_headers,
 			  UnusedIstreamPtr response_body) noexcept override;
+	void SendEarlyHints(std::string_view link) noexcept override;
 };
 
 [[gnu::pure]]
@@ -638,6 +641,27 @@ ServerConnection::Request::SendResponse(HttpStatus status,
 	DeferWrite();
 }
 
+void
+ServerConnection::Request::SendEarlyHints(std::string_view link) noexcept
+{
+	const std::array hdrs{
+		MakeNv(":status"sv, "103"sv),
+		MakeNv("link"sv, link),
+	};
+
+	/* a HEADERS frame without END_STREAM and with an 1xx status
+	   is an informational response (RFC 9113 8.1) */
+	if (nghttp2_submit_headers(connection.session.get(), NGHTTP2_FLAG_NONE,
+				   id, nullptr,
+				   hdrs.data(), hdrs.size(),
+				   nullptr) < 0)
+		/* early hints are optional; if the stream is in a
+		   state which does not allow this, just skip them */
+		return;
+
+	DeferWrite();
+}
+
 ServerConnection::ServerConnection(struct pool &_pool,
 				   UniquePoolPtr<FilteredSocket> _socket,
 				   SocketAddress _local_address,
@@ -166,7 +166,7 @@ Stock::Item::Start(SocketAddress bind_address,
 	ConnectFilteredSocket(GetEventLoop(),
 			      get_requests.front().stopwatch,
 			      false, bind_address, address, timeout,
-			      filter_params != nullptr ? filter_params->CreateFactory() : nullptr,
+			      filter_params != nullptr ? filter_params->CreateFactory(address) : nullptr,
 			      *this, connect_cancel);
 }
 
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Profiler.hxx"
+#include "io/Logger.hxx"
+
+#include <algorithm> // for std::clamp()
+#include <bit> // for std::bit_width()
+#include <map>
+#include <unordered_map>
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * Recalculate the adaptive size after this many samples.
+ */
+static constexpr uint_least32_t ADAPT_INTERVAL = 256;
+
+/**
+ * When the histogram has this many samples, all slots are halved so
+ * old samples fade out.
+ */
+static constexpr uint_least32_t MAX_SAMPLES = 16384;
+
+static constexpr std::size_t MIN_ADAPTIVE_SIZE = 256;
+static constexpr std::size_t MAX_ADAPTIVE_SIZE = 64 * 1024;
+
+/**
+ * Returns the upper bound of the given percentile (0..100) of the
+ * histogram, which is always a power of two.
+ */
+[[gnu::pure]]
+static std::size_t
+GetPercentile(const PoolClassProfile::Histogram &histogram,
+	      uint_least32_t n_samples, unsigned percentile) noexcept
+{
+	if (n_samples == 0)
+		return 0;
+
+	const uint_least64_t threshold =
+		(uint_least64_t{n_samples} * percentile + 99) / 100;
+
+	uint_least64_t sum = 0;
+	for (std::size_t i = 0; i < histogram.size(); ++i) {
+		sum += histogram[i];
+		if (sum >= threshold)
+			return std::size_t{1} << i;
+	}
+
+	return std::size_t{1} << (histogram.size() - 1);
+}
+
+inline void
+PoolClassProfile::UpdateAdaptiveSize() noexcept
+{
+	adaptive_size = std::clamp(GetPercentile(histogram, n_samples, 95),
+				   MIN_ADAPTIVE_SIZE, MAX_ADAPTIVE_SIZE);
+}
+
+void
+PoolClassProfile::Record(std::size_t used) noexcept
+{
+	++n_pools;
+	max_used = std::max(max_used, used);
+
+	++histogram[std::min<std::size_t>(std::bit_width(used),
+					  histogram.size() - 1)];
+	++n_samples;
+
+	if (n_samples % ADAPT_INTERVAL == 0)
+		UpdateAdaptiveSize();
+
+	if (n_samples >= MAX_SAMPLES) {
+		n_samples = 0;
+		for (auto &i : histogram) {
+			i /= 2;
+			n_samples += i;
+		}
+	}
+}
+
+namespace PoolProfilerDetail {
+
+PoolProfilerMode mode = PoolProfilerMode::DISABLED;
+
+/**
+ * Keyed by the name pointer (which is usually a string literal) to
+ * make lookups cheap; pool_profiler_get_stats() merges equal names.
+ * Like the pool library itself, this is not thread-safe.
+ */
+static std::unordered_map<const char *, PoolClassProfile> profiles;
+
+PoolClassProfile &
+Lookup(const char *name) noexcept
+{
+	return profiles.try_emplace(name, name).first->second;
+}
+
+} // namespace PoolProfilerDetail
+
+void
+pool_profiler_set_mode(PoolProfilerMode mode) noexcept
+{
+	PoolProfilerDetail::mode = mode;
+}
+
+PoolProfilerStats
+pool_profiler_get_stats() noexcept
+{
+	struct Merged {
+		uint_least64_t n_pools = 0, n_overflows = 0, n_big_allocations = 0;
+		std::size_t max_used = 0, adaptive_size = 0;
+		uint_least32_t n_samples = 0;
+		PoolClassProfile::Histogram histogram{};
+	};
+
+	std::map<std::string_view, Merged> merged;
+
+	for (const auto &[_, p] : PoolProfilerDetail::profiles) {
+		auto &m = merged[p.name];
+		m.n_pools += p.n_pools;
+		m.n_overflows += p.n_overflows;
+		m.n_big_allocations += p.n_big_allocations;
+		m.max_used = std::max(m.max_used, p.max_used);
+		m.adaptive_size = std::max(m.adaptive_size, p.adaptive_size);
+		m.n_samples += p.n_samples;
+		for (std::size_t i = 0; i < m.histogram.size(); ++i)
+			m.histogram[i] += p.histogram[i];
+	}
+
+	PoolProfilerStats stats;
+	stats.classes.reserve(merged.size());
+
+	for (const auto &[name, m] : merged)
+		stats.classes.push_back({
+			.name = std::string{name},
+			.n_pools = m.n_pools,
+			.n_overflows = m.n_overflows,
+			.n_big_allocations = m.n_big_allocations,
+			.max_used = m.max_used,
+			.p95_used = GetPercentile(m.histogram, m.n_samples, 95),
+			.adaptive_size = m.adaptive_size,
+		});
+
+	return stats;
+}
+
+void
+pool_profiler_dump() noexcept
+{
+	if (PoolProfilerDetail::mode == PoolProfilerMode::DISABLED) {
+		LogConcat(2, "pool", "pool profiler is disabled");
+		return;
+	}
+
+	for (const auto &i : pool_profiler_get_stats().classes)
+		LogFmt(2, "pool",
+		       "{:?}: pools={} overflows={} big={} max_used={} p95_used={} adaptive_size={}"sv,
+		       i.name, i.n_pools, i.n_overflows, i.n_big_allocations,
+		       i.max_used, i.p95_used, i.adaptive_size);
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Optional per-name statistics about linear pools, and adaptive
+ * initial area sizes derived from them.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class PoolProfilerMode : uint_least8_t {
+	DISABLED,
+
+	/**
+	 * Collect statistics, but do not change anything.
+	 */
+	PROFILE,
+
+	/**
+	 * Collect statistics and use them to choose the initial area
+	 * size of new pools created by pool_new_linear().
+	 */
+	ADAPTIVE,
+};
+
+/**
+ * Statistics about all pools with the same name (which are assumed
+ * to serve the same purpose).  Only used by pool.cxx.
+ */
+struct PoolClassProfile {
+	/**
+	 * Each sample is counted in the slot of its bit width, i.e.
+	 * slot n contains sizes in the range [2^(n-1), 2^n).
+	 */
+	using Histogram = std::array<uint_least32_t, 33>;
+
+	const char *name;
+
+	uint_least64_t n_pools = 0;
+
+	/**
+	 * How often did a pool need another area because the current
+	 * one was full?
+	 */
+	uint_least64_t n_overflows = 0;
+
+	/**
+	 * How many allocations were larger than the area size and
+	 * got their own area?
+	 */
+	uint_least64_t n_big_allocations = 0;
+
+	/**
+	 * The largest number of bytes ever used by one pool
+	 * (including alignment padding).
+	 */
+	std::size_t max_used = 0;
+
+	Histogram histogram{};
+
+	/**
+	 * The number of samples in #histogram.
+	 */
+	uint_least32_t n_samples = 0;
+
+	/**
+	 * The initial area size chosen in
+	 * #PoolProfilerMode::ADAPTIVE; 0 if not yet known.
+	 */
+	std::size_t adaptive_size = 0;
+
+	explicit PoolClassProfile(const char *_name) noexcept
+		:name(_name) {}
+
+	/**
+	 * A pool of this class is being destroyed.
+	 *
+	 * @param used the number of bytes used by this pool
+	 */
+	void Record(std::size_t used) noexcept;
+
+private:
+	void UpdateAdaptiveSize() noexcept;
+};
+
+namespace PoolProfilerDetail {
+
+extern PoolProfilerMode mode;
+
+PoolClassProfile &
+Lookup(const char *name) noexcept;
+
+} // namespace PoolProfilerDetail
+
+void
+pool_profiler_set_mode(PoolProfilerMode mode) noexcept;
+
+/**
+ * Returns the #PoolClassProfile for new pools with the given name,
+ * or nullptr if the profiler is disabled.
+ */
+static inline PoolClassProfile *
+pool_profiler_lookup(const char *name) noexcept
+{
+	if (PoolProfilerDetail::mode == PoolProfilerMode::DISABLED) [[likely]]
+		return nullptr;
+
+	return &PoolProfilerDetail::Lookup(name);
+}
+
+/**
+ * Returns the initial area size for a new pool of the given class.
+ */
+static inline std::size_t
+pool_profiler_area_size(const PoolClassProfile *profile,
+			std::size_t initial_size) noexcept
+{
+	if (profile == nullptr || profile->adaptive_size == 0 ||
+	    PoolProfilerDetail::mode != PoolProfilerMode::ADAPTIVE)
+		return initial_size;
+
+	return profile->adaptive_size;
+}
+
+struct PoolProfilerStats {
+	struct Class {
+		std::string name;
+
+		uint_least64_t n_pools, n_overflows, n_big_allocations;
+
+		std::size_t max_used;
+
+		/**
+		 * The (upper bound of the) 95th percentile of the
+		 * number of bytes used by one pool.
+		 */
+		std::size_t p95_used;
+
+		/**
+		 * The current adaptive area size (0 if not
+		 * applicable).
+		 */
+		std::size_t adaptive_size;
+	};
+
+	std::vector<Class> classes;
+};
+
+/**
+ * Obtain a snapshot of all profiles, sorted by name.  Pools with
+ * the same name (but different string pointers) are merged.
+ */
+PoolProfilerStats
+pool_profiler_get_stats() noexcept;
+
+/**
+ * Write all profiles to the log.
+ */
+void
+pool_profiler_dump() noexcept;
@@ -5,6 +5,7 @@
 #include "pool.hxx"
 #include "Ptr.hxx"
 #include "LeakDetector.hxx"
+#include "Profiler.hxx"
 #include "memory/Checker.hxx"
 #include "memory/SlicePool.hxx"
 #include "memory/AllocatorStats.hxx"
@@ -181,6 +182,12 @@ struct pool final
 
 	SlicePool *slice_pool;
 
+	/**
+	 * Statistics about all pools with this name; nullptr if the
+	 * pool profiler is disabled or if this is not a linear pool.
+	 */
+	PoolClassProfile *profile = nullptr;
+
 	/**
 	 * The area size passed to pool_new_linear().
 	 */
@@ -448,7 +455,8 @@ pool_new_linear(struct pool *parent, const char *name,
 		return pool_new_libc(parent, name);
 
 	struct pool *pool = pool_new(parent, pool::Type::LINEAR, name);
-	pool->area_size = initial_size;
+	pool->profile = pool_profiler_lookup(name);
+	pool->area_size = pool_profiler_area_size(pool->profile, initial_size);
 	pool->slice_pool = nullptr;
 	pool->current_area.linear = nullptr;
 
@@ -470,6 +478,7 @@ pool_new_slice(struct pool &parent, const char *name,
 		return pool_new_libc(&parent, name);
 
 	struct pool *pool = pool_new(&parent, pool::Type::LINEAR, name);
+	pool->profile = pool_profiler_lookup(name);
 	pool->area_size = slice_pool.GetSliceSize() - LINEAR_POOL_AREA_HEADER;
 	pool->slice_pool = &slice_pool;
 	pool->current_area.linear = nullptr;
@@ -514,6 +523,26 @@ pool_check_leaks(const struct pool &pool) noexcept
 #endif
 }
 
+/**
+ * Returns the number of bytes used in all areas of a linear pool,
+ * including alignment padding and allocations which have already
+ * been freed.
+ */
+[[gnu::pure]]
+static size_t
+pool_linear_used_size(const struct pool &pool) noexcept
+{
+	assert(pool.type == pool::Type::LINEAR);
+
+	size_t size = 0;
+
+	for (const struct linear_pool_area *area = pool.current_area.linear;
+	     area != nullptr; area = area->prev)
+		size += area->used;
+
+	return size;
+}
+
 static void
 pool_destroy(struct pool *pool, struct pool *reparent_to) noexcept
 {
@@ -569,6 +598,9 @@ pool_destroy(struct pool *pool, struct pool *reparent_to) noexcept
 	pool->unrefs.clear();
 #endif
 
+	if (pool->profile != nullptr) [[unlikely]]
+		pool->profile->Record(pool_linear_used_size(*pool));
+
 	pool_clear(*pool);
 
 	recycler.pools.Put(pool);
@@ -865,6 +897,9 @@ p_malloc_linear(struct pool *pool, const size_t original_size
 #endif
 #endif // NDEBUG
 
+		if (pool->profile != nullptr)
+			++pool->profile->n_big_allocations;
+
 		if (area == nullptr) {
 			/* this is the first allocation, create the initial
 			   area */
@@ -877,6 +912,9 @@ p_malloc_linear(struct pool *pool, const size_t original_size
 		}
 	} else if (area == nullptr || area->used + size > area->size) [[unlikely]] {
 		if (area != nullptr) {
+			if (pool->profile != nullptr)
+				++pool->profile->n_overflows;
+
 #ifndef NDEBUG
 			logger.Fmt(5, "growing linear pool '{}'"sv, pool->name);
 #ifdef DEBUG_POOL_GROW
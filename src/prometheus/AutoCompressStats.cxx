@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "AutoCompressStats.hxx"
+#include "stats/AutoCompressStats.hxx"
+#include "memory/GrowingBuffer.hxx"
+#include "time/Cast.hxx"
+
+using std::string_view_literals::operator""sv;
+
+namespace Prometheus {
+
+void
+Write(GrowingBuffer &buffer, std::string_view process,
+      const AutoCompressStats &stats) noexcept
+{
+	buffer.Fmt(R"(
+# HELP beng_proxy_auto_compress Number of auto-compressed responses by the chosen level
+# TYPE beng_proxy_auto_compress counter
+
+# HELP beng_proxy_auto_compress_queue_latency Thread pool queue latency measured by the adaptive auto-compression policy
+# TYPE beng_proxy_auto_compress_queue_latency gauge
+
+# HELP beng_proxy_auto_compress_cpu_pressure CPU pressure (percent) seen by the adaptive auto-compression policy
+# TYPE beng_proxy_auto_compress_cpu_pressure gauge
+
+beng_proxy_auto_compress{{process={:?},level="none"}} {}
+beng_proxy_auto_compress{{process={:?},level="fast"}} {}
+beng_proxy_auto_compress{{process={:?},level="medium"}} {}
+beng_proxy_auto_compress{{process={:?},level="best"}} {}
+beng_proxy_auto_compress_queue_latency{{process={:?}}} {:e}
+beng_proxy_auto_compress_cpu_pressure{{process={:?}}} {:e}
+)"sv,
+		   process, stats.n_by_level[static_cast<std::size_t>(AutoCompressLevel::NONE)],
+		   process, stats.n_by_level[static_cast<std::size_t>(AutoCompressLevel::FAST)],
+		   process, stats.n_by_level[static_cast<std::size_t>(AutoCompressLevel::MEDIUM)],
+		   process, stats.n_by_level[static_cast<std::size_t>(AutoCompressLevel::BEST)],
+		   process, ToFloatSeconds(stats.queue_latency),
+		   process, static_cast<double>(stats.cpu_pressure));
+}
+
+} // namespace Prometheus
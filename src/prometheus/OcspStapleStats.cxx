@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "OcspStapleStats.hxx"
+#include "stats/OcspStapleStats.hxx"
+#include "memory/GrowingBuffer.hxx"
+
+using std::string_view_literals::operator""sv;
+
+namespace Prometheus {
+
+void
+Write(GrowingBuffer &buffer, std::string_view process,
+      const OcspStapleStats &stats) noexcept
+{
+	buffer.Fmt(R"(
+# HELP beng_proxy_ocsp_staples Number of TLS handshakes which requested an OCSP response by whether one was stapled
+# TYPE beng_proxy_ocsp_staples counter
+
+beng_proxy_ocsp_staples{{process={:?},result="hit"}} {}
+beng_proxy_ocsp_staples{{process={:?},result="miss"}} {}
+)"sv,
+		   process, stats.hits,
+		   process, stats.misses);
+}
+
+} // namespace Prometheus
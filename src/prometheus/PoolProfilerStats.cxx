@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PoolProfilerStats.hxx"
+#include "pool/Profiler.hxx"
+#include "memory/GrowingBuffer.hxx"
+
+using std::string_view_literals::operator""sv;
+
+namespace Prometheus {
+
+void
+Write(GrowingBuffer &buffer, std::string_view process,
+      const PoolProfilerStats &stats) noexcept
+{
+	buffer.Write(R"(
+# HELP beng_proxy_pools Number of destroyed memory pools
+# TYPE beng_proxy_pools counter
+
+# HELP beng_proxy_pool_overflows Number of times a memory pool needed another area because the current one was full
+# TYPE beng_proxy_pool_overflows counter
+
+# HELP beng_proxy_pool_big_allocations Number of allocations which were larger than the area size of a memory pool
+# TYPE beng_proxy_pool_big_allocations counter
+
+# HELP beng_proxy_pool_max_used Largest number of bytes used by one memory pool
+# TYPE beng_proxy_pool_max_used gauge
+
+# HELP beng_proxy_pool_p95_used 95th percentile (rounded up to a power of two) of the number of bytes used by one memory pool
+# TYPE beng_proxy_pool_p95_used gauge
+
+# HELP beng_proxy_pool_adaptive_size Initial area size chosen by the adaptive pool profiler
+# TYPE beng_proxy_pool_adaptive_size gauge
+)"sv);
+
+	for (const auto &i : stats.classes)
+		buffer.Fmt(R"(
+beng_proxy_pools{{process={:?},pool={:?}}} {}
+beng_proxy_pool_overflows{{process={:?},pool={:?}}} {}
+beng_proxy_pool_big_allocations{{process={:?},pool={:?}}} {}
+beng_proxy_pool_max_used{{process={:?},pool={:?}}} {}
+beng_proxy_pool_p95_used{{process={:?},pool={:?}}} {}
+beng_proxy_pool_adaptive_size{{process={:?},pool={:?}}} {}
+)"sv,
+			   process, i.name, i.n_pools,
+			   process, i.name, i.n_overflows,
+			   process, i.name, i.n_big_allocations,
+			   process, i.name, i.max_used,
+			   process, i.name, i.p95_used,
+			   process, i.name, i.adaptive_size);
+}
+
+} // namespace Prometheus
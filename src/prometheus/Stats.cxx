@@ -35,11 +35,15 @@ beng_proxy_cache_skips{{process={:?},type={:?}}} {}
 beng_proxy_cache_misses{{process={:?},type={:?}}} {}
 beng_proxy_cache_stores{{process={:?},type={:?}}} {}
 beng_proxy_cache_hits{{process={:?},type={:?}}} {}
+beng_proxy_cache_evictions{{process={:?},type={:?}}} {}
+beng_proxy_cache_rejections{{process={:?},type={:?}}} {}
 )",
 		   process, type, stats.skips,
 		   process, type, stats.misses,
 		   process, type, stats.stores,
-		   process, type, stats.hits);
+		   process, type, stats.hits,
+		   process, type, stats.evictions,
+		   process, type, stats.rejections);
 }
 
 void
@@ -69,6 +73,21 @@ Write(GrowingBuffer &buffer, std::string_view process,
 # HELP beng_proxy_cache_hits Number of cache hits
 # TYPE beng_proxy_cache_hits counter
 
+# HELP beng_proxy_cache_evictions Number of cache items removed to make room for new items
+# TYPE beng_proxy_cache_evictions counter
+
+# HELP beng_proxy_cache_rejections Number of new cache items rejected by the admission policy
+# TYPE beng_proxy_cache_rejections counter
+
+# HELP beng_proxy_cache_recompressed Number of cache items recompressed with the maximum quality
+# TYPE beng_proxy_cache_recompressed counter
+
+# HELP beng_proxy_http_cache_key_normalized Number of HTTP cache keys modified by a normalization rule
+# TYPE beng_proxy_http_cache_key_normalized counter
+
+# HELP beng_proxy_http_cache_key_normalized_hits Number of HTTP cache hits with a key modified by a normalization rule
+# TYPE beng_proxy_http_cache_key_normalized_hits counter
+
 # HELP beng_proxy_buffer_size Size of buffers in bytes
 # TYPE beng_proxy_buffer_size gauge
 
@@ -82,8 +101,23 @@ beng_proxy_sessions{{process={:?}}} {}
 
 	Write(buffer, process, "translation"sv, stats.translation_cache);
 	Write(buffer, process, "http"sv, stats.http_cache);
+
+	for (std::size_t i = 0; i < N_HTTP_CACHE_KEY_RULES; ++i) {
+		const auto &r = stats.http_cache_key.rules[i];
+		const auto rule = http_cache_key_rule_names[i];
+		buffer.Fmt(R"(beng_proxy_http_cache_key_normalized{{process={:?},rule={:?}}} {}
+beng_proxy_http_cache_key_normalized_hits{{process={:?},rule={:?}}} {}
+)",
+			   process, rule, r.normalized,
+			   process, rule, r.hits);
+	}
+
 	Write(buffer, process, "filter"sv, stats.filter_cache);
 	Write(buffer, process, "encoding"sv, stats.encoding_cache);
+	buffer.Fmt("beng_proxy_cache_recompressed{{process={:?},type=\"encoding\"}} {}\n",
+		   process, stats.encoding_cache_recompressed);
+	Write(buffer, process, "static_file"sv, stats.static_file_cache);
+	Write(buffer, process, "widget_fragment"sv, stats.widget_fragment_cache);
 	Write(buffer, "beng_proxy_buffer_size"sv, process, "io"sv, stats.io_buffers);
 }
 
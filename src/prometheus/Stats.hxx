@@ -5,6 +5,7 @@
 #pragma once
 
 #include "stats/CacheStats.hxx"
+#include "stats/HttpCacheKeyStats.hxx"
 #include "memory/AllocatorStats.hxx"
 
 #include <cstdint>
@@ -45,6 +46,19 @@ struct Stats {
 
 	CacheStats translation_cache, http_cache, filter_cache, encoding_cache;
 
+	/**
+	 * The effect of the HTTP cache key normalization rules.
+	 */
+	HttpCacheKeyStats http_cache_key;
+
+	/**
+	 * Number of #EncodingCache items which were recompressed
+	 * with the maximum quality in the background.
+	 */
+	uint_least64_t encoding_cache_recompressed;
+
+	CacheStats static_file_cache, widget_fragment_cache;
+
 	AllocatorStats io_buffers;
 };
 
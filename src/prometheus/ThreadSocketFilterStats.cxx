@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ThreadSocketFilterStats.hxx"
+#include "stats/ThreadSocketFilterStats.hxx"
+#include "memory/GrowingBuffer.hxx"
+
+using std::string_view_literals::operator""sv;
+
+namespace Prometheus {
+
+void
+Write(GrowingBuffer &buffer, std::string_view process,
+      const ThreadSocketFilterStats &stats) noexcept
+{
+	buffer.Fmt(R"(
+# HELP beng_proxy_socket_filter_runs Number of socket filter (e.g. TLS) runs by where they were executed
+# TYPE beng_proxy_socket_filter_runs counter
+
+beng_proxy_socket_filter_runs{{process={:?},mode="inline"}} {}
+beng_proxy_socket_filter_runs{{process={:?},mode="offloaded"}} {}
+)"sv,
+		   process, stats.n_inline_runs,
+		   process, stats.n_offloaded_runs);
+}
+
+} // namespace Prometheus
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <string_view>
+
+class GrowingBuffer;
+struct ThreadSocketFilterStats;
+
+namespace Prometheus {
+
+void
+Write(GrowingBuffer &buffer, std::string_view process,
+      const ThreadSocketFilterStats &stats) noexcept;
+
+} // namespace Prometheus
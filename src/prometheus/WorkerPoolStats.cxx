@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "WorkerPoolStats.hxx"
+#include "stats/WorkerPoolStats.hxx"
+#include "memory/GrowingBuffer.hxx"
+#include "time/Cast.hxx"
+
+using std::string_view_literals::operator""sv;
+
+namespace Prometheus {
+
+void
+Write(GrowingBuffer &buffer, std::string_view process,
+      const WorkerPoolStats &stats) noexcept
+{
+	buffer.Write(R"(
+# HELP beng_proxy_worker_jobs Number of jobs run by each worker thread
+# TYPE beng_proxy_worker_jobs counter
+
+# HELP beng_proxy_worker_stolen_jobs Number of jobs a worker thread has taken from another worker's queue
+# TYPE beng_proxy_worker_stolen_jobs counter
+
+# HELP beng_proxy_worker_busy_duration Time each worker thread has spent running jobs
+# TYPE beng_proxy_worker_busy_duration counter
+
+# HELP beng_proxy_worker_queue_wait_duration Time the jobs run by each worker thread have waited in a queue
+# TYPE beng_proxy_worker_queue_wait_duration counter
+
+# HELP beng_proxy_worker_queue_length Number of jobs waiting in each worker's queue
+# TYPE beng_proxy_worker_queue_length gauge
+)"sv);
+
+	for (std::size_t i = 0; i < stats.workers.size(); ++i) {
+		const auto &w = stats.workers[i];
+
+		buffer.Fmt(R"(
+beng_proxy_worker_jobs{{process={:?},worker="{}"}} {}
+beng_proxy_worker_stolen_jobs{{process={:?},worker="{}"}} {}
+beng_proxy_worker_busy_duration{{process={:?},worker="{}"}} {:e}
+beng_proxy_worker_queue_wait_duration{{process={:?},worker="{}"}} {:e}
+beng_proxy_worker_queue_length{{process={:?},worker="{}"}} {}
+)"sv,
+			   process, i, w.n_jobs,
+			   process, i, w.n_stolen,
+			   process, i, ToFloatSeconds(w.busy),
+			   process, i, ToFloatSeconds(w.queue_wait),
+			   process, i, w.n_waiting);
+	}
+}
+
+} // namespace Prometheus
@@ -3,7 +3,9 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "Cache.hxx"
+#include "CertLookup.hxx"
 #include "CompletionHandler.hxx"
+#include "PrewarmList.hxx"
 #include "lib/openssl/Name.hxx"
 #include "lib/openssl/AltName.hxx"
 #include "lib/openssl/Error.hxx"
@@ -18,9 +20,16 @@
 #include <openssl/ssl.h>
 
 #include <set>
+#include <vector>
 
 using std::string_view_literals::operator""sv;
 
+/**
+ * After adding items to the cache, wait this long before publishing
+ * a new snapshot, to collect more additions (e.g. while prewarming).
+ */
+static constexpr Event::Duration SNAPSHOT_DELAY = std::chrono::milliseconds{500};
+
 struct CertCache::Request final : IntrusiveListHook<>, Cancellable {
 	CertCache &cache;
 
@@ -171,12 +180,11 @@ CertCache::Query::Run()
 		   OnCompletion() */
 		co_return;
 
-	cert_key = cache.Add(std::move(cert_key),
-			     _special);
+	const auto item = cache.Add(std::move(cert_key), _special);
 
-	LockClearAndDispose(cache.mutex, requests, [this, &cert_key](Request *request){
+	LockClearAndDispose(cache.mutex, requests, [this, &item](Request *request){
 		try {
-			cache.Apply(request->ssl, cert_key);
+			cache.Apply(request->ssl, *item);
 			cache.state_idx.Set(request->ssl, State::COMPLETE);
 		} catch (...) {
 			cache.logger(1, std::current_exception());
@@ -227,7 +235,9 @@ CertCache::CertCache(EventLoop &event_loop,
 	:logger("CertCache"), config(_config),
 	 query_added_notify(event_loop, BIND_THIS_METHOD(StartQuery)),
 	 db(event_loop, Pg::Config{config}, *this),
-	 name_cache(event_loop, _config, *this)
+	 name_cache(event_loop, _config, *this),
+	 publish_snapshot_event(event_loop, BIND_THIS_METHOD(PublishSnapshot)),
+	 publish_snapshot_timer(event_loop, BIND_THIS_METHOD(PublishSnapshot))
 {
 }
 
@@ -238,13 +248,175 @@ CertCache::Expire() noexcept
 {
 	const auto now = GetEventLoop().SteadyNow();
 
-	const std::scoped_lock lock{mutex};
-	for (auto i = map.begin(), end = map.end(); i != end;) {
-		if (now >= i->second.expires) {
-			logger.Fmt(5, "flushed certificate {:?}", i->first);
-			i = map.erase(i);
-		} else
-			++i;
+	bool modified = false;
+
+	{
+		const std::scoped_lock lock{mutex};
+		for (auto i = map.begin(), end = map.end(); i != end;) {
+			if (i->second->IsExpired(now)) {
+				logger.Fmt(5, "flushed certificate {:?}", i->first);
+				i = map.erase(i);
+				modified = true;
+			} else
+				++i;
+		}
+	}
+
+	if (modified)
+		InvalidateSnapshot();
+
+	RefreshOcspStaples();
+	SavePrewarmList();
+}
+
+void
+CertCache::LoadOcspStaple(Item &item) noexcept
+{
+	if (config.ocsp_staple_directory.empty())
+		return;
+
+	const char *const directory = config.ocsp_staple_directory.c_str();
+
+	/* if the file has not changed since the last attempt, it
+	   would be rejected again (and the same error would be
+	   logged again) or it would yield the same (old) staple */
+	const auto version = GetOcspStapleVersion(directory, *item.cert);
+	if (version == item.ocsp_version.exchange(version, std::memory_order_relaxed))
+		return;
+
+	try {
+		if (auto staple = ::LoadOcspStaple(directory, *item.cert,
+						   GetEventLoop().SteadyNow()))
+			item.ocsp_staple.store(std::move(staple),
+					       std::memory_order_relaxed);
+	} catch (...) {
+		logger(2, std::current_exception());
+	}
+}
+
+void
+CertCache::RefreshOcspStaples() noexcept
+{
+	if (config.ocsp_staple_directory.empty())
+		return;
+
+	const auto now = GetEventLoop().SteadyNow();
+
+	/* collect the certificates whose staple is missing or
+	   getting old; shadow items share the #Item with their
+	   primary item, so each certificate is loaded only once */
+	std::set<std::shared_ptr<Item>> items;
+
+	{
+		const std::scoped_lock lock{mutex};
+		for (const auto &[name, item] : map)
+			if (item->NeedsOcspRefresh(now))
+				items.emplace(item);
+	}
+
+	/* load the files without holding the mutex, because worker
+	   threads may be waiting for it */
+	for (const auto &item : items)
+		LoadOcspStaple(*item);
+}
+
+void
+CertCache::ScheduleSnapshot() noexcept
+{
+	if (!publish_snapshot_event.IsPending() &&
+	    !publish_snapshot_timer.IsPending())
+		publish_snapshot_timer.Schedule(SNAPSHOT_DELAY);
+}
+
+void
+CertCache::PublishSnapshot() noexcept
+{
+	publish_snapshot_event.Cancel();
+	publish_snapshot_timer.Cancel();
+
+	std::shared_ptr<const Map> new_snapshot;
+
+	{
+		const std::scoped_lock lock{mutex};
+		if (!map.empty())
+			new_snapshot = std::make_shared<const Map>(map);
+	}
+
+	/* the old snapshot is freed as soon as the last worker
+	   thread has finished using it */
+	snapshot.store(std::move(new_snapshot), std::memory_order_release);
+}
+
+void
+CertCache::LoadPrewarmList() noexcept
+{
+	if (config.prewarm_file.empty())
+		return;
+
+	try {
+		auto names = ::LoadPrewarmList(config.prewarm_file.c_str(),
+					       config.prewarm_count);
+		if (names.empty())
+			return;
+
+		logger.Fmt(4, "prewarming {} certificates", names.size());
+
+		prewarm_queue.insert(prewarm_queue.end(),
+				     std::make_move_iterator(names.begin()),
+				     std::make_move_iterator(names.end()));
+	} catch (...) {
+		logger(1, std::current_exception());
+	}
+}
+
+void
+CertCache::SavePrewarmList() noexcept
+{
+	if (config.prewarm_file.empty())
+		return;
+
+	/* collect the primary items (shadow items share the #Item
+	   object) */
+	std::set<std::shared_ptr<Item>> items;
+
+	{
+		const std::scoped_lock lock{mutex};
+		for (const auto &[name, item] : map)
+			if (item->special.empty())
+				items.emplace(item);
+	}
+
+	if (items.empty())
+		/* don't overwrite the list with an empty one, e.g. if
+		   the database was not available */
+		return;
+
+	/* the expiry is postponed each time a certificate is used,
+	   so it orders the items by their last use */
+	std::vector<AllocatedString> common_names;
+	common_names.reserve(items.size());
+
+	std::vector<PrewarmCandidate> candidates;
+	candidates.reserve(items.size());
+
+	for (const auto &item : items) {
+		auto name = GetCommonName(*item->cert);
+		if (name == nullptr)
+			continue;
+
+		candidates.push_back({
+			item->expires.load(std::memory_order_relaxed),
+			name.c_str(),
+		});
+		common_names.emplace_back(std::move(name));
+	}
+
+	const auto names = SelectPrewarmNames(candidates, config.prewarm_count);
+
+	try {
+		::SavePrewarmList(config.prewarm_file.c_str(), names);
+	} catch (...) {
+		logger(2, std::current_exception());
 	}
 }
 
@@ -257,6 +429,8 @@ CertCache::LoadCaCertificate(const char *path)
 void
 CertCache::Connect() noexcept
 {
+	LoadPrewarmList();
+
 	db.Connect();
 	name_cache.Connect();
 }
@@ -274,9 +448,12 @@ CertCache::Disconnect() noexcept
 
 	db.Disconnect();
 	query_added_notify.Disable();
+
+	prewarm_queue.clear();
+	SavePrewarmList();
 }
 
-inline UniqueCertKey
+inline std::shared_ptr<CertCache::Item>
 CertCache::Add(UniqueCertKey &&ck, const char *special)
 {
 	assert(ck);
@@ -287,45 +464,29 @@ CertCache::Add(UniqueCertKey &&ck, const char *special)
 	if (name == nullptr)
 		throw std::runtime_error("Certificate without common name");
 
-	const std::scoped_lock lock{mutex};
-	auto i = map.emplace(std::piecewise_construct,
-			     std::forward_as_tuple(name.c_str()),
-			     std::forward_as_tuple(std::move(ck),
-						   GetEventLoop().SteadyNow()));
-
-	if (special != nullptr)
-		i->second.special = special;
+	auto item = std::make_shared<Item>(std::move(ck),
+					   special != nullptr ? special : "",
+					   GetEventLoop().SteadyNow());
+	LoadOcspStaple(*item);
 
 	/* create shadow items for all altNames */
 	std::set<std::string, std::less<>> alt_names;
-	for (auto &a : GetSubjectAltNames(*i->second.cert))
+	for (auto &a : GetSubjectAltNames(*item->cert))
 		alt_names.emplace(std::move(a));
 
-	alt_names.erase(i->first);
-
-	for (auto &a : alt_names)
-		map.emplace(std::move(a), i->second);
+	alt_names.erase(name.c_str());
 
-	return UpRef(i->second);
-}
+	{
+		const std::scoped_lock lock{mutex};
+		map.emplace(name.c_str(), item);
 
-inline std::optional<UniqueCertKey>
-CertCache::GetNoWildCardCached(const char *host, const char *_special) noexcept
-{
-	const std::string_view special{
-		_special != nullptr
-		? std::string_view{_special}
-		: std::string_view{}
-	};
-
-	for (auto [i, end] = map.equal_range(host); i != end; ++i) {
-		if (i->second.special == special) {
-			i->second.expires = GetEventLoop().SteadyNow() + std::chrono::hours(24);
-			return UpRef(i->second);
-		}
+		for (auto &a : alt_names)
+			map.emplace(std::move(a), item);
 	}
 
-	return std::nullopt;
+	ScheduleSnapshot();
+
+	return item;
 }
 
 void
@@ -347,13 +508,42 @@ CertCache::StartQuery() noexcept
 			/* found a candidate - start it */
 			current_query = i;
 			current_query->second.Start();
-			break;
+			return;
 		}
 
 		/* this query was scheduled, but meanwhile all
 		   requests were cancelled, so don't bother */
 		queries.erase(i);
 	}
+
+	/* no handshake is waiting for the database - use the idle
+	   time to fill the cache */
+	StartPrewarmQuery();
+}
+
+void
+CertCache::StartPrewarmQuery() noexcept
+{
+	assert(current_query == queries.end());
+	assert(queries.empty());
+
+	while (!prewarm_queue.empty()) {
+		const std::string name = std::move(prewarm_queue.front());
+		prewarm_queue.pop_front();
+
+		if (FindCertItem(map, name, {}) != nullptr)
+			/* already cached */
+			continue;
+
+		/* this is a query without requests; if a handshake
+		   needs the same certificate meanwhile,
+		   ScheduleQuery() will attach its request to this
+		   query */
+		current_query = queries.try_emplace(name, *this,
+						    name, std::string_view{}).first;
+		current_query->second.Start();
+		break;
+	}
 }
 
 void
@@ -406,16 +596,31 @@ CertCache::Apply(SSL &ssl, X509 &cert, EVP_PKEY &key)
 }
 
 inline void
-CertCache::Apply(SSL &ssl, const UniqueCertKey &cert_key)
+CertCache::ApplyOcspStaple(SSL &ssl, const Item &item) noexcept
+{
+	if (config.ocsp_staple_directory.empty() || !WantsOcspStaple(ssl))
+		return;
+
+	const auto staple = item.ocsp_staple.load(std::memory_order_relaxed);
+	if (staple && staple->IsValid(std::chrono::steady_clock::now())) {
+		::ApplyOcspStaple(ssl, *staple);
+		n_ocsp_staple_hits.fetch_add(1, std::memory_order_relaxed);
+	} else
+		n_ocsp_staple_misses.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void
+CertCache::Apply(SSL &ssl, const Item &item)
 {
-	Apply(ssl, *cert_key.cert, *cert_key.key);
+	Apply(ssl, *item.cert, *item.key);
+	ApplyOcspStaple(ssl, item);
 }
 
 inline LookupCertResult
-CertCache::ApplyAndSetState(SSL &ssl, const UniqueCertKey &cert_key) noexcept
+CertCache::ApplyAndSetState(SSL &ssl, const Item &item) noexcept
 {
 	try {
-		Apply(ssl, cert_key);
+		Apply(ssl, item);
 		state_idx.Set(ssl, State::COMPLETE);
 		return LookupCertResult::COMPLETE;
 	} catch (...) {
@@ -449,20 +654,32 @@ CertCache::Apply(SSL &ssl, const char *host,
 		return LookupCertResult::ERROR;
 	}
 
+	const std::string_view special_sv =
+		special != nullptr ? std::string_view{special} : std::string_view{};
+	const auto wildcard = MakeCommonNameWildcard(host);
+	const auto now = std::chrono::steady_clock::now();
+
+	/* fast path: look up the certificate in the snapshot without
+	   locking the mutex */
+	if (const auto s = snapshot.load(std::memory_order_acquire)) {
+		if (auto *item = FindCertItem(*s, host, wildcard, special_sv)) {
+			item->Touch(now);
+			return ApplyAndSetState(ssl, *item);
+		}
+	}
+
 	/* this mutex not only protects #map and #queries, but also
 	   ensures that completed queries aren't finalized between
-	   GetNoWildCardCached() and ScheduleQuery(), so this request
-	   won't be added to a query that is currently being finalized
-	   by the main thread */
+	   FindCertItem() and ScheduleQuery(), so this request won't be
+	   added to a query that is currently being finalized by the
+	   main thread */
 	const std::scoped_lock lock{mutex};
 
-	if (auto item = GetNoWildCardCached(host, special))
+	/* check again; the certificate may have been added after
+	   the snapshot was published */
+	if (auto *item = FindCertItem(map, host, wildcard, special_sv)) {
+		item->Touch(now);
 		return ApplyAndSetState(ssl, *item);
-
-	const auto wildcard = MakeCommonNameWildcard(host);
-	if (!wildcard.empty()) {
-		if (auto item = GetNoWildCardCached(wildcard.c_str(), special))
-			return ApplyAndSetState(ssl, *item);
 	}
 
 	if (name_cache.Lookup(host) ||
@@ -477,7 +694,7 @@ CertCache::Apply(SSL &ssl, const char *host,
 }
 
 bool
-CertCache::Flush(const std::string_view name) noexcept
+CertCache::Flush(const std::string_view name, bool *was_primary) noexcept
 {
 	auto r = map.equal_range(name);
 	if (r.first == r.second)
@@ -486,15 +703,19 @@ CertCache::Flush(const std::string_view name) noexcept
 	std::set<std::string, std::less<>> alt_names;
 
 	for (auto i = r.first; i != r.second;) {
-		const auto &item = i->second;
+		const auto &item = *i->second;
 
 		/* if this is a primary item (not a shadow item for an
 		   altName), collect all altNames to be flushed
 		   later */
-		if (name == GetCommonName(*item.cert).c_str())
+		if (name == GetCommonName(*item.cert).c_str()) {
 			for (auto &a : GetSubjectAltNames(*item.cert))
 				alt_names.emplace(std::move(a));
 
+			if (was_primary != nullptr && item.special.empty())
+				*was_primary = true;
+		}
+
 		i = map.erase(i);
 	}
 
@@ -508,12 +729,28 @@ CertCache::Flush(const std::string_view name) noexcept
 void
 CertCache::OnCertModified(const std::string_view name, bool deleted) noexcept
 {
-	const std::scoped_lock lock{mutex};
+	bool was_primary = false;
 
-	if (Flush(name))
-		logger.Fmt(5, "flushed {} certificate {:?}"sv,
-			   deleted ? "deleted"sv : "modified"sv,
-			   name);
+	{
+		const std::scoped_lock lock{mutex};
+
+		if (!Flush(name, &was_primary))
+			return;
+	}
+
+	logger.Fmt(5, "flushed {} certificate {:?}"sv,
+		   deleted ? "deleted"sv : "modified"sv,
+		   name);
+
+	InvalidateSnapshot();
+
+	if (!deleted && was_primary) {
+		/* the certificate was in use; load the new version
+		   in the background, so the next handshake doesn't
+		   have to wait for the database */
+		prewarm_queue.emplace_back(name);
+		StartQuery();
+	}
 }
 
 void
@@ -7,21 +7,27 @@
 #include "CAMap.hxx"
 #include "NameCache.hxx"
 #include "LookupCertResult.hxx"
+#include "OcspStaple.hxx"
+#include "stats/OcspStapleStats.hxx"
 #include "lib/openssl/UniqueCertKey.hxx"
 #include "lib/openssl/IntegralExDataIndex.hxx"
 #include "certdb/Config.hxx"
 #include "pg/AsyncConnection.hxx"
+#include "event/DeferEvent.hxx"
+#include "event/FineTimerEvent.hxx"
 #include "thread/Notify.hxx"
 #include "io/Logger.hxx"
 #include "util/Cancellable.hxx"
 #include "util/IntrusiveList.hxx"
 #include "util/TransparentHash.hxx"
 
+#include <atomic>
+#include <deque>
 #include <unordered_map>
 #include <string>
 #include <mutex>
 #include <chrono>
-#include <optional>
+#include <memory>
 
 #include <string.h>
 
@@ -31,6 +37,10 @@ class CertDatabase;
  * A frontend for #CertDatabase which caches results as SSL_CTX
  * instance.  It is thread-safe, designed to be called synchronously
  * by worker threads (via #SslFilter).
+ *
+ * Worker threads look up certificates in a read-only snapshot of
+ * the cache which is replaced (not modified) by the main thread;
+ * only cache misses need to lock the mutex.
  */
 class CertCache final : Pg::AsyncConnectionHandler, CertNameCacheHandler {
 	const LLogger logger;
@@ -74,29 +84,102 @@ class CertCache final : Pg::AsyncConnectionHandler, CertNameCacheHandler {
 	 */
 	std::mutex mutex;
 
+	/**
+	 * A certificate/key pair loaded from the database.  It is
+	 * shared by the primary item (keyed by the common name) and
+	 * the shadow items (keyed by the altNames) and by
+	 * #snapshot, therefore all mutable fields are atomic.
+	 */
 	struct Item : UniqueCertKey {
-		std::string special;
+		const std::string special;
+
+		/**
+		 * The OCSP response to be stapled to handshakes
+		 * with this certificate (or nullptr).
+		 */
+		std::atomic<std::shared_ptr<const OcspStaple>> ocsp_staple;
+
+		/**
+		 * The GetOcspStapleVersion() of the OCSP response
+		 * file at the time of the last load attempt.
+		 */
+		std::atomic<uint_least64_t> ocsp_version{0};
 
-		std::chrono::steady_clock::time_point expires;
+		std::atomic<std::chrono::steady_clock::time_point> expires;
 
-		Item(UniqueCertKey &&_ck,
+		Item(UniqueCertKey &&_ck, std::string_view _special,
 		     std::chrono::steady_clock::time_point now) noexcept
 			:UniqueCertKey(std::move(_ck)),
+			 special(_special),
 			 /* the initial expiration is 6 hours; it will be raised
 			    to 24 hours if the certificate is used again */
 			 expires(now + std::chrono::hours(6)) {}
 
-		Item(const Item &src) noexcept
-			:UniqueCertKey(UpRef(src)),
-			 special(src.special),
-			 expires(src.expires) {}
+		Item(const Item &) = delete;
+		Item &operator=(const Item &) = delete;
+
+		/**
+		 * The certificate has been used; postpone its
+		 * expiration.
+		 */
+		void Touch(std::chrono::steady_clock::time_point now) noexcept {
+			expires.store(now + std::chrono::hours(24),
+				      std::memory_order_relaxed);
+		}
+
+		[[gnu::pure]]
+		bool IsExpired(std::chrono::steady_clock::time_point now) const noexcept {
+			return now >= expires.load(std::memory_order_relaxed);
+		}
+
+		[[gnu::pure]]
+		bool NeedsOcspRefresh(std::chrono::steady_clock::time_point now) const noexcept {
+			const auto staple = ocsp_staple.load(std::memory_order_relaxed);
+			return !staple || now >= staple->refresh;
+		}
 	};
 
 	/**
 	 * Map host names to SSL_CTX instances.  The key may be a
 	 * wildcard.
 	 */
-	std::unordered_multimap<std::string, Item, TransparentHash, std::equal_to<>> map;
+	using Map = std::unordered_multimap<std::string, std::shared_ptr<Item>,
+					    TransparentHash, std::equal_to<>>;
+	Map map;
+
+	/**
+	 * A read-only copy of #map which is used by worker threads
+	 * without locking the mutex.  After #map has been modified,
+	 * the main thread publishes a new copy (via
+	 * #publish_snapshot_event or #publish_snapshot_timer).  May
+	 * be nullptr if the cache is empty.
+	 */
+	std::atomic<std::shared_ptr<const Map>> snapshot;
+
+	/**
+	 * Publishes a new #snapshot in the next #EventLoop iteration
+	 * after items have been removed from #map, so stale
+	 * certificates are not used any longer.
+	 */
+	DeferEvent publish_snapshot_event;
+
+	/**
+	 * Publishes a new #snapshot after items have been added to
+	 * #map.  This is rate-limited because each publication copies
+	 * the whole #map (prewarming would otherwise cost quadratic
+	 * time); until then, new items are found by the locked
+	 * lookup.
+	 */
+	FineTimerEvent publish_snapshot_timer;
+
+	/**
+	 * Names to be loaded into the cache in the background when the
+	 * database is idle (loaded from
+	 * CertDatabaseConfig::prewarm_file or enqueued after a cached
+	 * certificate was modified).  Only accessed from the main
+	 * thread.
+	 */
+	std::deque<std::string> prewarm_queue;
 
 	struct Request;
 	class Query;
@@ -112,6 +195,12 @@ class CertCache final : Pg::AsyncConnectionHandler, CertNameCacheHandler {
 	 */
 	QueryMap::iterator current_query = queries.end();
 
+	/**
+	 * Counters for handshakes where the client has asked for a
+	 * stapled OCSP response (updated by worker threads).
+	 */
+	std::atomic<uint_least64_t> n_ocsp_staple_hits{0}, n_ocsp_staple_misses{0};
+
 public:
 	CertCache(EventLoop &event_loop,
 		  const CertDatabaseConfig &_config) noexcept;
@@ -124,11 +213,29 @@ public:
 
 	void LoadCaCertificate(const char *path);
 
+	/**
+	 * Connect to the database and begin prewarming the cache
+	 * with the names from CertDatabaseConfig::prewarm_file.
+	 */
 	void Connect() noexcept;
+
+	/**
+	 * Disconnect from the database and save the prewarm list.
+	 */
 	void Disconnect() noexcept;
 
+	/**
+	 * Flush expired certificates, reload OCSP staples which are
+	 * missing or due for refresh and save the prewarm list.  This
+	 * is supposed to be called periodically.
+	 */
 	void Expire() noexcept;
 
+	void AddOcspStapleStats(OcspStapleStats &stats) const noexcept {
+		stats.hits += n_ocsp_staple_hits.load(std::memory_order_relaxed);
+		stats.misses += n_ocsp_staple_misses.load(std::memory_order_relaxed);
+	}
+
 	/**
 	 * Look up a certificate by host name, and set it in the given
 	 * #SSL.
@@ -143,22 +250,58 @@ public:
 			       const char *special) noexcept;
 
 private:
+	/**
+	 * Load the OCSP staple for the given item's certificate (if
+	 * configured), unless the file has not changed since the
+	 * last attempt.  Errors are logged.
+	 */
+	void LoadOcspStaple(Item &item) noexcept;
+
+	void RefreshOcspStaples() noexcept;
+
+	/**
+	 * Schedule the publication of a new #snapshot.  Must be
+	 * called in the main thread after removing items from #map.
+	 */
+	void InvalidateSnapshot() noexcept {
+		publish_snapshot_event.Schedule();
+	}
+
+	/**
+	 * Like InvalidateSnapshot(), but after items have been added
+	 * to #map; the publication is rate-limited.
+	 */
+	void ScheduleSnapshot() noexcept;
+
+	void PublishSnapshot() noexcept;
+
+	/**
+	 * Load the prewarm list file (if configured) into
+	 * #prewarm_queue.
+	 */
+	void LoadPrewarmList() noexcept;
+
+	/**
+	 * Save the names of the most recently used certificates to
+	 * the prewarm list file (if configured).
+	 */
+	void SavePrewarmList() noexcept;
+
 	/**
 	 * Add the given certificate/key pair to the cache.
 	 *
 	 * This method locks the mutex when necessary.
 	 */
-	UniqueCertKey Add(UniqueCertKey &&ck,
-			  const char *special);
+	std::shared_ptr<Item> Add(UniqueCertKey &&ck, const char *special);
+
+	void StartQuery() noexcept;
 
 	/**
+	 * Start a query for the next name in #prewarm_queue.
+	 *
 	 * Caller must lock #mutex.
 	 */
-	[[gnu::pure]]
-	std::optional<UniqueCertKey> GetNoWildCardCached(const char *host,
-							 const char *special) noexcept;
-
-	void StartQuery() noexcept;
+	void StartPrewarmQuery() noexcept;
 
 	/**
 	 * Caller must lock #mutex.
@@ -167,19 +310,27 @@ private:
 			   const char *special) noexcept;
 
 	void Apply(SSL &ssl, X509 &cert, EVP_PKEY &key);
-	void Apply(SSL &ssl, const UniqueCertKey &cert_key);
+	void Apply(SSL &ssl, const Item &item);
+
+	/**
+	 * Staple the item's OCSP response if the client has asked
+	 * for it.
+	 */
+	void ApplyOcspStaple(SSL &ssl, const Item &item) noexcept;
 
 	LookupCertResult ApplyAndSetState(SSL &ssl,
-					  const UniqueCertKey &cert_key) noexcept;
+					  const Item &item) noexcept;
 
 	/**
 	 * Flush items with the given name.
 	 *
 	 * Caller must lock the mutex.
 	 *
+	 * @param was_primary if not nullptr, then this is set to true
+	 * if a primary item (without "special") was flushed
 	 * @return true if at least one item was found and deleted
 	 */
-	bool Flush(std::string_view name) noexcept;
+	bool Flush(std::string_view name, bool *was_primary=nullptr) noexcept;
 
 	/* virtual methods from Pg::AsyncConnectionHandler */
 	void OnConnect() override;
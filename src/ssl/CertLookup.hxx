@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <string_view>
+
+/*
+ * Lookups in the name map of #CertCache.  The map is a multimap
+ * from host names to (smart pointers to) items which have a
+ * "special" attribute; it may be the locked map or a read-only
+ * snapshot of it.
+ */
+
+/**
+ * Look up a (non-wildcard) name.
+ *
+ * @return the item or nullptr if there is no match
+ */
+template<typename Map>
+[[gnu::pure]]
+auto *
+FindCertItem(const Map &map, std::string_view host,
+	     std::string_view special) noexcept
+{
+	typename Map::mapped_type::element_type *result = nullptr;
+
+	for (auto [i, end] = map.equal_range(host); i != end; ++i) {
+		if (i->second->special == special) {
+			result = i->second.get();
+			break;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * Look up a name, falling back to the wildcard.
+ *
+ * @param wildcard the wildcard for #host (see
+ * MakeCommonNameWildcard()) or an empty string
+ */
+template<typename Map>
+[[gnu::pure]]
+auto *
+FindCertItem(const Map &map, std::string_view host,
+	     std::string_view wildcard, std::string_view special) noexcept
+{
+	auto *item = FindCertItem(map, host, special);
+	if (item == nullptr && !wildcard.empty())
+		item = FindCertItem(map, wildcard, special);
+
+	return item;
+}
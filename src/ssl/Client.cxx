@@ -13,7 +13,7 @@
 #include "lib/openssl/UniqueCertKey.hxx"
 #include "io/Logger.hxx"
 #include "fs/ThreadSocketFilter.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 
 #include <map>
 
@@ -71,6 +71,58 @@ SslClientFactory::ClientCertCallback(SSL *ssl, X509 **x509,
 	return GetFactory(ssl).ClientCertCallback_(ssl, x509, pkey);
 }
 
+int
+SslClientFactory::NewSessionCallback(SSL *ssl, SSL_SESSION *session) noexcept
+{
+	/* this is called in the worker thread which runs the
+	   handshake */
+
+	const auto *key = (const std::string *)SSL_get_ex_data(ssl, session_key_idx);
+	if (key == nullptr)
+		return 0;
+
+	GetFactory(ssl).session_cache.Put(*key, SslClientSessionCache::SessionPtr{session});
+
+	/* we have taken ownership of the session */
+	return 1;
+}
+
+void
+SslClientFactory::FreeSessionKey(void *, void *ptr,
+				 CRYPTO_EX_DATA *, int,
+				 long, void *) noexcept
+{
+	delete (std::string *)ptr;
+}
+
+/**
+ * Build the key for #SslClientSessionCache: a session may only be
+ * resumed with the same server, the same SNI, the same client
+ * certificate and the same ALPN protocols.
+ *
+ * @return the key or an empty string if session resumption is not
+ * possible
+ */
+static std::string
+MakeSessionKey(SocketAddress peer, const char *hostname,
+	       const char *certificate, SslClientAlpn alpn) noexcept
+{
+	if (peer.IsNull())
+		return {};
+
+	std::string key{(const char *)peer.GetAddress(), peer.GetSize()};
+	key.push_back(static_cast<char>(alpn));
+
+	if (hostname != nullptr)
+		key.append(hostname);
+	key.push_back('\0');
+
+	if (certificate != nullptr)
+		key.append(certificate);
+
+	return key;
+}
+
 static auto
 LoadCertKey(const SslCertKeyConfig &config)
 {
@@ -130,6 +182,18 @@ SslClientFactory::SslClientFactory(const SslClientConfig &config)
 
 	SSL_CTX_set_ex_data(ctx.get(), idx, this);
 
+	if (session_key_idx < 0)
+		session_key_idx = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr,
+						       FreeSessionKey);
+
+	/* resume sessions with our backends; OpenSSL reports new
+	   sessions to NewSessionCallback(), and
+	   #SslClientSessionCache takes care of storing them */
+	SSL_CTX_set_session_cache_mode(ctx.get(),
+				       SSL_SESS_CACHE_CLIENT|
+				       SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx.get(), NewSessionCallback);
+
 	if (!config.cert_key.empty()) {
 		certs = std::make_unique<SslClientCerts>(config.cert_key);
 		SSL_CTX_set_client_cert_cb(ctx.get(), ClientCertCallback);
@@ -142,7 +206,8 @@ SocketFilterPtr
 SslClientFactory::Create(EventLoop &event_loop,
 			 const char *hostname,
 			 const char *certificate,
-			 SslClientAlpn alpn)
+			 SslClientAlpn alpn,
+			 SocketAddress peer)
 {
 	UniqueSSL ssl(SSL_new(ctx.get()));
 	if (!ssl)
@@ -179,7 +244,17 @@ SslClientFactory::Create(EventLoop &event_loop,
 		SSL_use_certificate(ssl.get(), c->cert.get());
 	}
 
-	auto &queue = thread_pool_get_queue(event_loop);
+	if (auto key = MakeSessionKey(peer, hostname, certificate, alpn);
+	    !key.empty()) {
+		if (const auto session = session_cache.Get(key))
+			/* this acquires a new reference */
+			SSL_set_session(ssl.get(), session.get());
+
+		SSL_set_ex_data(ssl.get(), session_key_idx,
+				new std::string(std::move(key)));
+	}
+
+	auto &queue = worker_pool_get(event_loop);
 	return SocketFilterPtr(new ThreadSocketFilter(queue,
 						      ssl_filter_new(std::move(ssl))));
 }
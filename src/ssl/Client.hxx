@@ -9,8 +9,10 @@
 #pragma once
 
 #include "AlpnClient.hxx"
+#include "ClientSessionCache.hxx"
 #include "lib/openssl/Ctx.hxx"
 #include "fs/Ptr.hxx"
+#include "net/SocketAddress.hxx"
 
 #include <memory>
 
@@ -22,8 +24,16 @@ class SslClientFactory {
 	SslCtx ctx;
 	std::unique_ptr<SslClientCerts> certs;
 
+	SslClientSessionCache session_cache;
+
 	static inline int idx = -1;
 
+	/**
+	 * The SSL ex_data index for the session cache key (a
+	 * heap-allocated std::string).
+	 */
+	static inline int session_key_idx = -1;
+
 public:
 	explicit SslClientFactory(const SslClientConfig &config);
 	~SslClientFactory() noexcept;
@@ -33,11 +43,20 @@ public:
 	 *
 	 * @param certificate the name of the client certificate to be
 	 * used
+	 *
+	 * @param peer the address of the server; it is used to look
+	 * up a session to be resumed (may be null to disable session
+	 * resumption)
 	 */
 	SocketFilterPtr Create(EventLoop &event_loop,
 			       const char *hostname,
 			       const char *certificate,
-			       SslClientAlpn alpn=SslClientAlpn::NONE);
+			       SslClientAlpn alpn=SslClientAlpn::NONE,
+			       SocketAddress peer=SocketAddress::Null());
+
+	void FlushSessionCache() noexcept {
+		session_cache.Flush();
+	}
 
 private:
 	[[gnu::const]]
@@ -54,4 +73,10 @@ private:
 				EVP_PKEY **pkey) noexcept;
 	static int ClientCertCallback(SSL *ssl, X509 **x509,
 				      EVP_PKEY **pkey) noexcept;
+
+	static int NewSessionCallback(SSL *ssl, SSL_SESSION *session) noexcept;
+
+	static void FreeSessionKey(void *parent, void *ptr,
+				   CRYPTO_EX_DATA *ad, int idx,
+				   long argl, void *argp) noexcept;
 };
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ClientSessionCache.hxx"
+
+#include <time.h>
+
+[[gnu::pure]]
+static bool
+IsExpired(const SSL_SESSION &session, time_t now) noexcept
+{
+	return SSL_SESSION_get_time(&session) + SSL_SESSION_get_timeout(&session) <= now;
+}
+
+SslClientSessionCache::SessionPtr
+SslClientSessionCache::Get(std::string_view key) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	auto i = map.find(key);
+	if (i == map.end())
+		return {};
+
+	if (IsExpired(*i->second, time(nullptr))) {
+		map.erase(i);
+		return {};
+	}
+
+	if (SSL_SESSION_get_protocol_version(i->second.get()) >= TLS1_3_VERSION) {
+		/* TLS 1.3 tickets are single-use */
+		auto session = std::move(i->second);
+		map.erase(i);
+		return session;
+	}
+
+	SSL_SESSION_up_ref(i->second.get());
+	return SessionPtr{i->second.get()};
+}
+
+void
+SslClientSessionCache::Put(std::string_view key, SessionPtr session) noexcept
+{
+	if (!SSL_SESSION_is_resumable(session.get()))
+		return;
+
+	const std::scoped_lock lock{mutex};
+
+	if (auto i = map.find(key); i != map.end()) {
+		i->second = std::move(session);
+		return;
+	}
+
+	if (map.size() >= MAX_SIZE)
+		/* crude eviction; this cache is only an optimization
+		   and the limit is rarely reached */
+		map.erase(map.begin());
+
+	map.emplace(key, std::move(session));
+}
+
+void
+SslClientSessionCache::Flush() noexcept
+{
+	const std::scoped_lock lock{mutex};
+	map.clear();
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <openssl/ssl.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+ * A cache for TLS client sessions (TLS 1.2 session tickets and TLS
+ * 1.3 PSKs), keyed by destination.  It allows resuming sessions on
+ * new connections to a server we have talked to before, saving a
+ * full handshake.
+ *
+ * This class is thread-safe because new sessions are reported by
+ * OpenSSL in the worker thread which runs the handshake.
+ */
+class SslClientSessionCache {
+	struct SessionDeleter {
+		void operator()(SSL_SESSION *session) const noexcept {
+			SSL_SESSION_free(session);
+		}
+	};
+
+public:
+	using SessionPtr = std::unique_ptr<SSL_SESSION, SessionDeleter>;
+
+	/**
+	 * The maximum number of destinations.
+	 */
+	static constexpr std::size_t MAX_SIZE = 4096;
+
+private:
+	std::mutex mutex;
+
+	std::map<std::string, SessionPtr, std::less<>> map;
+
+public:
+	/**
+	 * Look up a session for the given destination.  TLS 1.3
+	 * tickets are removed from the cache because they should be
+	 * used only once (RFC 8446 C.4).
+	 *
+	 * @return a new reference or nullptr
+	 */
+	SessionPtr Get(std::string_view key) noexcept;
+
+	/**
+	 * Remember a session for the given destination, replacing
+	 * the previous one.
+	 */
+	void Put(std::string_view key, SessionPtr session) noexcept;
+
+	void Flush() noexcept;
+};
@@ -6,6 +6,7 @@
 #include "Basic.hxx"
 #include "Config.hxx"
 #include "CertCallback.hxx"
+#include "OcspStaple.hxx"
 #include "lib/openssl/Error.hxx"
 #include "lib/openssl/Name.hxx"
 #include "lib/openssl/AltName.hxx"
@@ -141,6 +142,11 @@ SslFactory::SslFactory(const SslConfig &config,
 		SSL_CTX_set_cert_cb(ssl_ctx.get(), CertCallback, this);
 	else if (!cert_key.empty())
 		cert_key.front().Apply(*ssl_ctx);
+
+	if (cert_callback)
+		/* the #SslCertCallback may staple an OCSP response
+		   (see CertCache) */
+		EnableOcspStapling(*ssl_ctx);
 }
 
 SslFactory::~SslFactory() noexcept = default;
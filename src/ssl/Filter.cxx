@@ -8,6 +8,7 @@
 #include "lib/openssl/Name.hxx"
 #include "lib/openssl/UniqueX509.hxx"
 #include "FifoBufferBio.hxx"
+#include "InlineRun.hxx"
 #include "fs/ThreadSocketFilter.hxx"
 #include "memory/fb_pool.hxx"
 #include "memory/SliceFifoBuffer.hxx"
@@ -64,6 +65,7 @@ private:
 
 	/* virtual methods from class ThreadSocketFilterHandler */
 	void PreRun(ThreadSocketFilterInternal &f) noexcept override;
+	bool WantInlineRun(const ThreadSocketFilterInternal &f) const noexcept override;
 	void Run(ThreadSocketFilterInternal &f) override;
 	void PostRun(ThreadSocketFilterInternal &f) noexcept override;
 	void CancelRun(ThreadSocketFilterInternal &f) noexcept override;
@@ -224,6 +226,15 @@ SslFilter::PreRun(ThreadSocketFilterInternal &f) noexcept
 	}
 }
 
+bool
+SslFilter::WantInlineRun(const ThreadSocketFilterInternal &f) const noexcept
+{
+	const std::scoped_lock lock{f.mutex};
+	return SslWantInlineRun(handshaking,
+				plain_output.GetAvailable() + f.plain_output.GetAvailable() +
+				encrypted_input.GetAvailable() + f.encrypted_input.GetAvailable());
+}
+
 void
 SslFilter::Run(ThreadSocketFilterInternal &f)
 {
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Encrypting or decrypting this many bytes with a symmetric cipher
+ * is cheaper than handing the job over to a worker thread and back,
+ * so it is done right in the main thread.
+ */
+inline constexpr std::size_t SSL_INLINE_RUN_THRESHOLD = 4096;
+
+/**
+ * Shall #SslFilter do its work synchronously in the main thread?
+ *
+ * @param handshaking true if the TLS handshake is still in progress
+ * @param pending the number of plain-text bytes to be encrypted plus
+ * the number of encrypted bytes to be decrypted
+ */
+constexpr bool
+SslWantInlineRun(bool handshaking, std::size_t pending) noexcept
+{
+	if (handshaking)
+		/* the handshake involves expensive public-key
+		   cryptography and may block (e.g. in the
+		   certificate lookup) */
+		return false;
+
+	return pending <= SSL_INLINE_RUN_THRESHOLD;
+}
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "OcspStaple.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "io/Open.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "system/Error.hxx"
+
+#include <openssl/ocsp.h>
+#include <openssl/ssl.h>
+
+#include <fmt/format.h>
+
+#include <memory>
+#include <string>
+
+#include <fcntl.h> // for AT_FDCWD
+#include <sys/stat.h>
+
+/**
+ * OCSP responses are usually a few kilobytes; anything larger than
+ * this is rejected.
+ */
+static constexpr std::size_t MAX_OCSP_RESPONSE_SIZE = 64 * 1024;
+
+struct OcspResponseDeleter {
+	void operator()(OCSP_RESPONSE *r) const noexcept {
+		OCSP_RESPONSE_free(r);
+	}
+};
+
+struct OcspBasicResponseDeleter {
+	void operator()(OCSP_BASICRESP *r) const noexcept {
+		OCSP_BASICRESP_free(r);
+	}
+};
+
+static std::string
+MakeOcspStapleFilename(const char *directory, const X509 &cert)
+{
+	const ASN1_INTEGER *serial = X509_get0_serialNumber(&cert);
+	const unsigned char *data = ASN1_STRING_get0_data(serial);
+	const int length = ASN1_STRING_length(serial);
+
+	std::string path{directory};
+	path.push_back('/');
+	for (int i = 0; i < length; ++i)
+		path += fmt::format("{:02x}", data[i]);
+	path += ".der";
+	return path;
+}
+
+/**
+ * @return the file contents or an empty array if the file does not
+ * exist
+ */
+static AllocatedArray<std::byte>
+LoadOcspFile(const char *path)
+{
+	UniqueFileDescriptor fd;
+
+	try {
+		fd = OpenReadOnly(path);
+	} catch (const std::system_error &e) {
+		if (IsFileNotFound(e))
+			return {};
+		throw;
+	}
+
+	AllocatedArray<std::byte> buffer{MAX_OCSP_RESPONSE_SIZE};
+	const ssize_t nbytes = fd.ReadAt(0, {buffer.data(), buffer.size()});
+	if (nbytes < 0)
+		throw FmtErrno("Failed to read {}", path);
+
+	if (static_cast<std::size_t>(nbytes) >= buffer.size())
+		throw FmtRuntimeError("OCSP response too large: {}", path);
+
+	buffer.SetSize(nbytes);
+	return buffer;
+}
+
+/**
+ * Find the "SingleResponse" for the given certificate (by its serial
+ * number; we may not know the issuer, which would be needed for
+ * OCSP_resp_find_status()).
+ */
+static OCSP_SINGLERESP *
+FindSingleResponse(OCSP_BASICRESP &basic, const X509 &cert) noexcept
+{
+	const ASN1_INTEGER *cert_serial = X509_get0_serialNumber(&cert);
+
+	for (int i = 0, n = OCSP_resp_count(&basic); i < n; ++i) {
+		OCSP_SINGLERESP *single = OCSP_resp_get0(&basic, i);
+
+		ASN1_INTEGER *serial;
+		if (OCSP_id_get0_info(nullptr, nullptr, nullptr, &serial,
+				      const_cast<OCSP_CERTID *>(OCSP_SINGLERESP_get0_id(single))) == 1 &&
+		    ASN1_INTEGER_cmp(serial, cert_serial) == 0)
+			return single;
+	}
+
+	return nullptr;
+}
+
+/**
+ * Calculate the time from @from to @to (nullptr is "now").
+ */
+static std::chrono::seconds
+Asn1TimeDiff(const ASN1_TIME *from, const ASN1_TIME *to)
+{
+	int days, seconds;
+	if (ASN1_TIME_diff(&days, &seconds, from, to) != 1)
+		throw std::runtime_error("Malformed time in OCSP response");
+
+	return std::chrono::hours{days * 24} + std::chrono::seconds{seconds};
+}
+
+std::shared_ptr<const OcspStaple>
+LoadOcspStaple(const char *directory, X509 &cert,
+	       std::chrono::steady_clock::time_point now)
+{
+	const auto path = MakeOcspStapleFilename(directory, cert);
+
+	auto der = LoadOcspFile(path.c_str());
+	if (der.empty())
+		return nullptr;
+
+	const auto *p = reinterpret_cast<const unsigned char *>(der.data());
+	const std::unique_ptr<OCSP_RESPONSE, OcspResponseDeleter> response{
+		d2i_OCSP_RESPONSE(nullptr, &p, der.size())
+	};
+	if (!response)
+		throw FmtRuntimeError("Malformed OCSP response: {}", path);
+
+	if (OCSP_response_status(response.get()) != OCSP_RESPONSE_STATUS_SUCCESSFUL)
+		throw FmtRuntimeError("Unsuccessful OCSP response: {}", path);
+
+	const std::unique_ptr<OCSP_BASICRESP, OcspBasicResponseDeleter> basic{
+		OCSP_response_get1_basic(response.get())
+	};
+	if (!basic)
+		throw FmtRuntimeError("Malformed OCSP response: {}", path);
+
+	OCSP_SINGLERESP *single = FindSingleResponse(*basic, cert);
+	if (single == nullptr)
+		throw FmtRuntimeError("OCSP response does not match certificate: {}",
+				      path);
+
+	int reason;
+	ASN1_GENERALIZEDTIME *revoked, *this_update, *next_update;
+	OCSP_single_get0_status(single, &reason, &revoked,
+				&this_update, &next_update);
+	if (this_update == nullptr || next_update == nullptr)
+		throw FmtRuntimeError("OCSP response without nextUpdate: {}",
+				      path);
+
+	const auto remaining = Asn1TimeDiff(nullptr, next_update);
+	if (remaining <= std::chrono::seconds::zero())
+		throw FmtRuntimeError("OCSP response is expired: {}", path);
+
+	const auto period = Asn1TimeDiff(this_update, next_update);
+
+	auto staple = std::make_shared<OcspStaple>();
+	staple->der = std::move(der);
+	staple->expires = now + remaining;
+	staple->refresh = staple->expires - period / 2;
+	return staple;
+}
+
+uint_least64_t
+GetOcspStapleVersion(const char *directory, const X509 &cert) noexcept
+try {
+	const auto path = MakeOcspStapleFilename(directory, cert);
+
+	struct statx st;
+	if (statx(AT_FDCWD, path.c_str(), 0, STATX_MTIME, &st) < 0)
+		return 0;
+
+	const uint_least64_t version = uint_least64_t(st.stx_mtime.tv_sec) * 1000000000U +
+		st.stx_mtime.tv_nsec;
+	return version != 0 ? version : 1;
+} catch (...) {
+	return 0;
+}
+
+static int
+OcspStatusCallback(SSL *ssl, void *) noexcept
+{
+	const unsigned char *response;
+	return SSL_get_tlsext_status_ocsp_resp(ssl, &response) > 0
+		? SSL_TLSEXT_ERR_OK
+		: SSL_TLSEXT_ERR_NOACK;
+}
+
+void
+EnableOcspStapling(SSL_CTX &ssl_ctx) noexcept
+{
+	SSL_CTX_set_tlsext_status_cb(&ssl_ctx, OcspStatusCallback);
+}
+
+bool
+WantsOcspStaple(SSL &ssl) noexcept
+{
+	return SSL_get_tlsext_status_type(&ssl) == TLSEXT_STATUSTYPE_ocsp;
+}
+
+void
+ApplyOcspStaple(SSL &ssl, const OcspStaple &staple) noexcept
+{
+	/* OpenSSL takes ownership of the buffer */
+	auto *copy = static_cast<unsigned char *>(OPENSSL_memdup(staple.der.data(),
+								 staple.der.size()));
+	if (copy != nullptr)
+		SSL_set_tlsext_status_ocsp_resp(&ssl, copy, staple.der.size());
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "util/AllocatedArray.hxx"
+
+#include <openssl/ossl_typ.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * A DER-encoded OCSP response which can be "stapled" to the TLS
+ * handshake (RFC 6066 "status_request"), so the client does not need
+ * to contact the CA's OCSP responder.
+ */
+struct OcspStaple {
+	AllocatedArray<std::byte> der;
+
+	/**
+	 * The "nextUpdate" of the response; after this time, the
+	 * staple must not be used anymore.
+	 */
+	std::chrono::steady_clock::time_point expires;
+
+	/**
+	 * Half-way between "thisUpdate" and "nextUpdate"; after this
+	 * time, a newer response should be loaded.
+	 */
+	std::chrono::steady_clock::time_point refresh;
+
+	bool IsValid(std::chrono::steady_clock::time_point now) const noexcept {
+		return now < expires;
+	}
+};
+
+/**
+ * Load the OCSP response for the given certificate from the given
+ * directory.  The file name is the lower-case hexadecimal serial
+ * number of the certificate with the suffix ".der"; it is supposed
+ * to be maintained by an external program (e.g. "openssl ocsp
+ * -respout").
+ *
+ * The response's signature is not verified (that is the client's
+ * job), but it must be successful, contain a response for the given
+ * certificate and must not be expired.
+ *
+ * Throws on error.
+ *
+ * @return the staple or nullptr if there is no such file
+ */
+std::shared_ptr<const OcspStaple>
+LoadOcspStaple(const char *directory, X509 &cert,
+	       std::chrono::steady_clock::time_point now);
+
+/**
+ * Determine the version of the OCSP response file for the given
+ * certificate (see LoadOcspStaple()).  It changes whenever the file
+ * is modified or replaced, which allows the caller to skip reloading
+ * a file which has not changed since the last attempt (e.g. because
+ * it was rejected).
+ *
+ * @return an opaque version number or 0 if there is no such file
+ */
+uint_least64_t
+GetOcspStapleVersion(const char *directory, const X509 &cert) noexcept;
+
+/**
+ * Install a "status_request" callback in the given #SSL_CTX which
+ * sends the response set by ApplyOcspStaple().
+ */
+void
+EnableOcspStapling(SSL_CTX &ssl_ctx) noexcept;
+
+/**
+ * Has the client asked for a stapled OCSP response?  May be called
+ * from the certificate callback.
+ */
+[[gnu::pure]]
+bool
+WantsOcspStaple(SSL &ssl) noexcept;
+
+/**
+ * Attach the given OCSP response to the handshake.  Call this from
+ * the certificate callback.
+ */
+void
+ApplyOcspStaple(SSL &ssl, const OcspStaple &staple) noexcept;
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PrewarmList.hxx"
+#include "io/BufferedReader.hxx"
+#include "io/FdReader.hxx"
+#include "io/FileWriter.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/SpanCast.hxx"
+#include "util/StringStrip.hxx"
+
+#include <algorithm> // for std::stable_sort()
+
+std::vector<std::string_view>
+SelectPrewarmNames(std::span<PrewarmCandidate> candidates, std::size_t max)
+{
+	std::stable_sort(candidates.begin(), candidates.end(),
+			 [](const auto &a, const auto &b){
+				 return a.last_used > b.last_used;
+			 });
+
+	std::vector<std::string_view> names;
+	names.reserve(std::min(candidates.size(), max));
+
+	for (const auto &i : candidates) {
+		if (names.size() >= max)
+			break;
+
+		if (i.name.empty() || i.name.find('\n') != i.name.npos)
+			continue;
+
+		names.emplace_back(i.name);
+	}
+
+	return names;
+}
+
+std::vector<std::string>
+LoadPrewarmList(const char *path, std::size_t max)
+{
+	std::vector<std::string> names;
+
+	UniqueFileDescriptor fd;
+	if (!fd.OpenReadOnly(path))
+		return names;
+
+	FdReader fr(fd);
+	BufferedReader br(fr);
+
+	while (names.size() < max) {
+		char *line = br.ReadLine();
+		if (line == nullptr)
+			break;
+
+		const std::string_view name = Strip(std::string_view{line});
+		if (!name.empty())
+			names.emplace_back(name);
+	}
+
+	return names;
+}
+
+void
+SavePrewarmList(const char *path, std::span<const std::string_view> names)
+{
+	std::string buffer;
+	for (const auto name : names) {
+		buffer.append(name);
+		buffer.push_back('\n');
+	}
+
+	FileWriter file(path, 0600);
+	file.Write(AsBytes(buffer));
+	file.Commit();
+}
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * The "prewarm list" is a plain text file containing the most
+ * recently used certificate names of a #CertCache, one per line, the
+ * most recently used one first.  It is saved periodically and
+ * loaded after a restart, so the cache can be filled before the
+ * first handshakes arrive.
+ */
+
+/**
+ * A certificate name which may be saved in the prewarm list.
+ */
+struct PrewarmCandidate {
+	/**
+	 * The time of the last use (or any other time point which
+	 * has the same order).
+	 */
+	std::chrono::steady_clock::time_point last_used;
+
+	std::string_view name;
+};
+
+/**
+ * Choose the names to be saved: the @max most recently used ones,
+ * the most recently used one first.  Names which cannot be stored
+ * in the file (empty or containing a newline) are skipped.
+ *
+ * @param candidates the candidates (will be reordered)
+ */
+std::vector<std::string_view>
+SelectPrewarmNames(std::span<PrewarmCandidate> candidates, std::size_t max);
+
+/**
+ * Load at most @max names from the given file.
+ *
+ * Throws on error.
+ *
+ * @return a list of names (empty if the file does not exist)
+ */
+std::vector<std::string>
+LoadPrewarmList(const char *path, std::size_t max);
+
+/**
+ * Replace the given file atomically with a new list.
+ *
+ * Throws on error.
+ */
+void
+SavePrewarmList(const char *path, std::span<const std::string_view> names);
@@ -11,12 +11,13 @@ SslSocketFilterFactory::CreateFilter()
 	return ssl_client_factory.Create(event_loop,
 					 host.empty() ? nullptr : host.c_str(),
 					 certificate.empty() ? nullptr : certificate.c_str(),
-					 alpn);
+					 alpn, peer);
 }
 
 SocketFilterFactoryPtr
-SslSocketFilterParams::CreateFactory() const noexcept
+SslSocketFilterParams::CreateFactory(SocketAddress peer) const noexcept
 {
 	return std::make_unique<SslSocketFilterFactory>(event_loop, ssl_client_factory,
-							host, certificate, alpn);
+							host, certificate, alpn,
+							peer);
 }
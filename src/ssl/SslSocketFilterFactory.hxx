@@ -7,6 +7,7 @@
 #include "AlpnClient.hxx"
 #include "fs/Params.hxx"
 #include "fs/Factory.hxx"
+#include "net/AllocatedSocketAddress.hxx"
 
 #include <string>
 
@@ -20,16 +21,22 @@ class SslSocketFilterFactory final : public SocketFilterFactory {
 	const std::string certificate;
 	const SslClientAlpn alpn;
 
+	/**
+	 * The server address; used for session resumption.
+	 */
+	const AllocatedSocketAddress peer;
+
 public:
 	SslSocketFilterFactory(EventLoop &_event_loop,
 			      SslClientFactory &_ssl_client_factory,
 			      const char *_host, const char *_certificate,
-			      SslClientAlpn _alpn=SslClientAlpn::NONE) noexcept
+			      SslClientAlpn _alpn=SslClientAlpn::NONE,
+			      SocketAddress _peer=SocketAddress::Null()) noexcept
 		:event_loop(_event_loop),
 		 ssl_client_factory(_ssl_client_factory),
 		 host(_host != nullptr ?  _host : ""),
 		 certificate(_certificate != nullptr ? _certificate : ""),
-		 alpn(_alpn) {}
+		 alpn(_alpn), peer(_peer) {}
 
 	SocketFilterPtr CreateFilter() override;
 };
@@ -55,5 +62,5 @@ public:
 		return host;
 	}
 
-	SocketFilterFactoryPtr CreateFactory() const noexcept override;
+	SocketFilterFactoryPtr CreateFactory(SocketAddress peer) const noexcept override;
 };
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * The compression effort chosen by #AutoCompressPolicy for one
+ * response.
+ */
+enum class AutoCompressLevel : uint_least8_t {
+	/**
+	 * Don't compress at all; the worker threads are saturated.
+	 */
+	NONE,
+
+	FAST,
+	MEDIUM,
+	BEST,
+};
+
+static constexpr std::size_t N_AUTO_COMPRESS_LEVELS = 4;
+
+/**
+ * Metrics for #AutoCompressPolicy.
+ */
+struct AutoCompressStats {
+	/**
+	 * How many responses were compressed with which
+	 * #AutoCompressLevel?  Indexed by the numeric enum value.
+	 */
+	std::array<uint_least64_t, N_AUTO_COMPRESS_LEVELS> n_by_level{};
+
+	/**
+	 * The most recently measured thread pool queue latency.
+	 */
+	std::chrono::steady_clock::duration queue_latency{};
+
+	/**
+	 * The most recently read CPU pressure ("some avg10" from
+	 * /proc/pressure/cpu) in percent.
+	 */
+	float cpu_pressure = 0;
+};
@@ -13,12 +13,26 @@ struct CacheStats {
 
 	uint_least64_t skips, misses, stores, hits;
 
+	/**
+	 * The number of items which were removed to make room for
+	 * new items.
+	 */
+	uint_least64_t evictions;
+
+	/**
+	 * The number of new items which were not admitted by the
+	 * admission policy (see #CacheAdmission).
+	 */
+	uint_least64_t rejections;
+
 	constexpr CacheStats &operator+=(const CacheStats &other) noexcept {
 		allocator += other.allocator;
 		skips += other.skips;
 		misses += other.misses;
 		stores += other.stores;
 		hits += other.hits;
+		evictions += other.evictions;
+		rejections += other.rejections;
 		return *this;
 	}
 };
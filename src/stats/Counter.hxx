@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * A counter which is modified by only one thread, but may be read by
+ * other threads at any time.  Incrementing it is a plain load and
+ * store without a locked read-modify-write instruction.
+ */
+class StatsCounter {
+	std::atomic<uint_least64_t> value{0};
+
+public:
+	void Add(uint_least64_t delta) noexcept {
+		value.store(value.load(std::memory_order_relaxed) + delta,
+			    std::memory_order_relaxed);
+	}
+
+	StatsCounter &operator++() noexcept {
+		Add(1);
+		return *this;
+	}
+
+	uint_least64_t Load() const noexcept {
+		return value.load(std::memory_order_relaxed);
+	}
+};
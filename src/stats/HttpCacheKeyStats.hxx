@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * The HTTP cache key normalization rules (see #HttpCacheKeyRules).
+ */
+enum class HttpCacheKeyRule : uint_least8_t {
+	DROP_QUERY_PARAMS,
+	SORT_QUERY,
+	LOWERCASE_HOST,
+	NORMALIZE_URI,
+};
+
+static constexpr std::size_t N_HTTP_CACHE_KEY_RULES = 4;
+
+static constexpr std::array<std::string_view, N_HTTP_CACHE_KEY_RULES> http_cache_key_rule_names{
+	"drop_query_params",
+	"sort_query",
+	"lowercase_host",
+	"normalize_uri",
+};
+
+/**
+ * Counters showing the effect of HTTP cache key normalization.
+ */
+struct HttpCacheKeyStats {
+	struct PerRule {
+		/**
+		 * The number of cache keys modified by this rule.
+		 */
+		uint_least64_t normalized = 0;
+
+		/**
+		 * The number of cache hits with a key modified by
+		 * this rule.
+		 */
+		uint_least64_t hits = 0;
+	};
+
+	/**
+	 * Indexed by #HttpCacheKeyRule.
+	 */
+	std::array<PerRule, N_HTTP_CACHE_KEY_RULES> rules{};
+
+	PerRule &operator[](HttpCacheKeyRule rule) noexcept {
+		return rules[static_cast<std::size_t>(rule)];
+	}
+};
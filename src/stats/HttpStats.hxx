@@ -49,4 +49,19 @@ struct HttpStats {
 
 		++n_per_status[HttpStatusToIndex(status)];
 	}
+
+	constexpr HttpStats &operator+=(const HttpStats &other) noexcept {
+		n_requests += other.n_requests;
+		n_invalid_frames += other.n_invalid_frames;
+		n_rejected += other.n_rejected;
+		n_delayed += other.n_delayed;
+		traffic_received += other.traffic_received;
+		traffic_sent += other.traffic_sent;
+		total_duration += other.total_duration;
+
+		for (std::size_t i = 0; i < n_per_status.size(); ++i)
+			n_per_status[i] += other.n_per_status[i];
+
+		return *this;
+	}
 };
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Metrics for OCSP stapling (see #CertCache).
+ */
+struct OcspStapleStats {
+	/**
+	 * The number of handshakes where the client asked for an
+	 * OCSP response and a valid one was stapled.
+	 */
+	uint_least64_t hits = 0;
+
+	/**
+	 * The number of handshakes where the client asked for an
+	 * OCSP response, but none was available.
+	 */
+	uint_least64_t misses = 0;
+};
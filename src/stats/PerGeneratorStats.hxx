@@ -15,6 +15,12 @@ struct PerGeneratorStats {
 	void AddRequest(HttpStatus status) noexcept {
 		++n_per_status[HttpStatusToIndex(status)];
 	}
+
+	constexpr PerGeneratorStats &operator+=(const PerGeneratorStats &other) noexcept {
+		for (std::size_t i = 0; i < n_per_status.size(); ++i)
+			n_per_status[i] += other.n_per_status[i];
+		return *this;
+	}
 };
 
 struct PerGeneratorStatsMap {
@@ -26,6 +32,15 @@ struct PerGeneratorStatsMap {
 		s.AddRequest(status);
 	}
 
+	/**
+	 * Add the given (merged) counters to the specified
+	 * generator.
+	 */
+	void Add(std::string_view generator,
+		 const PerGeneratorStats &stats) noexcept {
+		FindOrEmplace(generator) += stats;
+	}
+
 private:
 	[[gnu::pure]]
 	PerGeneratorStats &FindOrEmplace(std::string_view generator) noexcept {
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Counter.hxx"
+#include "HttpStats.hxx"
+#include "TaggedHttpStats.hxx"
+#include "PerGeneratorStats.hxx"
+#include "TagTable.hxx"
+#include "ThreadShards.hxx"
+
+/**
+ * Per-status counters in one #ThreadShards shard.
+ */
+struct HttpStatusShardCounters {
+	std::array<StatsCounter, valid_http_status_array.size()> n_per_status;
+
+	void AddRequest(HttpStatus status) noexcept {
+		++n_per_status[HttpStatusToIndex(status)];
+	}
+
+	/**
+	 * @return true if at least one request was counted
+	 */
+	bool MergeInto(PerHttpStatusCounters &dest) const noexcept {
+		bool result = false;
+		for (std::size_t i = 0; i < n_per_status.size(); ++i) {
+			const auto value = n_per_status[i].Load();
+			dest[i] += value;
+			result |= value > 0;
+		}
+
+		return result;
+	}
+};
+
+/**
+ * The request counters of #HttpStats in one #ThreadShards shard.
+ */
+struct HttpStatsShardCounters {
+	StatsCounter n_requests;
+	StatsCounter traffic_received, traffic_sent;
+
+	/**
+	 * In std::chrono::steady_clock::duration ticks.
+	 */
+	StatsCounter total_duration;
+
+	HttpStatusShardCounters per_status;
+
+	void AddRequest(HttpStatus status,
+			uint_least64_t bytes_received,
+			uint_least64_t bytes_sent,
+			std::chrono::steady_clock::duration duration) noexcept {
+		++n_requests;
+		traffic_received.Add(bytes_received);
+		traffic_sent.Add(bytes_sent);
+		total_duration.Add(duration.count());
+		per_status.AddRequest(status);
+	}
+
+	/**
+	 * @return true if at least one request was counted
+	 */
+	bool MergeInto(HttpStats &dest) const noexcept {
+		const auto n = n_requests.Load();
+		if (n == 0)
+			return false;
+
+		dest.n_requests += n;
+		dest.traffic_received += traffic_received.Load();
+		dest.traffic_sent += traffic_sent.Load();
+		dest.total_duration += std::chrono::steady_clock::duration(total_duration.Load());
+		per_status.MergeInto(dest.n_per_status);
+		return true;
+	}
+};
+
+/**
+ * Like #HttpStats, but with per-thread counters.
+ */
+class ShardedHttpStats {
+	ThreadShards<HttpStatsShardCounters> shards;
+
+public:
+	void AddRequest(HttpStatus status,
+			uint_least64_t bytes_received,
+			uint_least64_t bytes_sent,
+			std::chrono::steady_clock::duration duration) noexcept {
+		shards.Local().AddRequest(status, bytes_received, bytes_sent,
+					  duration);
+	}
+
+	/**
+	 * Sum up the counters of all threads.
+	 */
+	HttpStats Merge() const noexcept {
+		HttpStats result;
+		shards.ForEach([&result](const auto &shard){
+			shard.MergeInto(result);
+		});
+		return result;
+	}
+};
+
+/**
+ * Like #TaggedHttpStats, but with per-thread counters indexed by
+ * #StatsTagId.
+ */
+class ShardedTaggedHttpStats {
+	ThreadShards<StatsTagTable<HttpStatsShardCounters>> shards;
+
+public:
+	void AddRequest(StatsTagId tag,
+			HttpStatus status,
+			uint_least64_t bytes_received,
+			uint_least64_t bytes_sent,
+			std::chrono::steady_clock::duration duration) noexcept {
+		shards.Local()[tag].AddRequest(status,
+					       bytes_received, bytes_sent,
+					       duration);
+	}
+
+	/**
+	 * Sum up the counters of all threads.
+	 *
+	 * @param tags the registry which has assigned the tag ids
+	 */
+	TaggedHttpStats Merge(const StatsTagRegistry &tags) const noexcept {
+		TaggedHttpStats result;
+		shards.ForEach([&](const auto &table){
+			table.ForEach([&](StatsTagId id, const auto &counters){
+				HttpStats stats;
+				if (counters.MergeInto(stats))
+					result.Add(tags.GetName(id), stats);
+			});
+		});
+		return result;
+	}
+};
+
+/**
+ * Like #PerGeneratorStatsMap, but with per-thread counters indexed
+ * by #StatsTagId.
+ */
+class ShardedPerGeneratorStats {
+	ThreadShards<StatsTagTable<HttpStatusShardCounters>> shards;
+
+public:
+	void AddRequest(StatsTagId generator, HttpStatus status) noexcept {
+		shards.Local()[generator].AddRequest(status);
+	}
+
+	/**
+	 * Sum up the counters of all threads.
+	 *
+	 * @param generators the registry which has assigned the
+	 * generator ids
+	 */
+	PerGeneratorStatsMap Merge(const StatsTagRegistry &generators) const noexcept {
+		PerGeneratorStatsMap result;
+		shards.ForEach([&](const auto &table){
+			table.ForEach([&](StatsTagId id, const auto &counters){
+				PerGeneratorStats stats;
+				if (counters.MergeInto(stats.n_per_status))
+					result.Add(generators.GetName(id), stats);
+			});
+		});
+		return result;
+	}
+};
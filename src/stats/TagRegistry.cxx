@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "TagRegistry.hxx"
+
+#include <cassert>
+#include <mutex>
+
+StatsTagRegistry::StatsTagRegistry(std::string_view name,
+				   std::size_t _max_tags) noexcept
+	:logger(name), max_tags(_max_tags)
+{
+	assert(max_tags > 0);
+	assert(max_tags <= MAX_TAGS);
+
+	auto [i, _] = ids.try_emplace(std::string{}, 0);
+	names.push_back(&i->first);
+}
+
+StatsTagId
+StatsTagRegistry::Intern(std::string_view name) noexcept
+{
+	{
+		const std::shared_lock lock{mutex};
+		if (auto i = ids.find(name); i != ids.end())
+			return i->second;
+	}
+
+	const std::scoped_lock lock{mutex};
+
+	if (names.size() >= max_tags) {
+		if (auto i = ids.find(name); i != ids.end())
+			/* another thread has interned it meanwhile */
+			return i->second;
+
+		if (!overflow) {
+			overflow = true;
+			logger.Fmt(2, "Too many distinct names (limit {}), counting new ones as empty, e.g. {:?}",
+				   max_tags, name);
+		}
+
+		return 0;
+	}
+
+	/* try_emplace() because another thread may have interned
+	   the same name meanwhile */
+	auto [i, inserted] = ids.try_emplace(std::string{name},
+					     static_cast<StatsTagId>(names.size()));
+	if (inserted)
+		names.push_back(&i->first);
+
+	return i->second;
+}
+
+std::string_view
+StatsTagRegistry::GetName(StatsTagId id) const noexcept
+{
+	const std::shared_lock lock{mutex};
+	assert(id < names.size());
+	return *names[id];
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "io/Logger.hxx"
+#include "util/TransparentHash.hxx"
+
+#include <cstdint>
+#include <functional> // for std::equal_to
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A small integer identifying a statistics tag (or a generator
+ * name).  It is obtained from StatsTagRegistry::Intern() and can be
+ * used as an array index.
+ */
+using StatsTagId = uint_least32_t;
+
+/**
+ * Interns statistics tag strings, i.e. assigns a #StatsTagId to each
+ * distinct string.  This is done once when a tag is first seen
+ * (e.g. when a translation response is applied), so the request path
+ * can count with an array index instead of looking up a string.
+ *
+ * Ids are never recycled.  This class is thread-safe.
+ */
+class StatsTagRegistry {
+	const LLogger logger;
+
+	const std::size_t max_tags;
+
+	mutable std::shared_mutex mutex;
+
+	std::unordered_map<std::string, StatsTagId,
+			   TransparentHash, std::equal_to<>> ids;
+
+	/**
+	 * Indexed by #StatsTagId, points to the keys of #ids (which
+	 * never move because the map is node based).
+	 */
+	std::vector<const std::string *> names;
+
+	/**
+	 * Has a new name been refused because #max_tags was reached?
+	 * This is used to log the condition only once.  Protected by
+	 * #mutex.
+	 */
+	bool overflow = false;
+
+public:
+	/**
+	 * The upper limit for the maximum number of distinct tags.
+	 */
+	static constexpr std::size_t MAX_TAGS = 65536;
+
+	/**
+	 * The empty string always has id 0.
+	 *
+	 * @param name a name for log messages
+	 * @param _max_tags the maximum number of distinct tags
+	 * (including the empty one); if this is exceeded, new tags
+	 * are counted as the empty tag
+	 */
+	explicit StatsTagRegistry(std::string_view name="stats_tag",
+				  std::size_t _max_tags=MAX_TAGS) noexcept;
+
+	StatsTagRegistry(const StatsTagRegistry &) = delete;
+	StatsTagRegistry &operator=(const StatsTagRegistry &) = delete;
+
+	/**
+	 * Look up the id of the given name, assigning a new one if
+	 * it has not been seen yet.
+	 */
+	StatsTagId Intern(std::string_view name) noexcept;
+
+	/**
+	 * Returns the name of the given id.  The returned view
+	 * remains valid for the lifetime of this object.
+	 */
+	[[gnu::pure]]
+	std::string_view GetName(StatsTagId id) const noexcept;
+};
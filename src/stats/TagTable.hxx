@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "TagRegistry.hxx"
+
+#include <array>
+#include <atomic>
+
+/**
+ * An array of #T indexed by #StatsTagId which grows on demand.  It
+ * is modified by only one thread (the owner of the #ThreadShards
+ * shard it lives in), but may be read by other threads; new chunks
+ * are published with release semantics and existing items never
+ * move.
+ */
+template<typename T>
+class StatsTagTable {
+	static constexpr std::size_t CHUNK_SIZE = 64;
+	static constexpr std::size_t N_CHUNKS =
+		(StatsTagRegistry::MAX_TAGS + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	struct Chunk {
+		std::array<T, CHUNK_SIZE> items;
+	};
+
+	std::array<std::atomic<Chunk *>, N_CHUNKS> chunks{};
+
+public:
+	StatsTagTable() noexcept = default;
+
+	~StatsTagTable() noexcept {
+		for (auto &i : chunks)
+			delete i.load(std::memory_order_relaxed);
+	}
+
+	StatsTagTable(const StatsTagTable &) = delete;
+	StatsTagTable &operator=(const StatsTagTable &) = delete;
+
+	/**
+	 * Returns the item for the given id, creating it if
+	 * necessary.  Must be called only by the owning thread.
+	 */
+	T &operator[](StatsTagId id) noexcept {
+		auto &slot = chunks[id / CHUNK_SIZE];
+		Chunk *chunk = slot.load(std::memory_order_relaxed);
+		if (chunk == nullptr) [[unlikely]] {
+			chunk = new Chunk();
+			slot.store(chunk, std::memory_order_release);
+		}
+
+		return chunk->items[id % CHUNK_SIZE];
+	}
+
+	/**
+	 * Invoke the given function with the id and a reference to
+	 * each item which may have been used.  May be called from any
+	 * thread.
+	 */
+	template<typename F>
+	void ForEach(F &&f) const noexcept {
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			const Chunk *chunk = chunks[i].load(std::memory_order_acquire);
+			if (chunk == nullptr)
+				continue;
+
+			for (std::size_t j = 0; j < CHUNK_SIZE; ++j)
+				f(static_cast<StatsTagId>(i * CHUNK_SIZE + j),
+				  chunk->items[j]);
+		}
+	}
+};
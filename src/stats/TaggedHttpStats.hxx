@@ -22,6 +22,13 @@ struct TaggedHttpStats {
 			     duration);
 	}
 
+	/**
+	 * Add the given (merged) counters to the specified tag.
+	 */
+	void Add(std::string_view tag, const HttpStats &stats) noexcept {
+		FindOrEmplace(tag) += stats;
+	}
+
 private:
 	[[gnu::pure]]
 	HttpStats &FindOrEmplace(std::string_view tag) noexcept {
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ThreadShards.hxx"
+
+static std::atomic_uint next_stats_thread_index;
+
+unsigned
+GetStatsThreadIndex() noexcept
+{
+	thread_local const unsigned index =
+		next_stats_thread_index.fetch_add(1, std::memory_order_relaxed);
+	return index;
+}
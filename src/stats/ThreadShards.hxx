@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+/**
+ * The maximum number of threads which may call
+ * ThreadShards::Local().
+ */
+static constexpr std::size_t MAX_STATS_THREADS = 64;
+
+/**
+ * Returns a small number identifying the calling thread.  It is
+ * assigned on the first call and is never recycled, therefore only
+ * long-lived threads (i.e. event loop threads) should record
+ * statistics.
+ */
+unsigned
+GetStatsThreadIndex() noexcept;
+
+/**
+ * Holds one instance of #T per thread.  Each thread modifies only
+ * its own shard (without locking); readers use ForEach() to merge
+ * all shards.  #T must be designed for this, e.g. by using
+ * #StatsCounter.
+ */
+template<typename T>
+class ThreadShards {
+	std::array<std::atomic<T *>, MAX_STATS_THREADS> shards{};
+
+public:
+	ThreadShards() noexcept = default;
+
+	~ThreadShards() noexcept {
+		for (auto &i : shards)
+			delete i.load(std::memory_order_relaxed);
+	}
+
+	ThreadShards(const ThreadShards &) = delete;
+	ThreadShards &operator=(const ThreadShards &) = delete;
+
+	/**
+	 * Returns the shard of the calling thread, creating it if
+	 * necessary.
+	 */
+	T &Local() noexcept {
+		const unsigned i = GetStatsThreadIndex();
+		assert(i < shards.size());
+
+		/* relaxed because only this thread ever stores to
+		   this slot */
+		T *shard = shards[i].load(std::memory_order_relaxed);
+		if (shard == nullptr) [[unlikely]] {
+			shard = new T();
+			shards[i].store(shard, std::memory_order_release);
+		}
+
+		return *shard;
+	}
+
+	/**
+	 * Invoke the given function for each existing shard.  May be
+	 * called from any thread.
+	 */
+	template<typename F>
+	void ForEach(F &&f) const noexcept {
+		for (const auto &i : shards)
+			if (const T *shard = i.load(std::memory_order_acquire))
+				f(*shard);
+	}
+};
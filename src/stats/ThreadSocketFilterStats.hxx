@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Metrics for #ThreadSocketFilter (e.g. TLS).
+ */
+struct ThreadSocketFilterStats {
+	/**
+	 * The number of filter runs which were executed
+	 * synchronously in the main thread.
+	 */
+	uint_least64_t n_inline_runs = 0;
+
+	/**
+	 * The number of filter runs which were offloaded to a worker
+	 * thread.
+	 */
+	uint_least64_t n_offloaded_runs = 0;
+};
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Metrics for #WorkerPool.
+ */
+struct WorkerPoolStats {
+	struct Worker {
+		/**
+		 * The number of jobs run by this worker.
+		 */
+		uint_least64_t n_jobs = 0;
+
+		/**
+		 * The number of jobs this worker has taken from
+		 * other workers' queues (subset of #n_jobs).
+		 */
+		uint_least64_t n_stolen = 0;
+
+		/**
+		 * The total time this worker has spent running jobs.
+		 */
+		std::chrono::steady_clock::duration busy{};
+
+		/**
+		 * The total time the jobs run by this worker have
+		 * waited in a queue.
+		 */
+		std::chrono::steady_clock::duration queue_wait{};
+
+		/**
+		 * The number of jobs currently waiting in this
+		 * worker's queue.
+		 */
+		unsigned n_waiting = 0;
+	};
+
+	std::vector<Worker> workers;
+};
@@ -63,24 +63,92 @@ stopwatch_is_enabled() noexcept;
 
 #else
 
+#include "trace/Span.hxx"
+#include "trace/Tracer.hxx"
+
+/**
+ * Without the "stopwatch" build option, this class feeds the
+ * sampled request tracer (see trace/Tracer.hxx): it points to a
+ * #TraceSpan only if the request has been sampled, which makes the
+ * unsampled case nearly free.
+ */
 class StopwatchPtr {
+protected:
+	TraceSpan *span = nullptr;
+
+	explicit StopwatchPtr(TraceSpan *_span) noexcept
+		:span(_span) {}
+
+	StopwatchPtr(std::string_view name,
+		     const char *suffix=nullptr) noexcept
+		:span(trace_should_sample()
+		      ? TraceSpan::NewRoot(name, suffix)
+		      : nullptr) {}
+
 public:
 	StopwatchPtr() = default;
 	StopwatchPtr(std::nullptr_t) noexcept {}
 
-	StopwatchPtr(std::string_view, const char * =nullptr) noexcept {}
+	StopwatchPtr(const StopwatchPtr &parent, std::string_view name,
+		     const char *suffix=nullptr) noexcept
+		:span(parent.span != nullptr
+		      ? TraceSpan::NewChild(*parent.span, name, suffix)
+		      : nullptr) {}
+
+	StopwatchPtr(const StopwatchPtr &src) noexcept
+		:span(src.span) {
+		if (span != nullptr)
+			span->Ref();
+	}
+
+	StopwatchPtr(StopwatchPtr &&src) noexcept
+		:span(std::exchange(src.span, nullptr)) {}
 
-	StopwatchPtr(const StopwatchPtr &, std::string_view,
-		     const char * =nullptr) noexcept {}
+	~StopwatchPtr() noexcept {
+		if (span != nullptr)
+			span->Unref();
+	}
+
+	StopwatchPtr &operator=(const StopwatchPtr &src) noexcept {
+		StopwatchPtr tmp(src);
+		std::swap(span, tmp.span);
+		return *this;
+	}
+
+	StopwatchPtr &operator=(StopwatchPtr &&src) noexcept {
+		StopwatchPtr tmp(std::move(src));
+		std::swap(span, tmp.span);
+		return *this;
+	}
 
 	operator bool() const noexcept {
-		return false;
+		return span != nullptr;
 	}
 
-	void RecordEvent(std::string_view) const noexcept {}
+	void RecordEvent(std::string_view name) const noexcept {
+		if (span != nullptr) [[unlikely]]
+			span->RecordEvent(name);
+	}
 };
 
-using RootStopwatchPtr = StopwatchPtr;
+class RootStopwatchPtr : public StopwatchPtr {
+public:
+	RootStopwatchPtr() = default;
+
+	RootStopwatchPtr(const char *name, const char *suffix=nullptr) noexcept
+		:StopwatchPtr(name, suffix) {}
+
+	/**
+	 * Continue a trace started by the peer (from a
+	 * "traceparent" request header).
+	 */
+	RootStopwatchPtr(const TraceContext &ctx, std::string_view name,
+			 const char *suffix=nullptr) noexcept
+		:StopwatchPtr(TraceSpan::NewRemoteChild(ctx, name, suffix)) {}
+
+	RootStopwatchPtr(RootStopwatchPtr &&) noexcept = default;
+	RootStopwatchPtr &operator=(RootStopwatchPtr &&) noexcept = default;
+};
 
 static inline void
 stopwatch_enable(UniqueFileDescriptor &&) noexcept
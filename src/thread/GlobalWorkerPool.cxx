@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "GlobalWorkerPool.hxx"
+#include "WorkerPool.hxx"
+
+#include <algorithm> // for std::clamp()
+#include <cassert>
+#include <thread>
+
+static WorkerPool *global_worker_pool;
+
+static bool volatile_worker_pool = false;
+
+static unsigned
+GetWorkerCount() noexcept
+{
+	return std::clamp(std::thread::hardware_concurrency(), 1U, 64U);
+}
+
+void
+worker_pool_set_volatile() noexcept
+{
+	volatile_worker_pool = true;
+
+	if (global_worker_pool != nullptr)
+		global_worker_pool->SetVolatile();
+}
+
+WorkerPool &
+worker_pool_get(EventLoop &event_loop)
+{
+	if (global_worker_pool == nullptr) {
+		auto *pool = new WorkerPool(event_loop, GetWorkerCount());
+
+		try {
+			pool->Start();
+		} catch (...) {
+			pool->Stop();
+			pool->Join();
+			delete pool;
+			throw;
+		}
+
+		if (volatile_worker_pool)
+			pool->SetVolatile();
+
+		global_worker_pool = pool;
+	}
+
+	assert(&global_worker_pool->GetEventLoop() == &event_loop);
+
+	return *global_worker_pool;
+}
+
+const WorkerPool *
+worker_pool_get_existing() noexcept
+{
+	return global_worker_pool;
+}
+
+void
+worker_pool_stop() noexcept
+{
+	if (global_worker_pool != nullptr)
+		global_worker_pool->Stop();
+}
+
+void
+worker_pool_join() noexcept
+{
+	if (global_worker_pool != nullptr)
+		global_worker_pool->Join();
+}
+
+void
+worker_pool_deinit() noexcept
+{
+	delete global_worker_pool;
+	global_worker_pool = nullptr;
+}
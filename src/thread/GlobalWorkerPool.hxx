@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * The process-wide #WorkerPool.
+ */
+
+#pragma once
+
+class EventLoop;
+class WorkerPool;
+
+/**
+ * Enable "volatile" mode: the pool does not keep the #EventLoop
+ * alive while there are no pending jobs.  This is useful for unit
+ * tests.
+ */
+void
+worker_pool_set_volatile() noexcept;
+
+/**
+ * Return the global #WorkerPool, creating it (and launching its
+ * threads) on the first call.
+ */
+WorkerPool &
+worker_pool_get(EventLoop &event_loop);
+
+/**
+ * Return the global #WorkerPool if it was already created, or
+ * nullptr.
+ */
+[[gnu::pure]]
+const WorkerPool *
+worker_pool_get_existing() noexcept;
+
+/**
+ * Ask all worker threads to exit.
+ */
+void
+worker_pool_stop() noexcept;
+
+/**
+ * Wait for all worker threads to exit.
+ */
+void
+worker_pool_join() noexcept;
+
+/**
+ * Free the global #WorkerPool (after worker_pool_join()).
+ */
+void
+worker_pool_deinit() noexcept;
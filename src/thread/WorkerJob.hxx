@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "util/IntrusiveList.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * A job which shall be run in a #WorkerPool thread.
+ */
+class WorkerJob {
+	friend class WorkerPool;
+
+	enum class State : uint_least8_t {
+		/**
+		 * The job is not in any queue.
+		 */
+		INITIAL,
+
+		/**
+		 * The job has been added to a worker's queue and waits
+		 * for a thread.
+		 */
+		WAITING,
+
+		/**
+		 * A worker thread is running the job.
+		 */
+		BUSY,
+
+		/**
+		 * The job has finished, but Done() has not been called
+		 * yet.
+		 */
+		DONE,
+	};
+
+	/**
+	 * Only the main thread changes the state from/to
+	 * #State::INITIAL; all other transitions are protected by the
+	 * mutex of the #home worker.
+	 */
+	std::atomic<State> state = State::INITIAL;
+
+	/**
+	 * Shall the job be run again after it finishes?  Set by
+	 * WorkerPool::Add() while the job is running.
+	 */
+	bool again = false;
+
+	static constexpr uint_least16_t NO_WORKER = UINT_LEAST16_MAX;
+
+	/**
+	 * The index of the worker whose queue (or "done" list) this
+	 * job is in.  Only changed by the main thread while the job
+	 * is idle.
+	 */
+	uint_least16_t home = NO_WORKER;
+
+	/**
+	 * The index of the worker which ran this job last.  The next
+	 * run is preferably scheduled on that worker, because its
+	 * CPU caches are still warm with this job's data.
+	 */
+	uint_least16_t last_worker = NO_WORKER;
+
+	/**
+	 * When was this job added to the queue?  Used to measure the
+	 * queue latency.
+	 */
+	std::chrono::steady_clock::time_point enqueue_time;
+
+	IntrusiveListHook<IntrusiveHookMode::NORMAL> worker_siblings;
+
+public:
+	WorkerJob() noexcept = default;
+
+	WorkerJob(const WorkerJob &) = delete;
+	WorkerJob &operator=(const WorkerJob &) = delete;
+
+	/**
+	 * Is this job neither queued nor running, nor waiting for
+	 * the Done() call?
+	 */
+	bool IsIdle() const noexcept {
+		return state.load(std::memory_order_relaxed) == State::INITIAL;
+	}
+
+	/**
+	 * Do the actual work.  This method is called in a worker
+	 * thread.
+	 */
+	virtual void Run() noexcept = 0;
+
+	/**
+	 * Called in the main thread after one or more Run() calls
+	 * have finished.
+	 */
+	virtual void Done() noexcept = 0;
+};
@@ -0,0 +1,420 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "WorkerPool.hxx"
+#include "stats/WorkerPoolStats.hxx"
+
+#include <cassert>
+#include <condition_variable>
+#include <thread>
+#include <utility> // for std::unreachable()
+
+#include <pthread.h>
+
+/**
+ * A job is submitted to the worker which ran it last only if that
+ * worker's queue is shorter than this; otherwise the affinity is
+ * ignored.
+ */
+static constexpr unsigned AFFINITY_QUEUE_LIMIT = 4;
+
+struct WorkerPool::Worker {
+	using JobList = IntrusiveList<
+		WorkerJob,
+		IntrusiveListMemberHookTraits<&WorkerJob::worker_siblings>>;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	/**
+	 * Jobs waiting to be run.  Protected by #mutex.
+	 */
+	JobList queue;
+
+	/**
+	 * Jobs which have finished and wait for the Done() call in
+	 * the main thread.  Protected by #mutex.
+	 */
+	JobList done;
+
+	std::thread thread;
+
+	/**
+	 * The number of jobs in #queue (a copy which can be read
+	 * without holding the mutex).
+	 */
+	std::atomic_uint n_waiting{0};
+
+	/**
+	 * Is this worker waiting on #cond?  Protected by #mutex.
+	 */
+	std::atomic_bool sleeping{false};
+
+	uint_least16_t index;
+
+	/**
+	 * Remove the first job from #queue.  Caller must hold
+	 * #mutex.
+	 */
+	WorkerJob &PopWaiting() noexcept {
+		auto &job = queue.front();
+		queue.pop_front();
+		n_waiting.fetch_sub(1, std::memory_order_relaxed);
+		job.state = WorkerJob::State::BUSY;
+		return job;
+	}
+
+	/* statistics, written only by this worker's thread */
+	std::atomic<uint_least64_t> n_jobs{0}, n_stolen{0};
+	std::atomic<std::chrono::steady_clock::rep> busy{0}, queue_wait{0};
+};
+
+WorkerPool::WorkerPool(EventLoop &_event_loop, unsigned _n_workers) noexcept
+	:event_loop(_event_loop),
+	 notify(event_loop, BIND_THIS_METHOD(OnNotify)),
+	 workers(std::make_unique<Worker[]>(_n_workers)),
+	 n_workers(_n_workers)
+{
+	assert(n_workers > 0);
+	assert(n_workers < WorkerJob::NO_WORKER);
+
+	for (unsigned i = 0; i < n_workers; ++i)
+		workers[i].index = i;
+}
+
+WorkerPool::~WorkerPool() noexcept
+{
+	for (unsigned i = 0; i < n_workers; ++i)
+		assert(!workers[i].thread.joinable());
+
+	notify.Disable();
+}
+
+void
+WorkerPool::SetVolatile() noexcept
+{
+	volatile_notify = true;
+
+	if (n_pending == 0)
+		notify.Disable();
+}
+
+inline void
+WorkerPool::AddPending() noexcept
+{
+	if (n_pending++ == 0 && volatile_notify)
+		notify.Enable();
+}
+
+inline void
+WorkerPool::RemovePending() noexcept
+{
+	assert(n_pending > 0);
+
+	if (--n_pending == 0 && volatile_notify)
+		notify.Disable();
+}
+
+void
+WorkerPool::Start()
+{
+	for (unsigned i = 0; i < n_workers; ++i) {
+		auto &worker = workers[i];
+		worker.thread = std::thread{&WorkerPool::WorkerFunc, this, std::ref(worker)};
+		pthread_setname_np(worker.thread.native_handle(), "worker");
+	}
+}
+
+void
+WorkerPool::Stop() noexcept
+{
+	stopping.store(true);
+
+	for (unsigned i = 0; i < n_workers; ++i) {
+		auto &worker = workers[i];
+		const std::scoped_lock lock{worker.mutex};
+		worker.cond.notify_one();
+	}
+}
+
+void
+WorkerPool::Join() noexcept
+{
+	for (unsigned i = 0; i < n_workers; ++i)
+		if (workers[i].thread.joinable())
+			workers[i].thread.join();
+}
+
+inline uint_least16_t
+WorkerPool::PickWorker(const WorkerJob &job) noexcept
+{
+	if (job.last_worker != WorkerJob::NO_WORKER &&
+	    workers[job.last_worker].n_waiting.load(std::memory_order_relaxed) < AFFINITY_QUEUE_LIMIT)
+		return job.last_worker;
+
+	const auto result = next_worker;
+	next_worker = (next_worker + 1) % n_workers;
+	return result;
+}
+
+inline bool
+WorkerPool::Enqueue(Worker &home, WorkerJob &job) noexcept
+{
+	assert(job.home == home.index);
+
+	job.state = WorkerJob::State::WAITING;
+	job.enqueue_time = std::chrono::steady_clock::now();
+	home.queue.push_back(job);
+	home.n_waiting.fetch_add(1, std::memory_order_relaxed);
+	n_waiting.fetch_add(1);
+
+	return home.sleeping.load();
+}
+
+void
+WorkerPool::WakeIdleWorker(const Worker &except) noexcept
+{
+	for (unsigned i = 1; i < n_workers; ++i) {
+		auto &worker = workers[(except.index + i) % n_workers];
+		if (!worker.sleeping.load())
+			continue;
+
+		const std::scoped_lock lock{worker.mutex};
+		if (worker.sleeping.load()) {
+			worker.cond.notify_one();
+			break;
+		}
+	}
+}
+
+void
+WorkerPool::Add(WorkerJob &job) noexcept
+{
+	bool wake_home = false;
+
+	if (job.IsIdle()) {
+		AddPending();
+
+		job.home = PickWorker(job);
+		auto &home = workers[job.home];
+
+		const std::scoped_lock lock{home.mutex};
+		wake_home = Enqueue(home, job);
+	} else {
+		auto &home = workers[job.home];
+
+		const std::scoped_lock lock{home.mutex};
+		switch (job.state.load(std::memory_order_relaxed)) {
+		case WorkerJob::State::INITIAL:
+			std::unreachable();
+
+		case WorkerJob::State::WAITING:
+			/* already queued */
+			return;
+
+		case WorkerJob::State::BUSY:
+			/* run it again after it finishes */
+			job.again = true;
+			return;
+
+		case WorkerJob::State::DONE:
+			/* finished, but Done() was not called yet;
+			   queue it again (and call Done() only after
+			   the next run) */
+			home.done.erase(home.done.iterator_to(job));
+			wake_home = Enqueue(home, job);
+			break;
+		}
+	}
+
+	auto &home = workers[job.home];
+	if (wake_home) {
+		const std::scoped_lock lock{home.mutex};
+		home.cond.notify_one();
+	} else
+		/* the home worker is busy; maybe somebody else has
+		   time to steal this job */
+		WakeIdleWorker(home);
+}
+
+bool
+WorkerPool::Cancel(WorkerJob &job) noexcept
+{
+	if (job.IsIdle())
+		return true;
+
+	auto &home = workers[job.home];
+	const std::scoped_lock lock{home.mutex};
+
+	switch (job.state.load(std::memory_order_relaxed)) {
+	case WorkerJob::State::INITIAL:
+		std::unreachable();
+
+	case WorkerJob::State::WAITING:
+		home.queue.erase(home.queue.iterator_to(job));
+		home.n_waiting.fetch_sub(1, std::memory_order_relaxed);
+		n_waiting.fetch_sub(1);
+		break;
+
+	case WorkerJob::State::BUSY:
+		/* too late, but at least don't run it again */
+		job.again = false;
+		return false;
+
+	case WorkerJob::State::DONE:
+		home.done.erase(home.done.iterator_to(job));
+		break;
+	}
+
+	job.state = WorkerJob::State::INITIAL;
+	RemovePending();
+	return true;
+}
+
+WorkerJob *
+WorkerPool::Steal(Worker &thief) noexcept
+{
+	for (unsigned i = 1; i < n_workers; ++i) {
+		auto &victim = workers[(thief.index + i) % n_workers];
+		if (victim.n_waiting.load(std::memory_order_relaxed) == 0)
+			continue;
+
+		const std::scoped_lock lock{victim.mutex};
+		if (victim.queue.empty())
+			continue;
+
+		/* steal the oldest job; it has waited the longest */
+		auto &job = victim.PopWaiting();
+		n_waiting.fetch_sub(1);
+		thief.n_stolen.fetch_add(1, std::memory_order_relaxed);
+		return &job;
+	}
+
+	return nullptr;
+}
+
+WorkerJob *
+WorkerPool::Take(Worker &worker) noexcept
+{
+	while (true) {
+		{
+			const std::scoped_lock lock{worker.mutex};
+			if (stopping.load())
+				return nullptr;
+
+			if (!worker.queue.empty()) {
+				auto &job = worker.PopWaiting();
+				n_waiting.fetch_sub(1);
+				return &job;
+			}
+		}
+
+		if (auto *job = Steal(worker))
+			return job;
+
+		std::unique_lock lock{worker.mutex};
+		if (stopping.load() || !worker.queue.empty())
+			continue;
+
+		/* announce that we're going to sleep, then check
+		   (again) whether there is anything to steal; Add()
+		   does the opposite, therefore no wakeup is lost */
+		worker.sleeping.store(true);
+		if (n_waiting.load() == 0)
+			worker.cond.wait(lock);
+		worker.sleeping.store(false);
+	}
+}
+
+inline void
+WorkerPool::RunJob(Worker &worker, WorkerJob &job) noexcept
+{
+	const auto start = std::chrono::steady_clock::now();
+	worker.queue_wait.fetch_add((start - job.enqueue_time).count(),
+				    std::memory_order_relaxed);
+
+	job.last_worker = worker.index;
+	job.Run();
+
+	worker.busy.fetch_add((std::chrono::steady_clock::now() - start).count(),
+			      std::memory_order_relaxed);
+	worker.n_jobs.fetch_add(1, std::memory_order_relaxed);
+
+	/* the job may have been stolen from another worker; its
+	   state is protected by the home worker's mutex */
+	auto &home = workers[job.home];
+	bool again, wake_home = false;
+
+	{
+		const std::scoped_lock lock{home.mutex};
+
+		again = job.again;
+		if (again) {
+			job.again = false;
+			wake_home = Enqueue(home, job);
+		} else {
+			job.state = WorkerJob::State::DONE;
+			home.done.push_back(job);
+		}
+	}
+
+	if (!again) {
+		notify.Signal();
+	} else if (wake_home) {
+		const std::scoped_lock lock{home.mutex};
+		home.cond.notify_one();
+	}
+}
+
+void
+WorkerPool::WorkerFunc(Worker &worker) noexcept
+{
+	while (auto *job = Take(worker))
+		RunJob(worker, *job);
+}
+
+void
+WorkerPool::OnNotify() noexcept
+{
+	for (unsigned i = 0; i < n_workers; ++i) {
+		auto &worker = workers[i];
+
+		while (true) {
+			WorkerJob *job;
+
+			{
+				/* pop only one job at a time, because
+				   Done() may cancel or delete other
+				   jobs */
+				const std::scoped_lock lock{worker.mutex};
+				if (worker.done.empty())
+					break;
+
+				job = &worker.done.front();
+				worker.done.pop_front();
+				job->state = WorkerJob::State::INITIAL;
+			}
+
+			RemovePending();
+			job->Done();
+		}
+	}
+}
+
+void
+WorkerPool::GetStats(WorkerPoolStats &stats) const noexcept
+{
+	stats.workers.resize(n_workers);
+
+	for (unsigned i = 0; i < n_workers; ++i) {
+		const auto &src = workers[i];
+		auto &dest = stats.workers[i];
+
+		dest.n_jobs = src.n_jobs.load(std::memory_order_relaxed);
+		dest.n_stolen = src.n_stolen.load(std::memory_order_relaxed);
+		dest.busy = std::chrono::steady_clock::duration{src.busy.load(std::memory_order_relaxed)};
+		dest.queue_wait = std::chrono::steady_clock::duration{src.queue_wait.load(std::memory_order_relaxed)};
+		dest.n_waiting = src.n_waiting.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "WorkerJob.hxx"
+#include "thread/Notify.hxx"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+class EventLoop;
+struct WorkerPoolStats;
+
+/**
+ * A pool of worker threads which run #WorkerJob instances.
+ *
+ * Unlike a single shared queue, each worker has its own queue
+ * protected by its own mutex, so submitting and fetching jobs
+ * rarely contends.  A job is submitted preferably to the worker
+ * which ran it last ("soft affinity"), which keeps the job's data
+ * (e.g. the OpenSSL state of a connection) in that CPU's caches.
+ * Idle workers steal jobs from the queues of busy workers.
+ *
+ * All public methods except for the constructor must be called
+ * from the main thread (the thread of the #EventLoop).
+ */
+class WorkerPool {
+	struct Worker;
+
+	EventLoop &event_loop;
+
+	/**
+	 * Wakes up the main thread to call WorkerJob::Done().
+	 */
+	Notify notify;
+
+	const std::unique_ptr<Worker[]> workers;
+
+	const uint_least16_t n_workers;
+
+	/**
+	 * The next worker for jobs without affinity (round-robin).
+	 */
+	uint_least16_t next_worker = 0;
+
+	/**
+	 * The number of jobs which are not idle.  Only accessed by
+	 * the main thread.
+	 */
+	unsigned n_pending = 0;
+
+	/**
+	 * The total number of jobs waiting in all queues.  Idle
+	 * workers check this before going to sleep.
+	 */
+	std::atomic_uint n_waiting{0};
+
+	std::atomic_bool stopping{false};
+
+	/**
+	 * If true, then #notify is only enabled while there are
+	 * pending jobs, so the #EventLoop can finish when there is
+	 * nothing else to do (for unit tests).
+	 */
+	bool volatile_notify = false;
+
+public:
+	/**
+	 * @param n_workers the number of worker threads (at least 1)
+	 */
+	WorkerPool(EventLoop &_event_loop, unsigned n_workers) noexcept;
+
+	/**
+	 * The threads must have been joined already (see Join()).
+	 */
+	~WorkerPool() noexcept;
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	EventLoop &GetEventLoop() const noexcept {
+		return event_loop;
+	}
+
+	unsigned GetWorkerCount() const noexcept {
+		return n_workers;
+	}
+
+	/**
+	 * Enable "volatile" mode (see #volatile_notify).
+	 */
+	void SetVolatile() noexcept;
+
+	/**
+	 * Launch the worker threads.
+	 *
+	 * Throws on error.
+	 */
+	void Start();
+
+	/**
+	 * Ask all worker threads to exit as soon as they have
+	 * finished their current job.  Jobs which are still waiting
+	 * in a queue will never run.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Wait for all worker threads to exit (after Stop()).
+	 */
+	void Join() noexcept;
+
+	/**
+	 * Schedule a Run() call.  If the job is already waiting,
+	 * this is a no-op; if it is running right now, it will be
+	 * run again afterwards.
+	 */
+	void Add(WorkerJob &job) noexcept;
+
+	/**
+	 * Cancel the job.
+	 *
+	 * @return true if the job is idle now (and Done() will not
+	 * be called), false if it is running right now
+	 */
+	bool Cancel(WorkerJob &job) noexcept;
+
+	void GetStats(WorkerPoolStats &stats) const noexcept;
+
+private:
+	/**
+	 * Choose the queue for a new job submission.
+	 */
+	[[gnu::pure]]
+	uint_least16_t PickWorker(const WorkerJob &job) noexcept;
+
+	/**
+	 * Append the job to the queue of its #home worker and wake
+	 * up a thread.  Caller must hold the mutex of that worker.
+	 *
+	 * @return true if the home worker is sleeping and needs to
+	 * be notified by the caller (after releasing the mutex)
+	 */
+	bool Enqueue(Worker &home, WorkerJob &job) noexcept;
+
+	/**
+	 * A job has transitioned from idle to pending.
+	 */
+	void AddPending() noexcept;
+
+	/**
+	 * A job has transitioned from pending to idle.
+	 */
+	void RemovePending() noexcept;
+
+	/**
+	 * Wake up one sleeping worker (other than the given one) so
+	 * it can steal a job.
+	 */
+	void WakeIdleWorker(const Worker &except) noexcept;
+
+	/**
+	 * Obtain the next job for the given worker thread; blocks
+	 * until one is available.
+	 *
+	 * @return nullptr if the pool is being stopped
+	 */
+	WorkerJob *Take(Worker &worker) noexcept;
+
+	/**
+	 * Take a job from another worker's queue.
+	 */
+	WorkerJob *Steal(Worker &thief) noexcept;
+
+	void RunJob(Worker &worker, WorkerJob &job) noexcept;
+
+	/**
+	 * The function of each worker thread.
+	 */
+	void WorkerFunc(Worker &worker) noexcept;
+
+	/**
+	 * Called by #notify in the main thread.
+	 */
+	void OnNotify() noexcept;
+};
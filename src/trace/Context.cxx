@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Context.hxx"
+#include "util/CharUtil.hxx"
+
+static constexpr int
+ParseHexDigit(char ch) noexcept
+{
+	if (IsDigitASCII(ch))
+		return ch - '0';
+	else if (ch >= 'a' && ch <= 'f')
+		return ch - 'a' + 10;
+	else
+		/* upper case is not allowed by the specification */
+		return -1;
+}
+
+static constexpr bool
+ParseHexBytes(std::string_view s, uint8_t *dest) noexcept
+{
+	for (std::size_t i = 0; i < s.size(); i += 2) {
+		const int hi = ParseHexDigit(s[i]), lo = ParseHexDigit(s[i + 1]);
+		if (hi < 0 || lo < 0)
+			return false;
+
+		*dest++ = (hi << 4) | lo;
+	}
+
+	return true;
+}
+
+template<std::size_t N>
+static constexpr bool
+IsAllZero(const std::array<uint8_t, N> &a) noexcept
+{
+	for (const auto i : a)
+		if (i != 0)
+			return false;
+	return true;
+}
+
+std::optional<TraceContext>
+ParseTraceParent(std::string_view s) noexcept
+{
+	/* "00-<32 hex trace id>-<16 hex parent id>-<2 hex flags>" */
+	if (s.size() != 55 || s[2] != '-' || s[35] != '-' || s[52] != '-' ||
+	    !s.starts_with("00"))
+		return std::nullopt;
+
+	TraceContext ctx;
+	if (!ParseHexBytes(s.substr(3, 32), ctx.trace_id.data()) ||
+	    IsAllZero(ctx.trace_id))
+		return std::nullopt;
+
+	std::array<uint8_t, 8> parent;
+	if (!ParseHexBytes(s.substr(36, 16), parent.data()) ||
+	    IsAllZero(parent))
+		return std::nullopt;
+
+	ctx.parent_span_id = 0;
+	for (const auto i : parent)
+		ctx.parent_span_id = (ctx.parent_span_id << 8) | i;
+
+	uint8_t flags;
+	if (!ParseHexBytes(s.substr(53, 2), &flags))
+		return std::nullopt;
+
+	ctx.sampled = (flags & 0x01) != 0;
+	return ctx;
+}
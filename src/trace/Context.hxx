@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Record.hxx"
+
+#include <optional>
+#include <string_view>
+
+/**
+ * The parsed value of a W3C "traceparent" header.
+ */
+struct TraceContext {
+	TraceId trace_id;
+
+	uint64_t parent_span_id;
+
+	/**
+	 * Has the caller decided to sample this trace?
+	 */
+	bool sampled;
+};
+
+/**
+ * Parse a "traceparent" header (W3C Trace Context, version 00).
+ *
+ * @return std::nullopt if the header is malformed
+ */
+[[gnu::pure]]
+std::optional<TraceContext>
+ParseTraceParent(std::string_view s) noexcept;
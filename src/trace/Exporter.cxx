@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Exporter.hxx"
+#include "OtlpJson.hxx"
+#include "Tracer.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "net/LocalSocketAddress.hxx"
+#include "net/SocketError.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "io/Logger.hxx"
+#include "util/SpanCast.hxx"
+
+#include <cerrno>
+#include <cstring> // for strerror()
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+static constexpr Event::Duration EXPORT_INTERVAL = std::chrono::seconds{1};
+
+static UniqueFileDescriptor
+OpenTraceOutput(const char *path)
+{
+	if (struct stat st; stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		UniqueSocketDescriptor s;
+		if (!s.Create(AF_LOCAL, SOCK_STREAM, 0))
+			throw MakeSocketError("Failed to create socket");
+
+		if (!s.Connect(LocalSocketAddress{path}))
+			throw FmtSocketError("Failed to connect to {:?}", path);
+
+		/* never block the event loop if the collector
+		   stalls */
+		s.SetNonBlocking();
+
+		return std::move(s).MoveToFileDescriptor();
+	}
+
+	UniqueFileDescriptor fd;
+	if (!fd.Open(path, O_WRONLY|O_CREAT|O_APPEND, 0640))
+		throw FmtErrno("Failed to open {:?}", path);
+
+	return fd;
+}
+
+TraceExporter::TraceExporter(EventLoop &event_loop, const char *path,
+			     std::string_view _service_name)
+	:service_name(_service_name),
+	 fd(OpenTraceOutput(path)),
+	 timer(event_loop, BIND_THIS_METHOD(OnTimer))
+{
+	timer.Schedule(EXPORT_INTERVAL);
+}
+
+TraceExporter::~TraceExporter() noexcept
+{
+	Flush();
+}
+
+void
+TraceExporter::Flush() noexcept
+{
+	records.clear();
+
+	trace_for_each_buffer([](TraceBuffer &b, void *ctx){
+		auto &dest = *(std::vector<TraceRecord> *)ctx;
+		b.ConsumeAll([&dest](const TraceRecord &r){
+			dest.push_back(r);
+		});
+	}, &records);
+
+	if (!fd.IsDefined())
+		return;
+
+	if (!buffer.empty()) {
+		/* the previous line was written only partially; it
+		   must be completed before the next one */
+		if (!WriteBuffer())
+			return;
+
+		if (!buffer.empty()) {
+			if (!records.empty())
+				LogFmt(3, "trace", "Trace output is stalled, dropping {} spans",
+				       records.size());
+			return;
+		}
+	}
+
+	if (records.empty())
+		return;
+
+	FormatOtlpJson(buffer, service_name, records);
+
+	const std::size_t size = buffer.size();
+	if (!WriteBuffer())
+		return;
+
+	if (buffer.size() == size) {
+		/* nothing was written (EAGAIN): drop this batch
+		   instead of blocking the event loop */
+		buffer.clear();
+		LogFmt(3, "trace", "Trace output is stalled, dropping {} spans",
+		       records.size());
+	}
+}
+
+bool
+TraceExporter::WriteBuffer() noexcept
+{
+	std::span<const std::byte> src = AsBytes(buffer);
+	while (!src.empty()) {
+		const auto nbytes = fd.Write(src);
+		if (nbytes < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN)
+				break;
+
+			LogConcat(2, "trace", "Failed to write trace: ",
+				  strerror(errno));
+			fd.Close();
+			buffer.clear();
+			return false;
+		}
+
+		src = src.subspan(nbytes);
+	}
+
+	buffer.erase(0, buffer.size() - src.size());
+	return true;
+}
+
+void
+TraceExporter::OnTimer() noexcept
+{
+	Flush();
+	timer.Schedule(EXPORT_INTERVAL);
+}
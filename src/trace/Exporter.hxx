@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Record.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <string>
+#include <vector>
+
+/**
+ * Periodically collects the spans from all #TraceBuffer instances
+ * and writes them as OTLP/JSON lines to a file or to a local
+ * socket.  The socket is non-blocking; if the peer does not read
+ * quickly enough, spans are dropped instead of blocking the event
+ * loop.
+ */
+class TraceExporter final {
+	const std::string service_name;
+
+	UniqueFileDescriptor fd;
+
+	CoarseTimerEvent timer;
+
+	/**
+	 * Records collected by OnTimer(); a member to reuse the
+	 * allocation.
+	 */
+	std::vector<TraceRecord> records;
+
+	/**
+	 * Formatted output which has not yet been written.  If it is
+	 * not empty after Flush(), it is the rest of a line which
+	 * could only be written partially.
+	 */
+	std::string buffer;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param path the path of a regular file (which is appended
+	 * to) or of a local stream socket (e.g. an OpenTelemetry
+	 * Collector)
+	 */
+	TraceExporter(EventLoop &event_loop, const char *path,
+		      std::string_view _service_name);
+
+	~TraceExporter() noexcept;
+
+	TraceExporter(const TraceExporter &) = delete;
+	TraceExporter &operator=(const TraceExporter &) = delete;
+
+	/**
+	 * Export all pending spans now.
+	 */
+	void Flush() noexcept;
+
+private:
+	/**
+	 * Write as much of #buffer as possible without blocking and
+	 * remove the written part from it.
+	 *
+	 * @return false on error (#fd has been closed)
+	 */
+	bool WriteBuffer() noexcept;
+
+	void OnTimer() noexcept;
+};
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "OtlpJson.hxx"
+
+#include <fmt/format.h>
+
+#include <iterator> // for std::back_inserter()
+
+static void
+AppendJsonString(std::string &dest, std::string_view s) noexcept
+{
+	dest.push_back('"');
+
+	for (const char ch : s) {
+		switch (ch) {
+		case '"':
+			dest.append("\\\"");
+			break;
+
+		case '\\':
+			dest.append("\\\\");
+			break;
+
+		default:
+			if (static_cast<unsigned char>(ch) < 0x20)
+				fmt::format_to(std::back_inserter(dest),
+					       "\\u{:04x}", static_cast<unsigned>(ch));
+			else
+				dest.push_back(ch);
+		}
+	}
+
+	dest.push_back('"');
+}
+
+static void
+AppendTraceId(std::string &dest, const TraceId &id) noexcept
+{
+	dest.push_back('"');
+	for (const auto i : id)
+		fmt::format_to(std::back_inserter(dest), "{:02x}", i);
+	dest.push_back('"');
+}
+
+static void
+AppendSpan(std::string &dest, const TraceRecord &span,
+	   std::span<const TraceRecord> events) noexcept
+{
+	dest.append(R"({"traceId":)");
+	AppendTraceId(dest, span.trace_id);
+	fmt::format_to(std::back_inserter(dest), R"(,"spanId":"{:016x}")",
+		       span.span_id);
+	if (span.parent_span_id != 0)
+		fmt::format_to(std::back_inserter(dest),
+			       R"(,"parentSpanId":"{:016x}")",
+			       span.parent_span_id);
+
+	dest.append(R"(,"name":)");
+	AppendJsonString(dest, span.GetName());
+
+	/* 64 bit integers are strings in OTLP/JSON */
+	fmt::format_to(std::back_inserter(dest),
+		       R"(,"kind":{},"startTimeUnixNano":"{}","endTimeUnixNano":"{}")",
+		       static_cast<unsigned>(span.kind),
+		       span.start_ns, span.end_ns);
+
+	if (!events.empty()) {
+		dest.append(R"(,"events":[)");
+
+		bool first = true;
+		for (const auto &event : events) {
+			if (!first)
+				dest.push_back(',');
+			first = false;
+
+			fmt::format_to(std::back_inserter(dest),
+				       R"({{"timeUnixNano":"{}","name":)",
+				       event.start_ns);
+			AppendJsonString(dest, event.GetName());
+			dest.push_back('}');
+		}
+
+		dest.push_back(']');
+	}
+
+	dest.push_back('}');
+}
+
+void
+FormatOtlpJson(std::string &dest, std::string_view service_name,
+	       std::span<const TraceRecord> records) noexcept
+{
+	dest.append(R"({"resourceSpans":[{"resource":{"attributes":[{"key":"service.name","value":{"stringValue":)");
+	AppendJsonString(dest, service_name);
+	dest.append(R"(}}]},"scopeSpans":[{"scope":{"name":"beng-proxy"},"spans":[)");
+
+	bool first = true;
+	while (!records.empty()) {
+		const auto &span = records.front();
+		records = records.subspan(1);
+
+		if (span.type != TraceRecord::Type::SPAN)
+			/* orphaned event (should not happen) */
+			continue;
+
+		std::size_t n_events = std::min<std::size_t>(span.n_events,
+							     records.size());
+
+		if (!first)
+			dest.push_back(',');
+		first = false;
+
+		AppendSpan(dest, span, records.first(n_events));
+		records = records.subspan(n_events);
+	}
+
+	dest.append("]}]}]}\n");
+}
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Record.hxx"
+
+#include <span>
+#include <string>
+#include <string_view>
+
+/**
+ * Format a list of records (as submitted by #TraceSpan) as one
+ * OTLP/JSON "ExportTraceServiceRequest" object on a single line
+ * (terminated with a newline).  This is the format read by the
+ * OpenTelemetry Collector's "otlpjsonfile" receiver.
+ *
+ * @param service_name the "service.name" resource attribute
+ */
+void
+FormatOtlpJson(std::string &dest, std::string_view service_name,
+	       std::span<const TraceRecord> records) noexcept;
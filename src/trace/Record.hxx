@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * A 128 bit trace id (W3C Trace Context / OpenTelemetry).
+ */
+using TraceId = std::array<uint8_t, 16>;
+
+/**
+ * One fixed-size binary record in a #TraceRing.  A span is
+ * submitted as one #Type::SPAN record followed by #n_events
+ * #Type::EVENT records.
+ */
+struct TraceRecord {
+	enum class Type : uint8_t {
+		SPAN,
+		EVENT,
+	};
+
+	enum class Kind : uint8_t {
+		INTERNAL = 1,
+		SERVER = 2,
+	};
+
+	/**
+	 * Only used for #Type::SPAN.
+	 */
+	TraceId trace_id;
+
+	uint64_t span_id;
+
+	/**
+	 * Zero for root spans.  Only used for #Type::SPAN.
+	 */
+	uint64_t parent_span_id;
+
+	/**
+	 * Nanoseconds since the Unix epoch.  For #Type::EVENT, this
+	 * is the time of the event.
+	 */
+	uint64_t start_ns;
+
+	/**
+	 * Nanoseconds since the Unix epoch.  Only used for
+	 * #Type::SPAN.
+	 */
+	uint64_t end_ns;
+
+	Type type;
+
+	Kind kind;
+
+	/**
+	 * The number of #Type::EVENT records following this
+	 * #Type::SPAN record.
+	 */
+	uint8_t n_events;
+
+	/**
+	 * Null-terminated, truncated if necessary.
+	 */
+	char name[77];
+
+	void SetName(std::string_view _name, const char *suffix=nullptr) noexcept;
+
+	std::string_view GetName() const noexcept {
+		return name;
+	}
+};
+
+static_assert(sizeof(TraceRecord) == 128);
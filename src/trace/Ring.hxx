@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Record.hxx"
+
+#include <algorithm> // for std::copy()
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <span>
+
+/**
+ * A lock-free single-producer/single-consumer ring buffer of
+ * #TraceRecord instances.  The producer is the event loop thread
+ * which owns this object; the consumer is the #TraceExporter.  If
+ * the ring is full, new records are dropped (and counted).
+ */
+template<std::size_t N>
+class TraceRing {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+	std::array<TraceRecord, N> records;
+
+	/**
+	 * The number of records ever pushed; only modified by the
+	 * producer.
+	 */
+	alignas(64) std::atomic_size_t head{0};
+
+	/**
+	 * The number of records ever consumed; only modified by the
+	 * consumer.
+	 */
+	alignas(64) std::atomic_size_t tail{0};
+
+	std::atomic_uint_least64_t dropped{0};
+
+public:
+	/**
+	 * Push a group of records.  Either all of them are pushed or
+	 * none (so a span never gets separated from its events).
+	 * Producer only.
+	 *
+	 * @return false if there was not enough room
+	 */
+	bool Push(std::span<const TraceRecord> src) noexcept {
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		const std::size_t t = tail.load(std::memory_order_acquire);
+		if (N - (h - t) < src.size()) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		std::size_t i = h;
+		for (const auto &r : src)
+			records[i++ % N] = r;
+
+		head.store(i, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Invoke the given function for all records which are
+	 * currently in the ring and remove them.  Consumer only.
+	 *
+	 * @return the number of records
+	 */
+	template<typename F>
+	std::size_t ConsumeAll(F &&f) noexcept {
+		std::size_t t = tail.load(std::memory_order_relaxed);
+		const std::size_t h = head.load(std::memory_order_acquire);
+		const std::size_t n = h - t;
+
+		for (; t != h; ++t)
+			f(records[t % N]);
+
+		tail.store(t, std::memory_order_release);
+		return n;
+	}
+
+	/**
+	 * The number of spans which were dropped because the ring was
+	 * full.
+	 */
+	uint_least64_t GetDropped() const noexcept {
+		return dropped.load(std::memory_order_relaxed);
+	}
+};
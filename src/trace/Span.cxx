@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Span.hxx"
+#include "Context.hxx"
+#include "Tracer.hxx"
+
+#include <algorithm> // for std::min()
+#include <span>
+
+#include <string.h>
+
+void
+TraceRecord::SetName(std::string_view _name, const char *suffix) noexcept
+{
+	std::size_t length = std::min(_name.size(), sizeof(name) - 1);
+	memcpy(name, _name.data(), length);
+
+	if (suffix != nullptr) {
+		const std::size_t suffix_length =
+			std::min(strlen(suffix), sizeof(name) - 1 - length);
+		memcpy(name + length, suffix, suffix_length);
+		length += suffix_length;
+	}
+
+	name[length] = 0;
+}
+
+inline TraceSpan *
+TraceSpan::New(const TraceId &trace_id, uint64_t parent_span_id,
+	       TraceRecord::Kind kind,
+	       std::string_view name, const char *suffix) noexcept
+{
+	auto *span = new TraceSpan();
+	auto &r = span->records[0];
+	r.type = TraceRecord::Type::SPAN;
+	r.kind = kind;
+	r.trace_id = trace_id;
+	r.span_id = trace_generate_span_id();
+	r.parent_span_id = parent_span_id;
+	r.start_ns = trace_now();
+	r.SetName(name, suffix);
+	return span;
+}
+
+TraceSpan *
+TraceSpan::NewRoot(std::string_view name, const char *suffix) noexcept
+{
+	return New(trace_generate_trace_id(), 0, TraceRecord::Kind::SERVER,
+		   name, suffix);
+}
+
+TraceSpan *
+TraceSpan::NewRemoteChild(const TraceContext &ctx,
+			  std::string_view name, const char *suffix) noexcept
+{
+	return New(ctx.trace_id, ctx.parent_span_id, TraceRecord::Kind::SERVER,
+		   name, suffix);
+}
+
+TraceSpan *
+TraceSpan::NewChild(const TraceSpan &parent,
+		    std::string_view name, const char *suffix) noexcept
+{
+	const auto &p = parent.records[0];
+	return New(p.trace_id, p.span_id, TraceRecord::Kind::INTERNAL,
+		   name, suffix);
+}
+
+void
+TraceSpan::RecordEvent(std::string_view name) noexcept
+{
+	if (n_events >= MAX_EVENTS)
+		/* array is full, do not record any more events */
+		return;
+
+	auto &r = records[1 + n_events++];
+	r.type = TraceRecord::Type::EVENT;
+	r.span_id = records[0].span_id;
+	r.start_ns = trace_now();
+	r.SetName(name);
+}
+
+void
+TraceSpan::Finish() noexcept
+{
+	auto &r = records[0];
+	r.end_ns = trace_now();
+	r.n_events = n_events;
+
+	trace_local_buffer().Push(std::span{records, 1U + n_events});
+
+	delete this;
+}
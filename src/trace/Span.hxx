@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Record.hxx"
+
+#include <cstddef>
+#include <string_view>
+
+struct TraceContext;
+
+/**
+ * A span of a sampled request.  It is only allocated for sampled
+ * requests; the #StopwatchPtr of an unsampled request is just a
+ * null pointer.
+ *
+ * Instances are reference counted (by #StopwatchPtr) and are owned
+ * by one thread.  When the last reference is dropped, the span is
+ * submitted to the thread's #TraceBuffer.
+ */
+class TraceSpan {
+	static constexpr std::size_t MAX_EVENTS = 16;
+
+	unsigned refs = 1;
+
+	uint8_t n_events = 0;
+
+	/**
+	 * The #TraceRecord::Type::SPAN record followed by the
+	 * events; submitted in one go.
+	 */
+	TraceRecord records[1 + MAX_EVENTS];
+
+	TraceSpan() noexcept = default;
+	~TraceSpan() noexcept = default;
+
+public:
+	TraceSpan(const TraceSpan &) = delete;
+	TraceSpan &operator=(const TraceSpan &) = delete;
+
+	/**
+	 * Start a new trace.
+	 */
+	static TraceSpan *NewRoot(std::string_view name,
+				  const char *suffix) noexcept;
+
+	/**
+	 * Continue a trace which was started by our caller.
+	 */
+	static TraceSpan *NewRemoteChild(const TraceContext &ctx,
+					 std::string_view name,
+					 const char *suffix) noexcept;
+
+	static TraceSpan *NewChild(const TraceSpan &parent,
+				   std::string_view name,
+				   const char *suffix) noexcept;
+
+	void Ref() noexcept {
+		++refs;
+	}
+
+	void Unref() noexcept {
+		if (--refs == 0)
+			Finish();
+	}
+
+	void RecordEvent(std::string_view name) noexcept;
+
+private:
+	static TraceSpan *New(const TraceId &trace_id,
+			      uint64_t parent_span_id,
+			      TraceRecord::Kind kind,
+			      std::string_view name,
+			      const char *suffix) noexcept;
+
+	/**
+	 * Submit this span to the #TraceBuffer and delete this
+	 * object.
+	 */
+	void Finish() noexcept;
+};
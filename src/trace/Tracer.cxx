@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Tracer.hxx"
+#include "stats/ThreadShards.hxx"
+
+#include <chrono>
+#include <random>
+
+namespace TraceDetail {
+
+std::atomic_uint sample_rate{0};
+
+std::atomic_bool honor_traceparent{false};
+
+thread_local unsigned sample_counter = 0;
+
+} // namespace TraceDetail
+
+/**
+ * Reuse the per-thread sharding from the statistics code; each
+ * shard is only written by its thread, and the exporter consumes
+ * them all.
+ */
+static ThreadShards<TraceBuffer> trace_buffers;
+
+void
+trace_set_sample_rate(unsigned n) noexcept
+{
+	TraceDetail::sample_rate.store(n, std::memory_order_relaxed);
+}
+
+void
+trace_set_honor_traceparent(bool value) noexcept
+{
+	TraceDetail::honor_traceparent.store(value, std::memory_order_relaxed);
+}
+
+TraceBuffer &
+trace_local_buffer() noexcept
+{
+	return trace_buffers.Local();
+}
+
+void
+trace_for_each_buffer(void (*f)(TraceBuffer &buffer, void *ctx),
+		      void *ctx) noexcept
+{
+	trace_buffers.ForEach([f, ctx](const TraceBuffer &buffer){
+		/* the consumer side of the ring is owned by the
+		   caller */
+		f(const_cast<TraceBuffer &>(buffer), ctx);
+	});
+}
+
+static std::mt19937_64 &
+GetRandomEngine() noexcept
+{
+	/* only sampled requests need random numbers, therefore a
+	   lazily seeded per-thread engine is good enough */
+	thread_local std::mt19937_64 engine{std::random_device{}()};
+	return engine;
+}
+
+TraceId
+trace_generate_trace_id() noexcept
+{
+	auto &engine = GetRandomEngine();
+
+	TraceId id;
+	uint64_t a, b;
+	do {
+		a = engine();
+		b = engine();
+	} while (a == 0 && b == 0);
+
+	for (unsigned i = 0; i < 8; ++i) {
+		id[i] = a >> (56 - i * 8);
+		id[8 + i] = b >> (56 - i * 8);
+	}
+
+	return id;
+}
+
+uint64_t
+trace_generate_span_id() noexcept
+{
+	auto &engine = GetRandomEngine();
+
+	uint64_t id;
+	do {
+		id = engine();
+	} while (id == 0);
+
+	return id;
+}
+
+uint64_t
+trace_now() noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Process-wide state of the sampled request tracer.
+ */
+
+#pragma once
+
+#include "Ring.hxx"
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Each event loop thread has one of these (4096 records = 512 kB).
+ */
+using TraceBuffer = TraceRing<4096>;
+
+namespace TraceDetail {
+
+extern std::atomic_uint sample_rate;
+
+extern std::atomic_bool honor_traceparent;
+
+extern thread_local unsigned sample_counter;
+
+} // namespace TraceDetail
+
+/**
+ * Trace one in @a n requests; 0 disables tracing.
+ */
+void
+trace_set_sample_rate(unsigned n) noexcept;
+
+/**
+ * Shall requests whose "traceparent" header has the "sampled" flag
+ * always be traced (bypassing the sample rate)?
+ */
+void
+trace_set_honor_traceparent(bool value) noexcept;
+
+/**
+ * Is the tracer enabled, i.e. is there a #TraceExporter which
+ * drains the #TraceBuffer rings?
+ */
+static inline bool
+trace_enabled() noexcept
+{
+	return TraceDetail::sample_rate.load(std::memory_order_relaxed) != 0;
+}
+
+/**
+ * Shall the "traceparent" request header be evaluated?  See
+ * trace_set_honor_traceparent().
+ */
+static inline bool
+trace_honor_traceparent() noexcept
+{
+	return trace_enabled() &&
+		TraceDetail::honor_traceparent.load(std::memory_order_relaxed);
+}
+
+/**
+ * Shall the request which is about to start be traced?  This is
+ * called for every request, therefore it is inline and cheap.
+ */
+static inline bool
+trace_should_sample() noexcept
+{
+	const unsigned rate =
+		TraceDetail::sample_rate.load(std::memory_order_relaxed);
+	if (rate == 0) [[likely]]
+		return false;
+
+	if (++TraceDetail::sample_counter < rate)
+		return false;
+
+	TraceDetail::sample_counter = 0;
+	return true;
+}
+
+/**
+ * Returns the #TraceBuffer of the calling thread.
+ */
+TraceBuffer &
+trace_local_buffer() noexcept;
+
+/**
+ * Invoke the given function for each #TraceBuffer.
+ */
+void
+trace_for_each_buffer(void (*f)(TraceBuffer &buffer, void *ctx),
+		      void *ctx) noexcept;
+
+/**
+ * Generate a random (non-zero) trace id.
+ */
+TraceId
+trace_generate_trace_id() noexcept;
+
+/**
+ * Generate a random (non-zero) span id.
+ */
+uint64_t
+trace_generate_span_id() noexcept;
+
+/**
+ * Returns the current time in nanoseconds since the Unix epoch.
+ */
+uint64_t
+trace_now() noexcept;
@@ -51,9 +51,10 @@ TranslationStockBuilder::Get(SocketAddress address,
 
 TranslationCacheBuilder::TranslationCacheBuilder(TranslationStockBuilder &_builder,
 						 struct pool &_pool,
-						 unsigned _max_size) noexcept
+						 unsigned _max_size,
+						 CacheAdmission _admission) noexcept
 	:builder(_builder),
-	 pool(_pool), max_size(_max_size)
+	 pool(_pool), max_size(_max_size), admission(_admission)
 {
 }
 
@@ -119,7 +120,7 @@ TranslationCacheBuilder::Get(SocketAddress address,
 			(pool, event_loop, pcre_cache,
 			 // TODO: refactor to std::shared_ptr?
 			 *builder.Get(address, event_loop, pcre_cache),
-			 max_size, false);
+			 max_size, admission, false);
 
 	return e.first->second;
 }
@@ -14,6 +14,7 @@
 #include <string_view>
 
 struct CacheStats;
+enum class CacheAdmission : uint_least8_t;
 class EventLoop;
 class SocketAddress;
 class TranslationGlue;
@@ -57,6 +58,8 @@ class TranslationCacheBuilder final : public TranslationServiceBuilder {
 
 	const unsigned max_size;
 
+	const CacheAdmission admission;
+
 	std::map<SocketAddress, std::shared_ptr<TranslationCache>,
 		 SocketAddressCompare> m;
 
@@ -66,7 +69,8 @@ class TranslationCacheBuilder final : public TranslationServiceBuilder {
 public:
 	TranslationCacheBuilder(TranslationStockBuilder &_builder,
 				struct pool &_pool,
-				unsigned _max_size) noexcept;
+				unsigned _max_size,
+				CacheAdmission _admission) noexcept;
 	~TranslationCacheBuilder() noexcept;
 
 	void ForkCow(bool inherit) noexcept;
@@ -935,11 +935,11 @@ void
 TranslationCache::ExpireTag(std::string_view tag, ExpireCallback callback) noexcept
 {
 	const auto now = cache.SteadyNow();
-	per_tag.for_each_key(tag, [callback, now](TranslateCacheItemTag &item_tag){
+	per_tag.for_each_key(tag, [this, callback, now](TranslateCacheItemTag &item_tag){
 		auto &item = item_tag.parent;
 		const auto delay = CalculateExpireDelayForSite(item.response.site);
 		const auto expires = now + delay;
-		item.SetExpires(expires);
+		cache.SetExpires(item, expires);
 		callback(item.response, expires);
 	});
 }
@@ -1263,11 +1263,12 @@ TranslationCache::TranslationCache(struct pool &_pool, EventLoop &event_loop,
 				   Pcre::Cache &_pcre_cache,
 				   TranslationService &_next,
 				   unsigned max_size,
+				   CacheAdmission admission,
 				   bool handshake_cacheable)
 	:pool(pool_new_dummy(&_pool, "translate_cache")),
 	 slice_pool(4096, 32768, "translate_cache"),
 	 pcre_cache(_pcre_cache),
-	 cache(event_loop, max_size, this),
+	 cache(event_loop, max_size, this, admission),
 	 next(_next), active(handshake_cacheable)
 {
 	assert(max_size > 0);
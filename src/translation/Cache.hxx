@@ -132,7 +132,8 @@ public:
 	TranslationCache(struct pool &pool, EventLoop &event_loop,
 			 Pcre::Cache &_pcre_cache,
 			 TranslationService &next,
-			 unsigned max_size, bool handshake_cacheable=true);
+			 unsigned max_size, CacheAdmission admission,
+			 bool handshake_cacheable=true);
 
 	~TranslationCache() noexcept override;
 
@@ -141,7 +142,9 @@ public:
 	void Populate() noexcept;
 
 	CacheStats GetStats() const noexcept {
-		return stats;
+		CacheStats result = stats;
+		cache.FillStats(result);
+		return result;
 	}
 
 	/**
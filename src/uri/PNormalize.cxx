@@ -4,9 +4,15 @@
 
 #include "PNormalize.hxx"
 #include "AllocatorPtr.hxx"
+#include "util/CharUtil.hxx"
+#include "util/HexParse.hxx"
+#include "util/IterableSplitString.hxx"
 #include "util/StringCompare.hxx"
+#include "util/StringSplit.hxx"
 
+#include <algorithm> // for std::stable_sort(), std::is_sorted()
 #include <cassert>
+#include <vector>
 
 #include <string.h>
 
@@ -61,3 +67,180 @@ NormalizeUriPath(AllocatorPtr alloc, const char *uri) noexcept
 
 	return dest;
 }
+
+static constexpr bool
+IsUnreservedChar(char ch) noexcept
+{
+	return IsAlphaNumericASCII(ch) ||
+		ch == '-' || ch == '.' || ch == '_' || ch == '~';
+}
+
+static constexpr bool
+IsLowerHexDigit(char ch) noexcept
+{
+	return ch >= 'a' && ch <= 'f';
+}
+
+/**
+ * Parse the escape at the given position.
+ *
+ * @return the decoded character or -1 if this is not a valid escape
+ */
+static int
+ParseEscape(std::string_view s, std::size_t i) noexcept
+{
+	if (s[i] != '%' || s.size() - i < 3)
+		return -1;
+
+	const int digit1 = ParseHexDigit(s[i + 1]);
+	const int digit2 = ParseHexDigit(s[i + 2]);
+	if (digit1 < 0 || digit2 < 0)
+		return -1;
+
+	return (digit1 << 4) | digit2;
+}
+
+/**
+ * Does the escape at the given position need normalization?
+ */
+static bool
+NeedsEscapeNormalization(std::string_view s, std::size_t i) noexcept
+{
+	const int ch = ParseEscape(s, i);
+	return ch >= 0 &&
+		(IsUnreservedChar(static_cast<char>(ch)) ||
+		 IsLowerHexDigit(s[i + 1]) || IsLowerHexDigit(s[i + 2]));
+}
+
+std::string_view
+NormalizeUriEscapes(AllocatorPtr alloc, std::string_view uri) noexcept
+{
+	std::size_t i = uri.find('%');
+	while (i != uri.npos && !NeedsEscapeNormalization(uri, i))
+		i = uri.find('%', i + 1);
+
+	if (i == uri.npos)
+		/* cheap route: nothing to normalize */
+		return uri;
+
+	char *const dest0 = alloc.NewArray<char>(uri.size());
+	char *dest = std::copy_n(uri.data(), i, dest0);
+
+	while (i < uri.size()) {
+		const int ch = ParseEscape(uri, i);
+		if (ch < 0) {
+			*dest++ = uri[i++];
+		} else if (IsUnreservedChar(static_cast<char>(ch))) {
+			*dest++ = static_cast<char>(ch);
+			i += 3;
+		} else {
+			*dest++ = '%';
+			*dest++ = ToUpperASCII(uri[i + 1]);
+			*dest++ = ToUpperASCII(uri[i + 2]);
+			i += 3;
+		}
+	}
+
+	return {dest0, dest};
+}
+
+[[gnu::pure]]
+static bool
+MatchQueryParameter(std::string_view parameter,
+		    std::span<const std::string> names) noexcept
+{
+	const std::string_view name = Split(parameter, '=').first;
+
+	for (const std::string_view i : names) {
+		if (i.ends_with('*')) {
+			if (name.starts_with(i.substr(0, i.size() - 1)))
+				return true;
+		} else if (name == i)
+			return true;
+	}
+
+	return false;
+}
+
+[[gnu::pure]]
+static bool
+IsRemovedQueryParameter(std::string_view parameter,
+			std::span<const std::string> names) noexcept
+{
+	return parameter.empty() || MatchQueryParameter(parameter, names);
+}
+
+std::string_view
+RemoveQueryParameters(AllocatorPtr alloc, std::string_view query,
+		      std::span<const std::string> names) noexcept
+{
+	if (query.empty())
+		return query;
+
+	bool found = false;
+	for (const std::string_view i : IterableSplitString(query, '&')) {
+		if (IsRemovedQueryParameter(i, names)) {
+			found = true;
+			break;
+		}
+	}
+
+	if (!found)
+		/* cheap route: nothing to remove */
+		return query;
+
+	char *const dest0 = alloc.NewArray<char>(query.size());
+	char *dest = dest0;
+
+	for (const std::string_view i : IterableSplitString(query, '&')) {
+		if (IsRemovedQueryParameter(i, names))
+			continue;
+
+		if (dest != dest0)
+			*dest++ = '&';
+		dest = std::copy(i.begin(), i.end(), dest);
+	}
+
+	return {dest0, dest};
+}
+
+/**
+ * Compare two query string parameters by their names (ignoring the
+ * values).
+ */
+[[gnu::pure]]
+static bool
+CompareQueryParameterNames(std::string_view a, std::string_view b) noexcept
+{
+	return Split(a, '=').first < Split(b, '=').first;
+}
+
+std::string_view
+SortQueryString(AllocatorPtr alloc, std::string_view query) noexcept
+{
+	std::vector<std::string_view> parameters;
+	for (const std::string_view i : IterableSplitString(query, '&'))
+		parameters.push_back(i);
+
+	if (std::is_sorted(parameters.begin(), parameters.end(),
+			   CompareQueryParameterNames))
+		/* cheap route: already sorted */
+		return query;
+
+	/* the order of repeated parameters is significant (the
+	   application may interpret them as a list), so it is
+	   preserved */
+	std::stable_sort(parameters.begin(), parameters.end(),
+			 CompareQueryParameterNames);
+
+	char *const dest0 = alloc.NewArray<char>(query.size());
+	char *dest = dest0;
+
+	for (const std::string_view i : parameters) {
+		if (dest != dest0)
+			*dest++ = '&';
+		dest = std::copy(i.begin(), i.end(), dest);
+	}
+
+	return {dest0, dest};
+}
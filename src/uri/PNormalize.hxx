@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <span>
+#include <string>
+#include <string_view>
+
 class AllocatorPtr;
 
 /**
@@ -16,3 +20,34 @@ class AllocatorPtr;
 [[gnu::pure]]
 const char *
 NormalizeUriPath(AllocatorPtr alloc, const char *uri) noexcept;
+
+/**
+ * Normalize the percent-encoding of an URI (RFC 3986 6.2.2.1 and
+ * 6.2.2.2): decode escaped unreserved characters and convert the hex
+ * digits of all other escapes to upper case.  Returns the original
+ * string if no change is needed.
+ */
+[[gnu::pure]]
+std::string_view
+NormalizeUriEscapes(AllocatorPtr alloc, std::string_view uri) noexcept;
+
+/**
+ * Remove parameters from a query string (without the question
+ * mark).  A name ending with an asterisk matches all parameters
+ * beginning with it.  Empty parameters ("&&") are removed as well.
+ * Returns the original string if no change is needed.
+ */
+[[gnu::pure]]
+std::string_view
+RemoveQueryParameters(AllocatorPtr alloc, std::string_view query,
+		      std::span<const std::string> names) noexcept;
+
+/**
+ * Sort the parameters of a query string (without the question
+ * mark) by their names.  Parameters with the same name keep their
+ * relative order.  Returns the original string if it is already
+ * sorted.
+ */
+[[gnu::pure]]
+std::string_view
+SortQueryString(AllocatorPtr alloc, std::string_view query) noexcept;
@@ -15,6 +15,8 @@ WidgetClass::WidgetClass(AllocatorPtr alloc, const WidgetClass &src) noexcept
 	 untrusted_raw_site_suffix(alloc.CheckDup(src.untrusted_raw_site_suffix)),
 	 cookie_host(alloc.CheckDup(src.cookie_host)),
 	 group(alloc.CheckDup(src.group)),
+	 fragment_cache_tag(alloc.CheckDup(src.fragment_cache_tag)),
+	 fragment_max_age(src.fragment_max_age),
 	 direct_addressing(src.direct_addressing),
 	 stateful(src.stateful),
 	 require_csrf_token(src.require_csrf_token),
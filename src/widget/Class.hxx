@@ -7,6 +7,8 @@
 #include "VList.hxx"
 #include "util/StringSet.hxx"
 
+#include <chrono>
+
 /**
  * A widget class is a server which provides a widget.
  */
@@ -64,6 +66,22 @@ struct WidgetClass {
 	 */
 	StringSet container_groups;
 
+	/**
+	 * The cache tag of fragments in the #WidgetFragmentCache
+	 * (from #TranslationCommand::CACHE_TAG).
+	 */
+	const char *fragment_cache_tag = nullptr;
+
+	/**
+	 * How long may the processed output of this widget be cached
+	 * in the #WidgetFragmentCache?  Zero (the default) disables
+	 * fragment caching.  It is enabled by
+	 * #TranslationCommand::EAGER_CACHE in the widget class
+	 * response, and the lifetime is its
+	 * #TranslationCommand::EXPIRES_RELATIVE.
+	 */
+	std::chrono::seconds fragment_max_age{};
+
 	/**
 	 * Does this widget support new-style direct URI addressing?
 	 *
@@ -15,6 +15,7 @@ class PipeStock;
 class TranslationService;
 class ResourceLoader;
 class WidgetRegistry;
+class WidgetFragmentCache;
 class StringMap;
 class SessionManager;
 class SessionLease;
@@ -35,6 +36,12 @@ struct WidgetContext {
 
 	WidgetRegistry *widget_registry;
 
+	/**
+	 * If set, then the processed output of session-independent
+	 * widgets is cached here.
+	 */
+	WidgetFragmentCache *fragment_cache = nullptr;
+
 	const char *site_name;
 
 	/**
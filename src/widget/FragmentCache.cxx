@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "FragmentCache.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "istream/SharedLeaseIstream.hxx"
+#include "istream/TeeIstream.hxx"
+#include "memory/istream_rubber.hxx"
+#include "memory/sink_rubber.hxx"
+#include "pool/pool.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "event/Loop.hxx"
+#include "io/Logger.hxx"
+#include "util/Cancellable.hxx"
+#include "util/LeakDetector.hxx"
+
+#include <cassert>
+
+/**
+ * Fragments larger than this are not cached.
+ */
+static constexpr std::size_t cacheable_size_limit = 256 * 1024;
+
+/**
+ * Upper limit for #WidgetClass::fragment_max_age.
+ */
+static constexpr std::chrono::seconds max_max_age = std::chrono::hours(24);
+
+WidgetFragmentCacheItem::WidgetFragmentCacheItem(StringWithHash _key,
+						 const char *_tag,
+						 RubberAllocation &&_allocation,
+						 std::size_t _size,
+						 std::chrono::steady_clock::time_point expires) noexcept
+	:WidgetFragmentCacheItemKey(_key.value),
+	 CacheItem(StringWithHash{WidgetFragmentCacheItemKey::key, _key.hash},
+		   _size, expires),
+	 tag(_tag != nullptr ? _tag : ""),
+	 allocation(std::move(_allocation)),
+	 size(_size) {}
+
+/**
+ * Copies a fragment from a #TeeIstream into the #Rubber heap.
+ */
+class WidgetFragmentCache::Store final
+	: public AutoUnlinkIntrusiveListHook, RubberSinkHandler, LeakDetector
+{
+	static constexpr Event::Duration timeout = std::chrono::minutes(1);
+
+	WidgetFragmentCache &cache;
+
+	const std::string key;
+	const std::size_t key_hash;
+
+	const std::string tag;
+
+	const std::chrono::seconds max_age;
+
+	/**
+	 * This event limits the duration for receiving the fragment.
+	 */
+	CoarseTimerEvent timeout_event;
+
+	/**
+	 * To cancel the RubberSink.
+	 */
+	CancellablePointer rubber_cancel_ptr;
+
+public:
+	Store(WidgetFragmentCache &_cache, StringWithHash _key,
+	      const char *_tag, std::chrono::seconds _max_age) noexcept
+		:cache(_cache), key(_key.value), key_hash(_key.hash),
+		 tag(_tag != nullptr ? _tag : ""),
+		 max_age(_max_age),
+		 timeout_event(cache.GetEventLoop(), BIND_THIS_METHOD(OnTimeout)) {}
+
+	/**
+	 * Release resources held by this request.
+	 */
+	void Destroy() noexcept {
+		assert(!rubber_cancel_ptr);
+
+		this->~Store();
+	}
+
+	void Start(struct pool &pool, UnusedIstreamPtr &&src) noexcept {
+		timeout_event.Schedule(timeout);
+
+		sink_rubber_new(pool, std::move(src),
+				cache.rubber, cacheable_size_limit,
+				*this,
+				rubber_cancel_ptr);
+	}
+
+	/**
+	 * Cancel storing the fragment.
+	 */
+	void CancelStore() noexcept {
+		assert(rubber_cancel_ptr);
+
+		rubber_cancel_ptr.Cancel();
+		Destroy();
+	}
+
+private:
+	void Skip(const char *reason) noexcept {
+		LogConcat(4, "WidgetFragmentCache", "nocache ", reason, " ", key);
+		++cache.stats.skips;
+		Destroy();
+	}
+
+	void OnTimeout() noexcept {
+		rubber_cancel_ptr.Cancel();
+		Skip("timeout");
+	}
+
+	/* virtual methods from class RubberSinkHandler */
+	void RubberDone(RubberAllocation &&a, std::size_t size) noexcept override {
+		rubber_cancel_ptr = nullptr;
+
+		if (size == 0) {
+			Skip("empty");
+			return;
+		}
+
+		auto *item = new Item(StringWithHash{key, key_hash},
+				      tag.empty() ? nullptr : tag.c_str(),
+				      std::move(a), size,
+				      cache.cache.SteadyNow() + max_age);
+
+		cache.Add(*item);
+		Destroy();
+	}
+
+	void RubberOutOfMemory() noexcept override {
+		rubber_cancel_ptr = nullptr;
+		Skip("oom");
+	}
+
+	void RubberTooLarge() noexcept override {
+		rubber_cancel_ptr = nullptr;
+		Skip("too large");
+	}
+
+	void RubberError(std::exception_ptr ep) noexcept override {
+		rubber_cancel_ptr = nullptr;
+
+		LogConcat(4, "WidgetFragmentCache", "body_error ", key, ": ", ep);
+		++cache.stats.skips;
+		Destroy();
+	}
+};
+
+WidgetFragmentCache::WidgetFragmentCache(EventLoop &event_loop,
+					 std::size_t max_size)
+	:rubber(max_size, "widget_fragment_cache"),
+	 /* leave 12.5% of the rubber allocator empty, to increase the
+	    chances that a hole can be found for a new allocation, to
+	    reduce the pressure that rubber_compress() creates */
+	 cache(event_loop, max_size * 7 / 8),
+	 compress_timer(event_loop, BIND_THIS_METHOD(OnCompressTimer))
+{
+	compress_timer.Schedule(compress_interval);
+}
+
+WidgetFragmentCache::~WidgetFragmentCache() noexcept
+{
+	stores.clear_and_dispose([](auto *r){ r->CancelStore(); });
+}
+
+void
+WidgetFragmentCache::BeginShutdown() noexcept
+{
+	stores.clear_and_dispose([](auto *r){ r->CancelStore(); });
+
+	compress_timer.Cancel();
+
+	cache.Flush();
+}
+
+void
+WidgetFragmentCache::FlushTag(std::string_view tag) noexcept
+{
+	per_tag.remove_and_dispose_key(tag, [this](auto *item){
+		cache.Remove(*item);
+	});
+}
+
+UnusedIstreamPtr
+WidgetFragmentCache::Get(struct pool &pool, StringWithHash key) noexcept
+{
+	auto *item = static_cast<Item *>(cache.Get(key));
+	if (item == nullptr) {
+		++stats.misses;
+		return nullptr;
+	}
+
+	LogConcat(4, "WidgetFragmentCache", "hit ", key.value);
+	++stats.hits;
+
+	return NewSharedLeaseIstream(pool,
+				     istream_rubber_new(pool, rubber,
+							item->allocation.GetId(),
+							0, item->size, false),
+				     *item);
+}
+
+UnusedIstreamPtr
+WidgetFragmentCache::Put(struct pool &pool, StringWithHash key,
+			 const char *tag, std::chrono::seconds max_age,
+			 UnusedIstreamPtr src) noexcept
+{
+	assert(max_age > std::chrono::seconds::zero());
+
+	if (max_age > max_max_age)
+		max_age = max_max_age;
+
+	/* tee the fragment: one goes to the template, and one goes
+	   into the cache */
+	src = NewTeeIstream(pool, std::move(src),
+			    GetEventLoop(),
+			    false, false);
+
+	auto store = NewFromPool<Store>(pool, *this, key, tag, max_age);
+	stores.push_back(*store);
+
+	store->Start(pool, AddTeeIstream(src, true));
+
+	return src;
+}
+
+void
+WidgetFragmentCache::Add(Item &item) noexcept
+{
+	LogConcat(4, "WidgetFragmentCache", "add ", item.GetKey().value);
+	++stats.stores;
+
+	if (!item.tag.empty())
+		per_tag.insert(item);
+
+	cache.Put(item);
+}
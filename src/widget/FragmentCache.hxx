@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "cache/Cache.hxx"
+#include "cache/Item.hxx"
+#include "stats/CacheStats.hxx"
+#include "memory/Rubber.hxx"
+#include "event/FarTimerEvent.hxx"
+#include "util/IntrusiveHashSet.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/TransparentHash.hxx"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+struct pool;
+class UnusedIstreamPtr;
+class WidgetFragmentCache;
+
+class WidgetFragmentCacheItemKey {
+protected:
+	const std::string key;
+
+public:
+	[[nodiscard]]
+	explicit WidgetFragmentCacheItemKey(std::string_view _key) noexcept
+		:key(_key) {}
+};
+
+/**
+ * An item in the #WidgetFragmentCache.
+ */
+class WidgetFragmentCacheItem final : WidgetFragmentCacheItemKey, public CacheItem {
+	friend class WidgetFragmentCache;
+
+	/**
+	 * The cache tag; empty if none was specified.
+	 */
+	const std::string tag;
+
+	/**
+	 * For #WidgetFragmentCache::per_tag.
+	 */
+	IntrusiveHashSetHook<IntrusiveHookMode::AUTO_UNLINK> per_tag_hook;
+
+	const RubberAllocation allocation;
+
+	const std::size_t size;
+
+public:
+	WidgetFragmentCacheItem(StringWithHash _key, const char *_tag,
+				RubberAllocation &&_allocation, std::size_t _size,
+				std::chrono::steady_clock::time_point expires) noexcept;
+
+	struct GetTag {
+		[[gnu::pure]]
+		std::string_view operator()(const WidgetFragmentCacheItem &item) const noexcept {
+			return item.tag;
+		}
+	};
+
+private:
+	/* virtual methods from class CacheItem */
+	void Destroy() noexcept override {
+		delete this;
+	}
+};
+
+/**
+ * A cache for the processed output of widgets which do not depend on
+ * the session, e.g. a static header or footer which is embedded in
+ * many pages.  A cached fragment is spliced into the template
+ * without sending a request to the widget server.
+ *
+ * The lifetime of each fragment is specified by the widget class
+ * (#WidgetClass::fragment_max_age), and fragments can be flushed by
+ * their cache tag.
+ */
+class WidgetFragmentCache final {
+	static constexpr Event::Duration compress_interval = std::chrono::minutes(10);
+
+	using Item = WidgetFragmentCacheItem;
+
+	Rubber rubber;
+	Cache cache;
+
+	/**
+	 * Lookup table to speed up FlushTag().
+	 */
+	IntrusiveHashSet<Item, 4096,
+			 IntrusiveHashSetOperators<Item, Item::GetTag,
+						   TransparentHash,
+						   std::equal_to<std::string_view>>,
+			 IntrusiveHashSetMemberHookTraits<&Item::per_tag_hook>> per_tag;
+
+	FarTimerEvent compress_timer;
+
+	class Store;
+
+	/**
+	 * A list of fragments which are currently being copied to a
+	 * #Rubber allocation.  We keep track of them so we can cancel
+	 * them on shutdown.
+	 */
+	IntrusiveList<Store> stores;
+
+	mutable CacheStats stats{};
+
+public:
+	WidgetFragmentCache(EventLoop &event_loop, std::size_t max_size);
+	~WidgetFragmentCache() noexcept;
+
+	auto &GetEventLoop() const noexcept {
+		return compress_timer.GetEventLoop();
+	}
+
+	void ForkCow(bool inherit) noexcept {
+		rubber.ForkCow(inherit);
+	}
+
+	CacheStats GetStats() const noexcept {
+		stats.allocator = rubber.GetStats();
+		cache.FillStats(stats);
+		return stats;
+	}
+
+	void Flush() noexcept {
+		cache.Flush();
+		Compress();
+	}
+
+	void FlushTag(std::string_view tag) noexcept;
+
+	/**
+	 * Initiate shutdown.  This cancels all pending stores and
+	 * unregisters all #EventLoop events.
+	 */
+	void BeginShutdown() noexcept;
+
+	/**
+	 * Look up a fragment.
+	 *
+	 * @return an #Istream which reads the fragment or nullptr on
+	 * cache miss
+	 */
+	UnusedIstreamPtr Get(struct pool &pool, StringWithHash key) noexcept;
+
+	/**
+	 * Copy a fragment into the cache while it is being sent to
+	 * the client.
+	 *
+	 * @param tag an optional cache tag for FlushTag()
+	 * @param src the fully processed widget response body
+	 * @return the #Istream to be embedded in the template
+	 */
+	UnusedIstreamPtr Put(struct pool &pool, StringWithHash key,
+			     const char *tag, std::chrono::seconds max_age,
+			     UnusedIstreamPtr src) noexcept;
+
+private:
+	void Add(Item &item) noexcept;
+
+	void Compress() noexcept {
+		rubber.Compress();
+	}
+
+	void OnCompressTimer() noexcept {
+		Compress();
+		compress_timer.Schedule(compress_interval);
+	}
+};
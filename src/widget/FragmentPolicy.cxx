@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "FragmentPolicy.hxx"
+#include "Widget.hxx"
+#include "Class.hxx"
+#include "View.hxx"
+#include "bp/ForwardHeaders.hxx"
+#include "http/CommonHeaders.hxx"
+#include "http/Method.hxx"
+#include "strmap.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringCompare.hxx"
+#include "util/StringStrip.hxx"
+#include "AllocatorPtr.hxx"
+
+#include <assert.h>
+
+using std::string_view_literals::operator""sv;
+
+bool
+IsSessionIndependent(const WidgetView &view) noexcept
+{
+	using Group = HeaderForwardSettings::Group;
+	using Mode = HeaderForwardSettings::Mode;
+
+	return view.request_header_forward[Group::COOKIE] == Mode::NO &&
+		view.request_header_forward[Group::IDENTITY] == Mode::NO &&
+		view.request_header_forward[Group::AUTH] == Mode::NO &&
+		view.request_header_forward[Group::SSL] == Mode::NO &&
+		view.request_header_forward[Group::SECURE] == Mode::NO &&
+		view.response_header_forward[Group::COOKIE] == Mode::NO;
+}
+
+bool
+IsFragmentCacheable(const Widget &widget) noexcept
+{
+	assert(widget.cls != nullptr);
+
+	if (widget.cls->fragment_max_age <= std::chrono::seconds::zero())
+		return false;
+
+	if (widget.from_request.method != HttpMethod::GET ||
+	    widget.from_request.body ||
+	    widget.from_request.unauthorized_view ||
+	    widget.for_focused != nullptr)
+		return false;
+
+	/* the output of a container includes its child widgets,
+	   which may be dynamic */
+	if (widget.IsContainer())
+		return false;
+
+	const WidgetView *view = widget.GetEffectiveView();
+	return view != nullptr && IsSessionIndependent(*view);
+}
+
+/**
+ * Is the response private or must it not be stored?
+ */
+[[gnu::pure]]
+static bool
+IsPrivate(const char *cache_control) noexcept
+{
+	for (std::string_view s : IterableSplitString(cache_control, ',')) {
+		s = Strip(s);
+
+		if (s.starts_with("private"sv) ||
+		    s == "no-cache"sv || s == "no-store"sv)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Does MakeFragmentKey() cover all request headers in this "Vary"
+ * response header?  "Accept-Language" is part of the key;
+ * "User-Agent" is part of the key if it is forwarded from the
+ * request (otherwise it is constant).
+ */
+[[gnu::pure]]
+static bool
+IsVaryCovered(const char *vary) noexcept
+{
+	for (std::string_view s : IterableSplitString(vary, ',')) {
+		s = Strip(s);
+
+		if (s.empty())
+			continue;
+
+		if (!StringIsEqualIgnoreCase(s, "accept-language"sv) &&
+		    !StringIsEqualIgnoreCase(s, "user-agent"sv))
+			/* this includes "*" */
+			return false;
+	}
+
+	return true;
+}
+
+bool
+IsFragmentCacheableResponse(const StringMap &headers) noexcept
+{
+	if (headers.Contains(set_cookie_header) ||
+	    headers.Contains(set_cookie2_header))
+		return false;
+
+	const auto cache_control = headers.EqualRange(cache_control_header);
+	for (auto i = cache_control.first; i != cache_control.second; ++i)
+		if (IsPrivate(i->value))
+			return false;
+
+	const auto vary = headers.EqualRange(vary_header);
+	for (auto i = vary.first; i != vary.second; ++i)
+		if (!IsVaryCovered(i->value))
+			return false;
+
+	return true;
+}
+
+StringWithHash
+MakeFragmentKey(AllocatorPtr alloc, const Widget &widget,
+		const char *template_uri,
+		const char *language, const char *user_agent,
+		bool plain_text) noexcept
+{
+	const WidgetView *view = widget.GetEffectiveView();
+	assert(view != nullptr);
+
+	const char *view_name = view->name != nullptr ? view->name : "";
+	const char *id_path = widget.GetIdPath();
+
+	/* the forwarded request headers are separated with a newline
+	   because they cannot contain one */
+	return StringWithHash{alloc.Concat(widget.class_name, '|',
+					   view_name, '|',
+					   id_path != nullptr ? id_path : "", '|',
+					   widget.GetAddress().GetId(alloc).value, '|',
+					   template_uri,
+					   plain_text ? "|text"sv : ""sv,
+					   "\nlang="sv,
+					   language != nullptr ? language : "",
+					   "\nua="sv,
+					   user_agent != nullptr ? user_agent : "")};
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Decide which widgets may be served from the #WidgetFragmentCache
+ * and how their fragments are keyed.
+ */
+
+#pragma once
+
+#include "util/StringWithHash.hxx"
+
+class AllocatorPtr;
+class StringMap;
+struct Widget;
+struct WidgetView;
+
+/**
+ * Does the given view send anything to the widget server (or accept
+ * anything from it) which depends on the session or on the user?
+ */
+[[gnu::pure]]
+bool
+IsSessionIndependent(const WidgetView &view) noexcept;
+
+/**
+ * May the processed output of this widget be stored in the
+ * #WidgetFragmentCache?  This checks only the widget class, the
+ * view and the request; the response is checked by
+ * IsFragmentCacheableResponse().
+ */
+[[gnu::pure]]
+bool
+IsFragmentCacheable(const Widget &widget) noexcept;
+
+/**
+ * May a widget server response with the given headers be stored in
+ * the #WidgetFragmentCache?  This refuses responses which are marked
+ * private or uncacheable, which set cookies, and which vary on
+ * request headers not covered by MakeFragmentKey().
+ */
+[[gnu::pure]]
+bool
+IsFragmentCacheableResponse(const StringMap &headers) noexcept;
+
+/**
+ * Build the #WidgetFragmentCache key: the fragment depends on the
+ * widget class, the view, the widget server URI (which includes
+ * path_info and query string), the widget's position in the
+ * template and the template URI (which are used to rewrite URIs),
+ * and on the request headers which are forwarded to the widget
+ * server.
+ *
+ * @param template_uri the (absolute) URI of the template
+ * @param language the "Accept-Language" forwarded to the widget
+ * server (from the session or from the request); nullptr if none
+ * @param user_agent the "User-Agent" forwarded to the widget server
+ * if it is copied from the request; nullptr otherwise
+ */
+StringWithHash
+MakeFragmentKey(AllocatorPtr alloc, const Widget &widget,
+		const char *template_uri,
+		const char *language, const char *user_agent,
+		bool plain_text) noexcept;
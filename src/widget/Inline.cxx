@@ -6,8 +6,12 @@
 #include "Request.hxx"
 #include "Error.hxx"
 #include "Widget.hxx"
+#include "Class.hxx"
+#include "View.hxx"
 #include "Context.hxx"
 #include "Resolver.hxx"
+#include "FragmentCache.hxx"
+#include "FragmentPolicy.hxx"
 #include "http/CommonHeaders.hxx"
 #include "http/HeaderUtil.hxx"
 #include "http/ResponseHandler.hxx"
@@ -21,6 +25,8 @@
 #include "istream/istream_string.hxx"
 #include "istream/TimeoutIstream.hxx"
 #include "bp/session/Lease.hxx"
+#include "bp/session/Session.hxx"
+#include "bp/ForwardHeaders.hxx"
 #include "pool/pool.hxx"
 #include "pool/LeakDetector.hxx"
 #include "lib/fmt/ToBuffer.hxx"
@@ -63,6 +69,12 @@ class InlineWidget final : PoolLeakDetector, HttpResponseHandler, Cancellable {
 
 	CancellablePointer cancel_ptr;
 
+	/**
+	 * The #WidgetFragmentCache key; its value is nullptr if the
+	 * widget response shall not be cached.
+	 */
+	StringWithHash fragment_key{nullptr};
+
 public:
 	InlineWidget(struct pool &_pool, SharedPoolPtr<WidgetContext> &&_ctx,
 		     const StopwatchPtr &_parent_stopwatch,
@@ -102,6 +114,14 @@ private:
 		_delayed.SetError(std::move(ep));
 	}
 
+	/**
+	 * Attempt to serve the widget from the #WidgetFragmentCache.
+	 *
+	 * @return true if the fragment was found (and this object
+	 * was destroyed)
+	 */
+	bool TryFragmentCache() noexcept;
+
 	void SendRequest() noexcept;
 	void ResolverCallback() noexcept;
 
@@ -216,6 +236,13 @@ InlineWidget::OnHttpResponse(HttpStatus status, StringMap &&headers,
 			return;
 		}
 
+		if (fragment_key.value.data() != nullptr &&
+		    !widget.fragment_uncacheable)
+			body = ctx->fragment_cache->Put(pool, fragment_key,
+							widget.cls->fragment_cache_tag,
+							widget.cls->fragment_max_age,
+							std::move(body));
+
 		auto &_delayed = delayed;
 		Destroy();
 		_delayed.Set(std::move(body));
@@ -260,6 +287,68 @@ InlineWidget::Cancel() noexcept
  *
  */
 
+/**
+ * Determine the "Accept-Language" which will be forwarded to the
+ * widget server; see forward_request_headers().
+ */
+static const char *
+GetForwardedLanguage(AllocatorPtr alloc, const WidgetContext &ctx) noexcept
+{
+	if (auto session = ctx.GetRealmSession();
+	    session && session->parent.language != nullptr)
+		return alloc.DupZ((std::string_view)session->parent.language);
+
+	return ctx.request_headers != nullptr
+		? ctx.request_headers->Get(accept_language_header)
+		: nullptr;
+}
+
+/**
+ * Determine the "User-Agent" which will be forwarded to the widget
+ * server if it is copied from the request; if it is not forwarded or
+ * mangled, it does not depend on the request.
+ */
+[[gnu::pure]]
+static const char *
+GetForwardedUserAgent(const WidgetView &view,
+		      const WidgetContext &ctx) noexcept
+{
+	using Group = HeaderForwardSettings::Group;
+	using Mode = HeaderForwardSettings::Mode;
+
+	if (view.request_header_forward[Group::CAPABILITIES] != Mode::YES ||
+	    ctx.request_headers == nullptr)
+		return nullptr;
+
+	return ctx.request_headers->Get(user_agent_header);
+}
+
+inline bool
+InlineWidget::TryFragmentCache() noexcept
+{
+	if (ctx->fragment_cache == nullptr || !IsFragmentCacheable(widget))
+		return false;
+
+	fragment_key = MakeFragmentKey(pool, widget,
+				       ctx->absolute_uri != nullptr
+				       ? ctx->absolute_uri : ctx->uri,
+				       GetForwardedLanguage(pool, *ctx),
+				       GetForwardedUserAgent(*widget.GetEffectiveView(),
+							     *ctx),
+				       plain_text);
+
+	auto body = ctx->fragment_cache->Get(pool, fragment_key);
+	if (!body)
+		return false;
+
+	/* splice the cached fragment into the template */
+	widget.Cancel();
+	auto &_delayed = delayed;
+	Destroy();
+	_delayed.Set(std::move(body));
+	return true;
+}
+
 void
 InlineWidget::SendRequest() noexcept
 try {
@@ -281,6 +370,9 @@ try {
 			widget.session_sync_pending = false;
 	}
 
+	if (TryFragmentCache())
+		return;
+
 	header_timeout_event.Schedule(inline_widget_header_timeout);
 	widget_http_request(pool, widget, ctx,
 			    parent_stopwatch,
@@ -13,6 +13,12 @@
 #include "io/Logger.hxx"
 #include "stopwatch.hxx"
 
+/**
+ * The lifetime of #WidgetFragmentCache items if the widget class
+ * enables the fragment cache without specifying EXPIRES_RELATIVE.
+ */
+static constexpr std::chrono::seconds default_fragment_max_age = std::chrono::minutes(1);
+
 static void
 widget_registry_lookup(struct pool &caller_pool, struct pool &widget_pool,
 		       TranslationService &service,
@@ -83,6 +89,23 @@ WidgetRegistryLookup::OnTranslateResponse(UniquePoolPtr<TranslateResponse> _resp
 	cls->cookie_host = response.cookie_host;
 	cls->group = response.widget_group;
 	cls->container_groups = std::move(response.container_groups);
+
+	/* the fragment cache must be enabled explicitly with
+	   EAGER_CACHE; the lifetime of fragments is EXPIRES_RELATIVE
+	   (MAX_AGE is the lifetime of this translation response and
+	   is therefore not used) */
+	if (response.eager_cache) {
+		const auto expires = response.GetExpiresRelative(false);
+		cls->fragment_max_age = expires > std::chrono::seconds::zero()
+			? expires
+			: default_fragment_max_age;
+
+		for (const char *tag : response.cache_tags) {
+			cls->fragment_cache_tag = tag;
+			break;
+		}
+	}
+
 	cls->direct_addressing = response.direct_addressing;
 	cls->stateful = response.stateful;
 	cls->require_csrf_token = response.require_csrf_token;
@@ -9,6 +9,7 @@
 #include "Context.hxx"
 #include "Error.hxx"
 #include "LookupHandler.hxx"
+#include "FragmentPolicy.hxx"
 #include "http/CommonHeaders.hxx"
 #include "http/ResponseHandler.hxx"
 #include "FilterStatus.hxx"
@@ -614,6 +615,10 @@ WidgetRequest::OnHttpResponse(HttpStatus status, StringMap &&headers,
 		}
 	}
 
+	if (ctx->fragment_cache != nullptr &&
+	    !IsFragmentCacheableResponse(headers))
+		widget.fragment_uncacheable = true;
+
 	if (http_status_is_redirect(status)) {
 		const char *location = headers.Get(location_header);
 		if (location != nullptr && HandleRedirect(location, body)) {
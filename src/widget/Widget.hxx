@@ -129,6 +129,13 @@ public:
 	 */
 	bool session_save_pending = false;
 
+	/**
+	 * This is set to true by the #WidgetRequest if a response
+	 * from the widget server must not be stored in the
+	 * #WidgetFragmentCache (see IsFragmentCacheableResponse()).
+	 */
+	bool fragment_uncacheable = false;
+
 	/**
 	 * Widget attributes specified by the template.  Some of them can
 	 * be overridden by the HTTP client.
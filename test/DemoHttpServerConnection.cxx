@@ -121,6 +121,21 @@ DemoHttpServerConnection::HandleHttpRequest(IncomingHttpRequest &request,
 							data));
 		break;
 
+	case Mode::CACHEABLE:
+		if (request.body)
+			NewNullSink(request.pool, std::move(request.body));
+
+		{
+			HttpHeaders headers;
+			headers.Write("cache-control", "max-age=3600");
+
+			request.SendResponse(HttpStatus::OK, std::move(headers),
+					     istream_memory_new(request.pool,
+								data));
+		}
+
+		break;
+
 	case Mode::HUGE_:
 		if (request.body)
 			NewNullSink(request.pool, std::move(request.body));
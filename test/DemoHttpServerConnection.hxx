@@ -40,6 +40,13 @@ public:
 
 		DUMMY,
 		FIXED,
+
+		/**
+		 * Like #FIXED, but the response may be cached by
+		 * clients for one hour.
+		 */
+		CACHEABLE,
+
 		HUGE_,
 		HOLD,
 		BLOCK,
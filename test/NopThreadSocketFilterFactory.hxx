@@ -7,8 +7,8 @@
 #include "fs/Factory.hxx"
 #include "fs/NopThreadSocketFilter.hxx"
 #include "fs/ThreadSocketFilter.hxx"
-#include "thread/Pool.hxx"
-#include "thread/Queue.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "thread/WorkerPool.hxx"
 
 class NopThreadSocketFilterFactory final : public SocketFilterFactory {
 	EventLoop &event_loop;
@@ -16,26 +16,26 @@ class NopThreadSocketFilterFactory final : public SocketFilterFactory {
 public:
 	explicit NopThreadSocketFilterFactory(EventLoop &_event_loop) noexcept
 		:event_loop(_event_loop) {
-		/* keep the eventfd unregistered if the ThreadQueue is
+		/* keep the eventfd unregistered if the WorkerPool is
 		   empty, so EventLoop::Dispatch() doesn't keep
 		   running after the HTTP request has completed */
-		thread_pool_set_volatile();
+		worker_pool_set_volatile();
 	}
 
 	~NopThreadSocketFilterFactory() noexcept override {
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	SocketFilterPtr CreateFilter() override {
 		return SocketFilterPtr{
-			new ThreadSocketFilter(thread_pool_get_queue(event_loop),
+			new ThreadSocketFilter(worker_pool_get(event_loop),
 					       std::make_unique<NopThreadSocketFilter>())
 		};
 	}
 
 	void Flush() noexcept {
-		thread_pool_get_queue(event_loop).FlushSynchronously();
+		worker_pool_get(event_loop).FlushSynchronously();
 	}
 };
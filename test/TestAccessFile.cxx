@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "bp/AccessFile.hxx"
+#include "bp/CredentialCache.hxx"
+
+#include <gtest/gtest.h>
+
+using std::string_view_literals::operator""sv;
+
+TEST(AccessFile, Parse)
+{
+	const auto map = ParseAccessFile("foo:$apr1$r31.....$HqJZimcKQFAMYayBlzkrA/\n"
+					 "  Bar:xyz  \n"
+					 "\n"
+					 "garbage\n"
+					 ":nouser\n"
+					 "FOO:second\n"
+					 "baz:"sv);
+	EXPECT_EQ(map.size(), 3U);
+
+	const auto *p = FindAccessFileUser(map, "foo"sv);
+	ASSERT_NE(p, nullptr);
+	EXPECT_EQ(*p, "$apr1$r31.....$HqJZimcKQFAMYayBlzkrA/");
+
+	p = FindAccessFileUser(map, "bAR"sv);
+	ASSERT_NE(p, nullptr);
+	EXPECT_EQ(*p, "xyz");
+
+	p = FindAccessFileUser(map, "baz"sv);
+	ASSERT_NE(p, nullptr);
+	EXPECT_EQ(*p, "");
+
+	EXPECT_EQ(FindAccessFileUser(map, "garbage"sv), nullptr);
+	EXPECT_EQ(FindAccessFileUser(map, ""sv), nullptr);
+}
+
+TEST(AccessFile, VerifyPassword)
+{
+	EXPECT_TRUE(VerifyPassword("$apr1$r31.....$HqJZimcKQFAMYayBlzkrA/",
+				   "myPassword"));
+	EXPECT_FALSE(VerifyPassword("$apr1$r31.....$HqJZimcKQFAMYayBlzkrA/",
+				    "wrong"));
+
+	EXPECT_TRUE(VerifyPassword("$6$saltsalt$TVLlQcbpFVof5W3Yz4DTP6gRstiNuHwwTt6GLc1E5n0U0aDehy0S5knV8wiOQSpT0Y77vwPZN.Pq.H91p5hVO1",
+				   "secret"));
+	EXPECT_FALSE(VerifyPassword("$6$saltsalt$TVLlQcbpFVof5W3Yz4DTP6gRstiNuHwwTt6GLc1E5n0U0aDehy0S5knV8wiOQSpT0Y77vwPZN.Pq.H91p5hVO1",
+				    "wrong"));
+
+	EXPECT_FALSE(VerifyPassword("", "secret"));
+}
+
+TEST(VerifiedCredentialCache, Basic)
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	VerifiedCredentialCache cache{std::chrono::minutes{1}};
+
+	const auto a = cache.MakeDigest("foo"sv, "secret"sv, "$1$x"sv);
+	EXPECT_EQ(a, cache.MakeDigest("foo"sv, "secret"sv, "$1$x"sv));
+
+	/* field boundaries are not ambiguous */
+	EXPECT_NE(a, cache.MakeDigest("foos"sv, "ecret"sv, "$1$x"sv));
+
+	/* a different crypted password (i.e. a modified entry in
+	   the password file) yields a different digest */
+	const auto b = cache.MakeDigest("foo"sv, "secret"sv, "$1$y"sv);
+	EXPECT_NE(a, b);
+
+	EXPECT_FALSE(cache.Contains(a, now));
+
+	cache.Add(a, now);
+	EXPECT_TRUE(cache.Contains(a, now));
+	EXPECT_TRUE(cache.Contains(a, now + std::chrono::seconds{59}));
+	EXPECT_FALSE(cache.Contains(a, now + std::chrono::minutes{1}));
+	EXPECT_FALSE(cache.Contains(b, now));
+
+	cache.Clear();
+	EXPECT_FALSE(cache.Contains(a, now));
+}
+
+TEST(VerifiedCredentialCache, Key)
+{
+	/* each instance has its own random key */
+	VerifiedCredentialCache a{std::chrono::minutes{1}};
+	VerifiedCredentialCache b{std::chrono::minutes{1}};
+
+	EXPECT_NE(a.MakeDigest("foo"sv, "secret"sv, "$1$x"sv),
+		  b.MakeDigest("foo"sv, "secret"sv, "$1$x"sv));
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "bp/AutoCompressPolicy.hxx"
+#include "istream/BrotliEncoderIstream.hxx"
+#include "istream/GzipIstream.hxx"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+static constexpr int_least64_t SMALL = 1024;
+static constexpr int_least64_t MEDIUM = 256 * 1024;
+static constexpr int_least64_t LARGE = 4 * 1024 * 1024;
+static constexpr int_least64_t UNKNOWN = -1;
+
+TEST(AutoCompressPolicy, Idle)
+{
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 0, SMALL),
+		  AutoCompressLevel::BEST);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 0, MEDIUM),
+		  AutoCompressLevel::MEDIUM);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 0, LARGE),
+		  AutoCompressLevel::MEDIUM);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 0, UNKNOWN),
+		  AutoCompressLevel::MEDIUM);
+}
+
+TEST(AutoCompressPolicy, Moderate)
+{
+	/* queue latency between "low" and "high" */
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(5ms, 0, SMALL),
+		  AutoCompressLevel::MEDIUM);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(5ms, 0, MEDIUM),
+		  AutoCompressLevel::MEDIUM);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(5ms, 0, LARGE),
+		  AutoCompressLevel::FAST);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(5ms, 0, UNKNOWN),
+		  AutoCompressLevel::FAST);
+
+	/* CPU pressure between "low" and "high" */
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 20, SMALL),
+		  AutoCompressLevel::MEDIUM);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 20, LARGE),
+		  AutoCompressLevel::FAST);
+}
+
+TEST(AutoCompressPolicy, High)
+{
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(50ms, 0, SMALL),
+		  AutoCompressLevel::FAST);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 50, SMALL),
+		  AutoCompressLevel::FAST);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(0ms, 50, UNKNOWN),
+		  AutoCompressLevel::FAST);
+}
+
+TEST(AutoCompressPolicy, Saturated)
+{
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(100ms, 0, SMALL),
+		  AutoCompressLevel::NONE);
+	EXPECT_EQ(AutoCompressPolicy::ChooseLevel(1s, 100, LARGE),
+		  AutoCompressLevel::NONE);
+}
+
+TEST(AutoCompressPolicy, BrotliParams)
+{
+	auto params = AutoCompressPolicy::ToBrotliParams(AutoCompressLevel::FAST, false);
+	EXPECT_EQ(params.quality, 1U);
+	EXPECT_FALSE(params.text_mode);
+
+	params = AutoCompressPolicy::ToBrotliParams(AutoCompressLevel::MEDIUM, true);
+	EXPECT_EQ(params.quality, BrotliEncoderParams{}.quality);
+	EXPECT_TRUE(params.text_mode);
+
+	params = AutoCompressPolicy::ToBrotliParams(AutoCompressLevel::BEST, true);
+	EXPECT_EQ(params.quality, 9U);
+	EXPECT_TRUE(params.text_mode);
+}
+
+TEST(AutoCompressPolicy, GzipParams)
+{
+	EXPECT_EQ(AutoCompressPolicy::ToGzipParams(AutoCompressLevel::FAST).level, 1);
+	EXPECT_EQ(AutoCompressPolicy::ToGzipParams(AutoCompressLevel::MEDIUM).level,
+		  GzipParams{}.level);
+	EXPECT_EQ(AutoCompressPolicy::ToGzipParams(AutoCompressLevel::BEST).level, 9);
+}
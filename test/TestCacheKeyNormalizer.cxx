@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "tconstruct.hxx"
+#include "TestPool.hxx"
+#include "http/cache/KeyNormalizer.hxx"
+#include "http/cache/KeyRules.hxx"
+#include "stats/HttpCacheKeyStats.hxx"
+#include "ResourceAddress.hxx"
+#include "http/Address.hxx"
+#include "cgi/Address.hxx"
+#include "AllocatorPtr.hxx"
+
+#include <gtest/gtest.h>
+
+static constexpr unsigned
+Bit(HttpCacheKeyRule rule) noexcept
+{
+	return 1U << static_cast<unsigned>(rule);
+}
+
+TEST(CacheKeyNormalizer, Disabled)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+	const HttpCacheKeyRules rules;
+
+	auto http = MakeHttpAddress("/a//b?z=1&a=2").Host("Example.COM");
+	const ResourceAddress address{http};
+
+	unsigned applied = ~0U;
+	const auto result = NormalizeCacheKeyAddress(alloc, address, rules, applied);
+	EXPECT_EQ(applied, 0U);
+	EXPECT_EQ(&result.GetHttp(), &http);
+}
+
+TEST(CacheKeyNormalizer, Unmodified)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.drop_query_params = {"utm_*"};
+	rules.sort_query = true;
+	rules.lowercase_host = true;
+	rules.normalize_uri = true;
+
+	/* all rules are enabled, but none of them changes anything */
+	auto http = MakeHttpAddress("/a/b?a=2&z=1").Host("example.com");
+	const ResourceAddress address{http};
+
+	unsigned applied = ~0U;
+	const auto result = NormalizeCacheKeyAddress(alloc, address, rules, applied);
+	EXPECT_EQ(applied, 0U);
+	EXPECT_EQ(&result.GetHttp(), &http);
+}
+
+TEST(CacheKeyNormalizer, DropQueryParams)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.drop_query_params = {"fbclid", "utm_*"};
+
+	auto http = MakeHttpAddress("/foo?utm_source=x&id=1&fbclid=y");
+	unsigned applied;
+	auto result = NormalizeCacheKeyAddress(alloc, ResourceAddress{http},
+					       rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::DROP_QUERY_PARAMS));
+	EXPECT_STREQ(result.GetHttp().path, "/foo?id=1");
+
+	/* the original address is not modified */
+	EXPECT_STREQ(http.path, "/foo?utm_source=x&id=1&fbclid=y");
+
+	/* the question mark is removed with the last parameter */
+	auto http2 = MakeHttpAddress("/foo?utm_source=x");
+	result = NormalizeCacheKeyAddress(alloc, ResourceAddress{http2},
+					  rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::DROP_QUERY_PARAMS));
+	EXPECT_STREQ(result.GetHttp().path, "/foo");
+}
+
+TEST(CacheKeyNormalizer, SortQuery)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.sort_query = true;
+
+	auto http = MakeHttpAddress("/foo?b=2&a=1&a=0");
+	unsigned applied;
+	const auto result = NormalizeCacheKeyAddress(alloc, ResourceAddress{http},
+						     rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::SORT_QUERY));
+
+	/* repeated parameters keep their order */
+	EXPECT_STREQ(result.GetHttp().path, "/foo?a=1&a=0&b=2");
+}
+
+TEST(CacheKeyNormalizer, LowercaseHost)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.lowercase_host = true;
+
+	auto http = MakeHttpAddress("/Foo").Host("Example.COM:8080");
+	unsigned applied;
+	const auto result = NormalizeCacheKeyAddress(alloc, ResourceAddress{http},
+						     rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::LOWERCASE_HOST));
+	EXPECT_STREQ(result.GetHttp().host_and_port, "example.com:8080");
+
+	/* the path is case sensitive */
+	EXPECT_STREQ(result.GetHttp().path, "/Foo");
+}
+
+TEST(CacheKeyNormalizer, NormalizeUri)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.normalize_uri = true;
+
+	auto http = MakeHttpAddress("/a//b/./%7ec?x=%41");
+	unsigned applied;
+	const auto result = NormalizeCacheKeyAddress(alloc, ResourceAddress{http},
+						     rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::NORMALIZE_URI));
+	EXPECT_STREQ(result.GetHttp().path, "/a/b/~c?x=A");
+}
+
+TEST(CacheKeyNormalizer, Combined)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.drop_query_params = {"utm_*"};
+	rules.sort_query = true;
+	rules.lowercase_host = true;
+
+	auto http = MakeHttpAddress("/foo?z=1&utm_source=x&a=2").Host("WWW.example.com");
+	unsigned applied;
+	const auto result = NormalizeCacheKeyAddress(alloc, ResourceAddress{http},
+						     rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::DROP_QUERY_PARAMS) |
+		  Bit(HttpCacheKeyRule::SORT_QUERY) |
+		  Bit(HttpCacheKeyRule::LOWERCASE_HOST));
+	EXPECT_STREQ(result.GetHttp().host_and_port, "www.example.com");
+	EXPECT_STREQ(result.GetHttp().path, "/foo?a=2&z=1");
+
+	/* variants of the same resource share one key */
+	auto http2 = MakeHttpAddress("/foo?a=2&utm_medium=y&z=1").Host("www.example.com");
+	const auto result2 = NormalizeCacheKeyAddress(alloc, ResourceAddress{http2},
+						      rules, applied);
+	EXPECT_EQ(result.GetId(alloc).value, result2.GetId(alloc).value);
+}
+
+TEST(CacheKeyNormalizer, Cgi)
+{
+	TestPool pool;
+	const AllocatorPtr alloc{pool};
+
+	HttpCacheKeyRules rules;
+	rules.drop_query_params = {"utm_*"};
+	rules.sort_query = true;
+
+	auto cgi = MakeCgiAddress(alloc, "/usr/lib/cgi-bin/foo.cgi",
+				  "/foo.cgi?b=1&utm_source=x&a=2");
+	cgi.query_string = "b=1&utm_source=x&a=2";
+
+	unsigned applied;
+	const auto result = NormalizeCacheKeyAddress(alloc,
+						     ResourceAddress{ResourceAddress::Type::CGI, cgi},
+						     rules, applied);
+	EXPECT_EQ(applied, Bit(HttpCacheKeyRule::DROP_QUERY_PARAMS) |
+		  Bit(HttpCacheKeyRule::SORT_QUERY));
+	EXPECT_EQ(result.type, ResourceAddress::Type::CGI);
+	EXPECT_STREQ(result.GetCgi().uri, "/foo.cgi?a=2&b=1");
+	EXPECT_STREQ(result.GetCgi().query_string, "a=2&b=1");
+	EXPECT_STREQ(result.GetCgi().path, "/usr/lib/cgi-bin/foo.cgi");
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ssl/CertLookup.hxx"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+struct Item {
+	std::string special;
+};
+
+using Map = std::multimap<std::string, std::shared_ptr<Item>, std::less<>>;
+
+struct Context {
+	Map map;
+
+	Item *Add(std::initializer_list<std::string_view> names,
+		  std::string_view special={}) {
+		auto item = std::make_shared<Item>(std::string{special});
+		for (const auto name : names)
+			map.emplace(name, item);
+		return item.get();
+	}
+};
+
+} // anonymous namespace
+
+TEST(CertLookup, Basic)
+{
+	Context c;
+
+	/* a primary item with shadow items for its altNames */
+	auto *a = c.Add({"a.example.com"sv, "www.a.example.com"sv});
+	auto *b = c.Add({"b.example.com"sv});
+
+	EXPECT_EQ(FindCertItem(c.map, "a.example.com"sv, {}), a);
+	EXPECT_EQ(FindCertItem(c.map, "www.a.example.com"sv, {}), a);
+	EXPECT_EQ(FindCertItem(c.map, "b.example.com"sv, {}), b);
+	EXPECT_EQ(FindCertItem(c.map, "c.example.com"sv, {}), nullptr);
+	EXPECT_EQ(FindCertItem(Map{}, "a.example.com"sv, {}), nullptr);
+}
+
+TEST(CertLookup, Special)
+{
+	Context c;
+
+	auto *plain = c.Add({"example.com"sv});
+	auto *rsa = c.Add({"example.com"sv}, "rsa"sv);
+
+	EXPECT_EQ(FindCertItem(c.map, "example.com"sv, {}), plain);
+	EXPECT_EQ(FindCertItem(c.map, "example.com"sv, "rsa"sv), rsa);
+	EXPECT_EQ(FindCertItem(c.map, "example.com"sv, "ecdsa"sv), nullptr);
+}
+
+TEST(CertLookup, Wildcard)
+{
+	Context c;
+
+	auto *wildcard = c.Add({"*.example.com"sv});
+	auto *exact = c.Add({"www.example.com"sv});
+
+	/* the exact match has precedence */
+	EXPECT_EQ(FindCertItem(c.map, "www.example.com"sv, "*.example.com"sv, {}),
+		  exact);
+	EXPECT_EQ(FindCertItem(c.map, "foo.example.com"sv, "*.example.com"sv, {}),
+		  wildcard);
+	EXPECT_EQ(FindCertItem(c.map, "foo.example.com"sv, {}, {}), nullptr);
+	EXPECT_EQ(FindCertItem(c.map, "foo.example.com"sv, "*.example.com"sv, "rsa"sv),
+		  nullptr);
+}
+
+/**
+ * A snapshot does not see items which were added after it was
+ * copied; those are found by the lookup in the (locked) map.
+ */
+TEST(CertLookup, Snapshot)
+{
+	Context c;
+
+	auto *a = c.Add({"a.example.com"sv});
+	const auto snapshot = std::make_shared<const Map>(c.map);
+
+	auto *b = c.Add({"b.example.com"sv});
+
+	EXPECT_EQ(FindCertItem(*snapshot, "a.example.com"sv, {}), a);
+	EXPECT_EQ(FindCertItem(*snapshot, "b.example.com"sv, {}), nullptr);
+	EXPECT_EQ(FindCertItem(c.map, "b.example.com"sv, {}), b);
+
+	/* items removed from the map stay alive while the snapshot
+	   refers to them */
+	c.map.clear();
+	EXPECT_EQ(FindCertItem(c.map, "a.example.com"sv, {}), nullptr);
+	EXPECT_EQ(FindCertItem(*snapshot, "a.example.com"sv, {}), a);
+	EXPECT_TRUE(a->special.empty());
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "bp/EarlyHintsCache.hxx"
+#include "PInstance.hxx"
+#include "AllocatorPtr.hxx"
+#include "strmap.hxx"
+#include "pool/pool.hxx"
+#include "pool/Ptr.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+struct Context : PInstance {
+	PoolPtr pool = pool_new_libc(root_pool, "test");
+
+	EarlyHintsCache cache{event_loop, 1024 * 1024};
+};
+
+} // anonymous namespace
+
+TEST(EarlyHintsCache, PutGet)
+{
+	Context c;
+
+	EXPECT_EQ(c.cache.Get("host/a"sv), ""sv);
+
+	c.cache.Put("host/a"sv, "</a.css>; rel=preload; as=style"sv);
+	EXPECT_EQ(c.cache.Get("host/a"sv), "</a.css>; rel=preload; as=style"sv);
+	EXPECT_EQ(c.cache.Get("host/b"sv), ""sv);
+	EXPECT_EQ(c.cache.Get("other/a"sv), ""sv);
+
+	/* a new value replaces the old one */
+	c.cache.Put("host/a"sv, "</b.js>; rel=preload; as=script"sv);
+	EXPECT_EQ(c.cache.Get("host/a"sv), "</b.js>; rel=preload; as=script"sv);
+
+	c.cache.Flush();
+	EXPECT_EQ(c.cache.Get("host/a"sv), ""sv);
+}
+
+TEST(EarlyHintsCache, Filter)
+{
+	Context c;
+
+	/* only "preload" and "preconnect" links are remembered */
+	c.cache.Put("host/a"sv,
+		    "</next>; rel=next, </a.css>; rel=preload; as=style"sv);
+	EXPECT_EQ(c.cache.Get("host/a"sv), "</a.css>; rel=preload; as=style"sv);
+
+	c.cache.Put("host/b"sv, "</next>; rel=next"sv);
+	EXPECT_EQ(c.cache.Get("host/b"sv), ""sv);
+}
+
+TEST(EarlyHintsCache, Forget)
+{
+	Context c;
+
+	c.cache.Put("host/a"sv, "</a.css>; rel=preload; as=style"sv);
+	ASSERT_NE(c.cache.Get("host/a"sv), ""sv);
+
+	/* a response without useful links removes the old ones */
+	c.cache.Put("host/a"sv, ""sv);
+	EXPECT_EQ(c.cache.Get("host/a"sv), ""sv);
+
+	c.cache.Put("host/a"sv, "</a.css>; rel=preload; as=style"sv);
+	ASSERT_NE(c.cache.Get("host/a"sv), ""sv);
+
+	c.cache.Put("host/a"sv, "</next>; rel=next"sv);
+	EXPECT_EQ(c.cache.Get("host/a"sv), ""sv);
+}
+
+TEST(EarlyHintsCache, TooLarge)
+{
+	Context c;
+
+	std::string link;
+	while (link.size() <= 4096)
+		link.append("</a.css>; rel=preload; as=style, ");
+	link.append("</b.css>; rel=preload; as=style");
+
+	c.cache.Put("host/a"sv, link);
+	EXPECT_EQ(c.cache.Get("host/a"sv), ""sv);
+}
+
+TEST(EarlyHintsCache, Sharable)
+{
+	Context c;
+	const AllocatorPtr alloc{*c.pool};
+
+	EXPECT_TRUE(IsEarlyHintsSharable(StringMap{}));
+	EXPECT_TRUE(IsEarlyHintsSharable(StringMap{alloc, {
+		{"link", "</a.css>; rel=preload; as=style"},
+		{"cache-control", "public, max-age=60"},
+	}}));
+
+	EXPECT_FALSE(IsEarlyHintsSharable(StringMap{alloc, {
+		{"cache-control", "private"},
+	}}));
+	EXPECT_FALSE(IsEarlyHintsSharable(StringMap{alloc, {
+		{"cache-control", "max-age=60, no-store"},
+	}}));
+	EXPECT_FALSE(IsEarlyHintsSharable(StringMap{alloc, {
+		{"cache-control", "public"},
+		{"cache-control", "no-cache"},
+	}}));
+	EXPECT_FALSE(IsEarlyHintsSharable(StringMap{alloc, {
+		{"set-cookie", "a=b"},
+	}}));
+	EXPECT_FALSE(IsEarlyHintsSharable(StringMap{alloc, {
+		{"set-cookie2", "a=b"},
+	}}));
+}
@@ -11,16 +11,19 @@
 #include "fs/NopThreadSocketFilter.hxx"
 #include "fs/ApproveThreadSocketFilter.hxx"
 #include "fs/ThreadSocketFilter.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "stats/ThreadSocketFilterStats.hxx"
 #include "memory/fb_pool.hxx"
 #include "event/Loop.hxx"
 #include "system/Error.hxx"
+#include "util/SpanCast.hxx"
 #include "net/SocketPair.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <string>
 
 #include <sys/socket.h>
 
@@ -33,10 +36,10 @@ struct Instance final {
 	const ScopeFbPoolInit fb_pool_init;
 
 	Instance() noexcept {
-		/* keep the eventfd unregistered if the ThreadQueue is
+		/* keep the eventfd unregistered if the WorkerPool is
 		   empty, so EventLoop::Dispatch() doesn't keep
 		   running after the HTTP request has completed */
-		thread_pool_set_volatile();
+		worker_pool_set_volatile();
 	}
 
 	~Instance() noexcept {
@@ -47,14 +50,14 @@ struct Instance final {
 		// TODO manually cancel "postponed_destroy" on shutdown
 		event_loop.Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	auto NewThreadSocketFilter(std::unique_ptr<ThreadSocketFilterHandler> handler) {
 		return SocketFilterPtr{
-			new ThreadSocketFilter(thread_pool_get_queue(event_loop),
+			new ThreadSocketFilter(worker_pool_get(event_loop),
 					       std::move(handler))
 		};
 	}
@@ -108,6 +111,138 @@ TEST(FilteredSocket, NopFilter)
 	EXPECT_EQ(handler.WaitRead(), "bar"sv);
 }
 
+/**
+ * Like #NopThreadSocketFilter, but small amounts of data are copied
+ * synchronously in the main thread.
+ */
+class InlineNopThreadSocketFilter final : public ThreadSocketFilterHandler {
+	static constexpr std::size_t THRESHOLD = 4096;
+
+public:
+	/* virtual methods from class ThreadSocketFilterHandler */
+	bool WantInlineRun(const ThreadSocketFilterInternal &f) const noexcept override {
+		const std::scoped_lock lock{f.mutex};
+		return f.plain_output.GetAvailable() +
+			f.encrypted_input.GetAvailable() <= THRESHOLD;
+	}
+
+	void Run(ThreadSocketFilterInternal &f) override {
+		const std::scoped_lock lock{f.mutex};
+		f.handshaking = false;
+		f.decrypted_input.MoveFromAllowBothNull(f.encrypted_input);
+		f.encrypted_output.MoveFromAllowBothNull(f.plain_output);
+	}
+};
+
+template<class Socket>
+static std::string
+WaitRead(TestBufferedSocketHandler<Socket> &handler, std::size_t size) noexcept
+{
+	std::string result;
+	while (result.size() < size)
+		result += handler.WaitRead();
+	return result;
+}
+
+TEST(FilteredSocket, InlineRun)
+{
+	Instance instance;
+
+	const auto before = GetThreadSocketFilterStats();
+
+	auto [s, echo] = NewEchoSocket(instance.event_loop);
+
+	FilteredSocket fs{instance.event_loop};
+	TestBufferedSocketHandler handler{fs};
+	fs.Init(std::move(s), FD_SOCKET, std::chrono::seconds{30},
+		instance.NewThreadSocketFilter(std::make_unique<InlineNopThreadSocketFilter>()),
+		handler);
+	fs.ScheduleRead();
+
+	handler.Write("foo"sv);
+	EXPECT_EQ(handler.WaitRead(), "foo"sv);
+
+	handler.Write("bar"sv);
+	EXPECT_EQ(handler.WaitRead(), "bar"sv);
+
+	/* no worker thread was involved */
+	const auto after = GetThreadSocketFilterStats();
+	EXPECT_GT(after.n_inline_runs, before.n_inline_runs);
+	EXPECT_EQ(after.n_offloaded_runs, before.n_offloaded_runs);
+}
+
+/**
+ * Large amounts of data are handed over to a worker thread, and
+ * subsequent small runs may be done inline again.
+ */
+TEST(FilteredSocket, InlineRunOffload)
+{
+	Instance instance;
+
+	auto [s, echo] = NewEchoSocket(instance.event_loop);
+
+	FilteredSocket fs{instance.event_loop};
+	TestBufferedSocketHandler handler{fs};
+	fs.Init(std::move(s), FD_SOCKET, std::chrono::seconds{30},
+		instance.NewThreadSocketFilter(std::make_unique<InlineNopThreadSocketFilter>()),
+		handler);
+	fs.ScheduleRead();
+
+	handler.Write("foo"sv);
+	EXPECT_EQ(handler.WaitRead(), "foo"sv);
+
+	const auto before = GetThreadSocketFilterStats();
+
+	const std::string large(64 * 1024, 'x');
+	handler.Write(large);
+	EXPECT_EQ(WaitRead(handler, large.size()), large);
+
+	const auto middle = GetThreadSocketFilterStats();
+	EXPECT_GT(middle.n_offloaded_runs, before.n_offloaded_runs);
+
+	handler.Write("bar"sv);
+	EXPECT_EQ(handler.WaitRead(), "bar"sv);
+
+	const auto after = GetThreadSocketFilterStats();
+	EXPECT_GT(after.n_inline_runs, middle.n_inline_runs);
+}
+
+/**
+ * More work arrives while the Done() call for an inline Run() is
+ * still pending; it must not be handed to a worker thread before
+ * that Done() call.
+ */
+TEST(FilteredSocket, InlineRunAgain)
+{
+	Instance instance;
+
+	auto [s, echo] = NewEchoSocket(instance.event_loop);
+
+	FilteredSocket fs{instance.event_loop};
+	TestBufferedSocketHandler handler{fs};
+	fs.Init(std::move(s), FD_SOCKET, std::chrono::seconds{30},
+		instance.NewThreadSocketFilter(std::make_unique<InlineNopThreadSocketFilter>()),
+		handler);
+	fs.ScheduleRead();
+
+	handler.Write("foo"sv);
+	EXPECT_EQ(handler.WaitRead(), "foo"sv);
+
+	const auto before = GetThreadSocketFilterStats();
+
+	/* the first Write() runs inline and defers Done(); the
+	   second one must wait for it */
+	const std::string large(8192, 'y');
+	EXPECT_EQ(fs.Write(AsBytes("bar"sv)), 3);
+	EXPECT_EQ(fs.Write(AsBytes(large)), static_cast<ssize_t>(large.size()));
+
+	EXPECT_EQ(WaitRead(handler, 3 + large.size()), "bar" + large);
+
+	const auto after = GetThreadSocketFilterStats();
+	EXPECT_GT(after.n_inline_runs, before.n_inline_runs);
+	EXPECT_GT(after.n_offloaded_runs, before.n_offloaded_runs);
+}
+
 TEST(FilteredSocket, Approve)
 {
 	Instance instance;
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "bp/GossipCodec.hxx"
+
+#include <sodium/crypto_auth.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+using Record = std::tuple<std::string, uint_least32_t, uint_least64_t>;
+
+/**
+ * An arbitrary wall clock time (in microseconds since the epoch).
+ */
+static constexpr uint_least64_t NOW = 1'700'000'000'000'000;
+
+static std::vector<Record>
+Parse(std::span<const std::byte> src, const BpGossipKey &key,
+      BpGossipReplayFilter &replay_filter, uint_least64_t now,
+      uint_least64_t &node_id, bool &valid)
+{
+	std::vector<Record> records;
+	valid = ParseBpGossip(src, key, replay_filter, now,
+			      node_id, [&records](std::string_view site,
+						  uint_least32_t requests,
+						  uint_least64_t traffic){
+		records.emplace_back(std::string{site}, requests, traffic);
+	});
+	return records;
+}
+
+static std::vector<Record>
+Parse(std::span<const std::byte> src, const BpGossipKey &key,
+      uint_least64_t &node_id, bool &valid)
+{
+	BpGossipReplayFilter replay_filter;
+	return Parse(src, key, replay_filter, NOW, node_id, valid);
+}
+
+TEST(GossipCodec, Basic)
+{
+	const auto key = MakeBpGossipKey("secret"sv);
+
+	BpGossipWriter w{key, 0x0123456789abcdef};
+	EXPECT_TRUE(w.IsEmpty());
+
+	EXPECT_TRUE(w.Append("foo"sv, 3, 42));
+	EXPECT_TRUE(w.Append("example.com"sv, 0, 0x100000000));
+	EXPECT_FALSE(w.IsEmpty());
+
+	uint_least64_t node_id = 0;
+	bool valid;
+	const auto records = Parse(w.Finish(NOW), key, node_id, valid);
+	EXPECT_TRUE(valid);
+	EXPECT_EQ(node_id, 0x0123456789abcdef);
+	ASSERT_EQ(records.size(), 2U);
+	EXPECT_EQ(records[0], Record("foo", 3, 42));
+	EXPECT_EQ(records[1], Record("example.com", 0, 0x100000000));
+
+	w.Clear();
+	EXPECT_TRUE(w.IsEmpty());
+	EXPECT_TRUE(Parse(w.Finish(NOW), key, node_id, valid).empty());
+	EXPECT_TRUE(valid);
+}
+
+TEST(GossipCodec, Full)
+{
+	const auto key = MakeBpGossipKey("secret"sv);
+
+	BpGossipWriter w{key, 1};
+
+	const std::string site(100, 'x');
+	unsigned n = 0;
+	while (w.Append(site, 1, 1))
+		++n;
+
+	EXPECT_EQ(n, (BP_GOSSIP_MAX_DATAGRAM - sizeof(BpGossipHeader) -
+		      BP_GOSSIP_MAC_SIZE) /
+		  (sizeof(BpGossipSiteHeader) + site.size()));
+
+	const auto datagram = w.Finish(NOW);
+	EXPECT_LE(datagram.size(), BP_GOSSIP_MAX_DATAGRAM);
+
+	uint_least64_t node_id;
+	bool valid;
+	EXPECT_EQ(Parse(datagram, key, node_id, valid).size(), n);
+	EXPECT_TRUE(valid);
+}
+
+TEST(GossipCodec, Malformed)
+{
+	const auto key = MakeBpGossipKey("secret"sv);
+
+	BpGossipWriter w{key, 1};
+	ASSERT_TRUE(w.Append("foo"sv, 1, 2));
+	const auto src = w.Finish(NOW);
+
+	uint_least64_t node_id;
+	bool valid;
+
+	/* too short for the header */
+	EXPECT_TRUE(Parse(src.first(sizeof(BpGossipHeader) - 1),
+			  key, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	/* truncated */
+	EXPECT_TRUE(Parse(src.first(src.size() - 1), key, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	/* modified */
+	auto copy = std::vector<std::byte>{src.begin(), src.end()};
+	copy[sizeof(BpGossipHeader) + 3] = std::byte{0xff};
+	EXPECT_TRUE(Parse(copy, key, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	/* wrong key */
+	EXPECT_TRUE(Parse(src, MakeBpGossipKey("wrong"sv),
+			  node_id, valid).empty());
+	EXPECT_FALSE(valid);
+}
+
+TEST(GossipCodec, ValidateBeforeApply)
+{
+	const auto key = MakeBpGossipKey("secret"sv);
+
+	BpGossipWriter w{key, 1};
+	ASSERT_TRUE(w.Append("foo"sv, 1, 2));
+	const auto src = w.Finish(NOW);
+
+	/* append a truncated record (which claims a longer site
+	   name than is present) and sign it: the datagram is
+	   authentic, but the first record must not be applied */
+	std::vector<std::byte> datagram{src.begin(),
+					src.end() - BP_GOSSIP_MAC_SIZE};
+
+	BpGossipSiteHeader bogus;
+	bogus.site_length = 10;
+	bogus.requests = 0xffffffff;
+	bogus.traffic = 0;
+	const auto *p = reinterpret_cast<const std::byte *>(&bogus);
+	datagram.insert(datagram.end(), p, p + sizeof(bogus));
+	datagram.push_back(std::byte{'x'});
+
+	const std::size_t payload_size = datagram.size();
+	datagram.resize(payload_size + BP_GOSSIP_MAC_SIZE);
+	crypto_auth(reinterpret_cast<unsigned char *>(datagram.data() + payload_size),
+		    reinterpret_cast<const unsigned char *>(datagram.data()),
+		    payload_size,
+		    reinterpret_cast<const unsigned char *>(key.data()));
+
+	uint_least64_t node_id;
+	bool valid;
+	EXPECT_TRUE(Parse(datagram, key, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+}
+
+TEST(GossipCodec, Replay)
+{
+	const auto key = MakeBpGossipKey("secret"sv);
+	BpGossipReplayFilter replay_filter;
+
+	BpGossipWriter w{key, 1};
+	ASSERT_TRUE(w.Append("foo"sv, 1, 2));
+	const auto first_span = w.Finish(NOW);
+	const std::vector<std::byte> first{first_span.begin(), first_span.end()};
+	const auto second_span = w.Finish(NOW + 1);
+	const std::vector<std::byte> second{second_span.begin(), second_span.end()};
+
+	uint_least64_t node_id;
+	bool valid;
+
+	EXPECT_EQ(Parse(first, key, replay_filter, NOW, node_id, valid).size(), 1U);
+	EXPECT_TRUE(valid);
+
+	/* the same datagram again */
+	EXPECT_TRUE(Parse(first, key, replay_filter, NOW, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	EXPECT_EQ(Parse(second, key, replay_filter, NOW, node_id, valid).size(), 1U);
+	EXPECT_TRUE(valid);
+
+	/* out of order */
+	EXPECT_TRUE(Parse(first, key, replay_filter, NOW, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	/* another node may use the same timestamp */
+	BpGossipWriter w2{key, 2};
+	ASSERT_TRUE(w2.Append("foo"sv, 1, 2));
+	EXPECT_EQ(Parse(w2.Finish(NOW), key, replay_filter, NOW,
+			node_id, valid).size(), 1U);
+	EXPECT_TRUE(valid);
+	EXPECT_EQ(node_id, 2U);
+
+	/* after the node has been forgotten, its old datagrams are
+	   still rejected because they are too old */
+	const uint_least64_t later = NOW + BP_GOSSIP_MAX_AGE + 2;
+	replay_filter.Expire(later);
+	EXPECT_TRUE(Parse(second, key, replay_filter, later, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	/* a datagram from the far future */
+	BpGossipReplayFilter fresh_filter;
+	EXPECT_TRUE(Parse(second, key, fresh_filter,
+			  NOW - BP_GOSSIP_MAX_AGE - 1, node_id, valid).empty());
+	EXPECT_FALSE(valid);
+
+	/* a fresh filter accepts it within the time window */
+	EXPECT_EQ(Parse(second, key, fresh_filter,
+			NOW + BP_GOSSIP_MAX_AGE, node_id, valid).size(), 1U);
+	EXPECT_TRUE(valid);
+}
+
+TEST(GossipCodec, ReplayFilterExpire)
+{
+	BpGossipReplayFilter replay_filter;
+
+	EXPECT_TRUE(replay_filter.Check(1, NOW, NOW));
+	EXPECT_FALSE(replay_filter.Check(1, NOW, NOW));
+
+	/* still within the window: the node is remembered */
+	replay_filter.Expire(NOW + BP_GOSSIP_MAX_AGE);
+	EXPECT_FALSE(replay_filter.Check(1, NOW, NOW + BP_GOSSIP_MAX_AGE));
+	EXPECT_TRUE(replay_filter.Check(1, NOW + 1, NOW + BP_GOSSIP_MAX_AGE));
+
+	/* the node is forgotten, but the age check still applies */
+	replay_filter.Expire(NOW + 2 * BP_GOSSIP_MAX_AGE + 2);
+	EXPECT_FALSE(replay_filter.Check(1, NOW + 1, NOW + 2 * BP_GOSSIP_MAX_AGE + 2));
+	EXPECT_TRUE(replay_filter.Check(1, NOW + BP_GOSSIP_MAX_AGE + 2,
+					NOW + 2 * BP_GOSSIP_MAX_AGE + 2));
+}
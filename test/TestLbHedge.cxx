@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "lb/Hedge.hxx"
+#include "lb/ClusterConfig.hxx"
+
+#include <gtest/gtest.h>
+
+using std::chrono_literals::operator""ms;
+
+static LbClusterConfig
+MakeConfig(Event::Duration delay, unsigned budget=5) noexcept
+{
+	LbClusterConfig config{"test"};
+	config.hedge_delay = delay;
+	config.hedge_auto = delay == Event::Duration{};
+	config.hedge_budget = budget;
+	return config;
+}
+
+TEST(LbHedge, Budget)
+{
+	const auto config = MakeConfig(10ms);
+	LbHedge hedge{config};
+
+	/* a few hedges are allowed right from the start */
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{10ms});
+	EXPECT_TRUE(hedge.Acquire());
+
+	/* now the budget is exhausted */
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{});
+	EXPECT_FALSE(hedge.Acquire());
+
+	/* 5% budget: 20 requests earn one hedge */
+	for (unsigned i = 0; i < 19; ++i)
+		hedge.OnRequest();
+	EXPECT_FALSE(hedge.Acquire());
+
+	hedge.OnRequest();
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{10ms});
+	EXPECT_TRUE(hedge.Acquire());
+	EXPECT_FALSE(hedge.Acquire());
+
+	/* a dropped hedge gives its budget back */
+	hedge.Refund();
+	EXPECT_TRUE(hedge.Acquire());
+	EXPECT_FALSE(hedge.Acquire());
+}
+
+TEST(LbHedge, MaxCredit)
+{
+	const auto config = MakeConfig(10ms, 100);
+	LbHedge hedge{config};
+
+	/* the credit is capped at 10 hedges, no matter how many
+	   requests have been seen */
+	for (unsigned i = 0; i < 1000; ++i)
+		hedge.OnRequest();
+
+	for (unsigned i = 0; i < 10; ++i)
+		EXPECT_TRUE(hedge.Acquire());
+	EXPECT_FALSE(hedge.Acquire());
+
+	/* Refund() is capped as well */
+	for (unsigned i = 0; i < 1000; ++i)
+		hedge.OnRequest();
+	hedge.Refund();
+
+	for (unsigned i = 0; i < 10; ++i)
+		EXPECT_TRUE(hedge.Acquire());
+	EXPECT_FALSE(hedge.Acquire());
+}
+
+TEST(LbHedge, MinSamples)
+{
+	const auto config = MakeConfig({});
+	LbHedge hedge{config};
+
+	/* no hedging in "auto" mode until 64 samples have been
+	   collected */
+	for (unsigned i = 0; i < 63; ++i) {
+		hedge.RecordLatency(5ms);
+		EXPECT_EQ(hedge.GetDelay(), Event::Duration{});
+	}
+
+	hedge.RecordLatency(5ms);
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{5ms});
+}
+
+TEST(LbHedge, Percentile)
+{
+	const auto config = MakeConfig({});
+	LbHedge hedge{config};
+
+	/* insert out of order to make sure the samples get sorted */
+	for (unsigned i = 64; i > 0; --i)
+		hedge.RecordLatency(std::chrono::milliseconds{i});
+
+	/* 95% of 64 samples are below the 61st one */
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{61ms});
+
+	/* the percentile is updated every 32 samples */
+	for (unsigned i = 0; i < 31; ++i)
+		hedge.RecordLatency(1000ms);
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{61ms});
+
+	hedge.RecordLatency(1000ms);
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{1000ms});
+}
+
+TEST(LbHedge, FixedDelay)
+{
+	const auto config = MakeConfig(20ms);
+	LbHedge hedge{config};
+
+	/* samples are ignored if a fixed delay is configured */
+	for (unsigned i = 0; i < 256; ++i)
+		hedge.RecordLatency(1ms);
+
+	EXPECT_EQ(hedge.GetDelay(), Event::Duration{20ms});
+}
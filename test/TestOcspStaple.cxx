@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ssl/OcspStaple.hxx"
+#include "lib/openssl/UniqueEVP.hxx"
+#include "lib/openssl/UniqueX509.hxx"
+
+#include <openssl/ocsp.h>
+#include <openssl/x509.h>
+
+#include <gtest/gtest.h>
+
+#include <forward_list>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h> // for AT_FDCWD
+#include <stdlib.h> // for mkdtemp()
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+class TempDirectory {
+	std::string path = "/tmp/TestOcspStaple.XXXXXX";
+
+	std::forward_list<std::string> files;
+
+public:
+	TempDirectory() noexcept {
+		if (mkdtemp(path.data()) == nullptr)
+			path.clear();
+	}
+
+	~TempDirectory() noexcept {
+		for (const auto &i : files)
+			unlink(i.c_str());
+		rmdir(path.c_str());
+	}
+
+	const char *c_str() const noexcept {
+		return path.c_str();
+	}
+
+	std::string Write(std::string_view name, std::string_view contents) noexcept {
+		std::string file_path = path + "/" + std::string{name};
+		int fd = open(file_path.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+		EXPECT_GE(fd, 0);
+		EXPECT_EQ(write(fd, contents.data(), contents.size()),
+			  static_cast<ssize_t>(contents.size()));
+		close(fd);
+
+		files.emplace_front(file_path);
+		return file_path;
+	}
+};
+
+struct Certificate {
+	UniqueEVP_PKEY key{EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256")};
+	UniqueX509 cert{X509_new()};
+
+	/**
+	 * Create a self-signed certificate with the given serial
+	 * number.
+	 */
+	explicit Certificate(long serial) noexcept {
+		ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), serial);
+
+		X509_NAME *name = X509_get_subject_name(cert.get());
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+					   reinterpret_cast<const unsigned char *>("example.com"),
+					   -1, -1, 0);
+		X509_set_issuer_name(cert.get(), name);
+
+		X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+		X509_gmtime_adj(X509_getm_notAfter(cert.get()), 86400);
+		X509_set_pubkey(cert.get(), key.get());
+		X509_sign(cert.get(), key.get(), EVP_sha256());
+	}
+
+	/**
+	 * Build a DER-encoded OCSP response for this certificate,
+	 * signed by the certificate itself.
+	 *
+	 * @param this_update the "thisUpdate" relative to now in seconds
+	 * @param next_update the "nextUpdate" relative to now in seconds
+	 */
+	std::string MakeOcspResponse(long this_update, long next_update,
+				     int status=OCSP_RESPONSE_STATUS_SUCCESSFUL) const noexcept {
+		OCSP_BASICRESP *basic = nullptr;
+
+		if (status == OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+			basic = OCSP_BASICRESP_new();
+
+			OCSP_CERTID *id = OCSP_cert_to_id(nullptr, cert.get(), cert.get());
+			ASN1_TIME *this_time = X509_gmtime_adj(nullptr, this_update);
+			ASN1_TIME *next_time = X509_gmtime_adj(nullptr, next_update);
+			EXPECT_NE(OCSP_basic_add1_status(basic, id,
+							 V_OCSP_CERTSTATUS_GOOD,
+							 0, nullptr,
+							 this_time, next_time),
+				  nullptr);
+			ASN1_TIME_free(next_time);
+			ASN1_TIME_free(this_time);
+			OCSP_CERTID_free(id);
+
+			EXPECT_EQ(OCSP_basic_sign(basic, cert.get(), key.get(),
+						  EVP_sha256(), nullptr, 0), 1);
+		}
+
+		OCSP_RESPONSE *response = OCSP_response_create(status, basic);
+		OCSP_BASICRESP_free(basic);
+
+		unsigned char *der = nullptr;
+		const int length = i2d_OCSP_RESPONSE(response, &der);
+		OCSP_RESPONSE_free(response);
+		EXPECT_GT(length, 0);
+
+		std::string result{reinterpret_cast<const char *>(der),
+				   static_cast<std::size_t>(length)};
+		OPENSSL_free(der);
+		return result;
+	}
+};
+
+} // anonymous namespace
+
+TEST(OcspStaple, Load)
+{
+	TempDirectory directory;
+	const Certificate c{0x1234};
+	const auto now = std::chrono::steady_clock::now();
+
+	directory.Write("1234.der"sv, c.MakeOcspResponse(-3600, 3600));
+
+	const auto staple = LoadOcspStaple(directory.c_str(), *c.cert, now);
+	ASSERT_TRUE(staple);
+	EXPECT_FALSE(staple->der.empty());
+
+	EXPECT_TRUE(staple->IsValid(now));
+	EXPECT_TRUE(staple->IsValid(now + std::chrono::minutes(59)));
+	EXPECT_FALSE(staple->IsValid(now + std::chrono::minutes(61)));
+
+	/* half of the validity period has elapsed already */
+	EXPECT_LE(staple->refresh, now + std::chrono::minutes(1));
+	EXPECT_GE(staple->refresh, now - std::chrono::minutes(1));
+}
+
+TEST(OcspStaple, Missing)
+{
+	const TempDirectory directory;
+	const Certificate c{0x1234};
+
+	EXPECT_FALSE(LoadOcspStaple(directory.c_str(), *c.cert,
+				    std::chrono::steady_clock::now()));
+}
+
+TEST(OcspStaple, WrongSerial)
+{
+	TempDirectory directory;
+	const Certificate a{0x1234}, b{0x5678};
+
+	/* the response for "b" was stored in the file for "a" */
+	directory.Write("1234.der"sv, b.MakeOcspResponse(-3600, 3600));
+
+	EXPECT_THROW(LoadOcspStaple(directory.c_str(), *a.cert,
+				    std::chrono::steady_clock::now()),
+		     std::runtime_error);
+}
+
+TEST(OcspStaple, Expired)
+{
+	TempDirectory directory;
+	const Certificate c{0x1234};
+
+	directory.Write("1234.der"sv, c.MakeOcspResponse(-7200, -3600));
+
+	EXPECT_THROW(LoadOcspStaple(directory.c_str(), *c.cert,
+				    std::chrono::steady_clock::now()),
+		     std::runtime_error);
+}
+
+TEST(OcspStaple, Unsuccessful)
+{
+	TempDirectory directory;
+	const Certificate c{0x1234};
+
+	directory.Write("1234.der"sv,
+			c.MakeOcspResponse(0, 0, OCSP_RESPONSE_STATUS_TRYLATER));
+
+	EXPECT_THROW(LoadOcspStaple(directory.c_str(), *c.cert,
+				    std::chrono::steady_clock::now()),
+		     std::runtime_error);
+}
+
+TEST(OcspStaple, Malformed)
+{
+	TempDirectory directory;
+	const Certificate c{0x1234};
+
+	directory.Write("1234.der"sv, "garbage"sv);
+
+	EXPECT_THROW(LoadOcspStaple(directory.c_str(), *c.cert,
+				    std::chrono::steady_clock::now()),
+		     std::runtime_error);
+}
+
+TEST(OcspStaple, Version)
+{
+	TempDirectory directory;
+	const Certificate c{0x1234};
+
+	EXPECT_EQ(GetOcspStapleVersion(directory.c_str(), *c.cert), 0U);
+
+	const auto path = directory.Write("1234.der"sv, "garbage"sv);
+	const auto version = GetOcspStapleVersion(directory.c_str(), *c.cert);
+	EXPECT_NE(version, 0U);
+	EXPECT_EQ(GetOcspStapleVersion(directory.c_str(), *c.cert), version);
+
+	/* modifying the file changes the version */
+	const struct timespec times[2]{{1000000000, 0}, {1000000000, 0}};
+	ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+	EXPECT_NE(GetOcspStapleVersion(directory.c_str(), *c.cert), version);
+}
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ssl/PrewarmList.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <fcntl.h>
+#include <stdlib.h> // for mkdtemp()
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+class TempDirectory {
+	std::string path = "/tmp/TestPrewarmList.XXXXXX";
+
+public:
+	TempDirectory() noexcept {
+		if (mkdtemp(path.data()) == nullptr)
+			path.clear();
+	}
+
+	~TempDirectory() noexcept {
+		unlink(GetFile().c_str());
+		rmdir(path.c_str());
+	}
+
+	std::string GetFile() const noexcept {
+		return path + "/prewarm";
+	}
+
+	void Write(std::string_view contents) const noexcept {
+		int fd = open(GetFile().c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(write(fd, contents.data(), contents.size()),
+			  static_cast<ssize_t>(contents.size()));
+		close(fd);
+	}
+};
+
+} // anonymous namespace
+
+TEST(PrewarmList, Select)
+{
+	const auto t = std::chrono::steady_clock::time_point{} + std::chrono::hours{1};
+
+	PrewarmCandidate candidates[]{
+		{t + std::chrono::seconds{2}, "b.example.com"sv},
+		{t + std::chrono::seconds{5}, "e.example.com"sv},
+		{t + std::chrono::seconds{1}, "a.example.com"sv},
+		{t + std::chrono::seconds{4}, "d.example.com"sv},
+		{t + std::chrono::seconds{3}, "c.example.com"sv},
+	};
+
+	/* the most recently used ones first */
+	EXPECT_EQ(SelectPrewarmNames(candidates, 100),
+		  (std::vector{
+			  "e.example.com"sv,
+			  "d.example.com"sv,
+			  "c.example.com"sv,
+			  "b.example.com"sv,
+			  "a.example.com"sv,
+		  }));
+
+	/* limited */
+	EXPECT_EQ(SelectPrewarmNames(candidates, 2),
+		  (std::vector{"e.example.com"sv, "d.example.com"sv}));
+	EXPECT_TRUE(SelectPrewarmNames(candidates, 0).empty());
+	EXPECT_TRUE(SelectPrewarmNames({}, 10).empty());
+}
+
+TEST(PrewarmList, SelectInvalid)
+{
+	const auto t = std::chrono::steady_clock::time_point{} + std::chrono::hours{1};
+
+	PrewarmCandidate candidates[]{
+		{t + std::chrono::seconds{3}, "evil\nexample.com"sv},
+		{t + std::chrono::seconds{2}, ""sv},
+		{t + std::chrono::seconds{1}, "a.example.com"sv},
+	};
+
+	/* invalid names do not count towards the limit */
+	EXPECT_EQ(SelectPrewarmNames(candidates, 1),
+		  (std::vector{"a.example.com"sv}));
+}
+
+TEST(PrewarmList, Missing)
+{
+	const TempDirectory directory;
+
+	EXPECT_TRUE(LoadPrewarmList(directory.GetFile().c_str(), 10).empty());
+}
+
+TEST(PrewarmList, SaveLoad)
+{
+	const TempDirectory directory;
+	const auto path = directory.GetFile();
+
+	const std::string_view names[]{
+		"c.example.com"sv,
+		"a.example.com"sv,
+		"b.example.com"sv,
+	};
+
+	SavePrewarmList(path.c_str(), names);
+
+	/* the order is preserved */
+	EXPECT_EQ(LoadPrewarmList(path.c_str(), 10),
+		  (std::vector<std::string>{
+			  "c.example.com",
+			  "a.example.com",
+			  "b.example.com",
+		  }));
+
+	/* limited */
+	EXPECT_EQ(LoadPrewarmList(path.c_str(), 2),
+		  (std::vector<std::string>{
+			  "c.example.com",
+			  "a.example.com",
+		  }));
+
+	/* saving again replaces the list */
+	SavePrewarmList(path.c_str(), std::span{names}.last(1));
+	EXPECT_EQ(LoadPrewarmList(path.c_str(), 10),
+		  (std::vector<std::string>{"b.example.com"}));
+}
+
+TEST(PrewarmList, LoadWhitespace)
+{
+	const TempDirectory directory;
+	directory.Write("\n  a.example.com \n\n\tb.example.com\nc.example.com\n"sv);
+
+	/* empty lines do not count towards the limit */
+	EXPECT_EQ(LoadPrewarmList(directory.GetFile().c_str(), 2),
+		  (std::vector<std::string>{
+			  "a.example.com",
+			  "b.example.com",
+		  }));
+	EXPECT_EQ(LoadPrewarmList(directory.GetFile().c_str(), 10).size(), 3U);
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "http/cache/Recompress.hxx"
+
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#ifdef HAVE_BROTLIDEC
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+
+#include <stdexcept>
+#include <string>
+
+using std::string_view_literals::operator""sv;
+
+static std::string
+MakeText()
+{
+	std::string s;
+	for (unsigned i = 0; i < 2000; ++i) {
+		s += "<p>The quick brown fox jumps over the lazy dog #";
+		s += std::to_string(i % 37);
+		s += "</p>\n";
+	}
+
+	return s;
+}
+
+static std::span<const std::byte>
+AsBytes(std::string_view s) noexcept
+{
+	return std::as_bytes(std::span{s});
+}
+
+static std::vector<std::byte>
+Gzip(std::string_view src, int level)
+{
+	z_stream z{};
+	if (deflateInit2(&z, level, Z_DEFLATED, MAX_WBITS + 16, 8,
+			 Z_DEFAULT_STRATEGY) != Z_OK)
+		throw std::runtime_error{"deflateInit2() failed"};
+
+	std::vector<std::byte> dest(deflateBound(&z, src.size()));
+	z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src.data()));
+	z.avail_in = src.size();
+	z.next_out = reinterpret_cast<Bytef *>(dest.data());
+	z.avail_out = dest.size();
+
+	int err = deflate(&z, Z_FINISH);
+	deflateEnd(&z);
+	if (err != Z_STREAM_END)
+		throw std::runtime_error{"deflate() failed"};
+
+	dest.resize(z.total_out);
+	return dest;
+}
+
+static std::string
+Gunzip(std::span<const std::byte> src)
+{
+	z_stream z{};
+	if (inflateInit2(&z, MAX_WBITS + 16) != Z_OK)
+		throw std::runtime_error{"inflateInit2() failed"};
+
+	std::string dest(1024 * 1024, '\0');
+	z.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(src.data()));
+	z.avail_in = src.size();
+	z.next_out = reinterpret_cast<Bytef *>(dest.data());
+	z.avail_out = dest.size();
+
+	int err = inflate(&z, Z_FINISH);
+	inflateEnd(&z);
+	if (err != Z_STREAM_END)
+		throw std::runtime_error{"inflate() failed"};
+
+	dest.resize(z.total_out);
+	return dest;
+}
+
+TEST(Recompress, CanRecompress)
+{
+	EXPECT_TRUE(CanRecompress("gzip"sv));
+	EXPECT_FALSE(CanRecompress("deflate"sv));
+	EXPECT_FALSE(CanRecompress(""sv));
+
+#ifdef HAVE_BROTLIDEC
+	EXPECT_TRUE(CanRecompress("br"sv));
+#else
+	EXPECT_FALSE(CanRecompress("br"sv));
+#endif
+}
+
+TEST(Recompress, Gzip)
+{
+	const auto text = MakeText();
+	const auto fast = Gzip(text, 1);
+
+	const auto best = RecompressBest("gzip"sv, fast, true, 1024 * 1024);
+	EXPECT_LE(best.size(), fast.size());
+	EXPECT_EQ(Gunzip(best), text);
+}
+
+TEST(Recompress, GzipEmpty)
+{
+	const auto empty = Gzip({}, 1);
+	const auto best = RecompressBest("gzip"sv, empty, false, 1024);
+	EXPECT_EQ(Gunzip(best), "");
+}
+
+TEST(Recompress, GzipTooLarge)
+{
+	const auto text = MakeText();
+	const auto fast = Gzip(text, 1);
+
+	EXPECT_THROW(RecompressBest("gzip"sv, fast, true, text.size() / 2),
+		     std::runtime_error);
+}
+
+TEST(Recompress, GzipMalformed)
+{
+	const auto text = MakeText();
+	const auto fast = Gzip(text, 1);
+
+	/* truncated */
+	EXPECT_ANY_THROW(RecompressBest("gzip"sv,
+					std::span{fast}.first(fast.size() / 2),
+					true, 1024 * 1024));
+
+	/* not gzip at all */
+	EXPECT_ANY_THROW(RecompressBest("gzip"sv, AsBytes(text),
+					true, 1024 * 1024));
+}
+
+TEST(Recompress, Unsupported)
+{
+	const auto text = MakeText();
+
+	EXPECT_THROW(RecompressBest("deflate"sv, AsBytes(text),
+				    false, 1024 * 1024),
+		     std::invalid_argument);
+
+#ifndef HAVE_BROTLIDEC
+	EXPECT_THROW(RecompressBest("br"sv, AsBytes(text),
+				    false, 1024 * 1024),
+		     std::invalid_argument);
+#endif
+}
+
+#ifdef HAVE_BROTLIDEC
+
+static std::vector<std::byte>
+BrotliFast(std::string_view src)
+{
+	std::vector<std::byte> dest(BrotliEncoderMaxCompressedSize(src.size()));
+	std::size_t size = dest.size();
+	if (!BrotliEncoderCompress(1, BROTLI_DEFAULT_WINDOW,
+				   BROTLI_MODE_GENERIC,
+				   src.size(),
+				   reinterpret_cast<const uint8_t *>(src.data()),
+				   &size,
+				   reinterpret_cast<uint8_t *>(dest.data())))
+		throw std::runtime_error{"Brotli error"};
+
+	dest.resize(size);
+	return dest;
+}
+
+static std::string
+BrotliDecode(std::span<const std::byte> src)
+{
+	std::string dest(1024 * 1024, '\0');
+	std::size_t size = dest.size();
+	if (BrotliDecoderDecompress(src.size(),
+				    reinterpret_cast<const uint8_t *>(src.data()),
+				    &size,
+				    reinterpret_cast<uint8_t *>(dest.data())) != BROTLI_DECODER_RESULT_SUCCESS)
+		throw std::runtime_error{"Brotli decoder error"};
+
+	dest.resize(size);
+	return dest;
+}
+
+TEST(Recompress, Brotli)
+{
+	const auto text = MakeText();
+	const auto fast = BrotliFast(text);
+
+	for (const bool text_mode : {false, true}) {
+		const auto best = RecompressBest("br"sv, fast, text_mode,
+						 1024 * 1024);
+		EXPECT_LE(best.size(), fast.size());
+		EXPECT_EQ(BrotliDecode(best), text);
+	}
+
+	EXPECT_THROW(RecompressBest("br"sv, fast, true, text.size() / 2),
+		     std::runtime_error);
+	EXPECT_THROW(RecompressBest("br"sv,
+				    std::span{fast}.first(fast.size() / 2),
+				    true, 1024 * 1024),
+		     std::runtime_error);
+}
+
+#endif // HAVE_BROTLIDEC
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "bp/session/SharedStore.hxx"
+#include "bp/session/Id.hxx"
+#include "bp/session/Prng.hxx"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdlib.h> // for mkstemp()
+#include <unistd.h>
+
+static constexpr std::size_t STORE_SIZE = 1024 * 1024;
+
+namespace {
+
+class TempPath {
+	std::string path = "/tmp/TestSharedSessionStore.XXXXXX";
+
+public:
+	TempPath() noexcept {
+		int fd = mkstemp(path.data());
+		if (fd >= 0)
+			close(fd);
+	}
+
+	~TempPath() noexcept {
+		unlink(path.c_str());
+	}
+
+	const char *c_str() const noexcept {
+		return path.c_str();
+	}
+};
+
+}
+
+static SessionId
+MakeId(SessionPrng &prng) noexcept
+{
+	SessionId id;
+	id.Generate(prng);
+	return id;
+}
+
+static std::vector<std::byte>
+MakeRecord(std::size_t size, std::byte fill) noexcept
+{
+	return std::vector<std::byte>(size, fill);
+}
+
+TEST(SharedSessionStore, Basic)
+{
+	const TempPath path;
+	SharedSessionStore store{path.c_str(), STORE_SIZE};
+
+	SessionPrng prng;
+	const auto id = MakeId(prng);
+	const auto now = std::chrono::steady_clock::now();
+	const auto expires = now + std::chrono::minutes{1};
+
+	std::vector<std::byte> dest;
+	EXPECT_EQ(store.GetHash(id, now), 0U);
+	EXPECT_EQ(store.Get(id, now, dest), 0U);
+
+	const auto a = MakeRecord(100, std::byte{'a'});
+	const auto hash_a = SharedSessionStore::CalcHash(a);
+	ASSERT_NE(hash_a, 0U);
+	ASSERT_TRUE(store.Put(id, a, hash_a, expires));
+
+	EXPECT_EQ(store.GetHash(id, now), hash_a);
+	EXPECT_EQ(store.Get(id, now, dest), hash_a);
+	EXPECT_EQ(dest, a);
+
+	/* expired */
+	EXPECT_EQ(store.GetHash(id, expires), 0U);
+	EXPECT_EQ(store.Get(id, expires, dest), 0U);
+
+	/* replace */
+	const auto b = MakeRecord(200, std::byte{'b'});
+	const auto hash_b = SharedSessionStore::CalcHash(b);
+	ASSERT_NE(hash_b, hash_a);
+	ASSERT_TRUE(store.Put(id, b, hash_b, expires));
+	EXPECT_EQ(store.Get(id, now, dest), hash_b);
+	EXPECT_EQ(dest, b);
+
+	/* another session */
+	const auto id2 = MakeId(prng);
+	EXPECT_EQ(store.GetHash(id2, now), 0U);
+	ASSERT_TRUE(store.Put(id2, a, hash_a, expires));
+	EXPECT_EQ(store.Get(id2, now, dest), hash_a);
+	EXPECT_EQ(dest, a);
+	EXPECT_EQ(store.Get(id, now, dest), hash_b);
+	EXPECT_EQ(dest, b);
+
+	store.Remove(id);
+	EXPECT_EQ(store.GetHash(id, now), 0U);
+	EXPECT_EQ(store.GetHash(id2, now), hash_a);
+}
+
+TEST(SharedSessionStore, Refresh)
+{
+	const TempPath path;
+	SharedSessionStore store{path.c_str(), STORE_SIZE};
+
+	SessionPrng prng;
+	const auto id = MakeId(prng);
+	const auto now = std::chrono::steady_clock::now();
+
+	/* the first bytes are volatile and are not hashed */
+	auto a = MakeRecord(100, std::byte{'a'});
+	const auto hash = SharedSessionStore::CalcHash(a, 8);
+	ASSERT_TRUE(store.Put(id, a, hash, now + std::chrono::minutes{1}));
+
+	a[0] = std::byte{'x'};
+	ASSERT_EQ(SharedSessionStore::CalcHash(a, 8), hash);
+	ASSERT_TRUE(store.Put(id, a, hash, now + std::chrono::minutes{2}));
+
+	/* same hash: only the expiry has been refreshed, the old
+	   record is still there */
+	std::vector<std::byte> dest;
+	const auto later = now + std::chrono::seconds{90};
+	EXPECT_EQ(store.Get(id, later, dest), hash);
+	EXPECT_EQ(dest[0], std::byte{'a'});
+}
+
+TEST(SharedSessionStore, Shared)
+{
+	const TempPath path;
+
+	SessionPrng prng;
+	const auto id = MakeId(prng);
+	const auto now = std::chrono::steady_clock::now();
+	const auto a = MakeRecord(100, std::byte{'a'});
+	const auto hash = SharedSessionStore::CalcHash(a);
+
+	SharedSessionStore store1{path.c_str(), STORE_SIZE};
+	ASSERT_TRUE(store1.Put(id, a, hash, now + std::chrono::minutes{1}));
+
+	/* a second mapping of the same file sees the record */
+	SharedSessionStore store2{path.c_str(), STORE_SIZE};
+	std::vector<std::byte> dest;
+	EXPECT_EQ(store2.Get(id, now, dest), hash);
+	EXPECT_EQ(dest, a);
+
+	store2.Remove(id);
+	EXPECT_EQ(store1.GetHash(id, now), 0U);
+}
+
+TEST(SharedSessionStore, Resize)
+{
+	const TempPath path;
+
+	SessionPrng prng;
+	const auto id = MakeId(prng);
+	const auto now = std::chrono::steady_clock::now();
+	const auto a = MakeRecord(100, std::byte{'a'});
+	const auto hash = SharedSessionStore::CalcHash(a);
+
+	{
+		SharedSessionStore store{path.c_str(), STORE_SIZE};
+		ASSERT_TRUE(store.Put(id, a, hash, now + std::chrono::minutes{1}));
+	}
+
+	{
+		/* same size: the record survives */
+		SharedSessionStore store{path.c_str(), STORE_SIZE};
+		EXPECT_EQ(store.GetHash(id, now), hash);
+	}
+
+	/* different size: an existing store is never cleared
+	   because other processes may be using it */
+	EXPECT_THROW(SharedSessionStore(path.c_str(), STORE_SIZE * 2),
+		     std::runtime_error);
+
+	SharedSessionStore store{path.c_str(), STORE_SIZE};
+	EXPECT_EQ(store.GetHash(id, now), hash);
+}
+
+TEST(SharedSessionStore, Wrap)
+{
+	const TempPath path;
+	SharedSessionStore store{path.c_str(), STORE_SIZE};
+
+	SessionPrng prng;
+	const auto id = MakeId(prng);
+	const auto now = std::chrono::steady_clock::now();
+	const auto expires = now + std::chrono::minutes{1};
+
+	const auto a = MakeRecord(100, std::byte{'a'});
+	const auto hash_a = SharedSessionStore::CalcHash(a);
+	ASSERT_TRUE(store.Put(id, a, hash_a, expires));
+
+	/* too large */
+	const auto huge = MakeRecord(STORE_SIZE / 2, std::byte{'h'});
+	EXPECT_FALSE(store.Put(MakeId(prng), huge,
+			       SharedSessionStore::CalcHash(huge), expires));
+	EXPECT_EQ(store.GetHash(id, now), hash_a);
+
+	/* fill the arena until it wraps around and overwrites the
+	   first record */
+	const auto big = MakeRecord(STORE_SIZE / 8, std::byte{'b'});
+	const auto hash_big = SharedSessionStore::CalcHash(big);
+	for (unsigned i = 0; i < 10; ++i)
+		ASSERT_TRUE(store.Put(MakeId(prng), big, hash_big, expires));
+
+	std::vector<std::byte> dest;
+	EXPECT_EQ(store.GetHash(id, now), 0U);
+	EXPECT_EQ(store.Get(id, now, dest), 0U);
+}
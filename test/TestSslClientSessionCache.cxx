@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ssl/ClientSessionCache.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <stdio.h> // for snprintf()
+#include <time.h>
+
+using SessionPtr = SslClientSessionCache::SessionPtr;
+
+/**
+ * Create a resumable session (i.e. one with a session id) without a
+ * handshake.
+ */
+static SessionPtr
+MakeSession(int version, long timeout=300,
+	    time_t t=time(nullptr)) noexcept
+{
+	SessionPtr session{SSL_SESSION_new()};
+
+	static constexpr unsigned char id[] = "0123456789abcdef";
+	SSL_SESSION_set1_id(session.get(), id, sizeof(id) - 1);
+	SSL_SESSION_set_protocol_version(session.get(), version);
+	SSL_SESSION_set_time(session.get(), t);
+	SSL_SESSION_set_timeout(session.get(), timeout);
+	return session;
+}
+
+TEST(SslClientSessionCache, Miss)
+{
+	SslClientSessionCache cache;
+	EXPECT_EQ(cache.Get("foo"), nullptr);
+
+	/* sessions which cannot be resumed are not stored */
+	cache.Put("foo", SessionPtr{SSL_SESSION_new()});
+	EXPECT_EQ(cache.Get("foo"), nullptr);
+}
+
+TEST(SslClientSessionCache, Tls12Reuse)
+{
+	SslClientSessionCache cache;
+
+	auto session = MakeSession(TLS1_2_VERSION);
+	auto *const raw = session.get();
+	cache.Put("foo", std::move(session));
+
+	/* TLS 1.2 sessions may be resumed any number of times */
+	for (unsigned i = 0; i < 3; ++i) {
+		const auto s = cache.Get("foo");
+		EXPECT_EQ(s.get(), raw);
+	}
+
+	EXPECT_EQ(cache.Get("bar"), nullptr);
+}
+
+TEST(SslClientSessionCache, Tls13SingleUse)
+{
+	SslClientSessionCache cache;
+
+	auto session = MakeSession(TLS1_3_VERSION);
+	auto *const raw = session.get();
+	cache.Put("foo", std::move(session));
+
+	/* TLS 1.3 tickets are removed from the cache by Get() */
+	EXPECT_EQ(cache.Get("foo").get(), raw);
+	EXPECT_EQ(cache.Get("foo"), nullptr);
+}
+
+TEST(SslClientSessionCache, Replace)
+{
+	SslClientSessionCache cache;
+
+	cache.Put("foo", MakeSession(TLS1_2_VERSION));
+
+	auto session = MakeSession(TLS1_2_VERSION);
+	auto *const raw = session.get();
+	cache.Put("foo", std::move(session));
+
+	EXPECT_EQ(cache.Get("foo").get(), raw);
+}
+
+TEST(SslClientSessionCache, Expiry)
+{
+	SslClientSessionCache cache;
+
+	cache.Put("foo", MakeSession(TLS1_2_VERSION, 300,
+				     time(nullptr) - 600));
+	EXPECT_EQ(cache.Get("foo"), nullptr);
+
+	cache.Put("bar", MakeSession(TLS1_3_VERSION, 300,
+				     time(nullptr) - 600));
+	EXPECT_EQ(cache.Get("bar"), nullptr);
+}
+
+TEST(SslClientSessionCache, Flush)
+{
+	SslClientSessionCache cache;
+
+	cache.Put("foo", MakeSession(TLS1_2_VERSION));
+	cache.Flush();
+	EXPECT_EQ(cache.Get("foo"), nullptr);
+}
+
+TEST(SslClientSessionCache, MaxSize)
+{
+	SslClientSessionCache cache;
+
+	const auto MakeKey = [](std::size_t i){
+		char buffer[16];
+		snprintf(buffer, sizeof(buffer), "%08zu", i);
+		return std::string{buffer};
+	};
+
+	for (std::size_t i = 0; i < SslClientSessionCache::MAX_SIZE; ++i)
+		cache.Put(MakeKey(i), MakeSession(TLS1_2_VERSION));
+
+	/* replacing an existing destination does not evict anything */
+	cache.Put(MakeKey(0), MakeSession(TLS1_2_VERSION));
+	EXPECT_NE(cache.Get(MakeKey(0)), nullptr);
+
+	/* a new destination evicts one */
+	cache.Put("new", MakeSession(TLS1_2_VERSION));
+	EXPECT_NE(cache.Get("new"), nullptr);
+
+	std::size_t n = 0;
+	for (std::size_t i = 0; i < SslClientSessionCache::MAX_SIZE; ++i)
+		if (cache.Get(MakeKey(i)) != nullptr)
+			++n;
+
+	EXPECT_EQ(n, SslClientSessionCache::MAX_SIZE - 1);
+}
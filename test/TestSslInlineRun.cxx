@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "ssl/InlineRun.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(SslInlineRun, Threshold)
+{
+	EXPECT_TRUE(SslWantInlineRun(false, 0));
+	EXPECT_TRUE(SslWantInlineRun(false, 1));
+	EXPECT_TRUE(SslWantInlineRun(false, SSL_INLINE_RUN_THRESHOLD - 1));
+	EXPECT_TRUE(SslWantInlineRun(false, SSL_INLINE_RUN_THRESHOLD));
+	EXPECT_FALSE(SslWantInlineRun(false, SSL_INLINE_RUN_THRESHOLD + 1));
+	EXPECT_FALSE(SslWantInlineRun(false, 1024 * 1024));
+}
+
+TEST(SslInlineRun, Handshake)
+{
+	/* the handshake is never done inline, no matter how little
+	   data is pending */
+	EXPECT_FALSE(SslWantInlineRun(true, 0));
+	EXPECT_FALSE(SslWantInlineRun(true, 1));
+	EXPECT_FALSE(SslWantInlineRun(true, SSL_INLINE_RUN_THRESHOLD));
+}
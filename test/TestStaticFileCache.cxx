@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "TestInstance.hxx"
+#include "FlushEventLoop.hxx"
+#include "RecordingStringSinkHandler.hxx"
+#include "bp/StaticFileCache.hxx"
+#include "file/Headers.hxx"
+#include "istream/istream_string.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "pool/pool.hxx"
+#include "pool/Ptr.hxx"
+#include "io/FileDescriptor.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include <fcntl.h> // for AT_EMPTY_PATH
+#include <stdlib.h> // for mkstemp()
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+static constexpr const char *CONTENT_TYPE = "text/plain";
+
+namespace {
+
+class TempFile {
+	std::string path = "/tmp/TestStaticFileCache.XXXXXX";
+
+public:
+	explicit TempFile(std::string_view contents) noexcept {
+		int fd = mkstemp(path.data());
+		if (fd >= 0)
+			close(fd);
+
+		Write(contents);
+	}
+
+	~TempFile() noexcept {
+		unlink(path.c_str());
+	}
+
+	std::string_view GetPath() const noexcept {
+		return path;
+	}
+
+	void Write(std::string_view contents) const noexcept {
+		int fd = open(path.c_str(), O_WRONLY|O_TRUNC|O_CLOEXEC);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(write(fd, contents.data(), contents.size()),
+			  static_cast<ssize_t>(contents.size()));
+		close(fd);
+	}
+
+	UniqueFileDescriptor Open() const noexcept {
+		return UniqueFileDescriptor{open(path.c_str(), O_RDONLY|O_CLOEXEC)};
+	}
+};
+
+struct Context : TestInstance {
+	PoolPtr pool = pool_new_libc(root_pool, "test");
+
+	StaticFileCache cache{event_loop, 1024 * 1024};
+
+	~Context() noexcept {
+		cache.BeginShutdown();
+	}
+
+	std::string ReadAll(UnusedIstreamPtr i) noexcept {
+		RecordingStringSinkHandler handler;
+		auto &sink = NewStringSink(*pool, std::move(i),
+					   handler, handler.cancel_ptr);
+		ReadStringSink(sink);
+		FlushPending(event_loop);
+
+		EXPECT_FALSE(handler.IsAlive());
+		return std::move(handler).TakeValue();
+	}
+
+	/**
+	 * Simulate a cache miss: send the file to the "client" while
+	 * copying it into the cache.
+	 */
+	std::string Put(const TempFile &file, std::string_view contents,
+			bool beneath=false) noexcept {
+		auto fd = file.Open();
+		EXPECT_TRUE(fd.IsDefined());
+
+		struct statx st;
+		EXPECT_EQ(statx(fd.Get(), "", AT_EMPTY_PATH,
+				STATX_TYPE|STATX_INO|STATX_MTIME|STATX_SIZE,
+				&st), 0);
+
+		return Put(file, fd, st, contents, beneath);
+	}
+
+	std::string Put(const TempFile &file, FileDescriptor fd,
+			const struct statx &st, std::string_view contents,
+			bool beneath=false) noexcept {
+		return ReadAll(cache.Put(*pool, file.GetPath(), beneath,
+					 CONTENT_TYPE, fd, st,
+					 istream_string_new(*pool, contents)));
+	}
+
+	StaticFileCache::Item *Get(const TempFile &file,
+				   bool beneath=false,
+				   const char *content_type=CONTENT_TYPE) noexcept {
+		return cache.Get(file.GetPath(), beneath, content_type);
+	}
+
+	std::string Read(StaticFileCache::Item &item,
+			 std::size_t start, std::size_t end) noexcept {
+		return ReadAll(cache.NewIstream(*pool, item, start, end));
+	}
+};
+
+} // anonymous namespace
+
+TEST(StaticFileCache, Hit)
+{
+	Context c;
+	const TempFile file{"0123456789"sv};
+
+	EXPECT_EQ(c.Get(file), nullptr);
+	EXPECT_EQ(c.Put(file, "0123456789"sv), "0123456789");
+
+	auto *item = c.Get(file);
+	ASSERT_NE(item, nullptr);
+	EXPECT_EQ(item->GetSize(), 10U);
+	EXPECT_EQ(c.Read(*item, 0, 10), "0123456789");
+
+	/* a second lookup returns the same item */
+	EXPECT_EQ(c.Get(file), item);
+
+	const auto stats = c.cache.GetStats();
+	EXPECT_EQ(stats.stores, 1U);
+	EXPECT_EQ(stats.hits, 2U);
+	EXPECT_EQ(stats.misses, 1U);
+}
+
+TEST(StaticFileCache, Mismatch)
+{
+	Context c;
+	const TempFile file{"foo"sv};
+
+	c.Put(file, "foo"sv);
+	ASSERT_NE(c.Get(file), nullptr);
+
+	/* loaded without RESOLVE_BENEATH, must not be used for a
+	   request which requires it */
+	EXPECT_EQ(c.Get(file, true), nullptr);
+
+	/* different Content-Type (which is part of the precomputed
+	   response headers) */
+	EXPECT_EQ(c.Get(file, false, "text/html"), nullptr);
+}
+
+TEST(StaticFileCache, Range)
+{
+	Context c;
+	const TempFile file{"0123456789"sv};
+
+	c.Put(file, "0123456789"sv);
+
+	auto *item = c.Get(file);
+	ASSERT_NE(item, nullptr);
+
+	EXPECT_EQ(c.Read(*item, 0, 1), "0");
+	EXPECT_EQ(c.Read(*item, 2, 5), "234");
+	EXPECT_EQ(c.Read(*item, 9, 10), "9");
+	EXPECT_EQ(c.Read(*item, 4, 4), "");
+}
+
+/**
+ * Conditional requests are evaluated with the cached statx and the
+ * cached response headers; they must match the file.
+ */
+TEST(StaticFileCache, Conditional)
+{
+	Context c;
+	const TempFile file{"foo"sv};
+
+	c.Put(file, "foo"sv);
+
+	auto *item = c.Get(file);
+	ASSERT_NE(item, nullptr);
+
+	auto fd = file.Open();
+	struct statx st;
+	ASSERT_EQ(statx(fd.Get(), "", AT_EMPTY_PATH,
+			STATX_INO|STATX_MTIME|STATX_SIZE, &st), 0);
+
+	const auto &cached = item->GetStatx();
+	EXPECT_EQ(cached.stx_ino, st.stx_ino);
+	EXPECT_EQ(cached.stx_size, st.stx_size);
+	EXPECT_EQ(cached.stx_mtime.tv_sec, st.stx_mtime.tv_sec);
+	EXPECT_EQ(cached.stx_mtime.tv_nsec, st.stx_mtime.tv_nsec);
+
+	char etag[256];
+	GetAnyETag(etag, st);
+
+	const auto headers = item->GetHeaders();
+	EXPECT_NE(headers.find(std::string{"etag: "} + etag + "\r\n"),
+		  headers.npos);
+	EXPECT_NE(headers.find("last-modified: "sv), headers.npos);
+	EXPECT_NE(headers.find("content-type: text/plain\r\n"sv), headers.npos);
+}
+
+TEST(StaticFileCache, InotifyModify)
+{
+	Context c;
+	const TempFile file{"foo"sv};
+
+	c.Put(file, "foo"sv);
+	ASSERT_NE(c.Get(file), nullptr);
+
+	file.Write("bar"sv);
+	FlushIO(c.event_loop);
+
+	EXPECT_EQ(c.Get(file), nullptr);
+
+	/* the new contents can be stored again */
+	EXPECT_EQ(c.Put(file, "bar"sv), "bar");
+
+	auto *item = c.Get(file);
+	ASSERT_NE(item, nullptr);
+	EXPECT_EQ(c.Read(*item, 0, 3), "bar");
+}
+
+TEST(StaticFileCache, InotifyDelete)
+{
+	Context c;
+	auto file = std::make_unique<TempFile>("foo"sv);
+
+	c.Put(*file, "foo"sv);
+	ASSERT_NE(c.Get(*file), nullptr);
+
+	const std::string path{file->GetPath()};
+	file.reset();
+	FlushIO(c.event_loop);
+
+	EXPECT_EQ(c.cache.Get(path, false, CONTENT_TYPE), nullptr);
+}
+
+/**
+ * An item which is still being read by a client survives its
+ * invalidation.
+ */
+TEST(StaticFileCache, InotifyWhileReading)
+{
+	Context c;
+	const TempFile file{"foo"sv};
+
+	c.Put(file, "foo"sv);
+
+	auto *item = c.Get(file);
+	ASSERT_NE(item, nullptr);
+	auto i = c.cache.NewIstream(*c.pool, *item, 0, 3);
+
+	file.Write("bar"sv);
+	FlushIO(c.event_loop);
+
+	EXPECT_EQ(c.Get(file), nullptr);
+	EXPECT_EQ(c.ReadAll(std::move(i)), "foo");
+}
+
+/**
+ * The given statx is stale (e.g. cached by #FdCache); the file must
+ * not be stored.
+ */
+TEST(StaticFileCache, Stale)
+{
+	Context c;
+	const TempFile file{"foo"sv};
+
+	auto fd = file.Open();
+	struct statx st;
+	ASSERT_EQ(statx(fd.Get(), "", AT_EMPTY_PATH,
+			STATX_INO|STATX_MTIME|STATX_SIZE, &st), 0);
+
+	file.Write("barbaz"sv);
+
+	EXPECT_EQ(c.Put(file, fd, st, "foo"sv), "foo");
+	EXPECT_EQ(c.Get(file), nullptr);
+	EXPECT_EQ(c.cache.GetStats().skips, 1U);
+}
+
+TEST(StaticFileCache, NotCacheable)
+{
+	Context c;
+
+	const TempFile empty{""sv};
+	EXPECT_EQ(c.Put(empty, ""sv), "");
+	EXPECT_EQ(c.Get(empty), nullptr);
+
+	const std::string large(512 * 1024, 'x');
+	const TempFile file{large};
+	EXPECT_EQ(c.Put(file, large), large);
+	EXPECT_EQ(c.Get(file), nullptr);
+
+	EXPECT_EQ(c.cache.GetStats().skips, 2U);
+}
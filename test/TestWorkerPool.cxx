@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "thread/WorkerPool.hxx"
+#include "stats/WorkerPoolStats.hxx"
+#include "event/Loop.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace {
+
+/**
+ * Allows the test to hold a job inside Run() until it is
+ * released.
+ */
+class Gate {
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool entered = false, open = true;
+
+public:
+	void Close() noexcept {
+		const std::scoped_lock lock{mutex};
+		open = false;
+	}
+
+	void Open() noexcept {
+		const std::scoped_lock lock{mutex};
+		open = true;
+		cond.notify_all();
+	}
+
+	/**
+	 * Called by Run() in the worker thread.
+	 */
+	void Pass() noexcept {
+		std::unique_lock lock{mutex};
+		entered = true;
+		cond.notify_all();
+		cond.wait(lock, [this]{ return open; });
+	}
+
+	/**
+	 * Wait until a worker thread has entered Pass().
+	 */
+	void WaitEntered() noexcept {
+		std::unique_lock lock{mutex};
+		cond.wait(lock, [this]{ return entered; });
+		entered = false;
+	}
+};
+
+struct MyJob final : WorkerJob {
+	Gate gate;
+
+	std::atomic_uint n_runs{0};
+	unsigned n_done = 0;
+
+	void Run() noexcept override {
+		gate.Pass();
+		++n_runs;
+	}
+
+	void Done() noexcept override {
+		++n_done;
+	}
+};
+
+struct Instance {
+	EventLoop event_loop;
+	WorkerPool pool;
+
+	explicit Instance(unsigned n_workers)
+		:pool(event_loop, n_workers)
+	{
+		/* let EventLoop::Run() return when all jobs are
+		   done */
+		pool.SetVolatile();
+		pool.Start();
+	}
+
+	~Instance() noexcept {
+		pool.Stop();
+		pool.Join();
+	}
+
+	/**
+	 * Wait until all Done() calls have been invoked.
+	 */
+	void Flush() noexcept {
+		event_loop.Run();
+	}
+};
+
+} // anonymous namespace
+
+TEST(WorkerPool, Basic)
+{
+	Instance instance{4};
+
+	MyJob jobs[32];
+	for (auto &i : jobs)
+		instance.pool.Add(i);
+
+	instance.Flush();
+
+	for (const auto &i : jobs) {
+		EXPECT_TRUE(i.IsIdle());
+		EXPECT_EQ(i.n_runs.load(), 1U);
+		EXPECT_EQ(i.n_done, 1U);
+	}
+
+	WorkerPoolStats stats;
+	instance.pool.GetStats(stats);
+	ASSERT_EQ(stats.workers.size(), 4U);
+
+	uint_least64_t n_jobs = 0;
+	for (const auto &i : stats.workers) {
+		n_jobs += i.n_jobs;
+		EXPECT_EQ(i.n_waiting, 0U);
+	}
+
+	EXPECT_EQ(n_jobs, std::size(jobs));
+}
+
+TEST(WorkerPool, CancelWaiting)
+{
+	Instance instance{1};
+
+	MyJob a, b;
+	a.gate.Close();
+	instance.pool.Add(a);
+	a.gate.WaitEntered();
+
+	/* the only worker is busy, so "b" is still waiting */
+	instance.pool.Add(b);
+	EXPECT_FALSE(b.IsIdle());
+	EXPECT_TRUE(instance.pool.Cancel(b));
+	EXPECT_TRUE(b.IsIdle());
+
+	/* cancelling an idle job is a no-op */
+	EXPECT_TRUE(instance.pool.Cancel(b));
+
+	a.gate.Open();
+	instance.Flush();
+
+	EXPECT_EQ(a.n_runs.load(), 1U);
+	EXPECT_EQ(a.n_done, 1U);
+	EXPECT_EQ(b.n_runs.load(), 0U);
+	EXPECT_EQ(b.n_done, 0U);
+}
+
+TEST(WorkerPool, CancelBusy)
+{
+	Instance instance{1};
+
+	MyJob a;
+	a.gate.Close();
+	instance.pool.Add(a);
+	a.gate.WaitEntered();
+
+	/* re-adding a running job schedules another run ... */
+	instance.pool.Add(a);
+
+	/* ... which is cancelled here; the running one cannot be
+	   cancelled, and Done() will still be called */
+	EXPECT_FALSE(instance.pool.Cancel(a));
+
+	a.gate.Open();
+	instance.Flush();
+
+	EXPECT_TRUE(a.IsIdle());
+	EXPECT_EQ(a.n_runs.load(), 1U);
+	EXPECT_EQ(a.n_done, 1U);
+}
+
+TEST(WorkerPool, AddAgain)
+{
+	Instance instance{1};
+
+	MyJob a, b;
+	a.gate.Close();
+	instance.pool.Add(a);
+	a.gate.WaitEntered();
+
+	/* adding a waiting job is a no-op */
+	instance.pool.Add(b);
+	instance.pool.Add(b);
+
+	/* adding a running job runs it again, but Done() is called
+	   only once */
+	instance.pool.Add(a);
+	instance.pool.Add(a);
+
+	a.gate.Open();
+	instance.Flush();
+
+	EXPECT_EQ(a.n_runs.load(), 2U);
+	EXPECT_EQ(a.n_done, 1U);
+	EXPECT_EQ(b.n_runs.load(), 1U);
+	EXPECT_EQ(b.n_done, 1U);
+
+	/* after Done(), the job can be added again */
+	instance.pool.Add(a);
+	instance.pool.Add(b);
+	instance.Flush();
+
+	EXPECT_EQ(a.n_runs.load(), 3U);
+	EXPECT_EQ(a.n_done, 2U);
+	EXPECT_EQ(b.n_runs.load(), 2U);
+	EXPECT_EQ(b.n_done, 2U);
+}
+
+/**
+ * A job waiting in the queue of a busy worker is stolen by an idle
+ * worker.
+ */
+TEST(WorkerPool, Steal)
+{
+	Instance instance{2};
+
+	/* new jobs are distributed round-robin: "a" and "c" go to
+	   the first worker, "b" to the second */
+	MyJob a, b, c;
+	a.gate.Close();
+	instance.pool.Add(a);
+	a.gate.WaitEntered();
+
+	instance.pool.Add(b);
+
+	c.gate.Close();
+	instance.pool.Add(c);
+
+	/* "c" runs while "a" still blocks the first worker */
+	c.gate.WaitEntered();
+	EXPECT_EQ(a.n_runs.load(), 0U);
+
+	c.gate.Open();
+	a.gate.Open();
+	instance.Flush();
+
+	EXPECT_EQ(a.n_done, 1U);
+	EXPECT_EQ(b.n_done, 1U);
+	EXPECT_EQ(c.n_done, 1U);
+
+	WorkerPoolStats stats;
+	instance.pool.GetStats(stats);
+	ASSERT_EQ(stats.workers.size(), 2U);
+	EXPECT_EQ(stats.workers[0].n_stolen, 0U);
+	EXPECT_EQ(stats.workers[1].n_stolen, 1U);
+	EXPECT_EQ(stats.workers[0].n_jobs, 1U);
+	EXPECT_EQ(stats.workers[1].n_jobs, 2U);
+}
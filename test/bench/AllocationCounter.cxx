@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "AllocationCounter.hxx"
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+
+/* these functions replace the glibc functions of the same name
+   (symbol interposition) and count each call; the actual work is
+   done by glibc's internal entry points */
+
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_calloc(std::size_t n, std::size_t size);
+extern "C" void *__libc_realloc(void *p, std::size_t size);
+
+static std::atomic<uint_least64_t> n_allocations;
+
+extern "C" void *
+malloc(std::size_t size)
+{
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void *
+calloc(std::size_t n, std::size_t size)
+{
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(n, size);
+}
+
+extern "C" void *
+realloc(void *p, std::size_t size)
+{
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(p, size);
+}
+
+bool
+HaveAllocationCounter() noexcept
+{
+	return true;
+}
+
+uint_least64_t
+GetAllocationCount() noexcept
+{
+	return n_allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool
+HaveAllocationCounter() noexcept
+{
+	return false;
+}
+
+uint_least64_t
+GetAllocationCount() noexcept
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Is GetAllocationCount() implemented on this platform?  It
+ * requires glibc, and it does not work with AddressSanitizer
+ * (which has its own malloc()).
+ */
+bool
+HaveAllocationCounter() noexcept;
+
+/**
+ * Returns the number of malloc()/calloc()/realloc() calls (in all
+ * threads) since the process was started.  This includes all C++
+ * "new" calls and all memory pool areas.
+ */
+uint_least64_t
+GetAllocationCount() noexcept;
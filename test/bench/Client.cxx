@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Client.hxx"
+#include "http/Client.hxx"
+#include "http/Method.hxx"
+#include "http/Status.hxx"
+#include "istream/NullSink.hxx"
+#include "istream/UnusedPtr.hxx"
+#include "memory/GrowingBuffer.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "pool/pool.hxx"
+#include "util/PrintException.hxx"
+#include "strmap.hxx"
+
+#include <cassert>
+
+BenchClient::BenchClient(struct pool &_parent_pool, EventLoop &event_loop,
+			 BenchClientHandler &_handler) noexcept
+	:parent_pool(_parent_pool), handler(_handler),
+	 socket(event_loop),
+	 defer_next(event_loop, BIND_THIS_METHOD(OnDeferredNext))
+{
+}
+
+BenchClient::~BenchClient() noexcept
+{
+	if (cancel_ptr)
+		cancel_ptr.Cancel();
+
+	if (connected)
+		Disconnect();
+}
+
+void
+BenchClient::Disconnect() noexcept
+{
+	assert(connected);
+
+	connected = false;
+
+	if (socket.IsConnected())
+		socket.Close();
+	socket.Destroy();
+}
+
+void
+BenchClient::SendRequest() noexcept
+{
+	request_pool = pool_new_linear(&parent_pool, "bench_request", 8192);
+
+	StringMap headers;
+	headers.Add(*request_pool, "host", "bench");
+	headers.Add(*request_pool, "accept-encoding", "gzip, br");
+
+	leased = true;
+	body_pending = false;
+	success = false;
+	start_time = BenchClientHandler::Clock::now();
+
+	http_client_request(*request_pool, nullptr, socket, *this,
+			    "beng-proxy",
+			    HttpMethod::GET,
+			    bench_path_uris[static_cast<std::size_t>(path)],
+			    headers, {},
+			    nullptr, false,
+			    *this, cancel_ptr);
+}
+
+void
+BenchClient::OnDeferredNext() noexcept
+{
+	const auto next = handler.NextRequest();
+	if (!next) {
+		if (connected)
+			Disconnect();
+
+		handler.OnClientFinished(*this);
+		return;
+	}
+
+	if (!connected) {
+		try {
+			socket.InitDummy(handler.Connect(), FdType::FD_SOCKET);
+		} catch (...) {
+			PrintException(std::current_exception());
+			handler.OnClientFinished(*this);
+			return;
+		}
+
+		connected = true;
+	}
+
+	path = *next;
+	SendRequest();
+}
+
+void
+BenchClient::MaybeFinishRequest() noexcept
+{
+	if (leased || body_pending)
+		return;
+
+	cancel_ptr = nullptr;
+	request_pool.reset();
+
+	handler.OnRequestFinished(path,
+				  BenchClientHandler::Clock::now() - start_time,
+				  success);
+
+	defer_next.Schedule();
+}
+
+void
+BenchClient::OnBodyEnd(std::exception_ptr &&error) noexcept
+{
+	assert(body_pending);
+
+	body_pending = false;
+
+	if (error) {
+		PrintException(error);
+		success = false;
+	}
+
+	MaybeFinishRequest();
+}
+
+PutAction
+BenchClient::ReleaseLease(PutAction action) noexcept
+{
+	assert(leased);
+
+	leased = false;
+
+	if (action == PutAction::DESTROY)
+		/* beng-proxy has closed the connection; the next
+		   request will open a new one */
+		Disconnect();
+
+	MaybeFinishRequest();
+	return action;
+}
+
+void
+BenchClient::OnHttpResponse(HttpStatus status, StringMap &&,
+			    UnusedIstreamPtr body) noexcept
+{
+	cancel_ptr = nullptr;
+	success = http_status_is_success(status);
+
+	if (body) {
+		body_pending = true;
+		auto &sink = NewNullSink(*request_pool, std::move(body),
+					 BIND_THIS_METHOD(OnBodyEnd));
+		ReadNullSink(sink);
+	} else
+		MaybeFinishRequest();
+}
+
+void
+BenchClient::OnHttpError(std::exception_ptr ep) noexcept
+{
+	cancel_ptr = nullptr;
+
+	PrintException(ep);
+	success = false;
+
+	MaybeFinishRequest();
+}
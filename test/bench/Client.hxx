@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Path.hxx"
+#include "lease.hxx"
+#include "http/ResponseHandler.hxx"
+#include "fs/FilteredSocket.hxx"
+#include "event/DeferEvent.hxx"
+#include "pool/Ptr.hxx"
+#include "util/Cancellable.hxx"
+
+#include <chrono>
+#include <optional>
+
+class UniqueSocketDescriptor;
+class BenchClient;
+
+class BenchClientHandler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * Choose the path of the next request.
+	 *
+	 * @return the path or std::nullopt if this client shall
+	 * stop
+	 */
+	virtual std::optional<BenchPath> NextRequest() noexcept = 0;
+
+	/**
+	 * A request has been completed (including the response
+	 * body).
+	 *
+	 * @param success true if the response status was 2xx and
+	 * the body was received completely
+	 */
+	virtual void OnRequestFinished(BenchPath path, Clock::duration duration,
+				       bool success) noexcept = 0;
+
+	/**
+	 * Open a new connection to beng-proxy.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the client side of the connection
+	 */
+	virtual UniqueSocketDescriptor Connect() = 0;
+
+	/**
+	 * The client has stopped (because NextRequest() returned
+	 * std::nullopt or because Connect() failed).
+	 */
+	virtual void OnClientFinished(BenchClient &client) noexcept = 0;
+};
+
+/**
+ * A HTTP/1.1 client which sends requests to beng-proxy one after
+ * the other over a kept-alive connection.
+ */
+class BenchClient final : Lease, HttpResponseHandler {
+	struct pool &parent_pool;
+
+	BenchClientHandler &handler;
+
+	FilteredSocket socket;
+
+	/**
+	 * Sends the next request outside of the stack frame which
+	 * finished the previous one.
+	 */
+	DeferEvent defer_next;
+
+	PoolPtr request_pool;
+
+	CancellablePointer cancel_ptr;
+
+	BenchClientHandler::Clock::time_point start_time;
+
+	BenchPath path;
+
+	bool connected = false;
+
+	/**
+	 * Is the HTTP client still using the #socket?
+	 */
+	bool leased = false;
+
+	/**
+	 * Is the response body still being received?
+	 */
+	bool body_pending = false;
+
+	bool success;
+
+public:
+	BenchClient(struct pool &_parent_pool, EventLoop &event_loop,
+		    BenchClientHandler &_handler) noexcept;
+	~BenchClient() noexcept;
+
+	BenchClient(const BenchClient &) = delete;
+	BenchClient &operator=(const BenchClient &) = delete;
+
+	void Start() noexcept {
+		defer_next.Schedule();
+	}
+
+private:
+	void Disconnect() noexcept;
+
+	void SendRequest() noexcept;
+	void OnDeferredNext() noexcept;
+
+	/**
+	 * Finish the current request if the response body has been
+	 * received and the socket lease has been released.
+	 */
+	void MaybeFinishRequest() noexcept;
+
+	void OnBodyEnd(std::exception_ptr &&error) noexcept;
+
+	/* virtual methods from class Lease */
+	PutAction ReleaseLease(PutAction action) noexcept override;
+
+	/* virtual methods from class HttpResponseHandler */
+	void OnHttpResponse(HttpStatus status, StringMap &&headers,
+			    UnusedIstreamPtr body) noexcept override;
+	void OnHttpError(std::exception_ptr ep) noexcept override;
+};
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "HttpBackend.hxx"
+#include "Socket.hxx"
+#include "pool/pool.hxx"
+#include "pool/Holder.hxx"
+#include "pool/UniquePtr.hxx"
+#include "fs/FilteredSocket.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/IntrusiveList.hxx"
+
+class BenchHttpBackendConnection final
+	: public AutoUnlinkIntrusiveListHook,
+	  PoolHolder,
+	  DemoHttpServerConnection
+{
+public:
+	BenchHttpBackendConnection(struct pool &parent_pool,
+				   EventLoop &event_loop, Mode _mode,
+				   UniqueSocketDescriptor &&fd,
+				   SocketAddress address) noexcept
+		:PoolHolder(pool_new_linear(&parent_pool, "bench_backend", 2048)),
+		 DemoHttpServerConnection(pool, event_loop,
+					  UniquePoolPtr<FilteredSocket>::Make(pool,
+									      event_loop,
+									      std::move(fd),
+									      FdType::FD_SOCKET),
+					  address, _mode) {}
+
+protected:
+	/* virtual methods from class HttpServerConnectionHandler */
+	void HttpConnectionError(std::exception_ptr e) noexcept override {
+		DemoHttpServerConnection::HttpConnectionError(std::move(e));
+		delete this;
+	}
+
+	void HttpConnectionClosed() noexcept override {
+		DemoHttpServerConnection::HttpConnectionClosed();
+		delete this;
+	}
+};
+
+BenchHttpBackend::BenchHttpBackend(struct pool &pool, EventLoop &event_loop,
+				   DemoHttpServerConnection::Mode mode)
+	:listener(std::make_unique<Listener>(event_loop,
+						 pool, event_loop, mode)),
+	 address(MakeBenchSocketAddress())
+{
+	listener->Listen(MakeBenchListener(address));
+}
+
+BenchHttpBackend::~BenchHttpBackend() noexcept = default;
+
+void
+BenchHttpBackend::Close() noexcept
+{
+	listener.reset();
+}
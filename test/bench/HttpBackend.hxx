@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "../DemoHttpServerConnection.hxx"
+#include "event/net/TemplateServerSocket.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+
+#include <memory>
+
+struct pool;
+class EventLoop;
+class BenchHttpBackendConnection;
+
+/**
+ * A HTTP server running in the benchmark process (using
+ * #DemoHttpServerConnection), listening on an abstract local
+ * socket.
+ */
+class BenchHttpBackend {
+	using Listener = TemplateServerSocket<BenchHttpBackendConnection,
+					      struct pool &, EventLoop &,
+					      DemoHttpServerConnection::Mode>;
+
+	std::unique_ptr<Listener> listener;
+
+	AllocatedSocketAddress address;
+
+public:
+	BenchHttpBackend(struct pool &pool, EventLoop &event_loop,
+			 DemoHttpServerConnection::Mode mode);
+	~BenchHttpBackend() noexcept;
+
+	SocketAddress GetAddress() const noexcept {
+		return address;
+	}
+
+	/**
+	 * Stop listening and close all connections.
+	 */
+	void Close() noexcept;
+};
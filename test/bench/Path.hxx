@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * The request handling paths which can be measured by the
+ * benchmark.  Each one has its own URI prefix which is recognized
+ * by #BenchTranslationService.
+ */
+enum class BenchPath : uint_least8_t {
+	/**
+	 * A static file.
+	 */
+	FILE,
+
+	/**
+	 * Proxy to an uncacheable HTTP backend.
+	 */
+	PROXY,
+
+	/**
+	 * Proxy to a cacheable HTTP backend; after the first
+	 * request, all responses are HTTP cache hits.
+	 */
+	CACHE,
+
+	/**
+	 * A static HTML file through the XML processor.
+	 */
+	PROCESSOR,
+
+	/**
+	 * A static text file with auto-compression.
+	 */
+	COMPRESS,
+
+	/**
+	 * A FastCGI application (only if one was specified on the
+	 * command line).
+	 */
+	FCGI,
+
+	/**
+	 * A WAS application (only if one was specified on the
+	 * command line).
+	 */
+	WAS,
+};
+
+static constexpr std::size_t N_BENCH_PATHS = static_cast<std::size_t>(BenchPath::WAS) + 1;
+
+static constexpr std::string_view bench_path_names[N_BENCH_PATHS] = {
+	"file",
+	"proxy",
+	"cache",
+	"processor",
+	"compress",
+	"fcgi",
+	"was",
+};
+
+static constexpr const char *bench_path_uris[N_BENCH_PATHS] = {
+	"/file/static.txt",
+	"/proxy/",
+	"/cache/",
+	"/processor/page.html",
+	"/compress/text.txt",
+	"/fcgi/",
+	"/was/",
+};
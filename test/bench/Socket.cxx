@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Socket.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+#include "net/SocketError.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+
+#include <fmt/core.h>
+
+#include <sys/socket.h>
+#include <unistd.h> // for getpid()
+
+static unsigned n_sockets;
+
+AllocatedSocketAddress
+MakeBenchSocketAddress() noexcept
+{
+	AllocatedSocketAddress address;
+	address.SetLocal(fmt::format("@beng-proxy-bench-{}-{}",
+				     getpid(), ++n_sockets).c_str());
+	return address;
+}
+
+UniqueSocketDescriptor
+MakeBenchListener(SocketAddress address)
+{
+	UniqueSocketDescriptor s;
+	if (!s.CreateNonBlock(AF_LOCAL, SOCK_STREAM, 0))
+		throw MakeSocketError("Failed to create socket");
+
+	if (!s.Bind(address))
+		throw MakeSocketError("Failed to bind");
+
+	if (!s.Listen(64))
+		throw MakeSocketError("Failed to listen");
+
+	return s;
+}
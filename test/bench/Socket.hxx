@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+class AllocatedSocketAddress;
+class SocketAddress;
+class UniqueSocketDescriptor;
+
+/**
+ * Generate a new unique abstract local socket address for this
+ * process.
+ */
+AllocatedSocketAddress
+MakeBenchSocketAddress() noexcept;
+
+/**
+ * Create a non-blocking local stream socket listening on the given
+ * address.
+ *
+ * Throws on error.
+ */
+UniqueSocketDescriptor
+MakeBenchListener(SocketAddress address);
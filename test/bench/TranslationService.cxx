@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "TranslationService.hxx"
+#include "translation/Handler.hxx"
+#include "translation/Request.hxx"
+#include "translation/Response.hxx"
+#include "translation/Transformation.hxx"
+#include "widget/View.hxx"
+#include "bp/XmlProcessor.hxx"
+#include "http/Address.hxx"
+#include "file/Address.hxx"
+#include "cgi/Address.hxx"
+#include "cluster/AddressListBuilder.hxx"
+#include "pool/UniquePtr.hxx"
+#include "AllocatorPtr.hxx"
+
+#include <stdexcept>
+
+[[gnu::pure]]
+static const BenchPath *
+FindPath(std::string_view uri) noexcept
+{
+	static constexpr BenchPath paths[] = {
+		BenchPath::FILE,
+		BenchPath::PROXY,
+		BenchPath::CACHE,
+		BenchPath::PROCESSOR,
+		BenchPath::COMPRESS,
+		BenchPath::FCGI,
+		BenchPath::WAS,
+	};
+
+	for (const auto &i : paths) {
+		const std::string_view name = bench_path_names[static_cast<std::size_t>(i)];
+		if (uri.size() > name.size() + 1 && uri.front() == '/' &&
+		    uri.substr(1).starts_with(name) &&
+		    uri[name.size() + 1] == '/')
+			return &i;
+	}
+
+	return nullptr;
+}
+
+static ResourceAddress
+MakeFile(AllocatorPtr alloc, const BenchBackends &backends,
+	 const char *name, const char *content_type) noexcept
+{
+	auto *file = alloc.New<FileAddress>(alloc.Concat(std::string_view{backends.document_root},
+							 '/', name));
+	file->content_type = content_type;
+	return *file;
+}
+
+static ResourceAddress
+MakeHttp(AllocatorPtr alloc, SocketAddress address) noexcept
+{
+	AddressListBuilder address_list_builder;
+	address_list_builder.Add(alloc, address);
+
+	auto *http = alloc.New<HttpAddress>(false, nullptr, "/");
+	http->addresses = address_list_builder.Finish(alloc);
+	return *http;
+}
+
+static ResourceAddress
+MakeCgi(AllocatorPtr alloc, ResourceAddress::Type type,
+	const char *path, const char *uri) noexcept
+{
+	auto *cgi = alloc.New<CgiAddress>(path);
+	cgi->uri = uri;
+	return {type, *cgi};
+}
+
+static void
+AddProcessor(AllocatorPtr alloc, TranslateResponse &response) noexcept
+{
+	auto *view = alloc.New<WidgetView>(nullptr);
+	view->transformations.push_front(*alloc.New<Transformation>(XmlProcessorTransformation{PROCESSOR_REWRITE_URL}));
+	response.views.push_front(*view);
+}
+
+void
+BenchTranslationService::SendRequest(AllocatorPtr alloc,
+				     const TranslateRequest &request,
+				     const StopwatchPtr &,
+				     TranslateHandler &handler,
+				     CancellablePointer &) noexcept
+{
+	const BenchPath *path = request.uri != nullptr
+		? FindPath(request.uri)
+		: nullptr;
+	if (path == nullptr) {
+		handler.OnTranslateError(std::make_exception_ptr(std::runtime_error{"Unknown benchmark path"}));
+		return;
+	}
+
+	auto response = UniquePoolPtr<TranslateResponse>::Make(alloc.GetPool());
+
+	switch (*path) {
+	case BenchPath::FILE:
+		response->address = MakeFile(alloc, backends,
+					     "static.txt", "text/plain");
+		break;
+
+	case BenchPath::PROXY:
+		response->address = MakeHttp(alloc, backends.http);
+		break;
+
+	case BenchPath::CACHE:
+		response->address = MakeHttp(alloc, backends.cacheable_http);
+		break;
+
+	case BenchPath::PROCESSOR:
+		response->address = MakeFile(alloc, backends,
+					     "page.html", "text/html");
+		AddProcessor(alloc, *response);
+		break;
+
+	case BenchPath::COMPRESS:
+		response->address = MakeFile(alloc, backends,
+					     "text.txt", "text/plain");
+		response->auto_gzip = true;
+#ifdef HAVE_BROTLI
+		response->auto_brotli = true;
+#endif
+		break;
+
+	case BenchPath::FCGI:
+		if (backends.fcgi == nullptr)
+			break;
+
+		response->address = MakeCgi(alloc, ResourceAddress::Type::FASTCGI,
+					    backends.fcgi, request.uri);
+		break;
+
+	case BenchPath::WAS:
+		if (backends.was == nullptr)
+			break;
+
+		response->address = MakeCgi(alloc, ResourceAddress::Type::WAS,
+					    backends.was, request.uri);
+		break;
+	}
+
+	if (!response->address.IsDefined()) {
+		handler.OnTranslateError(std::make_exception_ptr(std::runtime_error{"Benchmark path not configured"}));
+		return;
+	}
+
+	handler.OnTranslateResponse(std::move(response));
+}
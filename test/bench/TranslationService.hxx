@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Path.hxx"
+#include "translation/Service.hxx"
+#include "net/SocketAddress.hxx"
+
+#include <string>
+
+/**
+ * Everything #BenchTranslationService needs to know about the
+ * local backends.
+ */
+struct BenchBackends {
+	/**
+	 * The directory containing the static files.
+	 */
+	std::string document_root;
+
+	/**
+	 * The local socket of the uncacheable HTTP backend.
+	 */
+	SocketAddress http;
+
+	/**
+	 * The local socket of the cacheable HTTP backend.
+	 */
+	SocketAddress cacheable_http;
+
+	/**
+	 * The FastCGI program (may be nullptr).
+	 */
+	const char *fcgi = nullptr;
+
+	/**
+	 * The WAS program (may be nullptr).
+	 */
+	const char *was = nullptr;
+};
+
+/**
+ * An in-process stand-in for the translation server.  It answers
+ * each request synchronously, depending on the #BenchPath URI
+ * prefix.
+ */
+class BenchTranslationService final : public TranslationService {
+	const BenchBackends &backends;
+
+public:
+	explicit BenchTranslationService(const BenchBackends &_backends) noexcept
+		:backends(_backends) {}
+
+	/* virtual methods from class TranslationService */
+	void SendRequest(AllocatorPtr alloc,
+			 const TranslateRequest &request,
+			 const StopwatchPtr &parent_stopwatch,
+			 TranslateHandler &handler,
+			 CancellablePointer &cancel_ptr) noexcept override;
+};
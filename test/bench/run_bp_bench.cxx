@@ -0,0 +1,570 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * An in-process benchmark of the beng-proxy request pipeline.  It
+ * sets up a #BpInstance with a fake translation server and local
+ * backends, and then sends a configurable mix of requests over
+ * socketpairs.
+ */
+
+#include "AllocationCounter.hxx"
+#include "Client.hxx"
+#include "HttpBackend.hxx"
+#include "Path.hxx"
+#include "Socket.hxx"
+#include "TranslationService.hxx"
+#include "bp/Config.hxx"
+#include "bp/Instance.hxx"
+#include "bp/Listener.hxx"
+#include "bp/LConfig.hxx"
+#include "bp/session/Manager.hxx"
+#include "translation/Multi.hxx"
+#include "access_log/ChildErrorLogOptions.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "memory/fb_pool.hxx"
+#include "spawn/Launch.hxx"
+#include "ssl/Init.hxx"
+#include "ssl/Client.hxx"
+#include "system/SetupProcess.hxx"
+#include "system/Error.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+#include "net/SocketPair.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringParser.hxx"
+#include "direct.hxx"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <array>
+#include <forward_list>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h> // for strchr()
+#include <sysexits.h> // for EX_*
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+struct BenchOptions {
+	/**
+	 * The relative weight of each #BenchPath in the request
+	 * mix.
+	 */
+	std::array<unsigned, N_BENCH_PATHS> weights{};
+
+	unsigned connections = 16;
+	unsigned requests = 100000;
+	unsigned warmup = 1000;
+
+	BenchBackends backends;
+
+	BpConfig config;
+};
+
+static void
+PrintUsage(const char *argv0) noexcept
+{
+	fmt::print(stderr,
+		   "Usage: {} [OPTIONS]\n"
+		   "\n"
+		   "  --mix=PATH[:WEIGHT],...\n"
+		   "      paths: file, proxy, cache, processor, compress, fcgi, was\n"
+		   "      (default: file,proxy,cache,processor,compress)\n"
+		   "  --connections=N   number of concurrent connections (default 16)\n"
+		   "  --requests=N      number of measured requests (default 100000)\n"
+		   "  --warmup=N        number of unmeasured requests (default 1000)\n"
+		   "  --fcgi=PATH       FastCGI program for the \"fcgi\" path\n"
+		   "  --was=PATH        WAS program for the \"was\" path\n"
+		   "  --set NAME=VALUE  beng-proxy configuration setting\n",
+		   argv0);
+}
+
+[[noreturn]]
+static void
+UsageError(const char *argv0, std::string_view msg) noexcept
+{
+	fmt::print(stderr, "{}\n\n", msg);
+	PrintUsage(argv0);
+	exit(EX_USAGE);
+}
+
+[[gnu::pure]]
+static const BenchPath *
+FindPathByName(std::string_view name) noexcept
+{
+	static constexpr BenchPath paths[] = {
+		BenchPath::FILE,
+		BenchPath::PROXY,
+		BenchPath::CACHE,
+		BenchPath::PROCESSOR,
+		BenchPath::COMPRESS,
+		BenchPath::FCGI,
+		BenchPath::WAS,
+	};
+
+	for (const auto &i : paths)
+		if (name == bench_path_names[static_cast<std::size_t>(i)])
+			return &i;
+
+	return nullptr;
+}
+
+/**
+ * Parse a "--mix" argument, e.g. "file:3,proxy:1".
+ *
+ * Throws on error.
+ */
+static void
+ParseMix(std::array<unsigned, N_BENCH_PATHS> &weights, std::string_view s)
+{
+	weights = {};
+
+	for (const std::string_view i : IterableSplitString(s, ',')) {
+		if (i.empty())
+			continue;
+
+		const auto colon = i.find(':');
+		const std::string_view name = i.substr(0, colon);
+
+		const BenchPath *path = FindPathByName(name);
+		if (path == nullptr)
+			throw std::invalid_argument{fmt::format("Unknown path: {}", name)};
+
+		unsigned weight = 1;
+		if (colon != i.npos) {
+			const std::string value{i.substr(colon + 1)};
+			weight = ParseUnsignedLong(value.c_str());
+		}
+
+		weights[static_cast<std::size_t>(*path)] = weight;
+	}
+
+	if (std::all_of(weights.begin(), weights.end(),
+			[](unsigned w){ return w == 0; }))
+		throw std::invalid_argument{"Empty request mix"};
+}
+
+static void
+ParseCommandLine(BenchOptions &options, int argc, char **argv)
+{
+	enum {
+		OPTION_MIX = 0x100,
+		OPTION_CONNECTIONS,
+		OPTION_REQUESTS,
+		OPTION_WARMUP,
+		OPTION_FCGI,
+		OPTION_WAS,
+	};
+
+	static constexpr struct option long_options[] = {
+		{"help", 0, nullptr, 'h'},
+		{"mix", 1, nullptr, OPTION_MIX},
+		{"connections", 1, nullptr, OPTION_CONNECTIONS},
+		{"requests", 1, nullptr, OPTION_REQUESTS},
+		{"warmup", 1, nullptr, OPTION_WARMUP},
+		{"fcgi", 1, nullptr, OPTION_FCGI},
+		{"was", 1, nullptr, OPTION_WAS},
+		{"set", 1, nullptr, 's'},
+		{nullptr, 0, nullptr, 0}
+	};
+
+	ParseMix(options.weights, "file,proxy,cache,processor,compress"sv);
+
+	while (true) {
+		const int ret = getopt_long(argc, argv, "hs:",
+					    long_options, nullptr);
+		if (ret == -1)
+			break;
+
+		try {
+			switch (ret) {
+			case 'h':
+				PrintUsage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case OPTION_MIX:
+				ParseMix(options.weights, optarg);
+				break;
+
+			case OPTION_CONNECTIONS:
+				options.connections = ParseUnsignedLong(optarg);
+				if (options.connections == 0)
+					throw std::invalid_argument{"Need at least one connection"};
+				break;
+
+			case OPTION_REQUESTS:
+				options.requests = ParseUnsignedLong(optarg);
+				if (options.requests == 0)
+					throw std::invalid_argument{"Need at least one request"};
+				break;
+
+			case OPTION_WARMUP:
+				options.warmup = ParseUnsignedLong(optarg);
+				break;
+
+			case OPTION_FCGI:
+				options.backends.fcgi = optarg;
+				break;
+
+			case OPTION_WAS:
+				options.backends.was = optarg;
+				break;
+
+			case 's':
+				if (const char *eq = strchr(optarg, '=');
+				    eq != nullptr && eq != optarg)
+					options.config.HandleSet({optarg, eq}, eq + 1);
+				else
+					throw std::invalid_argument{"Malformed --set argument"};
+				break;
+
+			default:
+				UsageError(argv[0], "Invalid option");
+			}
+		} catch (const std::exception &e) {
+			UsageError(argv[0], e.what());
+		}
+	}
+
+	if (optind < argc)
+		UsageError(argv[0], "Too many arguments");
+
+	if (options.weights[static_cast<std::size_t>(BenchPath::FCGI)] > 0 &&
+	    options.backends.fcgi == nullptr)
+		UsageError(argv[0], "The \"fcgi\" path requires --fcgi");
+
+	if (options.weights[static_cast<std::size_t>(BenchPath::WAS)] > 0 &&
+	    options.backends.was == nullptr)
+		UsageError(argv[0], "The \"was\" path requires --was");
+}
+
+/**
+ * A temporary directory containing the static files served by the
+ * benchmark.
+ */
+class BenchDocumentRoot {
+	static constexpr const char *file_names[] = {
+		"static.txt",
+		"page.html",
+		"text.txt",
+	};
+
+	std::string path;
+
+public:
+	BenchDocumentRoot() {
+		char buffer[] = "/tmp/beng-proxy-bench-XXXXXX";
+		if (mkdtemp(buffer) == nullptr)
+			throw MakeErrno("Failed to create temporary directory");
+
+		path = buffer;
+
+		try {
+			/* a small static file */
+			WriteFile("static.txt", std::string(4096, 'x'));
+
+			/* a HTML page with links for the processor
+			   to rewrite */
+			std::string html = "<html><head><title>bench</title></head><body>\n";
+			for (unsigned i = 0; i < 64; ++i)
+				html += fmt::format("<p><a href=\"/link/{}\">Link {}</a>"
+						    "<img src=\"/img/{}.png\"/></p>\n",
+						    i, i, i);
+			html += "</body></html>\n";
+			WriteFile("page.html", html);
+
+			/* a large compressible text file */
+			std::string text;
+			for (unsigned i = 0; text.size() < 65536; ++i)
+				text += fmt::format("{}: The quick brown fox jumps over the lazy dog.\n", i);
+			WriteFile("text.txt", text);
+		} catch (...) {
+			Remove();
+			throw;
+		}
+	}
+
+	~BenchDocumentRoot() noexcept {
+		Remove();
+	}
+
+	BenchDocumentRoot(const BenchDocumentRoot &) = delete;
+	BenchDocumentRoot &operator=(const BenchDocumentRoot &) = delete;
+
+	const std::string &GetPath() const noexcept {
+		return path;
+	}
+
+private:
+	void WriteFile(const char *name, std::string_view contents) {
+		const auto file_path = fmt::format("{}/{}", path, name);
+		const int fd = open(file_path.c_str(),
+				    O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC|O_NOCTTY,
+				    0666);
+		if (fd < 0)
+			throw FmtErrno("Failed to create {}", file_path);
+
+		const auto nbytes = write(fd, contents.data(), contents.size());
+		close(fd);
+
+		if (nbytes != static_cast<ssize_t>(contents.size()))
+			throw FmtErrno("Failed to write {}", file_path);
+	}
+
+	void Remove() noexcept {
+		for (const char *name : file_names)
+			unlink(fmt::format("{}/{}", path, name).c_str());
+		rmdir(path.c_str());
+	}
+};
+
+class Bench final : BenchClientHandler {
+	BpInstance &instance;
+	BpListener &listener;
+	const SocketAddress listener_address;
+
+	std::mt19937 random{42};
+	std::discrete_distribution<std::size_t> mix;
+
+	/**
+	 * The number of requests which have not yet been started.
+	 */
+	unsigned remaining;
+
+	/**
+	 * The number of completed requests to be ignored before the
+	 * measurement starts.
+	 */
+	unsigned remaining_warmup;
+
+	struct PathResult {
+		std::vector<Clock::duration> durations;
+		unsigned n_errors = 0;
+	};
+
+	std::array<PathResult, N_BENCH_PATHS> results;
+
+	std::forward_list<BenchClient> clients;
+	unsigned n_running_clients = 0;
+
+	Clock::time_point start_time, end_time;
+	uint_least64_t start_allocations, end_allocations;
+
+public:
+	Bench(BpInstance &_instance, BpListener &_listener,
+	      SocketAddress _listener_address,
+	      const BenchOptions &options) noexcept
+		:instance(_instance), listener(_listener),
+		 listener_address(_listener_address),
+		 mix(options.weights.begin(), options.weights.end()),
+		 remaining(options.warmup + options.requests),
+		 remaining_warmup(options.warmup)
+	{
+		for (unsigned i = 0; i < options.connections; ++i)
+			clients.emplace_front(instance.root_pool,
+					      instance.event_loop, *this);
+	}
+
+	void Start() noexcept {
+		if (remaining_warmup == 0)
+			StartMeasurement();
+
+		for (auto &i : clients) {
+			++n_running_clients;
+			i.Start();
+		}
+	}
+
+	void PrintReport() const noexcept;
+
+private:
+	void StartMeasurement() noexcept {
+		start_time = Clock::now();
+		start_allocations = GetAllocationCount();
+	}
+
+	/* virtual methods from class BenchClientHandler */
+	std::optional<BenchPath> NextRequest() noexcept override {
+		if (remaining == 0)
+			return std::nullopt;
+
+		--remaining;
+		return static_cast<BenchPath>(mix(random));
+	}
+
+	void OnRequestFinished(BenchPath path, Clock::duration duration,
+			       bool success) noexcept override {
+		if (remaining_warmup > 0) {
+			if (--remaining_warmup == 0)
+				StartMeasurement();
+			return;
+		}
+
+		auto &result = results[static_cast<std::size_t>(path)];
+		result.durations.push_back(duration);
+		if (!success)
+			++result.n_errors;
+
+		end_time = Clock::now();
+		end_allocations = GetAllocationCount();
+	}
+
+	UniqueSocketDescriptor Connect() override {
+		auto [client_socket, server_socket] = CreateStreamSocketPairNonBlock();
+		listener.AddConnection(std::move(server_socket),
+				       listener_address);
+		return std::move(client_socket);
+	}
+
+	void OnClientFinished(BenchClient &) noexcept override {
+		assert(n_running_clients > 0);
+
+		if (--n_running_clients == 0) {
+			/* the backends are still listening, therefore
+			   the event loop would not finish by itself */
+			instance.ShutdownCallback();
+			instance.event_loop.Break();
+		}
+	}
+};
+
+static double
+ToMilliseconds(BenchClientHandler::Clock::duration d) noexcept
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+[[gnu::pure]]
+static BenchClientHandler::Clock::duration
+Percentile(const std::vector<BenchClientHandler::Clock::duration> &sorted,
+	   unsigned p) noexcept
+{
+	assert(!sorted.empty());
+
+	return sorted[(sorted.size() - 1) * p / 100];
+}
+
+void
+Bench::PrintReport() const noexcept
+{
+	fmt::print("{:<10} {:>9} {:>7} {:>10} {:>10}\n",
+		   "path", "requests", "errors", "p50 [ms]", "p99 [ms]");
+
+	std::size_t n_total = 0;
+	unsigned n_errors = 0;
+
+	for (std::size_t i = 0; i < N_BENCH_PATHS; ++i) {
+		const auto &result = results[i];
+		if (result.durations.empty())
+			continue;
+
+		auto sorted = result.durations;
+		std::sort(sorted.begin(), sorted.end());
+
+		fmt::print("{:<10} {:>9} {:>7} {:>10.3f} {:>10.3f}\n",
+			   bench_path_names[i],
+			   sorted.size(), result.n_errors,
+			   ToMilliseconds(Percentile(sorted, 50)),
+			   ToMilliseconds(Percentile(sorted, 99)));
+
+		n_total += sorted.size();
+		n_errors += result.n_errors;
+	}
+
+	if (n_total == 0)
+		return;
+
+	const double seconds =
+		std::chrono::duration<double>(end_time - start_time).count();
+
+	fmt::print("\n{} requests, {} errors in {:.3f} s: {:.0f} req/s\n",
+		   n_total, n_errors, seconds,
+		   seconds > 0 ? n_total / seconds : 0.);
+
+	if (HaveAllocationCounter())
+		fmt::print("{:.1f} allocations per request\n",
+			   double(end_allocations - start_allocations) / n_total);
+}
+
+int
+main(int argc, char **argv)
+try {
+	BenchOptions options;
+	ParseCommandLine(options, argc, argv);
+
+	SetupProcess();
+
+	const BenchDocumentRoot document_root;
+	options.backends.document_root = document_root.GetPath();
+
+	const ScopeFbPoolInit fb_pool_init;
+
+	auto spawner = LaunchSpawnServer(options.config.spawn, nullptr);
+	BpInstance instance{std::move(options.config), std::move(spawner)};
+
+	direct_global_init();
+
+	const ScopeSslGlobalInit ssl_init;
+	instance.ssl_client_factory =
+		std::make_unique<SslClientFactory>(instance.config.ssl_client);
+
+	instance.session_manager =
+		std::make_unique<SessionManager>(instance.event_loop,
+						 instance.config.session_idle_timeout,
+						 instance.config.cluster_size,
+						 instance.config.cluster_node);
+
+	BenchHttpBackend http_backend(instance.root_pool, instance.event_loop,
+				      DemoHttpServerConnection::Mode::FIXED);
+	BenchHttpBackend cacheable_http_backend(instance.root_pool,
+						instance.event_loop,
+						DemoHttpServerConnection::Mode::CACHEABLE);
+	options.backends.http = http_backend.GetAddress();
+	options.backends.cacheable_http = cacheable_http_backend.GetAddress();
+
+	instance.uncached_translation_service =
+		std::make_shared<MultiTranslationService>();
+	instance.uncached_translation_service
+		->Add(std::make_shared<BenchTranslationService>(options.backends));
+	instance.translation_service = instance.uncached_translation_service;
+
+	instance.CreateStocksAndCaches(nullptr, ChildErrorLogOptions{});
+
+	const auto listener_address = MakeBenchSocketAddress();
+	BpListenerConfig listener_config;
+	auto &listener =
+		instance.listeners.emplace_front(instance,
+						 instance.listener_stats[listener_config.tag],
+						 nullptr, nullptr,
+						 instance.translation_service,
+						 listener_config,
+						 MakeBenchListener(listener_address));
+
+	Bench bench{instance, listener, listener_address, options};
+	bench.Start();
+	instance.event_loop.Run();
+
+	http_backend.Close();
+	cacheable_http_backend.Close();
+
+	bench.PrintReport();
+
+	worker_pool_deinit();
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "http/LinkHeader.hxx"
+
+#include <gtest/gtest.h>
+
+using std::string_view_literals::operator""sv;
+
+TEST(LinkHeader, ExtractEarlyHintLinks)
+{
+	EXPECT_EQ(ExtractEarlyHintLinks(""sv), "");
+	EXPECT_EQ(ExtractEarlyHintLinks("</a.css>"sv), "");
+	EXPECT_EQ(ExtractEarlyHintLinks("</a.css>; rel=stylesheet"sv), "");
+	EXPECT_EQ(ExtractEarlyHintLinks("</a.css>; rel=preload; as=style"sv),
+		  "</a.css>; rel=preload; as=style");
+	EXPECT_EQ(ExtractEarlyHintLinks("</a.css>;rel=\"preload\";as=style"sv),
+		  "</a.css>;rel=\"preload\";as=style");
+	EXPECT_EQ(ExtractEarlyHintLinks("</a.css>; REL=\"alternate Preload\""sv),
+		  "</a.css>; REL=\"alternate Preload\"");
+	EXPECT_EQ(ExtractEarlyHintLinks("<https://cdn.example.com>; rel=preconnect"sv),
+		  "<https://cdn.example.com>; rel=preconnect");
+
+	/* filter a list; commas inside the URI and inside quoted
+	   strings do not separate links */
+	EXPECT_EQ(ExtractEarlyHintLinks("</a,b.js>; rel=preload; as=script, "
+					"</next>; rel=next; title=\"x, y\", "
+					"</c.css>; rel=preload; as=style"sv),
+		  "</a,b.js>; rel=preload; as=script, </c.css>; rel=preload; as=style");
+
+	/* malformed */
+	EXPECT_EQ(ExtractEarlyHintLinks("a.css; rel=preload"sv), "");
+	EXPECT_EQ(ExtractEarlyHintLinks("</a.css; rel=preload"sv), "");
+}
@@ -18,7 +18,7 @@
 #include "ssl/Client.hxx"
 #include "ssl/Config.hxx"
 #include "nghttp2/Client.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "system/SetupProcess.hxx"
 #include "io/FileDescriptor.hxx"
 #include "io/SpliceSupport.hxx"
@@ -235,7 +235,7 @@ Context::ShutdownCallback() noexcept
 
 	connection.reset();
 
-	thread_pool_set_volatile();
+	worker_pool_set_volatile();
 
 	shutdown_listener.Disable();
 }
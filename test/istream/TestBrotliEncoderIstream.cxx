@@ -6,7 +6,7 @@
 #include "istream/BrotliEncoderIstream.hxx"
 #include "istream/istream_string.hxx"
 #include "istream/UnusedPtr.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 
 #include <brotli/decode.h>
 
@@ -48,13 +48,13 @@ public:
 	};
 
 	~BrotliEncoderIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -65,8 +65,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewBrotliEncoderIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewBrotliEncoderIstream(pool, worker_pool_get(event_loop),
 					       std::move(input));
 	}
 };
@@ -6,7 +6,7 @@
 #include "istream/GzipIstream.hxx"
 #include "istream/istream_string.hxx"
 #include "istream/UnusedPtr.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "lib/zlib/Error.hxx"
 #include "util/ScopeExit.hxx"
 
@@ -51,13 +51,13 @@ public:
 	};
 
 	~GzipIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -68,9 +68,9 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
+		worker_pool_set_volatile();
 		return NewGzipIstream(pool,
-				      thread_pool_get_queue(event_loop),
+				      worker_pool_get(event_loop),
 				      std::move(input));
 	}
 };
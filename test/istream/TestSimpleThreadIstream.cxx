@@ -8,7 +8,7 @@
 #include "istream/UnusedPtr.hxx"
 #include "istream/istream_string.hxx"
 #include "istream/ZeroIstream.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 
 #include <fmt/core.h>
 
@@ -37,13 +37,13 @@ public:
 	};
 
 	~NopSimpleThreadIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -54,8 +54,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<NopSimpleThreadIstreamFilter>());
 	}
@@ -116,13 +116,13 @@ public:
 	};
 
 	~FooSimpleThreadIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -133,8 +133,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<FooSimpleThreadIstreamFilter>());
 	}
@@ -204,13 +204,13 @@ public:
 	};
 
 	~SimpleExplodeOutputIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -221,8 +221,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<ExplodeSimpleThreadIstreamFilter>());
 	}
@@ -283,13 +283,13 @@ public:
 	};
 
 	~HugeZeroInputIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -302,8 +302,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<CountSimpleThreadIstreamFilter>());
 	}
@@ -12,7 +12,7 @@
 #include "istream/FourIstream.hxx"
 #include "istream/HeadIstream.hxx"
 #include "istream/BlockIstream.hxx"
-#include "thread/Pool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
 #include "memory/fb_pool.hxx"
 #include "pool/pool.hxx"
 
@@ -42,13 +42,13 @@ public:
 	};
 
 	~NopThreadIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -59,8 +59,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<NopThreadIstreamFilter>());
 	}
@@ -128,13 +128,13 @@ public:
 	};
 
 	~FooThreadIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -145,8 +145,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<FooThreadIstreamFilter>());
 	}
@@ -222,13 +222,13 @@ public:
 	};
 
 	~ExplodeOutputIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -239,8 +239,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<ExplodeThreadIstreamFilter>());
 	}
@@ -310,13 +310,13 @@ public:
 	};
 
 	~DrainThreadIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -327,8 +327,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<DrainThreadIstreamFilter>());
 	}
@@ -373,13 +373,13 @@ public:
 	};
 
 	~FinishThreadIstreamTestTraits() noexcept {
-		// invoke all pending ThreadJob::Done() calls
+		// invoke all pending WorkerJob::Done() calls
 		if (event_loop_ != nullptr)
 			event_loop_->Run();
 
-		thread_pool_stop();
-		thread_pool_join();
-		thread_pool_deinit();
+		worker_pool_stop();
+		worker_pool_join();
+		worker_pool_deinit();
 	}
 
 	UnusedIstreamPtr CreateInput(struct pool &pool) const noexcept {
@@ -390,8 +390,8 @@ public:
 				    UnusedIstreamPtr input) const noexcept {
 		event_loop_ = &event_loop;
 
-		thread_pool_set_volatile();
-		return NewThreadIstream(pool, thread_pool_get_queue(event_loop),
+		worker_pool_set_volatile();
+		return NewThreadIstream(pool, worker_pool_get(event_loop),
 					std::move(input),
 					std::make_unique<FinishThreadIstreamFilter>());
 	}
@@ -5,6 +5,8 @@
 #include "pool/pool.hxx"
 #include "pool/Ptr.hxx"
 #include "pool/RootPool.hxx"
+#include "pool/Profiler.hxx"
+#include "memory/Checker.hxx"
 
 #include <gtest/gtest.h>
 
@@ -79,3 +81,43 @@ TEST(PoolTest, Linear)
 #endif
 	ASSERT_EQ(size_t(2 * 1024 + 32 + 16 + 32), pool_netto_size(pool));
 }
+
+static void
+AllocProfiled(struct pool &parent) noexcept
+{
+	const auto pool = pool_new_linear(&parent, "profiled", 64);
+	for (unsigned i = 0; i < 20; ++i)
+		p_malloc(pool, 64);
+}
+
+TEST(PoolTest, Profiler)
+{
+	if (HaveMemoryChecker())
+		GTEST_SKIP();
+
+	RootPool root_pool;
+
+	pool_profiler_set_mode(PoolProfilerMode::ADAPTIVE);
+
+	for (unsigned i = 0; i < 256; ++i)
+		AllocProfiled(root_pool);
+
+	auto stats = pool_profiler_get_stats();
+	ASSERT_EQ(stats.classes.size(), 1U);
+	EXPECT_EQ(stats.classes.front().name, "profiled");
+	EXPECT_EQ(stats.classes.front().n_pools, 256U);
+	EXPECT_EQ(stats.classes.front().n_overflows, 256U * 19);
+	EXPECT_EQ(stats.classes.front().n_big_allocations, 0U);
+	EXPECT_EQ(stats.classes.front().max_used, 20U * 64);
+	EXPECT_EQ(stats.classes.front().p95_used, 2048U);
+	EXPECT_EQ(stats.classes.front().adaptive_size, 2048U);
+
+	/* now the whole pool fits into the initial area */
+	AllocProfiled(root_pool);
+
+	stats = pool_profiler_get_stats();
+	EXPECT_EQ(stats.classes.front().n_pools, 257U);
+	EXPECT_EQ(stats.classes.front().n_overflows, 256U * 19);
+
+	pool_profiler_set_mode(PoolProfilerMode::DISABLED);
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Benchmark for the expiry of cache items: compares the
+ * #CacheExpiryWheel with a walk over the list of all items (which is
+ * what #Cache used to do every 60 seconds).
+ */
+
+#include "cache/ExpiryWheel.hxx"
+#include "cache/Item.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchItem final : CacheItem {
+	IntrusiveListHook<IntrusiveHookMode::NORMAL> list_siblings;
+
+	const Clock::time_point expires;
+
+	BenchItem(Clock::time_point _expires) noexcept
+		:CacheItem(StringWithHash{nullptr}, 1, _expires),
+		 expires(_expires) {}
+
+	/* virtual methods from class CacheItem */
+	void Destroy() noexcept override {}
+};
+
+struct Result {
+	std::size_t n_runs = 0, n_expired = 0;
+	Clock::duration total{}, max{};
+
+	void Add(Clock::duration d) noexcept {
+		++n_runs;
+		total += d;
+		max = std::max(max, d);
+	}
+
+	void Print(const char *name) const noexcept {
+		using std::chrono::duration_cast;
+		using std::chrono::microseconds;
+
+		printf("%-12s runs=%zu expired=%zu total=%lldus max=%lldus avg=%lldus\n",
+		       name, n_runs, n_expired,
+		       (long long)duration_cast<microseconds>(total).count(),
+		       (long long)duration_cast<microseconds>(max).count(),
+		       n_runs > 0
+		       ? (long long)duration_cast<microseconds>(total / n_runs).count()
+		       : 0LL);
+	}
+};
+
+static std::vector<std::unique_ptr<BenchItem>>
+MakeItems(std::size_t n, Clock::time_point now)
+{
+	/* lifetimes between one minute and one hour, like a typical
+	   translation cache */
+	std::mt19937 rng{42};
+	std::uniform_int_distribution<unsigned> lifetime(60, 3600);
+
+	std::vector<std::unique_ptr<BenchItem>> items;
+	items.reserve(n);
+	for (std::size_t i = 0; i < n; ++i)
+		items.emplace_back(std::make_unique<BenchItem>(now + std::chrono::seconds{lifetime(rng)}));
+
+	return items;
+}
+
+static Result
+RunListWalk(std::size_t n, Clock::time_point t0, Clock::duration interval)
+{
+	auto items = MakeItems(n, t0);
+
+	IntrusiveList<BenchItem,
+		      IntrusiveListMemberHookTraits<&BenchItem::list_siblings>> list;
+	for (auto &i : items)
+		list.push_back(*i);
+
+	Result result;
+
+	for (auto now = t0 + interval; !list.empty(); now += interval) {
+		const auto start = Clock::now();
+
+		result.n_expired += list.remove_and_dispose_if([now](const BenchItem &item){
+			return item.expires <= now;
+		}, [](BenchItem *){});
+
+		result.Add(Clock::now() - start);
+	}
+
+	return result;
+}
+
+static void
+OnExpire(void *ctx, CacheItem &) noexcept
+{
+	auto &n_expired = *(std::size_t *)ctx;
+	++n_expired;
+}
+
+static Result
+RunWheel(std::size_t n, Clock::time_point t0, Clock::duration interval)
+{
+	auto items = MakeItems(n, t0);
+
+	Result result;
+
+	CacheExpiryWheel wheel;
+	for (auto &i : items)
+		wheel.Insert(*i, t0);
+
+	for (auto now = t0 + interval; !wheel.empty(); now += interval) {
+		const auto start = Clock::now();
+		wheel.Advance(now, {&result.n_expired, OnExpire});
+		result.Add(Clock::now() - start);
+	}
+
+	return result;
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	std::size_t n = 1000000;
+	if (argc > 1)
+		n = std::strtoul(argv[1], nullptr, 10);
+
+	const Clock::time_point t0{std::chrono::hours{1000}};
+
+	printf("%zu items\n", n);
+
+	RunListWalk(n, t0, 60s).Print("list/60s");
+	RunWheel(n, t0, 60s).Print("wheel/60s");
+	RunWheel(n, t0, 10s).Print("wheel/10s");
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
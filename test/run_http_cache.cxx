@@ -77,7 +77,8 @@ main(int, char **) noexcept
 
 	auto pool2 = pool_new_dummy(instance.root_pool, "cache");
 
-	HttpCacheHeap cache(*pool2, instance.event_loop, max_size);
+	HttpCacheHeap cache(*pool2, instance.event_loop, max_size,
+			    CacheAdmission::LRU);
 
 	for (unsigned i = 0; i < 32 * 1024; ++i)
 		put_random(&cache);
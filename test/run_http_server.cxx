@@ -110,7 +110,7 @@ int
 main(int argc, char **argv)
 try {
 	if (argc != 2) {
-		fprintf(stderr, "Usage: %s {null|mirror|close|dummy|fixed|huge|hold}\n", argv[0]);
+		fprintf(stderr, "Usage: %s {null|mirror|close|dummy|fixed|cacheable|huge|hold}\n", argv[0]);
 		return EXIT_FAILURE;
 	}
 
@@ -131,6 +131,8 @@ try {
 		parsed_mode = DemoHttpServerConnection::Mode::DUMMY;
 	else if (StringIsEqual(mode, "fixed"))
 		parsed_mode = DemoHttpServerConnection::Mode::FIXED;
+	else if (StringIsEqual(mode, "cacheable"))
+		parsed_mode = DemoHttpServerConnection::Mode::CACHEABLE;
 	else if (StringIsEqual(mode, "huge"))
 		parsed_mode = DemoHttpServerConnection::Mode::HUGE_;
 	else if (StringIsEqual(mode, "hold"))
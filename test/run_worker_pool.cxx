@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Benchmark for the #WorkerPool: simulates many concurrent TLS
+ * connections, each of which submits one job after the other (like
+ * #ThreadSocketFilter does), and compares with the single shared
+ * #ThreadQueue.
+ */
+
+#include "thread/WorkerPool.hxx"
+#include "thread/GlobalWorkerPool.hxx"
+#include "thread/Job.hxx"
+#include "thread/Queue.hxx"
+#include "thread/Pool.hxx"
+#include "stats/WorkerPoolStats.hxx"
+#include "event/Loop.hxx"
+#include "util/PrintException.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The per-connection state touched by each job; this resembles
+ * the OpenSSL context plus the socket buffers.
+ */
+static constexpr std::size_t STATE_SIZE = 16384;
+
+struct BenchContext {
+	EventLoop &event_loop;
+
+	const unsigned n_rounds;
+
+	unsigned n_active = 0;
+
+	Clock::duration queue_wait{};
+
+	uint_least64_t n_runs = 0;
+};
+
+template<typename Base, typename Queue>
+struct Connection final : Base {
+	Queue &queue;
+	BenchContext &ctx;
+
+	unsigned remaining;
+
+	Clock::time_point submit_time;
+	Clock::duration queue_wait{};
+
+	std::array<uint_least64_t, STATE_SIZE / sizeof(uint_least64_t)> state{};
+
+	Connection(Queue &_queue, BenchContext &_ctx) noexcept
+		:queue(_queue), ctx(_ctx), remaining(ctx.n_rounds) {}
+
+	void Submit() noexcept {
+		submit_time = Clock::now();
+		queue.Add(*this);
+	}
+
+	/* virtual methods from class ThreadJob/WorkerJob */
+	void Run() noexcept override {
+		queue_wait += Clock::now() - submit_time;
+
+		/* a cheap "cipher" which reads and writes the whole
+		   state */
+		uint_least64_t x = remaining;
+		for (auto &i : state) {
+			x = (x ^ i) * 0x9e3779b97f4a7c15;
+			i = x;
+		}
+	}
+
+	void Done() noexcept override {
+		if (--remaining > 0) {
+			Submit();
+			return;
+		}
+
+		ctx.queue_wait += queue_wait;
+		ctx.n_runs += ctx.n_rounds;
+
+		if (--ctx.n_active == 0)
+			ctx.event_loop.Break();
+	}
+};
+
+template<typename Base, typename Queue>
+static void
+RunBenchmark(const char *name, EventLoop &event_loop, Queue &queue,
+	     unsigned n_connections, unsigned n_rounds)
+{
+	using C = Connection<Base, Queue>;
+
+	BenchContext ctx{event_loop, n_rounds};
+
+	std::vector<std::unique_ptr<C>> connections;
+	connections.reserve(n_connections);
+	for (unsigned i = 0; i < n_connections; ++i)
+		connections.emplace_back(std::make_unique<C>(queue, ctx));
+
+	const auto start = Clock::now();
+
+	for (auto &c : connections) {
+		++ctx.n_active;
+		c->Submit();
+	}
+
+	event_loop.Run();
+
+	const auto duration = Clock::now() - start;
+
+	using std::chrono::duration_cast;
+	using std::chrono::microseconds;
+	using std::chrono::milliseconds;
+
+	printf("%-12s total=%lldms jobs/s=%.0f avg_queue_wait=%lldus\n",
+	       name,
+	       (long long)duration_cast<milliseconds>(duration).count(),
+	       ctx.n_runs / std::chrono::duration<double>(duration).count(),
+	       (long long)duration_cast<microseconds>(ctx.queue_wait / ctx.n_runs).count());
+}
+
+static void
+PrintWorkerStats(const WorkerPool &pool) noexcept
+{
+	WorkerPoolStats stats;
+	pool.GetStats(stats);
+
+	for (std::size_t i = 0; i < stats.workers.size(); ++i) {
+		const auto &w = stats.workers[i];
+		printf("  worker %2zu: jobs=%llu stolen=%llu busy=%lldms\n",
+		       i, (unsigned long long)w.n_jobs,
+		       (unsigned long long)w.n_stolen,
+		       (long long)std::chrono::duration_cast<std::chrono::milliseconds>(w.busy).count());
+	}
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	unsigned n_connections = 1000, n_rounds = 200;
+	if (argc > 1)
+		n_connections = std::strtoul(argv[1], nullptr, 10);
+	if (argc > 2)
+		n_rounds = std::strtoul(argv[2], nullptr, 10);
+
+	printf("%u connections, %u jobs each\n", n_connections, n_rounds);
+
+	EventLoop event_loop;
+
+	RunBenchmark<ThreadJob>("ThreadQueue", event_loop,
+				thread_pool_get_queue(event_loop),
+				n_connections, n_rounds);
+	thread_pool_stop();
+	thread_pool_join();
+	thread_pool_deinit();
+
+	auto &pool = worker_pool_get(event_loop);
+	RunBenchmark<WorkerJob>("WorkerPool", event_loop, pool,
+				n_connections, n_rounds);
+	PrintWorkerStats(pool);
+	worker_pool_stop();
+	worker_pool_join();
+	worker_pool_deinit();
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
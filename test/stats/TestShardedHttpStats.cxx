@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "stats/ShardedHttpStats.hxx"
+#include "stats/TagRegistry.hxx"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using std::string_literals::operator""s;
+using std::string_view_literals::operator""sv;
+
+TEST(StatsTagRegistry, Intern)
+{
+	StatsTagRegistry registry;
+
+	EXPECT_EQ(registry.Intern(""sv), 0U);
+
+	const auto foo = registry.Intern("foo"sv);
+	const auto bar = registry.Intern("bar"sv);
+	EXPECT_NE(foo, 0U);
+	EXPECT_NE(bar, 0U);
+	EXPECT_NE(foo, bar);
+
+	EXPECT_EQ(registry.Intern("foo"sv), foo);
+	EXPECT_EQ(registry.Intern("bar"sv), bar);
+
+	EXPECT_EQ(registry.GetName(0), ""sv);
+	EXPECT_EQ(registry.GetName(foo), "foo"sv);
+	EXPECT_EQ(registry.GetName(bar), "bar"sv);
+}
+
+TEST(StatsTagRegistry, Limit)
+{
+	StatsTagRegistry registry{"test", 3};
+
+	const auto foo = registry.Intern("foo"sv);
+	const auto bar = registry.Intern("bar"sv);
+	EXPECT_NE(foo, 0U);
+	EXPECT_NE(bar, 0U);
+
+	/* the limit (which includes the empty name) is reached; new
+	   names are counted as the empty one */
+	EXPECT_EQ(registry.Intern("baz"sv), 0U);
+	EXPECT_EQ(registry.Intern("qux"sv), 0U);
+
+	/* existing names are still found */
+	EXPECT_EQ(registry.Intern("foo"sv), foo);
+	EXPECT_EQ(registry.Intern("bar"sv), bar);
+}
+
+TEST(ShardedHttpStats, Merge)
+{
+	using namespace std::chrono_literals;
+
+	ShardedHttpStats stats;
+	stats.AddRequest(HttpStatus::OK, 10, 100, 1ms);
+	stats.AddRequest(HttpStatus::NOT_FOUND, 20, 200, 2ms);
+
+	std::thread thread([&stats]{
+		stats.AddRequest(HttpStatus::OK, 30, 300, 3ms);
+	});
+	thread.join();
+
+	const auto merged = stats.Merge();
+	EXPECT_EQ(merged.n_requests, 3U);
+	EXPECT_EQ(merged.traffic_received, 60U);
+	EXPECT_EQ(merged.traffic_sent, 600U);
+	EXPECT_EQ(merged.total_duration, 6ms);
+	EXPECT_EQ(merged.n_per_status[HttpStatusToIndex(HttpStatus::OK)], 2U);
+	EXPECT_EQ(merged.n_per_status[HttpStatusToIndex(HttpStatus::NOT_FOUND)], 1U);
+}
+
+TEST(ShardedTaggedHttpStats, Merge)
+{
+	using namespace std::chrono_literals;
+
+	StatsTagRegistry tags;
+	const auto foo = tags.Intern("foo"sv);
+
+	/* an id in a different chunk of the StatsTagTable */
+	for (unsigned i = 0; i < 100; ++i)
+		tags.Intern(std::to_string(i));
+	const auto bar = tags.Intern("bar"sv);
+
+	ShardedTaggedHttpStats stats;
+
+	constexpr unsigned N_THREADS = 4;
+	std::thread threads[N_THREADS];
+	for (auto &i : threads)
+		i = std::thread([&]{
+			stats.AddRequest(0, HttpStatus::OK, 1, 2, 1ms);
+			stats.AddRequest(foo, HttpStatus::OK, 1, 2, 1ms);
+			stats.AddRequest(bar, HttpStatus::NOT_FOUND, 1, 2, 1ms);
+			stats.AddRequest(bar, HttpStatus::NOT_FOUND, 1, 2, 1ms);
+		});
+
+	for (auto &i : threads)
+		i.join();
+
+	const auto merged = stats.Merge(tags);
+	EXPECT_EQ(merged.per_tag.size(), 3U);
+
+	const auto &untagged = merged.per_tag.at(""s);
+	EXPECT_EQ(untagged.n_requests, N_THREADS);
+
+	const auto &foo_stats = merged.per_tag.at("foo"s);
+	EXPECT_EQ(foo_stats.n_requests, N_THREADS);
+	EXPECT_EQ(foo_stats.traffic_received, N_THREADS);
+	EXPECT_EQ(foo_stats.traffic_sent, 2 * N_THREADS);
+
+	const auto &bar_stats = merged.per_tag.at("bar"s);
+	EXPECT_EQ(bar_stats.n_requests, 2 * N_THREADS);
+	EXPECT_EQ(bar_stats.n_per_status[HttpStatusToIndex(HttpStatus::NOT_FOUND)],
+		  2 * N_THREADS);
+}
+
+TEST(ShardedPerGeneratorStats, Merge)
+{
+	StatsTagRegistry generators;
+	const auto foo = generators.Intern("foo"sv);
+
+	ShardedPerGeneratorStats stats;
+	stats.AddRequest(foo, HttpStatus::OK);
+
+	std::thread thread([&]{
+		stats.AddRequest(foo, HttpStatus::OK);
+		stats.AddRequest(foo, HttpStatus::INTERNAL_SERVER_ERROR);
+	});
+	thread.join();
+
+	const auto merged = stats.Merge(generators);
+	EXPECT_EQ(merged.per_generator.size(), 1U);
+
+	const auto &foo_stats = merged.per_generator.at("foo"s);
+	EXPECT_EQ(foo_stats.n_per_status[HttpStatusToIndex(HttpStatus::OK)], 2U);
+	EXPECT_EQ(foo_stats.n_per_status[HttpStatusToIndex(HttpStatus::INTERNAL_SERVER_ERROR)], 1U);
+}
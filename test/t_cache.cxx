@@ -3,13 +3,22 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "cache/Cache.hxx"
+#include "cache/ExpiryWheel.hxx"
+#include "cache/FrequencySketch.hxx"
 #include "cache/Item.hxx"
+#include "stats/CacheStats.hxx"
 #include "pool/pool.hxx"
 #include "pool/Holder.hxx"
 #include "PInstance.hxx"
 
 #include <gtest/gtest.h>
 
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
 #include <time.h>
 
 static void *
@@ -252,3 +261,278 @@ TEST(TranslationCache, GetMatchExpired)
 	i = (MyCacheItem *)cache.GetMatch(foo_key, {match_to_ptr(1), my_match});
 	ASSERT_EQ(i, nullptr);
 }
+
+struct WheelItem final : CacheItem {
+	std::chrono::steady_clock::time_point inserted, expires;
+
+	/**
+	 * The time when CacheExpiryWheel::Advance() reported this
+	 * item; zero if it has not been reported yet.
+	 */
+	std::chrono::steady_clock::time_point expired{};
+
+	WheelItem(std::chrono::steady_clock::time_point now,
+		  std::chrono::steady_clock::duration lifetime) noexcept
+		:CacheItem(StringWithHash{nullptr}, 1, now + lifetime),
+		 inserted(now), expires(now + lifetime) {}
+
+	void Extend(std::chrono::steady_clock::time_point now,
+		    std::chrono::steady_clock::duration lifetime) noexcept {
+		inserted = now;
+		expires = now + lifetime;
+		SetExpires(expires);
+	}
+
+	/* virtual methods from class CacheItem */
+	void Destroy() noexcept override {}
+};
+
+struct WheelContext {
+	std::chrono::steady_clock::time_point now;
+};
+
+static void
+OnWheelExpire(void *ctx, CacheItem &_item) noexcept
+{
+	const auto &c = *(const WheelContext *)ctx;
+	auto &item = static_cast<WheelItem &>(_item);
+
+	EXPECT_EQ(item.expired, std::chrono::steady_clock::time_point{});
+	item.expired = c.now;
+}
+
+/**
+ * A starting point far away from the steady_clock epoch.
+ */
+static constexpr std::chrono::steady_clock::time_point wheel_t0{std::chrono::hours{1000}};
+
+TEST(CacheExpiryWheel, Basic)
+{
+	using namespace std::chrono_literals;
+
+	WheelContext c{wheel_t0};
+	CacheExpiryWheel wheel;
+
+	WheelItem a{c.now, 500ms}, b{c.now, 5s}, d{c.now, 100s},
+		e{c.now, 1h}, f{c.now, 30 * 24h}, removed{c.now, 5s};
+
+	for (auto *i : {&a, &b, &d, &e, &f, &removed})
+		wheel.Insert(*i, c.now);
+
+	EXPECT_EQ(wheel.size(), 6U);
+
+	wheel.Remove(removed);
+	EXPECT_EQ(wheel.size(), 5U);
+
+	/* nothing expires early */
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(a.expired, std::chrono::steady_clock::time_point{});
+
+	c.now += 1s;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(a.expired, c.now);
+	EXPECT_EQ(b.expired, std::chrono::steady_clock::time_point{});
+
+	c.now = wheel_t0 + 4s;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(b.expired, std::chrono::steady_clock::time_point{});
+
+	c.now = wheel_t0 + 5s;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(b.expired, c.now);
+
+	/* at most 1/8 late */
+	c.now = wheel_t0 + 99s;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(d.expired, std::chrono::steady_clock::time_point{});
+	c.now = wheel_t0 + 100s + 100s / 8;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_NE(d.expired, std::chrono::steady_clock::time_point{});
+
+	/* extend "e"; it must survive its old expiry time */
+	e.Extend(c.now, 2h);
+	c.now = wheel_t0 + 1h + 10min;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(e.expired, std::chrono::steady_clock::time_point{});
+	c.now = e.expires + 15min;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_NE(e.expired, std::chrono::steady_clock::time_point{});
+
+	/* "f" exceeds the range of the wheel and is reinserted */
+	c.now = f.expires - 1s;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_EQ(f.expired, std::chrono::steady_clock::time_point{});
+	EXPECT_EQ(wheel.size(), 1U);
+	c.now = f.expires + 30 * 24h / 8;
+	wheel.Advance(c.now, {&c, OnWheelExpire});
+	EXPECT_NE(f.expired, std::chrono::steady_clock::time_point{});
+
+	EXPECT_TRUE(wheel.empty());
+	EXPECT_EQ(removed.expired, std::chrono::steady_clock::time_point{});
+}
+
+TEST(CacheExpiryWheel, Random)
+{
+	using namespace std::chrono_literals;
+
+	std::mt19937 rng{42};
+
+	WheelContext c{wheel_t0};
+	CacheExpiryWheel wheel;
+
+	std::vector<std::unique_ptr<WheelItem>> items;
+
+	for (unsigned i = 0; i < 10000; ++i) {
+		std::uniform_int_distribution<unsigned> lifetime(0, 48 * 3600);
+		items.emplace_back(std::make_unique<WheelItem>(c.now, std::chrono::seconds{lifetime(rng)}));
+		wheel.Insert(*items.back(), c.now);
+
+		if (i % 100 == 0) {
+			std::uniform_int_distribution<unsigned> step(0, 30);
+			c.now += std::chrono::seconds{step(rng)};
+			wheel.Advance(c.now, {&c, OnWheelExpire});
+		}
+	}
+
+	while (!wheel.empty()) {
+		std::uniform_int_distribution<unsigned> step(1, 600);
+		c.now += std::chrono::seconds{step(rng)};
+		wheel.Advance(c.now, {&c, OnWheelExpire});
+	}
+
+	for (const auto &i : items) {
+		ASSERT_NE(i->expired, std::chrono::steady_clock::time_point{});
+
+		/* never early */
+		EXPECT_GE(i->expired, i->expires);
+
+		/* not much later than 1/8 of the lifetime (plus
+		   the step size of the loop above) */
+		EXPECT_LE(i->expired,
+			  i->expires + (i->expires - i->inserted) / 8 + 602s);
+	}
+}
+
+TEST(FrequencySketch, Basic)
+{
+	FrequencySketch sketch;
+	EXPECT_EQ(sketch.GetCapacity(), 0U);
+
+	/* without a table, nothing is counted */
+	sketch.Increment(1);
+	EXPECT_EQ(sketch.Estimate(1), 0U);
+
+	sketch.EnsureCapacity(1000);
+	EXPECT_EQ(sketch.GetCapacity(), 1024U);
+
+	for (unsigned i = 0; i < 5; ++i)
+		sketch.Increment(1);
+	sketch.Increment(2);
+
+	EXPECT_EQ(sketch.Estimate(1), 5U);
+	EXPECT_EQ(sketch.Estimate(2), 1U);
+	EXPECT_EQ(sketch.Estimate(3), 0U);
+
+	/* the counters saturate */
+	for (unsigned i = 0; i < 100; ++i)
+		sketch.Increment(1);
+	EXPECT_EQ(sketch.Estimate(1), FrequencySketch::MAX_FREQUENCY);
+
+	sketch.Clear();
+	EXPECT_EQ(sketch.Estimate(1), 0U);
+}
+
+TEST(FrequencySketch, Aging)
+{
+	FrequencySketch sketch;
+	sketch.EnsureCapacity(64);
+
+	for (unsigned i = 0; i < 8; ++i)
+		sketch.Increment(1);
+	EXPECT_EQ(sketch.Estimate(1), 8U);
+
+	/* lots of other keys let the old popularity fade away */
+	for (std::size_t i = 1000; i < 3000; ++i)
+		sketch.Increment(i);
+
+	EXPECT_LT(sketch.Estimate(1), 8U);
+}
+
+struct AdmissionItem final : CacheItem {
+	const std::string_view key;
+
+	bool destroyed = false;
+
+	AdmissionItem(std::string_view _key,
+		      std::chrono::steady_clock::time_point now) noexcept
+		:CacheItem(StringWithHash{_key}, 1, now, std::chrono::hours{1}),
+		 key(_key) {}
+
+	/* virtual methods from class CacheItem */
+	void Destroy() noexcept override {
+		destroyed = true;
+	}
+};
+
+/**
+ * Simulate a crawler: lots of unique keys are requested once, while a
+ * small set of "hot" keys keeps getting requested, too.
+ *
+ * @return the number of cache hits for the hot keys
+ */
+static unsigned
+RunScan(CacheAdmission admission, CacheStats &stats)
+{
+	PInstance instance;
+
+	Cache cache(instance.event_loop, 100, nullptr, admission);
+
+	const auto now = std::chrono::steady_clock::now();
+
+	std::deque<std::string> keys;
+	std::vector<std::unique_ptr<AdmissionItem>> items;
+
+	/* look up the key; on a miss, add a new item */
+	auto request = [&](std::string_view key){
+		if (cache.Get(StringWithHash{key}) != nullptr)
+			return true;
+
+		items.emplace_back(std::make_unique<AdmissionItem>(key, now));
+		cache.Put(*items.back());
+		return false;
+	};
+
+	for (unsigned i = 0; i < 50; ++i)
+		keys.emplace_back("hot" + std::to_string(i));
+
+	for (unsigned i = 0; i < 50; ++i)
+		request(keys[i]);
+
+	unsigned n_hits = 0;
+
+	for (unsigned i = 0; i < 10000; ++i) {
+		request(keys.emplace_back("scan" + std::to_string(i)));
+
+		if (i % 2 == 0 && request(keys[(i / 2) % 50]))
+			++n_hits;
+	}
+
+	cache.FillStats(stats);
+	cache.Flush();
+	return n_hits;
+}
+
+TEST(Cache, TinyLfu)
+{
+	CacheStats stats{};
+
+	/* the scan wipes out the hot items from a plain LRU cache */
+	EXPECT_LT(RunScan(CacheAdmission::LRU, stats), 100U);
+	EXPECT_GT(stats.evictions, 9000U);
+	EXPECT_EQ(stats.rejections, 0U);
+
+	/* with TinyLFU, the hot items stay */
+	stats = {};
+	EXPECT_GT(RunScan(CacheAdmission::TINY_LFU, stats), 4900U);
+	EXPECT_GT(stats.rejections, 5000U);
+}
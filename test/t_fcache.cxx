@@ -5,6 +5,7 @@
 #include "http/rl/BlockingResourceLoader.hxx"
 #include "http/rl/MirrorResourceLoader.hxx"
 #include "http/cache/FilterCache.hxx"
+#include "cache/Admission.hxx"
 #include "strmap.hxx"
 #include "http/ResponseHandler.hxx"
 #include "ResourceAddress.hxx"
@@ -29,6 +30,7 @@ TestCancelBlocking()
 
 		BlockingResourceLoader resource_loader;
 		FilterCache *fcache = filter_cache_new(root_pool, 65536,
+						       CacheAdmission::LRU,
 						       event_loop, resource_loader);
 
 		~Context() noexcept {
@@ -68,6 +70,7 @@ TestNoBody()
 
 		MirrorResourceLoader resource_loader;
 		FilterCache *fcache = filter_cache_new(root_pool, 65536,
+						       CacheAdmission::LRU,
 						       event_loop, resource_loader);
 
 		~Context() noexcept {
@@ -5,6 +5,9 @@
 #include "TestInstance.hxx"
 #include "tconstruct.hxx"
 #include "http/cache/Public.hxx"
+#include "http/cache/DiskConfig.hxx"
+#include "http/cache/KeyRules.hxx"
+#include "cache/Admission.hxx"
 #include "http/rl/ResourceLoader.hxx"
 #include "ResourceAddress.hxx"
 #include "RecordingHttpResponseHandler.hxx"
@@ -24,6 +27,8 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <stdio.h>
@@ -184,9 +189,16 @@ struct Instance final : TestInstance {
 
 	HttpCache *const cache;
 
-	Instance()
-		:cache(http_cache_new(root_pool, 1024 * 1024, true,
-				      event_loop, resource_loader))
+	explicit Instance(const HttpCacheDiskConfig &disk_config={})
+		:cache(http_cache_new(root_pool, 1024 * 1024,
+				      CacheAdmission::LRU, true,
+				      HttpCacheKeyRules{},
+				      disk_config,
+				      event_loop,
+#ifdef HAVE_URING
+				      nullptr,
+#endif
+				      resource_loader))
 	{
 	}
 
@@ -542,3 +554,251 @@ TEST(HttpCache, Tag)
 	run_cache_test(instance, request, false);
 	run_cache_test(instance, request, true);
 }
+
+TEST(HttpCache, Disk)
+{
+	char path[] = "/tmp/t_http_cache_XXXXXX";
+	ASSERT_NE(mkdtemp(path), nullptr);
+
+	{
+		Instance instance{HttpCacheDiskConfig{
+			.path = path,
+			.max_size = 16 * 1024 * 1024,
+			.max_object_size = 1024 * 1024,
+		}};
+
+		/* larger than the in-memory limit */
+		const std::string large(768 * 1024, 'x');
+
+		Request r{
+			.uri = "/large",
+			.response_headers = "date: " DATE "\n"
+			"last-modified: " STAMP1 "\n"
+			"expires: " EXPIRES "\n",
+			.response_body = large.c_str(),
+		};
+
+		run_cache_test(instance, r, false);
+		run_cache_test(instance, r, true);
+
+		/* larger than the disk tier's object size limit */
+		const std::string too_large(2 * 1024 * 1024, 'y');
+		r.uri = "/too_large";
+		r.response_body = too_large.c_str();
+
+		run_cache_test(instance, r, false);
+		run_cache_test(instance, r, false);
+	}
+
+	/* all files have been deleted */
+	ASSERT_EQ(rmdir(path), 0);
+}
+
+struct PartialResult {
+	HttpStatus status;
+	std::multimap<std::string, std::string, std::less<>> headers;
+	std::string body;
+	bool has_body;
+
+	const char *GetHeader(std::string_view name) const noexcept {
+		auto i = headers.find(name);
+		return i != headers.end() ? i->second.c_str() : nullptr;
+	}
+};
+
+/**
+ * Send a "HEAD" or "Range" request which is expected to be served
+ * from the cache.
+ */
+static PartialResult
+run_partial_test(Instance &instance, HttpMethod method, const char *uri,
+		 const char *request_headers)
+{
+	auto pool = pool_new_linear(instance.root_pool, "t_http_cache", 8192);
+	const AllocatorPtr alloc{pool};
+	auto uwa = MakeHttpAddress(uri).Host("foo");
+	const ResourceAddress address(uwa);
+
+	CancellablePointer cancel_ptr;
+
+	instance.resource_loader.current_request = nullptr;
+	instance.resource_loader.got_request = false;
+
+	StringMap headers;
+	if (request_headers != nullptr) {
+		GrowingBuffer gb;
+		gb.Write(request_headers);
+
+		header_parse_buffer(alloc, headers, std::move(gb));
+	}
+
+	RecordingHttpResponseHandler handler(instance.root_pool,
+					     instance.event_loop);
+
+	http_cache_request(*instance.cache, pool, nullptr, {},
+			   method, address,
+			   std::move(headers), nullptr,
+			   handler, cancel_ptr);
+
+	if (handler.IsAlive())
+		instance.event_loop.Run();
+
+	EXPECT_FALSE(instance.resource_loader.got_request);
+	EXPECT_FALSE(handler.IsAlive());
+	EXPECT_EQ(handler.error, nullptr);
+
+	const char *x_cache = nullptr;
+	if (auto i = handler.headers.find("x-cache"sv); i != handler.headers.end())
+		x_cache = i->second.c_str();
+	EXPECT_STREQ(x_cache, "HIT");
+
+	return {
+		.status = handler.status,
+		.headers = std::move(handler.headers),
+		.body = std::move(handler.body),
+		.has_body = handler.state == RecordingHttpResponseHandler::State::END,
+	};
+}
+
+TEST(HttpCache, Range)
+{
+	Instance instance;
+
+	static constexpr Request r0{
+		.uri = "/range",
+		.response_headers = "date: " DATE "\n"
+		"last-modified: " STAMP1 "\n"
+		"expires: " EXPIRES "\n"
+		"content-type: text/plain\n",
+		.response_body = "0123456789",
+	};
+
+	run_cache_test(instance, r0, false);
+
+	/* HEAD */
+	auto result = run_partial_test(instance, HttpMethod::HEAD, r0.uri, nullptr);
+	EXPECT_EQ(result.status, HttpStatus::OK);
+	EXPECT_FALSE(result.has_body);
+	EXPECT_STREQ(result.GetHeader("content-length"), "10");
+
+	/* single ranges */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=2-4\n");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 2-4/10");
+	EXPECT_EQ(result.body, "234");
+
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=-3\n");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 7-9/10");
+	EXPECT_EQ(result.body, "789");
+
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=8-100\n");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 8-9/10");
+	EXPECT_EQ(result.body, "89");
+
+	/* last-pos beyond the end, up to the maximum value */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=9-10
+");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 9-9/10");
+	EXPECT_EQ(result.body, "9");
+
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=5-18446744073709551615
+");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 5-9/10");
+	EXPECT_EQ(result.body, "56789");
+
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=0-18446744073709551615
+");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 0-9/10");
+	EXPECT_EQ(result.body, "0123456789");
+
+	/* the range unit is case-insensitive */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: Bytes=2-4
+");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 2-4/10");
+	EXPECT_EQ(result.body, "234");
+
+	/* overlapping ranges are merged */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=0-2, 1-4\n");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes 0-4/10");
+	EXPECT_EQ(result.body, "01234");
+
+	/* multiple ranges */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=5-6,0-1\n");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_EQ(result.GetHeader("content-range"), nullptr);
+
+	const char *content_type = result.GetHeader("content-type");
+	ASSERT_NE(content_type, nullptr);
+
+	std::string_view boundary{content_type};
+	ASSERT_TRUE(boundary.starts_with("multipart/byteranges; boundary="sv));
+	boundary.remove_prefix(31);
+
+	std::string expected_body = "--";
+	expected_body += boundary;
+	expected_body += "\r\ncontent-type: text/plain\r\n"
+		"content-range: bytes 0-1/10\r\n\r\n01\r\n--";
+	expected_body += boundary;
+	expected_body += "\r\ncontent-type: text/plain\r\n"
+		"content-range: bytes 5-6/10\r\n\r\n56\r\n--";
+	expected_body += boundary;
+	expected_body += "--\r\n";
+	EXPECT_EQ(result.body, expected_body);
+
+	/* not satisfiable */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=20-\n");
+	EXPECT_EQ(result.status, HttpStatus::REQUESTED_RANGE_NOT_SATISFIABLE);
+	EXPECT_STREQ(result.GetHeader("content-range"), "bytes */10");
+	EXPECT_FALSE(result.has_body);
+
+	/* "If-Range" mismatch and unsupported unit: the whole body */
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=2-4\n"
+				  "if-range: \"foo\"\n");
+	EXPECT_EQ(result.status, HttpStatus::OK);
+	EXPECT_EQ(result.body, "0123456789");
+
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: bytes=2-4\n"
+				  "if-range: " STAMP1 "\n");
+	EXPECT_EQ(result.status, HttpStatus::PARTIAL_CONTENT);
+	EXPECT_EQ(result.body, "234");
+
+	result = run_partial_test(instance, HttpMethod::GET, r0.uri,
+				  "range: items=2-4\n");
+	EXPECT_EQ(result.status, HttpStatus::OK);
+	EXPECT_EQ(result.body, "0123456789");
+
+	/* a Range miss is forwarded, but the partial response is not
+	   stored (and without a complete length in the
+	   "Content-Range" header, there is no background fill) */
+	static constexpr Request miss{
+		.uri = "/range-miss",
+		.request_headers = "range: bytes=0-1\n",
+		.status = HttpStatus::PARTIAL_CONTENT,
+		.response_headers = "date: " DATE "\n"
+		"expires: " EXPIRES "\n"
+		"content-range: bytes 0-1/*\n",
+		.response_body = "01",
+	};
+
+	run_cache_test(instance, miss, false);
+	run_cache_test(instance, miss, false);
+}
@@ -1324,3 +1324,145 @@ TYPED_TEST(HttpServerTest, RawPostHold)
 
 	client->ReleaseSocket(false, PutAction::REUSE);
 }
+
+/**
+ * Has the complete header of a "200 OK" response been received?
+ */
+[[gnu::pure]]
+static bool
+HasOkResponseHeader(std::string_view response) noexcept
+{
+	const auto i = response.find("HTTP/1.1 200 OK\r\n"sv);
+	return i != response.npos &&
+		response.find("\r\n\r\n"sv, i) != response.npos;
+}
+
+/**
+ * Test "103 Early Hints" with a raw client.
+ */
+TYPED_TEST(HttpServerTest, RawEarlyHints)
+{
+	auto &instance = this->instance_;
+	auto server = this->MakeServer();
+
+	static constexpr std::string_view link = "</a.css>; rel=preload; as=style"sv;
+	static constexpr std::string_view early_hints =
+		"HTTP/1.1 103 Early Hints\r\nlink: </a.css>; rel=preload; as=style\r\n\r\n"sv;
+
+	server.SetRequestHandler([](IncomingHttpRequest &request, CancellablePointer &) noexcept {
+		request.SendEarlyHints(link);
+		request.SendResponse(HttpStatus::OK, {},
+				     std::move(request.body));
+	});
+
+	// the 103 goes out before the final response
+
+	{
+		auto client = server.MakeRawClient();
+		client->Write(AsBytes("GET / HTTP/1.1\r\n\r\n"sv));
+
+		while (!HasOkResponseHeader(client->GetResponse()))
+			instance.event_loop.Run();
+
+		EXPECT_TRUE(client->SkipResponse(early_hints));
+		EXPECT_TRUE(client->GetResponse().starts_with("HTTP/1.1 200 OK\r\n"sv));
+
+		client->TakeResponse();
+		client->ReleaseSocket(false, PutAction::REUSE);
+	}
+
+	// HTTP/1.0 clients don't understand 1xx responses
+
+	{
+		auto client = server.MakeRawClient();
+		client->Write(AsBytes("GET / HTTP/1.0\r\n\r\n"sv));
+
+		while (!HasOkResponseHeader(client->GetResponse()))
+			instance.event_loop.Run();
+
+		EXPECT_TRUE(client->GetResponse().starts_with("HTTP/1.1 200 OK\r\n"sv));
+		EXPECT_EQ(client->GetResponse().find("103"sv), std::string_view::npos);
+
+		client->TakeResponse();
+		client->ReleaseSocket(false, PutAction::REUSE);
+	}
+
+	// expect:100-continue; the 103 goes out before the "100 Continue"
+
+	IncomingHttpRequest *delayed_request = nullptr;
+
+	server.SetRequestHandler([&delayed_request](IncomingHttpRequest &request, CancellablePointer &) noexcept {
+		delayed_request = &request;
+	});
+
+	{
+		auto client = server.MakeRawClient();
+		client->Write(AsBytes("POST / HTTP/1.1\r\ncontent-length: 3\r\nexpect: 100-continue\r\n\r\n"sv));
+
+		FlushIO(instance.event_loop);
+		this->FlushFilters();
+		FlushIO(instance.event_loop);
+		EXPECT_EQ(client->GetResponse(), ""sv);
+
+		ASSERT_TRUE(delayed_request != nullptr);
+
+		/* the 103 is sent right away, without waiting for the
+		   response */
+		delayed_request->SendEarlyHints(link);
+
+		while (client->GetResponse().size() < early_hints.size())
+			instance.event_loop.Run();
+
+		EXPECT_TRUE(client->SkipResponse(early_hints));
+		EXPECT_EQ(client->GetResponse(), ""sv);
+
+		delayed_request->SendResponse(HttpStatus::OK, {},
+					      std::move(delayed_request->body));
+
+		while (!HasOkResponseHeader(client->GetResponse()))
+			instance.event_loop.Run();
+
+		EXPECT_TRUE(client->SkipResponse("HTTP/1.1 100 Continue\r\n\r\n"sv));
+		EXPECT_TRUE(client->GetResponse().starts_with("HTTP/1.1 200 OK\r\n"sv));
+		client->TakeResponse();
+
+		client->Write(AsBytes("ABC"sv));
+		instance.event_loop.Run();
+		EXPECT_EQ(client->TakeResponse(), "ABC"sv);
+
+		client->ReleaseSocket(false, PutAction::REUSE);
+	}
+
+	/* a "link" header which is too large for the socket buffer,
+	   i.e. the 103 is written partially; the final response
+	   must not be sent before the rest of it */
+
+	std::string large_link;
+	while (large_link.size() < 1024 * 1024)
+		large_link.append("</a.css>; rel=preload; as=style, "sv);
+	large_link.append(link);
+
+	server.SetRequestHandler([&large_link](IncomingHttpRequest &request, CancellablePointer &) noexcept {
+		request.SendEarlyHints(large_link);
+		request.SendEarlyHints(link);
+		request.SendResponse(HttpStatus::OK, {},
+				     std::move(request.body));
+	});
+
+	{
+		auto client = server.MakeRawClient();
+		client->Write(AsBytes("GET / HTTP/1.1\r\n\r\n"sv));
+
+		while (!HasOkResponseHeader(client->GetResponse()))
+			instance.event_loop.Run();
+
+		EXPECT_TRUE(client->SkipResponse("HTTP/1.1 103 Early Hints\r\nlink: "sv));
+		EXPECT_TRUE(client->SkipResponse(large_link));
+		EXPECT_TRUE(client->SkipResponse("\r\n\r\n"sv));
+		EXPECT_TRUE(client->SkipResponse(early_hints));
+		EXPECT_TRUE(client->GetResponse().starts_with("HTTP/1.1 200 OK\r\n"sv));
+
+		client->TakeResponse();
+		client->ReleaseSocket(false, PutAction::REUSE);
+	}
+}
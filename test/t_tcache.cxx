@@ -46,7 +46,8 @@ struct Instance : PInstance {
 	TranslationCache cache;
 
 	Instance()
-		:cache(root_pool, event_loop, pcre_cache, ts, 1024) {}
+		:cache(root_pool, event_loop, pcre_cache, ts, 1024,
+		       CacheAdmission::LRU) {}
 };
 
 const TranslateResponse *next_response;
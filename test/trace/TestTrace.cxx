@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "trace/Context.hxx"
+#include "trace/OtlpJson.hxx"
+#include "trace/Ring.hxx"
+
+#include <gtest/gtest.h>
+
+using std::string_view_literals::operator""sv;
+
+static TraceRecord
+MakeSpan(uint64_t span_id, uint8_t n_events=0) noexcept
+{
+	TraceRecord r{};
+	r.type = TraceRecord::Type::SPAN;
+	r.kind = TraceRecord::Kind::SERVER;
+	r.trace_id[15] = 1;
+	r.span_id = span_id;
+	r.start_ns = 1000;
+	r.end_ns = 2000;
+	r.n_events = n_events;
+	r.SetName("GET /"sv);
+	return r;
+}
+
+TEST(Trace, Ring)
+{
+	TraceRing<4> ring;
+
+	const TraceRecord a[] = {MakeSpan(1), MakeSpan(2), MakeSpan(3)};
+	EXPECT_TRUE(ring.Push(a));
+
+	/* doesn't fit; all or nothing */
+	EXPECT_FALSE(ring.Push(a));
+	EXPECT_EQ(ring.GetDropped(), 1U);
+
+	uint64_t expected = 1;
+	EXPECT_EQ(ring.ConsumeAll([&expected](const TraceRecord &r){
+		EXPECT_EQ(r.span_id, expected++);
+	}), 3U);
+
+	/* wraps around */
+	EXPECT_TRUE(ring.Push(a));
+	EXPECT_EQ(ring.ConsumeAll([](const TraceRecord &){}), 3U);
+	EXPECT_EQ(ring.ConsumeAll([](const TraceRecord &){}), 0U);
+}
+
+TEST(Trace, ParseTraceParent)
+{
+	const auto ctx = ParseTraceParent("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"sv);
+	ASSERT_TRUE(ctx);
+	EXPECT_EQ(ctx->trace_id[0], 0x0a);
+	EXPECT_EQ(ctx->trace_id[15], 0x9c);
+	EXPECT_EQ(ctx->parent_span_id, 0xb7ad6b7169203331U);
+	EXPECT_TRUE(ctx->sampled);
+
+	EXPECT_FALSE(ParseTraceParent("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00"sv)->sampled);
+
+	/* uppercase is not allowed */
+	EXPECT_FALSE(ParseTraceParent("00-0AF7651916CD43DD8448EB211C80319C-b7ad6b7169203331-01"sv));
+
+	/* all-zero ids are invalid */
+	EXPECT_FALSE(ParseTraceParent("00-00000000000000000000000000000000-b7ad6b7169203331-01"sv));
+	EXPECT_FALSE(ParseTraceParent("00-0af7651916cd43dd8448eb211c80319c-0000000000000000-01"sv));
+
+	EXPECT_FALSE(ParseTraceParent("01-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"sv));
+	EXPECT_FALSE(ParseTraceParent("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331"sv));
+	EXPECT_FALSE(ParseTraceParent(""sv));
+}
+
+TEST(Trace, OtlpJson)
+{
+	TraceRecord event{};
+	event.type = TraceRecord::Type::EVENT;
+	event.span_id = 0x2a;
+	event.start_ns = 1500;
+	event.SetName("a\"b"sv);
+
+	const TraceRecord records[] = {MakeSpan(0x2a, 1), event};
+
+	std::string json;
+	FormatOtlpJson(json, "test"sv, records);
+
+	EXPECT_EQ(json,
+		  R"({"resourceSpans":[{"resource":{"attributes":[{"key":"service.name","value":{"stringValue":"test"}}]},"scopeSpans":[{"scope":{"name":"beng-proxy"},"spans":[)"
+		  R"({"traceId":"00000000000000000000000000000001","spanId":"000000000000002a","name":"GET /","kind":2,"startTimeUnixNano":"1000","endTimeUnixNano":"2000","events":[{"timeUnixNano":"1500","name":"a\"b"}]})"
+		  "]}]}]}\n");
+}
@@ -8,6 +8,9 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <vector>
+
 TEST(UriPNormalize, NormalizeUriPath)
 {
 	TestPool pool;
@@ -39,3 +42,66 @@ TEST(UriPNormalize, NormalizeUriPath)
 	EXPECT_STREQ(NormalizeUriPath(alloc, ".."), "..");
 	EXPECT_STREQ(NormalizeUriPath(alloc, "/1/2/.."), "/1/2/..");
 }
+
+TEST(UriPNormalize, NormalizeUriEscapes)
+{
+	TestPool pool;
+	AllocatorPtr alloc(pool);
+
+	const std::string_view unmodified = "/foo%2Fbar?a=%C3%A4";
+	EXPECT_EQ(NormalizeUriEscapes(alloc, unmodified).data(), unmodified.data());
+
+	EXPECT_EQ(NormalizeUriEscapes(alloc, ""), "");
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/%7Efoo"), "/~foo");
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/%41%62%2d%2E%5f"), "/Ab-._");
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/foo%2fbar"), "/foo%2Fbar");
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/%c3%a4%7e"), "/%C3%A4~");
+
+	/* malformed escapes are left alone */
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/%"), "/%");
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/%4"), "/%4");
+	EXPECT_EQ(NormalizeUriEscapes(alloc, "/%xy%41"), "/%xyA");
+}
+
+TEST(UriPNormalize, RemoveQueryParameters)
+{
+	TestPool pool;
+	AllocatorPtr alloc(pool);
+
+	const std::vector<std::string> names{"fbclid", "utm_*"};
+
+	const std::string_view unmodified = "a=1&b=2&fbclid_x=3";
+	EXPECT_EQ(RemoveQueryParameters(alloc, unmodified, names).data(),
+		  unmodified.data());
+
+	EXPECT_EQ(RemoveQueryParameters(alloc, "", names), "");
+	EXPECT_EQ(RemoveQueryParameters(alloc, "fbclid=x", names), "");
+	EXPECT_EQ(RemoveQueryParameters(alloc, "fbclid", names), "");
+	EXPECT_EQ(RemoveQueryParameters(alloc, "a=1&fbclid=x&b=2", names), "a=1&b=2");
+	EXPECT_EQ(RemoveQueryParameters(alloc, "utm_source=x&a=1&utm_medium=y", names),
+		  "a=1");
+	EXPECT_EQ(RemoveQueryParameters(alloc, "a=1&&b=2&", names), "a=1&b=2");
+	EXPECT_EQ(RemoveQueryParameters(alloc, "utm=1", names), "utm=1");
+}
+
+TEST(UriPNormalize, SortQueryString)
+{
+	TestPool pool;
+	AllocatorPtr alloc(pool);
+
+	const std::string_view unmodified = "a=1&b=2&c";
+	EXPECT_EQ(SortQueryString(alloc, unmodified).data(), unmodified.data());
+
+	EXPECT_EQ(SortQueryString(alloc, ""), "");
+	EXPECT_EQ(SortQueryString(alloc, "b=2&a=1"), "a=1&b=2");
+	EXPECT_EQ(SortQueryString(alloc, "c&b=2&a=1&a=0"), "a=1&a=0&b=2&c");
+
+	/* repeated parameters keep their order */
+	const std::string_view repeated = "a=2&a=1&b";
+	EXPECT_EQ(SortQueryString(alloc, repeated).data(), repeated.data());
+	EXPECT_EQ(SortQueryString(alloc, "b&x=3&a=2&x=1&a=1&x=2"),
+		  "a=2&a=1&b&x=3&x=1&x=2");
+
+	/* only the name is compared ("a" sorts before "a-b") */
+	EXPECT_EQ(SortQueryString(alloc, "a-b=1&a=2"), "a=2&a-b=1");
+}
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "../tconstruct.hxx"
+#include "widget/FragmentPolicy.hxx"
+#include "widget/Widget.hxx"
+#include "widget/Class.hxx"
+#include "widget/View.hxx"
+#include "http/Address.hxx"
+#include "http/Method.hxx"
+#include "PInstance.hxx"
+#include "AllocatorPtr.hxx"
+#include "strmap.hxx"
+#include "pool/pool.hxx"
+#include "pool/Ptr.hxx"
+
+#include <gtest/gtest.h>
+
+using Group = HeaderForwardSettings::Group;
+using Mode = HeaderForwardSettings::Mode;
+
+namespace {
+
+/**
+ * A widget class which qualifies for the #WidgetFragmentCache.
+ */
+struct MakeCacheableClass : WidgetClass {
+	explicit MakeCacheableClass(struct pool &p) {
+		auto http = MakeHttpAddress("/footer").Host("widget-server");
+		auto &view = *NewFromPool<WidgetView>(p, *NewFromPool<HttpAddress>(p, p, http));
+		view.request_header_forward[Group::COOKIE] = Mode::NO;
+		view.request_header_forward[Group::IDENTITY] = Mode::NO;
+		view.response_header_forward[Group::COOKIE] = Mode::NO;
+		views.push_front(view);
+
+		fragment_max_age = std::chrono::minutes(5);
+	}
+
+	WidgetView &GetView() noexcept {
+		return views.front();
+	}
+};
+
+struct Context : PInstance {
+	PoolPtr pool = pool_new_libc(root_pool, "test");
+
+	Widget container{Widget::RootTag(), *pool, "root"};
+};
+
+} // anonymous namespace
+
+TEST(FragmentPolicy, SessionIndependent)
+{
+	Context c;
+	MakeCacheableClass cls{*c.pool};
+	auto &view = cls.GetView();
+
+	EXPECT_TRUE(IsSessionIndependent(view));
+
+	for (const auto group : {Group::COOKIE, Group::IDENTITY,
+				 Group::AUTH, Group::SSL, Group::SECURE}) {
+		for (const auto mode : {Mode::YES, Mode::MANGLE, Mode::BOTH}) {
+			view.request_header_forward[group] = mode;
+			EXPECT_FALSE(IsSessionIndependent(view));
+		}
+
+		view.request_header_forward[group] = Mode::NO;
+		EXPECT_TRUE(IsSessionIndependent(view));
+	}
+
+	view.response_header_forward[Group::COOKIE] = Mode::MANGLE;
+	EXPECT_FALSE(IsSessionIndependent(view));
+	view.response_header_forward[Group::COOKIE] = Mode::NO;
+
+	/* these groups do not depend on the session */
+	view.request_header_forward[Group::CAPABILITIES] = Mode::YES;
+	view.request_header_forward[Group::CORS] = Mode::YES;
+	EXPECT_TRUE(IsSessionIndependent(view));
+
+	/* the defaults forward cookies and identity */
+	const WidgetView default_view{"default"};
+	EXPECT_FALSE(IsSessionIndependent(default_view));
+}
+
+TEST(FragmentPolicy, Cacheable)
+{
+	Context c;
+	MakeCacheableClass cls{*c.pool};
+
+	Widget widget{*c.pool, &cls};
+	widget.from_request.method = HttpMethod::GET;
+	EXPECT_TRUE(IsFragmentCacheable(widget));
+
+	/* not enabled by the translation server */
+	cls.fragment_max_age = {};
+	EXPECT_FALSE(IsFragmentCacheable(widget));
+	cls.fragment_max_age = std::chrono::minutes(5);
+
+	widget.from_request.method = HttpMethod::POST;
+	EXPECT_FALSE(IsFragmentCacheable(widget));
+	widget.from_request.method = HttpMethod::GET;
+
+	widget.from_request.unauthorized_view = true;
+	EXPECT_FALSE(IsFragmentCacheable(widget));
+	widget.from_request.unauthorized_view = false;
+
+	cls.GetView().request_header_forward[Group::SECURE] = Mode::MANGLE;
+	EXPECT_FALSE(IsFragmentCacheable(widget));
+	cls.GetView().request_header_forward[Group::SECURE] = Mode::NO;
+
+	EXPECT_TRUE(IsFragmentCacheable(widget));
+}
+
+TEST(FragmentPolicy, CacheableResponse)
+{
+	Context c;
+	const AllocatorPtr alloc{*c.pool};
+
+	EXPECT_TRUE(IsFragmentCacheableResponse(StringMap{}));
+	EXPECT_TRUE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"content-type", "text/html"},
+		{"cache-control", "public, max-age=60"},
+	}}));
+
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"cache-control", "private"},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"cache-control", "max-age=60, private=\"x-foo\""},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"cache-control", "no-store"},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"cache-control", "public"},
+		{"cache-control", "no-cache"},
+	}}));
+
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"set-cookie", "a=b"},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"set-cookie2", "a=b"},
+	}}));
+
+	/* "Vary" is only allowed for headers covered by the key */
+	EXPECT_TRUE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"vary", "Accept-Language, user-agent"},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"vary", "accept-language, cookie"},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"vary", "accept-language"},
+		{"vary", "accept-encoding"},
+	}}));
+	EXPECT_FALSE(IsFragmentCacheableResponse(StringMap{alloc, {
+		{"vary", "*"},
+	}}));
+}
+
+TEST(FragmentPolicy, Key)
+{
+	Context c;
+	const AllocatorPtr alloc{*c.pool};
+	MakeCacheableClass cls{*c.pool};
+
+	Widget widget{*c.pool, &cls};
+	widget.class_name = "footer";
+	widget.parent = &c.container;
+	widget.SetId("f");
+
+	const auto key = MakeFragmentKey(alloc, widget, "http://host/a.html",
+					 "de", nullptr, false);
+	EXPECT_EQ(key.value, MakeFragmentKey(alloc, widget, "http://host/a.html",
+					     "de", nullptr, false).value);
+
+	/* everything which affects the fragment is part of the key */
+	EXPECT_NE(key.value, MakeFragmentKey(alloc, widget, "http://host/b.html",
+					     "de", nullptr, false).value);
+	EXPECT_NE(key.value, MakeFragmentKey(alloc, widget, "http://host/a.html",
+					     "en", nullptr, false).value);
+	EXPECT_NE(key.value, MakeFragmentKey(alloc, widget, "http://host/a.html",
+					     nullptr, nullptr, false).value);
+	EXPECT_NE(key.value, MakeFragmentKey(alloc, widget, "http://host/a.html",
+					     "de", "Mozilla/5.0", false).value);
+	EXPECT_NE(key.value, MakeFragmentKey(alloc, widget, "http://host/a.html",
+					     "de", nullptr, true).value);
+
+	Widget other{*c.pool, &cls};
+	other.class_name = "footer";
+	other.parent = &c.container;
+	other.SetId("g");
+	EXPECT_NE(key.value, MakeFragmentKey(alloc, other, "http://host/a.html",
+					     "de", nullptr, false).value);
+
+	/* header values cannot be shifted between key components */
+	EXPECT_NE(MakeFragmentKey(alloc, widget, "http://host/a.html",
+				  "de|x", "y", false).value,
+		  MakeFragmentKey(alloc, widget, "http://host/a.html",
+				  "de", "x|y", false).value);
+}